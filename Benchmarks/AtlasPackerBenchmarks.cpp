@@ -0,0 +1,97 @@
+//
+// Skyline packing speed and how full it gets the pages, for power of two textures, arbitrary sizes, and arbitrary sizes
+// padded with the 8 texel gutters and alignment TextureAtlas uses (the padding counts as occupied)
+//
+
+#include "Benchmark.h"
+#include "AtlasPacker.h"
+
+// Page size and rectangles packed per set
+static const UINT PageSize = 1024;
+static const UINT RectCount = 200;
+
+// Sets packed per configuration
+static const UINT Sets = 50;
+
+struct PackResult
+{
+	UINT pages;
+	double occupancy;	// Mean over every page but the last, which is only as full as what was left
+};
+
+typedef std::pair<UINT, UINT> RectSize;
+
+/// <summary>Packs tallest first, opening a new page when nothing open has room, as TextureAtlas does
+/// </summary>
+static PackResult Pack(const std::vector<RectSize>& sizes, UINT alignment)
+{
+	std::vector<AtlasPacker> packers;
+	for (const RectSize& size : sizes)
+	{
+		AtlasRect rect;
+		size_t page = 0;
+		while (page < packers.size() && !packers[page].Insert(size.first, size.second, rect))
+			page++;
+		if (page == packers.size())
+		{
+			packers.push_back(AtlasPacker(PageSize, PageSize, alignment));
+			packers.back().Insert(size.first, size.second, rect);
+		}
+	}
+
+	PackResult result;
+	result.pages = (UINT)packers.size();
+	result.occupancy = 0.0;
+	for (size_t page = 0; page + 1 < packers.size(); page++)
+		result.occupancy += packers[page].GetOccupancy();
+	if (packers.size() > 1)
+		result.occupancy /= packers.size() - 1;
+	else
+		result.occupancy = packers[0].GetOccupancy();
+	return result;
+}
+
+static void RunConfiguration(const char* name, UINT alignment, UINT gutter, bool powerOfTwo)
+{
+	std::mt19937 random(7);
+	std::vector<std::vector<RectSize> > sets(Sets);
+	for (std::vector<RectSize>& sizes : sets)
+	{
+		for (UINT i = 0; i < RectCount; i++)
+		{
+			UINT width = powerOfTwo ? 16u << (random() % 5) : 8 + random() % 240;
+			UINT height = powerOfTwo ? 16u << (random() % 5) : 8 + random() % 240;
+			sizes.push_back(RectSize(width + 2 * gutter, height + 2 * gutter));
+		}
+		std::sort(sizes.begin(), sizes.end(), [](const RectSize& a, const RectSize& b)
+		{
+			return a.second != b.second ? a.second > b.second : a.first > b.first;
+		});
+	}
+
+	double occupancy = 0.0;
+	UINT pages = 0;
+	double perSet = MeasureNanoseconds(Sets, [&](UINT64 i)
+	{
+		PackResult result = Pack(sets[i], alignment);
+		KeepValue(result);
+	});
+	for (const std::vector<RectSize>& sizes : sets)
+	{
+		PackResult result = Pack(sizes, alignment);
+		occupancy += result.occupancy;
+		pages += result.pages;
+	}
+
+	std::string label(name);
+	Report((label + ", per insert").c_str(), perSet / RectCount, "ns");
+	Report((label + ", pages per set").c_str(), (double)pages / Sets, "");
+	Report((label + ", occupancy of full pages").c_str(), 100.0 * occupancy / Sets, "%");
+}
+
+BENCHMARK(AtlasPacker)
+{
+	RunConfiguration("Power of two", 1, 0, true);
+	RunConfiguration("Arbitrary", 1, 0, false);
+	RunConfiguration("Padded", 8, 8, false);
+}
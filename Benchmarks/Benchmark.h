@@ -0,0 +1,78 @@
+//
+// Minimal benchmark registry for the Linux build
+// BENCHMARK registers a case before main runs. Each case times its own loops with MeasureNanoseconds and prints what
+// it measured with Report
+//
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <Windows.h>
+#include <chrono>
+#include <vector>
+
+typedef void (*BenchmarkFunction)();
+
+class BenchmarkRegistry
+{
+public:
+	static BenchmarkRegistry& Get();
+
+	void Add(const char* name, BenchmarkFunction function);
+
+	/// <summary>Runs every benchmark whose name contains filter, all of them if it's NULL. Returns how many ran
+	/// </summary>
+	int Run(const char* filter);
+private:
+	struct Case
+	{
+		const char* name;
+		BenchmarkFunction function;
+	};
+
+	std::vector<Case> cases;
+};
+
+struct BenchmarkRegistration
+{
+	BenchmarkRegistration(const char* name, BenchmarkFunction function) { BenchmarkRegistry::Get().Add(name, function); }
+};
+
+#define BENCHMARK(name) \
+	static void name(); \
+	static BenchmarkRegistration name##Registration(#name, name); \
+	static void name()
+
+/// <summary>Stops the compiler from optimizing away the work that produced value
+/// </summary>
+template <typename T>
+inline void KeepValue(const T& value)
+{
+	asm volatile("" : : "r"(&value) : "memory");
+}
+
+/// <summary>Calls body(i) for i in [0, calls), repeats that and keeps the fastest repeat, which is the one the rest of
+/// the machine disturbed least. Returns nanoseconds per call
+/// </summary>
+template <typename Body>
+double MeasureNanoseconds(UINT64 calls, Body body, UINT repeats = 5)
+{
+	typedef std::chrono::steady_clock clock;
+	double best = 0.0;
+	for (UINT repeat = 0; repeat < repeats; repeat++)
+	{
+		clock::time_point start = clock::now();
+		for (UINT64 i = 0; i < calls; i++)
+			body(i);
+		double elapsed = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+		if (repeat == 0 || elapsed < best)
+			best = elapsed;
+	}
+	return best / (double)calls;
+}
+
+/// <summary>Prints one measured value under the running benchmark
+/// </summary>
+void Report(const char* label, double value, const char* unit);
+
+#endif
@@ -0,0 +1,44 @@
+//
+// Runs the registered benchmarks, all of them or those whose name contains the first argument
+//
+
+#include "Benchmark.h"
+
+BenchmarkRegistry& BenchmarkRegistry::Get()
+{
+	static BenchmarkRegistry registry;
+	return registry;
+}
+
+void BenchmarkRegistry::Add(const char* name, BenchmarkFunction function)
+{
+	Case benchmark = { name, function };
+	cases.push_back(benchmark);
+}
+
+int BenchmarkRegistry::Run(const char* filter)
+{
+	int run = 0;
+	for (const Case& benchmark : cases)
+	{
+		if (filter && !strstr(benchmark.name, filter))
+			continue;
+
+		printf("%s\n", benchmark.name);
+		fflush(stdout);
+		benchmark.function();
+		run++;
+	}
+	return run;
+}
+
+void Report(const char* label, double value, const char* unit)
+{
+	printf("  %-40s %12.2f %s\n", label, value, unit);
+	fflush(stdout);
+}
+
+int main(int argc, char** argv)
+{
+	return BenchmarkRegistry::Get().Run(argc > 1 ? argv[1] : NULL) > 0 ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+//
+// Loading a cooked DDS file the two ways DDSTextureLoader can: reading it into a heap buffer first, or mapping it and
+// pointing the subresources straight into the mapping. Both parse the header, lay out the chain and copy every
+// subresource to staging memory where the loader hands them to the device
+//
+
+#include "Benchmark.h"
+#include "DDSLayout.h"
+#include "TextureCooker.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace DirectX;
+
+// Size of the cooked test texture, a large material map with its full chain
+static const UINT TextureSize = 2048;
+
+// First mip of the range a streamer would upload before the rest
+static const size_t StreamedFirstMip = 4;
+
+// Runs timed per configuration, the fastest is reported
+static const UINT Repeats = 5;
+
+static bool ReadFile(const char* path, std::vector<BYTE>& data)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file)
+		return false;
+	std::streamsize size = file.tellg();
+	data.resize((size_t)size);
+	file.seekg(0, std::ios::beg);
+	return size > 0 && file.read((char*)&data[0], size);
+}
+
+/// <summary>Asks the kernel to drop the file's cached pages, so the next read goes to the disk
+/// </summary>
+static void DropFromCache(const char* path)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return;
+	fdatasync(fd);
+	posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	close(fd);
+}
+
+/// <summary>Parses a DDS file in memory and copies mips [firstMip, end of chain) into staging, as the device would
+/// receive them
+/// </summary>
+static bool Upload(const BYTE* data, size_t size, size_t firstMip, std::vector<BYTE>& staging)
+{
+	const DDS_HEADER* header = NULL;
+	size_t bitOffset = 0;
+	if (!ParseDDSHeader(data, size, &header, &bitOffset))
+		return false;
+
+	DDSSubresourceLayout layout[16];
+	size_t width, height, depth, usedMips;
+	bool truncated;
+	if (header->mipMapCount > 16 || !GetDDSSubresourceLayout(header->width, header->height, 1, header->mipMapCount, 1,
+		GetDXGIFormat(header->ddspf), 0, firstMip, 0, size - bitOffset, layout, width, height, depth, usedMips, truncated))
+		return false;
+
+	BYTE* destination = &staging[0];
+	for (size_t i = 0; i < usedMips; i++)
+	{
+		memcpy(destination, data + bitOffset + layout[i].offset, layout[i].numBytes);
+		destination += layout[i].numBytes;
+	}
+	return true;
+}
+
+static bool LoadThroughHeap(const char* path, size_t firstMip, std::vector<BYTE>& staging)
+{
+	std::vector<BYTE> file;
+	return ReadFile(path, file) && Upload(&file[0], file.size(), firstMip, staging);
+}
+
+static bool LoadMapped(const char* path, size_t firstMip, std::vector<BYTE>& staging)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat status;
+	void* mapping = fstat(fd, &status) == 0 ? mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	close(fd);
+	if (mapping == MAP_FAILED)
+		return false;
+
+	bool uploaded = Upload((const BYTE*)mapping, (size_t)status.st_size, firstMip, staging);
+	munmap(mapping, (size_t)status.st_size);
+	return uploaded;
+}
+
+/// <summary>Milliseconds for the fastest of Repeats loads, negative if one failed
+/// </summary>
+template <typename Load>
+static double MeasureLoad(const char* path, bool cold, Load load)
+{
+	double best = -1.0;
+	for (UINT repeat = 0; repeat < Repeats; repeat++)
+	{
+		if (cold)
+			DropFromCache(path);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		if (!load())
+			return -1.0;
+		double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (best < 0.0 || elapsed < best)
+			best = elapsed;
+	}
+	return best;
+}
+
+BENCHMARK(DDSLoad)
+{
+	ImageData image;
+	image.width = TextureSize;
+	image.height = TextureSize;
+	image.rgba.resize(TextureSize * TextureSize * 4);
+	for (UINT i = 0; i < TextureSize * TextureSize; i++)
+	{
+		image.rgba[i * 4 + 0] = (BYTE)(i % TextureSize);
+		image.rgba[i * 4 + 1] = (BYTE)(i / TextureSize);
+		image.rgba[i * 4 + 2] = (BYTE)(i * 2654435761u >> 24);
+		image.rgba[i * 4 + 3] = 255;
+	}
+
+	CookOptions options;
+	std::vector<BYTE> dds;
+	CookStats stats;
+	char path[] = "/tmp/ddsloadXXXXXX";
+	int fd = mkstemp(path);
+	if (fd < 0 || !TextureCooker::Cook(image, options, dds, stats) || write(fd, &dds[0], dds.size()) != (ssize_t)dds.size())
+	{
+		fprintf(stderr, "Could not write the cooked texture\n");
+		if (fd >= 0)
+			close(fd);
+		return;
+	}
+	close(fd);
+
+	std::vector<BYTE> staging(dds.size());
+	Report("Cooked BC1 file", dds.size() / 1024.0, "KB");
+	for (int cold = 1; cold >= 0; cold--)
+	{
+		double heap = MeasureLoad(path, cold != 0, [&]() { return LoadThroughHeap(path, 0, staging); });
+		double mapped = MeasureLoad(path, cold != 0, [&]() { return LoadMapped(path, 0, staging); });
+		double mappedTail = MeasureLoad(path, cold != 0, [&]() { return LoadMapped(path, StreamedFirstMip, staging); });
+		Report(cold ? "Cold, read into heap" : "Warm, read into heap", heap, "ms");
+		Report(cold ? "Cold, mapped" : "Warm, mapped", mapped, "ms");
+		Report(cold ? "Cold, mapped from mip 4" : "Warm, mapped from mip 4", mappedTail, "ms");
+	}
+
+	// Header and layout alone, what every load pays before touching the texels
+	double layout = MeasureNanoseconds(100000, [&](UINT64)
+	{
+		const DDS_HEADER* header = NULL;
+		size_t bitOffset = 0;
+		DDSSubresourceLayout subresources[16];
+		size_t width, height, depth, usedMips;
+		bool truncated;
+		ParseDDSHeader(&dds[0], dds.size(), &header, &bitOffset);
+		GetDDSSubresourceLayout(header->width, header->height, 1, header->mipMapCount, 1, GetDXGIFormat(header->ddspf), 0, 0, 0,
+			dds.size() - bitOffset, subresources, width, height, depth, usedMips, truncated);
+		KeepValue(usedMips);
+	});
+	Report("Parse and lay out the chain", layout, "ns");
+
+	unlink(path);
+}
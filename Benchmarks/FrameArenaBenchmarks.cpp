@@ -0,0 +1,235 @@
+//
+// A frame's transient allocations from the frame arena against the heap: many small allocations of mixed sizes that all
+// go at the end of the frame, the per object arrays Simulation::Draw takes, and vectors grown by push_back. Global
+// operator new is replaced here to count heap allocations, which shows whether a warmed up frame touches the heap at all
+//
+
+#include "Benchmark.h"
+#include "FrameArena.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <string>
+
+// Allocations a frame and the objects Simulation::Draw sizes its arrays for
+static const UINT FrameAllocations = 10000;
+static const UINT DrawObjects = 10000;
+
+// Frames run before counting, for the arena to grow to the largest one, and the frames counted after
+static const UINT WarmupFrames = 3;
+static const UINT SteadyFrames = 100;
+
+// Every operator new in the benchmark binary, on any thread. Counting is one relaxed add, too little to move the other
+// benchmarks' numbers. Kept out of line so the compiler doesn't pair the inlined malloc and free with new and delete
+static std::atomic<UINT64> heapAllocations(0);
+
+__attribute__((noinline)) void* operator new(size_t bytes)
+{
+	heapAllocations.fetch_add(1, std::memory_order_relaxed);
+	void* p = malloc(bytes ? bytes : 1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t bytes)
+{
+	return operator new(bytes);
+}
+
+__attribute__((noinline)) void operator delete(void* p) throw()
+{
+	free(p);
+}
+
+void operator delete[](void* p) throw()
+{
+	operator delete(p);
+}
+
+BENCHMARK(FrameArenaSmallAllocations)
+{
+	// Sizes between 16 and 512 bytes, drawn once so both sides allocate the same frame
+	std::mt19937 random(3);
+	std::uniform_int_distribution<UINT> size(16, 512);
+	std::vector<size_t> sizes(FrameAllocations);
+	for (size_t& bytes : sizes)
+		bytes = size(random);
+	std::vector<void*> pointers(FrameAllocations);
+
+	double heap = MeasureNanoseconds(FrameAllocations, [&](UINT64 i)
+	{
+		pointers[(size_t)i] = malloc(sizes[(size_t)i]);
+		*(BYTE*)pointers[(size_t)i] = 1;
+		if (i + 1 == FrameAllocations)
+		{
+			for (void* p : pointers)
+				free(p);
+		}
+	});
+
+	// Blocks the first and the last frame took, read before the reset clears them
+	LinearArena arena;
+	UINT frames = 0, firstBlocks = 0, lastBlocks = 0;
+	double linear = MeasureNanoseconds(FrameAllocations, [&](UINT64 i)
+	{
+		pointers[(size_t)i] = arena.Allocate(sizes[(size_t)i]);
+		*(BYTE*)pointers[(size_t)i] = 1;
+		if (i + 1 == FrameAllocations)
+		{
+			lastBlocks = arena.GetStats().heapBlocks;
+			if (frames++ == 0)
+				firstBlocks = lastBlocks;
+			arena.Reset();
+		}
+	});
+
+	// The calling thread's frame arena, a new frame every FrameAllocations calls
+	double frame = MeasureNanoseconds(FrameAllocations, [&](UINT64 i)
+	{
+		if (i == 0)
+			FrameArena::BeginFrame();
+		pointers[(size_t)i] = FrameArena::Get().Allocate(sizes[(size_t)i]);
+		*(BYTE*)pointers[(size_t)i] = 1;
+	});
+
+	Report("Small, malloc and free", heap, "ns");
+	Report("Small, linear arena", linear, "ns");
+	Report("Small, frame arena", frame, "ns");
+	Report("Small, arena speedup", heap / linear, "x");
+	Report("Small, arena heap blocks, first frame", firstBlocks, "");
+	Report("Small, arena heap blocks, last frame", lastBlocks, "");
+}
+
+BENCHMARK(FrameArenaDrawArrays)
+{
+	// The worlds and visibility flags Simulation::Draw allocates each frame, per frame cost
+	struct World
+	{
+		float m[16];
+	};
+	double heap = MeasureNanoseconds(100, [&](UINT64)
+	{
+		World* worlds = new World[DrawObjects];
+		bool* camera = new bool[DrawObjects];
+		bool* shadow = new bool[DrawObjects];
+		worlds[DrawObjects - 1].m[0] = 1.0f;
+		camera[0] = shadow[0] = true;
+		KeepValue(worlds[DrawObjects - 1].m[0]);
+		delete[] shadow;
+		delete[] camera;
+		delete[] worlds;
+	});
+
+	double frame = MeasureNanoseconds(100, [&](UINT64)
+	{
+		FrameArena::BeginFrame();
+		LinearArena& arena = FrameArena::Get();
+		World* worlds = arena.AllocateArray<World>(DrawObjects);
+		bool* camera = arena.AllocateArray<bool>(DrawObjects);
+		bool* shadow = arena.AllocateArray<bool>(DrawObjects);
+		worlds[DrawObjects - 1].m[0] = 1.0f;
+		camera[0] = shadow[0] = true;
+		KeepValue(worlds[DrawObjects - 1].m[0]);
+	});
+
+	Report("Draw arrays, new and delete", heap, "ns");
+	Report("Draw arrays, frame arena", frame, "ns");
+}
+
+BENCHMARK(FrameArenaVectors)
+{
+	// Vectors grown from empty, as per frame lists are, each frame builds 100 of 100 elements
+	double heap = MeasureNanoseconds(100, [&](UINT64)
+	{
+		for (UINT list = 0; list < 100; list++)
+		{
+			std::vector<UINT> values;
+			for (UINT i = 0; i < 100; i++)
+				values.push_back(i);
+			KeepValue(values.back());
+		}
+	});
+
+	double frame = MeasureNanoseconds(100, [&](UINT64)
+	{
+		FrameArena::BeginFrame();
+		for (UINT list = 0; list < 100; list++)
+		{
+			FrameVector<UINT> values;
+			for (UINT i = 0; i < 100; i++)
+				values.push_back(i);
+			KeepValue(values.back());
+		}
+	});
+
+	Report("Vectors, heap", heap / 1000.0, "us");
+	Report("Vectors, frame arena", frame / 1000.0, "us");
+	Report("Vectors, frame arena bytes a frame", FrameArena::Get().GetStats().bytes / 1024.0, "KB");
+}
+
+/// <summary>One frame's worth of Simulation::Draw's arrays and per frame lists, from the frame arena or the heap
+/// </summary>
+static void RunFrame(bool arena)
+{
+	struct World
+	{
+		float m[16];
+	};
+	if (arena)
+	{
+		FrameArena::BeginFrame();
+		World* worlds = FrameArena::Get().AllocateArray<World>(DrawObjects);
+		bool* visible = FrameArena::Get().AllocateArray<bool>(DrawObjects);
+		worlds[DrawObjects - 1].m[0] = 1.0f;
+		visible[0] = true;
+		KeepValue(worlds[DrawObjects - 1].m[0]);
+		for (UINT list = 0; list < 100; list++)
+		{
+			FrameVector<UINT> values;
+			for (UINT i = 0; i < 100; i++)
+				values.push_back(i);
+			KeepValue(values.back());
+		}
+	}
+	else
+	{
+		std::vector<World> worlds(DrawObjects);
+		std::vector<bool> visible(DrawObjects);
+		worlds[DrawObjects - 1].m[0] = 1.0f;
+		visible[0] = true;
+		KeepValue(worlds[DrawObjects - 1].m[0]);
+		for (UINT list = 0; list < 100; list++)
+		{
+			std::vector<UINT> values;
+			for (UINT i = 0; i < 100; i++)
+				values.push_back(i);
+			KeepValue(values.back());
+		}
+	}
+}
+
+BENCHMARK(FrameArenaSteadyState)
+{
+	// Heap allocations across the steady frames after the warm up ones, the arena's should be none at all
+	const char* labels[] = { "Steady heap", "Steady frame arena" };
+	for (UINT arena = 0; arena < 2; arena++)
+	{
+		for (UINT frame = 0; frame < WarmupFrames; frame++)
+			RunFrame(arena == 1);
+		UINT64 before = heapAllocations.load();
+		for (UINT frame = 0; frame < SteadyFrames; frame++)
+			RunFrame(arena == 1);
+		UINT64 allocations = heapAllocations.load() - before;
+
+		std::string label = labels[arena];
+		Report((label + ", allocations/frame").c_str(), (double)allocations / SteadyFrames, "");
+		if (arena == 1)
+		{
+			Report((label + ", heap blocks").c_str(), FrameArena::Get().GetStats().heapBlocks, "");
+			Report((label + ", bytes/frame").c_str(), FrameArena::Get().GetStats().bytes / 1024.0, "KB");
+		}
+	}
+}
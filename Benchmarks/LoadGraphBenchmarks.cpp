@@ -0,0 +1,154 @@
+//
+// Startup loading through a LoadGraph, cold and warm, with the device steps stubbed
+// The graph mirrors LoadAssets' CPU work: every compiled shader is read, the material textures are decoded and mipped
+// as the atlas does, and materials wait on both. Create steps copy what they were given into staging memory where the
+// application would call the device. Cold runs drop the files from the page cache first
+//
+
+#include "Benchmark.h"
+#include "ImageConvert.h"
+#include "LoadGraph.h"
+#include "PNGDecoder.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// Compiled shaders and textures LoadAssets reads, relative to the repository root. The shaders are only read, so the
+// checked-in fixtures stand in for what the build compiles into Debug
+static const char* ShaderFiles[] =
+{
+	"Tests/Data/Shaders/DefaultVertex.cso", "Tests/Data/Shaders/DefaultPixel.cso", "Tests/Data/Shaders/PixelNoNormal.cso",
+	"Tests/Data/Shaders/NoLightVert.cso", "Tests/Data/Shaders/NoLightPixel.cso", "Tests/Data/Shaders/FullScreenQuadVert.cso",
+	"Tests/Data/Shaders/FullScreenQuadPixel.cso", "Tests/Data/Shaders/Shadow.cso"
+};
+static const UINT ShaderCount = sizeof(ShaderFiles) / sizeof(ShaderFiles[0]);
+
+static const char* TextureFiles[] =
+{
+	"Debug/Textures/floor_tiles.png", "Debug/Textures/floor_tiles_normal.png",
+	"Debug/Textures/default.png", "Debug/Textures/brick_normal.png"
+};
+static const UINT TextureCount = sizeof(TextureFiles) / sizeof(TextureFiles[0]);
+
+// Runs timed per configuration, the fastest is reported
+static const UINT Repeats = 5;
+
+static bool ReadFile(const char* path, std::vector<BYTE>& data)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file)
+		return false;
+	std::streamsize size = file.tellg();
+	data.resize((size_t)size);
+	file.seekg(0, std::ios::beg);
+	return size > 0 && file.read((char*)&data[0], size);
+}
+
+/// <summary>Asks the kernel to drop the file's cached pages, so the next read goes to the disk
+/// </summary>
+static void DropFromCache(const char* path)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return;
+	fdatasync(fd);
+	posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	close(fd);
+}
+
+/// <summary>Builds and runs the startup graph, returning how long Run took in milliseconds, negative if it failed
+/// </summary>
+static double RunStartup(UINT workers, bool cold)
+{
+	if (cold)
+	{
+		for (const char* path : ShaderFiles)
+			DropFromCache(path);
+		for (const char* path : TextureFiles)
+			DropFromCache(path);
+	}
+
+	std::vector<std::vector<BYTE> > shaders(ShaderCount);
+	std::vector<std::vector<ImageData> > textures(TextureCount);
+	std::vector<BYTE> staging;
+	PNGDecoder png;
+
+	LoadGraph graph;
+	std::vector<LoadNodeId> shaderNodes, textureNodes;
+	for (UINT i = 0; i < ShaderCount; i++)
+	{
+		shaderNodes.push_back(graph.Add(ShaderFiles[i], [&shaders, i]() { return ReadFile(ShaderFiles[i], shaders[i]); },
+			[&shaders, &staging, i]() { staging.insert(staging.end(), shaders[i].begin(), shaders[i].end()); return true; }));
+	}
+	for (UINT i = 0; i < TextureCount; i++)
+	{
+		textureNodes.push_back(graph.Add(TextureFiles[i], [&textures, &png, i]()
+		{
+			std::vector<BYTE> file;
+			ImageData image;
+			if (!ReadFile(TextureFiles[i], file) || !png.Decode(&file[0], file.size(), image))
+				return false;
+			ImageConvert::GenerateMips(image, i % 2 ? MipNormalMap : MipColor, MipBox, textures[i]);
+			return true;
+		},
+		[&textures, &staging, i]()
+		{
+			for (const ImageData& level : textures[i])
+				staging.insert(staging.end(), level.rgba.begin(), level.rgba.end());
+			return true;
+		}));
+	}
+
+	// Lit materials take the default shaders and a texture pair, the unlit one only its shaders
+	for (UINT i = 0; i < 2; i++)
+	{
+		LoadNodeId material = graph.Add("LitMaterial", std::function<bool()>(), []() { return true; });
+		graph.DependsOn(material, shaderNodes[0]);
+		graph.DependsOn(material, shaderNodes[1 + i]);
+		graph.DependsOn(material, textureNodes[i * 2]);
+		graph.DependsOn(material, textureNodes[i * 2 + 1]);
+	}
+	LoadNodeId unlit = graph.Add("NoLightMaterial", std::function<bool()>(), []() { return true; });
+	graph.DependsOn(unlit, shaderNodes[3]);
+	graph.DependsOn(unlit, shaderNodes[4]);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	bool succeeded = graph.Run(workers);
+	double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	KeepValue(staging);
+	return succeeded ? elapsed : -1.0;
+}
+
+BENCHMARK(LoadGraphStartup)
+{
+	std::vector<BYTE> probe;
+	if (!ReadFile(ShaderFiles[0], probe))
+	{
+		printf("  Skipped, run from the repository root so Debug/ can be found\n");
+		return;
+	}
+
+	const UINT workerCounts[] = { 1, 4 };
+	for (UINT workers : workerCounts)
+	{
+		double cold = -1.0, warm = -1.0;
+		for (UINT repeat = 0; repeat < Repeats; repeat++)
+		{
+			double coldRun = RunStartup(workers, true);
+			double warmRun = RunStartup(workers, false);
+			if (coldRun < 0.0 || warmRun < 0.0)
+			{
+				printf("  Startup graph failed to load\n");
+				return;
+			}
+			cold = repeat == 0 || coldRun < cold ? coldRun : cold;
+			warm = repeat == 0 || warmRun < warm ? warmRun : warm;
+		}
+
+		char label[64];
+		snprintf(label, sizeof(label), "Cold start, %u loader threads", workers);
+		Report(label, cold, "ms");
+		snprintf(label, sizeof(label), "Warm start, %u loader threads", workers);
+		Report(label, warm, "ms");
+	}
+}
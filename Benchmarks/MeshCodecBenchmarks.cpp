@@ -0,0 +1,52 @@
+//
+// Mesh compression of a cooked mesh of about 100k vertices: how much smaller it gets with and without the Huffman
+// stage, and how fast it decodes against copying the uncompressed file, which is what loading paid before
+//
+
+#include "Benchmark.h"
+#include "MeshCodec.h"
+#include "MeshData.h"
+#include "TestMeshes.h"
+
+#include <cstring>
+#include <string>
+
+// Quads across the benchmark grid, (GridCells + 1)^2 vertices
+static const UINT GridCells = 316;
+
+BENCHMARK(MeshCodecDecode)
+{
+	std::vector<BYTE> cooked;
+	CreateCookedGrid(GridCells, 100.0f, cooked);
+	double megabytes = cooked.size() / (1024.0 * 1024.0);
+	Report("Cooked mesh", megabytes, "MB");
+
+	// Copying the uncompressed file is the floor the decoder is measured against
+	std::vector<BYTE> decoded(cooked.size());
+	double copy = MeasureNanoseconds(20, [&](UINT64) { memcpy(&decoded[0], &cooked[0], cooked.size()); });
+	Report("memcpy", cooked.size() / copy, "GB/s");
+
+	const char* labels[] = { "Vertex and index coding", "With Huffman" };
+	for (UINT entropy = 0; entropy < 2; entropy++)
+	{
+		std::vector<BYTE> compressed;
+		double encode = MeasureNanoseconds(1, [&](UINT64)
+		{
+			compressed.clear();
+			MeshCodec::Encode(&cooked[0], cooked.size(), entropy == 1, compressed);
+		}, 3);
+		bool ok = true;
+		double decode = MeasureNanoseconds(10, [&](UINT64)
+		{
+			ok &= MeshCodec::Decode(&compressed[0], compressed.size(), &decoded[0], decoded.size());
+		});
+		KeepValue(ok && decoded == cooked);
+
+		std::string label = labels[entropy];
+		Report((label + ", size").c_str(), compressed.size() / (1024.0 * 1024.0), "MB");
+		Report((label + ", ratio").c_str(), (double)cooked.size() / compressed.size(), "x");
+		Report((label + ", encode").c_str(), megabytes / (encode / 1e9), "MB/s");
+		Report((label + ", decode").c_str(), cooked.size() / decode, "GB/s");
+		Report((label + ", decode time").c_str(), decode / 1e6, "ms");
+	}
+}
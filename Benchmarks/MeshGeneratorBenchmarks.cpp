@@ -0,0 +1,52 @@
+//
+// Sphere and plane generation from thousands up to tens of millions of triangles, written straight into memory sized
+// up front like a mapped buffer, so what is timed is generating and welding rather than growing vectors
+//
+
+#include "Benchmark.h"
+#include "MeshGenerator.h"
+
+#include <string>
+
+/// <summary>Reports the mesh's triangles, the time to generate it and the triangles a second that makes
+/// </summary>
+static void ReportGeneration(const std::string& label, double nanoseconds, UINT indexCount)
+{
+	Report((label + ", size").c_str(), indexCount / 3 / 1e6, "M tris");
+	Report((label + ", generate").c_str(), nanoseconds / 1e6, "ms");
+	Report((label + ", triangles").c_str(), indexCount / 3 / (nanoseconds / 1e9) / 1e6, "M/s");
+}
+
+BENCHMARK(MeshGeneratorSphere)
+{
+	// 10 subdivisions is the limit, about 21 million triangles and 10 million vertices
+	const UINT subdivisions[] = { 4, 6, 8, 10 };
+	for (UINT s : subdivisions)
+	{
+		UINT vertexCount, indexCount;
+		MeshGenerator::GetSphereCounts(s, vertexCount, indexCount);
+		std::vector<Vertex> vertices(vertexCount);
+		std::vector<UINT> indices(indexCount);
+		double generate = MeasureNanoseconds(1, [&](UINT64) { MeshGenerator::WriteSphere(1.0f, s, &vertices[0], &indices[0]); },
+			s < 10 ? 5 : 2);
+		KeepValue(vertices.back().Position.x);
+		ReportGeneration("Sphere, " + std::to_string(s) + " subdivisions", generate, indexCount);
+	}
+}
+
+BENCHMARK(MeshGeneratorPlane)
+{
+	// The largest is about 33 million triangles
+	const UINT sides[] = { 64, 512, 2048, 4096 };
+	for (UINT side : sides)
+	{
+		UINT vertexCount, indexCount;
+		MeshGenerator::GetPlaneCounts(side, side, vertexCount, indexCount);
+		std::vector<Vertex> vertices(vertexCount);
+		std::vector<UINT> indices(indexCount);
+		double generate = MeasureNanoseconds(1, [&](UINT64) { MeshGenerator::WritePlane(100.0f, 100.0f, side, side, &vertices[0], &indices[0]); },
+			side < 4096 ? 5 : 2);
+		KeepValue(vertices.back().Position.x);
+		ReportGeneration("Plane, " + std::to_string(side) + " x " + std::to_string(side), generate, indexCount);
+	}
+}
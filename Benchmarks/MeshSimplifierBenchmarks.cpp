@@ -0,0 +1,103 @@
+//
+// Building level of detail chains for spheres of growing tessellation, and selecting levels for a field of objects
+// each frame as the camera moves through it. Selection also counts how many objects change level between frames,
+// with and without hysteresis, since every change is a visible pop
+//
+
+#include "Benchmark.h"
+#include "LODSelector.h"
+#include "MeshSimplifier.h"
+#include "TestMeshes.h"
+
+#include <random>
+
+// Objects scattered over a square this wide, and the frames the camera takes to cross it
+static const UINT SelectObjects = 10000;
+static const float FieldSize = 400.0f;
+static const UINT Frames = 240;
+
+BENCHMARK(MeshSimplifierBuildLODs)
+{
+	const UINT rings[] = { 16, 32, 64 };
+	for (UINT ringCount : rings)
+	{
+		MeshData sphere;
+		CreateSphere(1.0f, ringCount, sphere);
+
+		std::vector<UINT> indices;
+		std::vector<MeshLOD> lods;
+		SimplifyOptions options;
+		double ns = MeasureNanoseconds(1, [&](UINT64)
+		{
+			indices = sphere.indices;
+			lods.clear();
+			MeshSimplifier::BuildLODs(sphere.vertices.data(), (UINT)sphere.vertices.size(), indices, lods, options);
+		}, 3);
+
+		UINT triangles = (UINT)sphere.indices.size() / 3;
+		std::ostringstream label;
+		label << triangles << " triangle sphere";
+		Report((label.str() + ", build").c_str(), ns / 1e6, "ms");
+		Report((label.str() + ", throughput").c_str(), triangles / (ns / 1e9) / 1e6, "Mtri/s");
+		Report((label.str() + ", levels").c_str(), (double)lods.size(), "");
+		Report((label.str() + ", last level").c_str(), lods.back().indexCount / 3.0, "tris");
+		Report((label.str() + ", last error").c_str(), lods.back().error, "");
+	}
+}
+
+BENCHMARK(LODSelectorSelect)
+{
+	MeshData sphere;
+	CreateSphere(1.0f, 32, sphere);
+	std::vector<MeshLOD> lods;
+	MeshSimplifier::BuildLODs(sphere.vertices.data(), (UINT)sphere.vertices.size(), sphere.indices, lods, SimplifyOptions());
+
+	MeshBounds bounds;
+	bounds.center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	bounds.extents = XMFLOAT3(1.0f, 1.0f, 1.0f);
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> position(-FieldSize * 0.5f, FieldSize * 0.5f);
+	std::uniform_real_distribution<float> scale(0.5f, 3.0f);
+	std::vector<XMFLOAT4X4> worlds(SelectObjects);
+	for (XMFLOAT4X4& world : worlds)
+	{
+		float s = scale(random);
+		XMStoreFloat4x4(&world, XMMatrixScaling(s, s, s) * XMMatrixTranslation(position(random), s, position(random)));
+	}
+
+	const float hysteresis[] = { 0.0f, 0.25f };
+	for (float margin : hysteresis)
+	{
+		std::ostringstream args;
+		args << "lodhysteresis=" << margin;
+		LODSelector selector;
+		selector.ParseCommandLine(args.str().c_str());
+
+		// The camera walks across the field at eye height, swaying sideways a little each frame. The first frame picks
+		// every object's level from scratch, so changes are counted from the second
+		std::vector<UINT> levels(SelectObjects, 0);
+		UINT64 changes = 0;
+		UINT64 levelSum = 0;
+		double ns = MeasureNanoseconds((UINT64)Frames * SelectObjects, [&](UINT64 i)
+		{
+			UINT frame = (UINT)(i / SelectObjects);
+			size_t object = (size_t)(i % SelectObjects);
+			if (object == 0)
+			{
+				float z = -FieldSize * 0.5f + FieldSize * frame / Frames;
+				float x = (frame % 2) ? 0.5f : -0.5f;
+				selector.SetPerspective(LODPassCamera, XMFLOAT3(x, 1.7f, z), XM_PIDIV4, 1080.0f);
+			}
+			UINT level = selector.Select(LODPassCamera, lods, bounds, worlds[object], levels[object]);
+			changes += frame > 0 && level != levels[object];
+			levelSum += level;
+			levels[object] = level;
+		}, 1);
+
+		std::ostringstream label;
+		label << "Select, hysteresis " << margin;
+		Report((label.str() + ", per object").c_str(), ns, "ns");
+		Report((label.str() + ", changes/frame").c_str(), (double)changes / (Frames - 1), "");
+		Report((label.str() + ", mean level").c_str(), (double)levelSum / ((UINT64)Frames * SelectObjects), "");
+	}
+}
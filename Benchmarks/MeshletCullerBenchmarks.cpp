@@ -0,0 +1,88 @@
+//
+// Meshlet culling of a field of detailed spheres seen by a camera: the time per meshlet and per object on the calling
+// thread, and how many triangles frustum and cone culling leave against drawing every mesh whole
+//
+
+#include "Benchmark.h"
+#include "MeshletCuller.h"
+#include "TestMeshes.h"
+
+#include <random>
+
+// Spheres in the field, their detail and how far they spread from the camera
+static const UINT FieldObjects = 400;
+static const UINT SphereRings = 48;
+static const float FieldSize = 200.0f;
+
+BENCHMARK(MeshletCullerField)
+{
+	MeshData sphere;
+	CreateSphere(1.0f, SphereRings, sphere);
+	MeshletData meshlets;
+	MeshletBuilder::Build(&sphere.vertices[0], (UINT)sphere.vertices.size(), &sphere.indices[0], (UINT)sphere.indices.size(), 1, meshlets);
+
+	// Spheres of radius 1 to 4 scattered in front of and around a camera at the field's edge
+	std::mt19937 random(8);
+	std::uniform_real_distribution<float> position(-FieldSize * 0.5f, FieldSize * 0.5f);
+	std::uniform_real_distribution<float> scale(1.0f, 4.0f);
+	std::vector<MeshletJob> jobs(FieldObjects);
+	for (MeshletJob& job : jobs)
+	{
+		job.meshlets = &meshlets;
+		float size = scale(random);
+		XMStoreFloat4x4(&job.world, XMMatrixScaling(size, size, size) * XMMatrixTranslation(position(random), size, position(random)));
+	}
+
+	XMFLOAT3 eye(0.0f, 10.0f, -FieldSize * 0.5f);
+	XMFLOAT3 target(0.0f, 0.0f, 0.0f);
+	XMFLOAT4X4 viewProjection;
+	XMMATRIX view = XMMatrixLookAtLH(XMLoadFloat3(&eye), XMLoadFloat3(&target), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMStoreFloat4x4(&viewProjection, view * XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 0.1f, 500.0f));
+	MeshletView camera = MeshletCuller::PerspectiveView(viewProjection, eye);
+
+	// No workers, this is the render thread's share alone
+	MeshletCuller culler;
+	std::vector<UINT> indices(meshlets.triangles.size() * FieldObjects);
+	double pass = MeasureNanoseconds(20, [&](UINT64)
+	{
+		culler.CullInto(camera, &jobs[0], FieldObjects, &indices[0]);
+	});
+
+	const MeshletCullStats& stats = culler.GetStats();
+	UINT64 allTriangles = (UINT64)sphere.indices.size() / 3 * FieldObjects;
+	Report("Meshlets per object", (double)meshlets.meshlets.size(), "");
+	Report("Cull pass", pass / 1000.0, "us");
+	Report("Cull per object", pass / FieldObjects, "ns");
+	Report("Cull per meshlet", pass / stats.meshlets, "ns");
+	Report("Frustum culled", 100.0 * stats.frustumCulled / stats.meshlets, "%");
+	Report("Cone culled", 100.0 * stats.coneCulled / stats.meshlets, "%");
+	Report("Triangles drawn whole", (double)allTriangles, "");
+	Report("Triangles after culling", stats.triangles, "");
+	Report("Triangle reduction", (double)allTriangles / max(stats.triangles, 1u), "x");
+}
+
+BENCHMARK(MeshletCullerConeOnly)
+{
+	// One sphere filling the view, what the cone test alone saves and what writing the survivors costs
+	MeshData sphere;
+	CreateSphere(1.0f, SphereRings * 2, sphere);
+	MeshletData meshlets;
+	MeshletBuilder::Build(&sphere.vertices[0], (UINT)sphere.vertices.size(), &sphere.indices[0], (UINT)sphere.indices.size(), 1, meshlets);
+
+	MeshletJob job;
+	job.meshlets = &meshlets;
+	XMStoreFloat4x4(&job.world, XMMatrixScaling(10.0f, 10.0f, 10.0f));
+	XMFLOAT3 eye(0.0f, 0.0f, -40.0f);
+	XMFLOAT4X4 viewProjection;
+	XMMATRIX view = XMMatrixLookAtLH(XMLoadFloat3(&eye), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMStoreFloat4x4(&viewProjection, view * XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.0f, 0.1f, 500.0f));
+	MeshletView camera = MeshletCuller::PerspectiveView(viewProjection, eye);
+
+	MeshletCuller culler;
+	std::vector<UINT> indices(meshlets.triangles.size());
+	double cull = MeasureNanoseconds(200, [&](UINT64) { culler.CullInto(camera, &job, 1, &indices[0]); });
+	Report("Sphere meshlets", (double)meshlets.meshlets.size(), "");
+	Report("Sphere cull", cull / 1000.0, "us");
+	Report("Sphere cone culled", 100.0 * culler.GetStats().coneCulled / culler.GetStats().meshlets, "%");
+	Report("Sphere triangles kept", 100.0 * job.indexCount / sphere.indices.size(), "%");
+}
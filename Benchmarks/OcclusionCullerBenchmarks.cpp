@@ -0,0 +1,178 @@
+//
+// Occlusion culling the generated benchmark scene along its flythrough, for the camera and the shadow casting light
+// Occluders are the ground and the objects' boxes scaled by the fills LoadBenchmarkScene gives them, every object is
+// tested against the buffer sizes Simulation uses. Times are per view, split between rasterizing, the pyramid and testing
+// The flythrough looks down at the ground just ahead, so the same path is also run looking straight ahead at eye level,
+// where objects stand in front of each other
+//
+
+#include "Benchmark.h"
+#include "OcclusionCuller.h"
+#include "SceneGenerator.h"
+
+// Simulation's buffer sizes and the light's orthographic view width
+static const UINT CameraWidth = 320;
+static const UINT CameraHeight = 180;
+static const UINT ShadowSize = 256;
+static const float ShadowViewSize = 60.0f;
+
+// Views sampled along the flythrough
+static const UINT Views = 16;
+
+// Sphere, box and the two thin models, as LoadBenchmarkScene fills their unit bounds
+static const float OccluderFills[] = { 0.55f, 1.0f, 0.0f, 0.0f };
+
+struct CullingScene
+{
+	std::vector<MeshBounds> bounds;
+	std::vector<XMFLOAT4X4> worlds;
+	std::vector<float> fills;
+	GeneratedScene generated;
+};
+
+static void CreateScene(UINT objectCount, CullingScene& scene)
+{
+	SceneDesc desc;
+	desc.objectCount = objectCount;
+	desc.meshCount = 4;
+	SceneGenerator::Generate(desc, scene.generated);
+
+	MeshBounds ground;
+	ground.center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	ground.extents = XMFLOAT3(desc.extent * 0.5f, 0.0f, desc.extent * 0.5f);
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+	scene.bounds.push_back(ground);
+	scene.worlds.push_back(identity);
+	scene.fills.push_back(1.0f);
+
+	MeshBounds unit;
+	unit.center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	unit.extents = XMFLOAT3(0.5f, 0.5f, 0.5f);
+	for (const GeneratedObject& object : scene.generated.objects)
+	{
+		XMFLOAT4X4 world;
+		XMStoreFloat4x4(&world, XMMatrixScaling(object.scale.x, object.scale.y, object.scale.z) *
+			XMMatrixRotationRollPitchYaw(object.rotation.x, object.rotation.y, object.rotation.z) *
+			XMMatrixTranslation(object.position.x, object.position.y, object.position.z));
+		scene.bounds.push_back(unit);
+		scene.worlds.push_back(world);
+		scene.fills.push_back(OccluderFills[object.mesh]);
+	}
+}
+
+enum CullingView
+{
+	ViewFlythrough,
+	ViewEyeLevel,
+	ViewShadow
+};
+
+// Height of the eye level camera
+static const float EyeHeight = 1.7f;
+
+static void GetViews(const CullingScene& scene, CullingView kind, std::vector<XMFLOAT4X4>& views)
+{
+	for (UINT i = 0; i < Views; i++)
+	{
+		XMFLOAT3 eye, target;
+		SceneGenerator::SampleCameraPath(scene.generated, (float)i / Views, eye, target);
+		XMMATRIX viewProjection;
+		if (kind == ViewShadow)
+		{
+			XMVECTOR center = XMLoadFloat3(&target);
+			XMMATRIX view = XMMatrixLookAtLH(center + XMVectorSet(20.0f, 40.0f, -10.0f, 0.0f), center, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+			viewProjection = view * XMMatrixOrthographicLH(ShadowViewSize, ShadowViewSize, 0.1f, 200.0f);
+		}
+		else
+		{
+			if (kind == ViewEyeLevel)
+			{
+				XMVECTOR ahead = XMLoadFloat3(&target) - XMLoadFloat3(&eye);
+				ahead = XMVector3Normalize(XMVectorMultiply(ahead, XMVectorSet(1.0f, 0.0f, 1.0f, 0.0f)));
+				eye.y = EyeHeight;
+				XMStoreFloat3(&target, XMLoadFloat3(&eye) + ahead);
+			}
+			XMMATRIX view = XMMatrixLookAtLH(XMLoadFloat3(&eye), XMLoadFloat3(&target), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+			viewProjection = view * XMMatrixPerspectiveFovLH(0.25f * XM_PI, (float)CameraWidth / CameraHeight, 0.1f, 200.0f);
+		}
+		XMFLOAT4X4 stored;
+		XMStoreFloat4x4(&stored, viewProjection);
+		views.push_back(stored);
+	}
+}
+
+static void RenderOccluders(const CullingScene& scene, OcclusionCuller& culler)
+{
+	for (size_t i = 0; i < scene.bounds.size(); i++)
+	{
+		if (scene.fills[i] <= 0.0f)
+			continue;
+		MeshBounds box = scene.bounds[i];
+		box.extents.x *= scene.fills[i];
+		box.extents.y *= scene.fills[i];
+		box.extents.z *= scene.fills[i];
+		culler.RenderBox(box, scene.worlds[i]);
+	}
+}
+
+static void ReportView(const char* name, const CullingScene& scene, UINT width, UINT height, CullingView kind)
+{
+	std::vector<XMFLOAT4X4> views;
+	GetViews(scene, kind, views);
+	OcclusionCuller culler;
+	culler.Resize(width, height);
+
+	double render = MeasureNanoseconds(Views, [&](UINT64 i)
+	{
+		culler.Begin(views[(size_t)i]);
+		RenderOccluders(scene, culler);
+	});
+	UINT occluderTriangles = culler.GetStats().occluderTriangles;
+	double pyramid = MeasureNanoseconds(1, [&](UINT64) { culler.End(); });
+
+	// Tests against the last view's buffer, the counts over every view
+	UINT visible = 0, occluded = 0, outside = 0;
+	for (UINT i = 0; i < Views; i++)
+	{
+		culler.Begin(views[i]);
+		RenderOccluders(scene, culler);
+		culler.End();
+		for (size_t j = 1; j < scene.bounds.size(); j++)
+			culler.IsVisible(scene.bounds[j], scene.worlds[j]);
+		visible += culler.GetStats().visible;
+		occluded += culler.GetStats().occluded;
+		outside += culler.GetStats().outside;
+	}
+	size_t objects = scene.bounds.size() - 1;
+	double test = MeasureNanoseconds(objects, [&](UINT64 j)
+	{
+		KeepValue(culler.IsVisible(scene.bounds[(size_t)j + 1], scene.worlds[(size_t)j + 1]));
+	});
+
+	std::string label(name);
+	Report((label + ", occluders").c_str(), render / 1000.0, "us");
+	Report((label + ", triangles").c_str(), occluderTriangles, "");
+	Report((label + ", pyramid").c_str(), pyramid / 1000.0, "us");
+	Report((label + ", test").c_str(), test, "ns");
+	Report((label + ", whole view").c_str(), (render + pyramid + test * objects) / 1000.0, "us");
+	Report((label + ", occluded").c_str(), 100.0 * occluded / (visible + occluded + outside), "%");
+	Report((label + ", outside").c_str(), 100.0 * outside / (visible + occluded + outside), "%");
+}
+
+BENCHMARK(OcclusionCuller)
+{
+	const UINT counts[] = { 1000, 5000 };
+	for (UINT count : counts)
+	{
+		CullingScene scene;
+		CreateScene(count, scene);
+		std::ostringstream flythrough, eyeLevel, shadow;
+		flythrough << count << " flythrough";
+		eyeLevel << count << " eye level";
+		shadow << count << " shadow";
+		ReportView(flythrough.str().c_str(), scene, CameraWidth, CameraHeight, ViewFlythrough);
+		ReportView(eyeLevel.str().c_str(), scene, CameraWidth, CameraHeight, ViewEyeLevel);
+		ReportView(shadow.str().c_str(), scene, ShadowSize, ShadowSize, ViewShadow);
+	}
+}
@@ -0,0 +1,66 @@
+//
+// PNG decode throughput on the application's textures, and how much of it is inflating
+//
+
+#include "Benchmark.h"
+#include "PNGDecoder.h"
+
+// Textures the application loads at startup, relative to the repository root
+static const char* TextureFiles[] =
+{
+	"Debug/Textures/brick.png", "Debug/Textures/brick_normal.png", "Debug/Textures/brick_bump.png",
+	"Debug/Textures/default.png", "Debug/Textures/floor_tiles.png", "Debug/Textures/floor_tiles_normal.png"
+};
+
+static bool ReadFile(const char* path, std::vector<BYTE>& data)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file)
+		return false;
+	std::streamsize size = file.tellg();
+	data.resize((size_t)size);
+	file.seekg(0, std::ios::beg);
+	return size > 0 && file.read((char*)&data[0], size);
+}
+
+BENCHMARK(PNGDecode)
+{
+	PNGDecoder decoder;
+	double totalSeconds = 0.0;
+	double totalMegapixels = 0.0;
+	double totalMegabytes = 0.0;
+	for (const char* path : TextureFiles)
+	{
+		std::vector<BYTE> png;
+		if (!ReadFile(path, png))
+		{
+			fprintf(stderr, "Could not read %s\n", path);
+			continue;
+		}
+
+		ImageData image;
+		decoder.Decode(&png[0], png.size(), image);
+
+		// The decoder times its own inflating, so the share comes from the very decodes measured
+		PNGDecodeStats before = decoder.GetStats();
+		double decode = MeasureNanoseconds(10, [&](UINT64)
+		{
+			decoder.Decode(&png[0], png.size(), image);
+			KeepValue(image.rgba[0]);
+		});
+		PNGDecodeStats after = decoder.GetStats();
+		INT64 inflateTicks = after.inflateTicks - before.inflateTicks;
+		INT64 decodeTicks = after.decodeTicks - before.decodeTicks;
+
+		double megapixels = image.width * image.height / 1000000.0;
+		std::string name = strrchr(path, '/') + 1;
+		Report((name + ", decode").c_str(), megapixels / (decode / 1e9), "MP/s");
+		Report((name + ", inflate share").c_str(), 100.0 * inflateTicks / max(decodeTicks, (INT64)1), "%");
+
+		totalSeconds += decode / 1e9;
+		totalMegapixels += megapixels;
+		totalMegabytes += png.size() / 1000000.0;
+	}
+	Report("All textures", totalMegapixels / totalSeconds, "MP/s");
+	Report("All textures, compressed input", totalMegabytes / totalSeconds, "MB/s");
+}
@@ -0,0 +1,163 @@
+//
+// Pose evaluation of thousands of characters with 64 joints each: sampling two compressed clips, blending them and
+// building the palette, per frame, per character and per joint, on the calling thread and with workers alongside
+//
+
+#include "Benchmark.h"
+#include "PoseEvaluator.h"
+
+#include <cmath>
+#include <string>
+
+// Joints of the benchmark character, about what a game character has without its fingers and face
+static const UINT CharacterJoints = 64;
+
+// Keys a second the clips are authored at before compression resamples them
+static const float ClipKeyRate = 60.0f;
+
+/// <summary>A branching skeleton, every joint's parent halfway down the list, with its inverse bind matrices
+/// </summary>
+static void CreateSkeleton(UINT jointCount, Skeleton& skeleton)
+{
+	std::vector<XMFLOAT4X4> model(jointCount);
+	for (UINT i = 0; i < jointCount; i++)
+	{
+		int parent = i == 0 ? -1 : (int)(i - 1) / 2;
+		JointTransform bind = { XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f), XMFLOAT3(i % 2 ? 0.05f : -0.05f, 0.1f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f) };
+		XMMATRIX local = XMMatrixTranslation(bind.translation.x, bind.translation.y, bind.translation.z);
+		XMMATRIX world = parent < 0 ? local : local * XMLoadFloat4x4(&model[parent]);
+		XMStoreFloat4x4(&model[i], world);
+		XMFLOAT4X4 inverseBind;
+		XMStoreFloat4x4(&inverseBind, XMMatrixInverse(NULL, world));
+		skeleton.names.push_back("Joint" + std::to_string(i));
+		skeleton.parents.push_back(parent);
+		skeleton.bindPose.push_back(bind);
+		skeleton.inverseBind.push_back(inverseBind);
+	}
+}
+
+/// <summary>Looping clips of waves running down the joints, every joint rotating and the root moving as well
+/// </summary>
+static void CreateClips(UINT jointCount, UINT clipCount, std::vector<RawClip>& clips)
+{
+	clips.resize(clipCount);
+	for (UINT c = 0; c < clipCount; c++)
+	{
+		RawClip& clip = clips[c];
+		clip.name = "Wave" + std::to_string(c);
+		clip.duration = 2.0f + c;
+		clip.tracks.resize(jointCount);
+		UINT keys = (UINT)(clip.duration * ClipKeyRate) + 1;
+		for (UINT i = 0; i < jointCount; i++)
+		{
+			RawTrack& track = clip.tracks[i];
+			for (UINT k = 0; k < keys; k++)
+			{
+				float time = k / ClipKeyRate;
+				float wave = 2.0f * PI * time / clip.duration - 0.3f * i;
+				XMFLOAT4 rotation;
+				XMStoreFloat4(&rotation, XMQuaternionRotationRollPitchYaw(0.2f * std::sin(wave), 0.15f * c * std::cos(wave), 0.3f * std::sin(wave * 2.0f)));
+				track.rotationTimes.push_back(time);
+				track.rotations.push_back(rotation);
+				if (i == 0)
+				{
+					track.translationTimes.push_back(time);
+					track.translations.push_back(XMFLOAT3(0.02f * std::cos(wave), 0.05f * std::sin(wave * 2.0f), 0.0f));
+				}
+			}
+		}
+	}
+}
+
+BENCHMARK(PoseEvaluatorCharacters)
+{
+	Skeleton skeleton;
+	CreateSkeleton(CharacterJoints, skeleton);
+	std::vector<RawClip> clips;
+	CreateClips(CharacterJoints, 4, clips);
+
+	const UINT counts[] = { 1000, 4000 };
+	const UINT workers[] = { 0, 3 };
+	for (UINT count : counts)
+	{
+		for (UINT workerCount : workers)
+		{
+			// Every character blending, the most expensive case, at its own phase and speed like the scene places them
+			PoseEvaluator poses;
+			poses.Load(skeleton, clips, workerCount);
+			for (UINT i = 0; i < count; i++)
+			{
+				AnimatedCharacter character;
+				XMStoreFloat4x4(&character.world, XMMatrixTranslation(1.5f * (i % 64), 0.0f, 1.5f * (i / 64)));
+				character.phase = 0.37f * i;
+				character.speed = 0.8f + 0.4f * (i % 7) / 6.0f;
+				character.blendPeriod = 4.0f + (i % 5);
+				poses.AddCharacter(character);
+			}
+
+			float time = 0.0f;
+			double frame = MeasureNanoseconds(5, [&](UINT64)
+			{
+				poses.Evaluate(time);
+				time += 1.0f / 60.0f;
+			});
+			KeepValue(poses.GetPalette(count - 1)[0]);
+
+			std::string label = std::to_string(count) + " characters, " + std::to_string(workerCount) + " workers";
+			Report((label + ", frame").c_str(), frame / 1e6, "ms");
+			Report((label + ", per character").c_str(), frame / count / 1000.0, "us");
+			Report((label + ", joints").c_str(), (double)count * CharacterJoints / (frame / 1e9) / 1e6, "M/s");
+		}
+	}
+
+	PoseEvaluator poses;
+	poses.Load(skeleton, clips, 0);
+	const AnimationStats& stats = poses.GetStats();
+	Report("Clip keys kept", 100.0 * stats.keptKeys / stats.rawKeys, "%");
+	Report("Clip bytes", stats.clipBytes / 1024.0, "KB");
+	Report("Clip compression", (double)stats.rawBytes / stats.clipBytes, "x");
+}
+
+BENCHMARK(PoseEvaluatorCpuSkinning)
+{
+	// The shadow pass's CPU skinning of a 400 vertex character, two influences each
+	const UINT count = 1000;
+	const UINT vertexCount = 400;
+	Skeleton skeleton;
+	CreateSkeleton(CharacterJoints, skeleton);
+	std::vector<RawClip> clips;
+	CreateClips(CharacterJoints, 2, clips);
+	PoseEvaluator poses;
+	poses.Load(skeleton, clips, 0);
+	for (UINT i = 0; i < count; i++)
+	{
+		AnimatedCharacter character;
+		XMStoreFloat4x4(&character.world, XMMatrixTranslation(1.5f * (i % 32), 0.0f, 1.5f * (i / 32)));
+		character.phase = 0.37f * i;
+		character.speed = 1.0f;
+		character.blendPeriod = 5.0f;
+		poses.AddCharacter(character);
+	}
+
+	std::vector<Vertex> vertices;
+	std::vector<SkinInfluences> influences(vertexCount);
+	for (UINT v = 0; v < vertexCount; v++)
+	{
+		Vertex vertex(XMFLOAT3(0.1f * std::cos(v * 0.5f), 0.01f * v, 0.1f * std::sin(v * 0.5f)), XMFLOAT2(0.0f, 0.0f));
+		vertex.Normal = XMFLOAT3(std::cos(v * 0.5f), 0.0f, std::sin(v * 0.5f));
+		vertex.Tangent = XMFLOAT3(-std::sin(v * 0.5f), 0.0f, std::cos(v * 0.5f));
+		vertices.push_back(vertex);
+		ZeroMemory(&influences[v], sizeof(SkinInfluences));
+		influences[v].joints[0] = (BYTE)(v * CharacterJoints / vertexCount);
+		influences[v].joints[1] = (BYTE)min(influences[v].joints[0] + 1u, CharacterJoints - 1);
+		influences[v].weights[0] = 0.6f;
+		influences[v].weights[1] = 0.4f;
+	}
+
+	poses.Evaluate(1.0f);
+	std::vector<Vertex> out((size_t)count * vertexCount);
+	double skin = MeasureNanoseconds(5, [&](UINT64) { poses.SkinVerticesInto(&vertices[0], &influences[0], vertexCount, &out[0]); });
+	KeepValue(out.back().Position.x);
+	Report("Skinning 1000 characters", skin / 1e6, "ms");
+	Report("Skinning per vertex", skin / ((double)count * vertexCount), "ns");
+}
@@ -0,0 +1,64 @@
+//
+// Cost of recording profiler zones and counters, the overhead every instrumented scope pays
+//
+
+#include "Benchmark.h"
+#include "Profiler.h"
+
+// Zones timed per repeat
+static const UINT64 Calls = 4000000;
+
+// Zones recorded between frame boundaries, well inside the per frame budget
+static const UINT64 ZonesPerFrame = 1024;
+
+BENCHMARK(ProfilerZone)
+{
+	Profiler::SetEnabled(true);
+	double recorded = MeasureNanoseconds(Calls, [](UINT64 i)
+	{
+		if (i % ZonesPerFrame == 0)
+			Profiler::BeginFrame();
+		PROFILE_ZONE("Zone");
+	});
+	Report("Recorded zone", recorded, "ns");
+
+	double nested = MeasureNanoseconds(Calls / 4, [](UINT64 i)
+	{
+		if (i % (ZonesPerFrame / 4) == 0)
+			Profiler::BeginFrame();
+		PROFILE_ZONE("Outer");
+		{
+			PROFILE_ZONE("Middle");
+			{
+				PROFILE_ZONE("Inner");
+				PROFILE_ZONE("Innermost");
+			}
+		}
+	});
+	Report("Recorded zone, nested four deep", nested / 4.0, "ns");
+
+	Profiler::SetEnabled(false);
+	double disabled = MeasureNanoseconds(Calls, [](UINT64 i)
+	{
+		PROFILE_ZONE("Zone");
+	});
+	Report("Zone while disabled", disabled, "ns");
+	Profiler::SetEnabled(true);
+
+	double overBudget = MeasureNanoseconds(Calls, [](UINT64 i)
+	{
+		PROFILE_ZONE("Zone");
+	});
+	Report("Zone over the frame budget", overBudget, "ns");
+}
+
+BENCHMARK(ProfilerCounter)
+{
+	double counter = MeasureNanoseconds(Calls, [](UINT64 i)
+	{
+		if (i % ZonesPerFrame == 0)
+			Profiler::BeginFrame();
+		PROFILE_COUNTER("Counter", i);
+	});
+	Report("Counter", counter, "ns");
+}
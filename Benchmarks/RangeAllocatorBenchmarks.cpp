@@ -0,0 +1,233 @@
+//
+// Streaming meshes in and out of a shared vertex space: the cost of allocating and freeing against a first fit free list,
+// how fragmented the space gets, and how often GeometryPool's compaction rule fires and how much it moves when it does
+//
+
+#include "Benchmark.h"
+#include "RangeAllocator.h"
+
+#include <cmath>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+
+// Vertices in the space and mesh sizes, from a cube to a detailed model, spread evenly in log scale
+static const UINT Capacity = 1 << 20;
+static const UINT SmallestMesh = 24;
+static const UINT LargestMesh = 40000;
+
+// Operations in the churn, and the share of the space kept live
+static const UINT Operations = 200000;
+static const float LiveFraction = 0.6f;
+
+// GeometryPool's rule: compact once a quarter is free and the largest free range is under half of what is free
+static const float CompactFreeFraction = 0.25f;
+static const float CompactLargestFraction = 0.5f;
+
+/// <summary>First fit over free ranges kept by offset, merging on free, what a simple pool would do
+/// </summary>
+class FirstFitAllocator
+{
+public:
+	FirstFitAllocator(UINT capacity) { freeRanges[0] = capacity; }
+
+	UINT Allocate(UINT size)
+	{
+		for (auto range = freeRanges.begin(); range != freeRanges.end(); ++range)
+		{
+			if (range->second < size)
+				continue;
+			UINT offset = range->first;
+			UINT left = range->second - size;
+			freeRanges.erase(range);
+			if (left)
+				freeRanges[offset + size] = left;
+			return offset;
+		}
+		return RangeAllocator::Invalid;
+	}
+
+	void Free(UINT offset, UINT size)
+	{
+		auto next = freeRanges.lower_bound(offset);
+		if (next != freeRanges.end() && next->first == offset + size)
+		{
+			size += next->second;
+			next = freeRanges.erase(next);
+		}
+		if (next != freeRanges.begin())
+		{
+			auto previous = std::prev(next);
+			if (previous->first + previous->second == offset)
+			{
+				previous->second += size;
+				return;
+			}
+		}
+		freeRanges[offset] = size;
+	}
+private:
+	std::map<UINT, UINT> freeRanges;
+};
+
+struct ChurnOp
+{
+	bool allocate;
+	UINT size;		// Mesh size to allocate, or which live mesh to free
+};
+
+/// <summary>A fixed sequence both allocators run, meshes come while under the live target and go at random above it
+/// </summary>
+static void CreateChurn(std::vector<ChurnOp>& ops)
+{
+	std::mt19937 random(17);
+	std::uniform_real_distribution<float> logSize(logf((float)SmallestMesh), logf((float)LargestMesh));
+	UINT64 live = 0;
+	std::vector<UINT> sizes;
+	for (UINT i = 0; i < Operations; i++)
+	{
+		ChurnOp op;
+		op.allocate = sizes.empty() || (live < Capacity * LiveFraction ? random() % 4 != 0 : random() % 4 == 0);
+		if (op.allocate)
+		{
+			op.size = (UINT)expf(logSize(random));
+			sizes.push_back(op.size);
+			live += op.size;
+		}
+		else
+		{
+			op.size = random();
+			UINT victim = op.size % sizes.size();
+			live -= sizes[victim];
+			sizes[victim] = sizes.back();
+			sizes.pop_back();
+		}
+		ops.push_back(op);
+	}
+}
+
+BENCHMARK(RangeAllocatorChurn)
+{
+	std::vector<ChurnOp> ops;
+	CreateChurn(ops);
+
+	// Live meshes are freed by swapping with the last, the same way on both sides. Failed allocations are skipped
+	RangeAllocator ranges(Capacity);
+	std::vector<UINT> live;
+	UINT failures = 0;
+	double tlsf = MeasureNanoseconds(Operations, [&](UINT64 i)
+	{
+		const ChurnOp& op = ops[(size_t)i];
+		if (op.allocate)
+		{
+			live.push_back(ranges.Allocate(op.size));
+			failures += live.back() == RangeAllocator::Invalid;
+		}
+		else
+		{
+			UINT victim = op.size % live.size();
+			ranges.Free(live[victim]);
+			live[victim] = live.back();
+			live.pop_back();
+		}
+		if (i + 1 == Operations)
+		{
+			ranges.Reset(Capacity);
+			live.clear();
+		}
+	}, 3);
+
+	FirstFitAllocator* firstFit = NULL;
+	std::vector<std::pair<UINT, UINT>> liveFirstFit;
+	double list = MeasureNanoseconds(Operations, [&](UINT64 i)
+	{
+		if (i == 0)
+		{
+			delete firstFit;
+			firstFit = new FirstFitAllocator(Capacity);
+			liveFirstFit.clear();
+		}
+		const ChurnOp& op = ops[(size_t)i];
+		if (op.allocate)
+			liveFirstFit.push_back(std::make_pair(firstFit->Allocate(op.size), op.size));
+		else
+		{
+			UINT victim = op.size % liveFirstFit.size();
+			if (liveFirstFit[victim].first != RangeAllocator::Invalid)
+				firstFit->Free(liveFirstFit[victim].first, liveFirstFit[victim].second);
+			liveFirstFit[victim] = liveFirstFit.back();
+			liveFirstFit.pop_back();
+		}
+	}, 3);
+	delete firstFit;
+
+	Report("Churn, TLSF", tlsf, "ns/op");
+	Report("Churn, first fit list", list, "ns/op");
+	Report("Churn, failed allocations", failures / 3.0, "");
+}
+
+BENCHMARK(RangeAllocatorFragmentation)
+{
+	std::vector<ChurnOp> ops;
+	CreateChurn(ops);
+
+	// The same churn with and without GeometryPool's compaction rule checked after every operation
+	for (UINT compacting = 0; compacting < 2; compacting++)
+	{
+		RangeAllocator ranges(Capacity);
+		std::vector<UINT> live;
+		std::vector<RangeMove> moves;
+		UINT failures = 0, compactions = 0, samples = 0;
+		UINT64 moved = 0;
+		double fragmentation = 0.0, largestFragmentation = 0.0, compactNs = 0.0;
+		for (UINT i = 0; i < Operations; i++)
+		{
+			const ChurnOp& op = ops[i];
+			if (op.allocate)
+			{
+				live.push_back(ranges.Allocate(op.size));
+				failures += live.back() == RangeAllocator::Invalid;
+			}
+			else
+			{
+				UINT victim = op.size % live.size();
+				ranges.Free(live[victim]);
+				live[victim] = live.back();
+				live.pop_back();
+			}
+
+			// How much of the free space can't be had in one piece
+			RangeAllocatorStats stats = ranges.GetStats();
+			UINT free = stats.capacity - stats.used;
+			if (i >= Operations / 10 && free > 0)
+			{
+				double fragmented = 1.0 - (double)stats.largestFree / free;
+				fragmentation += fragmented;
+				largestFragmentation = max(largestFragmentation, fragmented);
+				samples++;
+			}
+
+			if (compacting && free >= stats.capacity * CompactFreeFraction && stats.largestFree < free * CompactLargestFraction)
+			{
+				moves.clear();
+				compactNs += MeasureNanoseconds(1, [&](UINT64) { ranges.Compact(moves); }, 1);
+				for (const RangeMove& move : moves)
+					moved += move.size;
+				compactions++;
+			}
+		}
+
+		std::string label = compacting ? "Compacting" : "Never compacting";
+		Report((label + ", mean fragmentation").c_str(), 100.0 * fragmentation / samples, "%");
+		Report((label + ", worst fragmentation").c_str(), 100.0 * largestFragmentation, "%");
+		Report((label + ", failed allocations").c_str(), failures, "");
+		if (compacting)
+		{
+			Report((label + ", compactions").c_str(), compactions, "");
+			Report((label + ", ops per compaction").c_str(), compactions ? (double)Operations / compactions : 0.0, "");
+			Report((label + ", moved per compaction").c_str(), compactions ? (double)moved / compactions : 0.0, "verts");
+			Report((label + ", Compact call").c_str(), compactions ? compactNs / compactions / 1000.0 : 0.0, "us");
+		}
+	}
+}
@@ -0,0 +1,140 @@
+//
+// Building, reading and searching shader archives holding the four permutations the scene uses and all of them
+// Every permutation is the DefaultPixel fixture with its feature mask stamped in, so none share bytecode and each costs
+// what a real lit pixel shader does to hash and copy. The lookup is a linear search, this shows when that stops being free
+//
+
+#include "Benchmark.h"
+#include "ShaderArchive.h"
+#include "ShaderBuildCommand.h"
+
+#include <unistd.h>
+
+// Compiled lit pixel shader the fake permutations are copied from, relative to the repository root
+static const char* ShaderFile = "Tests/Data/Shaders/DefaultPixel.cso";
+
+// Every bit ShaderFeature defines
+static const UINT FeatureBits = 9;
+
+static bool ReadFile(const char* path, std::vector<BYTE>& data)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file)
+		return false;
+	std::streamsize size = file.tellg();
+	data.resize((size_t)size);
+	file.seekg(0, std::ios::beg);
+	return size > 0 && file.read((char*)&data[0], size);
+}
+
+/// <summary>Hands back the template bytecode with the defines' values stamped over its end
+/// </summary>
+class TemplateCompiler : public ShaderCompiler
+{
+public:
+	TemplateCompiler(const std::vector<BYTE>& bytecode) :
+	bytecode(bytecode)
+	{
+
+	}
+
+	bool Compile(const std::string& source, const std::vector<ShaderDefine>& defines, const std::string& target,
+		std::vector<BYTE>& compiled, std::string& errors)
+	{
+		compiled = bytecode;
+		for (size_t i = 0; i < defines.size(); i++)
+			compiled[compiled.size() - 1 - i] = (BYTE)defines[i].value[0];
+		return true;
+	}
+private:
+	const std::vector<BYTE>& bytecode;
+};
+
+static void ReportArchive(const char* name, const std::vector<UINT>& masks, const std::vector<BYTE>& shader)
+{
+	TemplateCompiler compiler(shader);
+	std::vector<std::vector<BYTE> > compiled(masks.size());
+	for (size_t i = 0; i < masks.size(); i++)
+	{
+		std::vector<ShaderDefine> defines;
+		std::string errors;
+		ShaderPermutations::GetDefines(masks[i], defines);
+		compiler.Compile("LitPixel.hlsli", defines, "ps_4_0", compiled[i], errors);
+	}
+
+	ShaderArchive archive;
+	double add = MeasureNanoseconds(1, [&](UINT64)
+	{
+		ShaderArchive built;
+		for (size_t i = 0; i < masks.size(); i++)
+			built.Add("LitPixel", masks[i], &compiled[i][0], compiled[i].size());
+		archive = built;
+	});
+
+	std::vector<BYTE> data;
+	archive.Write(data);
+	ShaderArchive read;
+	double load = MeasureNanoseconds(1, [&](UINT64)
+	{
+		read.Read(&data[0], data.size());
+		KeepValue(read.GetBlobCount());
+	});
+
+	const UINT lookups = 100000;
+	double find = MeasureNanoseconds(lookups, [&](UINT64 i)
+	{
+		const BYTE* bytecode = NULL;
+		size_t size = 0;
+		read.Find("LitPixel", masks[i % masks.size()], bytecode, size);
+		KeepValue(size);
+	});
+
+	std::string label(name);
+	Report((label + ", archive size").c_str(), data.size() / (1024.0 * 1024.0), "MB");
+	Report((label + ", add").c_str(), add / 1e6, "ms");
+	Report((label + ", read").c_str(), load / 1e6, "ms");
+	Report((label + ", find").c_str(), find, "ns");
+}
+
+BENCHMARK(ShaderArchive)
+{
+	std::vector<BYTE> shader;
+	if (!ReadFile(ShaderFile, shader))
+	{
+		fprintf(stderr, "Could not read %s\n", ShaderFile);
+		return;
+	}
+
+	std::vector<ShaderPermutation> used;
+	ShaderPermutations::GetUsed(used);
+	std::vector<UINT> usedMasks;
+	for (const ShaderPermutation& permutation : used)
+		usedMasks.push_back(permutation.features);
+
+	std::vector<UINT> allMasks;
+	for (UINT features = 0; features < (1u << FeatureBits); features++)
+	{
+		UINT normalized = ShaderPermutations::Normalize(features);
+		if (std::find(allMasks.begin(), allMasks.end(), normalized) == allMasks.end())
+			allMasks.push_back(normalized);
+	}
+
+	ReportArchive("Used permutations", usedMasks, shader);
+	ReportArchive("All permutations", allMasks, shader);
+
+	// -buildshaders end to end without the compiler: archive, report and both files written
+	char archivePath[] = "/tmp/shaderbenchXXXXXX";
+	char reportPath[] = "/tmp/shaderbenchlogXXXXXX";
+	close(mkstemp(archivePath));
+	close(mkstemp(reportPath));
+	std::ostream quiet(NULL);
+	ShaderBuildCommand command;
+	command.SetLog(&quiet);
+	std::string commandLine = std::string("-buildshaders out=") + archivePath + " report=" + reportPath;
+	command.ParseCommandLine(commandLine.c_str());
+	TemplateCompiler compiler(shader);
+	double build = MeasureNanoseconds(1, [&](UINT64) { KeepValue(command.Run(compiler)); });
+	Report("Build used permutations, compiler stubbed", build / 1e6, "ms");
+	unlink(archivePath);
+	unlink(reportPath);
+}
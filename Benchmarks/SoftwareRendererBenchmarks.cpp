@@ -0,0 +1,347 @@
+//
+// Software renderer throughput on a generated benchmark scene as the thread count grows, and the raster loop on its own
+// The scene is SceneGenerator's layout with spheres standing in for the imported models, lit, textured and shadowed with
+// every feature on. The loop comparison runs the renderer's SSE2 edge tests against the same loop eight pixels wide on
+// AVX2, which is what decides whether a wider path is worth a runtime dispatch
+//
+
+#include "Benchmark.h"
+#include "ImageConvert.h"
+#include "SceneGenerator.h"
+#include "ShaderPermutations.h"
+#include "SoftwareRenderer.h"
+#include "TestMeshes.h"
+
+#include <immintrin.h>
+#include <thread>
+
+// Target and shadow map of the windowed run
+static const UINT FrameWidth = 1280;
+static const UINT FrameHeight = 720;
+static const UINT ShadowSize = 2048;
+
+// Frames rendered along the flythrough per measurement
+static const UINT Frames = 4;
+
+// Objects in the scene, each a sphere of one of the palette's tessellations
+static const UINT ObjectCount = 500;
+static const UINT PaletteRings[] = { 8, 12, 16 };
+static const UINT PaletteSize = sizeof(PaletteRings) / sizeof(PaletteRings[0]);
+
+typedef SoftwareRenderer::RasterTriangle RasterTriangle;
+
+static void CreateTexture(UINT size, bool normalMap, SoftwareTexture& texture)
+{
+	ImageData image;
+	image.width = size;
+	image.height = size;
+	for (UINT y = 0; y < size; y++)
+	{
+		for (UINT x = 0; x < size; x++)
+		{
+			BYTE value = ((x / 16 + y / 16) % 2) ? 220 : 90;
+			BYTE texel[4] = { value, (BYTE)(value - 40), (BYTE)(255 - value), 255 };
+			BYTE bump[4] = { (BYTE)(128 + (x % 16) * 4 - 32), 128, 240, 255 };
+			image.rgba.insert(image.rgba.end(), normalMap ? bump : texel, (normalMap ? bump : texel) + 4);
+		}
+	}
+	ImageConvert::GenerateMips(image, normalMap ? MipLinear : MipColor, MipBox, texture.mips);
+}
+
+class BenchmarkScene
+{
+public:
+	BenchmarkScene()
+	{
+		SceneDesc desc;
+		desc.objectCount = ObjectCount;
+		desc.meshCount = PaletteSize;
+		SceneGenerator::Generate(desc, generated);
+
+		// Spheres of radius 0.5 stand in for the models, and one quad across the scene is the ground
+		meshes.resize(PaletteSize + 1);
+		for (UINT i = 0; i < PaletteSize; i++)
+			CreateSphere(0.5f, PaletteRings[i], meshes[i]);
+		CreateGrid(1, desc.extent, 0.0f, 0, meshes[PaletteSize]);
+		XMStoreFloat4x4(&groundWorld, XMMatrixTranslation(-desc.extent * 0.5f, 0.0f, -desc.extent * 0.5f));
+
+		textures.resize(2);
+		CreateTexture(256, false, textures[0]);
+		CreateTexture(256, true, textures[1]);
+		materials.resize(2);
+		for (SoftwareMaterial& material : materials)
+		{
+			material.lightMat.ambient = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
+			material.lightMat.diffuse = XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f);
+			material.lightMat.specular = XMFLOAT4(0.9f, 0.9f, 0.9f, 64.0f);
+			material.diffuse = &textures[0];
+		}
+		materials[0].normal = &textures[1];
+		materials[0].tileX = 20.0f;
+		materials[0].tileZ = 20.0f;
+	}
+
+	/// <summary>Records frame index of Frames along the flythrough, lit by the nearest generated light
+	/// </summary>
+	void Record(UINT index, UINT features, SoftwareRenderer& renderer) const
+	{
+		XMFLOAT3 eye, target;
+		SceneGenerator::SampleCameraPath(generated, (float)index / Frames, eye, target);
+
+		SoftwareFrameData frame = SoftwareFrameData();
+		XMStoreFloat4x4(&frame.view, XMMatrixLookAtLH(XMLoadFloat3(&eye), XMLoadFloat3(&target), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+		XMStoreFloat4x4(&frame.projection, XMMatrixPerspectiveFovLH(0.25f * XM_PI, (float)FrameWidth / FrameHeight, 0.1f, 200.0f));
+		frame.eyePos = eye;
+
+		const GeneratedLight& light = generated.lights[index % generated.lights.size()];
+		frame.pLight.diffuse = light.color;
+		frame.pLight.specular = XMFLOAT4(0.6f, 0.6f, 0.6f, 1.0f);
+		frame.pLight.attenuation = XMFLOAT3(0.0f, 0.1f, 0.0f);
+		frame.pLight.position = light.position;
+		frame.pLight.range = light.range;
+
+		XMFLOAT3 spotPosition(target.x + 20.0f, 30.0f, target.z - 10.0f);
+		frame.sLight.diffuse = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+		frame.sLight.specular = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+		frame.sLight.attenuation = XMFLOAT3(1.0f, 0.0f, 0.0f);
+		frame.sLight.position = spotPosition;
+		XMStoreFloat3(&frame.sLight.direction, XMVector3Normalize(XMLoadFloat3(&target) - XMLoadFloat3(&spotPosition)));
+		frame.sLight.spot = 8.0f;
+		frame.sLight.range = 1000.0f;
+
+		frame.fogStart = 50.0f;
+		frame.fogRange = 100.0f;
+		frame.fogColor = XMFLOAT4(0.7f, 0.7f, 0.7f, 0.2f);
+		frame.clearColor = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+		frame.features = features;
+		XMStoreFloat4x4(&frame.shadowView, XMMatrixLookAtLH(XMLoadFloat3(&spotPosition), XMLoadFloat3(&target), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+		XMStoreFloat4x4(&frame.shadowProjection, XMMatrixOrthographicLH(60.0f, 60.0f, 0.1f, 200.0f));
+
+		renderer.Begin(frame);
+		AddDraw(meshes[PaletteSize], XMLoadFloat4x4(&groundWorld), materials[0], renderer);
+		for (const GeneratedObject& object : generated.objects)
+		{
+			XMMATRIX world = XMMatrixScaling(object.scale.x, object.scale.y, object.scale.z) *
+				XMMatrixRotationRollPitchYaw(object.rotation.x, object.rotation.y, object.rotation.z) *
+				XMMatrixTranslation(object.position.x, object.position.y, object.position.z);
+			AddDraw(meshes[object.mesh], world, materials[1], renderer);
+		}
+	}
+private:
+	static void AddDraw(const MeshData& mesh, XMMATRIX world, const SoftwareMaterial& material, SoftwareRenderer& renderer)
+	{
+		SoftwareDraw draw;
+		draw.vertices = &mesh.vertices[0];
+		draw.vertexCount = (UINT)mesh.vertices.size();
+		draw.indices = &mesh.indices[0];
+		draw.indexCount = (UINT)mesh.indices.size();
+		XMStoreFloat4x4(&draw.world, world);
+		XMStoreFloat4x4(&draw.worldInverseTranspose, XMMatrixTranspose(XMMatrixInverse(nullptr, XMMatrixTranspose(world))));
+		draw.material = &material;
+		renderer.Draw(draw);
+	}
+
+	GeneratedScene generated;
+	std::vector<MeshData> meshes;
+	XMFLOAT4X4 groundWorld;		// Centers the ground on the scene
+	std::vector<SoftwareTexture> textures;
+	std::vector<SoftwareMaterial> materials;
+};
+
+/// <summary>Milliseconds per frame over the flythrough, and the stats of the last frame
+/// </summary>
+static double RenderFrames(const BenchmarkScene& scene, UINT threads, UINT features, SoftwareRenderStats& stats)
+{
+	SoftwareRenderer renderer;
+	renderer.Resize(FrameWidth, FrameHeight, ShadowSize);
+	renderer.SetThreads(threads);
+	double perFrame = MeasureNanoseconds(Frames, [&](UINT64 i)
+	{
+		scene.Record((UINT)i, features, renderer);
+		renderer.End();
+	}, 3);
+	stats = renderer.GetStats();
+	return perFrame / 1e6;
+}
+
+BENCHMARK(SoftwareRendererScaling)
+{
+	BenchmarkScene scene;
+	UINT cores = max(std::thread::hardware_concurrency(), 1u);
+	Report("Hardware threads", cores, "");
+
+	SoftwareRenderStats stats;
+	double single = RenderFrames(scene, 1, FeatureAll, stats);
+	double pixels = (double)FrameWidth * FrameHeight;
+	Report("1 thread, per frame", single, "ms");
+	Report("1 thread, shadow pass", stats.shadowSeconds * 1000.0, "ms");
+	Report("1 thread, setup and binning", stats.setupSeconds * 1000.0, "ms");
+	Report("1 thread, raster and shading", stats.rasterSeconds * 1000.0, "ms");
+	Report("1 thread, throughput", pixels / (single / 1000.0) / 1e6, "Mpix/s");
+	Report("1 thread, triangles", stats.triangles / (single / 1000.0) / 1e6, "Mtris/s");
+
+	// Without lighting, texturing or shadows, what's left of the raster stage is mostly the edge loop
+	SoftwareRenderStats unlit;
+	RenderFrames(scene, 1, 0, unlit);
+	Report("1 thread, raster stage unlit", unlit.rasterSeconds * 1000.0, "ms");
+
+	for (UINT threads = 2; threads <= max(cores, 4u); threads *= 2)
+	{
+		double ms = RenderFrames(scene, threads, FeatureAll, stats);
+		std::ostringstream label;
+		label << threads << " threads, per frame";
+		Report(label.str().c_str(), ms, "ms");
+		label.str("");
+		label << threads << " threads, speedup";
+		Report(label.str().c_str(), single / ms, "x");
+	}
+}
+
+/// <summary>Edge and depth planes for a screen space triangle, as SetupTriangle computes them
+/// </summary>
+static RasterTriangle MakeTriangle(const float* x, const float* y, const float* z)
+{
+	RasterTriangle triangle;
+	triangle.topLeft = 0;
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	for (int k = 0; k < 3; k++)
+	{
+		int j = k == 2 ? 0 : k + 1;
+		int l = j == 2 ? 0 : j + 1;
+		triangle.edgeA[k] = y[j] - y[l];
+		triangle.edgeB[k] = x[l] - x[j];
+		triangle.edgeC[k] = x[j] * y[l] - x[l] * y[j];
+		if (triangle.edgeA[k] > 0.0f || (triangle.edgeA[k] == 0.0f && triangle.edgeB[k] > 0.0f))
+			triangle.topLeft |= 1 << k;
+	}
+	triangle.depth[0] = (triangle.edgeA[0] * z[0] + triangle.edgeA[1] * z[1] + triangle.edgeA[2] * z[2]) / area;
+	triangle.depth[1] = (triangle.edgeB[0] * z[0] + triangle.edgeB[1] * z[1] + triangle.edgeB[2] * z[2]) / area;
+	triangle.depth[2] = (triangle.edgeC[0] * z[0] + triangle.edgeC[1] * z[1] + triangle.edgeC[2] * z[2]) / area;
+	triangle.minX = max((int)floorf(min(x[0], min(x[1], x[2])) - 0.5f), 0);
+	triangle.minY = max((int)floorf(min(y[0], min(y[1], y[2])) - 0.5f), 0);
+	triangle.maxX = min((int)ceilf(max(x[0], max(x[1], x[2])) - 0.5f), SoftwareRenderer::TileSize - 1);
+	triangle.maxY = min((int)ceilf(max(y[0], max(y[1], y[2])) - 0.5f), SoftwareRenderer::TileSize - 1);
+	triangle.draw = 0;
+	return triangle;
+}
+
+__attribute__((target("avx2"))) static __m256 InsideEdge8(__m256 e, __m256 topLeft)
+{
+	__m256 zero = _mm256_setzero_ps();
+	return _mm256_or_ps(_mm256_cmp_ps(e, zero, _CMP_GT_OQ), _mm256_and_ps(_mm256_cmp_ps(e, zero, _CMP_EQ_OQ), topLeft));
+}
+
+/// <summary>SoftwareRenderer::RasterizeTriangle eight pixels at a time, same rules and results
+/// </summary>
+__attribute__((target("avx2"))) static void RasterizeTriangle8(const RasterTriangle& triangle, int tileX, int tileY, float* depth, UINT* ids, UINT id)
+{
+	const int TileSize = SoftwareRenderer::TileSize;
+	int x0 = max(triangle.minX, tileX);
+	int y0 = max(triangle.minY, tileY);
+	int x1 = min(triangle.maxX, tileX + TileSize - 1);
+	int y1 = min(triangle.maxY, tileY + TileSize - 1);
+	if (x0 > x1 || y0 > y1)
+		return;
+
+	x0 &= ~7;
+	const __m256 offsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+	const __m256 allBits = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+	__m256 a[3], topLeft[3];
+	for (int k = 0; k < 3; k++)
+	{
+		a[k] = _mm256_set1_ps(triangle.edgeA[k]);
+		topLeft[k] = (triangle.topLeft & (1 << k)) ? allBits : _mm256_setzero_ps();
+	}
+	__m256 depthX = _mm256_set1_ps(triangle.depth[0]);
+	__m256 idVector = _mm256_castsi256_ps(_mm256_set1_epi32((int)id));
+
+	for (int y = y0; y <= y1; y++)
+	{
+		float py = y + 0.5f;
+		__m256 row0 = _mm256_set1_ps(triangle.edgeB[0] * py + triangle.edgeC[0]);
+		__m256 row1 = _mm256_set1_ps(triangle.edgeB[1] * py + triangle.edgeC[1]);
+		__m256 row2 = _mm256_set1_ps(triangle.edgeB[2] * py + triangle.edgeC[2]);
+		__m256 rowDepth = _mm256_set1_ps(triangle.depth[1] * py + triangle.depth[2]);
+		float* depthRow = depth + (y - tileY) * TileSize - tileX;
+		float* idRow = (float*)ids + (y - tileY) * TileSize - tileX;
+
+		for (int x = x0; x <= x1; x += 8)
+		{
+			__m256 px = _mm256_add_ps(_mm256_set1_ps((float)x), offsets);
+			__m256 inside = InsideEdge8(_mm256_add_ps(_mm256_mul_ps(a[0], px), row0), topLeft[0]);
+			inside = _mm256_and_ps(inside, InsideEdge8(_mm256_add_ps(_mm256_mul_ps(a[1], px), row1), topLeft[1]));
+			inside = _mm256_and_ps(inside, InsideEdge8(_mm256_add_ps(_mm256_mul_ps(a[2], px), row2), topLeft[2]));
+			if (!_mm256_movemask_ps(inside))
+				continue;
+
+			__m256 z = _mm256_add_ps(_mm256_mul_ps(depthX, px), rowDepth);
+			__m256 old = _mm256_loadu_ps(depthRow + x);
+			__m256 pass = _mm256_and_ps(inside, _mm256_cmp_ps(z, old, _CMP_LE_OQ));
+			if (!_mm256_movemask_ps(pass))
+				continue;
+
+			_mm256_storeu_ps(depthRow + x, _mm256_blendv_ps(old, z, pass));
+			_mm256_storeu_ps(idRow + x, _mm256_blendv_ps(_mm256_loadu_ps(idRow + x), idVector, pass));
+		}
+	}
+}
+
+BENCHMARK(SoftwareRasterLoop)
+{
+	const int TileSize = SoftwareRenderer::TileSize;
+	bool avx2 = __builtin_cpu_supports("avx2") != 0;
+
+	// Triangles of one size scattered over a tile, from the distant spheres' few pixels to close up ground
+	const float sizes[] = { 3.0f, 8.0f, 24.0f, 64.0f };
+	std::mt19937 random(3);
+	std::vector<float> depth(TileSize * TileSize), wideDepth(TileSize * TileSize);
+	std::vector<UINT> ids(TileSize * TileSize), wideIds(TileSize * TileSize);
+	for (float size : sizes)
+	{
+		std::vector<RasterTriangle> triangles;
+		for (UINT i = 0; i < 4096; i++)
+		{
+			float cx = (float)(random() % (TileSize * 256)) / 256.0f;
+			float cy = (float)(random() % (TileSize * 256)) / 256.0f;
+			float x[3] = { cx - size * 0.5f, cx + size * 0.5f, cx - size * 0.25f };
+			float y[3] = { cy - size * 0.5f, cy - size * 0.25f, cy + size * 0.5f };
+			float z[3] = { (random() % 1000) / 1000.0f, (random() % 1000) / 1000.0f, (random() % 1000) / 1000.0f };
+			triangles.push_back(MakeTriangle(x, y, z));
+		}
+
+		// Both paths must agree before their times mean anything
+		std::fill(depth.begin(), depth.end(), 1.0f);
+		std::fill(wideDepth.begin(), wideDepth.end(), 1.0f);
+		for (UINT i = 0; i < triangles.size(); i++)
+		{
+			SoftwareRenderer::RasterizeTriangle(triangles[i], 0, 0, &depth[0], &ids[0], i);
+			if (avx2)
+				RasterizeTriangle8(triangles[i], 0, 0, &wideDepth[0], &wideIds[0], i);
+		}
+		if (avx2 && (depth != wideDepth || ids != wideIds))
+			fprintf(stderr, "AVX2 loop disagrees with the renderer's\n");
+
+		double sse2 = MeasureNanoseconds(triangles.size(), [&](UINT64 i)
+		{
+			SoftwareRenderer::RasterizeTriangle(triangles[(size_t)i], 0, 0, &depth[0], &ids[0], (UINT)i);
+		});
+		std::ostringstream label;
+		label << (int)size << " px triangles, SSE2";
+		Report(label.str().c_str(), sse2, "ns");
+		if (!avx2)
+			continue;
+
+		double wide = MeasureNanoseconds(triangles.size(), [&](UINT64 i)
+		{
+			RasterizeTriangle8(triangles[(size_t)i], 0, 0, &wideDepth[0], &wideIds[0], (UINT)i);
+		});
+		label.str("");
+		label << (int)size << " px triangles, AVX2";
+		Report(label.str().c_str(), wide, "ns");
+		label.str("");
+		label << (int)size << " px triangles, AVX2 speedup";
+		Report(label.str().c_str(), sse2 / wide, "x");
+	}
+	if (!avx2)
+		Report("AVX2 not supported, loop not compared", 0.0, "");
+}
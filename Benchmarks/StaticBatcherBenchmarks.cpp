@@ -0,0 +1,66 @@
+//
+// Static batching of a scattered scene like the -benchmark one: draws a pass takes before and after, what building
+// the batches costs at load and the memory they add, for a few cluster sizes
+//
+
+#include "Benchmark.h"
+#include "StaticBatcher.h"
+#include "TestMeshes.h"
+
+#include <random>
+#include <sstream>
+
+// Objects in the scene, spread over a square this many units across, and how many materials they are split between
+static const UINT SceneObjects = 10000;
+static const float SceneSize = 200.0f;
+static const UINT SceneMaterials = 8;
+
+// Raised past the default so the cluster size alone decides what is merged
+static const UINT BatchBudgetMB = 512;
+
+BENCHMARK(StaticBatcherDrawReduction)
+{
+	// Three prop sizes placed, turned and scaled at random
+	MeshData meshes[3];
+	CreateGrid(4, 1.0f, 0.1f, 2, meshes[0]);
+	CreateGrid(8, 1.0f, 0.1f, 2, meshes[1]);
+	CreateGrid(14, 1.0f, 0.1f, 2, meshes[2]);
+	std::mt19937 random(21);
+	std::uniform_real_distribution<float> position(-SceneSize * 0.5f, SceneSize * 0.5f);
+	std::uniform_real_distribution<float> angle(0.0f, XM_2PI);
+	std::uniform_real_distribution<float> scale(0.5f, 3.0f);
+	std::vector<StaticInstance> instances(SceneObjects);
+	UINT64 sourceVertices = 0;
+	for (UINT i = 0; i < SceneObjects; i++)
+	{
+		StaticInstance& instance = instances[i];
+		instance.mesh = &meshes[i % 3];
+		instance.material = (UINT)(random() % SceneMaterials);
+		XMStoreFloat4x4(&instance.world, XMMatrixScaling(scale(random), scale(random), scale(random)) *
+			XMMatrixRotationY(angle(random)) * XMMatrixTranslation(position(random), 0.0f, position(random)));
+		sourceVertices += instance.mesh->vertices.size();
+	}
+
+	const char* sizes[] = { "10", "25", "50" };
+	for (const char* size : sizes)
+	{
+		StaticBatcher batcher;
+		std::ostringstream args;
+		args << "staticbatchsize=" << size << " staticbatchmb=" << BatchBudgetMB;
+		batcher.ParseCommandLine(args.str().c_str());
+		std::vector<StaticBatch> batches;
+		double build = MeasureNanoseconds(1, [&](UINT64) { batcher.Build(instances, batches); }, 3);
+
+		const StaticBatchStats& stats = batcher.GetStats();
+		std::string label = std::string("Cluster ") + size;
+		Report((label + ", draws after").c_str(), stats.drawsAfter, "");
+		Report((label + ", draw reduction").c_str(), (double)stats.drawsBefore / stats.drawsAfter, "x");
+		Report((label + ", instances left alone").c_str(), stats.instances - stats.batched, "");
+		Report((label + ", build").c_str(), build / 1e6, "ms");
+		Report((label + ", build per instance").c_str(), build / stats.instances / 1000.0, "us");
+		Report((label + ", batch memory").c_str(), stats.bytes / (1024.0 * 1024.0), "MB");
+		KeepValue(batches.size());
+	}
+	Report("Draws before batching", SceneObjects, "");
+	Report("Source vertices", (double)sourceVertices, "");
+}
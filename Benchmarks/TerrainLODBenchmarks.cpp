@@ -0,0 +1,180 @@
+//
+// What morphing terrain on the CPU costs: writing one chunk's vertices at each level, and walks with Terrain's per frame
+// work, selecting chunks and rewriting the ones whose level changed or that morph. Walks cross the default terrain and a
+// 16k x 16k one tiled from the same generated heights, with the morph eye stepping a cell at a time as Terrain does and
+// following the eye every frame
+//
+
+#include "Benchmark.h"
+#include "TerrainLOD.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <string>
+
+// Terrain's defaults, 1024 cells a side, 40 units tall, level 0 out to 64 units
+static const UINT TerrainCells = 1024;
+static const float HeightScale = 40.0f;
+static const float FirstRange = 64.0f;
+
+// The largest terrain walked, 16k cells a side
+static const UINT LargeTerrainCells = 16384;
+
+// Walking speed at 60 frames a second, and the camera's far plane
+static const float WalkStep = 0.1f;
+static const UINT WalkFrames = 600;
+static const float FarPlane = 200.0f;
+
+static void CreateHeights(std::vector<float>& heights)
+{
+	heights.resize(TerrainTileSamples * TerrainTileSamples);
+	for (UINT z = 0; z < TerrainTileSamples; z++)
+	{
+		for (UINT x = 0; x < TerrainTileSamples; x++)
+		{
+			UINT hash = (x * 73856093u) ^ (z * 19349663u);
+			hash = (hash ^ (hash >> 13)) * 0x5bd1e995u;
+			float rough = (float)(hash >> 8 & 0xffff) / 65535.0f;
+			heights[z * TerrainTileSamples + x] = 18.0f + 15.0f * sinf(x * 0.05f) * cosf(z * 0.07f) + 4.0f * rough;
+		}
+	}
+}
+
+BENCHMARK(TerrainWriteVertices)
+{
+	std::vector<float> heights;
+	CreateHeights(heights);
+	TerrainSelector selector;
+	selector.Configure(TerrainTileChunks, TerrainTileChunks, 1.0f, FirstRange, HeightScale);
+	std::vector<Vertex> vertices(TerrainChunkVertices * TerrainChunkVertices);
+
+	// The eye stands back most of each level's range from the tile, so the chunks nearest it are in the morph band
+	for (UINT level = 0; level + 1 < TerrainLevels; level++)
+	{
+		XMFLOAT3 eye(-selector.GetRange(level) * 0.95f, 20.0f, 16.0f);
+		double ns = MeasureNanoseconds(2000, [&](UINT64 i)
+		{
+			UINT chunk = (UINT)i % (TerrainTileChunks * TerrainTileChunks);
+			UINT x = chunk % TerrainTileChunks, z = chunk / TerrainTileChunks;
+			selector.WriteVertices(&heights[0], x, z, selector.GetChunkOrigin(x, z), level, eye, &vertices[0]);
+			KeepValue(vertices[0].Position.y);
+		});
+		std::ostringstream label;
+		label << "Chunk, level " << level;
+		Report(label.str().c_str(), ns / 1000.0, "us");
+		if (level == 0)
+			Report("Chunk, level 0, per vertex", ns / vertices.size(), "ns");
+	}
+}
+
+/// <summary>Walks a terrain of cells a side with its chunks' heights set from the tile, seeing out to farPlane
+/// </summary>
+static void Walk(const std::vector<float>& heights, UINT cells, float farPlane, const std::string& name)
+{
+	// Every tile is the same generated one, so each chunk's height range is its place in the tile's, as Terrain sets it
+	UINT chunksPerSide = cells / TerrainChunkCells;
+	TerrainSelector selector;
+	selector.Configure(chunksPerSide, chunksPerSide, 1.0f, FirstRange, HeightScale);
+	for (UINT z = 0; z < chunksPerSide; z++)
+	{
+		for (UINT x = 0; x < chunksPerSide; x++)
+		{
+			UINT firstX = x % TerrainTileChunks * TerrainChunkCells + 1, firstZ = z % TerrainTileChunks * TerrainChunkCells + 1;
+			float lowest = heights[firstZ * TerrainTileSamples + firstX], highest = lowest;
+			for (UINT row = firstZ; row < firstZ + TerrainChunkVertices; row++)
+			{
+				const float* sample = &heights[row * TerrainTileSamples + firstX];
+				lowest = min(lowest, *std::min_element(sample, sample + TerrainChunkVertices));
+				highest = max(highest, *std::max_element(sample, sample + TerrainChunkVertices));
+			}
+			selector.SetChunkHeights(x, z, lowest, highest);
+		}
+	}
+
+	std::vector<UINT> indices;
+	std::vector<MeshLOD> ranges;
+	TerrainSelector::BuildIndices(indices, ranges);
+	UINT fullTriangles = ranges[0].indexCount / 3;
+
+	std::vector<Vertex> vertices(TerrainChunkVertices * TerrainChunkVertices);
+	const float steps[] = { 1.0f, 0.0f };
+	for (float morphStep : steps)
+	{
+		// Per chunk, the level, whether it morphed and the eye it was last written for, as Terrain's chunk buffers keep
+		struct Written
+		{
+			UINT level;
+			bool morphing;
+			XMFLOAT3 eye;
+		};
+		std::map<UINT, Written> written;
+		std::vector<TerrainChunk> chunks;
+		XMFLOAT3 morphEye(0.0f, 0.0f, 0.0f);
+		UINT64 selected = 0, rewrites = 0, triangles = 0;
+		double selectNs = 0.0, writeNs = 0.0;
+
+		for (UINT frame = 0; frame < WalkFrames; frame++)
+		{
+			// Walking diagonally across the middle at eye height, looking the way it walks
+			float t = frame * WalkStep;
+			XMFLOAT3 eye(-30.0f + t * 0.7f, 21.7f, -30.0f + t * 0.7f);
+			XMMATRIX view = XMMatrixLookToLH(XMLoadFloat3(&eye), XMVectorSet(0.7f, -0.1f, 0.7f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+			XMFLOAT4X4 viewProjection;
+			XMStoreFloat4x4(&viewProjection, view * XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 0.1f, farPlane));
+			XMFLOAT4 planes[6];
+			TerrainSelector::ExtractFrustum(viewProjection, planes);
+
+			float dx = eye.x - morphEye.x, dy = eye.y - morphEye.y, dz = eye.z - morphEye.z;
+			if (frame == 0 || dx * dx + dy * dy + dz * dz > morphStep * morphStep)
+				morphEye = eye;
+
+			selectNs += MeasureNanoseconds(1, [&](UINT64)
+			{
+				selector.Select(morphEye, farPlane, planes, planes, chunks);
+			}, 1);
+
+			writeNs += MeasureNanoseconds(1, [&](UINT64)
+			{
+				for (const TerrainChunk& chunk : chunks)
+				{
+					UINT key = chunk.z * chunksPerSide + chunk.x;
+					std::map<UINT, Written>::iterator found = written.find(key);
+					bool moved = found == written.end() || memcmp(&found->second.eye, &morphEye, sizeof(morphEye)) != 0;
+					if (found != written.end() && found->second.level == chunk.level && !((chunk.morphing || found->second.morphing) && moved))
+						continue;
+					selector.WriteVertices(&heights[0], chunk.x % TerrainTileChunks, chunk.z % TerrainTileChunks,
+						selector.GetChunkOrigin(chunk.x, chunk.z), chunk.level, morphEye, &vertices[0]);
+					Written entry = { chunk.level, chunk.morphing, morphEye };
+					written[key] = entry;
+					rewrites++;
+				}
+			}, 1);
+
+			selected += chunks.size();
+			for (const TerrainChunk& chunk : chunks)
+				triangles += ranges[chunk.level * TerrainSideCount + chunk.stitch].indexCount / 3;
+		}
+
+		// Averages include the first frame, which writes every chunk
+		std::string label = name + (morphStep > 0.0f ? ", stepped eye" : ", eye every frame");
+		Report((label + ", chunks").c_str(), (double)selected / WalkFrames, "");
+		Report((label + ", triangles").c_str(), (double)triangles / WalkFrames, "");
+		Report((label + ", full detail").c_str(), (double)selected / WalkFrames * fullTriangles, "");
+		Report((label + ", select").c_str(), selectNs / WalkFrames / 1000.0, "us");
+		Report((label + ", rewrites").c_str(), (double)rewrites / WalkFrames, "");
+		Report((label + ", rewrite").c_str(), writeNs / WalkFrames / 1000.0, "us");
+	}
+}
+
+BENCHMARK(TerrainWalk)
+{
+	std::vector<float> heights;
+	CreateHeights(heights);
+	Walk(heights, TerrainCells, FarPlane, "1k walk");
+
+	// Selection only looks under the eye's circle, so a terrain 256 times larger should cost the same, until the far
+	// plane is pushed out to take in thousands of chunks
+	Walk(heights, LargeTerrainCells, FarPlane, "16k walk");
+	Walk(heights, LargeTerrainCells, FarPlane * 10.0f, "16k walk, far 2000");
+}
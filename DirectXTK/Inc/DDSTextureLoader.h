@@ -157,4 +157,22 @@ namespace DirectX
                                                 _Outptr_opt_ ID3D11ShaderResourceView** textureView,
                                                 _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr
                                               );
+
+    // Memory-mapped version: the file is mapped read-only and the subresource data points into the
+    // mapping instead of a heap copy. Creates mips [firstMip, firstMip + mipLevels) of the chain
+    // (mipLevels of 0 takes the rest), so a streamer can upload the small mips before the full texture
+    HRESULT __cdecl CreateDDSTextureFromFileMapped( _In_ ID3D11Device* d3dDevice,
+                                                    _In_z_ const wchar_t* szFileName,
+                                                    _In_ size_t maxsize,
+                                                    _In_ size_t firstMip,
+                                                    _In_ size_t mipLevels,
+                                                    _In_ D3D11_USAGE usage,
+                                                    _In_ unsigned int bindFlags,
+                                                    _In_ unsigned int cpuAccessFlags,
+                                                    _In_ unsigned int miscFlags,
+                                                    _In_ bool forceSRGB,
+                                                    _Outptr_opt_ ID3D11Resource** texture,
+                                                    _Outptr_opt_ ID3D11ShaderResourceView** textureView,
+                                                    _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr
+                                                  );
 }
\ No newline at end of file
@@ -0,0 +1,560 @@
+//
+// The part of DirectXMath the portable modules use, for building them on Linux
+// XMVECTOR is an SSE register like the Windows SDK's, so code mixing DirectXMath with intrinsics builds unchanged
+// Conventions follow DirectXMath: row vectors, left handed projections, quaternions as x, y, z, w
+//
+
+#ifndef DIRECTXMATH_H
+#define DIRECTXMATH_H
+
+#include <cmath>
+#include <cstdint>
+#include <emmintrin.h>
+
+#define XM_CALLCONV
+
+namespace DirectX
+{
+
+const float XM_PI = 3.141592654f;
+const float XM_2PI = 6.283185307f;
+const float XM_1DIVPI = 0.318309886f;
+const float XM_1DIV2PI = 0.159154943f;
+const float XM_PIDIV2 = 1.570796327f;
+const float XM_PIDIV4 = 0.785398163f;
+
+inline float XMConvertToRadians(float degrees) { return degrees * (XM_PI / 180.0f); }
+inline float XMConvertToDegrees(float radians) { return radians * (180.0f / XM_PI); }
+
+///
+// Types
+///
+
+typedef __m128 XMVECTOR;
+typedef const XMVECTOR FXMVECTOR;
+typedef const XMVECTOR GXMVECTOR;
+typedef const XMVECTOR HXMVECTOR;
+typedef const XMVECTOR& CXMVECTOR;
+
+struct XMMATRIX
+{
+	XMVECTOR r[4];
+
+	XMMATRIX() {}
+	XMMATRIX(FXMVECTOR r0, FXMVECTOR r1, FXMVECTOR r2, FXMVECTOR r3) { r[0] = r0; r[1] = r1; r[2] = r2; r[3] = r3; }
+	XMMATRIX(float m00, float m01, float m02, float m03, float m10, float m11, float m12, float m13,
+		float m20, float m21, float m22, float m23, float m30, float m31, float m32, float m33)
+	{
+		r[0] = _mm_setr_ps(m00, m01, m02, m03);
+		r[1] = _mm_setr_ps(m10, m11, m12, m13);
+		r[2] = _mm_setr_ps(m20, m21, m22, m23);
+		r[3] = _mm_setr_ps(m30, m31, m32, m33);
+	}
+
+	XMMATRIX operator*(const XMMATRIX& m) const;
+	XMMATRIX& operator*=(const XMMATRIX& m) { *this = *this * m; return *this; }
+};
+typedef const XMMATRIX FXMMATRIX;
+typedef const XMMATRIX& CXMMATRIX;
+
+struct XMFLOAT2
+{
+	float x, y;
+	XMFLOAT2() {}
+	XMFLOAT2(float _x, float _y) : x(_x), y(_y) {}
+	explicit XMFLOAT2(const float* p) : x(p[0]), y(p[1]) {}
+};
+
+struct XMFLOAT3
+{
+	float x, y, z;
+	XMFLOAT3() {}
+	XMFLOAT3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+	explicit XMFLOAT3(const float* p) : x(p[0]), y(p[1]), z(p[2]) {}
+};
+
+struct XMFLOAT4
+{
+	float x, y, z, w;
+	XMFLOAT4() {}
+	XMFLOAT4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+	explicit XMFLOAT4(const float* p) : x(p[0]), y(p[1]), z(p[2]), w(p[3]) {}
+};
+
+struct XMFLOAT4X4
+{
+	union
+	{
+		struct
+		{
+			float _11, _12, _13, _14;
+			float _21, _22, _23, _24;
+			float _31, _32, _33, _34;
+			float _41, _42, _43, _44;
+		};
+		float m[4][4];
+	};
+
+	XMFLOAT4X4() {}
+	XMFLOAT4X4(float m00, float m01, float m02, float m03, float m10, float m11, float m12, float m13,
+		float m20, float m21, float m22, float m23, float m30, float m31, float m32, float m33) :
+		_11(m00), _12(m01), _13(m02), _14(m03), _21(m10), _22(m11), _23(m12), _24(m13),
+		_31(m20), _32(m21), _33(m22), _34(m23), _41(m30), _42(m31), _43(m32), _44(m33) {}
+	explicit XMFLOAT4X4(const float* p)
+	{
+		for (int i = 0; i < 16; i++)
+			m[i / 4][i % 4] = p[i];
+	}
+
+	float operator()(size_t row, size_t column) const { return m[row][column]; }
+	float& operator()(size_t row, size_t column) { return m[row][column]; }
+};
+
+///
+// Loads and stores
+///
+
+inline XMVECTOR XMLoadFloat2(const XMFLOAT2* p) { return _mm_setr_ps(p->x, p->y, 0.0f, 0.0f); }
+inline XMVECTOR XMLoadFloat3(const XMFLOAT3* p) { return _mm_setr_ps(p->x, p->y, p->z, 0.0f); }
+inline XMVECTOR XMLoadFloat4(const XMFLOAT4* p) { return _mm_loadu_ps(&p->x); }
+
+inline void XMStoreFloat2(XMFLOAT2* p, FXMVECTOR v)
+{
+	float f[4];
+	_mm_storeu_ps(f, v);
+	p->x = f[0];
+	p->y = f[1];
+}
+
+inline void XMStoreFloat3(XMFLOAT3* p, FXMVECTOR v)
+{
+	float f[4];
+	_mm_storeu_ps(f, v);
+	p->x = f[0];
+	p->y = f[1];
+	p->z = f[2];
+}
+
+inline void XMStoreFloat4(XMFLOAT4* p, FXMVECTOR v) { _mm_storeu_ps(&p->x, v); }
+
+inline XMMATRIX XMLoadFloat4x4(const XMFLOAT4X4* p)
+{
+	return XMMATRIX(_mm_loadu_ps(p->m[0]), _mm_loadu_ps(p->m[1]), _mm_loadu_ps(p->m[2]), _mm_loadu_ps(p->m[3]));
+}
+
+inline void XMStoreFloat4x4(XMFLOAT4X4* p, CXMMATRIX m)
+{
+	for (int i = 0; i < 4; i++)
+		_mm_storeu_ps(p->m[i], m.r[i]);
+}
+
+///
+// Vectors
+///
+
+inline XMVECTOR XMVectorSet(float x, float y, float z, float w) { return _mm_setr_ps(x, y, z, w); }
+inline XMVECTOR XMVectorReplicate(float value) { return _mm_set1_ps(value); }
+inline XMVECTOR XMVectorZero() { return _mm_setzero_ps(); }
+inline XMVECTOR XMVectorSplatOne() { return _mm_set1_ps(1.0f); }
+inline XMVECTOR XMVectorSplatX(FXMVECTOR v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)); }
+inline XMVECTOR XMVectorSplatY(FXMVECTOR v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)); }
+inline XMVECTOR XMVectorSplatZ(FXMVECTOR v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2)); }
+inline XMVECTOR XMVectorSplatW(FXMVECTOR v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)); }
+
+inline float XMVectorGetX(FXMVECTOR v) { return _mm_cvtss_f32(v); }
+inline float XMVectorGetY(FXMVECTOR v) { return _mm_cvtss_f32(XMVectorSplatY(v)); }
+inline float XMVectorGetZ(FXMVECTOR v) { return _mm_cvtss_f32(XMVectorSplatZ(v)); }
+inline float XMVectorGetW(FXMVECTOR v) { return _mm_cvtss_f32(XMVectorSplatW(v)); }
+
+inline XMVECTOR XMVectorSetW(FXMVECTOR v, float w)
+{
+	float f[4];
+	_mm_storeu_ps(f, v);
+	return _mm_setr_ps(f[0], f[1], f[2], w);
+}
+
+inline XMVECTOR XMVectorAdd(FXMVECTOR a, FXMVECTOR b) { return _mm_add_ps(a, b); }
+inline XMVECTOR XMVectorSubtract(FXMVECTOR a, FXMVECTOR b) { return _mm_sub_ps(a, b); }
+inline XMVECTOR XMVectorMultiply(FXMVECTOR a, FXMVECTOR b) { return _mm_mul_ps(a, b); }
+inline XMVECTOR XMVectorDivide(FXMVECTOR a, FXMVECTOR b) { return _mm_div_ps(a, b); }
+inline XMVECTOR XMVectorMultiplyAdd(FXMVECTOR a, FXMVECTOR b, FXMVECTOR c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+inline XMVECTOR XMVectorScale(FXMVECTOR v, float scale) { return _mm_mul_ps(v, _mm_set1_ps(scale)); }
+inline XMVECTOR XMVectorNegate(FXMVECTOR v) { return _mm_sub_ps(_mm_setzero_ps(), v); }
+inline XMVECTOR XMVectorMin(FXMVECTOR a, FXMVECTOR b) { return _mm_min_ps(a, b); }
+inline XMVECTOR XMVectorMax(FXMVECTOR a, FXMVECTOR b) { return _mm_max_ps(a, b); }
+inline XMVECTOR XMVectorAbs(FXMVECTOR v) { return _mm_max_ps(v, _mm_sub_ps(_mm_setzero_ps(), v)); }
+inline XMVECTOR XMVectorSqrt(FXMVECTOR v) { return _mm_sqrt_ps(v); }
+
+inline XMVECTOR XMVectorLerp(FXMVECTOR a, FXMVECTOR b, float t)
+{
+	return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), _mm_set1_ps(t)));
+}
+
+inline XMVECTOR XMVectorCatmullRom(FXMVECTOR p0, FXMVECTOR p1, FXMVECTOR p2, GXMVECTOR p3, float t)
+{
+	float t2 = t * t;
+	float t3 = t2 * t;
+	XMVECTOR w0 = _mm_set1_ps((-t3 + 2.0f * t2 - t) * 0.5f);
+	XMVECTOR w1 = _mm_set1_ps((3.0f * t3 - 5.0f * t2 + 2.0f) * 0.5f);
+	XMVECTOR w2 = _mm_set1_ps((-3.0f * t3 + 4.0f * t2 + t) * 0.5f);
+	XMVECTOR w3 = _mm_set1_ps((t3 - t2) * 0.5f);
+	return _mm_add_ps(_mm_add_ps(_mm_mul_ps(p0, w0), _mm_mul_ps(p1, w1)), _mm_add_ps(_mm_mul_ps(p2, w2), _mm_mul_ps(p3, w3)));
+}
+
+///
+// 3D and 4D vectors
+///
+
+inline XMVECTOR XMVector3Dot(FXMVECTOR a, FXMVECTOR b)
+{
+	float f[4], g[4];
+	_mm_storeu_ps(f, a);
+	_mm_storeu_ps(g, b);
+	return _mm_set1_ps(f[0] * g[0] + f[1] * g[1] + f[2] * g[2]);
+}
+
+inline XMVECTOR XMVector4Dot(FXMVECTOR a, FXMVECTOR b)
+{
+	float f[4], g[4];
+	_mm_storeu_ps(f, a);
+	_mm_storeu_ps(g, b);
+	return _mm_set1_ps(f[0] * g[0] + f[1] * g[1] + f[2] * g[2] + f[3] * g[3]);
+}
+
+inline XMVECTOR XMVector3LengthSq(FXMVECTOR v) { return XMVector3Dot(v, v); }
+inline XMVECTOR XMVector3Length(FXMVECTOR v) { return _mm_sqrt_ps(XMVector3Dot(v, v)); }
+inline XMVECTOR XMVector4Length(FXMVECTOR v) { return _mm_sqrt_ps(XMVector4Dot(v, v)); }
+
+inline XMVECTOR XMVector3Normalize(FXMVECTOR v)
+{
+	float length = XMVectorGetX(XMVector3Length(v));
+	return length > 0.0f ? _mm_div_ps(v, _mm_set1_ps(length)) : _mm_setzero_ps();
+}
+
+inline XMVECTOR XMVector4Normalize(FXMVECTOR v)
+{
+	float length = XMVectorGetX(XMVector4Length(v));
+	return length > 0.0f ? _mm_div_ps(v, _mm_set1_ps(length)) : _mm_setzero_ps();
+}
+
+inline XMVECTOR XMVector3Cross(FXMVECTOR a, FXMVECTOR b)
+{
+	float f[4], g[4];
+	_mm_storeu_ps(f, a);
+	_mm_storeu_ps(g, b);
+	return _mm_setr_ps(f[1] * g[2] - f[2] * g[1], f[2] * g[0] - f[0] * g[2], f[0] * g[1] - f[1] * g[0], 0.0f);
+}
+
+inline XMVECTOR XMVector4Transform(FXMVECTOR v, CXMMATRIX m)
+{
+	XMVECTOR result = _mm_mul_ps(XMVectorSplatX(v), m.r[0]);
+	result = _mm_add_ps(result, _mm_mul_ps(XMVectorSplatY(v), m.r[1]));
+	result = _mm_add_ps(result, _mm_mul_ps(XMVectorSplatZ(v), m.r[2]));
+	return _mm_add_ps(result, _mm_mul_ps(XMVectorSplatW(v), m.r[3]));
+}
+
+inline XMVECTOR XMVector3Transform(FXMVECTOR v, CXMMATRIX m)
+{
+	XMVECTOR result = _mm_mul_ps(XMVectorSplatX(v), m.r[0]);
+	result = _mm_add_ps(result, _mm_mul_ps(XMVectorSplatY(v), m.r[1]));
+	result = _mm_add_ps(result, _mm_mul_ps(XMVectorSplatZ(v), m.r[2]));
+	return _mm_add_ps(result, m.r[3]);
+}
+
+inline XMVECTOR XMVector3TransformCoord(FXMVECTOR v, CXMMATRIX m)
+{
+	XMVECTOR result = XMVector3Transform(v, m);
+	return _mm_div_ps(result, XMVectorSplatW(result));
+}
+
+inline XMVECTOR XMVector3TransformNormal(FXMVECTOR v, CXMMATRIX m)
+{
+	XMVECTOR result = _mm_mul_ps(XMVectorSplatX(v), m.r[0]);
+	result = _mm_add_ps(result, _mm_mul_ps(XMVectorSplatY(v), m.r[1]));
+	return _mm_add_ps(result, _mm_mul_ps(XMVectorSplatZ(v), m.r[2]));
+}
+
+///
+// Quaternions
+///
+
+inline XMVECTOR XMQuaternionIdentity() { return _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f); }
+inline XMVECTOR XMQuaternionNormalize(FXMVECTOR q) { return XMVector4Normalize(q); }
+
+/// <summary>Rotation by a then by b, as DirectXMath orders it
+/// </summary>
+inline XMVECTOR XMQuaternionMultiply(FXMVECTOR a, FXMVECTOR b)
+{
+	float p[4], q[4];
+	_mm_storeu_ps(p, a);
+	_mm_storeu_ps(q, b);
+	return _mm_setr_ps(
+		q[3] * p[0] + q[0] * p[3] + q[1] * p[2] - q[2] * p[1],
+		q[3] * p[1] - q[0] * p[2] + q[1] * p[3] + q[2] * p[0],
+		q[3] * p[2] + q[0] * p[1] - q[1] * p[0] + q[2] * p[3],
+		q[3] * p[3] - q[0] * p[0] - q[1] * p[1] - q[2] * p[2]);
+}
+
+inline XMVECTOR XMQuaternionRotationRollPitchYaw(float pitch, float yaw, float roll)
+{
+	float sp = std::sin(pitch * 0.5f), cp = std::cos(pitch * 0.5f);
+	float sy = std::sin(yaw * 0.5f), cy = std::cos(yaw * 0.5f);
+	float sr = std::sin(roll * 0.5f), cr = std::cos(roll * 0.5f);
+	return _mm_setr_ps(
+		sp * cy * cr + cp * sy * sr,
+		cp * sy * cr - sp * cy * sr,
+		cp * cy * sr - sp * sy * cr,
+		cp * cy * cr + sp * sy * sr);
+}
+
+inline XMVECTOR XMQuaternionRotationAxis(FXMVECTOR axis, float angle)
+{
+	XMVECTOR q = _mm_mul_ps(XMVector3Normalize(axis), _mm_set1_ps(std::sin(angle * 0.5f)));
+	return XMVectorSetW(q, std::cos(angle * 0.5f));
+}
+
+inline XMVECTOR XMQuaternionRotationMatrix(CXMMATRIX m)
+{
+	float r[4][4];
+	for (int i = 0; i < 4; i++)
+		_mm_storeu_ps(r[i], m.r[i]);
+
+	float trace = r[0][0] + r[1][1] + r[2][2];
+	if (trace > 0.0f)
+	{
+		float s = std::sqrt(trace + 1.0f) * 2.0f;
+		return _mm_setr_ps((r[1][2] - r[2][1]) / s, (r[2][0] - r[0][2]) / s, (r[0][1] - r[1][0]) / s, 0.25f * s);
+	}
+	if (r[0][0] > r[1][1] && r[0][0] > r[2][2])
+	{
+		float s = std::sqrt(1.0f + r[0][0] - r[1][1] - r[2][2]) * 2.0f;
+		return _mm_setr_ps(0.25f * s, (r[0][1] + r[1][0]) / s, (r[0][2] + r[2][0]) / s, (r[1][2] - r[2][1]) / s);
+	}
+	if (r[1][1] > r[2][2])
+	{
+		float s = std::sqrt(1.0f + r[1][1] - r[0][0] - r[2][2]) * 2.0f;
+		return _mm_setr_ps((r[0][1] + r[1][0]) / s, 0.25f * s, (r[1][2] + r[2][1]) / s, (r[2][0] - r[0][2]) / s);
+	}
+	float s = std::sqrt(1.0f + r[2][2] - r[0][0] - r[1][1]) * 2.0f;
+	return _mm_setr_ps((r[0][2] + r[2][0]) / s, (r[1][2] + r[2][1]) / s, 0.25f * s, (r[0][1] - r[1][0]) / s);
+}
+
+inline XMVECTOR XMQuaternionSlerp(FXMVECTOR q0, FXMVECTOR q1, float t)
+{
+	// Takes the short way round, and falls back to a lerp where the two are too close for sin to divide by
+	float cosOmega = XMVectorGetX(XMVector4Dot(q0, q1));
+	float sign = cosOmega < 0.0f ? -1.0f : 1.0f;
+	cosOmega *= sign;
+
+	float s0 = 1.0f - t;
+	float s1 = t;
+	if (cosOmega < 1.0f - 0.00001f)
+	{
+		float omega = std::acos(cosOmega);
+		float sinOmega = std::sin(omega);
+		s0 = std::sin(s0 * omega) / sinOmega;
+		s1 = std::sin(s1 * omega) / sinOmega;
+	}
+	return _mm_add_ps(_mm_mul_ps(q0, _mm_set1_ps(s0)), _mm_mul_ps(q1, _mm_set1_ps(s1 * sign)));
+}
+
+///
+// Matrices
+///
+
+inline XMMATRIX XMMatrixIdentity()
+{
+	return XMMATRIX(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+inline XMMATRIX XMMatrixMultiply(CXMMATRIX a, CXMMATRIX b)
+{
+	XMMATRIX result;
+	for (int i = 0; i < 4; i++)
+		result.r[i] = XMVector4Transform(a.r[i], b);
+	return result;
+}
+
+inline XMMATRIX XMMATRIX::operator*(const XMMATRIX& m) const { return XMMatrixMultiply(*this, m); }
+
+inline XMMATRIX XMMatrixTranspose(CXMMATRIX m)
+{
+	XMMATRIX result = m;
+	_MM_TRANSPOSE4_PS(result.r[0], result.r[1], result.r[2], result.r[3]);
+	return result;
+}
+
+inline XMVECTOR XMMatrixDeterminant(CXMMATRIX m)
+{
+	float a[4][4];
+	for (int i = 0; i < 4; i++)
+		_mm_storeu_ps(a[i], m.r[i]);
+
+	float s0 = a[2][2] * a[3][3] - a[2][3] * a[3][2];
+	float s1 = a[2][1] * a[3][3] - a[2][3] * a[3][1];
+	float s2 = a[2][1] * a[3][2] - a[2][2] * a[3][1];
+	float s3 = a[2][0] * a[3][3] - a[2][3] * a[3][0];
+	float s4 = a[2][0] * a[3][2] - a[2][2] * a[3][0];
+	float s5 = a[2][0] * a[3][1] - a[2][1] * a[3][0];
+	float determinant =
+		a[0][0] * (a[1][1] * s0 - a[1][2] * s1 + a[1][3] * s2) -
+		a[0][1] * (a[1][0] * s0 - a[1][2] * s3 + a[1][3] * s4) +
+		a[0][2] * (a[1][0] * s1 - a[1][1] * s3 + a[1][3] * s5) -
+		a[0][3] * (a[1][0] * s2 - a[1][1] * s4 + a[1][2] * s5);
+	return _mm_set1_ps(determinant);
+}
+
+inline XMMATRIX XMMatrixInverse(XMVECTOR* determinantOut, CXMMATRIX m)
+{
+	float a[16];
+	for (int i = 0; i < 4; i++)
+		_mm_storeu_ps(&a[i * 4], m.r[i]);
+
+	// Cofactors of every element, transposed into the adjugate
+	float inv[16];
+	inv[0] = a[5] * a[10] * a[15] - a[5] * a[11] * a[14] - a[9] * a[6] * a[15] + a[9] * a[7] * a[14] + a[13] * a[6] * a[11] - a[13] * a[7] * a[10];
+	inv[4] = -a[4] * a[10] * a[15] + a[4] * a[11] * a[14] + a[8] * a[6] * a[15] - a[8] * a[7] * a[14] - a[12] * a[6] * a[11] + a[12] * a[7] * a[10];
+	inv[8] = a[4] * a[9] * a[15] - a[4] * a[11] * a[13] - a[8] * a[5] * a[15] + a[8] * a[7] * a[13] + a[12] * a[5] * a[11] - a[12] * a[7] * a[9];
+	inv[12] = -a[4] * a[9] * a[14] + a[4] * a[10] * a[13] + a[8] * a[5] * a[14] - a[8] * a[6] * a[13] - a[12] * a[5] * a[10] + a[12] * a[6] * a[9];
+	inv[1] = -a[1] * a[10] * a[15] + a[1] * a[11] * a[14] + a[9] * a[2] * a[15] - a[9] * a[3] * a[14] - a[13] * a[2] * a[11] + a[13] * a[3] * a[10];
+	inv[5] = a[0] * a[10] * a[15] - a[0] * a[11] * a[14] - a[8] * a[2] * a[15] + a[8] * a[3] * a[14] + a[12] * a[2] * a[11] - a[12] * a[3] * a[10];
+	inv[9] = -a[0] * a[9] * a[15] + a[0] * a[11] * a[13] + a[8] * a[1] * a[15] - a[8] * a[3] * a[13] - a[12] * a[1] * a[11] + a[12] * a[3] * a[9];
+	inv[13] = a[0] * a[9] * a[14] - a[0] * a[10] * a[13] - a[8] * a[1] * a[14] + a[8] * a[2] * a[13] + a[12] * a[1] * a[10] - a[12] * a[2] * a[9];
+	inv[2] = a[1] * a[6] * a[15] - a[1] * a[7] * a[14] - a[5] * a[2] * a[15] + a[5] * a[3] * a[14] + a[13] * a[2] * a[7] - a[13] * a[3] * a[6];
+	inv[6] = -a[0] * a[6] * a[15] + a[0] * a[7] * a[14] + a[4] * a[2] * a[15] - a[4] * a[3] * a[14] - a[12] * a[2] * a[7] + a[12] * a[3] * a[6];
+	inv[10] = a[0] * a[5] * a[15] - a[0] * a[7] * a[13] - a[4] * a[1] * a[15] + a[4] * a[3] * a[13] + a[12] * a[1] * a[7] - a[12] * a[3] * a[5];
+	inv[14] = -a[0] * a[5] * a[14] + a[0] * a[6] * a[13] + a[4] * a[1] * a[14] - a[4] * a[2] * a[13] - a[12] * a[1] * a[6] + a[12] * a[2] * a[5];
+	inv[3] = -a[1] * a[6] * a[11] + a[1] * a[7] * a[10] + a[5] * a[2] * a[11] - a[5] * a[3] * a[10] - a[9] * a[2] * a[7] + a[9] * a[3] * a[6];
+	inv[7] = a[0] * a[6] * a[11] - a[0] * a[7] * a[10] - a[4] * a[2] * a[11] + a[4] * a[3] * a[10] + a[8] * a[2] * a[7] - a[8] * a[3] * a[6];
+	inv[11] = -a[0] * a[5] * a[11] + a[0] * a[7] * a[9] + a[4] * a[1] * a[11] - a[4] * a[3] * a[9] - a[8] * a[1] * a[7] + a[8] * a[3] * a[5];
+	inv[15] = a[0] * a[5] * a[10] - a[0] * a[6] * a[9] - a[4] * a[1] * a[10] + a[4] * a[2] * a[9] + a[8] * a[1] * a[6] - a[8] * a[2] * a[5];
+
+	float determinant = a[0] * inv[0] + a[1] * inv[4] + a[2] * inv[8] + a[3] * inv[12];
+	if (determinantOut)
+		*determinantOut = _mm_set1_ps(determinant);
+
+	XMVECTOR scale = _mm_set1_ps(1.0f / determinant);
+	XMMATRIX result;
+	for (int i = 0; i < 4; i++)
+		result.r[i] = _mm_mul_ps(_mm_loadu_ps(&inv[i * 4]), scale);
+	return result;
+}
+
+inline XMMATRIX XMMatrixScaling(float x, float y, float z)
+{
+	return XMMATRIX(x, 0.0f, 0.0f, 0.0f, 0.0f, y, 0.0f, 0.0f, 0.0f, 0.0f, z, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+inline XMMATRIX XMMatrixTranslation(float x, float y, float z)
+{
+	return XMMATRIX(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, x, y, z, 1.0f);
+}
+
+inline XMMATRIX XMMatrixScalingFromVector(FXMVECTOR v)
+{
+	return XMMatrixScaling(XMVectorGetX(v), XMVectorGetY(v), XMVectorGetZ(v));
+}
+
+inline XMMATRIX XMMatrixTranslationFromVector(FXMVECTOR v)
+{
+	return XMMatrixTranslation(XMVectorGetX(v), XMVectorGetY(v), XMVectorGetZ(v));
+}
+
+inline XMMATRIX XMMatrixRotationX(float angle)
+{
+	float s = std::sin(angle), c = std::cos(angle);
+	return XMMATRIX(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, c, s, 0.0f, 0.0f, -s, c, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+inline XMMATRIX XMMatrixRotationY(float angle)
+{
+	float s = std::sin(angle), c = std::cos(angle);
+	return XMMATRIX(c, 0.0f, -s, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, s, 0.0f, c, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+inline XMMATRIX XMMatrixRotationZ(float angle)
+{
+	float s = std::sin(angle), c = std::cos(angle);
+	return XMMATRIX(c, s, 0.0f, 0.0f, -s, c, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+inline XMMATRIX XMMatrixRotationQuaternion(FXMVECTOR quaternion)
+{
+	float q[4];
+	_mm_storeu_ps(q, quaternion);
+	float x = q[0], y = q[1], z = q[2], w = q[3];
+	return XMMATRIX(
+		1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + z * w), 2.0f * (x * z - y * w), 0.0f,
+		2.0f * (x * y - z * w), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + x * w), 0.0f,
+		2.0f * (x * z + y * w), 2.0f * (y * z - x * w), 1.0f - 2.0f * (x * x + y * y), 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+inline XMMATRIX XMMatrixRotationAxis(FXMVECTOR axis, float angle)
+{
+	return XMMatrixRotationQuaternion(XMQuaternionRotationAxis(axis, angle));
+}
+
+inline XMMATRIX XMMatrixRotationRollPitchYaw(float pitch, float yaw, float roll)
+{
+	return XMMatrixRotationQuaternion(XMQuaternionRotationRollPitchYaw(pitch, yaw, roll));
+}
+
+inline XMMATRIX XMMatrixLookToLH(FXMVECTOR eye, FXMVECTOR direction, FXMVECTOR up)
+{
+	XMVECTOR r2 = XMVector3Normalize(direction);
+	XMVECTOR r0 = XMVector3Normalize(XMVector3Cross(up, r2));
+	XMVECTOR r1 = XMVector3Cross(r2, r0);
+	XMVECTOR negEye = XMVectorNegate(eye);
+	XMMATRIX view(XMVectorSetW(r0, XMVectorGetX(XMVector3Dot(r0, negEye))), XMVectorSetW(r1, XMVectorGetX(XMVector3Dot(r1, negEye))),
+		XMVectorSetW(r2, XMVectorGetX(XMVector3Dot(r2, negEye))), XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f));
+	return XMMatrixTranspose(view);
+}
+
+inline XMMATRIX XMMatrixLookAtLH(FXMVECTOR eye, FXMVECTOR focus, FXMVECTOR up)
+{
+	return XMMatrixLookToLH(eye, _mm_sub_ps(focus, eye), up);
+}
+
+inline XMMATRIX XMMatrixPerspectiveFovLH(float fovAngleY, float aspectRatio, float nearZ, float farZ)
+{
+	float height = std::cos(fovAngleY * 0.5f) / std::sin(fovAngleY * 0.5f);
+	float width = height / aspectRatio;
+	float range = farZ / (farZ - nearZ);
+	return XMMATRIX(width, 0.0f, 0.0f, 0.0f, 0.0f, height, 0.0f, 0.0f, 0.0f, 0.0f, range, 1.0f, 0.0f, 0.0f, -range * nearZ, 0.0f);
+}
+
+inline XMMATRIX XMMatrixOrthographicLH(float viewWidth, float viewHeight, float nearZ, float farZ)
+{
+	float range = 1.0f / (farZ - nearZ);
+	return XMMATRIX(2.0f / viewWidth, 0.0f, 0.0f, 0.0f, 0.0f, 2.0f / viewHeight, 0.0f, 0.0f, 0.0f, 0.0f, range, 0.0f,
+		0.0f, 0.0f, -range * nearZ, 1.0f);
+}
+
+/// <summary>Splits a scale, rotate, translate matrix back apart. A mirrored matrix comes back with a negative x scale
+/// </summary>
+inline bool XMMatrixDecompose(XMVECTOR* outScale, XMVECTOR* outRotation, XMVECTOR* outTranslation, CXMMATRIX m)
+{
+	*outTranslation = m.r[3];
+	float scale[3];
+	XMMATRIX rotation = XMMatrixIdentity();
+	for (int i = 0; i < 3; i++)
+	{
+		scale[i] = XMVectorGetX(XMVector3Length(m.r[i]));
+		if (scale[i] == 0.0f)
+			return false;
+		rotation.r[i] = XMVectorSetW(_mm_div_ps(m.r[i], _mm_set1_ps(scale[i])), 0.0f);
+	}
+	if (XMVectorGetX(XMMatrixDeterminant(rotation)) < 0.0f)
+	{
+		scale[0] = -scale[0];
+		rotation.r[0] = XMVectorNegate(rotation.r[0]);
+	}
+	*outScale = _mm_setr_ps(scale[0], scale[1], scale[2], 0.0f);
+	*outRotation = XMQuaternionRotationMatrix(rotation);
+	return true;
+}
+
+}
+
+#endif
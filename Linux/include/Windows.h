@@ -0,0 +1,138 @@
+//
+// The part of Windows.h the portable modules use, for building them on Linux
+// Integer types keep their Windows sizes, LONG and DWORD are 32 bits. The code is written against Windows.h's min and
+// max macros, so the standard headers that would break under them are included first
+//
+
+#ifndef WINDOWS_H
+#define WINDOWS_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <strings.h>
+#include <time.h>
+#include <x86intrin.h>
+
+#include <sal.h>
+
+typedef unsigned char BYTE;
+typedef BYTE byte;
+typedef unsigned short USHORT;
+typedef unsigned short WORD;
+typedef int INT;
+typedef unsigned int UINT;
+typedef int LONG;
+typedef unsigned int ULONG;
+typedef unsigned int DWORD;
+typedef int BOOL;
+typedef float FLOAT;
+typedef int64_t INT64;
+typedef uint64_t UINT64;
+typedef uint8_t UINT8;
+typedef size_t SIZE_T;
+typedef int32_t HRESULT;
+typedef char CHAR;
+typedef wchar_t WCHAR;
+typedef const char* LPCSTR;
+typedef const wchar_t* LPCWSTR;
+typedef void* HANDLE;
+
+union LARGE_INTEGER
+{
+	struct
+	{
+		DWORD LowPart;
+		LONG HighPart;
+	};
+	INT64 QuadPart;
+};
+
+#define WINAPI
+#define STDMETHODCALLTYPE
+
+struct GUID
+{
+	DWORD Data1;
+	WORD Data2;
+	WORD Data3;
+	BYTE Data4[8];
+};
+typedef const GUID& REFGUID;
+typedef const GUID& REFIID;
+
+inline bool operator==(const GUID& a, const GUID& b) { return memcmp(&a, &b, sizeof(GUID)) == 0; }
+inline bool operator!=(const GUID& a, const GUID& b) { return !(a == b); }
+
+// selectany is the only one the shared headers use, it lets each translation unit define the same constant
+#define __declspec(attribute) __attribute__((weak))
+#define FALSE 0
+#define TRUE 1
+
+#define S_OK ((HRESULT)0)
+#define S_FALSE ((HRESULT)1)
+#define E_NOTIMPL ((HRESULT)0x80004001L)
+#define E_FAIL ((HRESULT)0x80004005L)
+#define E_OUTOFMEMORY ((HRESULT)0x8007000EL)
+#define E_INVALIDARG ((HRESULT)0x80070057L)
+#define E_NOINTERFACE ((HRESULT)0x80004002L)
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+
+#define ZeroMemory(destination, length) memset((destination), 0, (length))
+#define ARRAYSIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+#ifndef NOMINMAX
+#define min(a, b) (((a) < (b)) ? (a) : (b))
+#define max(a, b) (((a) > (b)) ? (a) : (b))
+#endif
+
+#define _stricmp strcasecmp
+
+inline LONG InterlockedIncrement(volatile LONG* value) { return __sync_add_and_fetch(value, 1); }
+inline LONG InterlockedDecrement(volatile LONG* value) { return __sync_sub_and_fetch(value, 1); }
+
+/// <summary>Debug output goes to stderr, there is no debugger to send it to
+/// </summary>
+inline void OutputDebugStringA(const char* text) { fputs(text, stderr); }
+
+inline BOOL QueryPerformanceFrequency(LARGE_INTEGER* frequency)
+{
+	frequency->QuadPart = 1000000000;
+	return TRUE;
+}
+
+inline BOOL QueryPerformanceCounter(LARGE_INTEGER* counter)
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	counter->QuadPart = (INT64)now.tv_sec * 1000000000 + now.tv_nsec;
+	return TRUE;
+}
+
+#endif
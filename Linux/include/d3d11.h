@@ -0,0 +1,170 @@
+//
+// The COM interfaces the portable modules pass around without calling into Direct3D, for building them on Linux
+// Nothing here talks to a device, tests implement these to stand in for a device and its objects
+//
+
+#ifndef D3D11_H
+#define D3D11_H
+
+#include <Windows.h>
+#include <dxgiformat.h>
+
+// __uuidof only ever names IUnknown in the portable modules
+static const GUID IID_IUnknown = { 0x00000000, 0x0000, 0x0000, { 0xc0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46 } };
+#define __uuidof(type) IID_##type
+
+struct IUnknown
+{
+	virtual HRESULT QueryInterface(REFIID, void** object)
+	{
+		*object = NULL;
+		return E_NOINTERFACE;
+	}
+	virtual ULONG AddRef() = 0;
+	virtual ULONG Release() = 0;
+protected:
+	virtual ~IUnknown() {}
+};
+
+enum D3D11_BIND_FLAG
+{
+	D3D11_BIND_VERTEX_BUFFER = 0x1,
+	D3D11_BIND_INDEX_BUFFER = 0x2,
+	D3D11_BIND_CONSTANT_BUFFER = 0x4,
+	D3D11_BIND_SHADER_RESOURCE = 0x8,
+	D3D11_BIND_STREAM_OUTPUT = 0x10,
+	D3D11_BIND_RENDER_TARGET = 0x20,
+	D3D11_BIND_DEPTH_STENCIL = 0x40,
+	D3D11_BIND_UNORDERED_ACCESS = 0x80
+};
+
+enum D3D11_USAGE
+{
+	D3D11_USAGE_DEFAULT,
+	D3D11_USAGE_IMMUTABLE,
+	D3D11_USAGE_DYNAMIC,
+	D3D11_USAGE_STAGING
+};
+
+enum D3D11_CPU_ACCESS_FLAG
+{
+	D3D11_CPU_ACCESS_WRITE = 0x10000,
+	D3D11_CPU_ACCESS_READ = 0x20000
+};
+
+enum D3D11_MAP
+{
+	D3D11_MAP_READ = 1,
+	D3D11_MAP_WRITE = 2,
+	D3D11_MAP_READ_WRITE = 3,
+	D3D11_MAP_WRITE_DISCARD = 4,
+	D3D11_MAP_WRITE_NO_OVERWRITE = 5
+};
+
+enum D3D11_RESOURCE_DIMENSION
+{
+	D3D11_RESOURCE_DIMENSION_UNKNOWN,
+	D3D11_RESOURCE_DIMENSION_BUFFER,
+	D3D11_RESOURCE_DIMENSION_TEXTURE1D,
+	D3D11_RESOURCE_DIMENSION_TEXTURE2D,
+	D3D11_RESOURCE_DIMENSION_TEXTURE3D
+};
+
+struct DXGI_SAMPLE_DESC
+{
+	UINT Count;
+	UINT Quality;
+};
+
+struct D3D11_BUFFER_DESC
+{
+	UINT ByteWidth;
+	D3D11_USAGE Usage;
+	UINT BindFlags;
+	UINT CPUAccessFlags;
+	UINT MiscFlags;
+	UINT StructureByteStride;
+};
+
+struct D3D11_TEXTURE2D_DESC
+{
+	UINT Width;
+	UINT Height;
+	UINT MipLevels;
+	UINT ArraySize;
+	DXGI_FORMAT Format;
+	DXGI_SAMPLE_DESC SampleDesc;
+	D3D11_USAGE Usage;
+	UINT BindFlags;
+	UINT CPUAccessFlags;
+	UINT MiscFlags;
+};
+
+struct D3D11_SUBRESOURCE_DATA
+{
+	const void* pSysMem;
+	UINT SysMemPitch;
+	UINT SysMemSlicePitch;
+};
+
+struct D3D11_MAPPED_SUBRESOURCE
+{
+	void* pData;
+	UINT RowPitch;
+	UINT DepthPitch;
+};
+
+// Views are only described to the device, which the fakes don't look at
+struct D3D11_SHADER_RESOURCE_VIEW_DESC;
+struct D3D11_RENDER_TARGET_VIEW_DESC;
+struct D3D11_DEPTH_STENCIL_VIEW_DESC;
+
+struct ID3D11DeviceChild : IUnknown
+{
+	/// <summary>The object holds a reference to data until it is destroyed or data is replaced
+	/// </summary>
+	virtual HRESULT SetPrivateDataInterface(REFGUID, const IUnknown*) { return E_NOTIMPL; }
+};
+
+struct ID3D11Resource : ID3D11DeviceChild
+{
+	virtual void GetType(D3D11_RESOURCE_DIMENSION* dimension) = 0;
+};
+
+struct ID3D11Buffer : ID3D11Resource
+{
+	virtual void GetDesc(D3D11_BUFFER_DESC* desc) = 0;
+};
+
+struct ID3D11Texture2D : ID3D11Resource
+{
+	virtual void GetDesc(D3D11_TEXTURE2D_DESC* desc) = 0;
+};
+
+struct ID3D11View : ID3D11DeviceChild {};
+struct ID3D11ShaderResourceView : ID3D11View {};
+struct ID3D11RenderTargetView : ID3D11View {};
+struct ID3D11DepthStencilView : ID3D11View {};
+
+struct ID3D11Device : IUnknown
+{
+	virtual HRESULT CreateBuffer(const D3D11_BUFFER_DESC* desc, const D3D11_SUBRESOURCE_DATA* data, ID3D11Buffer** buffer) = 0;
+	virtual HRESULT CreateTexture2D(const D3D11_TEXTURE2D_DESC* desc, const D3D11_SUBRESOURCE_DATA* data,
+		ID3D11Texture2D** texture) = 0;
+	virtual HRESULT CreateShaderResourceView(ID3D11Resource* resource, const D3D11_SHADER_RESOURCE_VIEW_DESC* desc,
+		ID3D11ShaderResourceView** view) = 0;
+	virtual HRESULT CreateRenderTargetView(ID3D11Resource* resource, const D3D11_RENDER_TARGET_VIEW_DESC* desc,
+		ID3D11RenderTargetView** view) = 0;
+	virtual HRESULT CreateDepthStencilView(ID3D11Resource* resource, const D3D11_DEPTH_STENCIL_VIEW_DESC* desc,
+		ID3D11DepthStencilView** view) = 0;
+};
+
+/// <summary>Only mapping is stood in for, fakes hand out memory of their own
+/// </summary>
+struct ID3D11DeviceContext : ID3D11DeviceChild
+{
+	virtual HRESULT Map(ID3D11Resource* resource, UINT subresource, D3D11_MAP type, UINT flags, D3D11_MAPPED_SUBRESOURCE* mapped) = 0;
+	virtual void Unmap(ID3D11Resource* resource, UINT subresource) = 0;
+};
+
+#endif
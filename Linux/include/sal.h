@@ -0,0 +1,20 @@
+//
+// The source annotations DirectXTK's headers use, all of them empty outside MSVC's analyzer
+//
+
+#ifndef SAL_H
+#define SAL_H
+
+#define _In_
+#define _In_z_
+#define _In_opt_
+#define _In_reads_(size)
+#define _In_reads_bytes_(size)
+#define _Out_
+#define _Out_opt_
+#define _Outptr_
+#define _Out_writes_(size)
+#define _Out_writes_bytes_(size)
+#define _Inout_
+
+#endif
@@ -0,0 +1,399 @@
+//
+// Compressed animation clips
+//
+
+#include "AnimationClip.h"
+#include <algorithm>
+#include <cmath>
+#include <emmintrin.h>
+
+// Smallest three components of a unit quaternion lie within +-1/sqrt(2), spread over 15 bits
+static const float RotationRange = 0.70710678f;
+static const float RotationStep = 2.0f * RotationRange / 32767.0f;
+
+// Longest clip whose frames still fit a USHORT
+static const UINT MaxClipFrames = 65535;
+
+AnimationClip::AnimationClip() :
+duration(0.0f),
+frameRate(30.0f),
+frameCount(1),
+jointCount(0)
+{
+	ZeroMemory(&stats, sizeof(stats));
+}
+
+const std::string& AnimationClip::GetName() const { return name; }
+float AnimationClip::GetDuration() const { return duration; }
+UINT AnimationClip::GetJointCount() const { return jointCount; }
+const ClipCompressionStats& AnimationClip::GetStats() const { return stats; }
+
+///
+// Compression
+///
+void AnimationClip::Compress(const RawClip& raw, const Skeleton& skeleton, const ClipCompression& settings)
+{
+	name = raw.name;
+	duration = max(raw.duration, 0.0f);
+	frameRate = settings.frameRate;
+	frameCount = min((UINT)std::ceil(duration * frameRate) + 1, MaxClipFrames);
+	jointCount = skeleton.GetJointCount();
+	channels.clear();
+	frames.clear();
+	values.clear();
+	ZeroMemory(&stats, sizeof(stats));
+
+	// Joints with long chains below them swing the ends of those further for the same rotation error, so their
+	// tolerance shrinks until the farthest joint below moves no more than the translation tolerance
+	std::vector<float> reach(jointCount, 0.0f);
+	for (UINT i = jointCount; i-- > 0;)
+	{
+		int parent = skeleton.parents[i];
+		if (parent >= 0)
+			reach[parent] = max(reach[parent], reach[i] + XMVectorGetX(XMVector3Length(XMLoadFloat3(&skeleton.bindPose[i].translation))));
+	}
+
+	static const std::vector<float> noTimes;
+	for (UINT type = 0; type < ChannelTypeCount; type++)
+	{
+		for (UINT i = 0; i < jointCount; i++)
+		{
+			const RawTrack* track = i < raw.tracks.size() ? &raw.tracks[i] : NULL;
+			const JointTransform& bind = skeleton.bindPose[i];
+			if (type == ChannelRotation)
+			{
+				// A quaternion component off by e turns the joint by about 2e radians
+				float tolerance = settings.rotationTolerance;
+				if (reach[i] > 0.0f)
+					tolerance = min(tolerance, settings.translationTolerance / (2.0f * reach[i]));
+				bool keyed = track && !track->rotations.empty();
+				AddChannel(keyed ? track->rotationTimes : noTimes, keyed ? &track->rotations[0].x : NULL, 4, &bind.rotation.x, tolerance);
+			}
+			else if (type == ChannelTranslation)
+			{
+				bool keyed = track && !track->translations.empty();
+				AddChannel(keyed ? track->translationTimes : noTimes, keyed ? &track->translations[0].x : NULL, 3, &bind.translation.x,
+					settings.translationTolerance);
+			}
+			else
+			{
+				bool keyed = track && !track->scales.empty();
+				AddChannel(keyed ? track->scaleTimes : noTimes, keyed ? &track->scales[0].x : NULL, 3, &bind.scale.x, settings.scaleTolerance);
+			}
+		}
+	}
+	stats.bytes = (UINT)(channels.size() * sizeof(Channel) + frames.size() * sizeof(USHORT) + values.size() * sizeof(USHORT));
+}
+
+/// <summary>Interpolates between two keys of components floats, renormalizing rotations
+/// </summary>
+static void Interpolate(const float* a, const float* b, float t, UINT components, float* out)
+{
+	for (UINT k = 0; k < components; k++)
+		out[k] = a[k] + (b[k] - a[k]) * t;
+	if (components == 4)
+	{
+		float length = std::sqrt(out[0] * out[0] + out[1] * out[1] + out[2] * out[2] + out[3] * out[3]);
+		for (UINT k = 0; k < 4; k++)
+			out[k] /= length;
+	}
+}
+
+static bool WithinTolerance(const float* a, const float* b, UINT components, float tolerance)
+{
+	for (UINT k = 0; k < components; k++)
+	{
+		if (std::fabs(a[k] - b[k]) > tolerance)
+			return false;
+	}
+	return true;
+}
+
+void AnimationClip::AddChannel(const std::vector<float>& times, const float* source, UINT components, const float* bindValue, float tolerance)
+{
+
+	///
+	// Resample at the clip's rate
+	// Rotations are kept on one side of the 4D sphere so neighbouring keys always interpolate the short way round
+	///
+	std::vector<float> samples(frameCount * components);
+	for (UINT f = 0; f < frameCount; f++)
+	{
+		float* sample = &samples[f * components];
+		if (times.empty())
+		{
+			std::copy(bindValue, bindValue + components, sample);
+		}
+		else
+		{
+			float time = min((float)f / frameRate, duration);
+			size_t next = std::upper_bound(times.begin(), times.end(), time) - times.begin();
+			if (next == 0 || next == times.size())
+			{
+				const float* key = &source[(next == 0 ? 0 : next - 1) * components];
+				std::copy(key, key + components, sample);
+			}
+			else
+			{
+				const float* a = &source[(next - 1) * components];
+				float b[4];
+				std::copy(&source[next * components], &source[next * components] + components, b);
+				if (components == 4 && a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3] < 0.0f)
+				{
+					for (UINT k = 0; k < 4; k++)
+						b[k] = -b[k];
+				}
+				float span = times[next] - times[next - 1];
+				Interpolate(a, b, span > 0.0f ? (time - times[next - 1]) / span : 0.0f, components, sample);
+			}
+		}
+		if (components == 4 && f > 0)
+		{
+			const float* previous = sample - 4;
+			if (previous[0] * sample[0] + previous[1] * sample[1] + previous[2] * sample[2] + previous[3] * sample[3] < 0.0f)
+			{
+				for (UINT k = 0; k < 4; k++)
+					sample[k] = -sample[k];
+			}
+		}
+	}
+
+	///
+	// Key reduction
+	// A key is only kept once the line from the last kept key can no longer reach every frame up to the one after it
+	///
+	std::vector<UINT> kept(1, 0);
+	bool constant = true;
+	for (UINT f = 1; f < frameCount && constant; f++)
+		constant = WithinTolerance(&samples[f * components], &samples[0], components, tolerance);
+	if (!constant)
+	{
+		UINT start = 0;
+		for (UINT end = 2; end < frameCount; end++)
+		{
+			bool fits = true;
+			for (UINT f = start + 1; f < end && fits; f++)
+			{
+				float line[4];
+				Interpolate(&samples[start * components], &samples[end * components], (float)(f - start) / (float)(end - start), components, line);
+				fits = WithinTolerance(line, &samples[f * components], components, tolerance);
+			}
+			if (!fits)
+			{
+				kept.push_back(end - 1);
+				start = end - 1;
+			}
+		}
+		kept.push_back(frameCount - 1);
+	}
+
+	///
+	// Quantization
+	///
+	Channel channel;
+	channel.firstKey = (UINT)frames.size();
+	channel.keyCount = (UINT)kept.size();
+	for (UINT k = 0; k < 3; k++)
+	{
+		channel.minimum[k] = 0.0f;
+		channel.extent[k] = 0.0f;
+	}
+	if (components == 3)
+	{
+		for (UINT k = 0; k < 3; k++)
+		{
+			float low = samples[kept[0] * 3 + k];
+			float high = low;
+			for (UINT key : kept)
+			{
+				low = min(low, samples[key * 3 + k]);
+				high = max(high, samples[key * 3 + k]);
+			}
+			channel.minimum[k] = low;
+			channel.extent[k] = high - low;
+		}
+	}
+	for (UINT key : kept)
+	{
+		const float* sample = &samples[key * components];
+		frames.push_back((USHORT)key);
+		USHORT quantized[3];
+		if (components == 4)
+		{
+			QuantizeRotation(XMFLOAT4(sample[0], sample[1], sample[2], sample[3]), quantized);
+		}
+		else
+		{
+			for (UINT k = 0; k < 3; k++)
+			{
+				float unit = channel.extent[k] > 0.0f ? (sample[k] - channel.minimum[k]) / channel.extent[k] : 0.0f;
+				quantized[k] = (USHORT)min(max(unit * 65535.0f + 0.5f, 0.0f), 65535.0f);
+			}
+		}
+		values.insert(values.end(), quantized, quantized + 3);
+	}
+	channels.push_back(channel);
+
+	stats.rawKeys += frameCount;
+	stats.keptKeys += channel.keyCount;
+	stats.constantChannels += constant ? 1 : 0;
+	stats.rawBytes += frameCount * components * sizeof(float);
+}
+
+void AnimationClip::QuantizeRotation(XMFLOAT4 rotation, USHORT* out)
+{
+	float q[4] = { rotation.x, rotation.y, rotation.z, rotation.w };
+	float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+	UINT largest = 0;
+	for (UINT k = 0; k < 4; k++)
+	{
+		q[k] /= length;
+		if (std::fabs(q[k]) > std::fabs(q[largest]))
+			largest = k;
+	}
+
+	// The largest component is rebuilt from the others, flipping the quaternion makes its sign always positive
+	float sign = q[largest] < 0.0f ? -1.0f : 1.0f;
+	UINT written = 0;
+	for (UINT k = 0; k < 4; k++)
+	{
+		if (k == largest)
+			continue;
+		float unit = (q[k] * sign + RotationRange) / RotationStep;
+		out[written++] = (USHORT)min(max(unit + 0.5f, 0.0f), 32767.0f);
+	}
+
+	// Two top bits say which component was left out
+	out[0] |= (largest & 1) << 15;
+	out[1] |= (largest >> 1) << 15;
+}
+
+///
+// Sampling
+///
+void AnimationClip::FindKeys(const Channel& channel, float frame, UINT& key, UINT& next, float& t) const
+{
+	key = next = channel.firstKey;
+	t = 0.0f;
+	if (channel.keyCount == 1)
+		return;
+	const USHORT* first = &frames[channel.firstKey];
+	size_t after = std::upper_bound(first, first + channel.keyCount, frame) - first;
+	if (after >= channel.keyCount)
+	{
+		key = next = channel.firstKey + channel.keyCount - 1;
+		return;
+	}
+	key = channel.firstKey + (UINT)max(after, (size_t)1) - 1;
+	next = key + 1;
+	t = (frame - frames[key]) / (float)(frames[next] - frames[key]);
+}
+
+/// <summary>Component k of four keys, one per lane
+/// </summary>
+static inline __m128i GatherKeys(const std::vector<USHORT>& values, const UINT* keys, UINT k)
+{
+	return _mm_setr_epi32(values[keys[0] * 3 + k], values[keys[1] * 3 + k], values[keys[2] * 3 + k], values[keys[3] * 3 + k]);
+}
+
+static inline __m128 Select(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+/// <summary>Rebuilds four smallest three quaternions, one per lane
+/// </summary>
+static void DecodeRotations(__m128i q0, __m128i q1, __m128i q2, __m128& x, __m128& y, __m128& z, __m128& w)
+{
+	__m128i bits = _mm_set1_epi32(0x7FFF);
+	__m128 step = _mm_set1_ps(RotationStep);
+	__m128 range = _mm_set1_ps(RotationRange);
+	__m128 a = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(q0, bits)), step), range);
+	__m128 b = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(q1, bits)), step), range);
+	__m128 c = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(q2, bits)), step), range);
+	__m128 rest = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, a), _mm_mul_ps(b, b)), _mm_mul_ps(c, c));
+	__m128 d = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(1.0f), rest), _mm_setzero_ps()));
+
+	__m128i largest = _mm_or_si128(_mm_srli_epi32(q0, 15), _mm_slli_epi32(_mm_srli_epi32(q1, 15), 1));
+	__m128 is0 = _mm_castsi128_ps(_mm_cmpeq_epi32(largest, _mm_setzero_si128()));
+	__m128 is1 = _mm_castsi128_ps(_mm_cmpeq_epi32(largest, _mm_set1_epi32(1)));
+	__m128 is2 = _mm_castsi128_ps(_mm_cmpeq_epi32(largest, _mm_set1_epi32(2)));
+	__m128 is3 = _mm_castsi128_ps(_mm_cmpeq_epi32(largest, _mm_set1_epi32(3)));
+	x = Select(is0, d, a);
+	y = Select(is0, a, Select(is1, d, b));
+	z = Select(_mm_or_ps(is0, is1), b, Select(is2, d, c));
+	w = Select(is3, d, c);
+}
+
+void AnimationClip::Sample(float time, Pose& pose) const
+{
+	if (pose.GetJointCount() != jointCount)
+		pose.Resize(jointCount);
+	if (jointCount == 0)
+		return;
+
+	float frame = 0.0f;
+	if (duration > 0.0f)
+	{
+		time = std::fmod(time, duration);
+		if (time < 0.0f)
+			time += duration;
+		frame = min(time * frameRate, (float)(frameCount - 1));
+	}
+
+	// Keys of four joints at a time gathered into lanes, joints past the end repeat the last one
+	// Lanes are built from scalars in registers, storing them to memory and reading them back as a vector stalls
+	const Channel* lanes[4];
+	UINT key[4];
+	UINT next[4];
+	float t[4];
+	for (UINT type = 0; type < ChannelTypeCount; type++)
+	{
+		PoseStream firstStream = type == ChannelRotation ? PoseRotationX : type == ChannelTranslation ? PoseTranslationX : PoseScaleX;
+		float* out[4] = { pose.GetStream(firstStream), pose.GetStream((PoseStream)(firstStream + 1)), pose.GetStream((PoseStream)(firstStream + 2)),
+			type == ChannelRotation ? pose.GetStream(PoseRotationW) : NULL };
+		const Channel* typeChannels = &channels[type * jointCount];
+		for (UINT i = 0; i < jointCount; i += 4)
+		{
+			for (UINT lane = 0; lane < 4; lane++)
+			{
+				lanes[lane] = &typeChannels[min(i + lane, jointCount - 1)];
+				FindKeys(*lanes[lane], frame, key[lane], next[lane], t[lane]);
+			}
+
+			__m128 weight = _mm_setr_ps(t[0], t[1], t[2], t[3]);
+			if (type == ChannelRotation)
+			{
+				__m128 ax, ay, az, aw, bx, by, bz, bw;
+				DecodeRotations(GatherKeys(values, key, 0), GatherKeys(values, key, 1), GatherKeys(values, key, 2), ax, ay, az, aw);
+				DecodeRotations(GatherKeys(values, next, 0), GatherKeys(values, next, 1), GatherKeys(values, next, 2), bx, by, bz, bw);
+
+				// Quantizing may have flipped either key to the other side of the sphere
+				__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+				__m128 flip = _mm_and_ps(_mm_cmplt_ps(dot, _mm_setzero_ps()), _mm_set1_ps(-0.0f));
+				__m128 x = _mm_add_ps(ax, _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(bx, flip), ax), weight));
+				__m128 y = _mm_add_ps(ay, _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(by, flip), ay), weight));
+				__m128 z = _mm_add_ps(az, _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(bz, flip), az), weight));
+				__m128 w = _mm_add_ps(aw, _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(bw, flip), aw), weight));
+				__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w))));
+				_mm_storeu_ps(out[0] + i, _mm_div_ps(x, length));
+				_mm_storeu_ps(out[1] + i, _mm_div_ps(y, length));
+				_mm_storeu_ps(out[2] + i, _mm_div_ps(z, length));
+				_mm_storeu_ps(out[3] + i, _mm_div_ps(w, length));
+			}
+			else
+			{
+				__m128 unit = _mm_set1_ps(1.0f / 65535.0f);
+				for (UINT k = 0; k < 3; k++)
+				{
+					__m128 a = _mm_cvtepi32_ps(GatherKeys(values, key, k));
+					__m128 b = _mm_cvtepi32_ps(GatherKeys(values, next, k));
+					__m128 units = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), weight));
+					__m128 minimum = _mm_setr_ps(lanes[0]->minimum[k], lanes[1]->minimum[k], lanes[2]->minimum[k], lanes[3]->minimum[k]);
+					__m128 step = _mm_mul_ps(_mm_setr_ps(lanes[0]->extent[k], lanes[1]->extent[k], lanes[2]->extent[k], lanes[3]->extent[k]), unit);
+					_mm_storeu_ps(out[k] + i, _mm_add_ps(minimum, _mm_mul_ps(units, step)));
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,119 @@
+//
+// Compressed animation clips
+// Tracks are resampled to a fixed rate, every key a straight line through its neighbours can stand in for is dropped,
+// and what's left is quantized: rotations to 48 bit smallest three quaternions, translations and scales to 16 bits per
+// component across the channel's own range. Sampling decodes and interpolates four joints at a time into a Pose
+//
+
+#ifndef ANIMATIONCLIP_H
+#define ANIMATIONCLIP_H
+
+#include <string>
+#include <vector>
+#include "Skinning.h"
+
+/// <summary>Keys of one joint as imported, times in seconds. Empty channels hold the bind pose
+/// </summary>
+struct RawTrack
+{
+	std::vector<float> rotationTimes;
+	std::vector<XMFLOAT4> rotations;
+	std::vector<float> translationTimes;
+	std::vector<XMFLOAT3> translations;
+	std::vector<float> scaleTimes;
+	std::vector<XMFLOAT3> scales;
+};
+
+/// <summary>Uncompressed clip with a track for every joint of its skeleton
+/// </summary>
+struct RawClip
+{
+	std::string name;
+	float duration;		// Seconds
+	std::vector<RawTrack> tracks;
+};
+
+/// <summary>How far compression may stray from the raw tracks
+/// </summary>
+struct ClipCompression
+{
+	ClipCompression() :
+	frameRate(30.0f),
+	rotationTolerance(0.002f),
+	translationTolerance(0.001f),
+	scaleTolerance(0.001f)
+	{
+
+	}
+
+	float frameRate;			// Keys are only ever kept on frames of this rate
+	float rotationTolerance;	// Largest difference of any quaternion component, less for joints with long chains below them
+	float translationTolerance;	// In the skeleton's units, also how far a rotation error may move the joints below
+	float scaleTolerance;
+};
+
+/// <summary>Sizes before and after compressing a clip
+/// </summary>
+struct ClipCompressionStats
+{
+	UINT rawKeys;			// Keys of every channel once resampled
+	UINT keptKeys;
+	UINT constantChannels;	// Channels stored as a single key
+	UINT rawBytes;			// Resampled keys as floats
+	UINT bytes;
+};
+
+class AnimationClip
+{
+public:
+	AnimationClip();
+
+	/// <summary>Compresses a clip of a skeleton, empty channels are filled in from its bind pose
+	/// </summary>
+	void Compress(const RawClip& raw, const Skeleton& skeleton, const ClipCompression& settings = ClipCompression());
+
+	/// <summary>Writes the local transform of every joint at time into pose, looping past the end of the clip
+	/// pose is resized if it doesn't have the clip's joint count
+	/// </summary>
+	void Sample(float time, Pose& pose) const;
+
+	const std::string& GetName() const;
+	float GetDuration() const;
+	UINT GetJointCount() const;
+	const ClipCompressionStats& GetStats() const;
+private:
+	/// <summary>Keys of one component group of a joint, a range of the frames and values arrays
+	/// </summary>
+	struct Channel
+	{
+		UINT firstKey;
+		UINT keyCount;		// 1 for channels that never change
+		float minimum[3];	// Translations and scales are quantized across minimum to minimum + extent
+		float extent[3];
+	};
+
+	enum ChannelType { ChannelRotation, ChannelTranslation, ChannelScale, ChannelTypeCount };
+
+	/// <summary>Resamples a channel, drops the keys it can do without and quantizes the rest
+	/// components is 4 for rotations, 3 otherwise
+	/// </summary>
+	void AddChannel(const std::vector<float>& times, const float* source, UINT components, const float* bindValue, float tolerance);
+
+	/// <summary>Finds the keys frame falls between in a channel, the key before it and the fraction of the way to the next
+	/// </summary>
+	void FindKeys(const Channel& channel, float frame, UINT& key, UINT& next, float& t) const;
+
+	static void QuantizeRotation(XMFLOAT4 rotation, USHORT* out);
+
+	std::string name;
+	float duration;
+	float frameRate;
+	UINT frameCount;
+	UINT jointCount;
+	std::vector<Channel> channels;	// Every joint's rotation, then every translation, then every scale
+	std::vector<USHORT> frames;		// Frame of every key
+	std::vector<USHORT> values;		// Three per key
+	ClipCompressionStats stats;
+};
+
+#endif
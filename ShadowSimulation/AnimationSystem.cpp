@@ -0,0 +1,225 @@
+//
+// Animated characters, their device buffers and draws
+//
+
+#include "AnimationSystem.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <thread>
+
+#include "Game.h"
+#include "Profiler.h"
+#include "TrackedResources.h"
+
+// The render thread evaluates as well, and the update and streaming threads need cores of their own
+static const UINT DefaultMaxWorkers = 3;
+
+// Joints of the procedural character
+static const UINT ProceduralJoints = 32;
+
+// Slot SkinnedVertex.hlsl reads the palette from
+static const UINT PaletteSlot = 3;
+
+AnimationSystem::AnimationSystem() :
+enabled(false),
+cpuSkinning(false),
+requestedCharacters(0),
+threadCount(min(max(std::thread::hardware_concurrency(), 1u) - 1, DefaultMaxWorkers)),
+dev(NULL),
+vertexBuffer(NULL),
+indexBuffer(NULL),
+paletteBuffer(NULL),
+skinnedBuffer(NULL),
+skinnedCapacity(0)
+{
+
+}
+
+AnimationSystem::~AnimationSystem()
+{
+	ReleaseMacro(vertexBuffer);
+	ReleaseMacro(indexBuffer);
+	ReleaseMacro(paletteBuffer);
+	ReleaseMacro(skinnedBuffer);
+}
+
+void AnimationSystem::ParseCommandLine(const char* cmdLine)
+{
+	if (!cmdLine)
+		return;
+
+	std::istringstream args(cmdLine);
+	std::string arg;
+	while (args >> arg)
+	{
+		size_t split = arg.find('=');
+		if (split == std::string::npos)
+			continue;
+
+		std::string key = arg.substr(0, split);
+		std::string value = arg.substr(split + 1);
+		if (key == "agents")
+			requestedCharacters = (UINT)max(atoi(value.c_str()), 0);
+		else if (key == "animationmodel")
+			modelPath = value;
+		else if (key == "animationthreads")
+			threadCount = (UINT)max(atoi(value.c_str()), 0);
+		else if (key == "cpuskinning")
+			cpuSkinning = value != "0";
+	}
+	enabled = requestedCharacters > 0;
+}
+
+bool AnimationSystem::IsEnabled() const { return enabled; }
+bool AnimationSystem::IsCpuSkinning() const { return cpuSkinning; }
+UINT AnimationSystem::GetRequestedCharacters() const { return enabled ? requestedCharacters : 0; }
+
+bool AnimationSystem::Initialize(ID3D11Device* _dev)
+{
+	dev = _dev;
+	if (!enabled)
+		return true;
+
+	SkinnedModelData model;
+	if (modelPath.empty() || !SkinnedModel::Import(modelPath.c_str(), model) || model.clips.empty())
+	{
+		if (!modelPath.empty())
+			OutputDebugStringA(("Animation: " + modelPath + " has no usable skeleton or clips, using the procedural character\n").c_str());
+		SkinnedModel::BuildProcedural(ProceduralJoints, model);
+	}
+	return Load(model) && CreateBuffers();
+}
+
+bool AnimationSystem::Load(const SkinnedModelData& model)
+{
+	PROFILE_ZONE("AnimationSystem::Load");
+	if (model.mesh.vertices.empty() || model.mesh.influences.size() != model.mesh.vertices.size() ||
+		!poses.Load(model.skeleton, model.clips, threadCount))
+		return false;
+
+	vertices = model.mesh.vertices;
+	influences = model.mesh.influences;
+	indices = model.mesh.indices;
+	return true;
+}
+
+bool AnimationSystem::CreateBuffers()
+{
+	std::vector<SkinnedVertex> skinned(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		skinned[i].vertex = vertices[i];
+		skinned[i].skin = influences[i];
+	}
+
+	D3D11_BUFFER_DESC vbd = {};
+	vbd.Usage = D3D11_USAGE_IMMUTABLE;
+	vbd.ByteWidth = (UINT)(skinned.size() * sizeof(SkinnedVertex));
+	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	D3D11_SUBRESOURCE_DATA vertexData = { &skinned[0] };
+	if (FAILED(TrackedResources::CreateBuffer(dev, &vbd, &vertexData, "AnimationSystem", &vertexBuffer)))
+		return false;
+
+	D3D11_BUFFER_DESC ibd = {};
+	ibd.Usage = D3D11_USAGE_IMMUTABLE;
+	ibd.ByteWidth = (UINT)(indices.size() * sizeof(UINT));
+	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	D3D11_SUBRESOURCE_DATA indexData = { &indices[0] };
+	if (FAILED(TrackedResources::CreateBuffer(dev, &ibd, &indexData, "AnimationSystem", &indexBuffer)))
+		return false;
+
+	D3D11_BUFFER_DESC cbd = {};
+	cbd.Usage = D3D11_USAGE_DYNAMIC;
+	cbd.ByteWidth = MaxSkinJoints * sizeof(SkinMatrix);
+	cbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	cbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	return SUCCEEDED(TrackedResources::CreateBuffer(dev, &cbd, NULL, "AnimationSystem", &paletteBuffer));
+}
+
+void AnimationSystem::AddCharacter(const AnimatedCharacter& character) { poses.AddCharacter(character); }
+UINT AnimationSystem::GetCharacterCount() const { return poses.GetCharacterCount(); }
+const AnimatedCharacter& AnimationSystem::GetCharacter(UINT i) const { return poses.GetCharacter(i); }
+void AnimationSystem::Evaluate(float time) { poses.Evaluate(time); }
+const SkinMatrix* AnimationSystem::GetPalette(UINT character) const { return poses.GetPalette(character); }
+UINT AnimationSystem::GetIndexCount() const { return (UINT)indices.size(); }
+const AnimationStats& AnimationSystem::GetStats() const { return poses.GetStats(); }
+
+///
+// CPU skinning
+///
+bool AnimationSystem::SkinVertices(ID3D11DeviceContext* devCon)
+{
+	PROFILE_ZONE("AnimationSystem::SkinVertices");
+	UINT count = poses.GetCharacterCount();
+	if (count == 0)
+		return true;
+
+	if (count > skinnedCapacity)
+	{
+		ReleaseMacro(skinnedBuffer);
+		skinnedCapacity = count;
+
+		D3D11_BUFFER_DESC vbd = {};
+		vbd.Usage = D3D11_USAGE_DYNAMIC;
+		vbd.ByteWidth = (UINT)(count * vertices.size() * sizeof(Vertex));
+		vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		vbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		if (FAILED(TrackedResources::CreateBuffer(dev, &vbd, NULL, "AnimationSystem", &skinnedBuffer)))
+		{
+			skinnedCapacity = 0;
+			return false;
+		}
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(devCon->Map(skinnedBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		return false;
+	SkinVerticesInto((Vertex*)mapped.pData);
+	devCon->Unmap(skinnedBuffer, 0);
+	return true;
+}
+
+void AnimationSystem::SkinVerticesInto(Vertex* out)
+{
+	if (!vertices.empty())
+		poses.SkinVerticesInto(&vertices[0], &influences[0], (UINT)vertices.size(), out);
+}
+
+///
+// Drawing
+///
+void AnimationSystem::Bind(ID3D11DeviceContext* devCon)
+{
+	UINT stride = sizeof(SkinnedVertex);
+	UINT offset = 0;
+	devCon->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+	devCon->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	devCon->VSSetConstantBuffers(PaletteSlot, 1, &paletteBuffer);
+}
+
+void AnimationSystem::Draw(ID3D11DeviceContext* devCon, UINT character)
+{
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(devCon->Map(paletteBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		return;
+	memcpy(mapped.pData, GetPalette(character), poses.GetJointCount() * sizeof(SkinMatrix));
+	devCon->Unmap(paletteBuffer, 0);
+	devCon->DrawIndexed((UINT)indices.size(), 0, 0);
+}
+
+UINT AnimationSystem::DrawSkinned(ID3D11DeviceContext* devCon)
+{
+	if (!skinnedBuffer)
+		return 0;
+
+	UINT stride = sizeof(Vertex);
+	UINT offset = 0;
+	devCon->IASetVertexBuffers(0, 1, &skinnedBuffer, &stride, &offset);
+	devCon->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	UINT count = poses.GetCharacterCount();
+	for (UINT i = 0; i < count; i++)
+		devCon->DrawIndexed((UINT)indices.size(), 0, i * (UINT)vertices.size());
+	return count;
+}
@@ -0,0 +1,107 @@
+//
+// Animated characters, each playing two compressed clips blended together and skinned by a matrix palette every frame
+// PoseEvaluator builds the palettes across worker threads. The main pass skins in the vertex shader from a palette
+// constant buffer. The shadow pass can instead skin on the CPU into one dynamic vertex buffer already in world space,
+// which saves a palette upload per character
+// Command line: agents=<characters>, 0 leaves animation off, animationmodel=<model file with bones>,
+// animationthreads=<workers besides the render thread>, cpuskinning=1 skins the shadow pass on the CPU
+//
+
+#ifndef ANIMATIONSYSTEM_H
+#define ANIMATIONSYSTEM_H
+
+#include <d3d11.h>
+#include <string>
+#include <vector>
+
+#include "PoseEvaluator.h"
+#include "SkinnedModel.h"
+
+class AnimationSystem
+{
+public:
+	AnimationSystem();
+	~AnimationSystem();
+
+	void ParseCommandLine(const char* cmdLine);
+
+	bool IsEnabled() const;
+	bool IsCpuSkinning() const;
+
+	/// <summary>Characters asked for on the command line, the scene places them
+	/// </summary>
+	UINT GetRequestedCharacters() const;
+
+	/// <summary>Imports the model named on the command line, or builds a procedural one if there is none or it has no clips,
+	/// then loads it and creates its buffers. Does nothing if animation is off
+	/// </summary>
+	bool Initialize(ID3D11Device* dev);
+
+	/// <summary>Compresses the model's clips and starts the workers, without touching the device. Returns false if the
+	/// model has no clips, no influences or too many joints
+	/// </summary>
+	bool Load(const SkinnedModelData& model);
+
+	/// <summary>Each character plays clip i and i + 1 of the model, i being its index
+	/// </summary>
+	void AddCharacter(const AnimatedCharacter& character);
+
+	UINT GetCharacterCount() const;
+	const AnimatedCharacter& GetCharacter(UINT i) const;
+
+	/// <summary>Samples and blends every character's clips at time and builds their palettes
+	/// </summary>
+	void Evaluate(float time);
+
+	const SkinMatrix* GetPalette(UINT character) const;
+
+	/// <summary>Skins every character into the shadow vertex buffer after Evaluate. Returns false if it couldn't be mapped
+	/// </summary>
+	bool SkinVertices(ID3D11DeviceContext* devCon);
+
+	/// <summary>Skins into memory instead, out needs room for every character's vertices
+	/// </summary>
+	void SkinVerticesInto(Vertex* out);
+
+	/// <summary>Binds the skinned vertex buffer, index buffer and palette buffer for Draw. The input layout has to take
+	/// VertexFormatSkinned and the vertex shader has to be SkinnedVertex.hlsl
+	/// </summary>
+	void Bind(ID3D11DeviceContext* devCon);
+
+	/// <summary>Uploads a character's palette and draws it, its world matrix has to be set already
+	/// </summary>
+	void Draw(ID3D11DeviceContext* devCon, UINT character);
+
+	/// <summary>Draws every character from the CPU skinned buffer, with the Vertex layout and an identity world matrix
+	/// Returns the draws made
+	/// </summary>
+	UINT DrawSkinned(ID3D11DeviceContext* devCon);
+
+	UINT GetIndexCount() const;
+	const AnimationStats& GetStats() const;
+private:
+	AnimationSystem(const AnimationSystem&);
+	AnimationSystem& operator=(const AnimationSystem&);
+
+	bool CreateBuffers();
+
+	bool enabled;
+	bool cpuSkinning;
+	UINT requestedCharacters;
+	UINT threadCount;
+	std::string modelPath;
+
+	PoseEvaluator poses;
+	std::vector<Vertex> vertices;				// Bind pose, kept for CPU skinning
+	std::vector<SkinInfluences> influences;
+	std::vector<UINT> indices;
+
+	ID3D11Device* dev;
+	ID3D11Buffer* vertexBuffer;			// SkinnedVertex
+	ID3D11Buffer* indexBuffer;
+	ID3D11Buffer* paletteBuffer;
+	ID3D11Buffer* skinnedBuffer;		// Vertex of every character, made on the first SkinVertices
+	UINT skinnedCapacity;				// Characters skinnedBuffer holds
+};
+
+#endif
@@ -0,0 +1,323 @@
+//
+// Streams assets in the background and uploads them under a per-frame budget
+// Worker threads read and decode, the main thread uploads the most important finished assets
+// and evicts the least important ones to stay under a memory cap
+// Nothing in here touches D3D, all loading and uploading goes through a StreamBackend, which is never called with the
+// streamer's lock held
+//
+
+#include "AssetStreamer.h"
+#include <algorithm>
+
+// An evicted asset has to beat a resident one by this much to count on its room when coming back,
+// otherwise two assets of similar priority keep evicting each other
+static const float RequeueHysteresis = 1.5f;
+
+AssetStreamer::AssetStreamer(StreamBackend* backend) :
+backend(backend),
+stopping(false),
+memoryCap(256 * 1024 * 1024),
+pendingCap(64 * 1024 * 1024),
+residentBytes(0),
+pendingBytes(0)
+{
+
+}
+
+AssetStreamer::~AssetStreamer()
+{
+	Stop();
+}
+
+void AssetStreamer::Start(UINT workerCount)
+{
+	Stop();
+
+	stopping = false;
+	for (UINT i = 0; i < workerCount; i++)
+		workers.push_back(std::thread(&AssetStreamer::WorkerLoop, this));
+}
+
+void AssetStreamer::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (std::thread& worker : workers)
+		worker.join();
+	workers.clear();
+}
+
+AssetId AssetStreamer::Add(float priority)
+{
+	Asset asset;
+	asset.state = AssetQueued;
+	asset.priority = priority;
+	asset.residentBytes = 0;
+
+	AssetId id;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		id = (AssetId)assets.size();
+		assets.push_back(asset);
+	}
+	wake.notify_one();
+	return id;
+}
+
+void AssetStreamer::SetPriority(AssetId id, float priority)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	assets[id].priority = priority;
+}
+
+void AssetStreamer::RaisePriority(AssetId id, float priority)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (priority > assets[id].priority)
+		assets[id].priority = priority;
+}
+
+void AssetStreamer::ResetPriorities()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (Asset& asset : assets)
+		asset.priority = 0.0f;
+}
+
+void AssetStreamer::SetMemoryCap(UINT64 bytes)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	memoryCap = bytes;
+}
+
+void AssetStreamer::SetPendingCap(UINT64 bytes)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pendingCap = bytes;
+	}
+	wake.notify_all();
+}
+
+UINT AssetStreamer::Update(UINT64 uploadBudget)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	// Bring evicted assets back once they fit after evicting what they clearly outrank, nothing else could make room
+	// Residents sorted by priority with running byte totals answer that with one search per evicted asset
+	std::vector<std::pair<float, UINT64>> residents;
+	for (const Asset& asset : assets)
+	{
+		if (asset.state == AssetResident)
+			residents.push_back(std::make_pair(asset.priority, asset.residentBytes));
+	}
+	std::sort(residents.begin(), residents.end());
+	for (size_t i = 1; i < residents.size(); i++)
+		residents[i].second += residents[i - 1].second;
+	bool requeued = false;
+	for (Asset& asset : assets)
+	{
+		if (asset.state != AssetEvicted)
+			continue;
+		size_t outranked = std::lower_bound(residents.begin(), residents.end(), std::make_pair(asset.priority / RequeueHysteresis, (UINT64)0)) -
+			residents.begin();
+		UINT64 freeable = outranked ? residents[outranked - 1].second : 0;
+		if (residentBytes - freeable + asset.residentBytes <= memoryCap)
+		{
+			asset.state = AssetQueued;
+			requeued = true;
+		}
+	}
+	if (requeued)
+		wake.notify_all();
+
+	// Without workers the streamer loads synchronously, one asset per update
+	if (workers.empty())
+	{
+		int next = FindHighest(AssetQueued);
+		if (next >= 0)
+			LoadAsset(lock, (AssetId)next);
+	}
+
+	UINT uploads = 0;
+	UINT64 spent = 0;
+	bool dropped = false;
+	std::vector<AssetId> victims;
+	while (spent < uploadBudget || uploads == 0)
+	{
+		int next = FindHighest(AssetLoaded);
+		if (next < 0)
+			break;
+
+		// Even evicting everything less important wouldn't make room. The payload is dropped so the asset doesn't hold
+		// up the ones behind it, and it comes back like an evicted asset once room can be made for it
+		Asset& asset = assets[next];
+		UINT64 estimate = asset.residentBytes ? asset.residentBytes : asset.payload.size();
+		if (!MakeRoom(estimate, asset.priority, victims))
+		{
+			pendingBytes -= asset.payload.size();
+			std::vector<BYTE>().swap(asset.payload);
+			asset.residentBytes = estimate;
+			asset.state = AssetEvicted;
+			dropped = true;
+			continue;
+		}
+
+		std::vector<BYTE> payload;
+		payload.swap(asset.payload);
+		asset.state = AssetUploading;
+		pendingBytes -= payload.size();
+
+		// Victims free their memory before the upload needs it
+		lock.unlock();
+		for (AssetId victim : victims)
+			backend->Evict(victim);
+		victims.clear();
+		UINT64 uploaded = backend->Upload((AssetId)next, payload);
+		lock.lock();
+
+		Asset& landed = assets[next];
+		if (uploaded)
+		{
+			landed.state = AssetResident;
+			landed.residentBytes = uploaded;
+			residentBytes += uploaded;
+
+			// The estimate can be off (compressed files expand on upload). Trim anything less important,
+			// and if that isn't enough this asset is the least important one and goes back out
+			if (!MakeRoom(0, landed.priority, victims))
+			{
+				landed.state = AssetEvicted;
+				residentBytes -= uploaded;
+				victims.push_back((AssetId)next);
+			}
+		}
+		else
+		{
+			landed.state = AssetFailed;
+		}
+
+		spent += payload.size();
+		uploads++;
+	}
+
+	lock.unlock();
+	for (AssetId victim : victims)
+		backend->Evict(victim);
+	if (uploads || dropped || !victims.empty())
+		wake.notify_all();
+	return uploads;
+}
+
+AssetState AssetStreamer::GetState(AssetId id) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return assets[id].state;
+}
+
+bool AssetStreamer::IsIdle() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (const Asset& asset : assets)
+	{
+		if (asset.state == AssetQueued || asset.state == AssetLoading || asset.state == AssetLoaded || asset.state == AssetUploading)
+			return false;
+	}
+	return true;
+}
+
+UINT64 AssetStreamer::GetResidentBytes() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return residentBytes;
+}
+
+UINT64 AssetStreamer::GetPendingBytes() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return pendingBytes;
+}
+
+void AssetStreamer::WorkerLoop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (!stopping)
+	{
+		int next = pendingBytes < pendingCap ? FindHighest(AssetQueued) : -1;
+		if (next < 0)
+		{
+			wake.wait(lock);
+			continue;
+		}
+		LoadAsset(lock, (AssetId)next);
+	}
+}
+
+void AssetStreamer::LoadAsset(std::unique_lock<std::mutex>& lock, AssetId id)
+{
+	assets[id].state = AssetLoading;
+
+	std::vector<BYTE> payload;
+	lock.unlock();
+	bool loaded = backend->Load(id, payload);
+	lock.lock();
+
+	Asset& asset = assets[id];
+	if (loaded)
+	{
+		pendingBytes += payload.size();
+		asset.payload.swap(payload);
+		asset.state = AssetLoaded;
+	}
+	else
+	{
+		asset.state = AssetFailed;
+	}
+}
+
+int AssetStreamer::FindHighest(AssetState state) const
+{
+	int best = -1;
+	for (size_t i = 0; i < assets.size(); i++)
+	{
+		if (assets[i].state == state && (best < 0 || assets[i].priority > assets[best].priority))
+			best = (int)i;
+	}
+	return best;
+}
+
+bool AssetStreamer::MakeRoom(UINT64 bytes, float priority, std::vector<AssetId>& victims)
+{
+	if (residentBytes + bytes <= memoryCap)
+		return true;
+
+	// Victims are only picked here, least important first, and nothing is evicted unless together they make room
+	std::vector<AssetId> candidates;
+	for (size_t i = 0; i < assets.size(); i++)
+	{
+		if (assets[i].state == AssetResident && assets[i].priority < priority)
+			candidates.push_back((AssetId)i);
+	}
+	std::stable_sort(candidates.begin(), candidates.end(), [this](AssetId a, AssetId b) { return assets[a].priority < assets[b].priority; });
+
+	UINT64 remaining = residentBytes;
+	size_t count = 0;
+	while (remaining + bytes > memoryCap)
+	{
+		if (count == candidates.size())
+			return false;
+		remaining -= assets[candidates[count++]].residentBytes;
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		assets[candidates[i]].state = AssetEvicted;
+		victims.push_back(candidates[i]);
+	}
+	residentBytes = remaining;
+	return true;
+}
@@ -0,0 +1,141 @@
+//
+// Streams assets in the background and uploads them under a per-frame budget
+// Worker threads read and decode, the main thread uploads the most important finished assets
+// and evicts the least important ones to stay under a memory cap
+// Nothing in here touches D3D, all loading and uploading goes through a StreamBackend, which is never called with the
+// streamer's lock held
+//
+
+#ifndef ASSETSTREAMER_H
+#define ASSETSTREAMER_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <Windows.h>
+
+typedef UINT AssetId;
+
+enum AssetState
+{
+	AssetQueued,	// Waiting for a worker
+	AssetLoading,	// A worker is reading and decoding it
+	AssetLoaded,	// Decoded, waiting for upload budget
+	AssetUploading,
+	AssetResident,
+	AssetEvicted,	// Dropped to stay under the cap or didn't fit, requeued once room can be made for it
+	AssetFailed
+};
+
+/// <summary>Does the actual work for an AssetStreamer
+/// </summary>
+class StreamBackend
+{
+public:
+	virtual ~StreamBackend() {}
+
+	/// <summary>Called on a worker thread. Reads and decodes the asset into payload
+	/// </summary>
+	virtual bool Load(AssetId id, std::vector<BYTE>& payload) = 0;
+
+	/// <summary>Called on the main thread. Creates the GPU resources and returns how many bytes they take, 0 on failure
+	/// </summary>
+	virtual UINT64 Upload(AssetId id, const std::vector<BYTE>& payload) = 0;
+
+	/// <summary>Called on the main thread. Frees the GPU resources and puts the placeholder back
+	/// </summary>
+	virtual void Evict(AssetId id) = 0;
+};
+
+class AssetStreamer
+{
+public:
+	AssetStreamer(StreamBackend* backend);
+	~AssetStreamer();
+
+	/// <summary>Starts the worker threads. With no workers, Update loads assets itself
+	/// </summary>
+	void Start(UINT workerCount);
+
+	/// <summary>Stops the workers once their current load finishes
+	/// </summary>
+	void Stop();
+
+	/// <summary>Registers a new asset and queues it for loading
+	/// </summary>
+	AssetId Add(float priority);
+
+	/// <summary>Priorities are relative, higher loads first and is evicted last
+	/// </summary>
+	void SetPriority(AssetId id, float priority);
+
+	/// <summary>Raises the priority to at least the given value. Lets several users of one asset vote
+	/// </summary>
+	void RaisePriority(AssetId id, float priority);
+
+	/// <summary>Sets every priority to 0, call before re-prioritizing a frame
+	/// </summary>
+	void ResetPriorities();
+
+	/// <summary>Total GPU bytes resident assets may use
+	/// </summary>
+	void SetMemoryCap(UINT64 bytes);
+
+	/// <summary>Decoded bytes workers may keep waiting for upload before they pause
+	/// </summary>
+	void SetPendingCap(UINT64 bytes);
+
+	/// <summary>Main thread only. Uploads finished assets by priority until uploadBudget payload bytes were spent,
+	/// always at least one. Returns the number of assets uploaded
+	/// </summary>
+	UINT Update(UINT64 uploadBudget);
+
+	AssetState GetState(AssetId id) const;
+
+	/// <summary>Returns true when no asset is waiting to be loaded or uploaded
+	/// </summary>
+	bool IsIdle() const;
+
+	UINT64 GetResidentBytes() const;
+	UINT64 GetPendingBytes() const;
+private:
+	struct Asset
+	{
+		AssetState state;
+		float priority;
+		UINT64 residentBytes;	// What the asset took the last time it was resident, or would take if it never fit
+		std::vector<BYTE> payload;
+	};
+
+	void WorkerLoop();
+
+	/// <summary>Loads one asset. Called with lock held, releases it while the backend works
+	/// </summary>
+	void LoadAsset(std::unique_lock<std::mutex>& lock, AssetId id);
+
+	/// <summary>Returns the highest priority asset in the given state, -1 if there is none
+	/// </summary>
+	int FindHighest(AssetState state) const;
+
+	/// <summary>Marks resident assets less important than priority evicted until bytes more fit under the cap, adding
+	/// them to victims. Evicts nothing and returns false if that can't make enough room. The backend is only told once
+	/// the lock has been released
+	/// </summary>
+	bool MakeRoom(UINT64 bytes, float priority, std::vector<AssetId>& victims);
+
+	StreamBackend* backend;
+	std::vector<Asset> assets;
+
+	std::vector<std::thread> workers;
+	mutable std::mutex mutex;
+	std::condition_variable wake;
+	bool stopping;
+
+	UINT64 memoryCap;
+	UINT64 pendingCap;
+	UINT64 residentBytes;
+	UINT64 pendingBytes;
+};
+
+#endif
@@ -0,0 +1,113 @@
+//
+// Packs rectangles into a fixed size page with a bottom-left skyline
+// Positions are kept on an alignment grid so mip levels of the packed images line up with the page's
+//
+
+#include "AtlasPacker.h"
+
+#include <climits>
+
+AtlasPacker::AtlasPacker(UINT _width, UINT _height, UINT _alignment) :
+width(_width),
+height(_height),
+alignment(max(_alignment, 1u)),
+usedArea(0)
+{
+	SkylineSegment floor = { 0, 0, width };
+	skyline.push_back(floor);
+}
+
+bool AtlasPacker::Insert(UINT rectWidth, UINT rectHeight, AtlasRect& rect)
+{
+	rectWidth = (rectWidth + alignment - 1) & ~(alignment - 1);
+	rectHeight = (rectHeight + alignment - 1) & ~(alignment - 1);
+	if (rectWidth == 0 || rectHeight == 0 || rectWidth > width || rectHeight > height)
+		return false;
+
+	// Lowest top edge wins, ties go to the narrowest gap so wide runs stay free for wide rectangles
+	size_t best = skyline.size();
+	UINT bestTop = UINT_MAX;
+	UINT bestWidth = UINT_MAX;
+	for (size_t i = 0; i < skyline.size(); i++)
+	{
+		UINT y = FindHeight(i, rectWidth);
+		if (y == UINT_MAX || y + rectHeight > height)
+			continue;
+
+		UINT top = y + rectHeight;
+		if (top < bestTop || (top == bestTop && skyline[i].width < bestWidth))
+		{
+			best = i;
+			bestTop = top;
+			bestWidth = skyline[i].width;
+			rect.x = skyline[i].x;
+			rect.y = y;
+		}
+	}
+	if (best == skyline.size())
+		return false;
+
+	rect.width = rectWidth;
+	rect.height = rectHeight;
+	AddSegment(best, rect);
+	usedArea += (UINT64)rectWidth * rectHeight;
+	return true;
+}
+
+float AtlasPacker::GetOccupancy() const
+{
+	return (float)((double)usedArea / ((double)width * height));
+}
+
+UINT AtlasPacker::GetWidth() const { return width; }
+UINT AtlasPacker::GetHeight() const { return height; }
+
+UINT AtlasPacker::FindHeight(size_t index, UINT rectWidth) const
+{
+	if (skyline[index].x + rectWidth > width)
+		return UINT_MAX;
+
+	// The rectangle rests on the highest segment underneath it
+	UINT y = 0;
+	UINT remaining = rectWidth;
+	for (size_t i = index; remaining > 0; i++)
+	{
+		y = max(y, skyline[i].y);
+		remaining -= min(remaining, skyline[i].width);
+	}
+	return y;
+}
+
+void AtlasPacker::AddSegment(size_t index, const AtlasRect& rect)
+{
+	SkylineSegment segment = { rect.x, rect.y + rect.height, rect.width };
+	skyline.insert(skyline.begin() + index, segment);
+
+	// Trim the segments the new one now covers
+	UINT right = rect.x + rect.width;
+	size_t i = index + 1;
+	while (i < skyline.size() && skyline[i].x < right)
+	{
+		UINT end = skyline[i].x + skyline[i].width;
+		if (end <= right)
+		{
+			skyline.erase(skyline.begin() + i);
+			continue;
+		}
+		skyline[i].width = end - right;
+		skyline[i].x = right;
+		break;
+	}
+
+	// Neighbours at the same height become one segment
+	for (i = 0; i + 1 < skyline.size();)
+	{
+		if (skyline[i].y == skyline[i + 1].y)
+		{
+			skyline[i].width += skyline[i + 1].width;
+			skyline.erase(skyline.begin() + i + 1);
+		}
+		else
+			i++;
+	}
+}
@@ -0,0 +1,61 @@
+//
+// Packs rectangles into a fixed size page with a bottom-left skyline
+// Positions are kept on an alignment grid so mip levels of the packed images line up with the page's
+//
+
+#ifndef ATLASPACKER_H
+#define ATLASPACKER_H
+
+#include <vector>
+#include <Windows.h>
+
+struct AtlasRect
+{
+	UINT x;
+	UINT y;
+	UINT width;
+	UINT height;
+};
+
+class AtlasPacker
+{
+public:
+	/// <summary>alignment must be a power of two, 1 packs tightly
+	/// </summary>
+	AtlasPacker(UINT width, UINT height, UINT alignment);
+
+	/// <summary>Finds room for a rectangle, placing it where its top edge ends lowest
+	/// Sizes are rounded up to the alignment, rect gets the rounded size. Returns false if it doesn't fit
+	/// </summary>
+	bool Insert(UINT width, UINT height, AtlasRect& rect);
+
+	/// <summary>Area of everything inserted over the area of the page
+	/// </summary>
+	float GetOccupancy() const;
+
+	UINT GetWidth() const;
+	UINT GetHeight() const;
+private:
+	/// <summary>Top edge of the packed area along a horizontal run of the page
+	/// </summary>
+	struct SkylineSegment
+	{
+		UINT x;
+		UINT y;
+		UINT width;
+	};
+
+	/// <summary>Returns how low a rectangle starting at segment index can sit, or UINT_MAX if it runs off the page
+	/// </summary>
+	UINT FindHeight(size_t index, UINT width) const;
+
+	void AddSegment(size_t index, const AtlasRect& rect);
+
+	UINT width;
+	UINT height;
+	UINT alignment;
+	UINT64 usedArea;
+	std::vector<SkylineSegment> skyline;
+};
+
+#endif
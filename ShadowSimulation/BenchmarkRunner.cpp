@@ -0,0 +1,185 @@
+//
+// Drives a fixed length benchmark run and reports frame statistics as JSON
+// Turned on from the command line: -benchmark seed=1 objects=1000 lights=8 dynamic=0.25 frames=1000 out=benchmark.json
+// Nothing is simulated or measured until streaming has gone idle, so every run measures the same frames
+//
+
+#include "BenchmarkRunner.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+BenchmarkRunner::BenchmarkRunner() :
+enabled(false),
+frameCount(1000),
+warmupFrames(30),
+settleLimit(600),
+fixedStep(1.0f / 60.0f),
+outputPath("benchmark.json"),
+settleFrames(0),
+settled(false),
+streamingSettled(false),
+framesSeen(0)
+{
+
+}
+
+bool BenchmarkRunner::ParseCommandLine(const char* cmdLine)
+{
+	if (!cmdLine)
+		return false;
+
+	std::istringstream args(cmdLine);
+	std::string arg;
+	while (args >> arg)
+	{
+		if (arg == "-benchmark")
+		{
+			enabled = true;
+			continue;
+		}
+
+		size_t split = arg.find('=');
+		if (split == std::string::npos)
+			continue;
+
+		std::string key = arg.substr(0, split);
+		std::string value = arg.substr(split + 1);
+		if (key == "seed")
+			scene.seed = (UINT)strtoul(value.c_str(), NULL, 10);
+		else if (key == "objects")
+			scene.objectCount = (UINT)strtoul(value.c_str(), NULL, 10);
+		else if (key == "lights")
+			scene.lightCount = (UINT)strtoul(value.c_str(), NULL, 10);
+		else if (key == "dynamic")
+			scene.dynamicFraction = (float)atof(value.c_str());
+		else if (key == "extent")
+			scene.extent = (float)atof(value.c_str());
+		else if (key == "frames")
+			frameCount = (UINT)strtoul(value.c_str(), NULL, 10);
+		else if (key == "warmup")
+			warmupFrames = (UINT)strtoul(value.c_str(), NULL, 10);
+		else if (key == "settle")
+			settleLimit = (UINT)strtoul(value.c_str(), NULL, 10);
+		else if (key == "out")
+			outputPath = value;
+	}
+
+	if (frameCount == 0)
+		frameCount = 1;
+
+	frameTimes.reserve(frameCount);
+	frames.reserve(frameCount);
+	return enabled;
+}
+
+bool BenchmarkRunner::IsEnabled() const { return enabled; }
+const SceneDesc& BenchmarkRunner::GetSceneDesc() const { return scene; }
+float BenchmarkRunner::GetFixedStep() const { return fixedStep; }
+
+bool BenchmarkRunner::IsSettling() const { return !settled; }
+
+float BenchmarkRunner::GetProgress() const
+{
+	return (float)framesSeen / (warmupFrames + frameCount);
+}
+
+bool BenchmarkRunner::EndFrame(const FrameStats& stats, bool streamingIdle)
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (!settled)
+	{
+		// How long loading takes varies from run to run, so none of these frames count towards the run
+		settleFrames++;
+		streamingSettled = streamingIdle;
+		settled = streamingIdle || settleFrames >= settleLimit;
+		lastFrame = now;
+		return false;
+	}
+
+	if (framesSeen >= warmupFrames)
+	{
+		frameTimes.push_back(std::chrono::duration<float, std::milli>(now - lastFrame).count());
+		frames.push_back(stats);
+	}
+	lastFrame = now;
+	framesSeen++;
+
+	return frames.size() >= frameCount;
+}
+
+// Nearest rank percentile of an already sorted list
+template <typename T>
+static T Percentile(const std::vector<T>& sorted, float p)
+{
+	if (sorted.empty())
+		return T();
+	size_t rank = (size_t)(p * (sorted.size() - 1) + 0.5f);
+	return sorted[rank];
+}
+
+template <typename T>
+static void WriteDistribution(std::ofstream& file, const char* name, std::vector<T> values, bool last = false)
+{
+	std::sort(values.begin(), values.end());
+	double total = 0.0;
+	for (const T& value : values)
+		total += value;
+
+	file << "  \"" << name << "\": { "
+		<< "\"mean\": " << (values.empty() ? 0.0 : total / values.size())
+		<< ", \"p50\": " << Percentile(values, 0.5f)
+		<< ", \"p90\": " << Percentile(values, 0.9f)
+		<< ", \"p99\": " << Percentile(values, 0.99f)
+		<< ", \"max\": " << (values.empty() ? T() : values.back())
+		<< " }" << (last ? "\n" : ",\n");
+}
+
+bool BenchmarkRunner::WriteReport() const
+{
+	std::ofstream file(outputPath.c_str());
+	if (!file)
+		return false;
+
+	std::vector<UINT> draws, stateChanges, textureBinds, bufferBinds, visible, occluded, shadowOccluded, triangles, meshletsCulled;
+	std::vector<UINT64> bytesUploaded;
+	for (const FrameStats& stats : frames)
+	{
+		draws.push_back(stats.draws);
+		stateChanges.push_back(stats.stateChanges);
+		textureBinds.push_back(stats.textureBinds);
+		bufferBinds.push_back(stats.bufferBinds);
+		bytesUploaded.push_back(stats.bytesUploaded);
+		visible.push_back(stats.visible);
+		occluded.push_back(stats.occluded);
+		shadowOccluded.push_back(stats.shadowOccluded);
+		triangles.push_back(stats.triangles);
+		meshletsCulled.push_back(stats.meshletsCulled);
+	}
+
+	file << std::fixed << std::setprecision(3);
+	file << "{\n";
+	file << "  \"seed\": " << scene.seed << ",\n";
+	file << "  \"objects\": " << scene.objectCount << ",\n";
+	file << "  \"lights\": " << scene.lightCount << ",\n";
+	file << "  \"dynamicFraction\": " << scene.dynamicFraction << ",\n";
+	file << "  \"frames\": " << frames.size() << ",\n";
+	file << "  \"settleFrames\": " << settleFrames << ",\n";
+	file << "  \"streamingSettled\": " << (streamingSettled ? "true" : "false") << ",\n";
+	WriteDistribution(file, "frameTimeMs", frameTimes);
+	WriteDistribution(file, "draws", draws);
+	WriteDistribution(file, "stateChanges", stateChanges);
+	WriteDistribution(file, "textureBinds", textureBinds);
+	WriteDistribution(file, "bufferBinds", bufferBinds);
+	WriteDistribution(file, "visible", visible);
+	WriteDistribution(file, "occluded", occluded);
+	WriteDistribution(file, "shadowOccluded", shadowOccluded);
+	WriteDistribution(file, "triangles", triangles);
+	WriteDistribution(file, "meshletsCulled", meshletsCulled);
+	WriteDistribution(file, "bytesUploaded", bytesUploaded, true);
+	file << "}\n";
+
+	return file.good();
+}
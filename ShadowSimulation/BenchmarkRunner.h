@@ -0,0 +1,85 @@
+//
+// Drives a fixed length benchmark run and reports frame statistics as JSON
+// Turned on from the command line: -benchmark seed=1 objects=1000 lights=8 dynamic=0.25 frames=1000 out=benchmark.json
+// Nothing is simulated or measured until streaming has gone idle, so every run measures the same frames
+//
+
+#ifndef BENCHMARKRUNNER_H
+#define BENCHMARKRUNNER_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <Windows.h>
+
+#include "SceneGenerator.h"
+
+struct FrameStats
+{
+	FrameStats() : draws(0), stateChanges(0), textureBinds(0), bufferBinds(0), bytesUploaded(0), visible(0), occluded(0), shadowOccluded(0),
+		triangles(0), meshletsCulled(0) {}
+
+	UINT draws;
+	UINT stateChanges;	// Mesh or material switches between consecutive draws
+	UINT textureBinds;	// Texture slots that actually had to be rebound
+	UINT bufferBinds;	// Vertex and index buffers objects had to bind
+	UINT64 bytesUploaded;
+	UINT visible;			// Objects that passed the camera's occlusion test
+	UINT occluded;			// Objects hidden behind occluders from the camera
+	UINT shadowOccluded;	// Shadow casters hidden behind occluders from the light
+	UINT triangles;			// Drawn at the levels of detail picked for each pass
+	UINT meshletsCulled;	// Off screen or back facing in either pass, their triangles never drawn
+};
+
+class BenchmarkRunner
+{
+public:
+	BenchmarkRunner();
+
+	/// <summary>Reads benchmark settings from the command line. Returns true if -benchmark was passed
+	/// </summary>
+	bool ParseCommandLine(const char* cmdLine);
+
+	bool IsEnabled() const;
+	const SceneDesc& GetSceneDesc() const;
+
+	/// <summary>Simulation step used for every frame, so runs don't depend on how fast frames are
+	/// </summary>
+	float GetFixedStep() const;
+
+	/// <summary>Returns true while the run waits for streaming to go idle. The simulation should stand still meanwhile
+	/// </summary>
+	bool IsSettling() const;
+
+	/// <summary>Returns how far along the run is, in [0, 1). Stays at 0 while settling
+	/// </summary>
+	float GetProgress() const;
+
+	/// <summary>Records one finished frame. streamingIdle ends settling, as does settle=600 frames passing without it
+	/// Returns true once the requested number of frames is done
+	/// </summary>
+	bool EndFrame(const FrameStats& stats, bool streamingIdle);
+
+	/// <summary>Writes percentiles of everything recorded to the output file
+	/// </summary>
+	bool WriteReport() const;
+private:
+	bool enabled;
+	SceneDesc scene;
+	UINT frameCount;
+	UINT warmupFrames;
+	UINT settleLimit;	// Frames to wait for streaming before measuring anyway
+	float fixedStep;
+	std::string outputPath;
+
+	std::chrono::steady_clock::time_point lastFrame;
+	UINT settleFrames;
+	bool settled;
+	bool streamingSettled;	// Settling ended because streaming went idle, not because it ran out of frames
+	UINT framesSeen;
+
+	std::vector<float> frameTimes;
+	std::vector<FrameStats> frames;
+};
+
+#endif
@@ -43,6 +43,13 @@ void Camera::SetPosition(XMFLOAT3& v)
 	m_Position = v;
 }
 
+void Camera::SetOrientation(const XMFLOAT3& right, const XMFLOAT3& up, const XMFLOAT3& look)
+{
+	m_Right = right;
+	m_Up = up;
+	m_Look = look;
+}
+
 XMVECTOR Camera::GetRightXM()const
 {
 	return XMLoadFloat3(&m_Right);
@@ -114,10 +121,18 @@ void Camera::SetLens(float fovY, float aspect, float zn, float zf)
 }
 
 void Camera::LookAt(FXMVECTOR pos, FXMVECTOR target, FXMVECTOR worldUp){
+	XMVECTOR L = XMVector3Normalize(XMVectorSubtract(target, pos));
+	XMVECTOR R = XMVector3Normalize(XMVector3Cross(worldUp, L));
+	XMVECTOR U = XMVector3Cross(L, R);
+
+	XMStoreFloat3(&m_Position, pos);
+	XMStoreFloat3(&m_Look, L);
+	XMStoreFloat3(&m_Right, R);
+	XMStoreFloat3(&m_Up, U);
 }
 
 void Camera::LookAt(const XMFLOAT3& pos, const XMFLOAT3& target, const XMFLOAT3& worldUp){
-
+	LookAt(XMLoadFloat3(&pos), XMLoadFloat3(&target), XMLoadFloat3(&worldUp));
 }
 
 float Camera::GetFovX()const{
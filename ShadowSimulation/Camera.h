@@ -28,6 +28,10 @@ public:
 	void	 SetPosition(float x, float y, float z);
 	void	 SetPosition(XMFLOAT3& v);
 
+	/// <summary>Sets the right, up and look vectors directly (re-orthonormalized in UpdateViewMatrix)
+	/// </summary>
+	void	 SetOrientation(const XMFLOAT3& right, const XMFLOAT3& up, const XMFLOAT3& look);
+
 	XMVECTOR GetRightXM() const;
 	XMFLOAT3 GetRight()   const;
 	XMVECTOR GetUpXM() const;
@@ -0,0 +1,353 @@
+//
+// Cooks source images to block compressed DDS files, and models to .mesh files with their levels of detail, without opening a window
+// Turned on from the command line: -cook in=Textures out=Textures threads=0 srgb=0 mips=1 filter=box compress=1 entropy=0 report=cook.log
+// in can be a single file or a directory of .png, .fbx and .obj files, out defaults to next to the input
+// Meshes are written through the MeshCodec unless compress=0, entropy=1 adds its Huffman stage
+// Tools/Cook.cpp runs it as a command line tool of its own, which on Linux cooks the textures and leaves models to Windows
+//
+
+#include "CookCommand.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "PNGDecoder.h"
+
+#if defined(_MSC_VER)
+#include "Mesh.h"
+#include "MeshCodec.h"
+#include "WICImageDecoder.h"
+
+// Models are imported through Assimp into the renderer's mesh format, which only the Windows build has
+static const bool CooksMeshes = true;
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+
+static const bool CooksMeshes = false;
+#endif
+
+static bool IsDirectory(const std::string& path)
+{
+#if defined(_MSC_VER)
+	DWORD attributes = GetFileAttributesA(path.c_str());
+	return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+	struct stat status;
+	return stat(path.c_str(), &status) == 0 && S_ISDIR(status.st_mode);
+#endif
+}
+
+/// <summary>Fills names with the files (not directories) in a directory
+/// </summary>
+static bool ListFiles(const std::string& directory, std::vector<std::string>& names)
+{
+#if defined(_MSC_VER)
+	WIN32_FIND_DATAA found;
+	HANDLE search = FindFirstFileA((directory + "/*").c_str(), &found);
+	if (search == INVALID_HANDLE_VALUE)
+		return false;
+
+	do
+	{
+		if (!(found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+			names.push_back(found.cFileName);
+	} while (FindNextFileA(search, &found));
+	FindClose(search);
+#else
+	DIR* search = opendir(directory.c_str());
+	if (!search)
+		return false;
+
+	while (dirent* found = readdir(search))
+	{
+		if (!IsDirectory(directory + "/" + found->d_name))
+			names.push_back(found->d_name);
+	}
+	closedir(search);
+#endif
+	return true;
+}
+
+static std::string GetFileName(const std::string& path)
+{
+	size_t split = path.find_last_of("/\\");
+	return split == std::string::npos ? path : path.substr(split + 1);
+}
+
+static std::string ReplaceExtension(const std::string& path, const char* extension)
+{
+	size_t split = path.find_last_of("./\\");
+	if (split == std::string::npos || path[split] != '.')
+		return path + extension;
+	return path.substr(0, split) + extension;
+}
+
+/// <summary>Lower case extension without the dot, empty if there is none
+/// </summary>
+static std::string GetExtension(const std::string& path)
+{
+	size_t split = path.find_last_of("./\\");
+	if (split == std::string::npos || path[split] != '.')
+		return "";
+	std::string extension = path.substr(split + 1);
+	for (char& c : extension)
+		c = (char)tolower(c);
+	return extension;
+}
+
+static bool IsModel(const std::string& path)
+{
+	std::string extension = GetExtension(path);
+	return extension == "fbx" || extension == "obj";
+}
+
+CookCommand::CookCommand() :
+enabled(false),
+inputPath("Textures"),
+reportPath("cook.log"),
+compressMeshes(true),
+entropy(false)
+{
+
+}
+
+bool CookCommand::ParseCommandLine(const char* cmdLine)
+{
+	if (!cmdLine)
+		return false;
+
+	std::istringstream args(cmdLine);
+	std::string arg;
+	while (args >> arg)
+	{
+		if (arg == "-cook")
+		{
+			enabled = true;
+			continue;
+		}
+
+		size_t split = arg.find('=');
+		if (split == std::string::npos)
+			continue;
+
+		std::string key = arg.substr(0, split);
+		std::string value = arg.substr(split + 1);
+		if (key == "in")
+			inputPath = value;
+		else if (key == "out")
+			outputPath = value;
+		else if (key == "threads")
+			options.threads = (UINT)strtoul(value.c_str(), NULL, 10);
+		else if (key == "srgb")
+			options.srgb = value != "0";
+		else if (key == "mips")
+			options.mips = value != "0";
+		else if (key == "filter")
+			options.mipFilter = value == "kaiser" ? MipKaiser : MipBox;
+		else if (key == "report")
+			reportPath = value;
+		else if (key == "compress")
+			compressMeshes = value != "0";
+		else if (key == "entropy")
+			entropy = value != "0";
+	}
+	return enabled;
+}
+
+int CookCommand::Run()
+{
+	std::vector<std::string> sources;
+	if (!FindSources(sources))
+		return 1;
+
+#if defined(_MSC_VER)
+	if (FAILED(CoInitializeEx(NULL, COINIT_MULTITHREADED)))
+		return 1;
+#endif
+
+	static const char* formatNames[] = { "BC1", "BC3", "BC5" };
+	std::ostringstream report;
+	report << std::fixed << std::setprecision(2);
+
+	UINT failures = 0;
+	UINT textures = 0;
+	UINT64 totalSource = 0;
+	UINT64 totalCooked = 0;
+	double totalSeconds = 0.0;
+	double totalMegapixels = 0.0;
+	for (const std::string& source : sources)
+	{
+		if (IsModel(source))
+		{
+			if (!CookMesh(source, report))
+				failures++;
+			continue;
+		}
+
+		textures++;
+		ImageData image;
+		if (!LoadImageFile(source, image))
+		{
+			report << source << ": could not be decoded\n";
+			failures++;
+			continue;
+		}
+
+		CookOptions imageOptions = options;
+		imageOptions.format = TextureCooker::ChooseFormat(source, image);
+
+		std::vector<BYTE> dds;
+		CookStats stats;
+		std::string output = GetOutputPath(source, ".dds");
+		std::ofstream file(output.c_str(), std::ios::binary);
+		if (!TextureCooker::Cook(image, imageOptions, dds, stats) || !file.write((const char*)&dds[0], dds.size()))
+		{
+			report << source << ": could not be cooked to " << output << "\n";
+			failures++;
+			continue;
+		}
+
+		report << source << " -> " << output << "\n"
+			<< "\t" << formatNames[imageOptions.format] << (options.srgb && imageOptions.format != CookBC5 ? " sRGB" : "")
+			<< ", " << image.width << "x" << image.height << ", " << stats.mipCount << " mips\n"
+			<< "\t" << stats.sourceBytes / 1024 << " KB -> " << stats.cookedBytes / 1024 << " KB ("
+			<< (double)stats.sourceBytes / stats.cookedBytes << ":1)\n"
+			<< "\tPSNR " << stats.psnr << " dB, " << stats.megapixelsPerSecond << " MP/s\n";
+
+		totalSource += stats.sourceBytes;
+		totalCooked += stats.cookedBytes;
+		totalSeconds += stats.seconds;
+		totalMegapixels += stats.megapixelsPerSecond * stats.seconds;
+	}
+
+	report << "\nCooked " << sources.size() - failures << " of " << sources.size() << " files, " << textures << " textures";
+	if (totalCooked > 0)
+	{
+		report << ", " << totalSource / 1024 << " KB -> " << totalCooked / 1024 << " KB ("
+			<< (double)totalSource / totalCooked << ":1), "
+			<< (totalSeconds > 0.0 ? totalMegapixels / totalSeconds : 0.0) << " MP/s";
+	}
+	report << "\n";
+
+#if defined(_MSC_VER)
+	CoUninitialize();
+#endif
+
+	std::ofstream reportFile(reportPath.c_str());
+	reportFile << report.str();
+	OutputDebugStringA(report.str().c_str());
+	return failures == 0 ? 0 : 1;
+}
+
+bool CookCommand::LoadImageFile(const std::string& path, ImageData& image)
+{
+	PNGDecoder png;
+	ImageDecoders decoders;
+	decoders.Add(&png);
+#if defined(_MSC_VER)
+	WICImageDecoder wic;
+	decoders.Add(&wic);
+#endif
+	return decoders.DecodeFile(std::wstring(path.begin(), path.end()), image);
+}
+
+bool CookCommand::CookMesh(const std::string& source, std::ostringstream& report) const
+{
+#if !defined(_MSC_VER)
+	report << source << ": meshes are only cooked by the Windows build\n";
+	return false;
+#else
+	MeshData data;
+	if (!Mesh::Import(source.c_str(), data))
+	{
+		report << source << ": could not be imported\n";
+		return false;
+	}
+	UINT sourceTriangles = (UINT)data.indices.size() / 3;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	Mesh::BuildLODs(data);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::vector<BYTE> cooked;
+	SerializeMesh(data, cooked);
+
+	// Compressed meshes are decoded again before they are written, a file that wouldn't load the same is never shipped
+	std::vector<BYTE> compressed;
+	double decodeSeconds = 0.0;
+	if (compressMeshes)
+	{
+		std::vector<BYTE> decoded(cooked.size());
+		bool encoded = MeshCodec::Encode(&cooked[0], cooked.size(), entropy, compressed);
+		std::chrono::steady_clock::time_point decodeStart = std::chrono::steady_clock::now();
+		if (!encoded || !MeshCodec::Decode(&compressed[0], compressed.size(), &decoded[0], decoded.size()) || decoded != cooked)
+		{
+			report << source << ": did not survive compression\n";
+			return false;
+		}
+		decodeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - decodeStart).count();
+	}
+	const std::vector<BYTE>& written = compressMeshes ? compressed : cooked;
+
+	std::string output = GetOutputPath(source, ".mesh");
+	std::ofstream file(output.c_str(), std::ios::binary);
+	if (!file.write((const char*)&written[0], written.size()))
+	{
+		report << source << ": could not be written to " << output << "\n";
+		return false;
+	}
+
+	report << source << " -> " << output << "\n"
+		<< "\t" << data.vertices.size() << " vertices, " << data.lods.size() << " levels in " << seconds * 1000.0 << " ms ("
+		<< (seconds > 0.0 ? sourceTriangles / seconds / 1000000.0 : 0.0) << " Mtris/s)\n";
+	for (size_t i = 0; i < data.lods.size(); i++)
+	{
+		UINT triangles = data.lods[i].indexCount / 3;
+		report << "\tLOD" << i << ": " << triangles << " triangles (" << 100.0 * triangles / sourceTriangles << "%), error "
+			<< std::setprecision(5) << data.lods[i].error << std::setprecision(2) << "\n";
+	}
+	if (compressMeshes)
+	{
+		report << "\t" << cooked.size() / 1024 << " KB -> " << compressed.size() / 1024 << " KB (" << (double)cooked.size() / compressed.size()
+			<< ":1), decodes at " << (decodeSeconds > 0.0 ? cooked.size() / decodeSeconds / 1000000.0 : 0.0) << " MB/s\n";
+	}
+	return true;
+#endif
+}
+
+bool CookCommand::FindSources(std::vector<std::string>& sources) const
+{
+	if (!IsDirectory(inputPath))
+	{
+		sources.push_back(inputPath);
+		return true;
+	}
+
+	std::vector<std::string> names;
+	if (!ListFiles(inputPath, names))
+		return false;
+
+	// Listing order differs between file systems, sorted the report reads the same everywhere
+	std::sort(names.begin(), names.end());
+	for (const std::string& name : names)
+	{
+		if (GetExtension(name) == "png" || (CooksMeshes && IsModel(name)))
+			sources.push_back(inputPath + "/" + name);
+	}
+	return !sources.empty();
+}
+
+std::string CookCommand::GetOutputPath(const std::string& source, const char* extension) const
+{
+	std::string cooked = ReplaceExtension(GetFileName(source), extension);
+	if (outputPath.empty())
+		return ReplaceExtension(source, extension);
+	if (IsDirectory(outputPath) || IsDirectory(inputPath))
+		return outputPath + "/" + cooked;
+	return outputPath;
+}
@@ -0,0 +1,56 @@
+//
+// Cooks source images to block compressed DDS files, and models to .mesh files with their levels of detail, without opening a window
+// Turned on from the command line: -cook in=Textures out=Textures threads=0 srgb=0 mips=1 filter=box compress=1 entropy=0 report=cook.log
+// in can be a single file or a directory of .png, .fbx and .obj files, out defaults to next to the input
+// Meshes are written through the MeshCodec unless compress=0, entropy=1 adds its Huffman stage
+// Tools/Cook.cpp runs it as a command line tool of its own, which on Linux cooks the textures and leaves models to Windows
+//
+
+#ifndef COOKCOMMAND_H
+#define COOKCOMMAND_H
+
+#include <sstream>
+#include <string>
+#include <vector>
+#include <Windows.h>
+
+#include "TextureCooker.h"
+
+class CookCommand
+{
+public:
+	CookCommand();
+
+	/// <summary>Reads cooker settings from the command line. Returns true if -cook was passed
+	/// </summary>
+	bool ParseCommandLine(const char* cmdLine);
+
+	/// <summary>Cooks every input and writes the report. Returns the process exit code
+	/// </summary>
+	int Run();
+private:
+	/// <summary>Decodes an image file to RGBA, PNGs with the portable decoder and anything else through WIC on Windows
+	/// </summary>
+	static bool LoadImageFile(const std::string& path, ImageData& image);
+
+	/// <summary>Imports a model, simplifies its levels of detail and writes them as a .mesh file
+	/// Returns false with the failure written to the report
+	/// </summary>
+	bool CookMesh(const std::string& source, std::ostringstream& report) const;
+
+	/// <summary>Fills sources with the input file, or every image and model in the input directory
+	/// </summary>
+	bool FindSources(std::vector<std::string>& sources) const;
+
+	std::string GetOutputPath(const std::string& source, const char* extension) const;
+
+	bool enabled;
+	std::string inputPath;
+	std::string outputPath;
+	std::string reportPath;
+	CookOptions options;
+	bool compressMeshes;
+	bool entropy;
+};
+
+#endif
@@ -0,0 +1,3 @@
+// DefaultPixel reading its textures from the atlas texture array
+#define TEXTURE_ARRAY 1
+#include "DefaultPixel.hlsl"
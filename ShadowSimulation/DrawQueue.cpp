@@ -0,0 +1,60 @@
+//
+// Sort stage between culling and submission
+// Orders a pass's draws so objects sharing a material and mesh go back to back. Keys are built from small ids handed
+// out at load rather than from pointers, so the order and the state changes it causes are the same on every run
+//
+
+#include "DrawQueue.h"
+
+#include <algorithm>
+
+// Bits of the key below each part
+static const UINT MaterialShift = 40;
+static const UINT MeshShift = 16;
+
+// Mask for the level of detail, the lowest part of the key
+static const UINT64 LODMask = 0xFFFF;
+
+// Mask for the material and mesh ids
+static const UINT64 IdMask = 0xFFFFFF;
+
+// Key bits that decide state changes, levels of detail share a mesh's buffers
+static const UINT64 StateMask = ~LODMask;
+
+void DrawQueue::Clear()
+{
+	items.clear();
+}
+
+void DrawQueue::Add(UINT material, UINT mesh, UINT lod, UINT object)
+{
+	DrawItem item;
+	item.key = ((material & IdMask) << MaterialShift) | ((mesh & IdMask) << MeshShift) | (lod & LODMask);
+	item.object = object;
+	items.push_back(item);
+}
+
+static bool DrawBefore(const DrawItem& a, const DrawItem& b)
+{
+	return a.key < b.key || (a.key == b.key && a.object < b.object);
+}
+
+void DrawQueue::Sort()
+{
+	// Objects are added in increasing order, so breaking ties on them keeps the sort stable without std::stable_sort's
+	// temporary buffer
+	std::sort(items.begin(), items.end(), DrawBefore);
+}
+
+const std::vector<DrawItem>& DrawQueue::GetItems() const { return items; }
+
+UINT DrawQueue::CountStateChanges() const
+{
+	UINT changes = 0;
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		if (i == 0 || (items[i].key & StateMask) != (items[i - 1].key & StateMask))
+			changes++;
+	}
+	return changes;
+}
@@ -0,0 +1,44 @@
+//
+// Sort stage between culling and submission
+// Orders a pass's draws so objects sharing a material and mesh go back to back. Keys are built from small ids handed
+// out at load rather than from pointers, so the order and the state changes it causes are the same on every run
+//
+
+#ifndef DRAWQUEUE_H
+#define DRAWQUEUE_H
+
+#include <vector>
+#include <Windows.h>
+
+struct DrawItem
+{
+	UINT64 key;
+	UINT object;
+};
+
+class DrawQueue
+{
+public:
+	/// <summary>Empties the queue for a new pass, keeping its memory
+	/// </summary>
+	void Clear();
+
+	/// <summary>Queues an object's draw. Materials sort first since rebinding textures costs most, then meshes, then
+	/// levels of detail. Ids past 24 bits for materials and meshes or 16 bits for levels share a key
+	/// </summary>
+	void Add(UINT material, UINT mesh, UINT lod, UINT object);
+
+	/// <summary>Sorts the draws by key, draws with equal keys keep the order they were added in
+	/// </summary>
+	void Sort();
+
+	const std::vector<DrawItem>& GetItems() const;
+
+	/// <summary>Counts the draws that change material or mesh from the one before, the first draw included
+	/// </summary>
+	UINT CountStateChanges() const;
+private:
+	std::vector<DrawItem> items;
+};
+
+#endif
@@ -0,0 +1,226 @@
+//
+// Creates textures from image files for a TextureCache
+// .dds files go through the DDS loader, PNGs through the portable decoder with a mip chain built on the CPU,
+// and anything else through WIC, unless the image has been cooked to .dds
+//
+
+#include "FileTextureSource.h"
+
+#include <fstream>
+#include <DDSTextureLoader.h>
+#include <WICTextureLoader.h>
+
+#include "Game.h"
+#include "PNGDecoder.h"
+#include "Profiler.h"
+#include "TrackedResources.h"
+
+// Only decoders that are safe on any thread, WIC stays behind CreateWICTextureFromFile
+static const PNGDecoder pngDecoder;
+
+static ImageDecoders CreatePortableDecoders()
+{
+	ImageDecoders decoders;
+	decoders.Add(&pngDecoder);
+	return decoders;
+}
+
+static const ImageDecoders portableDecoders = CreatePortableDecoders();
+
+static bool ReadImageFile(const std::wstring& path, std::vector<BYTE>& data)
+{
+	std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+	if (!file)
+		return false;
+
+	std::streamsize size = file.tellg();
+	if (size <= 0)
+		return false;
+
+	data.resize((size_t)size);
+	file.seekg(0, std::ios::beg);
+	return !!file.read((char*)&data[0], size);
+}
+
+FileTextureSource::FileTextureSource() :
+dev(NULL)
+{
+
+}
+
+void FileTextureSource::SetDevice(ID3D11Device* _dev)
+{
+	dev = _dev;
+}
+
+bool FileTextureSource::CreateTexture(const std::wstring& path, const TextureLoadOptions& options, ID3D11ShaderResourceView** view, UINT64& bytes)
+{
+	PROFILE_ZONE("FileTextureSource::CreateTexture");
+	if (!dev)
+		return false;
+
+	// Images that have been through the texture cooker load from the .dds beside them
+	std::wstring file = path;
+	std::wstring cooked = GetCookedPath(path);
+	if (GetFileAttributesW(cooked.c_str()) != INVALID_FILE_ATTRIBUTES)
+		file = cooked;
+
+	bool dds = file.size() > 4 && _wcsicmp(file.c_str() + file.size() - 4, L".dds") == 0;
+
+	// Paths are ASCII in practice, narrowed for the registry
+	std::string owner(path.begin(), path.end());
+	ID3D11Resource* resource = NULL;
+	HRESULT hr;
+	if (dds)
+	{
+		// Mapped rather than read, so large cooked textures aren't copied through the heap first
+		hr = CreateDDSTextureFromFileMapped(dev, file.c_str(), options.maxSize, 0, 0, D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE,
+			0, 0, options.forceSRGB, &resource, view);
+		if (SUCCEEDED(hr))
+		{
+			TrackedResources::TrackResource(resource, owner.c_str());
+			TrackedResources::Track(*view, MemoryView, owner.c_str(), 0);
+		}
+	}
+	else
+	{
+		std::vector<BYTE> data;
+		DecodedTexture decoded;
+		if (ReadImageFile(file, data) && DecodeImage(file, &data[0], data.size(), options, decoded))
+		{
+			hr = CreateDecodedTexture(dev, decoded.width, decoded.height, decoded.mipCount, &decoded.levels[0], options.forceSRGB,
+				owner.c_str(), &resource, view);
+		}
+		else
+		{
+			hr = CreateWICTextureFromFileEx(dev, file.c_str(), options.maxSize, D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE,
+				0, 0, options.forceSRGB, &resource, view);
+			if (SUCCEEDED(hr))
+			{
+				TrackedResources::TrackResource(resource, owner.c_str());
+				TrackedResources::Track(*view, MemoryView, owner.c_str(), 0);
+			}
+		}
+	}
+	if (FAILED(hr))
+		return false;
+
+	bytes = GetTextureBytes(resource);
+	ReleaseMacro(resource);
+	return true;
+}
+
+std::wstring FileTextureSource::GetCookedPath(const std::wstring& path)
+{
+	size_t extension = path.find_last_of(L"./\\");
+	if (extension == std::wstring::npos || path[extension] != L'.')
+		return path + L".dds";
+	return path.substr(0, extension) + L".dds";
+}
+
+bool FileTextureSource::DecodeImage(const std::wstring& path, const BYTE* data, size_t size, const TextureLoadOptions& options, DecodedTexture& texture)
+{
+	PROFILE_ZONE("FileTextureSource::DecodeImage");
+	ImageData image;
+	if (!portableDecoders.Decode(data, size, image))
+		return false;
+
+	if (options.premultiplyAlpha)
+		ImageConvert::PremultiplyAlpha(&image.rgba[0], (size_t)image.width * image.height);
+
+	std::vector<ImageData> mips;
+	ImageConvert::GenerateMips(image, GetMipContent(path), MipBox, mips);
+
+	// Levels over the size limit are dropped rather than rescaled, the next one down is already filtered
+	size_t first = 0;
+	if (options.maxSize > 0)
+	{
+		while (first + 1 < mips.size() && (mips[first].width > options.maxSize || mips[first].height > options.maxSize))
+			first++;
+	}
+
+	size_t bytes = 0;
+	for (size_t i = first; i < mips.size(); i++)
+		bytes += mips[i].rgba.size();
+
+	texture.width = mips[first].width;
+	texture.height = mips[first].height;
+	texture.mipCount = (UINT)(mips.size() - first);
+	texture.levels.resize(bytes);
+
+	size_t offset = 0;
+	for (size_t i = first; i < mips.size(); i++)
+	{
+		memcpy(&texture.levels[offset], &mips[i].rgba[0], mips[i].rgba.size());
+		offset += mips[i].rgba.size();
+	}
+	return true;
+}
+
+HRESULT FileTextureSource::CreateDecodedTexture(ID3D11Device* dev, UINT width, UINT height, UINT mipCount, const BYTE* levels, bool forceSRGB,
+	const char* owner, ID3D11Resource** texture, ID3D11ShaderResourceView** view)
+{
+	D3D11_TEXTURE2D_DESC desc;
+	ZeroMemory(&desc, sizeof(D3D11_TEXTURE2D_DESC));
+	desc.Width = width;
+	desc.Height = height;
+	desc.MipLevels = mipCount;
+	desc.ArraySize = 1;
+	desc.Format = forceSRGB ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	std::vector<D3D11_SUBRESOURCE_DATA> data(mipCount);
+	for (UINT mip = 0; mip < mipCount; mip++)
+	{
+		data[mip].pSysMem = levels;
+		data[mip].SysMemPitch = width * 4;
+		data[mip].SysMemSlicePitch = 0;
+
+		levels += (size_t)width * height * 4;
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+
+	ID3D11Texture2D* created = NULL;
+	HRESULT hr = TrackedResources::CreateTexture2D(dev, &desc, &data[0], owner, &created);
+	if (FAILED(hr))
+		return hr;
+
+	hr = TrackedResources::CreateShaderResourceView(dev, created, NULL, owner, view);
+	if (FAILED(hr))
+	{
+		ReleaseMacro(created);
+		return hr;
+	}
+
+	*texture = created;
+	return S_OK;
+}
+
+MipContent FileTextureSource::GetMipContent(const std::wstring& path)
+{
+	std::wstring name = path;
+	size_t extension = name.find_last_of(L"./\\");
+	if (extension != std::wstring::npos && name[extension] == L'.')
+		name = name.substr(0, extension);
+
+	if (name.size() > 7 && _wcsicmp(name.c_str() + name.size() - 7, L"_normal") == 0)
+		return MipNormalMap;
+	if (name.size() > 5 && _wcsicmp(name.c_str() + name.size() - 5, L"_bump") == 0)
+		return MipLinear;
+	return MipColor;
+}
+
+UINT64 FileTextureSource::GetTextureBytes(ID3D11Resource* resource)
+{
+	D3D11_RESOURCE_DIMENSION dimension;
+	resource->GetType(&dimension);
+	if (dimension != D3D11_RESOURCE_DIMENSION_TEXTURE2D)
+		return 0;
+
+	D3D11_TEXTURE2D_DESC desc;
+	static_cast<ID3D11Texture2D*>(resource)->GetDesc(&desc);
+	return MemoryRegistry::GetTextureBytes(desc.Width, desc.Height, 1, desc.MipLevels, desc.ArraySize, desc.SampleDesc.Count, desc.Format);
+}
@@ -0,0 +1,57 @@
+//
+// Creates textures from image files for a TextureCache
+// .dds files go through the DDS loader, PNGs through the portable decoder with a mip chain built on the CPU,
+// and anything else through WIC, unless the image has been cooked to .dds
+//
+
+#ifndef FILETEXTURESOURCE_H
+#define FILETEXTURESOURCE_H
+
+#include "ImageConvert.h"
+#include "TextureCache.h"
+
+/// <summary>RGBA8 image with its mip chain packed back to back, largest level first
+/// </summary>
+struct DecodedTexture
+{
+	UINT width;
+	UINT height;
+	UINT mipCount;
+	std::vector<BYTE> levels;
+};
+
+class FileTextureSource : public TextureSource
+{
+public:
+	FileTextureSource();
+
+	void SetDevice(ID3D11Device* dev);
+
+	bool CreateTexture(const std::wstring& path, const TextureLoadOptions& options, ID3D11ShaderResourceView** view, UINT64& bytes);
+
+	/// <summary>Returns the bytes a 2D texture occupies, counting every mip and array slice
+	/// </summary>
+	static UINT64 GetTextureBytes(ID3D11Resource* resource);
+
+	/// <summary>Where the texture cooker writes its output for an image, the same path with a .dds extension
+	/// </summary>
+	static std::wstring GetCookedPath(const std::wstring& path);
+
+	/// <summary>Decodes an image and builds its mips without touching the device, so it can run on any thread
+	/// Returns false for formats only WIC can read
+	/// </summary>
+	static bool DecodeImage(const std::wstring& path, const BYTE* data, size_t size, const TextureLoadOptions& options, DecodedTexture& texture);
+
+	/// <summary>Creates a texture from DecodeImage's mip chain, reported to the MemoryRegistry under owner
+	/// </summary>
+	static HRESULT CreateDecodedTexture(ID3D11Device* dev, UINT width, UINT height, UINT mipCount, const BYTE* levels, bool forceSRGB,
+		const char* owner, ID3D11Resource** texture, ID3D11ShaderResourceView** view);
+
+	/// <summary>Normal maps by their _normal suffix, heights by _bump, everything else is color
+	/// </summary>
+	static MipContent GetMipContent(const std::wstring& path);
+private:
+	ID3D11Device* dev;
+};
+
+#endif
@@ -0,0 +1,83 @@
+//
+// Runs an update callback at a fixed rate on its own thread
+// The callback always receives the same dt, so the simulation does not depend on the frame rate
+//
+
+#include "FixedStepThread.h"
+
+// If the thread falls further behind than this many steps it drops them instead of trying to catch up
+static const int MaxCatchUpSteps = 5;
+
+FixedStepSchedule::FixedStepSchedule() :
+next(Duration::zero()),
+stepDuration(Duration::zero())
+{
+
+}
+
+void FixedStepSchedule::Reset(Duration start, float stepTime)
+{
+	stepDuration = std::chrono::duration_cast<Duration>(std::chrono::duration<float>(stepTime));
+	next = start;
+}
+
+FixedStepSchedule::Duration FixedStepSchedule::Advance(Duration now)
+{
+	next += stepDuration;
+	if (now - next > stepDuration * MaxCatchUpSteps)
+		next = now;
+	return next;
+}
+
+FixedStepSchedule::Duration FixedStepSchedule::GetStepDuration() const { return stepDuration; }
+
+float FixedStepSchedule::GetAlpha(Duration sinceStep, float stepTime)
+{
+	float alpha = std::chrono::duration<float>(sinceStep).count() / stepTime;
+	return alpha < 0.0f ? 0.0f : (alpha > 1.0f ? 1.0f : alpha);
+}
+
+FixedStepThread::FixedStepThread() :
+running(false),
+stepTime(0.0f)
+{
+
+}
+
+FixedStepThread::~FixedStepThread()
+{
+	Stop();
+}
+
+void FixedStepThread::Start(float hz, std::function<void(float)> _step)
+{
+	Stop();
+
+	step = _step;
+	stepTime = 1.0f / hz;
+	running = true;
+	thread = std::thread(&FixedStepThread::Loop, this);
+}
+
+void FixedStepThread::Stop()
+{
+	running = false;
+	if (thread.joinable())
+		thread.join();
+}
+
+bool FixedStepThread::IsRunning() const { return running; }
+float FixedStepThread::GetStepTime() const { return stepTime; }
+
+void FixedStepThread::Loop()
+{
+	typedef std::chrono::steady_clock clock;
+	schedule.Reset(clock::now().time_since_epoch(), stepTime);
+	while (running)
+	{
+		step(stepTime);
+
+		clock::duration next = schedule.Advance(clock::now().time_since_epoch());
+		std::this_thread::sleep_until(clock::time_point(next));
+	}
+}
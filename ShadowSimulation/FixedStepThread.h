@@ -0,0 +1,75 @@
+//
+// Runs an update callback at a fixed rate on its own thread
+// The callback always receives the same dt, so the simulation does not depend on the frame rate
+//
+
+#ifndef FIXEDSTEPTHREAD_H
+#define FIXEDSTEPTHREAD_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+
+/// <summary>Works out when each fixed step is due from times the caller passes in, so the update thread can run it off
+/// steady_clock and tests off a simulated clock
+/// </summary>
+class FixedStepSchedule
+{
+public:
+	typedef std::chrono::steady_clock::duration Duration;
+
+	FixedStepSchedule();
+
+	/// <summary>Starts over with the first step due at start
+	/// </summary>
+	void Reset(Duration start, float stepTime);
+
+	/// <summary>Called once a step has finished at now. Returns when the next step is due, which is now itself if the
+	/// schedule fell too far behind and dropped the steps it missed
+	/// </summary>
+	Duration Advance(Duration now);
+
+	Duration GetStepDuration() const;
+
+	/// <summary>How far the renderer is from the newest state towards the one after it, sinceStep after that state was
+	/// stepped. Clamped to [0, 1] so a late step holds the newest state instead of extrapolating past it
+	/// </summary>
+	static float GetAlpha(Duration sinceStep, float stepTime);
+private:
+	Duration next;
+	Duration stepDuration;
+};
+
+class FixedStepThread
+{
+public:
+	FixedStepThread();
+	~FixedStepThread();
+
+	/// <summary>Starts calling step(1 / hz) hz times per second on a new thread
+	/// </summary>
+	void Start(float hz, std::function<void(float)> step);
+
+	/// <summary>Stops the thread and waits for the step in flight to finish
+	/// </summary>
+	void Stop();
+
+	/// <summary>Returns true while the update thread is running
+	/// </summary>
+	bool IsRunning() const;
+
+	/// <summary>Returns the fixed dt passed to every step
+	/// </summary>
+	float GetStepTime() const;
+private:
+	void Loop();
+
+	FixedStepSchedule schedule;
+	std::thread thread;
+	std::atomic<bool> running;
+	std::function<void(float)> step;
+	float stepTime;
+};
+
+#endif
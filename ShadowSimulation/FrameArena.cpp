@@ -0,0 +1,149 @@
+//
+// Bump allocation for data that only lives for a frame
+//
+
+#include "FrameArena.h"
+
+#include <atomic>
+#include <mutex>
+
+struct FrameArenaThread
+{
+	LinearArena arena;
+	UINT frame;				// Frame the arena was last reset for
+	ArenaStats finished;	// The arena's stats when it was last reset, guarded by threadsMutex
+};
+
+// Shared state, only touched when a thread registers, finishes a frame or stats are read
+static std::mutex threadsMutex;
+static std::vector<FrameArenaThread*> threads;
+
+static std::atomic<UINT> frameIndex(0);
+
+FRAMEARENA_THREAD_LOCAL FrameArenaThread* FrameArena::threadData = 0;
+
+LinearArena::LinearArena(size_t _blockSize) :
+blockSize(_blockSize),
+current(0),
+offset(0)
+{
+
+}
+
+LinearArena::~LinearArena()
+{
+	for (Block& block : blocks)
+		delete[] block.memory;
+}
+
+void* LinearArena::Allocate(size_t bytes, size_t alignment)
+{
+	stats.allocations++;
+	for (;;)
+	{
+		if (current < blocks.size())
+		{
+			// Aligned by address, the blocks themselves are only as aligned as new makes them
+			Block& block = blocks[current];
+			size_t base = (size_t)block.memory;
+			size_t start = ((base + offset + alignment - 1) & ~(alignment - 1)) - base;
+			if (start + bytes <= block.size)
+			{
+				stats.bytes += start + bytes - offset;
+				stats.peakBytes = max(stats.peakBytes, stats.bytes);
+				offset = start + bytes;
+				return block.memory + start;
+			}
+
+			// What's left of the block goes unused this frame, Reset folds it into one block that fits
+			stats.bytes += block.size - offset;
+			if (current + 1 < blocks.size())
+			{
+				current++;
+				offset = 0;
+				continue;
+			}
+		}
+
+		AddBlock(bytes + alignment);
+		current = blocks.size() - 1;
+		offset = 0;
+	}
+}
+
+void LinearArena::Reset()
+{
+	if (blocks.size() > 1)
+	{
+		size_t total = 0;
+		for (Block& block : blocks)
+		{
+			total += block.size;
+			delete[] block.memory;
+		}
+		blocks.clear();
+		AddBlock(total);
+	}
+
+	current = 0;
+	offset = 0;
+	stats.allocations = 0;
+	stats.bytes = 0;
+	stats.heapBlocks = 0;
+}
+
+const ArenaStats& LinearArena::GetStats() const { return stats; }
+
+void LinearArena::AddBlock(size_t minimumSize)
+{
+	Block block;
+	block.size = max(blockSize, minimumSize);
+	block.memory = new BYTE[block.size];
+	blocks.push_back(block);
+	stats.heapBlocks++;
+}
+
+void FrameArena::BeginFrame()
+{
+	frameIndex++;
+}
+
+LinearArena& FrameArena::Get()
+{
+	FrameArenaThread* thread = threadData;
+	if (!thread)
+	{
+		thread = new FrameArenaThread();
+		thread->frame = frameIndex.load(std::memory_order_relaxed);
+
+		std::lock_guard<std::mutex> lock(threadsMutex);
+		threads.push_back(thread);
+		threadData = thread;
+	}
+
+	UINT frame = frameIndex.load(std::memory_order_relaxed);
+	if (thread->frame != frame)
+	{
+		{
+			std::lock_guard<std::mutex> lock(threadsMutex);
+			thread->finished = thread->arena.GetStats();
+		}
+		thread->arena.Reset();
+		thread->frame = frame;
+	}
+	return thread->arena;
+}
+
+ArenaStats FrameArena::GetStats()
+{
+	ArenaStats total;
+	std::lock_guard<std::mutex> lock(threadsMutex);
+	for (const FrameArenaThread* thread : threads)
+	{
+		total.allocations += thread->finished.allocations;
+		total.bytes += thread->finished.bytes;
+		total.peakBytes += thread->finished.peakBytes;
+		total.heapBlocks += thread->finished.heapBlocks;
+	}
+	return total;
+}
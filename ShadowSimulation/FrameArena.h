@@ -0,0 +1,150 @@
+//
+// Bump allocation for data that only lives for a frame
+// Every thread gets its own arena, so allocating never takes a lock. The render thread calls BeginFrame once a frame and
+// each thread's arena is reset the next time that thread asks for it, nothing allocated from it may be kept past that
+// Arenas hold on to their memory between frames, once the largest frame has been seen they stop touching the heap
+//
+
+#ifndef FRAMEARENA_H
+#define FRAMEARENA_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <Windows.h>
+
+#if defined(_MSC_VER)
+#define FRAMEARENA_THREAD_LOCAL __declspec(thread)
+#else
+#define FRAMEARENA_THREAD_LOCAL thread_local
+#endif
+
+struct ArenaStats
+{
+	ArenaStats() : allocations(0), bytes(0), peakBytes(0), heapBlocks(0) {}
+
+	UINT allocations;
+	UINT64 bytes;			// Handed out since the last reset, including alignment padding
+	UINT64 peakBytes;		// Most bytes any frame has used
+	UINT heapBlocks;		// Blocks taken from the heap since the last reset
+};
+
+class LinearArena
+{
+public:
+	LinearArena(size_t blockSize = 256 * 1024);
+	~LinearArena();
+
+	/// <summary>Returns memory that stays valid until Reset. Never fails, a new block is taken if the current one is full
+	/// </summary>
+	void* Allocate(size_t bytes, size_t alignment = 16);
+
+	/// <summary>Uninitialized room for count values of T
+	/// </summary>
+	template <class T>
+	T* AllocateArray(size_t count)
+	{
+		return (T*)Allocate(count * sizeof(T), std::alignment_of<T>::value);
+	}
+
+	/// <summary>Makes all of the arena's memory available again. If the last frame needed more than one block they are
+	/// replaced by a single one large enough for it
+	/// </summary>
+	void Reset();
+
+	const ArenaStats& GetStats() const;
+private:
+	struct Block
+	{
+		BYTE* memory;
+		size_t size;
+	};
+
+	LinearArena(const LinearArena&);
+	LinearArena& operator=(const LinearArena&);
+
+	void AddBlock(size_t minimumSize);
+
+	size_t blockSize;
+	std::vector<Block> blocks;
+	size_t current;		// Block being allocated from
+	size_t offset;		// Next free byte in it
+	ArenaStats stats;
+};
+
+struct FrameArenaThread;
+
+class FrameArena
+{
+public:
+	/// <summary>Starts a new frame. Called once a frame from the render thread
+	/// </summary>
+	static void BeginFrame();
+
+	/// <summary>Returns the calling thread's arena, reset if it was last used in an earlier frame
+	/// </summary>
+	static LinearArena& Get();
+
+	/// <summary>Allocations and bytes of the last frame each thread finished, summed over every thread that has an arena
+	/// </summary>
+	static ArenaStats GetStats();
+private:
+	static FRAMEARENA_THREAD_LOCAL FrameArenaThread* threadData;
+};
+
+/// <summary>Lets standard containers allocate from an arena, by default the calling thread's frame arena
+/// Freeing does nothing, the memory comes back when the arena is reset, so a container must not outlive it
+/// </summary>
+template <class T>
+class ArenaAllocator
+{
+public:
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+
+	template <class U>
+	struct rebind
+	{
+		typedef ArenaAllocator<U> other;
+	};
+
+	ArenaAllocator() : arena(&FrameArena::Get()) {}
+	explicit ArenaAllocator(LinearArena& arena) : arena(&arena) {}
+	template <class U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.GetArena()) {}
+
+	T* allocate(size_t count) { return arena->AllocateArray<T>(count); }
+	void deallocate(T*, size_t) {}
+
+	T* address(T& value) const { return &value; }
+	const T* address(const T& value) const { return &value; }
+	size_t max_size() const { return ((size_t)-1) / sizeof(T); }
+	template <class U, class... Args>
+	void construct(U* p, Args&&... args) { ::new((void*)p) U(std::forward<Args>(args)...); }
+	template <class U>
+	void destroy(U* p) { p->~U(); }
+
+	LinearArena* GetArena() const { return arena; }
+private:
+	LinearArena* arena;
+};
+
+template <class T, class U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.GetArena() == b.GetArena(); }
+
+template <class T, class U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.GetArena() != b.GetArena(); }
+
+/// <summary>Vector in the calling thread's frame arena, only for locals that are gone by the end of the frame
+/// </summary>
+template <class T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif
@@ -22,7 +22,10 @@ cbuffer perObject : register(b1)
 	LightMaterial lightMat;
 	float tileX;
 	float tileZ;
-	float padO[2];
+	uint diffuseSlice;
+	uint normalSlice;
+	float4 diffuseRect;
+	float4 normalRect;
 };
 
 struct VertexInput
@@ -5,6 +5,8 @@
 
 #include "Game.h"
 #include "Timer.h"
+#include "Profiler.h"
+#include "TrackedResources.h"
 //
 // Global Callback Function
 //
@@ -27,7 +29,8 @@ swapChain(0),
 depthStencilBuffer(0),
 renderTargetView(0),
 depthStencilView(0),
-deltaTime(0)
+deltaTime(0),
+updateRate(0)
 {
 	ZeroMemory(&viewport, sizeof(D3D11_VIEWPORT));
 	game = this;
@@ -171,7 +174,8 @@ void Game::OnResize()
 		NULL);
 	ID3D11Texture2D* backBuffer;
 	swapChain->GetBuffer(NULL, __uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&backBuffer));
-	dev->CreateRenderTargetView(backBuffer, 0, &renderTargetView);
+	TrackedResources::TrackResource(backBuffer, "SwapChain");
+	TrackedResources::CreateRenderTargetView(dev, backBuffer, 0, "SwapChain", &renderTargetView);
 	ReleaseMacro(backBuffer);
 
 	D3D11_TEXTURE2D_DESC dsd;
@@ -187,8 +191,8 @@ void Game::OnResize()
 	dsd.MiscFlags		 = NULL;
 	dsd.SampleDesc.Count = 4;
 
-	dev->CreateTexture2D(&dsd, NULL, &depthStencilBuffer);
-	dev->CreateDepthStencilView(depthStencilBuffer, NULL, &depthStencilView);
+	TrackedResources::CreateTexture2D(dev, &dsd, NULL, "SwapChain", &depthStencilBuffer);
+	TrackedResources::CreateDepthStencilView(dev, depthStencilBuffer, NULL, "SwapChain", &depthStencilView);
 	devCon->OMSetRenderTargets(1, &renderTargetView, depthStencilView);
 
 	viewport.TopLeftX = 0;
@@ -203,24 +207,38 @@ void Game::OnResize()
 int Game::Run()
 {
 	MSG msg = { 0 };
+
+	// Simulation gets its own thread when a fixed rate is set, so a slow Draw can't slow it down
+	if (updateRate > 0.0f)
+		updateThread.Start(updateRate, [this](float dt){ Update(dt); });
+
 	while (msg.message != WM_QUIT)
 	{
 		Timer::StartFrame();
-		if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+		Profiler::BeginFrame();
+
+		// Drain every pending message, then render once
+		while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
 		{
 			TranslateMessage(&msg);
 			DispatchMessage(&msg);
+			if (msg.message == WM_QUIT)
+				break;
 		}
-		else
-		{
-			Update(Timer::GetFrameTime());
-			Draw();
-		}
+		if (msg.message == WM_QUIT)
+			break;
+
+		if (!updateThread.IsRunning())
+			Update(deltaTime);
+		Draw();
 
 		Timer::StopFrame();
 		deltaTime = Timer::GetFrameTime();
+		MemoryRegistry::Global().Update(deltaTime);
 	}
 
+	updateThread.Stop();
+	MemoryRegistry::Global().WriteSnapshot();
 	return (int)msg.wParam;
 }
 
@@ -11,6 +11,8 @@
 #include <Windows.h>
 #include <string>
 
+#include "FixedStepThread.h"
+
 #define ReleaseMacro(x) { if(x){ x->Release(); x = 0; } }
 
 class Game
@@ -36,6 +38,7 @@ public:
 	virtual void OnResize();
 
 	/// <summary>Pure virtual function to update game logic
+	/// Called on the update thread at updateRate Hz, or once per frame if updateRate is 0
 	/// </summary>
 	virtual void Update(float dt) = 0;
 
@@ -57,6 +60,10 @@ protected:
 
 	float deltaTime;
 
+	// Fixed simulation rate in Hz. 0 runs Update in lockstep with Draw on the main thread
+	float updateRate;
+	FixedStepThread updateThread;
+
 	// Handlers to our instance and window
 	HINSTANCE hInstance;
 	HWND	  hWnd;
@@ -6,13 +6,19 @@
 #include "Game.h"
 
 GameObject::GameObject(Mesh* mesh):
-mesh(mesh)
+mesh(mesh),
+mat(NULL),
+srv(NULL),
+sampler(NULL)
 {
-	vBuffer = mesh->GetVertexBuffer();
-	iBuffer = mesh->GetIndexBuffer();
-
 	stride = sizeof(Vertex);
 	offset = 0;
+	occluderFill = 0.0f;
+	isStatic = false;
+	lod = 0;
+	culledIndices = NULL;
+	culledStart = 0;
+	culledCount = 0;
 
 	worldMat = {
 		1.0, 0.0, 0.0, 0.0,
@@ -25,13 +31,24 @@ mesh(mesh)
 }
 
 GameObject::GameObject(Material* mat) :
+mesh(NULL),
 mat(mat)
 {
 	srv = mat->GetSRV();
 	sampler = mat->GetSampler();
+	if (srv)
+		srv->AddRef();
+	if (sampler)
+		sampler->AddRef();
 
 	stride = sizeof(Vertex);
 	offset = 0;
+	occluderFill = 0.0f;
+	isStatic = false;
+	lod = 0;
+	culledIndices = NULL;
+	culledStart = 0;
+	culledCount = 0;
 
 	XMStoreFloat4x4(&worldMat, XMMatrixIdentity());
 	position = { 0.0, 0.0, 0.0 };
@@ -43,13 +60,21 @@ GameObject::GameObject(Mesh* mesh, Material* mat) :
 mesh(mesh),
 mat(mat)
 {
-	vBuffer = mesh->GetVertexBuffer();
-	iBuffer = mesh->GetIndexBuffer();
 	srv = mat->GetSRV();
 	sampler = mat->GetSampler();
+	if (srv)
+		srv->AddRef();
+	if (sampler)
+		sampler->AddRef();
 
 	stride = sizeof(Vertex);
 	offset = 0;
+	occluderFill = 0.0f;
+	isStatic = false;
+	lod = 0;
+	culledIndices = NULL;
+	culledStart = 0;
+	culledCount = 0;
 
 	worldMat = {
 		1.0, 0.0, 0.0, 0.0,
@@ -61,15 +86,25 @@ mat(mat)
 	scale = { 1.0, 1.0, 1.0 };
 }
 
-GameObject::GameObject(Mesh* mesh, Material* mat, LightMaterial* lightMat)
+GameObject::GameObject(Mesh* mesh, Material* mat, LightMaterial* lightMat) :
+mesh(mesh),
+mat(mat)
 {
-	vBuffer = mesh->GetVertexBuffer();
-	iBuffer = mesh->GetIndexBuffer();
 	srv = mat->GetSRV();
 	sampler = mat->GetSampler();
+	if (srv)
+		srv->AddRef();
+	if (sampler)
+		sampler->AddRef();
 
 	stride = sizeof(Vertex);
 	offset = 0;
+	occluderFill = 0.0f;
+	isStatic = false;
+	lod = 0;
+	culledIndices = NULL;
+	culledStart = 0;
+	culledCount = 0;
 
 	worldMat = {
 		1.0, 0.0, 0.0, 0.0,
@@ -83,8 +118,6 @@ GameObject::GameObject(Mesh* mesh, Material* mat, LightMaterial* lightMat)
 
 GameObject::~GameObject()
 {
-	ReleaseMacro(vBuffer);
-	ReleaseMacro(iBuffer);
 	ReleaseMacro(srv);
 	ReleaseMacro(sampler);
 }
@@ -108,19 +141,43 @@ void GameObject::Update(float dt)
 	XMStoreFloat4x4(&worldMat, scaleM * rotationX * rotationY * rotationZ * translation);
 }
 
-void GameObject::Draw(ID3D11DeviceContext* devCon)
+UINT GameObject::Draw(ID3D11DeviceContext* devCon, TextureBindings* bindings, GeometryBindings* geometry)
 {
 	mat->SetShader(devCon);
 	if (shadowPass)
 		devCon->PSSetShader(0, 0, 0);
 	mat->SetSampler(devCon);
-	mat->SetResources(devCon);
-	if (vBuffer)
+	UINT binds = mat->SetResources(devCon, bindings);
+	// Fetched every draw, streamed meshes swap their geometry when data arrives and the pool may move it
+	ID3D11Buffer* vBuffer = mesh->GetVertexBuffer();
+	ID3D11Buffer* iBuffer = culledIndices ? culledIndices : mesh->GetIndexBuffer();
+	if (vBuffer && (!geometry || geometry->vertexBuffer != vBuffer))
+	{
 		devCon->IASetVertexBuffers(0, 1, &vBuffer, &stride, &offset);
-	if (iBuffer)
+		if (geometry)
+		{
+			geometry->vertexBuffer = vBuffer;
+			geometry->binds++;
+		}
+	}
+	if (iBuffer && (!geometry || geometry->indexBuffer != iBuffer))
+	{
 		devCon->IASetIndexBuffer(iBuffer, DXGI_FORMAT_R32_UINT, 0);
+		if (geometry)
+		{
+			geometry->indexBuffer = iBuffer;
+			geometry->binds++;
+		}
+	}
 
-	devCon->DrawIndexed(mesh->numIndices, 0, 0);
+	if (culledIndices)
+	{
+		devCon->DrawIndexed(culledCount, culledStart, mesh->GetBaseVertex());
+		return binds;
+	}
+	const MeshLOD& range = mesh->GetLOD(lod);
+	devCon->DrawIndexed(range.indexCount, mesh->GetStartIndex() + range.indexStart, mesh->GetBaseVertex());
+	return binds;
 }
 
 void GameObject::SetPosition(XMFLOAT3 newPosition)
@@ -146,11 +203,17 @@ void GameObject::SetRotation(XMFLOAT3 newRotation)
 
 void GameObject::SetSampler(ID3D11SamplerState* _sampler)
 {
+	if (_sampler)
+		_sampler->AddRef();
+	ReleaseMacro(sampler);
 	sampler = _sampler;
 }
 
 void GameObject::SetSRV(ID3D11ShaderResourceView* _srv)
 {
+	if (_srv)
+		_srv->AddRef();
+	ReleaseMacro(srv);
 	srv = _srv;
 }
 
@@ -162,4 +225,42 @@ void GameObject::SetShadowPass(bool val)
 float const GameObject::GetTextureTileX(){ if (mat){ return mat->GetTileX(); } }
 float const GameObject::GetTextureTileZ(){ if (mat){ return mat->GetTileZ(); } }
 XMFLOAT4X4 const GameObject::GetWorldMatrix() { return worldMat; }
-LightMaterial const GameObject::GetLightMaterial(){ return mat->GetLightMaterial(); }
\ No newline at end of file
+LightMaterial const GameObject::GetLightMaterial(){ return mat->GetLightMaterial(); }
+Mesh* GameObject::GetMesh() const { return mesh; }
+Material* GameObject::GetMaterial() const { return mat; }
+
+void GameObject::SetOccluder(float fill) { occluderFill = fill; }
+
+float GameObject::GetOccluderFill() const { return occluderFill; }
+
+void GameObject::SetStatic(bool value) { isStatic = value; }
+
+bool GameObject::IsStatic() const { return isStatic; }
+
+void GameObject::SetLOD(UINT level) { lod = level; }
+
+UINT GameObject::GetLOD() const { return lod; }
+
+void GameObject::SetCulledIndices(ID3D11Buffer* buffer, UINT indexStart, UINT indexCount)
+{
+	culledIndices = buffer;
+	culledStart = indexStart;
+	culledCount = indexCount;
+}
+
+UINT GameObject::GetIndexCount() const
+{
+	return culledIndices ? culledCount : mesh->GetLOD(lod).indexCount;
+}
+
+TransformState GameObject::GetTransform() const
+{
+	TransformState transform;
+	transform.position = position;
+	transform.scale = scale;
+
+	// Same rotation order as Update
+	XMMATRIX rotationM = XMMatrixRotationX(rotation.x) * XMMatrixRotationY(rotation.y) * XMMatrixRotationZ(rotation.z);
+	XMStoreFloat4(&transform.orientation, XMQuaternionRotationMatrix(rotationM));
+	return transform;
+}
\ No newline at end of file
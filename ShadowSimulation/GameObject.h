@@ -11,6 +11,7 @@
 #include "Mesh.h"
 #include "Material.h"
 #include "Lights.h"
+#include "SimulationState.h"
 
 using namespace DirectX;
 
@@ -30,9 +31,10 @@ public:
 	/// </summary>
 	virtual void Update(float dt);
 
-	/// <summary>Sets proper graphics pipeline values and renders the object
+	/// <summary>Sets proper graphics pipeline values and renders the object. Returns the texture slots it had to bind
+	/// With geometry, vertex and index buffers that are already bound are skipped and the ones bound are counted
 	/// </summary>
-	virtual void Draw(ID3D11DeviceContext* devCon);
+	virtual UINT Draw(ID3D11DeviceContext* devCon, TextureBindings* bindings = NULL, GeometryBindings* geometry = NULL);
 
 	/// <summary>Sets the position of the object to the new value
 	/// </summary>
@@ -73,16 +75,60 @@ public:
 	/// <summary>Returns the object's light material
 	/// </summary>
 	LightMaterial const GetLightMaterial();
+
+	/// <summary>Returns the mesh the object draws
+	/// </summary>
+	Mesh* GetMesh() const;
+
+	/// <summary>Returns the material the object draws with
+	/// </summary>
+	Material* GetMaterial() const;
+
+	/// <summary>Marks the object as an occluder. Its mesh bounds scaled by fill about their center must lie inside the mesh,
+	/// 1 for a solid box, 0 (the default) for objects that don't occlude
+	/// </summary>
+	void SetOccluder(float fill);
+
+	float GetOccluderFill() const;
+
+	/// <summary>Marks the object as never moving once the scene is loaded, so it may be merged into a static batch
+	/// </summary>
+	void SetStatic(bool value);
+
+	bool IsStatic() const;
+
+	/// <summary>Sets the level of detail the next draw uses, levels past the mesh's coarsest draw the coarsest
+	/// </summary>
+	void SetLOD(UINT level);
+
+	UINT GetLOD() const;
+
+	/// <summary>Makes the next draws take indexCount indices at indexStart of buffer instead of the level of detail, as left by
+	/// meshlet culling. The indices are relative to the mesh's first vertex. NULL draws the level again
+	/// </summary>
+	void SetCulledIndices(ID3D11Buffer* buffer, UINT indexStart, UINT indexCount);
+
+	/// <summary>Returns how many indices the next draw submits
+	/// </summary>
+	UINT GetIndexCount() const;
+
+	/// <summary>Returns the object's position, orientation and scale for snapshotting
+	/// </summary>
+	TransformState GetTransform() const;
 protected:
 	Mesh* mesh;
 	Material* mat;
 
 	bool shadowPass;
+	float occluderFill;
+	bool isStatic;
+	UINT lod;
+	ID3D11Buffer* culledIndices;	// Not referenced, it belongs to the culler and is only set for the pass that filled it
+	UINT culledStart;
+	UINT culledCount;
 	UINT stride;
 	UINT offset;
 
-	ID3D11Buffer* vBuffer;
-	ID3D11Buffer* iBuffer;
 	ID3D11ShaderResourceView* srv;
 	ID3D11SamplerState* sampler;
 
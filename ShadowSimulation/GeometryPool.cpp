@@ -0,0 +1,344 @@
+//
+// Shared vertex and index buffers meshes are sub-allocated from
+//
+
+#include "GeometryPool.h"
+
+#include <cstdlib>
+#include <sstream>
+#include <string>
+
+#include "Game.h"
+#include "Mesh.h"
+#include "Profiler.h"
+#include "TrackedResources.h"
+
+// Size of the shared vertex buffer to start with, the index buffer gets this many indices per vertex
+static const UINT64 InitialVertexBytes = 4 * 1024 * 1024;
+static const UINT IndicesPerVertex = 2;
+
+// Largest buffer every D3D11 device has to support
+static const UINT64 MaxBufferBytes = 128 * 1024 * 1024;
+
+// Fragmentation is only worth a compaction once this much of a buffer is free and the largest free range is under this
+// fraction of it. After a compaction all of it is one range, so the pool can't keep compacting
+static const float CompactFreeFraction = 0.25f;
+static const float CompactLargestFraction = 0.5f;
+
+GeometryPool::GeometryPool() :
+dev(NULL),
+devCon(NULL),
+enabled(true),
+initialVertexBytes(InitialVertexBytes),
+freeEntries(RangeAllocator::Invalid),
+meshes(0),
+grows(0),
+compactions(0),
+bytesMoved(0)
+{
+	vertices.buffer = NULL;
+	vertices.stride = sizeof(Vertex);
+	vertices.bindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vertices.owner = "GeometryPool";
+	indices.buffer = NULL;
+	indices.stride = sizeof(UINT);
+	indices.bindFlags = D3D11_BIND_INDEX_BUFFER;
+	indices.owner = "GeometryPool";
+}
+
+GeometryPool::~GeometryPool()
+{
+	for (Entry& entry : entries)
+	{
+		ReleaseMacro(entry.vertexBuffer);
+		ReleaseMacro(entry.indexBuffer);
+	}
+	ReleaseMacro(vertices.buffer);
+	ReleaseMacro(indices.buffer);
+}
+
+void GeometryPool::ParseCommandLine(const char* cmdLine)
+{
+	if (!cmdLine)
+		return;
+
+	std::istringstream args(cmdLine);
+	std::string arg;
+	while (args >> arg)
+	{
+		size_t split = arg.find('=');
+		if (split == std::string::npos)
+			continue;
+
+		std::string key = arg.substr(0, split);
+		std::string value = arg.substr(split + 1);
+		if (key == "geometrypool")
+			enabled = value != "0";
+		else if (key == "geometrypoolmb")
+			initialVertexBytes = (UINT64)(max(atof(value.c_str()), 1.0) * 1024 * 1024);
+	}
+}
+
+bool GeometryPool::Initialize(ID3D11Device* _dev, ID3D11DeviceContext* _devCon)
+{
+	dev = _dev;
+	devCon = _devCon;
+	if (!enabled)
+		return true;
+
+	UINT vertexCapacity = (UINT)(initialVertexBytes / sizeof(Vertex));
+	vertices.ranges.Reset(vertexCapacity);
+	indices.ranges.Reset(vertexCapacity * IndicesPerVertex);
+	vertices.buffer = CreateBuffer(vertices, vertices.ranges.GetCapacity());
+	indices.buffer = CreateBuffer(indices, indices.ranges.GetCapacity());
+	return vertices.buffer && indices.buffer;
+}
+
+bool GeometryPool::IsEnabled() const { return enabled; }
+
+GeometryHandle GeometryPool::Add(const Vertex* vertexData, UINT numVertices, const UINT* indexData, UINT numIndices, const char* owner)
+{
+	if (numVertices == 0 || numIndices == 0)
+		return 0;
+
+	Entry entry;
+	entry.refs = 1;
+	entry.vertexRange = RangeAllocator::Invalid;
+	entry.indexRange = RangeAllocator::Invalid;
+	entry.vertexBuffer = NULL;
+	entry.indexBuffer = NULL;
+	entry.nextFree = RangeAllocator::Invalid;
+
+	if (!enabled)
+	{
+		if (!Mesh::CreateBuffers(vertexData, numVertices, indexData, numIndices, dev, owner, &entry.vertexBuffer, &entry.indexBuffer))
+			return 0;
+	}
+	else
+	{
+		PROFILE_ZONE("GeometryPool::Add");
+		entry.vertexRange = Allocate(vertices, numVertices);
+		if (entry.vertexRange == RangeAllocator::Invalid)
+			return 0;
+		entry.indexRange = Allocate(indices, numIndices);
+		if (entry.indexRange == RangeAllocator::Invalid)
+		{
+			vertices.ranges.Free(entry.vertexRange);
+			return 0;
+		}
+
+		UINT vertexOffset = vertices.ranges.GetOffset(entry.vertexRange);
+		D3D11_BOX box = { vertexOffset * sizeof(Vertex), 0, 0, (vertexOffset + numVertices) * sizeof(Vertex), 1, 1 };
+		devCon->UpdateSubresource(vertices.buffer, 0, &box, vertexData, 0, 0);
+
+		UINT indexOffset = indices.ranges.GetOffset(entry.indexRange);
+		box.left = indexOffset * sizeof(UINT);
+		box.right = (indexOffset + numIndices) * sizeof(UINT);
+		devCon->UpdateSubresource(indices.buffer, 0, &box, indexData, 0, 0);
+	}
+
+	UINT slot = freeEntries;
+	if (slot != RangeAllocator::Invalid)
+	{
+		freeEntries = entries[slot].nextFree;
+		entries[slot] = entry;
+	}
+	else
+	{
+		slot = (UINT)entries.size();
+		entries.push_back(entry);
+	}
+	meshes++;
+	return slot + 1;
+}
+
+void GeometryPool::AddRef(GeometryHandle handle)
+{
+	if (handle)
+		entries[handle - 1].refs++;
+}
+
+void GeometryPool::Release(GeometryHandle handle)
+{
+	if (!handle)
+		return;
+
+	Entry& entry = entries[handle - 1];
+	if (--entry.refs > 0)
+		return;
+
+	if (enabled)
+	{
+		vertices.ranges.Free(entry.vertexRange);
+		indices.ranges.Free(entry.indexRange);
+	}
+	ReleaseMacro(entry.vertexBuffer);
+	ReleaseMacro(entry.indexBuffer);
+	entry.nextFree = freeEntries;
+	freeEntries = handle - 1;
+	meshes--;
+}
+
+ID3D11Buffer* GeometryPool::GetVertexBuffer(GeometryHandle handle) const
+{
+	if (!handle)
+		return NULL;
+	return enabled ? vertices.buffer : GetEntry(handle).vertexBuffer;
+}
+
+ID3D11Buffer* GeometryPool::GetIndexBuffer(GeometryHandle handle) const
+{
+	if (!handle)
+		return NULL;
+	return enabled ? indices.buffer : GetEntry(handle).indexBuffer;
+}
+
+UINT GeometryPool::GetBaseVertex(GeometryHandle handle) const
+{
+	if (!handle || !enabled)
+		return 0;
+	return vertices.ranges.GetOffset(GetEntry(handle).vertexRange);
+}
+
+UINT GeometryPool::GetStartIndex(GeometryHandle handle) const
+{
+	if (!handle || !enabled)
+		return 0;
+	return indices.ranges.GetOffset(GetEntry(handle).indexRange);
+}
+
+void GeometryPool::Update()
+{
+	if (!enabled)
+		return;
+
+	Space* spaces[] = { &vertices, &indices };
+	for (Space* space : spaces)
+	{
+		RangeAllocatorStats stats = space->ranges.GetStats();
+		UINT free = stats.capacity - stats.used;
+		if (free >= stats.capacity * CompactFreeFraction && stats.largestFree < free * CompactLargestFraction)
+		{
+			PROFILE_ZONE("GeometryPool::Compact");
+			if (Rebuild(*space, stats.capacity))
+				compactions++;
+		}
+	}
+}
+
+void GeometryPool::Compact()
+{
+	if (!enabled)
+		return;
+
+	PROFILE_ZONE("GeometryPool::Compact");
+	Rebuild(vertices, vertices.ranges.GetCapacity());
+	Rebuild(indices, indices.ranges.GetCapacity());
+	compactions++;
+}
+
+GeometryPoolStats GeometryPool::GetStats() const
+{
+	GeometryPoolStats stats;
+	stats.meshes = meshes;
+	if (enabled)
+	{
+		RangeAllocatorStats vertexStats = vertices.ranges.GetStats();
+		RangeAllocatorStats indexStats = indices.ranges.GetStats();
+		stats.vertexBytes = (UINT64)vertexStats.capacity * sizeof(Vertex);
+		stats.indexBytes = (UINT64)indexStats.capacity * sizeof(UINT);
+		stats.usedVertexBytes = (UINT64)vertexStats.used * sizeof(Vertex);
+		stats.usedIndexBytes = (UINT64)indexStats.used * sizeof(UINT);
+		stats.freeRanges = vertexStats.freeRanges + indexStats.freeRanges;
+	}
+	stats.grows = grows;
+	stats.compactions = compactions;
+	stats.bytesMoved = bytesMoved;
+	return stats;
+}
+
+UINT GeometryPool::Allocate(Space& space, UINT size)
+{
+	UINT range = space.ranges.Allocate(size);
+	if (range != RangeAllocator::Invalid)
+		return range;
+
+	// Enough room in all, just not in one piece, packing the ranges is enough. Otherwise the space doubles
+	RangeAllocatorStats stats = space.ranges.GetStats();
+	UINT capacity = stats.capacity;
+	if (stats.capacity - stats.used < size)
+	{
+		UINT64 grown = max((UINT64)stats.capacity * 2, (UINT64)stats.used + size);
+		if (grown * space.stride > MaxBufferBytes)
+			return RangeAllocator::Invalid;
+		capacity = (UINT)grown;
+	}
+
+	PROFILE_ZONE("GeometryPool::Rebuild");
+	if (!Rebuild(space, capacity))
+		return RangeAllocator::Invalid;
+	if (capacity > stats.capacity)
+		grows++;
+	else
+		compactions++;
+	return space.ranges.Allocate(size);
+}
+
+bool GeometryPool::Rebuild(Space& space, UINT capacity)
+{
+	ID3D11Buffer* buffer = CreateBuffer(space, capacity);
+	if (!buffer)
+		return false;
+
+	std::vector<RangeMove> moves;
+	space.ranges.Compact(moves);
+	space.ranges.Grow(capacity);
+
+	// Ranges ahead of the first gap keep their offsets, once one has moved every range after it has as well
+	RangeAllocatorStats stats = space.ranges.GetStats();
+	UINT unmoved = moves.empty() ? stats.used : moves[0].to;
+	D3D11_BOX box = { 0, 0, 0, 0, 1, 1 };
+	if (unmoved > 0)
+	{
+		box.right = unmoved * space.stride;
+		devCon->CopySubresourceRegion(buffer, 0, 0, 0, 0, space.buffer, 0, &box);
+	}
+
+	// Ranges that were neighbours before go in one copy
+	for (size_t i = 0; i < moves.size();)
+	{
+		UINT from = moves[i].from;
+		UINT to = moves[i].to;
+		UINT size = moves[i].size;
+		for (i++; i < moves.size() && moves[i].from == from + size && moves[i].to == to + size; i++)
+			size += moves[i].size;
+
+		box.left = from * space.stride;
+		box.right = (from + size) * space.stride;
+		devCon->CopySubresourceRegion(buffer, 0, to * space.stride, 0, 0, space.buffer, 0, &box);
+	}
+	bytesMoved += (UINT64)stats.used * space.stride;
+
+	ReleaseMacro(space.buffer);
+	space.buffer = buffer;
+	return true;
+}
+
+ID3D11Buffer* GeometryPool::CreateBuffer(const Space& space, UINT capacity)
+{
+	D3D11_BUFFER_DESC desc;
+	ZeroMemory(&desc, sizeof(D3D11_BUFFER_DESC));
+	desc.ByteWidth = capacity * space.stride;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = space.bindFlags;
+
+	ID3D11Buffer* buffer = NULL;
+	if (FAILED(TrackedResources::CreateBuffer(dev, &desc, NULL, space.owner, &buffer)))
+		return NULL;
+	return buffer;
+}
+
+const GeometryPool::Entry& GeometryPool::GetEntry(GeometryHandle handle) const
+{
+	return entries[handle - 1];
+}
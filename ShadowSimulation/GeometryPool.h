@@ -0,0 +1,146 @@
+//
+// Shared vertex and index buffers meshes are sub-allocated from, so consecutive draws rarely rebind the input assembler
+// Each mesh gets a range of vertices and a range of indices, drawn with its base vertex and start index. Indices stay
+// relative to the mesh's first vertex
+// Running out of room grows the buffers, and when freed ranges leave the space too fragmented the pool is compacted.
+// Both copy every live range into new buffers on the GPU, so handles stay valid but offsets and buffers may change
+// Command line: geometrypool=0 gives every mesh buffers of its own as before, geometrypoolmb=<vertex buffer MB to start with>
+//
+
+#ifndef GEOMETRYPOOL_H
+#define GEOMETRYPOOL_H
+
+#include <d3d11.h>
+#include <vector>
+
+#include "RangeAllocator.h"
+#include "Vertex.h"
+
+typedef UINT GeometryHandle;	// 0 is never handed out
+
+/// <summary>Buffers last bound to the input assembler, lets draws skip rebinding them
+/// Reset it whenever something else may have bound buffers
+/// </summary>
+struct GeometryBindings
+{
+	GeometryBindings() : binds(0) { Reset(); }
+
+	void Reset()
+	{
+		vertexBuffer = NULL;
+		indexBuffer = NULL;
+	}
+
+	ID3D11Buffer* vertexBuffer;
+	ID3D11Buffer* indexBuffer;
+	UINT binds;		// Buffers bound since this was made, for stats
+};
+
+struct GeometryPoolStats
+{
+	GeometryPoolStats() : meshes(0), vertexBytes(0), indexBytes(0), usedVertexBytes(0), usedIndexBytes(0), freeRanges(0), grows(0),
+		compactions(0), bytesMoved(0) {}
+
+	UINT meshes;
+	UINT64 vertexBytes;		// Size of the shared buffers
+	UINT64 indexBytes;
+	UINT64 usedVertexBytes;
+	UINT64 usedIndexBytes;
+	UINT freeRanges;
+	UINT grows;
+	UINT compactions;
+	UINT64 bytesMoved;		// Copied on the GPU by grows and compactions
+};
+
+class GeometryPool
+{
+public:
+	GeometryPool();
+	~GeometryPool();
+
+	void ParseCommandLine(const char* cmdLine);
+
+	/// <summary>Creates the shared buffers. Everything else uses the immediate context, so only the render thread may call in
+	/// </summary>
+	bool Initialize(ID3D11Device* dev, ID3D11DeviceContext* devCon);
+
+	bool IsEnabled() const;
+
+	/// <summary>Uploads a mesh and returns a handle holding one reference, 0 if it couldn't be placed
+	/// </summary>
+	GeometryHandle Add(const Vertex* vertices, UINT numVertices, const UINT* indices, UINT numIndices, const char* owner);
+
+	void AddRef(GeometryHandle handle);
+
+	/// <summary>Gives the mesh's ranges back once the last reference goes
+	/// </summary>
+	void Release(GeometryHandle handle);
+
+	ID3D11Buffer* GetVertexBuffer(GeometryHandle handle) const;
+	ID3D11Buffer* GetIndexBuffer(GeometryHandle handle) const;
+	UINT GetBaseVertex(GeometryHandle handle) const;
+	UINT GetStartIndex(GeometryHandle handle) const;
+
+	/// <summary>Compacts the buffers if freed ranges have left them too fragmented. Called once a frame, outside any pass
+	/// </summary>
+	void Update();
+
+	/// <summary>Packs every mesh to the front of new buffers of the same size
+	/// </summary>
+	void Compact();
+
+	GeometryPoolStats GetStats() const;
+private:
+	struct Entry
+	{
+		UINT refs;					// 0 while the entry is unused
+		UINT vertexRange;
+		UINT indexRange;
+		ID3D11Buffer* vertexBuffer;	// Only with the pool turned off
+		ID3D11Buffer* indexBuffer;
+		UINT nextFree;				// Unused entries, linked by index
+	};
+
+	/// <summary>Uploads to a range of one of the shared buffers
+	/// </summary>
+	struct Space
+	{
+		RangeAllocator ranges;
+		ID3D11Buffer* buffer;
+		UINT stride;
+		UINT bindFlags;
+		const char* owner;
+	};
+
+	GeometryPool(const GeometryPool&);
+	GeometryPool& operator=(const GeometryPool&);
+
+	/// <summary>Finds room for size elements, compacting or growing the space if it has to. Returns the range or Invalid
+	/// </summary>
+	UINT Allocate(Space& space, UINT size);
+
+	/// <summary>Copies every live range into a new buffer of capacity elements, packed to the front
+	/// </summary>
+	bool Rebuild(Space& space, UINT capacity);
+
+	ID3D11Buffer* CreateBuffer(const Space& space, UINT capacity);
+
+	const Entry& GetEntry(GeometryHandle handle) const;
+
+	ID3D11Device* dev;
+	ID3D11DeviceContext* devCon;
+	bool enabled;
+	UINT64 initialVertexBytes;
+
+	Space vertices;
+	Space indices;
+
+	std::vector<Entry> entries;
+	UINT freeEntries;
+	UINT meshes;
+	UINT grows;
+	UINT compactions;
+	UINT64 bytesMoved;
+};
+
+#endif
@@ -0,0 +1,119 @@
+//
+// Source of the terrain's heights, one square tile at a time
+//
+
+#include "Heightfield.h"
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+#include "TerrainLOD.h"
+
+// The arena floor is a separate plane, the terrain sits just under it so the two don't fight over depth
+static const float TerrainSink = 0.05f;
+
+// Flat around the arena out to the first radius, full height past the second
+static const float ArenaCenterZ = 10.0f;
+static const float ArenaFlatRadius = 30.0f;
+static const float ArenaBlendRadius = 90.0f;
+
+// Generated terrain is six octaves of value noise, the first with hills this many world units across
+static const float NoiseWavelength = 240.0f;
+static const UINT NoiseOctaves = 6;
+
+static float Hash(int x, int z, UINT seed)
+{
+	UINT h = (UINT)x * 73856093u ^ (UINT)z * 19349663u ^ seed * 83492791u;
+	h ^= h >> 13;
+	h *= 0x5bd1e995u;
+	h ^= h >> 15;
+	return (h & 0xFFFFFF) / (float)0x1000000;
+}
+
+static float ValueNoise(float x, float z, UINT seed)
+{
+	float fx = floorf(x), fz = floorf(z);
+	int ix = (int)fx, iz = (int)fz;
+	float tx = x - fx, tz = z - fz;
+	tx = tx * tx * (3.0f - 2.0f * tx);
+	tz = tz * tz * (3.0f - 2.0f * tz);
+
+	float h00 = Hash(ix, iz, seed), h10 = Hash(ix + 1, iz, seed);
+	float h01 = Hash(ix, iz + 1, seed), h11 = Hash(ix + 1, iz + 1, seed);
+	float low = h00 + (h10 - h00) * tx;
+	float high = h01 + (h11 - h01) * tx;
+	return low + (high - low) * tz;
+}
+
+Heightfield::Heightfield() :
+tiles(0),
+cellSize(1.0f),
+heightScale(1.0f)
+{
+
+}
+
+void Heightfield::Configure(UINT size, float _cellSize, float _heightScale, const std::string& _directory)
+{
+	tiles = max((size + TerrainTileCells - 1) / TerrainTileCells, 1u);
+	cellSize = _cellSize;
+	heightScale = _heightScale;
+	directory = _directory;
+}
+
+UINT Heightfield::GetTilesPerSide() const { return tiles; }
+
+float Heightfield::GetHeightScale() const { return heightScale; }
+
+std::string Heightfield::GetTilePath(UINT tileX, UINT tileZ) const
+{
+	std::ostringstream path;
+	path << directory << "/tile_" << tileX << "_" << tileZ << ".r16";
+	return path.str();
+}
+
+void Heightfield::LoadTile(UINT tileX, UINT tileZ, std::vector<float>& heights) const
+{
+	heights.resize(TerrainTileSamples * TerrainTileSamples);
+
+	std::vector<USHORT> samples(heights.size());
+	std::ifstream file(GetTilePath(tileX, tileZ).c_str(), std::ios::binary);
+	if (file && file.read((char*)&samples[0], samples.size() * sizeof(USHORT)))
+	{
+		float scale = heightScale / 65535.0f;
+		for (size_t i = 0; i < samples.size(); i++)
+			heights[i] = samples[i] * scale - TerrainSink;
+		return;
+	}
+
+	int firstX = (int)(tileX * TerrainTileCells) - 1;
+	int firstZ = (int)(tileZ * TerrainTileCells) - 1;
+	for (UINT z = 0; z < TerrainTileSamples; z++)
+	{
+		for (UINT x = 0; x < TerrainTileSamples; x++)
+			heights[z * TerrainTileSamples + x] = Generate(firstX + x, firstZ + z);
+	}
+}
+
+float Heightfield::Generate(int sampleX, int sampleZ) const
+{
+	float half = tiles * TerrainTileCells * 0.5f;
+	float x = (sampleX - half) * cellSize;
+	float z = (sampleZ - half) * cellSize;
+
+	float sum = 0.0f;
+	float amplitude = 0.5f;
+	float frequency = 1.0f / NoiseWavelength;
+	for (UINT octave = 0; octave < NoiseOctaves; octave++)
+	{
+		sum += ValueNoise(x * frequency, z * frequency, octave) * amplitude;
+		amplitude *= 0.5f;
+		frequency *= 2.0f;
+	}
+
+	float arena = sqrtf(x * x + (z - ArenaCenterZ) * (z - ArenaCenterZ));
+	float t = min(max((arena - ArenaFlatRadius) / (ArenaBlendRadius - ArenaFlatRadius), 0.0f), 1.0f);
+	t = t * t * (3.0f - 2.0f * t);
+	return sum * heightScale * t - TerrainSink;
+}
@@ -0,0 +1,43 @@
+//
+// Source of the terrain's heights, one square tile at a time
+// Tiles are read from <directory>/tile_<x>_<z>.r16, TerrainTileSamples^2 little endian 16 bit heights scaled to
+// [0, heightScale] that include one sample past each edge. Tiles without a file are generated from layered noise,
+// flattened around the origin where the simulation's arena is
+//
+
+#ifndef HEIGHTFIELD_H
+#define HEIGHTFIELD_H
+
+#include <string>
+#include <vector>
+#include <Windows.h>
+
+class Heightfield
+{
+public:
+	Heightfield();
+
+	/// <summary>size is the samples along each side, rounded up to whole tiles, cellSize the distance between them
+	/// </summary>
+	void Configure(UINT size, float cellSize, float heightScale, const std::string& directory);
+
+	UINT GetTilesPerSide() const;
+	float GetHeightScale() const;
+
+	/// <summary>Fills heights with a tile's samples. Safe to call from several threads at once
+	/// </summary>
+	void LoadTile(UINT tileX, UINT tileZ, std::vector<float>& heights) const;
+
+	/// <summary>Height of the generated terrain at a sample, sample 0 is the terrain's lowest x or z corner
+	/// </summary>
+	float Generate(int sampleX, int sampleZ) const;
+
+	std::string GetTilePath(UINT tileX, UINT tileZ) const;
+private:
+	UINT tiles;
+	float cellSize;
+	float heightScale;
+	std::string directory;
+};
+
+#endif
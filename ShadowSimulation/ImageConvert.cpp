@@ -0,0 +1,427 @@
+//
+// Class with static methods for converting decoded pixels and building mip chains
+// The per pixel loops use SSE2, the filters work in linear light for color and renormalize normal maps
+//
+
+#include "ImageConvert.h"
+
+#include <cmath>
+#include <cstring>
+#include <emmintrin.h>
+
+static const UINT SRGBTableSize = 16384;
+
+///
+// sRGB conversion
+///
+struct GammaTable
+{
+	GammaTable()
+	{
+		for (UINT i = 0; i < 256; i++)
+		{
+			float c = i / 255.0f;
+			toLinear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+		}
+
+		// Fine enough that the darkest levels, where sRGB is steepest, still round correctly
+		for (UINT i = 0; i < SRGBTableSize; i++)
+		{
+			float linear = i / (float)(SRGBTableSize - 1);
+			float c = linear <= 0.0031308f ? linear * 12.92f : 1.055f * powf(linear, 1.0f / 2.4f) - 0.055f;
+			toSRGB[i] = (BYTE)(min(max(c, 0.0f), 1.0f) * 255.0f + 0.5f);
+		}
+	}
+
+	float toLinear[256];
+	BYTE toSRGB[SRGBTableSize];
+};
+
+static const GammaTable gammaTable;
+
+static BYTE ToUnorm(float value)
+{
+	return (BYTE)(min(max(value, 0.0f), 255.0f) + 0.5f);
+}
+
+///
+// Kaiser filter
+///
+static const float KaiserRadius = 1.5f;	// In destination texels, 3 source texels either side when halving
+static const float KaiserAlpha = 4.0f;
+
+// Zeroth order modified Bessel function of the first kind
+static float BesselI0(float x)
+{
+	float sum = 1.0f;
+	float term = 1.0f;
+	float half = x * 0.5f;
+	for (UINT k = 1; k < 16; k++)
+	{
+		term *= (half / k) * (half / k);
+		sum += term;
+	}
+	return sum;
+}
+
+static float KaiserWeight(float distance)
+{
+	if (fabsf(distance) >= KaiserRadius)
+		return 0.0f;
+
+	const float pi = 3.14159265f;
+	float sinc = distance == 0.0f ? 1.0f : sinf(pi * distance) / (pi * distance);
+	float t = distance / KaiserRadius;
+	return sinc * BesselI0(KaiserAlpha * sqrtf(1.0f - t * t)) / BesselI0(KaiserAlpha);
+}
+
+/// <summary>Weights along one axis, count taps per destination texel starting at first
+/// </summary>
+struct FilterTaps
+{
+	UINT count;
+	std::vector<int> first;
+	std::vector<float> weights;
+};
+
+static void BuildKaiserTaps(UINT sourceSize, UINT destSize, FilterTaps& taps)
+{
+	float scale = (float)sourceSize / destSize;
+	float radius = KaiserRadius * scale;
+	taps.count = (UINT)ceilf(radius * 2.0f) + 1;
+	taps.first.resize(destSize);
+	taps.weights.resize((size_t)destSize * taps.count);
+
+	for (UINT x = 0; x < destSize; x++)
+	{
+		float center = (x + 0.5f) * scale - 0.5f;
+		int first = (int)floorf(center - radius);
+		taps.first[x] = first;
+
+		float* weights = &taps.weights[(size_t)x * taps.count];
+		float total = 0.0f;
+		for (UINT i = 0; i < taps.count; i++)
+		{
+			weights[i] = KaiserWeight((first + (int)i - center) / scale);
+			total += weights[i];
+		}
+		for (UINT i = 0; i < taps.count; i++)
+			weights[i] /= total;
+	}
+}
+
+// Textures tile, so the filter wraps around the edges rather than clamping
+static UINT Wrap(int i, UINT size)
+{
+	int n = (int)size;
+	return (UINT)(((i % n) + n) % n);
+}
+
+void ImageConvert::RGBToRGBA(const BYTE* rgb, BYTE* rgba, size_t pixels)
+{
+	size_t i = 0;
+
+	// Four pixels per pass, each load reads 16 bytes of which 12 are used so stop before the end
+	if (pixels >= 6)
+	{
+		const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+		for (; i + 6 <= pixels; i += 4)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*)(rgb + i * 3));
+			__m128i first = _mm_unpacklo_epi32(v, _mm_srli_si128(v, 3));
+			__m128i second = _mm_unpacklo_epi32(_mm_srli_si128(v, 6), _mm_srli_si128(v, 9));
+			__m128i out = _mm_or_si128(_mm_unpacklo_epi64(first, second), alpha);
+			_mm_storeu_si128((__m128i*)(rgba + i * 4), out);
+		}
+	}
+
+	for (; i < pixels; i++)
+	{
+		rgba[i * 4] = rgb[i * 3];
+		rgba[i * 4 + 1] = rgb[i * 3 + 1];
+		rgba[i * 4 + 2] = rgb[i * 3 + 2];
+		rgba[i * 4 + 3] = 255;
+	}
+}
+
+void ImageConvert::PremultiplyAlpha(BYTE* rgba, size_t pixels)
+{
+	size_t i = 0;
+
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i colorMask = _mm_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0);
+	const __m128i alphaOne = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+	const __m128i half = _mm_set1_epi16(128);
+	for (; i + 4 <= pixels; i += 4)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(rgba + i * 4));
+		__m128i halves[2] = { _mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero) };
+		for (UINT h = 0; h < 2; h++)
+		{
+			// Multiply color by alpha and alpha by 255, then divide by 255 with rounding
+			__m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(halves[h], 0xFF), 0xFF);
+			alpha = _mm_or_si128(_mm_and_si128(alpha, colorMask), alphaOne);
+			__m128i product = _mm_add_epi16(_mm_mullo_epi16(halves[h], alpha), half);
+			halves[h] = _mm_srli_epi16(_mm_add_epi16(product, _mm_srli_epi16(product, 8)), 8);
+		}
+		_mm_storeu_si128((__m128i*)(rgba + i * 4), _mm_packus_epi16(halves[0], halves[1]));
+	}
+
+	for (; i < pixels; i++)
+	{
+		BYTE* pixel = rgba + i * 4;
+		for (UINT c = 0; c < 3; c++)
+		{
+			UINT product = pixel[c] * pixel[3] + 128;
+			pixel[c] = (BYTE)((product + (product >> 8)) >> 8);
+		}
+	}
+}
+
+void ImageConvert::SRGBToLinear(const BYTE* rgba, float* linear, size_t pixels)
+{
+	for (size_t i = 0; i < pixels * 4; i += 4)
+	{
+		linear[i] = gammaTable.toLinear[rgba[i]];
+		linear[i + 1] = gammaTable.toLinear[rgba[i + 1]];
+		linear[i + 2] = gammaTable.toLinear[rgba[i + 2]];
+		linear[i + 3] = rgba[i + 3] / 255.0f;
+	}
+}
+
+void ImageConvert::LinearToSRGB(const float* linear, BYTE* rgba, size_t pixels)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 scale = _mm_setr_ps(SRGBTableSize - 1.0f, SRGBTableSize - 1.0f, SRGBTableSize - 1.0f, 255.0f);
+	for (size_t i = 0; i < pixels * 4; i += 4)
+	{
+		// Clamp and scale to table indices in one go, alpha scales straight to 0-255
+		__m128 v = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(linear + i), zero), one), scale);
+		int indices[4];
+		_mm_storeu_si128((__m128i*)indices, _mm_cvtps_epi32(v));
+
+		rgba[i] = gammaTable.toSRGB[indices[0]];
+		rgba[i + 1] = gammaTable.toSRGB[indices[1]];
+		rgba[i + 2] = gammaTable.toSRGB[indices[2]];
+		rgba[i + 3] = (BYTE)indices[3];
+	}
+}
+
+void ImageConvert::Downsample(const ImageData& source, MipContent content, MipFilter filter, ImageData& next)
+{
+	next.width = max(source.width / 2, 1u);
+	next.height = max(source.height / 2, 1u);
+	next.rgba.resize((size_t)next.width * next.height * 4);
+
+	if (filter == MipKaiser)
+		DownsampleKaiser(source, content, next);
+	else
+		DownsampleBox(source, content, next);
+}
+
+void ImageConvert::GenerateMips(const ImageData& image, MipContent content, MipFilter filter, std::vector<ImageData>& mips)
+{
+	mips.clear();
+	mips.push_back(image);
+
+	while (mips.back().width > 1 || mips.back().height > 1)
+	{
+		ImageData next;
+		Downsample(mips.back(), content, filter, next);
+		mips.push_back(next);
+	}
+}
+
+void ImageConvert::Blit(const BYTE* source, UINT width, UINT height, UINT gutterX, UINT gutterY, ImageData& target, UINT x, UINT y)
+{
+	for (int row = -(int)gutterY; row < (int)(height + gutterY); row++)
+	{
+		const BYTE* in = source + (size_t)Wrap(row, height) * width * 4;
+		BYTE* out = &target.rgba[((size_t)(y + row) * target.width + x) * 4];
+		memcpy(out, in, (size_t)width * 4);
+		for (UINT i = 1; i <= gutterX; i++)
+		{
+			memcpy(out - i * 4, in + Wrap(-(int)i, width) * 4, 4);
+			memcpy(out + (width + i - 1) * 4, in + Wrap(width + i - 1, width) * 4, 4);
+		}
+	}
+}
+
+void ImageConvert::DownsampleBox(const ImageData& source, MipContent content, ImageData& next)
+{
+	for (UINT y = 0; y < next.height; y++)
+	{
+		UINT rows[2] = { min(y * 2, source.height - 1), min(y * 2 + 1, source.height - 1) };
+		const BYTE* row0 = &source.rgba[(size_t)rows[0] * source.width * 4];
+		const BYTE* row1 = &source.rgba[(size_t)rows[1] * source.width * 4];
+		BYTE* out = &next.rgba[(size_t)y * next.width * 4];
+
+		UINT x = 0;
+		if (content == MipLinear && source.width >= 2)
+		{
+			// Linear data averages as stored, two destination texels from four source columns per pass
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i two = _mm_set1_epi16(2);
+			for (; x + 2 <= next.width; x += 2)
+			{
+				__m128i top = _mm_loadu_si128((const __m128i*)(row0 + x * 8));
+				__m128i bottom = _mm_loadu_si128((const __m128i*)(row1 + x * 8));
+				__m128i left = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+				__m128i right = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+				left = _mm_add_epi16(left, _mm_srli_si128(left, 8));
+				right = _mm_add_epi16(right, _mm_srli_si128(right, 8));
+				__m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(left, right), two), 2);
+				_mm_storel_epi64((__m128i*)(out + x * 4), _mm_packus_epi16(sum, zero));
+			}
+		}
+
+		for (; x < next.width; x++)
+		{
+			UINT columns[2] = { min(x * 2, source.width - 1), min(x * 2 + 1, source.width - 1) };
+			const BYTE* texels[4] = { row0 + columns[0] * 4, row0 + columns[1] * 4, row1 + columns[0] * 4, row1 + columns[1] * 4 };
+
+			float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			for (UINT t = 0; t < 4; t++)
+			{
+				for (UINT c = 0; c < 3; c++)
+				{
+					if (content == MipColor)
+						sum[c] += gammaTable.toLinear[texels[t][c]];
+					else if (content == MipNormalMap)
+						sum[c] += texels[t][c] / 127.5f - 1.0f;
+					else
+						sum[c] += texels[t][c];
+				}
+				sum[3] += texels[t][3];
+			}
+
+			BYTE* texel = out + x * 4;
+			if (content == MipNormalMap)
+			{
+				// Averaged normals get shorter, put them back on the unit sphere
+				float length = sqrtf(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+				if (length < 1e-6f)
+				{
+					sum[0] = 0.0f;
+					sum[1] = 0.0f;
+					sum[2] = length = 1.0f;
+				}
+				for (UINT c = 0; c < 3; c++)
+					texel[c] = ToUnorm((sum[c] / length * 0.5f + 0.5f) * 255.0f);
+			}
+			else if (content == MipColor)
+			{
+				for (UINT c = 0; c < 3; c++)
+					texel[c] = gammaTable.toSRGB[(UINT)(min(sum[c] * 0.25f, 1.0f) * (SRGBTableSize - 1) + 0.5f)];
+			}
+			else
+			{
+				for (UINT c = 0; c < 3; c++)
+					texel[c] = ToUnorm(sum[c] * 0.25f);
+			}
+			texel[3] = ToUnorm(sum[3] * 0.25f);
+		}
+	}
+}
+
+void ImageConvert::DownsampleKaiser(const ImageData& source, MipContent content, ImageData& next)
+{
+	std::vector<float> texels;
+	ToFloat(source, content, texels);
+
+	FilterTaps columns;
+	FilterTaps rows;
+	BuildKaiserTaps(source.width, next.width, columns);
+	BuildKaiserTaps(source.height, next.height, rows);
+
+	// Separable, across each row first and then down each column of the narrower result
+	std::vector<float> horizontal((size_t)next.width * source.height * 4);
+	for (UINT y = 0; y < source.height; y++)
+	{
+		const float* in = &texels[(size_t)y * source.width * 4];
+		float* out = &horizontal[(size_t)y * next.width * 4];
+		for (UINT x = 0; x < next.width; x++)
+		{
+			const float* weights = &columns.weights[(size_t)x * columns.count];
+			__m128 sum = _mm_setzero_ps();
+			for (UINT i = 0; i < columns.count; i++)
+			{
+				__m128 texel = _mm_loadu_ps(in + Wrap(columns.first[x] + (int)i, source.width) * 4);
+				sum = _mm_add_ps(sum, _mm_mul_ps(texel, _mm_set1_ps(weights[i])));
+			}
+			_mm_storeu_ps(out + x * 4, sum);
+		}
+	}
+
+	std::vector<float> filtered((size_t)next.width * next.height * 4);
+	for (UINT y = 0; y < next.height; y++)
+	{
+		const float* weights = &rows.weights[(size_t)y * rows.count];
+		float* out = &filtered[(size_t)y * next.width * 4];
+		for (UINT x = 0; x < next.width; x++)
+		{
+			__m128 sum = _mm_setzero_ps();
+			for (UINT i = 0; i < rows.count; i++)
+			{
+				UINT row = Wrap(rows.first[y] + (int)i, source.height);
+				__m128 texel = _mm_loadu_ps(&horizontal[((size_t)row * next.width + x) * 4]);
+				sum = _mm_add_ps(sum, _mm_mul_ps(texel, _mm_set1_ps(weights[i])));
+			}
+			_mm_storeu_ps(out + x * 4, sum);
+		}
+	}
+
+	FromFloat(filtered, content, next);
+}
+
+void ImageConvert::ToFloat(const ImageData& image, MipContent content, std::vector<float>& texels)
+{
+	size_t pixels = (size_t)image.width * image.height;
+	texels.resize(pixels * 4);
+
+	if (content == MipColor)
+	{
+		SRGBToLinear(&image.rgba[0], &texels[0], pixels);
+		return;
+	}
+
+	for (size_t i = 0; i < pixels * 4; i += 4)
+	{
+		for (UINT c = 0; c < 3; c++)
+			texels[i + c] = content == MipNormalMap ? image.rgba[i + c] / 127.5f - 1.0f : image.rgba[i + c] / 255.0f;
+		texels[i + 3] = image.rgba[i + 3] / 255.0f;
+	}
+}
+
+void ImageConvert::FromFloat(const std::vector<float>& texels, MipContent content, ImageData& image)
+{
+	size_t pixels = (size_t)image.width * image.height;
+
+	if (content == MipColor)
+	{
+		LinearToSRGB(&texels[0], &image.rgba[0], pixels);
+		return;
+	}
+
+	for (size_t i = 0; i < pixels * 4; i += 4)
+	{
+		float texel[3] = { texels[i], texels[i + 1], texels[i + 2] };
+		if (content == MipNormalMap)
+		{
+			float length = sqrtf(texel[0] * texel[0] + texel[1] * texel[1] + texel[2] * texel[2]);
+			if (length < 1e-6f)
+			{
+				texel[0] = 0.0f;
+				texel[1] = 0.0f;
+				texel[2] = length = 1.0f;
+			}
+			for (UINT c = 0; c < 3; c++)
+				texel[c] = texel[c] / length * 0.5f + 0.5f;
+		}
+
+		for (UINT c = 0; c < 3; c++)
+			image.rgba[i + c] = ToUnorm(texel[c] * 255.0f);
+		image.rgba[i + 3] = ToUnorm(texels[i + 3] * 255.0f);
+	}
+}
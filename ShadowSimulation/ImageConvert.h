@@ -0,0 +1,62 @@
+//
+// Class with static methods for converting decoded pixels and building mip chains
+// The per pixel loops use SSE2, the filters work in linear light for color and renormalize normal maps
+//
+
+#ifndef IMAGECONVERT_H
+#define IMAGECONVERT_H
+
+#include "ImageDecoder.h"
+
+enum MipContent
+{
+	MipColor,		// sRGB encoded color, filtered in linear light
+	MipLinear,		// Data stored linearly, filtered as it is
+	MipNormalMap	// Tangent space normals, renormalized after filtering
+};
+
+enum MipFilter
+{
+	MipBox,		// 2x2 average, cheapest
+	MipKaiser	// Kaiser windowed sinc over 6x6 texels, sharper mips with less aliasing
+};
+
+class ImageConvert
+{
+public:
+	/// <summary>Expands packed RGB to RGBA with opaque alpha. The buffers must not overlap
+	/// </summary>
+	static void RGBToRGBA(const BYTE* rgb, BYTE* rgba, size_t pixels);
+
+	static void PremultiplyAlpha(BYTE* rgba, size_t pixels);
+
+	/// <summary>Decodes sRGB color to linear floats, alpha is scaled to 0-1 without conversion
+	/// </summary>
+	static void SRGBToLinear(const BYTE* rgba, float* linear, size_t pixels);
+
+	static void LinearToSRGB(const float* linear, BYTE* rgba, size_t pixels);
+
+	/// <summary>Builds the next mip down, half the size in each dimension that is bigger than 1
+	/// </summary>
+	static void Downsample(const ImageData& source, MipContent content, MipFilter filter, ImageData& next);
+
+	/// <summary>Fills mips with the image followed by every smaller level down to 1x1
+	/// </summary>
+	static void GenerateMips(const ImageData& image, MipContent content, MipFilter filter, std::vector<ImageData>& mips);
+
+	/// <summary>Copies RGBA pixels into target with the top left at x, y, and fills a gutter around them with the
+	/// image wrapped round so filtering across the edge of a tiled region only sees its own texels
+	/// </summary>
+	static void Blit(const BYTE* source, UINT width, UINT height, UINT gutterX, UINT gutterY, ImageData& target, UINT x, UINT y);
+private:
+	static void DownsampleBox(const ImageData& source, MipContent content, ImageData& next);
+	static void DownsampleKaiser(const ImageData& source, MipContent content, ImageData& next);
+
+	/// <summary>Unpacks to four floats per texel, linear light for color and -1 to 1 for normals
+	/// </summary>
+	static void ToFloat(const ImageData& image, MipContent content, std::vector<float>& texels);
+
+	static void FromFloat(const std::vector<float>& texels, MipContent content, ImageData& image);
+};
+
+#endif
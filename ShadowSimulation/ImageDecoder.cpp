@@ -0,0 +1,55 @@
+//
+// Pluggable image decoding to 8 bit RGBA
+// Decoders are tried in the order they were added, so a portable decoder can sit in front of WIC
+//
+
+#include "ImageDecoder.h"
+
+#include <fstream>
+
+void ImageDecoders::Add(const ImageDecoder* decoder)
+{
+	decoders.push_back(decoder);
+}
+
+bool ImageDecoders::Decode(const BYTE* data, size_t size, ImageData& image) const
+{
+	const ImageDecoder* decoder = Find(data, size);
+	return decoder && decoder->Decode(data, size, image);
+}
+
+bool ImageDecoders::DecodeFile(const std::wstring& path, ImageData& image) const
+{
+#if defined(_MSC_VER)
+	std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+#else
+	// Only MSVC opens wide paths, elsewhere they are narrowed (the cooker and loaders only pass ASCII paths)
+	std::ifstream file(std::string(path.begin(), path.end()).c_str(), std::ios::binary | std::ios::ate);
+#endif
+	if (!file)
+		return false;
+
+	std::streamsize size = file.tellg();
+	if (size <= 0)
+		return false;
+
+	std::vector<BYTE> data((size_t)size);
+	file.seekg(0, std::ios::beg);
+	if (!file.read((char*)&data[0], size))
+		return false;
+
+	return Decode(&data[0], data.size(), image);
+}
+
+const ImageDecoder* ImageDecoders::Find(const BYTE* data, size_t size) const
+{
+	if (!data || size == 0)
+		return NULL;
+
+	for (const ImageDecoder* decoder : decoders)
+	{
+		if (decoder->CanDecode(data, size))
+			return decoder;
+	}
+	return NULL;
+}
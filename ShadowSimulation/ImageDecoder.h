@@ -0,0 +1,63 @@
+//
+// Pluggable image decoding to 8 bit RGBA
+// Decoders are tried in the order they were added, so a portable decoder can sit in front of WIC
+//
+
+#ifndef IMAGEDECODER_H
+#define IMAGEDECODER_H
+
+#include <string>
+#include <vector>
+#include <Windows.h>
+
+/// <summary>8 bit RGBA pixels, rows tightly packed
+/// </summary>
+struct ImageData
+{
+	ImageData() :
+	width(0),
+	height(0)
+	{
+
+	}
+
+	UINT width;
+	UINT height;
+	std::vector<BYTE> rgba;
+};
+
+class ImageDecoder
+{
+public:
+	virtual ~ImageDecoder() {}
+
+	/// <summary>Returns true if the data looks like a format this decoder reads
+	/// </summary>
+	virtual bool CanDecode(const BYTE* data, size_t size) const = 0;
+
+	virtual bool Decode(const BYTE* data, size_t size, ImageData& image) const = 0;
+
+	virtual const char* GetName() const = 0;
+};
+
+class ImageDecoders
+{
+public:
+	/// <summary>Adds a decoder behind the ones already added. Decoders are not owned
+	/// </summary>
+	void Add(const ImageDecoder* decoder);
+
+	/// <summary>Decodes with the first decoder that recognises the data
+	/// </summary>
+	bool Decode(const BYTE* data, size_t size, ImageData& image) const;
+
+	bool DecodeFile(const std::wstring& path, ImageData& image) const;
+
+	/// <summary>Returns the decoder that would be used for the data, or NULL
+	/// </summary>
+	const ImageDecoder* Find(const BYTE* data, size_t size) const;
+private:
+	std::vector<const ImageDecoder*> decoders;
+};
+
+#endif
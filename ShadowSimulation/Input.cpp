@@ -0,0 +1,167 @@
+//
+// Abstracts keyboard input so sessions can be recorded and replayed exactly
+// Command line: record=session.input to capture, replay=session.input to play back, fixeddt=0.0166 to override dt on replay
+// Live keys come from a KeySource, so recording and replaying don't depend on the keyboard
+//
+
+#include "Input.h"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+// File layout: header followed by runCount InputRuns, all little endian
+static const char InputMagic[4] = { 'S', 'S', 'I', 'N' };
+static const UINT InputVersion = 1;
+
+struct InputFileHeader
+{
+	char magic[4];
+	UINT version;
+	UINT runCount;
+};
+
+Input::Input(KeySource* source) :
+source(source),
+mode(Live),
+keys(0),
+fixedStep(0.0f),
+replayRun(0),
+replayStep(0)
+{
+
+}
+
+Input::~Input()
+{
+	if (mode == Record && !recordPath.empty())
+		Save(recordPath);
+}
+
+bool Input::ParseCommandLine(const char* cmdLine)
+{
+	if (!cmdLine)
+		return true;
+
+	std::istringstream args(cmdLine);
+	std::string arg;
+	while (args >> arg)
+	{
+		size_t split = arg.find('=');
+		if (split == std::string::npos)
+			continue;
+
+		std::string key = arg.substr(0, split);
+		std::string value = arg.substr(split + 1);
+		if (key == "record")
+		{
+			mode = Record;
+			recordPath = value;
+		}
+		else if (key == "replay")
+		{
+			if (!Load(value))
+				return false;
+		}
+		else if (key == "fixeddt")
+		{
+			fixedStep = (float)atof(value.c_str());
+		}
+	}
+	return true;
+}
+
+bool Input::BeginStep(float& dt)
+{
+	if (mode == Replay)
+	{
+		if (replayRun >= runs.size())
+		{
+			keys = 0;
+			return false;
+		}
+
+		const InputRun& run = runs[replayRun];
+		keys = run.keys;
+		dt = fixedStep > 0.0f ? fixedStep : run.dt;
+		if (++replayStep >= run.steps)
+		{
+			replayRun++;
+			replayStep = 0;
+		}
+		return true;
+	}
+
+	keys = source->Sample();
+	if (mode == Record)
+	{
+		// Extend the last run while nothing changes, most steps repeat the one before
+		if (!runs.empty() && runs.back().keys == keys && runs.back().dt == dt && runs.back().steps < 0xFFFF)
+		{
+			runs.back().steps++;
+		}
+		else
+		{
+			InputRun run = { 1, keys, dt };
+			runs.push_back(run);
+		}
+	}
+	return true;
+}
+
+bool Input::IsDown(InputKey key) const
+{
+	return (keys & (1 << key)) != 0;
+}
+
+Input::Mode Input::GetMode() const { return mode; }
+bool Input::IsReplaying() const { return mode == Replay; }
+
+bool Input::Save(const std::string& path) const
+{
+	std::ofstream file(path.c_str(), std::ios::binary);
+	if (!file)
+		return false;
+
+	InputFileHeader header;
+	memcpy(header.magic, InputMagic, sizeof(InputMagic));
+	header.version = InputVersion;
+	header.runCount = (UINT)runs.size();
+	file.write((const char*)&header, sizeof(header));
+	if (!runs.empty())
+		file.write((const char*)&runs[0], runs.size() * sizeof(InputRun));
+
+	return file.good();
+}
+
+bool Input::Load(const std::string& path)
+{
+	std::ifstream file(path.c_str(), std::ios::binary);
+	if (!file)
+		return false;
+
+	InputFileHeader header;
+	file.read((char*)&header, sizeof(header));
+	if (!file || memcmp(header.magic, InputMagic, sizeof(InputMagic)) != 0 || header.version != InputVersion)
+		return false;
+
+	// The header's count is only trusted once the file is known to hold exactly that many runs
+	std::streamoff runsStart = file.tellg();
+	file.seekg(0, std::ios::end);
+	UINT64 runBytes = (UINT64)(file.tellg() - runsStart);
+	file.seekg(runsStart);
+	if (!file || runBytes != (UINT64)header.runCount * sizeof(InputRun))
+		return false;
+
+	std::vector<InputRun> loaded(header.runCount);
+	if (!loaded.empty())
+		file.read((char*)&loaded[0], loaded.size() * sizeof(InputRun));
+	if (!file)
+		return false;
+
+	runs.swap(loaded);
+	mode = Replay;
+	replayRun = 0;
+	replayStep = 0;
+	return true;
+}
@@ -0,0 +1,106 @@
+//
+// Abstracts keyboard input so sessions can be recorded and replayed exactly
+// Command line: record=session.input to capture, replay=session.input to play back, fixeddt=0.0166 to override dt on replay
+// Live keys come from a KeySource, so recording and replaying don't depend on the keyboard
+//
+
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <string>
+#include <vector>
+#include <Windows.h>
+
+/// <summary>Logical keys the simulation reacts to, one bit each in a key state
+/// </summary>
+enum InputKey
+{
+	KeyForward,
+	KeyBack,
+	KeyStrafeLeft,
+	KeyStrafeRight,
+	KeyPitchUp,
+	KeyPitchDown,
+	KeyTurnLeft,
+	KeyTurnRight,
+	KeyLightForward,
+	KeyLightBack,
+	KeyLightLeft,
+	KeyLightRight,
+	KeyLightUp,
+	KeyLightDown,
+	KeyWireframe,
+	KeyCount
+};
+
+/// <summary>A run of consecutive steps with the same keys held and the same dt
+/// </summary>
+struct InputRun
+{
+	USHORT steps;
+	USHORT keys;
+	float dt;
+};
+
+/// <summary>Samples the live keys for an Input
+/// </summary>
+class KeySource
+{
+public:
+	virtual ~KeySource() {}
+
+	/// <summary>Returns the keys held right now, bit n set for InputKey n
+	/// </summary>
+	virtual USHORT Sample() = 0;
+};
+
+class Input
+{
+public:
+	enum Mode
+	{
+		Live,
+		Record,
+		Replay
+	};
+
+	Input(KeySource* source);
+	~Input();
+
+	/// <summary>Reads record=, replay= and fixeddt= from the command line. Returns false if a replay file couldn't be loaded
+	/// </summary>
+	bool ParseCommandLine(const char* cmdLine);
+
+	/// <summary>Latches the key state for one simulation step
+	/// Live and Record sample the key source, Replay reads the next recorded step and overwrites dt
+	/// Returns false once a replay has run out of steps
+	/// </summary>
+	bool BeginStep(float& dt);
+
+	/// <summary>Returns true if key was held during the current step
+	/// </summary>
+	bool IsDown(InputKey key) const;
+
+	Mode GetMode() const;
+	bool IsReplaying() const;
+
+	/// <summary>Writes a recording to disk. Called automatically on destruction in Record mode
+	/// </summary>
+	bool Save(const std::string& path) const;
+
+	/// <summary>Loads a recording and switches to Replay mode. Fails on files cut short or with anything after the runs
+	/// </summary>
+	bool Load(const std::string& path);
+private:
+	KeySource* source;
+	Mode mode;
+	USHORT keys;
+	float fixedStep;	// Replaces the recorded dt when non zero
+	std::string recordPath;
+
+	std::vector<InputRun> runs;
+	size_t replayRun;
+	USHORT replayStep;
+};
+
+#endif
@@ -0,0 +1,89 @@
+//
+// Worker threads that wait between batches of jobs and run each batch alongside the thread that hands it to them
+//
+
+#include "JobPool.h"
+
+JobPool::JobPool() :
+run(NULL),
+jobCount(0),
+nextJob(0),
+generation(0),
+running(0),
+stopping(false)
+{
+
+}
+
+JobPool::~JobPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+void JobPool::Start(UINT workerCount)
+{
+	if (!workers.empty())
+		return;
+	for (UINT i = 0; i < workerCount; i++)
+		workers.push_back(std::thread(&JobPool::WorkerLoop, this, i + 1));
+}
+
+UINT JobPool::GetWorkerCount() const { return (UINT)workers.size(); }
+
+void JobPool::Run(UINT _jobCount, const std::function<void(UINT, UINT)>& _run)
+{
+	run = &_run;
+	jobCount = _jobCount;
+	nextJob = 0;
+
+	// A single job isn't worth waking anyone for
+	bool parallel = !workers.empty() && jobCount > 1;
+	if (parallel)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		generation++;
+		running = (UINT)workers.size();
+	}
+	if (parallel)
+		wake.notify_all();
+
+	RunJobs(0);
+
+	if (parallel)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [this] { return running == 0; });
+	}
+}
+
+void JobPool::RunJobs(UINT slot)
+{
+	for (UINT i = nextJob++; i < jobCount; i = nextJob++)
+		(*run)(i, slot);
+}
+
+void JobPool::WorkerLoop(UINT slot)
+{
+	UINT seen = 0;
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		wake.wait(lock, [this, &seen] { return stopping || generation != seen; });
+		if (stopping)
+			return;
+		seen = generation;
+
+		lock.unlock();
+		RunJobs(slot);
+		lock.lock();
+
+		if (--running == 0)
+			done.notify_one();
+	}
+}
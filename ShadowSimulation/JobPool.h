@@ -0,0 +1,58 @@
+//
+// Worker threads that wait between batches of jobs and run each batch alongside the thread that hands it to them
+// Jobs are taken one at a time from a shared counter, so uneven jobs still spread evenly across the threads
+//
+
+#ifndef JOBPOOL_H
+#define JOBPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <Windows.h>
+
+class JobPool
+{
+public:
+	JobPool();
+	~JobPool();
+
+	/// <summary>Starts the workers, the thread calling Run is one more besides them. Does nothing if they are already running
+	/// </summary>
+	void Start(UINT workerCount);
+
+	UINT GetWorkerCount() const;
+
+	/// <summary>Calls run(job, slot) for every job below jobCount and returns once all of them are done. slot is 0 on the
+	/// calling thread and 1 to GetWorkerCount() on the workers, so each thread can keep results of its own in an array
+	/// Only one thread may call Run at a time
+	/// </summary>
+	void Run(UINT jobCount, const std::function<void(UINT, UINT)>& run);
+private:
+	JobPool(const JobPool&);
+	JobPool& operator=(const JobPool&);
+
+	/// <summary>Takes jobs until there are none left
+	/// </summary>
+	void RunJobs(UINT slot);
+
+	void WorkerLoop(UINT slot);
+
+	// Set up by the calling thread before waking the workers, read only while they run
+	const std::function<void(UINT, UINT)>* run;
+	UINT jobCount;
+	std::atomic<UINT> nextJob;
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	UINT generation;		// Bumped for every batch, workers run each once
+	UINT running;			// Workers still on the current batch
+	bool stopping;
+};
+
+#endif
@@ -0,0 +1,25 @@
+//
+// Samples the keyboard for an Input
+//
+
+#include "KeyboardKeySource.h"
+
+// Virtual key bound to each InputKey, in enum order
+static const int KeyBindings[KeyCount] =
+{
+	'W', 'S', 'A', 'D',
+	VK_UP, VK_DOWN, VK_LEFT, VK_RIGHT,
+	'I', 'K', 'J', 'L', 'U', 'O',
+	VK_SPACE
+};
+
+USHORT KeyboardKeySource::Sample()
+{
+	USHORT state = 0;
+	for (int i = 0; i < KeyCount; i++)
+	{
+		if (GetAsyncKeyState(KeyBindings[i]) & 0x8000)
+			state |= 1 << i;
+	}
+	return state;
+}
@@ -0,0 +1,18 @@
+//
+// Samples the keyboard for an Input
+//
+
+#ifndef KEYBOARDKEYSOURCE_H
+#define KEYBOARDKEYSOURCE_H
+
+#include "Input.h"
+
+class KeyboardKeySource : public KeySource
+{
+public:
+	/// <summary>Reads the keys bound to each InputKey with GetAsyncKeyState
+	/// </summary>
+	USHORT Sample();
+};
+
+#endif
@@ -0,0 +1,108 @@
+//
+// Picks each object's level of detail from how many pixels its simplification error would cover on screen
+//
+
+#include "LODSelector.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+
+LODSelector::LODSelector() :
+enabled(true),
+pixelError(1.0f),
+shadowScale(4.0f),
+hysteresis(0.25f)
+{
+	for (UINT i = 0; i < LODPassCount; i++)
+		SetOrthographic((LODPass)i, 1.0f, 1.0f);
+}
+
+void LODSelector::ParseCommandLine(const char* cmdLine)
+{
+	if (!cmdLine)
+		return;
+
+	std::istringstream args(cmdLine);
+	std::string arg;
+	while (args >> arg)
+	{
+		size_t split = arg.find('=');
+		if (split == std::string::npos)
+			continue;
+
+		std::string key = arg.substr(0, split);
+		std::string value = arg.substr(split + 1);
+		if (key == "lod")
+			enabled = value != "0";
+		else if (key == "lodpixels")
+			pixelError = max((float)atof(value.c_str()), 0.0f);
+		else if (key == "lodshadow")
+			shadowScale = max((float)atof(value.c_str()), 0.0f);
+		else if (key == "lodhysteresis")
+			hysteresis = min(max((float)atof(value.c_str()), 0.0f), 1.0f);
+	}
+}
+
+bool LODSelector::IsEnabled() const { return enabled; }
+
+void LODSelector::SetPerspective(LODPass pass, const XMFLOAT3& eye, float fovY, float viewportHeight)
+{
+	View& view = views[pass];
+	view.perspective = true;
+	view.eye = eye;
+	view.pixelsPerUnit = viewportHeight / (2.0f * tanf(fovY * 0.5f));
+	view.threshold = pass == LODPassShadow ? pixelError * shadowScale : pixelError;
+}
+
+void LODSelector::SetOrthographic(LODPass pass, float viewHeight, float viewportHeight)
+{
+	View& view = views[pass];
+	view.perspective = false;
+	view.eye = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	view.pixelsPerUnit = viewportHeight / viewHeight;
+	view.threshold = pass == LODPassShadow ? pixelError * shadowScale : pixelError;
+}
+
+UINT LODSelector::Select(LODPass pass, const std::vector<MeshLOD>& lods, const MeshBounds& bounds, const XMFLOAT4X4& world, UINT current) const
+{
+	if (!enabled || lods.size() <= 1)
+		return 0;
+	UINT last = (UINT)lods.size() - 1;
+	current = min(current, last);
+
+	// Errors are in the mesh's units, the largest axis scale bounds how much the world matrix stretches them
+	float scale = 0.0f;
+	for (UINT i = 0; i < 3; i++)
+		scale = max(scale, sqrtf(world.m[i][0] * world.m[i][0] + world.m[i][1] * world.m[i][1] + world.m[i][2] * world.m[i][2]));
+
+	const View& view = views[pass];
+	float pixelsPerUnit = view.pixelsPerUnit * scale;
+	if (view.perspective)
+	{
+		// Measured at the nearest the bounds come to the eye, an eye inside them gets full detail
+		const XMFLOAT3& c = bounds.center;
+		float x = c.x * world._11 + c.y * world._21 + c.z * world._31 + world._41 - view.eye.x;
+		float y = c.x * world._12 + c.y * world._22 + c.z * world._32 + world._42 - view.eye.y;
+		float z = c.x * world._13 + c.y * world._23 + c.z * world._33 + world._43 - view.eye.z;
+		const XMFLOAT3& e = bounds.extents;
+		float distance = sqrtf(x * x + y * y + z * z) - sqrtf(e.x * e.x + e.y * e.y + e.z * e.z) * scale;
+		if (distance <= 0.0f)
+			return 0;
+		pixelsPerUnit /= distance;
+	}
+
+	// The coarsest level under the threshold, errors only grow along the chain
+	UINT level = 0;
+	while (level < last && lods[level + 1].error * pixelsPerUnit <= view.threshold)
+		level++;
+	if (level <= current)
+		return level;
+
+	// Coarser levels have to clear the threshold by the hysteresis margin first
+	float coarserThreshold = view.threshold * (1.0f - hysteresis);
+	while (current < level && lods[current + 1].error * pixelsPerUnit <= coarserThreshold)
+		current++;
+	return current;
+}
@@ -0,0 +1,65 @@
+//
+// Picks each object's level of detail from how many pixels its simplification error would cover on screen
+// The camera and the shadow map are separate views, the shadow map takes coarser levels. An object keeps its level
+// until a coarser one is clearly under the threshold, so it doesn't flicker between two levels at one distance
+//
+
+#ifndef LODSELECTOR_H
+#define LODSELECTOR_H
+
+#include <vector>
+#include <Windows.h>
+#include <DirectXMath.h>
+
+#include "Vertex.h"
+
+using namespace DirectX;
+
+enum LODPass
+{
+	LODPassCamera,
+	LODPassShadow,
+	LODPassCount
+};
+
+class LODSelector
+{
+public:
+	LODSelector();
+
+	/// <summary>Reads lod=0 to draw everything at full detail, lodpixels=1 for the error allowed on screen,
+	/// lodshadow=4 for how many times that the shadow map allows and lodhysteresis=0.25 for how far under the
+	/// threshold a coarser level has to be before an object switches to it
+	/// </summary>
+	void ParseCommandLine(const char* cmdLine);
+
+	bool IsEnabled() const;
+
+	/// <summary>Sets up a pass seen through a perspective projection, fovY in radians and the viewport's height in pixels
+	/// </summary>
+	void SetPerspective(LODPass pass, const XMFLOAT3& eye, float fovY, float viewportHeight);
+
+	/// <summary>Sets up a pass seen through an orthographic projection viewHeight units tall
+	/// </summary>
+	void SetOrthographic(LODPass pass, float viewHeight, float viewportHeight);
+
+	/// <summary>Returns the level to draw the object at, current is the level it drew at last frame
+	/// </summary>
+	UINT Select(LODPass pass, const std::vector<MeshLOD>& lods, const MeshBounds& bounds, const XMFLOAT4X4& world, UINT current) const;
+private:
+	struct View
+	{
+		bool perspective;
+		XMFLOAT3 eye;
+		float pixelsPerUnit;	// At a distance of 1 for perspective views
+		float threshold;		// Pixels of error allowed
+	};
+
+	bool enabled;
+	float pixelError;
+	float shadowScale;
+	float hysteresis;
+	View views[LODPassCount];
+};
+
+#endif
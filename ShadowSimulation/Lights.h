@@ -6,13 +6,13 @@
 #ifndef LIGHTS_H
 #define LIGHTS_H
 
-#include <d3d11.h>
+#include <Windows.h>
 #include <DirectXMath.h>
 using namespace DirectX;
 
 struct DirectionalLight
 {
-	DirectionalLight() { ZeroMemory(this, sizeof(this)); }
+	DirectionalLight() { ZeroMemory(this, sizeof(*this)); }
 	XMFLOAT4 ambient;
 	XMFLOAT4 diffuse;
 	XMFLOAT4 specular;
@@ -22,7 +22,7 @@ struct DirectionalLight
 
 struct PointLight
 {
-	PointLight() { ZeroMemory(this, sizeof(this)); }
+	PointLight() { ZeroMemory(this, sizeof(*this)); }
 	XMFLOAT4 ambient;
 	XMFLOAT4 diffuse;
 	XMFLOAT4 specular;
@@ -34,7 +34,7 @@ struct PointLight
 
 struct SpotLight
 {
-	SpotLight() { ZeroMemory(this, sizeof(this)); }
+	SpotLight() { ZeroMemory(this, sizeof(*this)); }
 	XMFLOAT4 ambient;
 	XMFLOAT4 diffuse;
 	XMFLOAT4 specular;
@@ -48,7 +48,7 @@ struct SpotLight
 
 struct LightMaterial
 {
-	LightMaterial() { ZeroMemory(this, sizeof(this)); }
+	LightMaterial() { ZeroMemory(this, sizeof(*this)); }
 	XMFLOAT4 ambient;
 	XMFLOAT4 diffuse;
 	XMFLOAT4 specular;
@@ -0,0 +1,219 @@
+// Lit pixel shader shared by every material, features are switched on and off at compile time
+// DefaultPixel and PixelNoNormal compile it with everything on, -buildshaders compiles the permutations the simulation uses
+// NORMAL_MAP, NUM_DIR, NUM_POINT and NUM_SPOT (0 or 1, the cbuffer holds one of each), SHADOWS, PCF_TAPS (1, 4 or 9), FOG, TEXTURE_ARRAY
+
+#include "Lighting.hlsli"
+
+#ifndef NORMAL_MAP
+#define NORMAL_MAP 1
+#endif
+#ifndef NUM_DIR
+#define NUM_DIR 1
+#endif
+#ifndef NUM_POINT
+#define NUM_POINT 1
+#endif
+#ifndef NUM_SPOT
+#define NUM_SPOT 1
+#endif
+#ifndef SHADOWS
+#define SHADOWS 1
+#endif
+#ifndef PCF_TAPS
+#define PCF_TAPS 9
+#endif
+#ifndef FOG
+#define FOG 1
+#endif
+
+
+cbuffer perFrame : register(b0)
+{
+	DirectionalLight dLight;
+	PointLight pLight;
+	SpotLight sLight;
+	matrix view;
+	matrix projection;
+	float3 eyePos;
+	float time;
+	float4 fogColor;
+	float fogStart;
+	float fogRange;
+	float pad[2];
+};
+
+cbuffer perObject : register(b1)
+{
+	matrix world;
+	matrix worldInverseTranspose;
+	LightMaterial lightMat;
+	float tileX;
+	float tileZ;
+	uint diffuseSlice;
+	uint normalSlice;
+	float4 diffuseRect;
+	float4 normalRect;
+};
+
+cbuffer shadow : register(b2)
+{
+	matrix sView;
+	matrix sProj;
+	float resolution;
+	float padS[3];
+};
+
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;
+	float3 worldpos		: POSITION;
+	float4 color		: COLOR;
+	float2 uv			: TEXCOORD0;
+	float3 normal		: NORMAL;
+	float3 tangent		: TANGENT;
+	float4 shadowpos	: TEXCOORD1;
+};
+
+#ifndef TEXTURE_ARRAY
+#define TEXTURE_ARRAY 0
+#endif
+
+Texture2D _ShadowMap : register(t3);
+SamplerState _Sampler : register(s0);
+SamplerComparisonState _CmpSampler : register(s1);
+
+#if TEXTURE_ARRAY
+Texture2DArray _Texture : register(t0);
+Texture2DArray _Normal  : register(t1);
+
+// Tiles uv inside the texture's region of an atlas slice, the gradients come from the untiled uv so the mip doesn't jump at the seams
+float4 SampleRegion(Texture2DArray tex, float2 uv, float4 rect, uint slice)
+{
+	return tex.SampleGrad(_Sampler, float3(rect.xy + frac(uv) * rect.zw, slice), ddx(uv) * rect.zw, ddy(uv) * rect.zw);
+}
+
+#define SAMPLE_DIFFUSE(uv) SampleRegion(_Texture, uv, diffuseRect, diffuseSlice)
+#define SAMPLE_NORMAL(uv) SampleRegion(_Normal, uv, normalRect, normalSlice)
+#else
+Texture2D _Texture : register(t0);
+Texture2D _Normal  : register(t1);
+
+#define SAMPLE_DIFFUSE(uv) _Texture.Sample(_Sampler, uv)
+#define SAMPLE_NORMAL(uv) _Normal.Sample(_Sampler, uv)
+#endif
+
+#if SHADOWS
+// Fraction of the PCF kernel around shadowpos that the light reaches
+float ComputeShadow(float4 shadowpos)
+{
+	// Complete projection (if using perspective projection)
+	shadowpos.xyz /= shadowpos.w;
+
+	// Calculate distance between each pixel
+	float dx = 1.0 / resolution;
+
+#if PCF_TAPS == 9
+	static const int kernel = 3;
+#elif PCF_TAPS == 4
+	static const int kernel = 2;
+#else
+	static const int kernel = 1;
+#endif
+
+	// PCF Filtering, a kernel x kernel grid centered on the pixel
+	float percentLit = 0.0f;
+	float lightDepth = shadowpos.z;
+	[unroll]
+	for (int y = 0; y < kernel; y++)
+	{
+		[unroll]
+		for (int x = 0; x < kernel; x++)
+		{
+			float2 offset = (float2(x, y) - (kernel - 1) * 0.5) * dx;
+			percentLit += _ShadowMap.SampleCmpLevelZero(_CmpSampler, shadowpos.xy + offset, lightDepth - 0.0005).r;
+		}
+	}
+
+	return percentLit / (kernel * kernel);
+}
+#endif
+
+float4 main(VertexToPixel input) : SV_TARGET
+{
+	input.normal = normalize(input.normal);
+
+#if NORMAL_MAP
+	// Get the normal values from the map and unpack them
+	float3 normalT = SAMPLE_NORMAL(float2(input.uv.x * tileX, input.uv.y * tileZ)).xyz;
+	normalT = 2.0 * normalT - 1.0;
+
+	// TBN matrix calculation and bumped normal calculation
+	float3 N = input.normal;
+	float3 T = normalize(input.tangent - dot(input.tangent, N) * N);
+	float3 B = cross(N, T);
+	float3x3 TBN = float3x3(T, B, N);
+	float3 normal = normalize(mul(normalT, TBN));
+#else
+	// Pass through normal
+	float3 normal = input.normal;
+#endif
+
+	// Calculate relation to camera for specularity and camera based effects
+	float distToEye = length(eyePos - input.worldpos);
+	float3 toEye = normalize(eyePos - input.worldpos);
+
+	// Create light values and set them to zero
+	float4 ambient = float4(0, 0, 0, 0);
+	float4 diffuse = float4(0, 0, 0, 0);
+	float4 spec = float4(0, 0, 0, 0);
+
+	float4 A, D, S;
+
+	///
+	// Lighting Calculations (found in lighting.hlsli)
+	///
+#if NUM_DIR > 0
+	ComputeDirectionalLight(lightMat, dLight, normal, toEye, A, D, S);
+	ambient += A;
+	diffuse += D;
+	spec	+= S;
+#endif
+
+#if NUM_POINT > 0
+	ComputePointLight(lightMat, pLight, input.worldpos, normal, toEye, A, D, S);
+	ambient += A;
+	diffuse += D;
+	spec	+= S;
+#endif
+
+#if NUM_SPOT > 0
+	ComputeSpotLight(lightMat, sLight, input.worldpos, normal, toEye, A, D, S);
+	ambient += A;
+	diffuse += D;
+	spec	+= S;
+#endif
+
+	// Calculate Shadows
+#if SHADOWS
+	float percentLit = ComputeShadow(input.shadowpos);
+#else
+	float percentLit = 1.0;
+#endif
+
+	// Sample texture(s)
+	float4 texColor = SAMPLE_DIFFUSE(float2(input.uv.x * tileX, input.uv.y * tileZ));
+
+	// Calculate lit color based on lighting and shadow calculations
+	float4 litColor = texColor * (ambient + diffuse * percentLit) + spec * percentLit;
+
+#if FOG
+	// Fog calculations
+	float fogLerp = saturate((distToEye - fogStart) / fogRange);
+	litColor = lerp(litColor, fogColor, fogLerp);
+#endif
+
+	// Pass through alpha values
+	litColor.a = lightMat.diffuse.a;
+
+	return litColor;
+}
@@ -0,0 +1,200 @@
+//
+// Runs startup loading as a dependency graph
+// Each node has a load step, run on any thread as soon as its dependencies have loaded,
+// and an optional create step for device work, run on the calling thread once everything has loaded
+//
+
+#include "LoadGraph.h"
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+
+#include "Profiler.h"
+
+LoadGraph::LoadGraph() :
+threadCount(0)
+{
+
+}
+
+LoadNodeId LoadGraph::Add(const char* name, std::function<bool()> load, std::function<bool()> create)
+{
+	Node node;
+	node.name = name;
+	node.load = load;
+	node.create = create;
+	node.failed = false;
+	node.thread = 0;
+	nodes.push_back(node);
+	return (LoadNodeId)(nodes.size() - 1);
+}
+
+void LoadGraph::DependsOn(LoadNodeId node, LoadNodeId dependency)
+{
+	nodes[node].dependencies.push_back(dependency);
+	nodes[dependency].dependents.push_back(node);
+}
+
+bool LoadGraph::Sort(std::vector<LoadNodeId>& order) const
+{
+	std::vector<UINT> unmet(nodes.size());
+	std::deque<LoadNodeId> ready;
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		unmet[i] = (UINT)nodes[i].dependencies.size();
+		if (!unmet[i])
+			ready.push_back((LoadNodeId)i);
+	}
+
+	order.clear();
+	while (!ready.empty())
+	{
+		LoadNodeId id = ready.front();
+		ready.pop_front();
+		order.push_back(id);
+		for (LoadNodeId dependent : nodes[id].dependents)
+		{
+			if (--unmet[dependent] == 0)
+				ready.push_back(dependent);
+		}
+	}
+	return order.size() == nodes.size();
+}
+
+bool LoadGraph::Run(UINT workerCount)
+{
+	PROFILE_ZONE("LoadGraph::Run");
+
+	std::vector<LoadNodeId> order;
+	if (!Sort(order))
+		return false;
+
+	if (workerCount == 0)
+		workerCount = std::thread::hardware_concurrency();
+	if (workerCount == 0)
+		workerCount = 1;
+	threadCount = workerCount;
+
+	runStart = std::chrono::steady_clock::now();
+
+	///
+	// Load phase: a node becomes ready once all of its dependencies have loaded
+	///
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<LoadNodeId> ready;
+	std::vector<UINT> unmet(nodes.size());
+	size_t remaining = nodes.size();
+
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		unmet[i] = (UINT)nodes[i].dependencies.size();
+		if (!unmet[i])
+			ready.push_back((LoadNodeId)i);
+	}
+
+	auto worker = [&](UINT thread)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (remaining)
+		{
+			if (ready.empty())
+			{
+				wake.wait(lock);
+				continue;
+			}
+
+			LoadNodeId id = ready.front();
+			ready.pop_front();
+
+			Node& node = nodes[id];
+			bool skip = false;
+			for (LoadNodeId dependency : node.dependencies)
+				skip = skip || nodes[dependency].failed;
+
+			lock.unlock();
+			node.thread = thread;
+			node.loadStart = std::chrono::steady_clock::now();
+			bool loaded = !skip && (!node.load || node.load());
+			node.loadEnd = std::chrono::steady_clock::now();
+			lock.lock();
+
+			node.failed = !loaded;
+			remaining--;
+			for (LoadNodeId dependent : node.dependents)
+			{
+				if (--unmet[dependent] == 0)
+					ready.push_back(dependent);
+			}
+			wake.notify_all();
+		}
+	};
+
+	// The calling thread works too
+	std::vector<std::thread> threads;
+	for (UINT i = 1; i < workerCount; i++)
+		threads.push_back(std::thread(worker, i));
+	worker(0);
+	for (std::thread& thread : threads)
+		thread.join();
+
+	loadsDone = std::chrono::steady_clock::now();
+
+	///
+	// Create phase: device work stays on this thread and runs back to back
+	///
+	bool succeeded = true;
+	for (LoadNodeId id : order)
+	{
+		Node& node = nodes[id];
+		for (LoadNodeId dependency : node.dependencies)
+			node.failed = node.failed || nodes[dependency].failed;
+
+		node.createStart = std::chrono::steady_clock::now();
+		if (!node.failed && node.create)
+			node.failed = !node.create();
+		node.createEnd = std::chrono::steady_clock::now();
+
+		succeeded = succeeded && !node.failed;
+	}
+
+	runEnd = std::chrono::steady_clock::now();
+	return succeeded;
+}
+
+bool LoadGraph::Succeeded(LoadNodeId node) const
+{
+	return !nodes[node].failed;
+}
+
+bool LoadGraph::WriteTimeline(const char* path) const
+{
+	std::ofstream file(path);
+	if (!file)
+		return false;
+
+	auto ms = [this](const TimePoint& time)
+	{
+		return std::chrono::duration<double, std::milli>(time - runStart).count();
+	};
+
+	file << std::fixed << std::setprecision(3);
+	file << "Startup load graph: " << nodes.size() << " nodes on " << threadCount << " threads\n";
+	file << "Loads done at " << ms(loadsDone) << " ms, creates done at " << ms(runEnd) << " ms\n\n";
+	file << std::left << std::setw(28) << "node" << std::setw(8) << "thread"
+		<< std::setw(12) << "load start" << std::setw(12) << "load end"
+		<< std::setw(14) << "create start" << std::setw(12) << "create end" << "status\n";
+
+	for (const Node& node : nodes)
+	{
+		file << std::left << std::setw(28) << node.name << std::setw(8) << node.thread
+			<< std::setw(12) << ms(node.loadStart) << std::setw(12) << ms(node.loadEnd)
+			<< std::setw(14) << ms(node.createStart) << std::setw(12) << ms(node.createEnd)
+			<< (node.failed ? "failed" : "ok") << "\n";
+	}
+	return file.good();
+}
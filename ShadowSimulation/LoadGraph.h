@@ -0,0 +1,69 @@
+//
+// Runs startup loading as a dependency graph
+// Each node has a load step, run on any thread as soon as its dependencies have loaded,
+// and an optional create step for device work, run on the calling thread once everything has loaded
+//
+
+#ifndef LOADGRAPH_H
+#define LOADGRAPH_H
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+#include <Windows.h>
+
+typedef UINT LoadNodeId;
+
+class LoadGraph
+{
+public:
+	LoadGraph();
+
+	/// <summary>Adds a node. Either step may be empty, a step returning false fails the node and everything that depends on it
+	/// </summary>
+	LoadNodeId Add(const char* name, std::function<bool()> load, std::function<bool()> create = std::function<bool()>());
+
+	/// <summary>Makes node wait for dependency, both for loading and creation
+	/// </summary>
+	void DependsOn(LoadNodeId node, LoadNodeId dependency);
+
+	/// <summary>Loads every node on workerCount threads (0 uses every core), then runs the create steps in dependency order
+	/// Returns false if any node failed
+	/// </summary>
+	bool Run(UINT workerCount = 0);
+
+	/// <summary>Returns true if the node and all of its dependencies succeeded
+	/// </summary>
+	bool Succeeded(LoadNodeId node) const;
+
+	/// <summary>Writes when and on which thread every step ran, in milliseconds from the start of Run
+	/// </summary>
+	bool WriteTimeline(const char* path) const;
+private:
+	typedef std::chrono::steady_clock::time_point TimePoint;
+
+	struct Node
+	{
+		std::string name;
+		std::function<bool()> load;
+		std::function<bool()> create;
+		std::vector<LoadNodeId> dependencies;
+		std::vector<LoadNodeId> dependents;
+		bool failed;
+
+		UINT thread;
+		TimePoint loadStart, loadEnd;
+		TimePoint createStart, createEnd;
+	};
+
+	/// <summary>Returns the nodes ordered so every node comes after its dependencies, false on a cycle
+	/// </summary>
+	bool Sort(std::vector<LoadNodeId>& order) const;
+
+	std::vector<Node> nodes;
+	TimePoint runStart, loadsDone, runEnd;
+	UINT threadCount;
+};
+
+#endif
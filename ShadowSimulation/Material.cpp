@@ -1,25 +1,55 @@
 #include "Material.h"
-#include <WICTextureLoader.h>
-#include <DDSTextureLoader.h>
 #include "Game.h"
+#include "Profiler.h"
+#include "ShaderPermutations.h"
 
-Material::Material(wchar_t* filepath, ID3D11SamplerState* sampler, ID3D11Device* dev) :
-sampler(sampler)
+Material::Material(wchar_t* filepath, ID3D11SamplerState* sampler, TextureCache& textures) :
+srv(NULL),
+sampler(sampler),
+normal(NULL),
+bump(NULL),
+lightMat(NULL),
+cBuffer(NULL),
+features(0)
 {
-	CreateWICTextureFromFile(
-		dev,
-		filepath,
-		0,
-		&srv);
+	PROFILE_ZONE("Material::LoadTexture");
+	if (sampler)
+		sampler->AddRef();
+	ResetRegions();
+	SetTexture(DiffuseSlot, textures.Load(filepath));
 	m_Shader = new Shader();
 }
 
-Material::Material(wchar_t* vertfilepath, wchar_t* pixelfilepath, ID3D11SamplerState* _sampler, ID3D11Device* dev)
+Material::Material(wchar_t* vertfilepath, wchar_t* pixelfilepath, ID3D11SamplerState* _sampler, ID3D11Device* dev) :
+srv(NULL),
+normal(NULL),
+bump(NULL),
+lightMat(NULL),
+cBuffer(NULL),
+features(0)
 {
+	ResetRegions();
 	m_Shader = new Shader();
 	m_Shader->LoadShader(vertfilepath, Vert, dev);
 	m_Shader->LoadShader(pixelfilepath, Pixel, dev);
 	sampler = _sampler;
+	if (sampler)
+		sampler->AddRef();
+}
+
+Material::Material(ID3D11SamplerState* sampler) :
+srv(NULL),
+sampler(sampler),
+normal(NULL),
+bump(NULL),
+lightMat(NULL),
+cBuffer(NULL),
+features(0)
+{
+	if (sampler)
+		sampler->AddRef();
+	ResetRegions();
+	m_Shader = new Shader();
 }
 
 Material::~Material()
@@ -51,6 +81,30 @@ void Material::LoadShader(wchar_t* filepath, ShaderType type, ID3D11Device* dev)
 	m_Shader->LoadShader(filepath, type, dev);
 }
 
+void Material::LoadShader(ID3DBlob* bytecode, ShaderType type, ID3D11Device* dev)
+{
+	m_Shader->LoadShader(bytecode, type, dev);
+}
+
+void Material::LoadShader(ShaderLibrary& library, UINT64 hash, ShaderType type, ID3D11Device* dev)
+{
+	m_Shader->LoadShader(library, hash, type, dev);
+}
+
+bool Material::LoadPermutation(ShaderLibrary& library, const ShaderArchive& archive, const char* shader, UINT _features, ShaderType type, ID3D11Device* dev)
+{
+	_features = ShaderPermutations::Normalize(_features);
+	const BYTE* bytecode = NULL;
+	size_t size = 0;
+	if (!archive.Find(shader, _features, bytecode, size) || !m_Shader->LoadShader(library, library.Add(bytecode, size), type, dev))
+		return false;
+
+	features = _features;
+	return true;
+}
+
+UINT Material::GetFeatures() { return features; }
+
 void Material::SetShader(ID3D11DeviceContext* devCon)
 {
 	m_Shader->SetShader(Vert, devCon);
@@ -60,22 +114,53 @@ void Material::SetShader(ID3D11DeviceContext* devCon)
 	m_Shader->SetShader(Domain, devCon);
 }
 
-void Material::LoadNormal(wchar_t* filepath, ID3D11Device* dev)
+void Material::LoadNormal(wchar_t* filepath, TextureCache& textures)
 {
-	CreateWICTextureFromFile(
-		dev,
-		filepath,
-		0,
-		&normal);
+	PROFILE_ZONE("Material::LoadNormal");
+	SetTexture(NormalSlot, textures.Load(filepath));
 }
 
-void Material::LoadBump(wchar_t* filepath, ID3D11Device* dev)
+void Material::LoadBump(wchar_t* filepath, TextureCache& textures)
 {
-	CreateWICTextureFromFile(
-		dev,
-		filepath,
-		0,
-		&bump);
+	PROFILE_ZONE("Material::LoadBump");
+	SetTexture(BumpSlot, textures.Load(filepath));
+}
+
+void Material::SetTexture(TextureSlot slot, ID3D11ShaderResourceView* view)
+{
+	ID3D11ShaderResourceView** target = slot == DiffuseSlot ? &srv : (slot == NormalSlot ? &normal : &bump);
+	if (view)
+		view->AddRef();
+	ReleaseMacro((*target));
+	*target = view;
+	cachedTextures[slot].Reset();
+	textureSlices[slot] = 0;
+	textureRects[slot] = XMFLOAT4(0.0f, 0.0f, 1.0f, 1.0f);
+}
+
+void Material::SetTexture(TextureSlot slot, const TextureHandle& texture)
+{
+	SetTexture(slot, texture.Get());
+	cachedTextures[slot] = texture;
+}
+
+void Material::SetTextureRegion(TextureSlot slot, ID3D11ShaderResourceView* arrayView, UINT slice, const XMFLOAT4& rect)
+{
+	SetTexture(slot, arrayView);
+	textureSlices[slot] = slice;
+	textureRects[slot] = rect;
+}
+
+UINT Material::GetTextureSlice(TextureSlot slot) { return textureSlices[slot]; }
+XMFLOAT4 Material::GetTextureRect(TextureSlot slot) { return textureRects[slot]; }
+
+void Material::ResetRegions()
+{
+	for (UINT i = 0; i < 3; i++)
+	{
+		textureSlices[i] = 0;
+		textureRects[i] = XMFLOAT4(0.0f, 0.0f, 1.0f, 1.0f);
+	}
 }
 
 void Material::SetSampler(ID3D11DeviceContext* devCon)
@@ -92,23 +177,25 @@ void Material::SetLightMaterial(LightMaterial* _lightMat)
 	lightMat = _lightMat;
 }
 
-void Material::SetResources(ID3D11DeviceContext* devCon)
+UINT Material::SetResources(ID3D11DeviceContext* devCon, TextureBindings* bindings)
 {
-	if (srv)
-	{
-		devCon->VSSetShaderResources(0, 1, &srv);
-		devCon->PSSetShaderResources(0, 1, &srv);
-	}
-	if (normal)
-	{
-		devCon->VSSetShaderResources(1, 1, &normal);
-		devCon->PSSetShaderResources(1, 1, &normal);
-	}
-	if (bump)
+	ID3D11ShaderResourceView* views[3] = { srv, normal, bump };
+	UINT binds = 0;
+	for (UINT slot = 0; slot < 3; slot++)
 	{
-		devCon->VSSetShaderResources(2, 1, &bump);
-		devCon->PSSetShaderResources(2, 1, &bump);
+		if (!views[slot])
+			continue;
+		if (bindings)
+		{
+			if (bindings->views[slot] == views[slot])
+				continue;
+			bindings->views[slot] = views[slot];
+		}
+		devCon->VSSetShaderResources(slot, 1, &views[slot]);
+		devCon->PSSetShaderResources(slot, 1, &views[slot]);
+		binds++;
 	}
+	return binds;
 }
 
 void Material::SetTileX(float val){ tileXZ[0] = val; }
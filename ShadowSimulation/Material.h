@@ -10,13 +10,45 @@
 #include <DirectXMath.h>
 #include "Shader.h"
 #include "Lights.h"
+#include "TextureCache.h"
+#include "ShaderArchive.h"
+#include "ShaderLibrary.h"
 using namespace DirectX;
 
+/// <summary>Shader resource slots a material binds textures to
+/// </summary>
+enum TextureSlot
+{
+	DiffuseSlot,
+	NormalSlot,
+	BumpSlot
+};
+
+/// <summary>Textures last bound to each material slot, lets draws skip rebinding textures that are already set
+/// Reset it whenever something else may have bound those slots
+/// </summary>
+struct TextureBindings
+{
+	TextureBindings() { Reset(); }
+
+	void Reset()
+	{
+		for (UINT i = 0; i < 3; i++)
+			views[i] = NULL;
+	}
+
+	ID3D11ShaderResourceView* views[3];
+};
+
 class Material
 {
 public:
 	Material(wchar_t* vertfilepath, wchar_t* pixelfilepath, ID3D11SamplerState* _sampler, ID3D11Device* dev);
-	Material(wchar_t* filepath, ID3D11SamplerState* sampler, ID3D11Device* dev);
+	Material(wchar_t* filepath, ID3D11SamplerState* sampler, TextureCache& textures);
+
+	/// <summary>Creates a material with no textures, for textures that are streamed in later
+	/// </summary>
+	Material(ID3D11SamplerState* sampler);
 	virtual ~Material();
 
 	/// <summary>Sets the material's shader to the parameter
@@ -27,15 +59,50 @@ public:
 	/// </summary>
 	void LoadShader(wchar_t* filepath, ShaderType type, ID3D11Device* dev);
 
-	/// <summary>Loads a normal map SRV
+	/// <summary>Creates a shader from bytecode that was already read
+	/// </summary>
+	void LoadShader(ID3DBlob* bytecode, ShaderType type, ID3D11Device* dev);
+
+	/// <summary>Shares the library's shader for bytecode it loaded
 	/// </summary>
-	void LoadNormal(wchar_t* filepath, ID3D11Device* dev);
-	void LoadBump(wchar_t* filepath, ID3D11Device* dev);
+	void LoadShader(ShaderLibrary& library, UINT64 hash, ShaderType type, ID3D11Device* dev);
+
+	/// <summary>Loads the permutation of shader compiled for a feature mask (see ShaderPermutations)
+	/// Returns false, leaving the current shader, if the archive doesn't have that permutation
+	/// </summary>
+	bool LoadPermutation(ShaderLibrary& library, const ShaderArchive& archive, const char* shader, UINT features, ShaderType type, ID3D11Device* dev);
+
+	/// <summary>Feature mask of the permutation loaded last, 0 if the material uses a plain shader file
+	/// </summary>
+	UINT GetFeatures();
+
+	/// <summary>Loads a normal map SRV through the texture cache
+	/// </summary>
+	void LoadNormal(wchar_t* filepath, TextureCache& textures);
+	void LoadBump(wchar_t* filepath, TextureCache& textures);
+
+	/// <summary>Replaces the texture in a slot, taking a reference on the new one
+	/// </summary>
+	void SetTexture(TextureSlot slot, ID3D11ShaderResourceView* view);
+
+	/// <summary>Replaces the texture in a slot with a cached one, keeping it marked as in use
+	/// </summary>
+	void SetTexture(TextureSlot slot, const TextureHandle& texture);
+
+	/// <summary>Points a slot at a region of one slice of a texture array, rect holds the UV offset and scale
+	/// </summary>
+	void SetTextureRegion(TextureSlot slot, ID3D11ShaderResourceView* arrayView, UINT slice, const XMFLOAT4& rect);
+
+	UINT GetTextureSlice(TextureSlot slot);
+	XMFLOAT4 GetTextureRect(TextureSlot slot);
 
 	void SetShader(ID3D11DeviceContext* devCon);
 	void SetLightMaterial(LightMaterial* _lightMat);
 	void SetSampler(ID3D11DeviceContext* devCon);
-	void SetResources(ID3D11DeviceContext* devCon);
+
+	/// <summary>Binds the material's textures, skipping slots bindings says already hold them. Returns the slots bound
+	/// </summary>
+	UINT SetResources(ID3D11DeviceContext* devCon, TextureBindings* bindings = NULL);
 	void SetTileX(float val);
 	void SetTileZ(float val);
 
@@ -48,12 +115,20 @@ public:
 	ID3D11ShaderResourceView* srv;
 	ID3D11SamplerState* sampler;
 private:
+	/// <summary>Makes every slot sample its whole texture
+	/// </summary>
+	void ResetRegions();
+
 	ID3D11ShaderResourceView* normal;
 	ID3D11ShaderResourceView* bump;
+	TextureHandle cachedTextures[3];
+	UINT textureSlices[3];
+	XMFLOAT4 textureRects[3];
 
 	Shader* m_Shader;
 	LightMaterial* lightMat;
 	ID3D11Buffer* cBuffer;
+	UINT features;
 
 	UINT tileXZ[2];
 };
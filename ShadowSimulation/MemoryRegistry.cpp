@@ -0,0 +1,330 @@
+//
+// Central record of where memory goes, CPU side mesh copies and every buffer, texture, view and shader on the device
+//
+
+#include "MemoryRegistry.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+// Owners listed in a snapshot, largest first
+static const UINT SnapshotOwners = 32;
+
+static MemoryRegistry globalRegistry;
+
+static const char* categoryNames[MemoryCategoryCount] =
+{
+	"meshData",
+	"vertexBuffer",
+	"indexBuffer",
+	"constantBuffer",
+	"buffer",
+	"texture",
+	"renderTarget",
+	"depthStencil",
+	"shader",
+	"view"
+};
+
+MemoryRegistry::MemoryRegistry() :
+nextId(1),
+meshDataPolicy(MeshDataDrop),
+deviceBudget(0),
+reportPath("memory.jsonl"),
+reportInterval(10.0f),
+elapsed(0.0),
+lastReport(0.0)
+{
+
+}
+
+MemoryRegistry& MemoryRegistry::Global() { return globalRegistry; }
+
+void MemoryRegistry::ParseCommandLine(const char* cmdLine)
+{
+	if (!cmdLine)
+		return;
+
+	std::istringstream args(cmdLine);
+	std::string arg;
+	while (args >> arg)
+	{
+		size_t split = arg.find('=');
+		if (split == std::string::npos)
+			continue;
+
+		std::string key = arg.substr(0, split);
+		std::string value = arg.substr(split + 1);
+		if (key == "memreport")
+			reportPath = value == "0" ? std::string() : value;
+		else if (key == "memreportinterval")
+			reportInterval = max((float)atof(value.c_str()), 0.0f);
+		else if (key == "gpubudget")
+			deviceBudget = (UINT64)(max(atof(value.c_str()), 0.0) * 1024 * 1024);
+		else if (key == "meshdata")
+		{
+			if (value == "keep")
+				meshDataPolicy = MeshDataKeep;
+			else if (value == "drop")
+				meshDataPolicy = MeshDataDrop;
+			else if (value == "compress")
+				meshDataPolicy = MeshDataCompress;
+		}
+	}
+}
+
+AllocationId MemoryRegistry::Add(MemoryCategory category, const char* owner, UINT64 bytes)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	Allocation allocation;
+	allocation.category = category;
+	allocation.owner = owners.insert(std::make_pair(std::string(owner ? owner : "unknown"), MemoryTotals())).first;
+	allocation.bytes = bytes;
+
+	Grow(categories[category], bytes);
+	Grow(IsDeviceCategory(category) ? device : host, bytes);
+	Grow(allocation.owner->second, bytes);
+
+	AllocationId id = nextId++;
+	allocations[id] = allocation;
+	return id;
+}
+
+void MemoryRegistry::Resize(AllocationId id, UINT64 bytes)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto found = allocations.find(id);
+	if (found == allocations.end())
+		return;
+
+	Allocation& allocation = found->second;
+	MemoryTotals& side = IsDeviceCategory(allocation.category) ? device : host;
+	Shrink(categories[allocation.category], allocation.bytes);
+	Shrink(side, allocation.bytes);
+	Shrink(allocation.owner->second, allocation.bytes);
+	Grow(categories[allocation.category], bytes);
+	Grow(side, bytes);
+	Grow(allocation.owner->second, bytes);
+	allocation.bytes = bytes;
+}
+
+void MemoryRegistry::Remove(AllocationId id)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto found = allocations.find(id);
+	if (found == allocations.end())
+		return;
+
+	// Owners stay listed once seen, their high-water mark is still worth reporting
+	Allocation& allocation = found->second;
+	Shrink(categories[allocation.category], allocation.bytes);
+	Shrink(IsDeviceCategory(allocation.category) ? device : host, allocation.bytes);
+	Shrink(allocation.owner->second, allocation.bytes);
+	allocations.erase(found);
+}
+
+MemoryTotals MemoryRegistry::GetTotals(MemoryCategory category) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return categories[category];
+}
+
+MemoryTotals MemoryRegistry::GetDeviceTotals() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return device;
+}
+
+MemoryTotals MemoryRegistry::GetHostTotals() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return host;
+}
+
+MemoryTotals MemoryRegistry::GetOwnerTotals(const char* owner) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto found = owners.find(owner);
+	return found != owners.end() ? found->second : MemoryTotals();
+}
+
+UINT64 MemoryRegistry::GetDeviceBudget() const { return deviceBudget; }
+
+MeshDataPolicy MemoryRegistry::GetMeshDataPolicy() const { return meshDataPolicy; }
+void MemoryRegistry::SetMeshDataPolicy(MeshDataPolicy policy) { meshDataPolicy = policy; }
+
+// Owner names are paths, backslashes and quotes need escaping
+static void WriteString(std::ostream& out, const std::string& value)
+{
+	out << '"';
+	for (char c : value)
+	{
+		if (c == '"' || c == '\\')
+			out << '\\' << c;
+		else if ((unsigned char)c < 0x20)
+			out << ' ';
+		else
+			out << c;
+	}
+	out << '"';
+}
+
+static void WriteTotals(std::ostream& out, const MemoryTotals& totals)
+{
+	out << "{\"bytes\": " << totals.bytes << ", \"peakBytes\": " << totals.peakBytes << ", \"count\": " << totals.count << "}";
+}
+
+void MemoryRegistry::WriteJSON(std::ostream& out, double seconds) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	out << "{\"time\": " << seconds << ", \"device\": ";
+	WriteTotals(out, device);
+	out << ", \"host\": ";
+	WriteTotals(out, host);
+	out << ", \"deviceBudget\": " << deviceBudget << ", \"overBudget\": " << (deviceBudget > 0 && device.bytes > deviceBudget ? "true" : "false");
+
+	out << ", \"categories\": {";
+	for (UINT i = 0; i < MemoryCategoryCount; i++)
+	{
+		out << (i > 0 ? ", " : "") << '"' << categoryNames[i] << "\": ";
+		WriteTotals(out, categories[i]);
+	}
+	out << "}";
+
+	// The largest owners by what they hold now, then by what they once held
+	std::vector<std::map<std::string, MemoryTotals>::const_iterator> largest;
+	largest.reserve(owners.size());
+	for (auto owner = owners.begin(); owner != owners.end(); ++owner)
+		largest.push_back(owner);
+	UINT listed = min((UINT)largest.size(), SnapshotOwners);
+	std::partial_sort(largest.begin(), largest.begin() + listed, largest.end(),
+		[](std::map<std::string, MemoryTotals>::const_iterator a, std::map<std::string, MemoryTotals>::const_iterator b)
+	{
+		if (a->second.bytes != b->second.bytes)
+			return a->second.bytes > b->second.bytes;
+		return a->second.peakBytes > b->second.peakBytes;
+	});
+
+	out << ", \"owners\": [";
+	for (UINT i = 0; i < listed; i++)
+	{
+		out << (i > 0 ? ", " : "") << "{\"owner\": ";
+		WriteString(out, largest[i]->first);
+		out << ", \"totals\": ";
+		WriteTotals(out, largest[i]->second);
+		out << "}";
+	}
+	out << "], \"ownerCount\": " << owners.size() << "}";
+}
+
+bool MemoryRegistry::WriteSnapshot()
+{
+	if (reportPath.empty())
+		return false;
+
+	std::ofstream file(reportPath.c_str(), std::ios::app);
+	if (!file)
+		return false;
+
+	WriteJSON(file, elapsed);
+	file << "\n";
+	lastReport = elapsed;
+	return file.good();
+}
+
+void MemoryRegistry::Update(float dt)
+{
+	elapsed += dt;
+	if (reportInterval > 0.0f && elapsed - lastReport >= reportInterval)
+		WriteSnapshot();
+}
+
+const char* MemoryRegistry::GetCategoryName(MemoryCategory category) { return categoryNames[category]; }
+
+bool MemoryRegistry::IsDeviceCategory(MemoryCategory category) { return category != MemoryMeshData; }
+
+UINT MemoryRegistry::GetFormatBits(DXGI_FORMAT format, bool& blockCompressed)
+{
+	blockCompressed = false;
+	switch (format)
+	{
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+	case DXGI_FORMAT_R32G32B32A32_UINT:
+		return 128;
+	case DXGI_FORMAT_R32G32B32_FLOAT:
+		return 96;
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+	case DXGI_FORMAT_R16G16B16A16_UNORM:
+	case DXGI_FORMAT_R32G32_FLOAT:
+	case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
+		return 64;
+	case DXGI_FORMAT_R8G8_UNORM:
+	case DXGI_FORMAT_R16_UNORM:
+	case DXGI_FORMAT_R16_FLOAT:
+	case DXGI_FORMAT_R16_TYPELESS:
+	case DXGI_FORMAT_D16_UNORM:
+		return 16;
+	case DXGI_FORMAT_R8_UNORM:
+	case DXGI_FORMAT_A8_UNORM:
+		return 8;
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_UNORM:
+		blockCompressed = true;
+		return 64;
+	case DXGI_FORMAT_BC2_UNORM:
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_UNORM:
+	case DXGI_FORMAT_BC7_UNORM:
+	case DXGI_FORMAT_BC7_UNORM_SRGB:
+		blockCompressed = true;
+		return 128;
+	default:
+		return 32;
+	}
+}
+
+UINT64 MemoryRegistry::GetTextureBytes(UINT width, UINT height, UINT depth, UINT mipLevels, UINT arraySize, UINT samples, DXGI_FORMAT format)
+{
+	bool blockCompressed;
+	UINT bits = GetFormatBits(format, blockCompressed);
+
+	// 0 asks the device for the full chain
+	if (mipLevels == 0)
+	{
+		mipLevels = 1;
+		for (UINT size = max(max(width, height), depth); size > 1; size /= 2)
+			mipLevels++;
+	}
+
+	UINT64 bytes = 0;
+	for (UINT mip = 0; mip < mipLevels; mip++)
+	{
+		if (blockCompressed)
+			bytes += (UINT64)((width + 3) / 4) * ((height + 3) / 4) * depth * bits / 8;
+		else
+			bytes += (UINT64)width * height * depth * bits / 8;
+
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+		depth = depth > 1 ? depth / 2 : 1;
+	}
+	return bytes * max(arraySize, 1u) * max(samples, 1u);
+}
+
+void MemoryRegistry::Grow(MemoryTotals& totals, UINT64 bytes)
+{
+	totals.bytes += bytes;
+	totals.peakBytes = max(totals.peakBytes, totals.bytes);
+	totals.count++;
+}
+
+void MemoryRegistry::Shrink(MemoryTotals& totals, UINT64 bytes)
+{
+	totals.bytes -= bytes;
+	totals.count--;
+}
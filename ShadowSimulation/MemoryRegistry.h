@@ -0,0 +1,144 @@
+//
+// Central record of where memory goes, CPU side mesh copies and every buffer, texture, view and shader on the device
+// Allocations are tagged with a category and an owner (a file path or a system's name), totals and high-water marks
+// are kept for both. Snapshots are appended to a JSON lines file, one object per line, every few seconds
+// Kept free of D3D, TrackedResources measures device objects and reports them here
+// Command line: memreport=memory.jsonl memreportinterval=10 gpubudget=512 (MB) meshdata=keep|drop|compress
+//
+
+#ifndef MEMORYREGISTRY_H
+#define MEMORYREGISTRY_H
+
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <Windows.h>
+#include <dxgiformat.h>
+
+enum MemoryCategory
+{
+	MemoryMeshData,			// CPU copies of mesh vertices and indices kept after upload
+	MemoryVertexBuffer,
+	MemoryIndexBuffer,
+	MemoryConstantBuffer,
+	MemoryBuffer,			// Any other buffer
+	MemoryTexture,
+	MemoryRenderTarget,
+	MemoryDepthStencil,
+	MemoryShader,			// Bytecode size, about what the driver keeps
+	MemoryView,				// Views own no memory, they are only counted
+	MemoryCategoryCount
+};
+
+/// <summary>What a mesh keeps on the CPU once its buffers are on the device
+/// </summary>
+enum MeshDataPolicy
+{
+	MeshDataKeep,			// Every vertex and index
+	MeshDataDrop,			// Nothing, nothing reads the copies yet
+	MeshDataCompress		// Positions, and indices as 16 bits when they fit, enough for picking and collision
+};
+
+struct MemoryTotals
+{
+	MemoryTotals() : bytes(0), peakBytes(0), count(0) {}
+
+	UINT64 bytes;
+	UINT64 peakBytes;
+	UINT count;
+};
+
+typedef UINT64 AllocationId;	// 0 is never handed out
+
+class MemoryRegistry
+{
+public:
+	MemoryRegistry();
+
+	/// <summary>The registry every system reports to
+	/// </summary>
+	static MemoryRegistry& Global();
+
+	void ParseCommandLine(const char* cmdLine);
+
+	/// <summary>Records an allocation, owner is copied. Safe to call from any thread
+	/// </summary>
+	AllocationId Add(MemoryCategory category, const char* owner, UINT64 bytes);
+
+	/// <summary>Changes an allocation's size, as when a mesh drops part of its CPU copy
+	/// </summary>
+	void Resize(AllocationId id, UINT64 bytes);
+
+	void Remove(AllocationId id);
+
+	MemoryTotals GetTotals(MemoryCategory category) const;
+
+	/// <summary>Every category that lives on the device, or every one that doesn't
+	/// </summary>
+	MemoryTotals GetDeviceTotals() const;
+	MemoryTotals GetHostTotals() const;
+
+	MemoryTotals GetOwnerTotals(const char* owner) const;
+
+	/// <summary>Bytes on the device the simulation should stay under, 0 for no budget
+	/// </summary>
+	UINT64 GetDeviceBudget() const;
+
+	MeshDataPolicy GetMeshDataPolicy() const;
+	void SetMeshDataPolicy(MeshDataPolicy policy);
+
+	/// <summary>Writes the totals, every category and the largest owners as one line of JSON
+	/// </summary>
+	void WriteJSON(std::ostream& out, double seconds) const;
+
+	/// <summary>Appends a snapshot to the report file if one is set
+	/// </summary>
+	bool WriteSnapshot();
+
+	/// <summary>Advances the registry's clock and writes a snapshot whenever the report interval has passed
+	/// </summary>
+	void Update(float dt);
+
+	static const char* GetCategoryName(MemoryCategory category);
+	static bool IsDeviceCategory(MemoryCategory category);
+
+	/// <summary>Bits per texel, or per 4x4 block for block compressed formats
+	/// </summary>
+	static UINT GetFormatBits(DXGI_FORMAT format, bool& blockCompressed);
+
+	/// <summary>Size of a texture with every mip level, array slice and sample
+	/// </summary>
+	static UINT64 GetTextureBytes(UINT width, UINT height, UINT depth, UINT mipLevels, UINT arraySize, UINT samples, DXGI_FORMAT format);
+private:
+	struct Allocation
+	{
+		MemoryCategory category;
+		std::map<std::string, MemoryTotals>::iterator owner;
+		UINT64 bytes;
+	};
+
+	MemoryRegistry(const MemoryRegistry&);
+	MemoryRegistry& operator=(const MemoryRegistry&);
+
+	static void Grow(MemoryTotals& totals, UINT64 bytes);
+	static void Shrink(MemoryTotals& totals, UINT64 bytes);
+
+	mutable std::mutex mutex;
+	std::unordered_map<AllocationId, Allocation> allocations;
+	std::map<std::string, MemoryTotals> owners;
+	MemoryTotals categories[MemoryCategoryCount];
+	MemoryTotals device;
+	MemoryTotals host;
+	AllocationId nextId;
+
+	MeshDataPolicy meshDataPolicy;
+	UINT64 deviceBudget;
+	std::string reportPath;
+	float reportInterval;
+	double elapsed;
+	double lastReport;
+};
+
+#endif
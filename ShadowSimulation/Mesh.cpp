@@ -1,56 +1,255 @@
 #include "Mesh.h"
+#include <cstring>
+#include <fstream>
 #include <vector>
 #include "Material.h"
 #include "Game.h"
+#include "MeshCodec.h"
+#include "MeshSimplifier.h"
+#include "Profiler.h"
+#include "TrackedResources.h"
 
-Mesh::Mesh(const char* filepath, ID3D11Device* dev)
+// Meshes with fewer triangles than this get no meshlets, culling a couple of meshlets saves less than it costs
+static const UINT MinMeshletTriangles = 256;
+
+Mesh::Mesh(const char* filepath, GeometryPool& pool) :
+pool(&pool),
+geometry(0),
+hasBounds(false),
+dataAllocation(0),
+meshletAllocation(0)
 {
-	Assimp::Importer importer;
+	PROFILE_ZONE("Mesh::Import");
+	MeshData data;
+	bool imported = Import(filepath, data);
+	if (imported)
+		BuildLODs(data);
+	_vertices.swap(data.vertices);
+	_indices.swap(data.indices);
+
+	numVertices = _vertices.size();
+	numIndices = _indices.size();
+	SetLODs(data.lods.empty() ? NULL : &data.lods[0], (UINT)data.lods.size());
 
-	const aiScene* scene = importer.ReadFile(filepath, aiProcess_CalcTangentSpace | aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_SortByPType);
+	if (imported)
+	{
+		geometry = pool.Add(&_vertices[0], numVertices, &_indices[0], numIndices, filepath);
+		bounds = ComputeMeshBounds(&_vertices[0], numVertices);
+		hasBounds = true;
+		SetMeshlets(data.meshlets, filepath);
+	}
+	ApplyDataPolicy(filepath);
+}
 
-	ProcessScene(scene->mRootNode, scene);
+Mesh::Mesh(Vertex* vertices, UINT numVertices, UINT* indices, UINT numIndices, GeometryPool& pool, const char* owner):
+numVertices(numVertices),
+pool(&pool),
+geometry(0),
+hasBounds(true),
+dataAllocation(0),
+meshletAllocation(0)
+{
+	PROFILE_ZONE("Mesh::CreateBuffers");
+	MeshData data;
+	data.vertices.assign(vertices, vertices + numVertices);
+	data.indices.assign(indices, indices + numIndices);
+	BuildLODs(data);
+
+	this->numIndices = data.indices.size();
+	SetLODs(data.lods.empty() ? NULL : &data.lods[0], (UINT)data.lods.size());
+	geometry = pool.Add(vertices, numVertices, &data.indices[0], this->numIndices, owner);
+	bounds = ComputeMeshBounds(vertices, numVertices);
+	SetMeshlets(data.meshlets, owner);
+}
+
+Mesh::Mesh(MeshData& mesh, GeometryPool& pool, const char* owner) :
+pool(&pool),
+geometry(0),
+hasBounds(true),
+dataAllocation(0),
+meshletAllocation(0)
+{
+	PROFILE_ZONE("Mesh::CreateBuffers");
+	MeshData copy;
+	copy.vertices = mesh.vertices;
+	copy.indices = mesh.indices;
+	copy.lods = mesh.lods;
+	copy.meshlets = mesh.meshlets;
+
+	// Generated meshes are small enough to simplify as they are created, merged ones come with levels but no meshlets
+	if (copy.lods.empty())
+		BuildLODs(copy);
+	else if (copy.meshlets.meshlets.empty())
+		BuildMeshlets(copy);
+	_vertices.swap(copy.vertices);
+	_indices.swap(copy.indices);
+	lods.swap(copy.lods);
 
 	numVertices = _vertices.size();
 	numIndices = _indices.size();
 
-	Vertex * vertices = &_vertices[0];
-	UINT * indices = &_indices[0];
+	geometry = pool.Add(&_vertices[0], numVertices, &_indices[0], numIndices, owner);
+	bounds = ComputeMeshBounds(&_vertices[0], numVertices);
+	SetMeshlets(copy.meshlets, owner);
+	ApplyDataPolicy(owner);
+}
 
-	D3D11_BUFFER_DESC vb;
-	ZeroMemory(&vb, sizeof(D3D11_BUFFER_DESC));
-	vb.Usage = D3D11_USAGE_IMMUTABLE;
-	vb.ByteWidth = sizeof(Vertex) * numVertices;
-	vb.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vb.CPUAccessFlags = 0;
-	vb.MiscFlags = 0;
-	vb.StructureByteStride = 0;
-	D3D11_SUBRESOURCE_DATA initVertData;
-	initVertData.pSysMem = vertices;
-	dev->CreateBuffer(
-		&vb,
-		&initVertData,
-		&vertexBuffer);
+Mesh::Mesh(Mesh* placeholder) :
+numVertices(0),
+numIndices(0),
+pool(NULL),
+geometry(0),
+hasBounds(false),
+dataAllocation(0),
+meshletAllocation(0)
+{
+	const std::vector<MeshLOD>& placeholderLODs = placeholder->GetLODs();
+	SetGeometry(placeholder->GetPool(), placeholder->GetGeometry(), placeholder->numVertices, placeholder->numIndices, NULL,
+		&placeholderLODs[0], (UINT)placeholderLODs.size());
+}
 
-	D3D11_BUFFER_DESC ib;
-	ZeroMemory(&ib, sizeof(D3D11_BUFFER_DESC));
-	ib.Usage = D3D11_USAGE_IMMUTABLE;
-	ib.ByteWidth = sizeof(UINT) * numIndices;
-	ib.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	ib.CPUAccessFlags = 0;
-	ib.MiscFlags = 0;
-	ib.StructureByteStride = 0;
-	D3D11_SUBRESOURCE_DATA initIndexData;
-	initIndexData.pSysMem = indices;
-	dev->CreateBuffer(
-		&ib,
-		&initIndexData,
-		&indexBuffer);
+Mesh::~Mesh()
+{
+	if (pool)
+		pool->Release(geometry);
+	MemoryRegistry::Global().Remove(dataAllocation);
+	MemoryRegistry::Global().Remove(meshletAllocation);
 }
 
-Mesh::Mesh(Vertex* vertices, UINT numVertices, UINT* indices, UINT numIndices, ID3D11Device* dev):
-numVertices(numVertices),
-numIndices(numIndices)
+// Renumbers the vertices in the order the indices first use them, which the GPU fetches with fewer misses
+// and the mesh codec mostly codes as the next new vertex
+static void OrderVerticesByFirstUse(MeshData& data)
+{
+	const UINT Unused = ~0u;
+	std::vector<UINT> remap(data.vertices.size(), Unused);
+	std::vector<Vertex> ordered;
+	std::vector<SkinInfluences> orderedInfluences;
+	ordered.reserve(data.vertices.size());
+	orderedInfluences.reserve(data.influences.size());
+	for (UINT& index : data.indices)
+	{
+		if (remap[index] == Unused)
+		{
+			remap[index] = (UINT)ordered.size();
+			ordered.push_back(data.vertices[index]);
+			if (!data.influences.empty())
+				orderedInfluences.push_back(data.influences[index]);
+		}
+		index = remap[index];
+	}
+	data.vertices.swap(ordered);
+	data.influences.swap(orderedInfluences);
+}
+
+bool Mesh::Import(const char* filepath, MeshData& data)
+{
+	Assimp::Importer importer;
+
+	const aiScene* scene = 0;
+	{
+		PROFILE_ZONE("Assimp::ReadFile");
+		scene = importer.ReadFile(filepath, MeshImportFlags);
+	}
+	return ReadScene(scene, data);
+}
+
+bool Mesh::ReadScene(const aiScene* scene, MeshData& data)
+{
+	if (!scene || !scene->mRootNode)
+		return false;
+
+	bool skinned = false;
+	for (UINT i = 0; i < scene->mNumMeshes; i++)
+		skinned = skinned || scene->mMeshes[i]->HasBones();
+
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+	ProcessScene(scene->mRootNode, scene, identity, skinned, data);
+	OrderVerticesByFirstUse(data);
+	return !data.vertices.empty() && !data.indices.empty();
+}
+
+void Mesh::BuildLODs(MeshData& data)
+{
+	PROFILE_ZONE("Mesh::BuildLODs");
+	data.lods.clear();
+	if (data.vertices.empty())
+		return;
+	MeshSimplifier::BuildLODs(&data.vertices[0], (UINT)data.vertices.size(), data.indices, data.lods, SimplifyOptions());
+	BuildMeshlets(data);
+}
+
+void Mesh::BuildMeshlets(MeshData& data)
+{
+	data.meshlets = MeshletData();
+	if (data.vertices.empty() || data.indices.empty())
+		return;
+
+	MeshLOD full = { 0, (UINT)data.indices.size(), 0.0f };
+	const MeshLOD& level = data.lods.empty() ? full : data.lods[0];
+	MeshletBuilder::Build(&data.vertices[0], (UINT)data.vertices.size(), &data.indices[level.indexStart], level.indexCount, MinMeshletTriangles,
+		data.meshlets);
+}
+
+std::string Mesh::GetCookedPath(const std::string& filepath)
+{
+	size_t split = filepath.find_last_of("./\\");
+	if (split == std::string::npos || filepath[split] != '.')
+		return filepath + ".mesh";
+	return filepath.substr(0, split) + ".mesh";
+}
+
+bool Mesh::ReadCooked(const std::string& path, std::vector<BYTE>& cooked)
+{
+	std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+	std::streamsize size = file ? (std::streamsize)file.tellg() : 0;
+	if (size <= 0)
+		return false;
+
+	std::vector<BYTE> contents((size_t)size);
+	file.seekg(0, std::ios::beg);
+	if (!file.read((char*)&contents[0], size))
+		return false;
+	if (!MeshCodec::IsCompressed(&contents[0], contents.size()))
+	{
+		cooked.swap(contents);
+		return true;
+	}
+
+	PROFILE_ZONE("MeshCodec::Decode");
+	size_t decodedSize = MeshCodec::GetDecodedSize(&contents[0], contents.size());
+	if (decodedSize == 0)
+		return false;
+	cooked.resize(decodedSize);
+	return MeshCodec::Decode(&contents[0], contents.size(), &cooked[0], cooked.size());
+}
+
+bool Mesh::Load(const char* filepath, MeshData& data)
+{
+	PROFILE_ZONE("Mesh::Load");
+	std::vector<BYTE> cooked;
+	if (ReadCooked(GetCookedPath(filepath), cooked))
+	{
+		CookedMesh mesh;
+		if (ParseCookedMesh(&cooked[0], cooked.size(), mesh))
+		{
+			const CookedMeshHeader& header = mesh.header;
+			data.vertices.assign(mesh.vertices, mesh.vertices + header.numVertices);
+			data.indices.assign(mesh.indices, mesh.indices + header.numIndices);
+			data.lods.assign(mesh.lods, mesh.lods + header.numLODs);
+			ReadCookedMeshlets(mesh, data.meshlets);
+			return true;
+		}
+	}
+
+	if (!Import(filepath, data))
+		return false;
+	BuildLODs(data);
+	return true;
+}
+
+bool Mesh::CreateBuffers(const Vertex* vertices, UINT numVertices, const UINT* indices, UINT numIndices, ID3D11Device* dev, const char* owner,
+	ID3D11Buffer** vertexBuffer, ID3D11Buffer** indexBuffer)
 {
 	D3D11_BUFFER_DESC vb;
 	ZeroMemory(&vb, sizeof(D3D11_BUFFER_DESC));
@@ -62,10 +261,8 @@ numIndices(numIndices)
 	vb.StructureByteStride = 0;
 	D3D11_SUBRESOURCE_DATA initVertData;
 	initVertData.pSysMem = vertices;
-	dev->CreateBuffer(
-		&vb,
-		&initVertData,
-		&vertexBuffer);
+	if (FAILED(TrackedResources::CreateBuffer(dev, &vb, &initVertData, owner, vertexBuffer)))
+		return false;
 
 	D3D11_BUFFER_DESC ib;
 	ZeroMemory(&ib, sizeof(D3D11_BUFFER_DESC));
@@ -77,77 +274,128 @@ numIndices(numIndices)
 	ib.StructureByteStride = 0;
 	D3D11_SUBRESOURCE_DATA initIndexData;
 	initIndexData.pSysMem = indices;
-	dev->CreateBuffer(
-		&ib,
-		&initIndexData,
-		&indexBuffer);
+	if (FAILED(TrackedResources::CreateBuffer(dev, &ib, &initIndexData, owner, indexBuffer)))
+	{
+		ReleaseMacro((*vertexBuffer));
+		return false;
+	}
+	return true;
 }
 
-Mesh::Mesh(MeshData& mesh, ID3D11Device* dev)
+void Mesh::SetGeometry(GeometryPool* _pool, GeometryHandle _geometry, UINT _numVertices, UINT _numIndices, const MeshBounds* _bounds,
+	const MeshLOD* _lods, UINT lodCount)
 {
-	_vertices = mesh.vertices;
-	_indices = mesh.indices;
+	if (_pool)
+		_pool->AddRef(_geometry);
+	if (pool)
+		pool->Release(geometry);
 
-	Vertex* vertices = &mesh.vertices[0];
-	UINT*   indices  = &mesh.indices[0];
+	pool = _pool;
+	geometry = _geometry;
+	numVertices = _numVertices;
+	numIndices = _numIndices;
 
-	numVertices = mesh.vertices.size();
-	numIndices = mesh.indices.size();
+	hasBounds = _bounds != NULL;
+	if (_bounds)
+		bounds = *_bounds;
+	SetLODs(_lods, lodCount);
+}
 
-	D3D11_BUFFER_DESC vb;
-	ZeroMemory(&vb, sizeof(D3D11_BUFFER_DESC));
-	vb.Usage = D3D11_USAGE_IMMUTABLE;
-	vb.ByteWidth = sizeof(Vertex) * mesh.vertices.size();
-	vb.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vb.CPUAccessFlags = 0;
-	vb.MiscFlags = 0;
-	vb.StructureByteStride = 0;
-	D3D11_SUBRESOURCE_DATA initVertData;
-	initVertData.pSysMem = vertices;
-	dev->CreateBuffer(
-		&vb,
-		&initVertData,
-		&vertexBuffer);
+void Mesh::ApplyDataPolicy(const char* owner)
+{
+	MeshDataPolicy policy = MemoryRegistry::Global().GetMeshDataPolicy();
+	if (policy == MeshDataCompress)
+	{
+		_positions.resize(_vertices.size());
+		for (size_t i = 0; i < _vertices.size(); i++)
+			_positions[i] = _vertices[i].Position;
 
-	D3D11_BUFFER_DESC ib;
-	ZeroMemory(&ib, sizeof(D3D11_BUFFER_DESC));
-	ib.Usage = D3D11_USAGE_IMMUTABLE;
-	ib.ByteWidth = sizeof(UINT) * mesh.indices.size();
-	ib.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	ib.CPUAccessFlags = 0;
-	ib.MiscFlags = 0;
-	ib.StructureByteStride = 0;
-	D3D11_SUBRESOURCE_DATA initIndexData;
-	initIndexData.pSysMem = indices;
-	dev->CreateBuffer(
-		&ib,
-		&initIndexData,
-		&indexBuffer);
+		if (_vertices.size() <= 0x10000)
+		{
+			_shortIndices.resize(_indices.size());
+			for (size_t i = 0; i < _indices.size(); i++)
+				_shortIndices[i] = (USHORT)_indices[i];
+			std::vector<UINT>().swap(_indices);
+		}
+	}
+	if (policy != MeshDataKeep)
+		std::vector<Vertex>().swap(_vertices);
+	if (policy == MeshDataDrop)
+		std::vector<UINT>().swap(_indices);
+
+	UINT64 bytes = _vertices.capacity() * sizeof(Vertex) + _indices.capacity() * sizeof(UINT) + _positions.capacity() * sizeof(XMFLOAT3) +
+		_shortIndices.capacity() * sizeof(USHORT);
+	if (bytes > 0)
+		dataAllocation = MemoryRegistry::Global().Add(MemoryMeshData, owner, bytes);
 }
 
-Mesh::~Mesh()
+void Mesh::SetLODs(const MeshLOD* _lods, UINT lodCount)
+{
+	if (_lods && lodCount > 0)
+	{
+		lods.assign(_lods, _lods + lodCount);
+		return;
+	}
+	MeshLOD full = { 0, numIndices, 0.0f };
+	lods.assign(1, full);
+}
+
+void Mesh::SetMeshlets(MeshletData& _meshlets, const char* owner)
+{
+	meshlets = MeshletData();
+	meshlets.meshlets.swap(_meshlets.meshlets);
+	meshlets.vertices.swap(_meshlets.vertices);
+	meshlets.triangles.swap(_meshlets.triangles);
+	meshlets.bounds.swap(_meshlets.bounds);
+
+	MemoryRegistry::Global().Remove(meshletAllocation);
+	meshletAllocation = 0;
+	if (!meshlets.meshlets.empty())
+		meshletAllocation = MemoryRegistry::Global().Add(MemoryMeshData, owner, meshlets.GetBytes());
+}
+
+const MeshletData& Mesh::GetMeshlets() const { return meshlets; }
+
+bool Mesh::GetBounds(MeshBounds& _bounds) const
 {
-	ReleaseMacro(vertexBuffer);
-	ReleaseMacro(indexBuffer);
+	if (hasBounds)
+		_bounds = bounds;
+	return hasBounds;
 }
 
+const std::vector<MeshLOD>& Mesh::GetLODs() const { return lods; }
 
-void Mesh::ProcessScene(aiNode* node, const aiScene* scene)
+const MeshLOD& Mesh::GetLOD(UINT level) const
 {
-	for (int i = 0; i < node->mNumMeshes; i++)
+	return lods[min(level, (UINT)lods.size() - 1)];
+}
+
+void Mesh::ProcessScene(aiNode* node, const aiScene* scene, const XMFLOAT4X4& parent, bool skinned, MeshData& data)
+{
+	// Assimp's matrices transform column vectors, transposed they fit DirectX Math's row vectors
+	XMFLOAT4X4 local(&node->mTransformation.a1);
+	XMFLOAT4X4 transform;
+	XMStoreFloat4x4(&transform, XMMatrixTranspose(XMLoadFloat4x4(&local)) * XMLoadFloat4x4(&parent));
+
+	for (UINT i = 0; i < node->mNumMeshes; i++)
 	{
-		aiMesh* mesh = scene->mMeshes[i];
-		ProcessMesh(mesh, scene);
+		aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+		ProcessMesh(mesh, node, transform, skinned, data);
 	}
 
-	for (int i = 0; i < node->mNumChildren; i++)
+	for (UINT i = 0; i < node->mNumChildren; i++)
 	{
-		ProcessScene(node->mChildren[i], scene);
+		ProcessScene(node->mChildren[i], scene, transform, skinned, data);
 	}
 }
 
-void Mesh::ProcessMesh(aiMesh* mesh, const aiScene* scene)
+void Mesh::ProcessMesh(aiMesh* mesh, aiNode* node, const XMFLOAT4X4& transform, bool skinned, MeshData& data)
 {
+	// Normals go through the inverse transpose so non-uniform scales keep them perpendicular to the surface
+	XMMATRIX world = XMLoadFloat4x4(&transform);
+	XMMATRIX normalWorld = XMMatrixTranspose(XMMatrixInverse(nullptr, world));
+	UINT baseVertex = (UINT)data.vertices.size();
+
 	for (int i = 0; i < mesh->mNumVertices; i++)
 	{
 		Vertex temp;
@@ -157,13 +405,13 @@ void Mesh::ProcessMesh(aiMesh* mesh, const aiScene* scene)
 		tempvec.x = mesh->mVertices[i].x;
 		tempvec.y = mesh->mVertices[i].y;
 		tempvec.z = mesh->mVertices[i].z;
-		temp.Position = tempvec;
+		XMStoreFloat3(&temp.Position, XMVector3TransformCoord(XMLoadFloat3(&tempvec), world));
 
 		// Normals
 		tempvec.x = mesh->mNormals[i].x;
 		tempvec.y = mesh->mNormals[i].y;
 		tempvec.z = mesh->mNormals[i].z;
-		temp.Normal = tempvec;
+		XMStoreFloat3(&temp.Normal, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&tempvec), normalWorld)));
 
 		// Tangents
 		if (mesh->mTangents)
@@ -177,7 +425,7 @@ void Mesh::ProcessMesh(aiMesh* mesh, const aiScene* scene)
 			tempvec.x = 1.0;
 			tempvec.y = tempvec.z = 0.0;
 		}
-		temp.Tangent = tempvec;
+		XMStoreFloat3(&temp.Tangent, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&tempvec), world)));
 
 		// Colors
 		if (mesh->mColors[0])
@@ -204,20 +452,96 @@ void Mesh::ProcessMesh(aiMesh* mesh, const aiScene* scene)
 		}
 		temp.UV.x = tempvec.x;
 		temp.UV.y = tempvec.y;
-		_vertices.push_back(temp);
+		data.vertices.push_back(temp);
 	}
 
+	// Indices are the mesh's own, offset past the vertices of meshes already read. Mirroring transforms flip the winding
+	bool mirrored = XMVectorGetX(XMMatrixDeterminant(world)) < 0.0f;
 	for (int i = 0; i < mesh->mNumFaces; i++)
 	{
 		aiFace face = mesh->mFaces[i];
 		for (int j = 0; j < face.mNumIndices; j++)
 		{
-			_indices.push_back(face.mIndices[j]);
+			UINT corner = mirrored ? face.mNumIndices - 1 - j : j;
+			data.indices.push_back(baseVertex + face.mIndices[corner]);
 		}
 	}
+
+	if (!skinned)
+		return;
+
+	///
+	// Influences
+	// Vertices were moved into the model's space above, so each bone's offset matrix is preceded by the way back
+	///
+	XMMATRIX toMesh = XMMatrixInverse(nullptr, world);
+	SkinInfluences none;
+	ZeroMemory(&none, sizeof(none));
+	data.influences.resize(data.vertices.size(), none);
+	if (!mesh->HasBones())
+	{
+		XMFLOAT4X4 inverseBind;
+		XMStoreFloat4x4(&inverseBind, toMesh);
+		BYTE bone = (BYTE)FindBone(node->mName.C_Str(), inverseBind, data);
+		for (UINT i = baseVertex; i < data.vertices.size(); i++)
+		{
+			data.influences[i].joints[0] = bone;
+			data.influences[i].weights[0] = 1.0f;
+		}
+		return;
+	}
+	for (UINT i = 0; i < mesh->mNumBones; i++)
+	{
+		const aiBone* source = mesh->mBones[i];
+		XMFLOAT4X4 offset(&source->mOffsetMatrix.a1);
+		XMFLOAT4X4 inverseBind;
+		XMStoreFloat4x4(&inverseBind, toMesh * XMMatrixTranspose(XMLoadFloat4x4(&offset)));
+		BYTE bone = (BYTE)FindBone(source->mName.C_Str(), inverseBind, data);
+
+		// The four heaviest influences of each vertex are kept
+		for (UINT j = 0; j < source->mNumWeights; j++)
+		{
+			const aiVertexWeight& weight = source->mWeights[j];
+			SkinInfluences& skin = data.influences[baseVertex + weight.mVertexId];
+			int lightest = 0;
+			for (int k = 1; k < 4; k++)
+			{
+				if (skin.weights[k] < skin.weights[lightest])
+					lightest = k;
+			}
+			if (weight.mWeight > skin.weights[lightest])
+			{
+				skin.joints[lightest] = bone;
+				skin.weights[lightest] = weight.mWeight;
+			}
+		}
+	}
+	for (UINT i = baseVertex; i < data.vertices.size(); i++)
+	{
+		SkinInfluences& skin = data.influences[i];
+		float total = skin.weights[0] + skin.weights[1] + skin.weights[2] + skin.weights[3];
+		for (int k = 0; k < 4 && total > 0.0f; k++)
+			skin.weights[k] /= total;
+	}
+}
+
+UINT Mesh::FindBone(const std::string& name, const XMFLOAT4X4& inverseBind, MeshData& data)
+{
+	for (UINT i = 0; i < data.bones.size(); i++)
+	{
+		if (data.bones[i].name == name)
+			return i;
+	}
+	MeshBone bone = { name, inverseBind };
+	data.bones.push_back(bone);
+	return (UINT)data.bones.size() - 1;
 }
 
 UINT Mesh::GetNumVertices(){ return numVertices; }
 UINT Mesh::GetNumIndices(){ return numIndices; }
-ID3D11Buffer* Mesh::GetVertexBuffer(){ return vertexBuffer; }
-ID3D11Buffer* Mesh::GetIndexBuffer(){ return indexBuffer;}
\ No newline at end of file
+ID3D11Buffer* Mesh::GetVertexBuffer(){ return pool ? pool->GetVertexBuffer(geometry) : NULL; }
+ID3D11Buffer* Mesh::GetIndexBuffer(){ return pool ? pool->GetIndexBuffer(geometry) : NULL; }
+UINT Mesh::GetBaseVertex(){ return pool ? pool->GetBaseVertex(geometry) : 0; }
+UINT Mesh::GetStartIndex(){ return pool ? pool->GetStartIndex(geometry) : 0; }
+GeometryPool* Mesh::GetPool() const { return pool; }
+GeometryHandle Mesh::GetGeometry() const { return geometry; }
\ No newline at end of file
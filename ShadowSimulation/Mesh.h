@@ -8,43 +8,144 @@
 #define MESH_H
 
 #include <d3d11.h>
+#include <string>
 #include <vector>
 #include <assimp\Importer.hpp>
 #include <assimp\scene.h>
 #include <assimp\postprocess.h>
 
-#include "Vertex.h"
+#include "GeometryPool.h"
+#include "MemoryRegistry.h"
+#include "MeshData.h"
 
-struct MeshData
-{
-	std::vector<Vertex> vertices;
-	std::vector<UINT> indices;
-};
+// Post processing every imported model goes through
+static const UINT MeshImportFlags = aiProcess_CalcTangentSpace | aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_SortByPType |
+	aiProcess_ImproveCacheLocality;
 
 class Mesh
 {
 public:
-	Mesh(const char* filepath, ID3D11Device* dev);
-	Mesh(Vertex* vertices, UINT _numVertices, UINT* indices, UINT _numIndices, ID3D11Device* dev);
-	Mesh(MeshData& mesh, ID3D11Device* dev);
+	Mesh(const char* filepath, GeometryPool& pool);
+	Mesh(Vertex* vertices, UINT _numVertices, UINT* indices, UINT _numIndices, GeometryPool& pool, const char* owner);
+	Mesh(MeshData& mesh, GeometryPool& pool, const char* owner);
+
+	/// <summary>Creates a mesh that shares the placeholder's geometry until its real data is streamed in
+	/// </summary>
+	Mesh(Mesh* placeholder);
 	~Mesh();
 
+	/// <summary>Reads a model file into CPU memory without touching the device, safe to call from any thread
+	/// </summary>
+	static bool Import(const char* filepath, MeshData& data);
+
+	/// <summary>Reads every mesh of a scene Assimp loaded with at least MeshImportFlags. Models with bones also get their
+	/// influences, meshes without any are bound rigidly to their own node
+	/// </summary>
+	static bool ReadScene(const aiScene* scene, MeshData& data);
+
+	/// <summary>Simplifies the mesh into its chain of levels of detail, which can take a while for large models
+	/// Also splits the full level into meshlets
+	/// </summary>
+	static void BuildLODs(MeshData& data);
+
+	/// <summary>Splits the full level into meshlets if the mesh is large enough to be worth culling piece by piece
+	/// </summary>
+	static void BuildMeshlets(MeshData& data);
+
+	/// <summary>Cooked meshes sit next to the model with a .mesh extension
+	/// </summary>
+	static std::string GetCookedPath(const std::string& filepath);
+
+	/// <summary>Reads a cooked mesh file, decoding it if it was compressed. Parse the result with ParseCookedMesh
+	/// Returns false if there is no such file or it is corrupt
+	/// </summary>
+	static bool ReadCooked(const std::string& path, std::vector<BYTE>& cooked);
+
+	/// <summary>Reads the cooked mesh next to the model, or imports the model and builds its levels of detail when there is none
+	/// Safe to call from any thread
+	/// </summary>
+	static bool Load(const char* filepath, MeshData& data);
+
+	/// <summary>Creates immutable vertex and index buffers for the given data, reported to the MemoryRegistry under owner
+	/// Meshes live in a GeometryPool, this is for a pool that has been turned off
+	/// </summary>
+	static bool CreateBuffers(const Vertex* vertices, UINT numVertices, const UINT* indices, UINT numIndices, ID3D11Device* dev, const char* owner,
+		ID3D11Buffer** vertexBuffer, ID3D11Buffer** indexBuffer);
+
+	/// <summary>Swaps the geometry the mesh draws, taking a reference on the new one
+	/// bounds are those of the new vertices, NULL while a placeholder is drawn in the mesh's place
+	/// Without a LOD table the whole index range is the only level
+	/// </summary>
+	void SetGeometry(GeometryPool* pool, GeometryHandle geometry, UINT numVertices, UINT numIndices, const MeshBounds* bounds,
+		const MeshLOD* lods, UINT lodCount);
+
+	/// <summary>Takes the meshlets of the geometry last set, leaving meshlets empty. They are kept on the CPU for culling
+	/// whatever the mesh data policy, reported to the MemoryRegistry under owner
+	/// </summary>
+	void SetMeshlets(MeshletData& meshlets, const char* owner);
+
+	/// <summary>Meshlets of the full level, empty if the mesh has none
+	/// </summary>
+	const MeshletData& GetMeshlets() const;
+
+	/// <summary>Returns false while the mesh's extent isn't known, objects drawing it can't be culled
+	/// </summary>
+	bool GetBounds(MeshBounds& bounds) const;
+
+	/// <summary>Levels of detail from the full mesh down, there is always at least one
+	/// </summary>
+	const std::vector<MeshLOD>& GetLODs() const;
+
+	/// <summary>Returns the level's index range, levels past the last are drawn at the last
+	/// </summary>
+	const MeshLOD& GetLOD(UINT level) const;
+
 	UINT GetNumVertices();
 	UINT GetNumIndices();
 	ID3D11Buffer* GetVertexBuffer();
 	ID3D11Buffer* GetIndexBuffer();
 
+	/// <summary>Where the mesh starts in its buffers, LOD index ranges are relative to the start index
+	/// </summary>
+	UINT GetBaseVertex();
+	UINT GetStartIndex();
+
+	GeometryPool* GetPool() const;
+	GeometryHandle GetGeometry() const;
+
 	UINT numVertices;
 	UINT numIndices;
 
+	// CPU copy left after upload, whatever the MemoryRegistry's mesh data policy keeps: every vertex and index, nothing,
+	// or positions with indices in 16 bits when they fit (_indices is then empty)
 	std::vector<Vertex> _vertices;
 	std::vector<UINT>  _indices;
+	std::vector<XMFLOAT3> _positions;
+	std::vector<USHORT> _shortIndices;
 private:
-	ID3D11Buffer* vertexBuffer;
-	ID3D11Buffer* indexBuffer;
+	GeometryPool* pool;
+	GeometryHandle geometry;	// 0 while there is nothing to draw
+	MeshBounds bounds;
+	bool hasBounds;
+	std::vector<MeshLOD> lods;
+	MeshletData meshlets;
+	AllocationId dataAllocation;	// The CPU copy's bytes in the MemoryRegistry
+	AllocationId meshletAllocation;
+
+	/// <summary>Trims the CPU copy once the buffers are made and reports what's left
+	/// </summary>
+	void ApplyDataPolicy(const char* owner);
+
+	void SetLODs(const MeshLOD* lods, UINT lodCount);
 	
-	void ProcessScene(aiNode* node, const aiScene* scene);
-	void ProcessMesh(aiMesh* mesh, const aiScene* scene);
+	/// <summary>Reads the meshes of node and its children with their node transforms, parent is the transform above node
+	/// </summary>
+	static void ProcessScene(aiNode* node, const aiScene* scene, const XMFLOAT4X4& parent, bool skinned, MeshData& data);
+	static void ProcessMesh(aiMesh* mesh, aiNode* node, const XMFLOAT4X4& transform, bool skinned, MeshData& data);
+
+	/// <summary>Index of the bone in data, added if it isn't there yet
+	/// </summary>
+	static UINT FindBone(const std::string& name, const XMFLOAT4X4& inverseBind, MeshData& data);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,715 @@
+//
+// Lossless compression of cooked meshes, so .mesh files are small to ship to every render node and quick to load
+// Decoding unpacks sixteen bytes at a time with SSE2, the index and Huffman decoders are plain table driven loops
+//
+
+#include "MeshCodec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <emmintrin.h>
+#include <functional>
+#include <queue>
+
+#include "MeshData.h"
+
+// Vertices are coded in blocks of this many, small enough that a block's bytes stay in the first level cache
+static const UINT VertexBlockSize = 256;
+
+// Bytes of a word's difference are packed this many vertices at a time, each group at the fewest bits that hold it
+static const UINT VertexGroupSize = 16;
+
+// Widest element the vertex coder takes, in 32 bit words
+static const UINT MaxVertexWords = 64;
+
+// Bytes a group takes at each of its four widths: all zero, 2, 4 and 8 bits
+static const UINT GroupBytes[] = { 0, 4, 8, 16 };
+
+// Index codes, two to a byte. The next unused vertex, one of the FIFO's entries newest first, or an explicit
+// zigzagged difference from the index before written as a varint after the codes
+static const UINT IndexNew = 0;
+static const UINT IndexFifoSize = 14;
+static const UINT IndexExplicit = 15;
+
+// Longest Huffman code, which keeps the decoding table at 4096 entries
+static const UINT HuffmanMaxBits = 12;
+static const UINT HuffmanTableSize = 1 << HuffmanMaxBits;
+
+// Zero bytes after a Huffman stream, so the decoder can always read eight bytes at once until the real data ends
+static const UINT HuffmanPadding = 8;
+
+/// <summary>How each section of a cooked mesh is coded
+/// </summary>
+enum SectionCoding
+{
+	CodeRaw,
+	CodeVertices,
+	CodeIndices
+};
+
+struct SectionFormat
+{
+	SectionCoding coding;
+	UINT stride;
+};
+
+// Indexed by CookedMeshSection. Meshlet vertices are close to one another within a meshlet but don't follow
+// first use order, so they do better as differences than through the index FIFO
+static const SectionFormat SectionFormats[] =
+{
+	{ CodeRaw, 1 },
+	{ CodeRaw, 1 },
+	{ CodeVertices, sizeof(Vertex) },
+	{ CodeIndices, sizeof(UINT) },
+	{ CodeVertices, sizeof(Meshlet) },
+	{ CodeVertices, sizeof(UINT) },
+	{ CodeVertices, sizeof(float) },
+	{ CodeRaw, 1 }
+};
+
+static inline UINT ZigZag(UINT value)
+{
+	return (value << 1) ^ (UINT)((int)value >> 31);
+}
+
+static inline UINT UnZigZag(UINT value)
+{
+	return (value >> 1) ^ (0 - (value & 1));
+}
+
+static void AppendUINT(std::vector<BYTE>& out, UINT value)
+{
+	size_t start = out.size();
+	out.resize(start + sizeof(UINT));
+	memcpy(&out[start], &value, sizeof(UINT));
+}
+
+static bool ReadUINT(const BYTE*& data, const BYTE* end, UINT& value)
+{
+	if ((size_t)(end - data) < sizeof(UINT))
+		return false;
+	memcpy(&value, data, sizeof(UINT));
+	data += sizeof(UINT);
+	return true;
+}
+
+bool MeshCodec::IsCompressed(const BYTE* data, size_t size)
+{
+	UINT magic;
+	if (size < sizeof(CompressedMeshHeader))
+		return false;
+	memcpy(&magic, data, sizeof(UINT));
+	return magic == CompressedMeshMagic;
+}
+
+size_t MeshCodec::GetDecodedSize(const BYTE* data, size_t size)
+{
+	if (!IsCompressed(data, size))
+		return 0;
+	CompressedMeshHeader header;
+	memcpy(&header, data, sizeof(header));
+	if (header.payloadSize != size - sizeof(header))
+		return 0;
+	return header.rawSize;
+}
+
+///
+// Whole meshes
+///
+bool MeshCodec::Encode(const BYTE* cooked, size_t size, bool entropy, std::vector<BYTE>& compressed)
+{
+	CookedMesh mesh;
+	if (!ParseCookedMesh(cooked, size, mesh))
+		return false;
+	UINT64 sizes[CookedMeshSections];
+	GetCookedMeshSections(mesh.header, sizes);
+
+	// Every section is written after its coded length
+	std::vector<BYTE> payload;
+	const BYTE* section = cooked;
+	for (UINT i = 0; i < CookedMeshSections; i++)
+	{
+		const SectionFormat& format = SectionFormats[i];
+		size_t start = payload.size();
+		AppendUINT(payload, 0);
+		if (format.coding == CodeVertices)
+			EncodeVertices(section, (UINT)(sizes[i] / format.stride), format.stride, payload);
+		else if (format.coding == CodeIndices)
+			EncodeIndices((const UINT*)section, (UINT)(sizes[i] / sizeof(UINT)), payload);
+		else
+			payload.insert(payload.end(), section, section + (size_t)sizes[i]);
+		UINT length = (UINT)(payload.size() - start - sizeof(UINT));
+		memcpy(&payload[start], &length, sizeof(UINT));
+		section += sizes[i];
+	}
+
+	CompressedMeshHeader header = { CompressedMeshMagic, 0, (UINT)size, 0 };
+	std::vector<BYTE> coded;
+	if (entropy)
+	{
+		AppendUINT(coded, (UINT)payload.size());
+		EncodeEntropy(&payload[0], payload.size(), coded);
+		if (coded.size() < payload.size())
+		{
+			header.flags |= MeshCodecEntropy;
+			payload.swap(coded);
+		}
+	}
+
+	header.payloadSize = (UINT)payload.size();
+	compressed.resize(sizeof(header) + payload.size());
+	memcpy(&compressed[0], &header, sizeof(header));
+	memcpy(&compressed[sizeof(header)], &payload[0], payload.size());
+	return true;
+}
+
+bool MeshCodec::Decode(const BYTE* data, size_t size, BYTE* out, size_t outSize)
+{
+	size_t rawSize = GetDecodedSize(data, size);
+	if (rawSize < sizeof(CookedMeshHeader) || outSize < rawSize)
+		return false;
+	CompressedMeshHeader header;
+	memcpy(&header, data, sizeof(header));
+
+	const BYTE* cursor = data + sizeof(header);
+	const BYTE* end = cursor + header.payloadSize;
+	std::vector<BYTE> expanded;
+	if (header.flags & MeshCodecEntropy)
+	{
+		// The coded sections are never much larger than the mesh, anything past that is corrupt
+		UINT expandedSize;
+		if (!ReadUINT(cursor, end, expandedSize) || expandedSize > rawSize + rawSize / 4 + 4096)
+			return false;
+		expanded.resize(expandedSize);
+		if (expandedSize > 0 && DecodeEntropy(cursor, end - cursor, &expanded[0], expandedSize) != (size_t)(end - cursor))
+			return false;
+		cursor = expanded.empty() ? NULL : &expanded[0];
+		end = cursor + expanded.size();
+	}
+
+	// The sizes of every other section come from the header, which is the first
+	UINT64 sizes[CookedMeshSections] = { sizeof(CookedMeshHeader) };
+	BYTE* section = out;
+	for (UINT i = 0; i < CookedMeshSections; i++)
+	{
+		UINT length;
+		if (!ReadUINT(cursor, end, length) || length > (size_t)(end - cursor))
+			return false;
+
+		const SectionFormat& format = SectionFormats[i];
+		UINT count = (UINT)(sizes[i] / format.stride);
+		size_t read = length;
+		if (format.coding == CodeVertices)
+			read = DecodeVertices(cursor, length, count, format.stride, section);
+		else if (format.coding == CodeIndices)
+			read = DecodeIndices(cursor, length, count, (UINT*)section);
+		else if (length == sizes[i] && length > 0)
+			memcpy(section, cursor, length);
+		if (read != length || (format.coding == CodeRaw && length != sizes[i]))
+			return false;
+		cursor += length;
+		section += sizes[i];
+
+		if (i == CookedHeader)
+		{
+			CookedMeshHeader cookedHeader;
+			memcpy(&cookedHeader, out, sizeof(cookedHeader));
+			GetCookedMeshSections(cookedHeader, sizes);
+			UINT64 total = 0;
+			for (UINT j = 0; j < CookedMeshSections; j++)
+				total += sizes[j];
+			if (cookedHeader.magic != CookedMeshMagic || total != rawSize)
+				return false;
+		}
+	}
+	return cursor == end;
+}
+
+///
+// Vertices
+///
+void MeshCodec::EncodeVertices(const BYTE* vertices, UINT count, UINT stride, std::vector<BYTE>& out)
+{
+	UINT words = stride / sizeof(UINT);
+	BYTE planes[sizeof(UINT)][VertexBlockSize];
+	for (UINT base = 0; base < count; base += VertexBlockSize)
+	{
+		UINT blockCount = min(VertexBlockSize, count - base);
+		UINT groups = (blockCount + VertexGroupSize - 1) / VertexGroupSize;
+		for (UINT word = 0; word < words; word++)
+		{
+			// Each word's difference from the vertex before is split into byte planes, the high ones mostly zero
+			memset(planes, 0, sizeof(planes));
+			for (UINT i = 0; i < blockCount; i++)
+			{
+				UINT value;
+				UINT previous = 0;
+				memcpy(&value, vertices + (size_t)(base + i) * stride + word * sizeof(UINT), sizeof(UINT));
+				if (base + i > 0)
+					memcpy(&previous, vertices + (size_t)(base + i - 1) * stride + word * sizeof(UINT), sizeof(UINT));
+				UINT delta = ZigZag(value - previous);
+				for (UINT plane = 0; plane < sizeof(UINT); plane++)
+					planes[plane][i] = (BYTE)(delta >> (plane * 8));
+			}
+
+			for (UINT plane = 0; plane < sizeof(UINT); plane++)
+			{
+				// Two bits per group pick its width, all of a plane's before its groups
+				size_t header = out.size();
+				out.resize(header + (groups + 3) / 4, 0);
+				for (UINT group = 0; group < groups; group++)
+				{
+					const BYTE* values = &planes[plane][group * VertexGroupSize];
+					BYTE largest = *std::max_element(values, values + VertexGroupSize);
+					UINT mode = largest == 0 ? 0 : largest < 4 ? 1 : largest < 16 ? 2 : 3;
+					out[header + group / 4] |= (BYTE)(mode << (group % 4 * 2));
+
+					if (mode == 1)
+					{
+						for (UINT i = 0; i < VertexGroupSize; i += 4)
+							out.push_back((BYTE)(values[i] << 6 | values[i + 1] << 4 | values[i + 2] << 2 | values[i + 3]));
+					}
+					else if (mode == 2)
+					{
+						for (UINT i = 0; i < VertexGroupSize; i += 2)
+							out.push_back((BYTE)(values[i] << 4 | values[i + 1]));
+					}
+					else if (mode == 3)
+						out.insert(out.end(), values, values + VertexGroupSize);
+				}
+			}
+		}
+	}
+}
+
+/// <summary>Unpacks one byte plane of a block. Returns where its data ends, NULL if it runs past end
+/// </summary>
+static const BYTE* DecodePlane(const BYTE* data, const BYTE* end, UINT groups, BYTE* plane)
+{
+	const BYTE* header = data;
+	data += (groups + 3) / 4;
+	if (data > end)
+		return NULL;
+
+	// Checked up front so the groups unpack without bounds checks
+	size_t bytes = 0;
+	for (UINT group = 0; group < groups; group++)
+		bytes += GroupBytes[(header[group / 4] >> (group % 4 * 2)) & 3];
+	if (bytes > (size_t)(end - data))
+		return NULL;
+
+	const __m128i twoBits = _mm_set1_epi8(3);
+	const __m128i fourBits = _mm_set1_epi8(15);
+	for (UINT group = 0; group < groups; group++)
+	{
+		__m128i values;
+		switch ((header[group / 4] >> (group % 4 * 2)) & 3)
+		{
+		case 0:
+			values = _mm_setzero_si128();
+			break;
+		case 1:
+		{
+			int packed;
+			memcpy(&packed, data, sizeof(packed));
+			__m128i v = _mm_cvtsi32_si128(packed);
+			__m128i ab = _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(v, 6), twoBits), _mm_and_si128(_mm_srli_epi16(v, 4), twoBits));
+			__m128i cd = _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(v, 2), twoBits), _mm_and_si128(v, twoBits));
+			values = _mm_unpacklo_epi16(ab, cd);
+			data += 4;
+			break;
+		}
+		case 2:
+		{
+			__m128i v = _mm_loadl_epi64((const __m128i*)data);
+			values = _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(v, 4), fourBits), _mm_and_si128(v, fourBits));
+			data += 8;
+			break;
+		}
+		default:
+			values = _mm_loadu_si128((const __m128i*)data);
+			data += 16;
+			break;
+		}
+		_mm_storeu_si128((__m128i*)(plane + group * VertexGroupSize), values);
+	}
+	return data;
+}
+
+size_t MeshCodec::DecodeVertices(const BYTE* data, size_t size, UINT count, UINT stride, BYTE* out)
+{
+	UINT words = stride / sizeof(UINT);
+	if (words > MaxVertexWords || stride % sizeof(UINT) != 0)
+		return 0;
+
+	const BYTE* start = data;
+	const BYTE* end = data + size;
+	UINT previous[MaxVertexWords] = { 0 };
+	BYTE planes[sizeof(UINT)][VertexBlockSize];
+	UINT column[VertexBlockSize];
+	const __m128i one = _mm_set1_epi32(1);
+	for (UINT base = 0; base < count; base += VertexBlockSize)
+	{
+		UINT blockCount = min(VertexBlockSize, count - base);
+		UINT groups = (blockCount + VertexGroupSize - 1) / VertexGroupSize;
+		for (UINT word = 0; word < words; word++)
+		{
+			for (UINT plane = 0; plane < sizeof(UINT); plane++)
+			{
+				data = DecodePlane(data, end, groups, planes[plane]);
+				if (!data)
+					return 0;
+			}
+
+			// Byte planes back into words sixteen vertices at a time, then undo the zigzag and sum the differences
+			__m128i carry = _mm_set1_epi32((int)previous[word]);
+			for (UINT i = 0; i < groups * VertexGroupSize; i += VertexGroupSize)
+			{
+				__m128i p0 = _mm_loadu_si128((const __m128i*)&planes[0][i]);
+				__m128i p1 = _mm_loadu_si128((const __m128i*)&planes[1][i]);
+				__m128i p2 = _mm_loadu_si128((const __m128i*)&planes[2][i]);
+				__m128i p3 = _mm_loadu_si128((const __m128i*)&planes[3][i]);
+				__m128i low = _mm_unpacklo_epi8(p0, p1);
+				__m128i high = _mm_unpacklo_epi8(p2, p3);
+				__m128i quads[4] = { _mm_unpacklo_epi16(low, high), _mm_unpackhi_epi16(low, high), _mm_setzero_si128(), _mm_setzero_si128() };
+				low = _mm_unpackhi_epi8(p0, p1);
+				high = _mm_unpackhi_epi8(p2, p3);
+				quads[2] = _mm_unpacklo_epi16(low, high);
+				quads[3] = _mm_unpackhi_epi16(low, high);
+
+				for (UINT quad = 0; quad < 4; quad++)
+				{
+					__m128i z = quads[quad];
+					__m128i x = _mm_xor_si128(_mm_srli_epi32(z, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(z, one)));
+					x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+					x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+					x = _mm_add_epi32(x, carry);
+					carry = _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+					_mm_storeu_si128((__m128i*)&column[i + quad * 4], x);
+				}
+			}
+			previous[word] = column[blockCount - 1];
+
+			BYTE* target = out + (size_t)base * stride + word * sizeof(UINT);
+			for (UINT i = 0; i < blockCount; i++, target += stride)
+				memcpy(target, &column[i], sizeof(UINT));
+		}
+	}
+	return data - start;
+}
+
+///
+// Indices
+///
+void MeshCodec::EncodeIndices(const UINT* indices, UINT count, std::vector<BYTE>& out)
+{
+	UINT codeBytes = (count + 1) / 2;
+	size_t codes = out.size();
+	AppendUINT(out, codeBytes);
+	codes += sizeof(UINT);
+	out.resize(codes + codeBytes, 0);
+
+	// The FIFO only takes vertices that missed it, so it holds the most recent distinct ones
+	UINT fifo[16] = { 0 };
+	UINT head = 0;
+	UINT next = 0;
+	UINT last = 0;
+	for (UINT i = 0; i < count; i++)
+	{
+		UINT index = indices[i];
+		UINT code = IndexExplicit;
+		if (index == next)
+			code = IndexNew;
+		else
+		{
+			for (UINT entry = 0; entry < IndexFifoSize; entry++)
+			{
+				if (fifo[(head - 1 - entry) & 15] == index)
+				{
+					code = 1 + entry;
+					break;
+				}
+			}
+		}
+
+		if (code == IndexNew || code == IndexExplicit)
+		{
+			fifo[head++ & 15] = index;
+			next = max(next, index + 1);
+		}
+		if (code == IndexExplicit)
+		{
+			for (UINT value = ZigZag(index - last); ; value >>= 7)
+			{
+				if (value < 0x80)
+				{
+					out.push_back((BYTE)value);
+					break;
+				}
+				out.push_back((BYTE)(value | 0x80));
+			}
+		}
+		out[codes + i / 2] |= (BYTE)(code << (i % 2 * 4));
+		last = index;
+	}
+}
+
+size_t MeshCodec::DecodeIndices(const BYTE* data, size_t size, UINT count, UINT* out)
+{
+	const BYTE* start = data;
+	const BYTE* end = data + size;
+	UINT codeBytes;
+	if (!ReadUINT(data, end, codeBytes) || codeBytes != (count + 1) / 2 || codeBytes > (size_t)(end - data))
+		return 0;
+	const BYTE* codes = data;
+	data += codeBytes;
+
+	UINT fifo[16] = { 0 };
+	UINT head = 0;
+	UINT next = 0;
+	UINT last = 0;
+	for (UINT i = 0; i < count; i++)
+	{
+		UINT code = (codes[i / 2] >> (i % 2 * 4)) & 15;
+		UINT index;
+		if (code == IndexNew)
+			index = next;
+		else if (code <= IndexFifoSize)
+			index = fifo[(head - code) & 15];
+		else
+		{
+			UINT value = 0;
+			for (UINT shift = 0; ; shift += 7)
+			{
+				if (data == end || shift > 28)
+					return 0;
+				BYTE b = *data++;
+				value |= (UINT)(b & 0x7F) << shift;
+				if (b < 0x80)
+					break;
+			}
+			index = last + UnZigZag(value);
+		}
+
+		if (code == IndexNew || code == IndexExplicit)
+		{
+			fifo[head++ & 15] = index;
+			next = max(next, index + 1);
+		}
+		out[i] = index;
+		last = index;
+	}
+	return data - start;
+}
+
+///
+// Huffman stage
+///
+
+/// <summary>Code lengths for the byte frequencies, none longer than HuffmanMaxBits
+/// </summary>
+static void BuildCodeLengths(UINT64 frequencies[256], BYTE lengths[256])
+{
+	// A lone symbol still needs a one bit code
+	UINT used = 0;
+	for (UINT i = 0; i < 256; i++)
+		used += frequencies[i] > 0;
+	if (used == 1)
+	{
+		for (UINT i = 0; i < 256; i++)
+			lengths[i] = frequencies[i] > 0 ? 1 : 0;
+		return;
+	}
+
+	for (;;)
+	{
+		// Leaves first, then the nodes joining them, each pointing at its parent
+		std::vector<UINT> parents(512, 0);
+		std::priority_queue<std::pair<UINT64, UINT>, std::vector<std::pair<UINT64, UINT> >, std::greater<std::pair<UINT64, UINT> > > queue;
+		for (UINT i = 0; i < 256; i++)
+		{
+			if (frequencies[i] > 0)
+				queue.push(std::make_pair(frequencies[i], i));
+		}
+		UINT nodes = 256;
+		while (queue.size() > 1)
+		{
+			std::pair<UINT64, UINT> a = queue.top();
+			queue.pop();
+			std::pair<UINT64, UINT> b = queue.top();
+			queue.pop();
+			parents[a.second] = nodes;
+			parents[b.second] = nodes;
+			queue.push(std::make_pair(a.first + b.first, nodes++));
+		}
+
+		// Parents always come after their children, so depths fill in walking down from the root
+		std::vector<BYTE> depths(nodes, 0);
+		for (UINT node = nodes - 2; node >= 256; node--)
+			depths[node] = depths[parents[node]] + 1;
+		UINT longest = 0;
+		for (UINT i = 0; i < 256; i++)
+		{
+			lengths[i] = frequencies[i] > 0 ? depths[parents[i]] + 1 : 0;
+			longest = max(longest, (UINT)lengths[i]);
+		}
+		if (longest <= HuffmanMaxBits)
+			return;
+
+		// Flattening the frequencies shortens the longest codes, which only the rarest symbols have
+		for (UINT i = 0; i < 256; i++)
+		{
+			if (frequencies[i] > 0)
+				frequencies[i] = (frequencies[i] + 1) / 2;
+		}
+	}
+}
+
+/// <summary>Canonical codes for the lengths, bit reversed since the stream is read from the lowest bit up
+/// Returns false if the lengths don't make a valid code
+/// </summary>
+static bool BuildCodes(const BYTE lengths[256], UINT codes[256])
+{
+	UINT counts[HuffmanMaxBits + 1] = { 0 };
+	for (UINT i = 0; i < 256; i++)
+	{
+		if (lengths[i] > HuffmanMaxBits)
+			return false;
+		counts[lengths[i]]++;
+	}
+	counts[0] = 0;
+
+	UINT firsts[HuffmanMaxBits + 1] = { 0 };
+	UINT code = 0;
+	UINT space = 0;
+	for (UINT bits = 1; bits <= HuffmanMaxBits; bits++)
+	{
+		code = (code + counts[bits - 1]) << 1;
+		firsts[bits] = code;
+		space += counts[bits] << (HuffmanMaxBits - bits);
+	}
+	if (space > HuffmanTableSize)
+		return false;
+
+	for (UINT i = 0; i < 256; i++)
+	{
+		UINT bits = lengths[i];
+		UINT canonical = bits ? firsts[bits]++ : 0;
+		UINT reversed = 0;
+		for (UINT bit = 0; bit < bits; bit++)
+			reversed |= ((canonical >> bit) & 1) << (bits - 1 - bit);
+		codes[i] = reversed;
+	}
+	return true;
+}
+
+void MeshCodec::EncodeEntropy(const BYTE* data, size_t size, std::vector<BYTE>& out)
+{
+	UINT64 frequencies[256] = { 0 };
+	for (size_t i = 0; i < size; i++)
+		frequencies[data[i]]++;
+	BYTE lengths[256] = { 0 };
+	if (size > 0)
+		BuildCodeLengths(frequencies, lengths);
+	UINT codes[256];
+	BuildCodes(lengths, codes);
+
+	// Lengths as nibbles, then the stream's size and the stream
+	for (UINT i = 0; i < 256; i += 2)
+		out.push_back((BYTE)(lengths[i] | lengths[i + 1] << 4));
+	size_t streamSize = out.size();
+	AppendUINT(out, 0);
+	size_t stream = out.size();
+
+	UINT64 bits = 0;
+	UINT count = 0;
+	for (size_t i = 0; i < size; i++)
+	{
+		bits |= (UINT64)codes[data[i]] << count;
+		count += lengths[data[i]];
+		if (count >= 32)
+		{
+			AppendUINT(out, (UINT)bits);
+			bits >>= 32;
+			count -= 32;
+		}
+	}
+	for (; count > 0; count = count > 8 ? count - 8 : 0, bits >>= 8)
+		out.push_back((BYTE)bits);
+	out.resize(out.size() + HuffmanPadding, 0);
+
+	UINT written = (UINT)(out.size() - stream);
+	memcpy(&out[streamSize], &written, sizeof(UINT));
+}
+
+size_t MeshCodec::DecodeEntropy(const BYTE* data, size_t size, BYTE* out, size_t outSize)
+{
+	const BYTE* start = data;
+	const BYTE* end = data + size;
+	if (size < 128)
+		return 0;
+	BYTE lengths[256];
+	for (UINT i = 0; i < 256; i += 2)
+	{
+		lengths[i] = data[i / 2] & 15;
+		lengths[i + 1] = data[i / 2] >> 4;
+	}
+	data += 128;
+
+	UINT codes[256];
+	UINT streamSize;
+	if (!BuildCodes(lengths, codes) || !ReadUINT(data, end, streamSize) || streamSize > (size_t)(end - data))
+		return 0;
+	end = data + streamSize;
+
+	// Each entry is the symbol whose code the low bits start with and, above it, the code's length. 0 is no code at all
+	std::vector<USHORT> table(HuffmanTableSize, 0);
+	for (UINT i = 0; i < 256; i++)
+	{
+		for (UINT fill = codes[i]; lengths[i] && fill < HuffmanTableSize; fill += 1 << lengths[i])
+			table[fill] = (USHORT)(i | lengths[i] << 8);
+	}
+
+	const UINT mask = HuffmanTableSize - 1;
+	UINT64 bits = 0;
+	UINT count = 0;
+	size_t i = 0;
+	while (i < outSize)
+	{
+		if (end - data >= 8)
+		{
+			// Tops the buffer up to at least 56 bits, enough for four codes
+			UINT64 next;
+			memcpy(&next, data, sizeof(next));
+			bits |= next << count;
+			data += (63 - count) >> 3;
+			count |= 56;
+
+			size_t last = min(i + 4, outSize);
+			for (; i < last; i++)
+			{
+				UINT entry = table[(UINT)bits & mask];
+				UINT length = entry >> 8;
+				if (length == 0)
+					return 0;
+				out[i] = (BYTE)entry;
+				bits >>= length;
+				count -= length;
+			}
+		}
+		else
+		{
+			// Only reached in the padding of a valid stream
+			for (; count <= 56 && data < end; count += 8)
+				bits |= (UINT64)*data++ << count;
+			UINT entry = table[(UINT)bits & mask];
+			UINT length = entry >> 8;
+			if (length == 0 || length > count)
+				return 0;
+			out[i++] = (BYTE)entry;
+			bits >>= length;
+			count -= length;
+		}
+	}
+	return end - start;
+}
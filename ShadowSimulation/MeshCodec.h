@@ -0,0 +1,70 @@
+//
+// Lossless compression of cooked meshes, so .mesh files are small to ship to every render node and quick to load
+// Vertices are split into 32 bit words, each coded as the zigzagged difference from the same word of the vertex before
+// and packed sixteen vertices at a time at 0, 2, 4 or 8 bits per byte. Indices are coded against the next vertex not yet
+// used and a short FIFO of recent ones, which in vertex cache order catches nearly all of them in 4 bits
+// An optional Huffman stage goes over the whole result for smaller files at a slower load
+//
+
+#ifndef MESHCODEC_H
+#define MESHCODEC_H
+
+#include <vector>
+#include <Windows.h>
+
+/// <summary>Compressed .mesh files start with this instead of a CookedMeshHeader, followed by payloadSize bytes
+/// </summary>
+struct CompressedMeshHeader
+{
+	UINT magic;
+	UINT flags;			// MeshCodecFlags
+	UINT rawSize;		// Bytes of the cooked mesh once decoded
+	UINT payloadSize;
+};
+
+static const UINT CompressedMeshMagic = 0x5A48534D;	// "MSHZ"
+
+enum MeshCodecFlags
+{
+	MeshCodecEntropy = 1	// The payload went through the Huffman stage
+};
+
+class MeshCodec
+{
+public:
+	static bool IsCompressed(const BYTE* data, size_t size);
+
+	/// <summary>Compresses a cooked mesh, returns false if it doesn't parse. The Huffman stage is only kept when it helps
+	/// </summary>
+	static bool Encode(const BYTE* cooked, size_t size, bool entropy, std::vector<BYTE>& compressed);
+
+	/// <summary>Bytes a compressed mesh decodes to, 0 if it isn't one
+	/// </summary>
+	static size_t GetDecodedSize(const BYTE* data, size_t size);
+
+	/// <summary>Decodes into out, which needs GetDecodedSize bytes, so it can go straight into memory meant for upload
+	/// Returns false if the data is corrupt. The cooked mesh written still has to be checked with ParseCookedMesh
+	/// </summary>
+	static bool Decode(const BYTE* data, size_t size, BYTE* out, size_t outSize);
+
+	/// <summary>Codes count elements of stride bytes, stride a multiple of 4, appending to out
+	/// </summary>
+	static void EncodeVertices(const BYTE* vertices, UINT count, UINT stride, std::vector<BYTE>& out);
+
+	/// <summary>Decodes what EncodeVertices wrote for the same count and stride. Returns the bytes read, 0 if corrupt
+	/// </summary>
+	static size_t DecodeVertices(const BYTE* data, size_t size, UINT count, UINT stride, BYTE* out);
+
+	static void EncodeIndices(const UINT* indices, UINT count, std::vector<BYTE>& out);
+	static size_t DecodeIndices(const BYTE* data, size_t size, UINT count, UINT* out);
+
+	/// <summary>Huffman codes any bytes, appending to out
+	/// </summary>
+	static void EncodeEntropy(const BYTE* data, size_t size, std::vector<BYTE>& out);
+
+	/// <summary>Decodes what EncodeEntropy wrote into exactly outSize bytes. Returns the bytes read, 0 if corrupt
+	/// </summary>
+	static size_t DecodeEntropy(const BYTE* data, size_t size, BYTE* out, size_t outSize);
+};
+
+#endif
@@ -0,0 +1,145 @@
+//
+// Vertices, indices and everything built from them that a mesh holds on the CPU, and their cooked layout
+//
+
+#include "MeshData.h"
+
+#include <cstring>
+
+MeshBounds ComputeMeshBounds(const Vertex* vertices, UINT numVertices)
+{
+	XMFLOAT3 low(0.0f, 0.0f, 0.0f);
+	XMFLOAT3 high(0.0f, 0.0f, 0.0f);
+	for (UINT i = 0; i < numVertices; i++)
+	{
+		const XMFLOAT3& p = vertices[i].Position;
+		if (i == 0)
+		{
+			low = p;
+			high = p;
+			continue;
+		}
+		low = XMFLOAT3(min(low.x, p.x), min(low.y, p.y), min(low.z, p.z));
+		high = XMFLOAT3(max(high.x, p.x), max(high.y, p.y), max(high.z, p.z));
+	}
+
+	MeshBounds bounds;
+	bounds.center = XMFLOAT3((low.x + high.x) * 0.5f, (low.y + high.y) * 0.5f, (low.z + high.z) * 0.5f);
+	bounds.extents = XMFLOAT3((high.x - low.x) * 0.5f, (high.y - low.y) * 0.5f, (high.z - low.z) * 0.5f);
+	return bounds;
+}
+
+void GetCookedMeshSections(const CookedMeshHeader& header, UINT64 sizes[CookedMeshSections])
+{
+	sizes[CookedHeader] = sizeof(CookedMeshHeader);
+	sizes[CookedLODs] = (UINT64)header.numLODs * sizeof(MeshLOD);
+	sizes[CookedVertices] = (UINT64)header.numVertices * sizeof(Vertex);
+	sizes[CookedIndices] = (UINT64)header.numIndices * sizeof(UINT);
+	sizes[CookedMeshlets] = (UINT64)header.numMeshlets * sizeof(Meshlet);
+	sizes[CookedMeshletVertices] = (UINT64)header.numMeshletVertices * sizeof(UINT);
+	sizes[CookedMeshletBounds] = (((UINT64)header.numMeshlets + 3) & ~3ull) * MeshletBoundsStreams * sizeof(float);
+	sizes[CookedMeshletTriangles] = (UINT64)header.numMeshletTriangles * 3;
+}
+
+void SerializeMesh(const MeshData& data, std::vector<BYTE>& cooked)
+{
+	// A mesh without levels is written as its own single level
+	MeshLOD full = { 0, (UINT)data.indices.size(), 0.0f };
+	const MeshLOD* lods = data.lods.empty() ? &full : &data.lods[0];
+	const MeshletData& meshlets = data.meshlets;
+	CookedMeshHeader header = { CookedMeshMagic, (UINT)data.vertices.size(), (UINT)data.indices.size(), data.lods.empty() ? 1 : (UINT)data.lods.size(),
+		(UINT)meshlets.meshlets.size(), (UINT)meshlets.vertices.size(), (UINT)meshlets.triangles.size() / 3 };
+
+	const void* sections[] = { &header, lods, data.vertices.empty() ? NULL : &data.vertices[0], data.indices.empty() ? NULL : &data.indices[0],
+		meshlets.meshlets.empty() ? NULL : &meshlets.meshlets[0], meshlets.vertices.empty() ? NULL : &meshlets.vertices[0],
+		meshlets.bounds.empty() ? NULL : &meshlets.bounds[0], meshlets.triangles.empty() ? NULL : &meshlets.triangles[0] };
+	UINT64 sizes[CookedMeshSections];
+	GetCookedMeshSections(header, sizes);
+
+	size_t total = 0;
+	for (UINT64 size : sizes)
+		total += (size_t)size;
+	cooked.resize(total);
+	BYTE* out = &cooked[0];
+	for (UINT i = 0; i < CookedMeshSections; i++)
+	{
+		if (sizes[i] > 0)
+			memcpy(out, sections[i], (size_t)sizes[i]);
+		out += sizes[i];
+	}
+}
+
+bool ParseCookedMesh(const BYTE* data, size_t size, CookedMesh& mesh)
+{
+	if (size < sizeof(CookedMeshHeader))
+		return false;
+	memcpy(&mesh.header, data, sizeof(CookedMeshHeader));
+	const CookedMeshHeader& header = mesh.header;
+	if (header.magic != CookedMeshMagic || header.numLODs == 0)
+		return false;
+
+	UINT64 sizes[CookedMeshSections];
+	GetCookedMeshSections(header, sizes);
+	UINT64 total = 0;
+	for (UINT64 section : sizes)
+		total += section;
+	if (total != size)
+		return false;
+
+	const BYTE* cursor = data + sizes[CookedHeader];
+	mesh.lods = (const MeshLOD*)cursor;
+	cursor += sizes[CookedLODs];
+	mesh.vertices = (const Vertex*)cursor;
+	cursor += sizes[CookedVertices];
+	mesh.indices = (const UINT*)cursor;
+	cursor += sizes[CookedIndices];
+	mesh.meshlets = (const Meshlet*)cursor;
+	cursor += sizes[CookedMeshlets];
+	mesh.meshletVertices = (const UINT*)cursor;
+	cursor += sizes[CookedMeshletVertices];
+	mesh.meshletBounds = (const float*)cursor;
+	cursor += sizes[CookedMeshletBounds];
+	mesh.meshletTriangles = cursor;
+
+	// Every level has to lie inside the index buffer, and every index inside the vertex buffer
+	for (UINT i = 0; i < header.numLODs; i++)
+	{
+		if ((UINT64)mesh.lods[i].indexStart + mesh.lods[i].indexCount > header.numIndices)
+			return false;
+	}
+	for (UINT i = 0; i < header.numIndices; i++)
+	{
+		if (mesh.indices[i] >= header.numVertices)
+			return false;
+	}
+
+	// Likewise every meshlet inside the meshlet arrays, and every one of its corners inside the meshlet
+	for (UINT i = 0; i < header.numMeshlets; i++)
+	{
+		const Meshlet& meshlet = mesh.meshlets[i];
+		if (meshlet.vertexCount > MeshletMaxVertices || meshlet.triangleCount > MeshletMaxTriangles ||
+			(UINT64)meshlet.vertexOffset + meshlet.vertexCount > header.numMeshletVertices ||
+			(UINT64)meshlet.triangleOffset + meshlet.triangleCount > header.numMeshletTriangles)
+			return false;
+		for (UINT j = 0; j < meshlet.triangleCount * 3; j++)
+		{
+			if (mesh.meshletTriangles[meshlet.triangleOffset * 3 + j] >= meshlet.vertexCount)
+				return false;
+		}
+	}
+	for (UINT i = 0; i < header.numMeshletVertices; i++)
+	{
+		if (mesh.meshletVertices[i] >= header.numVertices)
+			return false;
+	}
+	return true;
+}
+
+void ReadCookedMeshlets(const CookedMesh& mesh, MeshletData& meshlets)
+{
+	const CookedMeshHeader& header = mesh.header;
+	meshlets.meshlets.assign(mesh.meshlets, mesh.meshlets + header.numMeshlets);
+	meshlets.vertices.assign(mesh.meshletVertices, mesh.meshletVertices + header.numMeshletVertices);
+	meshlets.triangles.assign(mesh.meshletTriangles, mesh.meshletTriangles + header.numMeshletTriangles * 3);
+	meshlets.bounds.assign(mesh.meshletBounds, mesh.meshletBounds + meshlets.GetBoundsStride() * MeshletBoundsStreams);
+}
@@ -0,0 +1,98 @@
+//
+// Vertices, indices and everything built from them that a mesh holds on the CPU, without the device or the importer
+// Also the cooked layout meshes are stored and streamed in
+//
+
+#ifndef MESHDATA_H
+#define MESHDATA_H
+
+#include <string>
+#include <vector>
+
+#include "MeshletBuilder.h"
+#include "Vertex.h"
+
+/// <summary>Joint a skinned mesh's influences refer to, by its node's name
+/// </summary>
+struct MeshBone
+{
+	std::string name;
+	XMFLOAT4X4 inverseBind;		// From the mesh's space into the bone's at the bind pose
+};
+
+struct MeshData
+{
+	std::vector<Vertex> vertices;
+	std::vector<UINT> indices;
+	std::vector<MeshLOD> lods;	// Empty until BuildLODs, the indices then hold every level one after another
+	MeshletData meshlets;		// Of the full level, empty until BuildLODs and for meshes too small to cull piece by piece
+	std::vector<SkinInfluences> influences;	// One per vertex for models with bones, empty otherwise
+	std::vector<MeshBone> bones;
+};
+
+/// <summary>Cooked mesh files and streamed mesh payloads start with this, followed by the LOD table, the vertices, the indices,
+/// the meshlets, their vertices, their bounds arrays and last their triangles, three bytes each
+/// </summary>
+struct CookedMeshHeader
+{
+	UINT magic;
+	UINT numVertices;
+	UINT numIndices;
+	UINT numLODs;
+	UINT numMeshlets;
+	UINT numMeshletVertices;
+	UINT numMeshletTriangles;
+};
+
+static const UINT CookedMeshMagic = 0x32444F4C;	// "LOD2", files from before meshlets are imported again
+
+/// <summary>Parts of a cooked mesh in the order they are laid out
+/// </summary>
+enum CookedMeshSection
+{
+	CookedHeader,
+	CookedLODs,
+	CookedVertices,
+	CookedIndices,
+	CookedMeshlets,
+	CookedMeshletVertices,
+	CookedMeshletBounds,
+	CookedMeshletTriangles,
+	CookedMeshSections
+};
+
+/// <summary>Points into the data of a cooked mesh
+/// </summary>
+struct CookedMesh
+{
+	CookedMeshHeader header;
+	const MeshLOD* lods;
+	const Vertex* vertices;
+	const UINT* indices;
+	const Meshlet* meshlets;
+	const UINT* meshletVertices;
+	const float* meshletBounds;
+	const BYTE* meshletTriangles;
+};
+
+/// <summary>Box around the vertices' positions, empty at the origin if there are none
+/// </summary>
+MeshBounds ComputeMeshBounds(const Vertex* vertices, UINT numVertices);
+
+/// <summary>Bytes each CookedMeshSection of a mesh with this header takes
+/// </summary>
+void GetCookedMeshSections(const CookedMeshHeader& header, UINT64 sizes[CookedMeshSections]);
+
+/// <summary>Writes the mesh and its levels of detail in the cooked layout
+/// </summary>
+void SerializeMesh(const MeshData& data, std::vector<BYTE>& cooked);
+
+/// <summary>Checks a cooked mesh's layout and points into it. Returns false if it is truncated or not a cooked mesh
+/// </summary>
+bool ParseCookedMesh(const BYTE* data, size_t size, CookedMesh& mesh);
+
+/// <summary>Copies a parsed cooked mesh's meshlets
+/// </summary>
+void ReadCookedMeshlets(const CookedMesh& mesh, MeshletData& meshlets);
+
+#endif
@@ -1,9 +1,108 @@
+//
+// Spheres and planes generated into MeshData or straight into mapped memory, nothing here touches the device
+//
+
 #include "MeshGenerator.h"
+
+#include <cstring>
+#include <functional>
+#include <thread>
 #include <vector>
 
+// Meshes with fewer vertices than this are generated on the calling thread, starting threads would cost more
+static const UINT ParallelVertexCount = 1 << 16;
+
+// Splits [0, count) into one range per core and runs them at once, the calling thread is one of the workers
+static void RunRanges(UINT count, bool parallel, const std::function<void(UINT, UINT)>& work)
+{
+	UINT threads = parallel ? min(max(std::thread::hardware_concurrency(), 1u), max(count, 1u)) : 1;
+	UINT step = (count + threads - 1) / threads;
+
+	std::vector<std::thread> workers;
+	for (UINT i = 1; i < threads; i++)
+		workers.push_back(std::thread(work, min(i * step, count), min((i + 1) * step, count)));
+	work(0, min(step, count));
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+// Marks free slots in the edge table, both halves are equal which no edge has
+static const UINT64 EmptyEdge = ~0ull;
+
+// Open addressed table from an edge's two vertex indices, in either order, to the vertex at its midpoint
+class EdgeMidpoints
+{
+public:
+	EdgeMidpoints(UINT maxEdges) :
+	shift(64)
+	{
+		// At least twice the closed mesh's edges, so probes stay short
+		UINT64 size = 1;
+		while (size <= maxEdges)
+		{
+			size <<= 1;
+			shift--;
+		}
+		keys.assign((size_t)size, EmptyEdge);
+		values.resize((size_t)size);
+		mask = size - 1;
+	}
+
+	/// <summary>Returns the edge's midpoint, when the edge is new it is given next and added is set
+	/// </summary>
+	UINT Find(UINT a, UINT b, UINT next, bool& added)
+	{
+		UINT64 key = a < b ? ((UINT64)a << 32) | b : ((UINT64)b << 32) | a;
+		UINT64 slot = (key * 0x9E3779B97F4A7C15ull) >> shift;
+		while (keys[(size_t)slot] != key)
+		{
+			if (keys[(size_t)slot] == EmptyEdge)
+			{
+				keys[(size_t)slot] = key;
+				values[(size_t)slot] = next;
+				added = true;
+				return next;
+			}
+			slot = (slot + 1) & mask;
+		}
+		added = false;
+		return values[(size_t)slot];
+	}
+private:
+	std::vector<UINT64> keys;
+	std::vector<UINT> values;
+	UINT64 mask;
+	UINT shift;
+};
+
+void MeshGenerator::GetSphereCounts(UINT numSubdivisions, UINT& vertexCount, UINT& indexCount)
+{
+	// Every subdivision quadruples the faces and adds one vertex per edge, 20 faces and 30 edges to start
+	UINT scale = 1u << (2 * min(numSubdivisions, MaxSphereSubdivisions));
+	vertexCount = 10 * scale + 2;
+	indexCount = 60 * scale;
+}
+
+void MeshGenerator::GetPlaneCounts(UINT n, UINT m, UINT& vertexCount, UINT& indexCount)
+{
+	n = max(n, 2u);
+	m = max(m, 2u);
+	vertexCount = n * m;
+	indexCount = (n - 1) * (m - 1) * 6;
+}
+
 void MeshGenerator::CreateSphere(float radius, UINT numSubdivisions, MeshData& data)
 {
-	numSubdivisions = min(numSubdivisions, 5u);
+	UINT vertexCount, indexCount;
+	GetSphereCounts(numSubdivisions, vertexCount, indexCount);
+	data.vertices.resize(vertexCount);
+	data.indices.resize(indexCount);
+	WriteSphere(radius, numSubdivisions, &data.vertices[0], &data.indices[0]);
+}
+
+void MeshGenerator::WriteSphere(float radius, UINT numSubdivisions, Vertex* vertices, UINT* indices)
+{
+	numSubdivisions = min(numSubdivisions, MaxSphereSubdivisions);
 
 	const float X = 0.525731f;
 	const float Z = 0.850651f;
@@ -26,110 +125,120 @@ void MeshGenerator::CreateSphere(float radius, UINT numSubdivisions, MeshData& d
 		10, 1, 6, 11, 0, 9, 2, 11, 9, 5, 2, 9, 11, 2, 7
 	};
 
-	data.vertices.resize(12);
-	data.indices.resize(60);
+	UINT vertexCount = 12;
+	for (UINT i = 0; i < 12; i++)
+		vertices[i].Position = pos[i];
 
-	for (byte i = 0; i < 12; i++)
+	// Each level's vertices are the ones before it plus its midpoints, so they build up in place
+	// The indices alternate between two scratch buffers and the last level goes straight to the output
+	std::vector<UINT> levels[2];
+	levels[0].assign(ind, ind + 60);
+	for (UINT i = 0; i < numSubdivisions; i++)
 	{
-		data.vertices[i].Position = pos[i];
-	}
-
-	for (byte i = 0; i < 60; i++)
-	{
-		data.indices[i] = ind[i];
-	}
-
-	for (byte i = 0; i < numSubdivisions; i++)
-	{
-		Subdivide(data);
+		const std::vector<UINT>& source = levels[i % 2];
+		UINT* subdivided = indices;
+		if (i + 1 < numSubdivisions)
+		{
+			levels[(i + 1) % 2].resize(source.size() * 4);
+			subdivided = &levels[(i + 1) % 2][0];
+		}
+		vertexCount = Subdivide(vertices, vertexCount, &source[0], (UINT)source.size(), subdivided);
 	}
+	if (numSubdivisions == 0)
+		memcpy(indices, ind, sizeof(ind));
 
-	for (int i = 0; i < data.vertices.size(); ++i)
+	RunRanges(vertexCount, vertexCount >= ParallelVertexCount, [&](UINT begin, UINT end)
 	{
-		XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&data.vertices[i].Position));
+		for (UINT i = begin; i < end; i++)
+		{
+			Vertex& vertex = vertices[i];
+			XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&vertex.Position));
 
-		XMVECTOR p = radius * n;
+			XMVECTOR p = radius * n;
 
-		XMStoreFloat3(&data.vertices[i].Position, p);
-		XMStoreFloat3(&data.vertices[i].Normal, n);
+			XMStoreFloat3(&vertex.Position, p);
+			XMStoreFloat3(&vertex.Normal, n);
+			vertex.Color = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 
-		float theta = atan2(data.vertices[i].Position.x, data.vertices[i].Position.z);
+			float theta = atan2(vertex.Position.x, vertex.Position.z);
 
-		float phi = acosf(data.vertices[i].Position.y / radius);
+			float phi = acosf(vertex.Position.y / radius);
 
-		data.vertices[i].UV.x = theta / XM_2PI;
-		data.vertices[i].UV.y = phi / XM_PI;
+			vertex.UV.x = theta / XM_2PI;
+			vertex.UV.y = phi / XM_PI;
 
-		data.vertices[i].Tangent.x = -radius*sinf(phi)*sinf(theta);
-		data.vertices[i].Tangent.y = 0.0f;
-		data.vertices[i].Tangent.z = +radius*sinf(phi)*cosf(theta);
+			vertex.Tangent.x = -radius*sinf(phi)*sinf(theta);
+			vertex.Tangent.y = 0.0f;
+			vertex.Tangent.z = +radius*sinf(phi)*cosf(theta);
 
-		XMVECTOR T = XMLoadFloat3(&data.vertices[i].Tangent);
-		XMStoreFloat3(&data.vertices[i].Tangent, XMVector3Normalize(T));
-	}
+			XMVECTOR T = XMLoadFloat3(&vertex.Tangent);
+			XMStoreFloat3(&vertex.Tangent, XMVector3Normalize(T));
+		}
+	});
 }
 
-void MeshGenerator::Subdivide(MeshData& mesh)
+UINT MeshGenerator::Subdivide(Vertex* vertices, UINT vertexCount, const UINT* indices, UINT indexCount, UINT* subdivided)
 {
-	MeshData copy = mesh;
-
-	mesh.vertices.resize(0);
-	mesh.indices.resize(0);
+	// A closed mesh has half as many edges as triangle sides, an open one at most as many
+	EdgeMidpoints midpoints(indexCount);
+	auto midpoint = [&](UINT a, UINT b)
+	{
+		bool added;
+		UINT m = midpoints.Find(a, b, vertexCount, added);
+		if (added)
+		{
+			const XMFLOAT3& p0 = vertices[a].Position;
+			const XMFLOAT3& p1 = vertices[b].Position;
+			vertices[vertexCount++].Position = XMFLOAT3(0.5f*(p0.x + p1.x), 0.5f*(p0.y + p1.y), 0.5f*(p0.z + p1.z));
+		}
+		return m;
+	};
 
-	UINT numTris = copy.indices.size() / 3;
+	UINT numTris = indexCount / 3;
 	for (UINT i = 0; i < numTris; ++i)
 	{
-		Vertex v0 = copy.vertices[copy.indices[i * 3 + 0]];
-		Vertex v1 = copy.vertices[copy.indices[i * 3 + 1]];
-		Vertex v2 = copy.vertices[copy.indices[i * 3 + 2]];
-
-		Vertex m0, m1, m2;
-
-		m0.Position = XMFLOAT3(
-			0.5f*(v0.Position.x + v1.Position.x),
-			0.5f*(v0.Position.y + v1.Position.y),
-			0.5f*(v0.Position.z + v1.Position.z));
-
-		m1.Position = XMFLOAT3(
-			0.5f*(v1.Position.x + v2.Position.x),
-			0.5f*(v1.Position.y + v2.Position.y),
-			0.5f*(v1.Position.z + v2.Position.z));
-
-		m2.Position = XMFLOAT3(
-			0.5f*(v0.Position.x + v2.Position.x),
-			0.5f*(v0.Position.y + v2.Position.y),
-			0.5f*(v0.Position.z + v2.Position.z));
-
-		mesh.vertices.push_back(v0); // 0
-		mesh.vertices.push_back(v1); // 1
-		mesh.vertices.push_back(v2); // 2
-		mesh.vertices.push_back(m0); // 3
-		mesh.vertices.push_back(m1); // 4
-		mesh.vertices.push_back(m2); // 5
-
-		mesh.indices.push_back(i * 6 + 0);
-		mesh.indices.push_back(i * 6 + 3);
-		mesh.indices.push_back(i * 6 + 5);
-
-		mesh.indices.push_back(i * 6 + 3);
-		mesh.indices.push_back(i * 6 + 4);
-		mesh.indices.push_back(i * 6 + 5);
-
-		mesh.indices.push_back(i * 6 + 5);
-		mesh.indices.push_back(i * 6 + 4);
-		mesh.indices.push_back(i * 6 + 2);
-
-		mesh.indices.push_back(i * 6 + 3);
-		mesh.indices.push_back(i * 6 + 1);
-		mesh.indices.push_back(i * 6 + 4);
+		UINT v0 = indices[i * 3 + 0];
+		UINT v1 = indices[i * 3 + 1];
+		UINT v2 = indices[i * 3 + 2];
+
+		UINT m0 = midpoint(v0, v1);
+		UINT m1 = midpoint(v1, v2);
+		UINT m2 = midpoint(v0, v2);
+
+		UINT* out = subdivided + i * 12;
+		out[0] = v0;
+		out[1] = m0;
+		out[2] = m2;
+
+		out[3] = m0;
+		out[4] = m1;
+		out[5] = m2;
+
+		out[6] = m2;
+		out[7] = m1;
+		out[8] = v2;
+
+		out[9] = m0;
+		out[10] = v1;
+		out[11] = m1;
 	}
+	return vertexCount;
 }
 
 
 void MeshGenerator::CreatePlane(float width, float depth, UINT n, UINT m, MeshData& data)
 {
-	UINT vertexCount = n * m;
-	UINT faceCount = (n - 1)*(m - 1) * 2;
+	UINT vertexCount, indexCount;
+	GetPlaneCounts(n, m, vertexCount, indexCount);
+	data.vertices.resize(vertexCount);
+	data.indices.resize(indexCount);
+	WritePlane(width, depth, n, m, &data.vertices[0], &data.indices[0]);
+}
+
+void MeshGenerator::WritePlane(float width, float depth, UINT n, UINT m, Vertex* vertices, UINT* indices)
+{
+	n = max(n, 2u);
+	m = max(m, 2u);
 
 	float halfWidth = width * 0.5f;
 	float halfDepth = depth * 0.5f;
@@ -140,38 +249,38 @@ void MeshGenerator::CreatePlane(float width, float depth, UINT n, UINT m, MeshDa
 	float du = 1.0f / (n - 1);
 	float dv = 1.0f / (m - 1);
 
-	data.indices.resize(0);
-	data.vertices.resize(0);
-
-	for (int i = 0; i < m; ++i)
+	// Rows are independent, each range writes its rows' vertices and the quads below them
+	RunRanges(m, n * m >= ParallelVertexCount, [&](UINT begin, UINT end)
 	{
-		float z = halfDepth - i * dz;
-		for (int j = 0; j < n; ++j)
+		for (UINT i = begin; i < end; ++i)
 		{
-			float x = halfWidth - j * dx;
-			Vertex cVert;
-			cVert.Position = XMFLOAT3(x, 0.0, z);
-			cVert.Normal = XMFLOAT3(0.0, 1.0, 0.0);
-			cVert.Tangent = XMFLOAT3(1.0f, 0.0f, 0.0f);
-			cVert.UV.x = j * du;
-			cVert.UV.y = i * dv;
-			cVert.Color = XMFLOAT4(0.7, 0.7, 0.7, 1.0);
-			data.vertices.push_back(cVert);
+			float z = halfDepth - i * dz;
+			Vertex* row = vertices + i * n;
+			for (UINT j = 0; j < n; ++j)
+			{
+				float x = halfWidth - j * dx;
+				Vertex& cVert = row[j];
+				cVert.Position = XMFLOAT3(x, 0.0, z);
+				cVert.Normal = XMFLOAT3(0.0, 1.0, 0.0);
+				cVert.Tangent = XMFLOAT3(1.0f, 0.0f, 0.0f);
+				cVert.UV.x = j * du;
+				cVert.UV.y = i * dv;
+				cVert.Color = XMFLOAT4(0.7f, 0.7f, 0.7f, 1.0f);
+			}
+
+			if (i + 1 == m)
+				continue;
+			UINT* quads = indices + i * (n - 1) * 6;
+			for (UINT j = 0; j < n - 1; ++j)
+			{
+				quads[0] = (i + 1) * n + j + 1;
+				quads[1] = i * n + j + 1;
+				quads[2] = (i + 1) * n + j;
+				quads[3] = (i + 1) * n + j;
+				quads[4] = i * n + j + 1;
+				quads[5] = i*n + j;
+				quads += 6;
+			}
 		}
-	}
-
-	UINT k = 0;
-	for (int i = 0; i < m - 1; ++i)
-	{
-		for (int j = 0; j < n - 1; ++j)
-		{
-			data.indices.push_back((i + 1) * n + j + 1);
-			data.indices.push_back(i * n + j + 1);
-			data.indices.push_back((i + 1) * n + j);
-			data.indices.push_back((i + 1) * n + j);
-			data.indices.push_back(i * n + j + 1);
-			data.indices.push_back(i*n + j);
-			k += 6;
-		}
-	}
-}
\ No newline at end of file
+	});
+}
@@ -1,20 +1,44 @@
 //
 // Class with static methods to generate primitive meshes
+// Vertices are shared between the triangles that meet at them, and large meshes are generated across every core
 // Credit to Frank D Luna
 //
 
 #ifndef MESHGENERATOR_H
 #define MESHGENERATOR_H
 
-#include "Mesh.h"
+#include "MeshData.h"
 
 class MeshGenerator
 {
 public:
+	/// <summary>Most subdivisions a sphere is generated with, 20 * 4^10 triangles
+	/// </summary>
+	static const UINT MaxSphereSubdivisions = 10;
+
 	static void CreateSphere(float radius, UINT numSubdivisions, MeshData& data);
 	static void CreatePlane(float width, float depth, UINT n, UINT m, MeshData& data);
+
+	/// <summary>Returns how many vertices and indices a sphere has, 10 * 4^s + 2 and 60 * 4^s for s subdivisions
+	/// </summary>
+	static void GetSphereCounts(UINT numSubdivisions, UINT& vertexCount, UINT& indexCount);
+
+	/// <summary>Returns how many vertices and indices an n by m plane has, n * m and 6 * (n - 1) * (m - 1)
+	/// </summary>
+	static void GetPlaneCounts(UINT n, UINT m, UINT& vertexCount, UINT& indexCount);
+
+	/// <summary>Generates a sphere straight into memory sized by GetSphereCounts, such as a mapped buffer
+	/// </summary>
+	static void WriteSphere(float radius, UINT numSubdivisions, Vertex* vertices, UINT* indices);
+
+	/// <summary>Generates a plane straight into memory sized by GetPlaneCounts, such as a mapped buffer
+	/// </summary>
+	static void WritePlane(float width, float depth, UINT n, UINT m, Vertex* vertices, UINT* indices);
 private:
-	static void Subdivide(MeshData& mesh);
+	/// <summary>Splits every triangle in four, each edge's midpoint is added once and shared by the triangles on both sides
+	/// Midpoints are appended to vertices after the vertexCount already there, returns the new vertex count
+	/// </summary>
+	static UINT Subdivide(Vertex* vertices, UINT vertexCount, const UINT* indices, UINT indexCount, UINT* subdivided);
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,790 @@
+//
+// Simplifies meshes by collapsing edges in order of quadric error, used to build level of detail chains
+// Every collapse moves a vertex onto a neighbour, so each level indexes the original vertices and can share their buffer
+//
+
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+
+static const UINT AttributeCount = 8;		// UV, normal and tangent components
+static const UINT NoEdge = 0xFFFFFFFF;
+static const UINT ManyEdges = 0xFFFFFFFE;
+static const UINT MaxPasses = 100;
+
+// Open edges of the mesh are held in place by a plane through them this much stronger than the surface's
+static const double BorderWeight = 10.0;
+
+// Each pass collapses edges up to this multiple of the error it would need to reach the target, so errors grow evenly
+static const float PassErrorScale = 1.5f;
+
+// Collapses that turn a triangle further than this (the cosine of the angle) are refused, small turns add up over many passes
+static const double FlipLimit = 0.25;
+
+enum VertexKind
+{
+	KindManifold,		// Surrounded by triangles
+	KindBorder,			// On an open edge of the mesh
+	KindSeam,			// One of two vertices that share a position and split an attribute along a seam
+	KindLocked			// Corners and anything more tangled, these never move
+};
+
+// Which kinds may collapse onto which, borders and seams also have to slide along their own edge
+static const bool CanCollapse[4][4] =
+{
+	{ true, true, true, true },
+	{ false, true, false, true },
+	{ false, false, true, true },
+	{ false, false, false, false }
+};
+
+/// <summary>Sum of weighted squared distances to planes, p'Ap + 2b'p + c
+/// </summary>
+struct Quadric
+{
+	double a00, a11, a22, a01, a02, a12;
+	double b0, b1, b2;
+	double c;
+	double w;		// Total weight, errors are divided by it
+};
+
+/// <summary>How far a vertex's attributes would be from their interpolated values. The quadric holds the squared gradients
+/// and gradients the weighted sum of each component's gradient and offset, enough to evaluate the error exactly
+/// </summary>
+struct AttributeQuadric
+{
+	Quadric quadric;
+	double gradients[AttributeCount][4];
+};
+
+struct Collapse
+{
+	UINT vertex;
+	UINT target;
+	float error;
+
+	bool operator<(const Collapse& other) const { return error < other.error; }
+};
+
+static void AddPlane(Quadric& q, double x, double y, double z, double d, double w)
+{
+	q.a00 += w * x * x;
+	q.a11 += w * y * y;
+	q.a22 += w * z * z;
+	q.a01 += w * x * y;
+	q.a02 += w * x * z;
+	q.a12 += w * y * z;
+	q.b0 += w * x * d;
+	q.b1 += w * y * d;
+	q.b2 += w * z * d;
+	q.c += w * d * d;
+}
+
+static void AddQuadric(Quadric& q, const Quadric& other)
+{
+	q.a00 += other.a00;
+	q.a11 += other.a11;
+	q.a22 += other.a22;
+	q.a01 += other.a01;
+	q.a02 += other.a02;
+	q.a12 += other.a12;
+	q.b0 += other.b0;
+	q.b1 += other.b1;
+	q.b2 += other.b2;
+	q.c += other.c;
+	q.w += other.w;
+}
+
+static void AddQuadric(AttributeQuadric& q, const AttributeQuadric& other)
+{
+	AddQuadric(q.quadric, other.quadric);
+	for (UINT k = 0; k < AttributeCount; k++)
+	{
+		for (UINT i = 0; i < 4; i++)
+			q.gradients[k][i] += other.gradients[k][i];
+	}
+}
+
+static double Evaluate(const Quadric& q, const double* p)
+{
+	double x = p[0], y = p[1], z = p[2];
+	return x * x * q.a00 + y * y * q.a11 + z * z * q.a22 + 2.0 * (x * y * q.a01 + x * z * q.a02 + y * z * q.a12)
+		+ 2.0 * (x * q.b0 + y * q.b1 + z * q.b2) + q.c;
+}
+
+/// <summary>Sum over the vertex's triangles of w * (g.p + d - a)^2 for every attribute component a
+/// </summary>
+static double Evaluate(const AttributeQuadric& q, const double* p, const double* attributes)
+{
+	double error = Evaluate(q.quadric, p);
+	for (UINT k = 0; k < AttributeCount; k++)
+	{
+		const double* g = q.gradients[k];
+		error += attributes[k] * (attributes[k] * q.quadric.w - 2.0 * (g[0] * p[0] + g[1] * p[1] + g[2] * p[2] + g[3]));
+	}
+	return error;
+}
+
+/// <summary>Orders float components by value, so -0 and 0 compare equal where memcmp would split them
+/// </summary>
+static int CompareFloats(const float* a, const float* b, UINT count)
+{
+	for (UINT i = 0; i < count; i++)
+	{
+		if (a[i] != b[i])
+			return a[i] < b[i] ? -1 : 1;
+	}
+	return 0;
+}
+
+/// <summary>Orders vertices by the data the simplifier weighs, vertex colors are ignored
+/// </summary>
+static int CompareVertices(const Vertex& a, const Vertex& b)
+{
+	int compare = CompareFloats(&a.Position.x, &b.Position.x, 3);
+	if (compare == 0)
+		compare = CompareFloats(&a.UV.x, &b.UV.x, 2);
+	if (compare == 0)
+		compare = CompareFloats(&a.Normal.x, &b.Normal.x, 3);
+	if (compare == 0)
+		compare = CompareFloats(&a.Tangent.x, &b.Tangent.x, 3);
+	return compare;
+}
+
+static UINT64 EdgeKey(UINT a, UINT b)
+{
+	return (UINT64)a << 32 | b;
+}
+
+static bool HasEdge(const std::vector<UINT64>& edges, UINT a, UINT b)
+{
+	return std::binary_search(edges.begin(), edges.end(), EdgeKey(a, b));
+}
+
+/// <summary>Everything one simplification works on. Positions are scaled to fit the unit sphere so the error limits don't
+/// depend on the mesh's size, indices always refer to the welded vertex of each set of identical ones
+/// </summary>
+class SimplifyContext
+{
+public:
+	SimplifyContext(const Vertex* vertices, UINT vertexCount, const SimplifyOptions& options) :
+	vertexCount(vertexCount),
+	radius(1.0),
+	reached(0.0f),
+	positions(vertexCount * 3),
+	attributes(vertexCount * AttributeCount),
+	weld(vertexCount),
+	remap(vertexCount),
+	wedge(vertexCount),
+	kinds(vertexCount, KindLocked),
+	openIn(vertexCount, NoEdge),
+	openOut(vertexCount, NoEdge),
+	vertexQuadrics(vertexCount),
+	attributeQuadrics(vertexCount),
+	surfaceNormals(vertexCount * 3, 0.0),
+	bestTargets(vertexCount),
+	bestErrors(vertexCount),
+	collapseRemap(vertexCount),
+	touched(vertexCount)
+	{
+		Normalize(vertices, options);
+		Weld(vertices);
+		GroupPositions();
+	}
+
+	/// <summary>Welds the indices and works out how every vertex may move and what moving it costs
+	/// </summary>
+	void Analyze(const UINT* sourceIndices, UINT indexCount)
+	{
+		indices.resize(indexCount);
+		for (UINT i = 0; i < indexCount; i++)
+			indices[i] = weld[sourceIndices[i]];
+
+		Classify();
+		FillQuadrics();
+	}
+
+	/// <summary>Collapses edges a pass at a time until the target or the error limit stops it, returning the error reached so far
+	/// Can be run again with a smaller target to carry on from where the last run stopped
+	/// </summary>
+	float Run(UINT targetTriangles, float maxError)
+	{
+		for (UINT pass = 0; pass < MaxPasses && indices.size() / 3 > targetTriangles; pass++)
+		{
+			BuildAdjacency();
+			FindCollapses();
+			if (collapses.empty())
+				break;
+			std::sort(collapses.begin(), collapses.end());
+
+			// Aim just past the error the collapses this pass needs, so cheap areas aren't left for later passes
+			UINT triangles = (UINT)indices.size() / 3;
+			size_t goal = min(collapses.size() - 1, (size_t)(triangles - targetTriangles) / 2);
+			float passLimit = min(max(collapses[goal].error * PassErrorScale, collapses[0].error), maxError);
+
+			UINT performed = PerformCollapses(targetTriangles, passLimit);
+			if (performed == 0 && passLimit < maxError)
+				performed = PerformCollapses(targetTriangles, maxError);
+			if (performed == 0)
+				break;
+
+			ApplyCollapses();
+		}
+		return (float)(reached * radius);
+	}
+
+	std::vector<UINT> indices;
+private:
+	void Normalize(const Vertex* vertices, const SimplifyOptions& options)
+	{
+		MeshBounds bounds;
+		XMFLOAT3 low = vertexCount > 0 ? vertices[0].Position : XMFLOAT3(0.0f, 0.0f, 0.0f);
+		XMFLOAT3 high = low;
+		for (UINT i = 1; i < vertexCount; i++)
+		{
+			const XMFLOAT3& p = vertices[i].Position;
+			low = XMFLOAT3(min(low.x, p.x), min(low.y, p.y), min(low.z, p.z));
+			high = XMFLOAT3(max(high.x, p.x), max(high.y, p.y), max(high.z, p.z));
+		}
+		bounds.center = XMFLOAT3((low.x + high.x) * 0.5f, (low.y + high.y) * 0.5f, (low.z + high.z) * 0.5f);
+		bounds.extents = XMFLOAT3((high.x - low.x) * 0.5f, (high.y - low.y) * 0.5f, (high.z - low.z) * 0.5f);
+
+		double extent = sqrt((double)bounds.extents.x * bounds.extents.x + (double)bounds.extents.y * bounds.extents.y
+			+ (double)bounds.extents.z * bounds.extents.z);
+		radius = extent > 0.0 ? extent : 1.0;
+
+		for (UINT i = 0; i < vertexCount; i++)
+		{
+			const Vertex& v = vertices[i];
+			double* p = &positions[i * 3];
+			p[0] = (v.Position.x - bounds.center.x) / radius;
+			p[1] = (v.Position.y - bounds.center.y) / radius;
+			p[2] = (v.Position.z - bounds.center.z) / radius;
+
+			double* a = &attributes[i * AttributeCount];
+			a[0] = v.UV.x * options.uvWeight;
+			a[1] = v.UV.y * options.uvWeight;
+			a[2] = v.Normal.x * options.normalWeight;
+			a[3] = v.Normal.y * options.normalWeight;
+			a[4] = v.Normal.z * options.normalWeight;
+			a[5] = v.Tangent.x * options.tangentWeight;
+			a[6] = v.Tangent.y * options.tangentWeight;
+			a[7] = v.Tangent.z * options.tangentWeight;
+		}
+	}
+
+	/// <summary>Points every vertex at the lowest numbered one with the same data. Generated and imported meshes often
+	/// repeat vertices per triangle, which would otherwise look like seams everywhere
+	/// </summary>
+	void Weld(const Vertex* vertices)
+	{
+		std::vector<UINT> order(vertexCount);
+		for (UINT i = 0; i < vertexCount; i++)
+			order[i] = i;
+		std::sort(order.begin(), order.end(), [vertices](UINT a, UINT b)
+		{
+			int compare = CompareVertices(vertices[a], vertices[b]);
+			return compare != 0 ? compare < 0 : a < b;
+		});
+
+		for (UINT i = 0; i < vertexCount; i++)
+		{
+			bool same = i > 0 && CompareVertices(vertices[order[i]], vertices[order[i - 1]]) == 0;
+			weld[order[i]] = same ? weld[order[i - 1]] : order[i];
+		}
+	}
+
+	/// <summary>Links welded vertices that share a position into rings, remap names each ring by its first vertex
+	/// </summary>
+	void GroupPositions()
+	{
+		std::vector<UINT> order;
+		for (UINT i = 0; i < vertexCount; i++)
+		{
+			remap[i] = i;
+			wedge[i] = i;
+			if (weld[i] == i)
+				order.push_back(i);
+		}
+
+		const double* p = positions.empty() ? NULL : &positions[0];
+		std::sort(order.begin(), order.end(), [p](UINT a, UINT b)
+		{
+			for (UINT k = 0; k < 3; k++)
+			{
+				if (p[a * 3 + k] != p[b * 3 + k])
+					return p[a * 3 + k] < p[b * 3 + k];
+			}
+			return a < b;
+		});
+
+		for (size_t start = 0; start < order.size();)
+		{
+			size_t end = start + 1;
+			const double* first = &p[order[start] * 3];
+			while (end < order.size() && p[order[end] * 3] == first[0] && p[order[end] * 3 + 1] == first[1] &&
+				p[order[end] * 3 + 2] == first[2])
+				end++;
+			for (size_t i = start; i < end; i++)
+			{
+				remap[order[i]] = order[start];
+				wedge[order[i]] = order[i + 1 < end ? i + 1 : start];
+			}
+			start = end;
+		}
+	}
+
+	void Classify()
+	{
+		std::vector<UINT64> edges;
+		edges.reserve(indices.size());
+		positionEdges.clear();
+		positionEdges.reserve(indices.size());
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			for (UINT k = 0; k < 3; k++)
+			{
+				UINT a = indices[i + k];
+				UINT b = indices[i + (k + 1) % 3];
+				edges.push_back(EdgeKey(a, b));
+				positionEdges.push_back(EdgeKey(remap[a], remap[b]));
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+		std::sort(positionEdges.begin(), positionEdges.end());
+
+		// An edge is open if no triangle runs along it the other way
+		for (size_t i = 0; i < edges.size(); i++)
+		{
+			UINT a = (UINT)(edges[i] >> 32);
+			UINT b = (UINT)edges[i];
+			if (HasEdge(edges, b, a))
+				continue;
+			openOut[a] = openOut[a] == NoEdge ? b : ManyEdges;
+			openIn[b] = openIn[b] == NoEdge ? a : ManyEdges;
+		}
+
+		for (UINT v = 0; v < vertexCount; v++)
+		{
+			if (weld[v] != v)
+				continue;
+
+			if (wedge[v] == v)
+			{
+				if (openIn[v] == NoEdge && openOut[v] == NoEdge)
+					kinds[v] = KindManifold;
+				else if (openIn[v] < ManyEdges && openOut[v] < ManyEdges)
+					kinds[v] = KindBorder;
+				continue;
+			}
+
+			// A seam is two vertices whose open edges run opposite ways between the same positions, closed in position space
+			UINT w = wedge[v];
+			if (wedge[w] != v || openIn[v] >= ManyEdges || openOut[v] >= ManyEdges || openIn[w] >= ManyEdges || openOut[w] >= ManyEdges)
+				continue;
+			UINT next = remap[openOut[v]];
+			UINT previous = remap[openIn[v]];
+			if (next == remap[openIn[w]] && previous == remap[openOut[w]] &&
+				HasEdge(positionEdges, remap[v], next) && HasEdge(positionEdges, next, remap[v]) &&
+				HasEdge(positionEdges, previous, remap[v]) && HasEdge(positionEdges, remap[v], previous))
+				kinds[v] = KindSeam;
+		}
+	}
+
+	void FillQuadrics()
+	{
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			UINT corners[3] = { indices[i], indices[i + 1], indices[i + 2] };
+			const double* p0 = &positions[corners[0] * 3];
+			const double* p1 = &positions[corners[1] * 3];
+			const double* p2 = &positions[corners[2] * 3];
+
+			double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			double length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			if (length <= 0.0)
+				continue;
+			n[0] /= length;
+			n[1] /= length;
+			n[2] /= length;
+			double area = length * 0.5;
+			double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+
+			for (UINT k = 0; k < 3; k++)
+			{
+				Quadric& q = vertexQuadrics[remap[corners[k]]];
+				AddPlane(q, n[0], n[1], n[2], d, area);
+				q.w += area;
+
+				double* surface = &surfaceNormals[remap[corners[k]] * 3];
+				surface[0] += n[0] * area;
+				surface[1] += n[1] * area;
+				surface[2] += n[2] * area;
+			}
+
+			// The gradient in the triangle's plane that reproduces each attribute at the corners
+			double d11 = e1[0] * e1[0] + e1[1] * e1[1] + e1[2] * e1[2];
+			double d12 = e1[0] * e2[0] + e1[1] * e2[1] + e1[2] * e2[2];
+			double d22 = e2[0] * e2[0] + e2[1] * e2[1] + e2[2] * e2[2];
+			double determinant = d11 * d22 - d12 * d12;
+			for (UINT k = 0; k < AttributeCount; k++)
+			{
+				double a0 = attributes[corners[0] * AttributeCount + k];
+				double da1 = attributes[corners[1] * AttributeCount + k] - a0;
+				double da2 = attributes[corners[2] * AttributeCount + k] - a0;
+				double s = (d22 * da1 - d12 * da2) / determinant;
+				double t = (d11 * da2 - d12 * da1) / determinant;
+				double g[3] = { s * e1[0] + t * e2[0], s * e1[1] + t * e2[1], s * e1[2] + t * e2[2] };
+				double offset = a0 - (g[0] * p0[0] + g[1] * p0[1] + g[2] * p0[2]);
+
+				for (UINT c = 0; c < 3; c++)
+				{
+					AttributeQuadric& q = attributeQuadrics[corners[c]];
+					AddPlane(q.quadric, g[0], g[1], g[2], offset, area);
+					q.gradients[k][0] += area * g[0];
+					q.gradients[k][1] += area * g[1];
+					q.gradients[k][2] += area * g[2];
+					q.gradients[k][3] += area * offset;
+				}
+			}
+			for (UINT c = 0; c < 3; c++)
+				attributeQuadrics[corners[c]].quadric.w += area;
+
+			// Open edges in position space get a plane standing on them, so the outline stays put
+			for (UINT k = 0; k < 3; k++)
+			{
+				UINT a = corners[k];
+				UINT b = corners[(k + 1) % 3];
+				if (HasEdge(positionEdges, remap[b], remap[a]))
+					continue;
+
+				const double* pa = &positions[a * 3];
+				const double* pb = &positions[b * 3];
+				double edge[3] = { pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2] };
+				double m[3] = { edge[1] * n[2] - edge[2] * n[1], edge[2] * n[0] - edge[0] * n[2], edge[0] * n[1] - edge[1] * n[0] };
+				double mLength = sqrt(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]);
+				if (mLength <= 0.0)
+					continue;
+				m[0] /= mLength;
+				m[1] /= mLength;
+				m[2] /= mLength;
+				double md = -(m[0] * pa[0] + m[1] * pa[1] + m[2] * pa[2]);
+				double weight = (edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2]) * BorderWeight;
+				AddPlane(vertexQuadrics[remap[a]], m[0], m[1], m[2], md, weight);
+				AddPlane(vertexQuadrics[remap[b]], m[0], m[1], m[2], md, weight);
+				vertexQuadrics[remap[a]].w += weight;
+				vertexQuadrics[remap[b]].w += weight;
+			}
+		}
+	}
+
+	void BuildAdjacency()
+	{
+		adjacencyOffsets.assign(vertexCount + 1, 0);
+		for (size_t i = 0; i < indices.size(); i++)
+			adjacencyOffsets[indices[i] + 1]++;
+		for (UINT v = 0; v < vertexCount; v++)
+			adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+
+		adjacency.resize(indices.size());
+		std::vector<UINT> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++)
+			adjacency[cursor[indices[i]]++] = (UINT)(i / 3);
+	}
+
+	/// <summary>The vertex at the target's position that the seam vertex's partner collapses onto, NoEdge if there isn't one
+	/// </summary>
+	UINT GetSeamTarget(UINT vertex, UINT target) const
+	{
+		UINT partner = wedge[vertex];
+		UINT partnerTarget = NoEdge;
+		if (target == openOut[vertex])
+			partnerTarget = openIn[partner];
+		else if (target == openIn[vertex])
+			partnerTarget = openOut[partner];
+		if (partnerTarget >= ManyEdges || remap[partnerTarget] != remap[target])
+			return NoEdge;
+		return partnerTarget;
+	}
+
+	/// <summary>Keeps the collapse if it is the cheapest found for the vertex so far
+	/// </summary>
+	void ConsiderCollapse(UINT vertex, UINT target)
+	{
+		VertexKind kind = (VertexKind)kinds[vertex];
+		if (!CanCollapse[kind][kinds[target]] || remap[vertex] == remap[target])
+			return;
+		if ((kind == KindBorder || kind == KindSeam) && target != openOut[vertex] && target != openIn[vertex])
+			return;
+
+		const Quadric& q = vertexQuadrics[remap[vertex]];
+		const double* p = &positions[target * 3];
+		double error = Evaluate(q, p) + Evaluate(attributeQuadrics[vertex], p, &attributes[target * AttributeCount]);
+		if (kind == KindSeam)
+		{
+			UINT partnerTarget = GetSeamTarget(vertex, target);
+			if (partnerTarget == NoEdge)
+				return;
+			error += Evaluate(attributeQuadrics[wedge[vertex]], p, &attributes[partnerTarget * AttributeCount]);
+		}
+
+		float normalized = (float)sqrt(max(error, 0.0) / max(q.w, 1e-30));
+		if (bestTargets[vertex] != NoEdge && normalized >= bestErrors[vertex])
+			return;
+
+		// Only one target per vertex is tried each pass, so one that would fold the mesh mustn't hide a cheap one that won't
+		// Flat areas are all zero error, and the first neighbour found is as likely as not on the wrong side
+		if (HasFlips(vertex, target) || (kind == KindSeam && HasFlips(wedge[vertex], GetSeamTarget(vertex, target))))
+			return;
+		bestTargets[vertex] = target;
+		bestErrors[vertex] = normalized;
+	}
+
+	/// <summary>Finds the cheapest collapse of every vertex that can move
+	/// </summary>
+	void FindCollapses()
+	{
+		std::fill(bestTargets.begin(), bestTargets.end(), NoEdge);
+		for (UINT v = 0; v < vertexCount; v++)
+			collapseRemap[v] = v;
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			for (UINT k = 0; k < 3; k++)
+			{
+				UINT a = indices[i + k];
+				UINT b = indices[i + (k + 1) % 3];
+				ConsiderCollapse(a, b);
+				ConsiderCollapse(b, a);
+			}
+		}
+
+		collapses.clear();
+		for (UINT v = 0; v < vertexCount; v++)
+		{
+			if (bestTargets[v] == NoEdge)
+				continue;
+			Collapse collapse = { v, bestTargets[v], bestErrors[v] };
+			collapses.push_back(collapse);
+		}
+	}
+
+	/// <summary>Whether moving the vertex onto the target would turn any of its remaining triangles over, or leave one
+	/// facing away from the full mesh's surface at its corners. Each collapse only turns triangles so far, but over many
+	/// passes the turns add up, and on coarse levels they would otherwise fold triangles inside out
+	/// </summary>
+	bool HasFlips(UINT vertex, UINT target) const
+	{
+		for (UINT i = adjacencyOffsets[vertex]; i < adjacencyOffsets[vertex + 1]; i++)
+		{
+			UINT triangle = adjacency[i];
+			UINT corners[3];
+			for (UINT k = 0; k < 3; k++)
+				corners[k] = collapseRemap[indices[triangle * 3 + k]];
+			if (corners[0] == target || corners[1] == target || corners[2] == target)
+				continue;
+			if (corners[0] != vertex && corners[1] != vertex && corners[2] != vertex)
+				continue;
+
+			// Rotate the vertex into the first corner
+			while (corners[0] != vertex)
+			{
+				UINT first = corners[0];
+				corners[0] = corners[1];
+				corners[1] = corners[2];
+				corners[2] = first;
+			}
+
+			const double* p0 = &positions[vertex * 3];
+			const double* t = &positions[target * 3];
+			const double* p1 = &positions[corners[1] * 3];
+			const double* p2 = &positions[corners[2] * 3];
+			double e1[3] = { p1[0] - p2[0], p1[1] - p2[1], p1[2] - p2[2] };
+			double before[3] = { p0[0] - p2[0], p0[1] - p2[1], p0[2] - p2[2] };
+			double after[3] = { t[0] - p2[0], t[1] - p2[1], t[2] - p2[2] };
+			double n0[3] = { e1[1] * before[2] - e1[2] * before[1], e1[2] * before[0] - e1[0] * before[2], e1[0] * before[1] - e1[1] * before[0] };
+			double n1[3] = { e1[1] * after[2] - e1[2] * after[1], e1[2] * after[0] - e1[0] * after[2], e1[0] * after[1] - e1[1] * after[0] };
+			double dot = n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2];
+			double lengths = sqrt((n0[0] * n0[0] + n0[1] * n0[1] + n0[2] * n0[2]) * (n1[0] * n1[0] + n1[1] * n1[1] + n1[2] * n1[2]));
+			if (dot <= FlipLimit * lengths)
+				return true;
+
+			// n1 is the moved triangle's normal negated
+			const double* s0 = &surfaceNormals[remap[target] * 3];
+			const double* s1 = &surfaceNormals[remap[corners[1]] * 3];
+			const double* s2 = &surfaceNormals[remap[corners[2]] * 3];
+			if (n1[0] * (s0[0] + s1[0] + s2[0]) + n1[1] * (s0[1] + s1[1] + s2[1]) + n1[2] * (s0[2] + s1[2] + s2[2]) >= 0.0)
+				return true;
+		}
+		return false;
+	}
+
+	/// <summary>Moves the vertex and merges its error into the target's, keeping the open edge links of borders and seams intact
+	/// </summary>
+	void CollapseVertex(UINT vertex, UINT target)
+	{
+		collapseRemap[vertex] = target;
+		AddQuadric(attributeQuadrics[target], attributeQuadrics[vertex]);
+
+		if (target == openOut[vertex])
+			openIn[target] = openIn[vertex];
+		else if (target == openIn[vertex])
+			openOut[target] = openOut[vertex];
+	}
+
+	UINT PerformCollapses(UINT targetTriangles, float limit)
+	{
+		for (UINT v = 0; v < vertexCount; v++)
+			collapseRemap[v] = v;
+		std::fill(touched.begin(), touched.end(), 0);
+
+		// Each collapse takes out the triangles on its edge, the count is only an estimate until the indices are rebuilt
+		UINT triangles = (UINT)indices.size() / 3;
+		UINT performed = 0;
+		for (const Collapse& collapse : collapses)
+		{
+			if (collapse.error > limit || triangles <= targetTriangles)
+				break;
+
+			UINT vertex = collapse.vertex;
+			UINT target = collapse.target;
+			if (touched[remap[vertex]] || touched[remap[target]])
+				continue;
+
+			UINT partner = NoEdge;
+			UINT partnerTarget = NoEdge;
+			if (kinds[vertex] == KindSeam)
+			{
+				partner = wedge[vertex];
+				partnerTarget = GetSeamTarget(vertex, target);
+			}
+			if (HasFlips(vertex, target) || (partner != NoEdge && HasFlips(partner, partnerTarget)))
+				continue;
+
+			triangles -= min(triangles, CountShared(vertex, target) + (partner != NoEdge ? CountShared(partner, partnerTarget) : 0));
+			AddQuadric(vertexQuadrics[remap[target]], vertexQuadrics[remap[vertex]]);
+			CollapseVertex(vertex, target);
+			if (partner != NoEdge)
+				CollapseVertex(partner, partnerTarget);
+
+			touched[remap[vertex]] = 1;
+			touched[remap[target]] = 1;
+			reached = max(reached, collapse.error);
+			performed++;
+		}
+		return performed;
+	}
+
+	UINT CountShared(UINT vertex, UINT target) const
+	{
+		UINT shared = 0;
+		for (UINT i = adjacencyOffsets[vertex]; i < adjacencyOffsets[vertex + 1]; i++)
+		{
+			const UINT* corners = &indices[adjacency[i] * 3];
+			if (collapseRemap[corners[0]] == target || collapseRemap[corners[1]] == target || collapseRemap[corners[2]] == target)
+				shared++;
+		}
+		return shared;
+	}
+
+	/// <summary>Rewrites the indices through this pass's collapses and drops the triangles that closed up
+	/// </summary>
+	void ApplyCollapses()
+	{
+		size_t write = 0;
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			UINT a = collapseRemap[indices[i]];
+			UINT b = collapseRemap[indices[i + 1]];
+			UINT c = collapseRemap[indices[i + 2]];
+			if (remap[a] == remap[b] || remap[b] == remap[c] || remap[c] == remap[a])
+				continue;
+			indices[write++] = a;
+			indices[write++] = b;
+			indices[write++] = c;
+		}
+		indices.resize(write);
+
+		for (UINT v = 0; v < vertexCount; v++)
+		{
+			if (openIn[v] < ManyEdges)
+				openIn[v] = collapseRemap[openIn[v]];
+			if (openOut[v] < ManyEdges)
+				openOut[v] = collapseRemap[openOut[v]];
+		}
+	}
+
+	UINT vertexCount;
+	double radius;
+	float reached;		// Largest error collapsed so far, relative to the radius
+	std::vector<double> positions;
+	std::vector<double> attributes;
+
+	std::vector<UINT> weld;
+	std::vector<UINT> remap;		// First vertex at the same position
+	std::vector<UINT> wedge;		// Next vertex at the same position, round to the first
+	std::vector<BYTE> kinds;
+	std::vector<UINT64> positionEdges;	// Every edge of the mesh between positions rather than vertices, sorted
+	std::vector<UINT> openIn;		// Vertex at the other end of the one open edge into each vertex, NoEdge or ManyEdges
+	std::vector<UINT> openOut;
+
+	std::vector<Quadric> vertexQuadrics;				// Indexed by remap, shared by the vertices at a position
+	std::vector<AttributeQuadric> attributeQuadrics;
+	std::vector<double> surfaceNormals;					// Indexed by remap, area weighted normal of the full mesh around each position
+
+	std::vector<UINT> adjacencyOffsets;
+	std::vector<UINT> adjacency;		// Triangles around each vertex
+	std::vector<UINT> bestTargets;
+	std::vector<float> bestErrors;
+	std::vector<Collapse> collapses;
+	std::vector<UINT> collapseRemap;
+	std::vector<BYTE> touched;			// Positions this pass already moved, each only collapses once per pass
+};
+
+float MeshSimplifier::Simplify(const Vertex* vertices, UINT vertexCount, const UINT* indices, UINT indexCount, UINT targetIndexCount,
+	const SimplifyOptions& options, std::vector<UINT>& result)
+{
+	if (indexCount < 3 || targetIndexCount >= indexCount)
+	{
+		result.assign(indices, indices + indexCount);
+		return 0.0f;
+	}
+
+	SimplifyContext context(vertices, vertexCount, options);
+	context.Analyze(indices, indexCount);
+	float error = context.Run(targetIndexCount / 3, options.maxError);
+	result.swap(context.indices);
+	return error;
+}
+
+void MeshSimplifier::BuildLODs(const Vertex* vertices, UINT vertexCount, std::vector<UINT>& indices, std::vector<MeshLOD>& lods,
+	const SimplifyOptions& options)
+{
+	UINT fullCount = (UINT)indices.size();
+	MeshLOD full = { 0, fullCount, 0.0f };
+	lods.assign(1, full);
+	if (fullCount < 3 || vertexCount == 0)
+		return;
+
+	// Each level carries on collapsing from the last, the errors stay exact as collapses never undo
+	SimplifyContext context(vertices, vertexCount, options);
+	context.Analyze(&indices[0], fullCount);
+	UINT previousCount = fullCount;
+	while (lods.size() < options.maxLevels && previousCount / 3 > options.minTriangles)
+	{
+		UINT target = (UINT)(previousCount / 3 * options.levelRatio);
+		float error = context.Run(target, options.maxError);
+
+		// Stop once the error limit or the mesh's seams and corners keep a level from shrinking much
+		const std::vector<UINT>& level = context.indices;
+		if (level.empty() || (UINT64)level.size() * 10 > (UINT64)previousCount * 9)
+			break;
+
+		MeshLOD lod = { (UINT)indices.size(), (UINT)level.size(), error };
+		indices.insert(indices.end(), level.begin(), level.end());
+		lods.push_back(lod);
+		previousCount = lod.indexCount;
+	}
+}
@@ -0,0 +1,56 @@
+//
+// Simplifies meshes by collapsing edges in order of quadric error, used to build level of detail chains
+// Position error comes from the planes of the triangles around each vertex, attribute error from how far the UVs, normals
+// and tangents drift from their interpolated values. Vertices on attribute seams only slide along the seam, both sides together
+//
+
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include <vector>
+#include <Windows.h>
+
+#include "Vertex.h"
+
+struct SimplifyOptions
+{
+	SimplifyOptions() :
+	uvWeight(0.5f),
+	normalWeight(0.5f),
+	tangentWeight(0.25f),
+	maxError(0.25f),
+	levelRatio(0.5f),
+	maxLevels(6),
+	minTriangles(24)
+	{
+
+	}
+
+	// Attribute differences count as this much position error, which is measured relative to the mesh's radius
+	float uvWeight;
+	float normalWeight;
+	float tangentWeight;
+
+	float maxError;			// No level strays further than this from the full mesh, relative to its radius
+	float levelRatio;		// Triangles each level keeps of the one before
+	UINT maxLevels;			// Including the full mesh
+	UINT minTriangles;		// Levels stop once they are this small
+};
+
+class MeshSimplifier
+{
+public:
+	/// <summary>Collapses edges until at most targetIndexCount indices are left or the next collapse would pass options.maxError
+	/// result indexes the same vertices as indices. Returns the error reached, in the mesh's units
+	/// </summary>
+	static float Simplify(const Vertex* vertices, UINT vertexCount, const UINT* indices, UINT indexCount, UINT targetIndexCount,
+		const SimplifyOptions& options, std::vector<UINT>& result);
+
+	/// <summary>Appends coarser levels to indices, each simplified from the full mesh indices holds on entry
+	/// lods[0] is the full mesh, the levels after it have fewer triangles and larger errors
+	/// </summary>
+	static void BuildLODs(const Vertex* vertices, UINT vertexCount, std::vector<UINT>& indices, std::vector<MeshLOD>& lods,
+		const SimplifyOptions& options);
+};
+
+#endif
@@ -0,0 +1,278 @@
+//
+// Splits a mesh's full level of detail into meshlets with bounding spheres and normal cones
+// Each meshlet grows from a seed triangle, always taking the neighbouring triangle that adds the fewest vertices
+//
+
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+
+#include "Profiler.h"
+
+static const BYTE NotInMeshlet = 0xFF;
+static const UINT NoTriangle = 0xFFFFFFFF;
+
+// Meshlets whose normals spread wider than this (the cosine from the axis) are back facing from too few places to bother
+static const float MinConeSpread = 0.1f;
+
+static XMFLOAT3 Subtract(const XMFLOAT3& a, const XMFLOAT3& b) { return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z); }
+
+void MeshletBuilder::Build(const Vertex* vertices, UINT vertexCount, const UINT* indices, UINT indexCount, UINT minTriangles,
+	MeshletData& meshlets)
+{
+	meshlets = MeshletData();
+	UINT triangleCount = indexCount / 3;
+	if (vertexCount == 0 || triangleCount == 0 || triangleCount < minTriangles)
+		return;
+
+	PROFILE_ZONE("MeshletBuilder::Build");
+
+	// Vertices sharing a position are one corner, so seams in the UVs or normals don't stop a meshlet from growing across them
+	std::vector<UINT> order(vertexCount);
+	for (UINT i = 0; i < vertexCount; i++)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), [vertices](UINT a, UINT b)
+	{
+		const XMFLOAT3& p = vertices[a].Position;
+		const XMFLOAT3& q = vertices[b].Position;
+		if (p.x != q.x)
+			return p.x < q.x;
+		if (p.y != q.y)
+			return p.y < q.y;
+		return p.z < q.z;
+	});
+	std::vector<UINT> corners(vertexCount);
+	for (UINT i = 0; i < vertexCount; i++)
+	{
+		const XMFLOAT3& p = vertices[order[i]].Position;
+		bool same = i > 0 && memcmp(&p, &vertices[order[i - 1]].Position, sizeof(XMFLOAT3)) == 0;
+		corners[order[i]] = same ? corners[order[i - 1]] : order[i];
+	}
+
+	// Triangles around each corner, packed by corner
+	std::vector<UINT> adjacencyStart(vertexCount + 1, 0);
+	for (UINT i = 0; i < triangleCount * 3; i++)
+		adjacencyStart[corners[indices[i]] + 1]++;
+	for (UINT i = 0; i < vertexCount; i++)
+		adjacencyStart[i + 1] += adjacencyStart[i];
+	std::vector<UINT> adjacency(triangleCount * 3);
+	std::vector<UINT> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+	for (UINT i = 0; i < triangleCount * 3; i++)
+		adjacency[fill[corners[indices[i]]]++] = i / 3;
+
+	// Unused triangles around each corner
+	std::vector<UINT> live(vertexCount, 0);
+	for (UINT i = 0; i < triangleCount * 3; i++)
+		live[corners[indices[i]]]++;
+
+	std::vector<BYTE> used(triangleCount, 0);
+	std::vector<BYTE> local(vertexCount, NotInMeshlet);
+	std::vector<UINT> candidateOf(triangleCount, NoTriangle);	// Meshlet a triangle was last a candidate of, to list it once
+	std::vector<UINT> candidates;
+	std::vector<float> bounds;
+
+	Meshlet current = { 0, 0, 0, 0 };
+	XMFLOAT3 sum(0.0f, 0.0f, 0.0f);
+	UINT seed = 0;
+	while (true)
+	{
+		// Of the triangles touching the meshlet, the one adding the fewest vertices. Ties go to the triangle whose corners have
+		// the fewest unused triangles left, which takes in corners that would otherwise be left over as slivers, then the closest
+		UINT best = NoTriangle;
+		UINT bestAdded = 4;
+		UINT bestLive = 0xFFFFFFFF;
+		float bestDistance = FLT_MAX;
+		UINT next = NoTriangle;
+		UINT nextLive = 0xFFFFFFFF;
+		float scale = current.vertexCount > 0 ? 1.0f / current.vertexCount : 0.0f;
+		XMFLOAT3 center(sum.x * scale, sum.y * scale, sum.z * scale);
+		size_t kept = 0;
+		for (size_t i = 0; i < candidates.size(); i++)
+		{
+			UINT triangle = candidates[i];
+			if (used[triangle])
+				continue;
+			candidates[kept++] = triangle;
+
+			const UINT* corner = &indices[triangle * 3];
+			UINT triangleLive = live[corners[corner[0]]] + live[corners[corner[1]]] + live[corners[corner[2]]];
+			if (triangleLive < nextLive)
+			{
+				next = triangle;
+				nextLive = triangleLive;
+			}
+
+			UINT added = (local[corner[0]] == NotInMeshlet) + (local[corner[1]] == NotInMeshlet) + (local[corner[2]] == NotInMeshlet);
+			if (added > bestAdded || (added == bestAdded && triangleLive > bestLive))
+				continue;
+			const XMFLOAT3& a = vertices[corner[0]].Position;
+			const XMFLOAT3& b = vertices[corner[1]].Position;
+			const XMFLOAT3& c = vertices[corner[2]].Position;
+			XMFLOAT3 offset((a.x + b.x + c.x) / 3.0f - center.x, (a.y + b.y + c.y) / 3.0f - center.y, (a.z + b.z + c.z) / 3.0f - center.z);
+			float distance = offset.x * offset.x + offset.y * offset.y + offset.z * offset.z;
+			if (added < bestAdded || triangleLive < bestLive || distance < bestDistance)
+			{
+				best = triangle;
+				bestAdded = added;
+				bestLive = triangleLive;
+				bestDistance = distance;
+			}
+		}
+		candidates.resize(kept);
+
+		// Nothing left around the meshlet, it is finished below and the next one starts at the first unused triangle
+		if (best == NoTriangle)
+		{
+			while (seed < triangleCount && used[seed])
+				seed++;
+			if (seed == triangleCount)
+				break;
+			best = seed;
+			bestAdded = 3;
+		}
+
+		bool full = current.vertexCount + bestAdded > MeshletMaxVertices || current.triangleCount == MeshletMaxTriangles;
+		if (current.triangleCount > 0 && (full || candidates.empty()))
+		{
+			meshlets.meshlets.push_back(current);
+			bounds.resize(bounds.size() + MeshletBoundsStreams);
+			ComputeBounds(vertices, meshlets, current, &bounds[bounds.size() - MeshletBoundsStreams]);
+			for (UINT i = 0; i < current.vertexCount; i++)
+				local[meshlets.vertices[current.vertexOffset + i]] = NotInMeshlet;
+
+			current.vertexOffset = (UINT)meshlets.vertices.size();
+			current.triangleOffset = (UINT)meshlets.triangles.size() / 3;
+			current.vertexCount = 0;
+			current.triangleCount = 0;
+			sum = XMFLOAT3(0.0f, 0.0f, 0.0f);
+			candidates.clear();
+
+			// A full meshlet's neighbour seeds the next one, the one most hemmed in by used triangles so no holes are left
+			if (next != NoTriangle)
+				best = next;
+		}
+
+		used[best] = 1;
+		for (UINT k = 0; k < 3; k++)
+			live[corners[indices[best * 3 + k]]]--;
+		for (UINT k = 0; k < 3; k++)
+		{
+			UINT vertex = indices[best * 3 + k];
+			if (local[vertex] == NotInMeshlet)
+			{
+				local[vertex] = (BYTE)current.vertexCount++;
+				meshlets.vertices.push_back(vertex);
+				const XMFLOAT3& p = vertices[vertex].Position;
+				sum = XMFLOAT3(sum.x + p.x, sum.y + p.y, sum.z + p.z);
+			}
+			meshlets.triangles.push_back(local[vertex]);
+		}
+		current.triangleCount++;
+
+		UINT meshlet = (UINT)meshlets.meshlets.size();
+		for (UINT k = 0; k < 3; k++)
+		{
+			UINT corner = corners[indices[best * 3 + k]];
+			for (UINT i = adjacencyStart[corner]; i < adjacencyStart[corner + 1]; i++)
+			{
+				UINT triangle = adjacency[i];
+				if (!used[triangle] && candidateOf[triangle] != meshlet)
+				{
+					candidateOf[triangle] = meshlet;
+					candidates.push_back(triangle);
+				}
+			}
+		}
+	}
+
+	if (current.triangleCount > 0)
+	{
+		meshlets.meshlets.push_back(current);
+		bounds.resize(bounds.size() + MeshletBoundsStreams);
+		ComputeBounds(vertices, meshlets, current, &bounds[bounds.size() - MeshletBoundsStreams]);
+	}
+
+	// Per meshlet values become one array per value. The padding never culls anything, the culler masks it off anyway
+	UINT count = (UINT)meshlets.meshlets.size();
+	UINT stride = meshlets.GetBoundsStride();
+	meshlets.bounds.assign(stride * MeshletBoundsStreams, 0.0f);
+	for (UINT i = count; i < stride; i++)
+		meshlets.bounds[MeshletConeCutoff * stride + i] = 1.0f;
+	for (UINT i = 0; i < count; i++)
+	{
+		for (UINT stream = 0; stream < MeshletBoundsStreams; stream++)
+			meshlets.bounds[stream * stride + i] = bounds[i * MeshletBoundsStreams + stream];
+	}
+}
+
+void MeshletBuilder::Unpack(const MeshletData& meshlets, std::vector<UINT>& indices)
+{
+	indices.clear();
+	for (const Meshlet& meshlet : meshlets.meshlets)
+	{
+		const UINT* vertices = &meshlets.vertices[meshlet.vertexOffset];
+		const BYTE* triangles = &meshlets.triangles[meshlet.triangleOffset * 3];
+		for (UINT i = 0; i < meshlet.triangleCount * 3; i++)
+			indices.push_back(vertices[triangles[i]]);
+	}
+}
+
+void MeshletBuilder::ComputeBounds(const Vertex* vertices, const MeshletData& meshlets, const Meshlet& meshlet, float* bounds)
+{
+	const UINT* meshletVertices = &meshlets.vertices[meshlet.vertexOffset];
+	XMFLOAT3 low(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 high(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (UINT i = 0; i < meshlet.vertexCount; i++)
+	{
+		const XMFLOAT3& p = vertices[meshletVertices[i]].Position;
+		low = XMFLOAT3(min(low.x, p.x), min(low.y, p.y), min(low.z, p.z));
+		high = XMFLOAT3(max(high.x, p.x), max(high.y, p.y), max(high.z, p.z));
+	}
+
+	XMFLOAT3 center((low.x + high.x) * 0.5f, (low.y + high.y) * 0.5f, (low.z + high.z) * 0.5f);
+	float radiusSquared = 0.0f;
+	for (UINT i = 0; i < meshlet.vertexCount; i++)
+	{
+		XMFLOAT3 d = Subtract(vertices[meshletVertices[i]].Position, center);
+		radiusSquared = max(radiusSquared, d.x * d.x + d.y * d.y + d.z * d.z);
+	}
+	bounds[MeshletCenterX] = center.x;
+	bounds[MeshletCenterY] = center.y;
+	bounds[MeshletCenterZ] = center.z;
+	bounds[MeshletRadius] = sqrtf(radiusSquared);
+
+	// Clockwise front faces, so the cross product of the first two edges points out of the front of the triangle
+	const BYTE* triangles = &meshlets.triangles[meshlet.triangleOffset * 3];
+	std::vector<XMFLOAT3> normals;
+	XMFLOAT3 axis(0.0f, 0.0f, 0.0f);
+	for (UINT i = 0; i < meshlet.triangleCount; i++)
+	{
+		const XMFLOAT3& a = vertices[meshletVertices[triangles[i * 3]]].Position;
+		XMFLOAT3 ab = Subtract(vertices[meshletVertices[triangles[i * 3 + 1]]].Position, a);
+		XMFLOAT3 ac = Subtract(vertices[meshletVertices[triangles[i * 3 + 2]]].Position, a);
+		XMFLOAT3 n(ab.y * ac.z - ab.z * ac.y, ab.z * ac.x - ab.x * ac.z, ab.x * ac.y - ab.y * ac.x);
+		float length = sqrtf(n.x * n.x + n.y * n.y + n.z * n.z);
+		if (length == 0.0f)
+			continue;
+		n = XMFLOAT3(n.x / length, n.y / length, n.z / length);
+		normals.push_back(n);
+		axis = XMFLOAT3(axis.x + n.x, axis.y + n.y, axis.z + n.z);
+	}
+
+	float axisLength = sqrtf(axis.x * axis.x + axis.y * axis.y + axis.z * axis.z);
+	float spread = -1.0f;
+	if (axisLength > 0.0f)
+	{
+		axis = XMFLOAT3(axis.x / axisLength, axis.y / axisLength, axis.z / axisLength);
+		spread = 1.0f;
+		for (const XMFLOAT3& n : normals)
+			spread = min(spread, n.x * axis.x + n.y * axis.y + n.z * axis.z);
+	}
+	bounds[MeshletConeX] = axis.x;
+	bounds[MeshletConeY] = axis.y;
+	bounds[MeshletConeZ] = axis.z;
+	bounds[MeshletConeCutoff] = spread <= MinConeSpread ? 1.0f : sqrtf(1.0f - spread * spread);
+}
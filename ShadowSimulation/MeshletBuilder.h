@@ -0,0 +1,84 @@
+//
+// Splits a mesh's full level of detail into meshlets, small clusters of triangles that can be culled on their own
+// Triangles are gathered greedily around shared corners, so a meshlet is a compact patch of the surface. Each one gets
+// a bounding sphere and a cone around its triangles' normals, enough to tell when it is off screen or entirely back facing
+//
+
+#ifndef MESHLETBUILDER_H
+#define MESHLETBUILDER_H
+
+#include <vector>
+#include <Windows.h>
+
+#include "Vertex.h"
+
+// Limits of one meshlet, the triangle count leaves room for the usual 128 entry GPU limit once rounded to whole groups
+static const UINT MeshletMaxVertices = 64;
+static const UINT MeshletMaxTriangles = 124;
+
+/// <summary>Where a meshlet's vertices and triangles sit in its MeshletData
+/// </summary>
+struct Meshlet
+{
+	UINT vertexOffset;
+	UINT triangleOffset;	// In triangles, each is three bytes of MeshletData::triangles
+	UINT vertexCount;
+	UINT triangleCount;
+};
+
+/// <summary>Arrays of MeshletData::bounds, each as long as the meshlet count rounded up to a multiple of 4
+/// so the culler can test four meshlets at once
+/// </summary>
+enum MeshletBoundsStream
+{
+	MeshletCenterX,
+	MeshletCenterY,
+	MeshletCenterZ,
+	MeshletRadius,
+	MeshletConeX,		// Average normal of the meshlet's triangles
+	MeshletConeY,
+	MeshletConeZ,
+	MeshletConeCutoff,	// Sine of the angle the farthest normal strays from the axis, 1 when no view sees every triangle's back
+	MeshletBoundsStreams
+};
+
+struct MeshletData
+{
+	/// <summary>Length of each of the bounds arrays
+	/// </summary>
+	UINT GetBoundsStride() const { return ((UINT)meshlets.size() + 3) & ~3u; }
+
+	const float* GetBounds(MeshletBoundsStream stream) const { return &bounds[stream * GetBoundsStride()]; }
+
+	/// <summary>Bytes the arrays take, for the MemoryRegistry
+	/// </summary>
+	UINT64 GetBytes() const
+	{
+		return meshlets.capacity() * sizeof(Meshlet) + vertices.capacity() * sizeof(UINT) + triangles.capacity() + bounds.capacity() * sizeof(float);
+	}
+
+	std::vector<Meshlet> meshlets;
+	std::vector<UINT> vertices;		// Mesh vertex of each meshlet vertex, relative to the mesh's first vertex
+	std::vector<BYTE> triangles;	// Three meshlet vertices per triangle, clockwise like the mesh
+	std::vector<float> bounds;		// MeshletBoundsStreams arrays one after another, in the mesh's own space
+};
+
+class MeshletBuilder
+{
+public:
+	/// <summary>Builds meshlets from a triangle list, replacing what meshlets held. Meshes under minTriangles are left
+	/// without any, culling them piece by piece would cost more than drawing them whole
+	/// </summary>
+	static void Build(const Vertex* vertices, UINT vertexCount, const UINT* indices, UINT indexCount, UINT minTriangles,
+		MeshletData& meshlets);
+
+	/// <summary>Indices of the triangles of every meshlet in order, as a triangle list over the mesh's vertices
+	/// </summary>
+	static void Unpack(const MeshletData& meshlets, std::vector<UINT>& indices);
+private:
+	/// <summary>Writes the meshlet's sphere and cone to bounds, one value per MeshletBoundsStream
+	/// </summary>
+	static void ComputeBounds(const Vertex* vertices, const MeshletData& meshlets, const Meshlet& meshlet, float* bounds);
+};
+
+#endif
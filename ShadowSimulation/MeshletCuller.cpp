@@ -0,0 +1,316 @@
+//
+// Culls the meshlets of large meshes on the CPU each pass, four at a time with SSE, and packs the indices left
+//
+
+#include "MeshletCuller.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <xmmintrin.h>
+
+#include "Profiler.h"
+#include "TerrainLOD.h"
+#include "TrackedResources.h"
+
+// The render thread culls as well, and the update and streaming threads need cores of their own
+static const UINT DefaultMaxWorkers = 3;
+
+// Meshes with fewer meshlets than this are drawn whole, the few triangles saved don't pay for the test and the upload
+static const UINT DefaultMinMeshlets = 4;
+
+// The index buffer grows by at least this much, so a slowly growing scene doesn't recreate it every frame
+static const UINT MinCapacity = 64 * 1024;
+
+// Set bits in each 4 bit lane mask
+static const UINT LaneCounts[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+/// <summary>Releases the culler's index buffer. Same as Game.h's ReleaseMacro, kept here so the culler builds
+/// without the rest of the renderer
+/// </summary>
+static void ReleaseBuffer(ID3D11Buffer*& buffer)
+{
+	if (buffer)
+	{
+		buffer->Release();
+		buffer = NULL;
+	}
+}
+
+static void AddStats(MeshletCullStats& total, const MeshletCullStats& add)
+{
+	total.objects += add.objects;
+	total.meshlets += add.meshlets;
+	total.visible += add.visible;
+	total.frustumCulled += add.frustumCulled;
+	total.coneCulled += add.coneCulled;
+	total.triangles += add.triangles;
+}
+
+/// <summary>Moves the view into the space of a mesh drawn with world. Planes are normalized there so spheres in the
+/// mesh's units test against them directly. Mirroring transforms turn back faces into front faces, those skip the cone test
+/// </summary>
+static MeshletView ToMeshSpace(const MeshletView& view, const XMFLOAT4X4& world, bool& coneTest)
+{
+	XMMATRIX transform = XMLoadFloat4x4(&world);
+	XMVECTOR determinant;
+	XMMATRIX inverse = XMMatrixInverse(&determinant, transform);
+	coneTest = XMVectorGetX(determinant) > 0.0f;
+
+	// A plane p holds points x world with p . (x world) = 0, so in mesh space it is world p, or p times world transposed
+	MeshletView local = view;
+	XMMATRIX planeTransform = XMMatrixTranspose(transform);
+	for (UINT i = 0; i < 6; i++)
+	{
+		XMVECTOR plane = XMVector4Transform(XMLoadFloat4(&view.planes[i]), planeTransform);
+		XMStoreFloat4(&local.planes[i], plane / XMVector3Length(plane));
+	}
+	XMStoreFloat3(&local.eye, XMVector3TransformCoord(XMLoadFloat3(&view.eye), inverse));
+	XMStoreFloat3(&local.direction, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&view.direction), inverse)));
+	return local;
+}
+
+MeshletCuller::MeshletCuller() :
+dev(NULL),
+indexBuffer(NULL),
+capacity(0),
+enabled(true),
+threadCount(min(max(std::thread::hardware_concurrency(), 1u) - 1, DefaultMaxWorkers)),
+minMeshlets(DefaultMinMeshlets)
+{
+
+}
+
+MeshletCuller::~MeshletCuller()
+{
+	ReleaseBuffer(indexBuffer);
+}
+
+void MeshletCuller::ParseCommandLine(const char* cmdLine)
+{
+	if (!cmdLine)
+		return;
+
+	std::istringstream args(cmdLine);
+	std::string arg;
+	while (args >> arg)
+	{
+		size_t split = arg.find('=');
+		if (split == std::string::npos)
+			continue;
+
+		std::string key = arg.substr(0, split);
+		std::string value = arg.substr(split + 1);
+		if (key == "meshlets")
+			enabled = value != "0";
+		else if (key == "meshletthreads")
+			threadCount = (UINT)max(atoi(value.c_str()), 0);
+		else if (key == "meshletmin")
+			minMeshlets = (UINT)max(atoi(value.c_str()), 1);
+	}
+}
+
+void MeshletCuller::Initialize(ID3D11Device* _dev)
+{
+	dev = _dev;
+	if (enabled)
+		jobPool.Start(threadCount);
+}
+
+bool MeshletCuller::IsEnabled() const { return enabled; }
+
+bool MeshletCuller::ShouldCull(const MeshletData& meshlets, UINT lod) const
+{
+	return enabled && lod == 0 && meshlets.meshlets.size() >= minMeshlets;
+}
+
+MeshletView MeshletCuller::PerspectiveView(const XMFLOAT4X4& viewProjection, const XMFLOAT3& eye)
+{
+	MeshletView view;
+	TerrainSelector::ExtractFrustum(viewProjection, view.planes);
+	view.orthographic = false;
+	view.eye = eye;
+	view.direction = XMFLOAT3(0.0f, 0.0f, 1.0f);
+	return view;
+}
+
+MeshletView MeshletCuller::OrthographicView(const XMFLOAT4X4& viewProjection, const XMFLOAT3& direction)
+{
+	MeshletView view;
+	TerrainSelector::ExtractFrustum(viewProjection, view.planes);
+	view.orthographic = true;
+	view.eye = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	view.direction = direction;
+	return view;
+}
+
+bool MeshletCuller::Cull(ID3D11DeviceContext* devCon, const MeshletView& view, MeshletJob* jobs, UINT jobCount)
+{
+	PROFILE_ZONE("MeshletCuller::Cull");
+	stats = MeshletCullStats();
+	UINT total = PlaceJobs(jobs, jobCount);
+	if (total == 0)
+		return true;
+
+	if (total > capacity)
+	{
+		ReleaseBuffer(indexBuffer);
+		capacity = max(total + total / 2, MinCapacity);
+
+		D3D11_BUFFER_DESC ibd = {};
+		ibd.Usage = D3D11_USAGE_DYNAMIC;
+		ibd.ByteWidth = capacity * sizeof(UINT);
+		ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+		ibd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		if (FAILED(TrackedResources::CreateBuffer(dev, &ibd, NULL, "MeshletCuller", &indexBuffer)))
+		{
+			capacity = 0;
+			return false;
+		}
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(devCon->Map(indexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		return false;
+	Run(view, jobs, jobCount, (UINT*)mapped.pData);
+	devCon->Unmap(indexBuffer, 0);
+	return true;
+}
+
+void MeshletCuller::CullInto(const MeshletView& view, MeshletJob* jobs, UINT jobCount, UINT* indices)
+{
+	stats = MeshletCullStats();
+	PlaceJobs(jobs, jobCount);
+	Run(view, jobs, jobCount, indices);
+}
+
+UINT MeshletCuller::CullMeshlets(const MeshletData& meshlets, const MeshletView& view, bool coneTest, UINT* out, MeshletCullStats& cullStats)
+{
+	UINT count = (UINT)meshlets.meshlets.size();
+	const float* centerX = meshlets.GetBounds(MeshletCenterX);
+	const float* centerY = meshlets.GetBounds(MeshletCenterY);
+	const float* centerZ = meshlets.GetBounds(MeshletCenterZ);
+	const float* radii = meshlets.GetBounds(MeshletRadius);
+	const float* coneX = meshlets.GetBounds(MeshletConeX);
+	const float* coneY = meshlets.GetBounds(MeshletConeY);
+	const float* coneZ = meshlets.GetBounds(MeshletConeZ);
+	const float* cutoffs = meshlets.GetBounds(MeshletConeCutoff);
+
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+	for (UINT i = 0; i < 6; i++)
+	{
+		planeX[i] = _mm_set1_ps(view.planes[i].x);
+		planeY[i] = _mm_set1_ps(view.planes[i].y);
+		planeZ[i] = _mm_set1_ps(view.planes[i].z);
+		planeW[i] = _mm_set1_ps(view.planes[i].w);
+	}
+	__m128 eyeX = _mm_set1_ps(view.eye.x);
+	__m128 eyeY = _mm_set1_ps(view.eye.y);
+	__m128 eyeZ = _mm_set1_ps(view.eye.z);
+	__m128 directionX = _mm_set1_ps(view.direction.x);
+	__m128 directionY = _mm_set1_ps(view.direction.y);
+	__m128 directionZ = _mm_set1_ps(view.direction.z);
+	__m128 zero = _mm_setzero_ps();
+
+	UINT written = 0;
+	for (UINT i = 0; i < count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(centerX + i);
+		__m128 y = _mm_loadu_ps(centerY + i);
+		__m128 z = _mm_loadu_ps(centerZ + i);
+		__m128 radius = _mm_loadu_ps(radii + i);
+
+		// Outside if the whole sphere is behind any plane
+		__m128 negativeRadius = _mm_sub_ps(zero, radius);
+		__m128 outside = zero;
+		for (UINT p = 0; p < 6; p++)
+		{
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)),
+				_mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p]));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeRadius));
+		}
+
+		// Back facing if every direction from the view to the sphere lies within the cone's complement around the axis
+		__m128 back = zero;
+		if (coneTest)
+		{
+			__m128 axisX = _mm_loadu_ps(coneX + i);
+			__m128 axisY = _mm_loadu_ps(coneY + i);
+			__m128 axisZ = _mm_loadu_ps(coneZ + i);
+			__m128 cutoff = _mm_loadu_ps(cutoffs + i);
+			if (view.orthographic)
+			{
+				__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(axisX, directionX), _mm_mul_ps(axisY, directionY)), _mm_mul_ps(axisZ, directionZ));
+				back = _mm_cmpge_ps(dot, cutoff);
+			}
+			else
+			{
+				__m128 toX = _mm_sub_ps(x, eyeX);
+				__m128 toY = _mm_sub_ps(y, eyeY);
+				__m128 toZ = _mm_sub_ps(z, eyeZ);
+				__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(axisX, toX), _mm_mul_ps(axisY, toY)), _mm_mul_ps(axisZ, toZ));
+				__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(toX, toX), _mm_mul_ps(toY, toY)), _mm_mul_ps(toZ, toZ)));
+				back = _mm_cmpge_ps(dot, _mm_add_ps(_mm_mul_ps(cutoff, length), radius));
+			}
+		}
+
+		UINT lanes = (1u << min(count - i, 4u)) - 1;
+		UINT outsideMask = (UINT)_mm_movemask_ps(outside) & lanes;
+		UINT backMask = (UINT)_mm_movemask_ps(back) & lanes & ~outsideMask;
+		UINT visibleMask = lanes & ~(outsideMask | backMask);
+		cullStats.frustumCulled += LaneCounts[outsideMask];
+		cullStats.coneCulled += LaneCounts[backMask];
+
+		for (UINT lane = 0; lane < 4; lane++)
+		{
+			if (!(visibleMask & (1u << lane)))
+				continue;
+			const Meshlet& meshlet = meshlets.meshlets[i + lane];
+			const UINT* vertices = &meshlets.vertices[meshlet.vertexOffset];
+			const BYTE* triangles = &meshlets.triangles[meshlet.triangleOffset * 3];
+			for (UINT k = 0; k < meshlet.triangleCount * 3; k++)
+				out[written + k] = vertices[triangles[k]];
+			written += meshlet.triangleCount * 3;
+			cullStats.visible++;
+		}
+	}
+	cullStats.meshlets += count;
+	cullStats.triangles += written / 3;
+	return written;
+}
+
+ID3D11Buffer* MeshletCuller::GetIndexBuffer() const { return indexBuffer; }
+
+const MeshletCullStats& MeshletCuller::GetStats() const { return stats; }
+
+UINT MeshletCuller::PlaceJobs(MeshletJob* jobs, UINT jobCount)
+{
+	// Every job gets room for all of its triangles, so workers never have to agree on where their output goes
+	UINT total = 0;
+	for (UINT i = 0; i < jobCount; i++)
+	{
+		jobs[i].indexStart = total;
+		total += (UINT)jobs[i].meshlets->triangles.size();
+	}
+	return total;
+}
+
+void MeshletCuller::Run(const MeshletView& view, MeshletJob* jobs, UINT jobCount, UINT* indices)
+{
+	// Each thread counts into its own slot, summed once every job is done
+	slotStats.assign(jobPool.GetWorkerCount() + 1, MeshletCullStats());
+	jobPool.Run(jobCount, [this, &view, jobs, indices](UINT i, UINT slot)
+	{
+		MeshletJob& job = jobs[i];
+		MeshletCullStats& jobStats = slotStats[slot];
+		bool coneTest;
+		MeshletView local = ToMeshSpace(view, job.world, coneTest);
+		UINT visible = jobStats.visible;
+		job.indexCount = CullMeshlets(*job.meshlets, local, coneTest, indices + job.indexStart, jobStats);
+		job.meshletsVisible = jobStats.visible - visible;
+		jobStats.objects++;
+	});
+	for (const MeshletCullStats& slot : slotStats)
+		AddStats(stats, slot);
+}
@@ -0,0 +1,121 @@
+//
+// Culls the meshlets of large meshes on the CPU each pass and writes the indices of those left into one dynamic index buffer
+// Meshlets are tested four at a time against the view frustum and against their normal cones, which for the camera
+// drop meshlets facing away from the eye and for the shadow pass those facing away from the light. Objects are split
+// among worker threads that wait between passes, each writing its survivors straight into its own part of the buffer
+// Command line: meshlets=0 draws every mesh whole, meshletthreads=<workers besides the render thread>,
+// meshletmin=<fewest meshlets a mesh needs to be culled piece by piece>
+//
+
+#ifndef MESHLETCULLER_H
+#define MESHLETCULLER_H
+
+#include <d3d11.h>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "JobPool.h"
+#include "MeshletBuilder.h"
+
+using namespace DirectX;
+
+/// <summary>What a pass sees, in world space. Planes point inwards
+/// </summary>
+struct MeshletView
+{
+	XMFLOAT4 planes[6];
+	bool orthographic;
+	XMFLOAT3 eye;			// Camera position for perspective views
+	XMFLOAT3 direction;		// Direction the view looks in for orthographic ones
+};
+
+/// <summary>One object to cull. Cull fills in where its indices went, indexCount is 0 if nothing of it is left
+/// </summary>
+struct MeshletJob
+{
+	const MeshletData* meshlets;
+	XMFLOAT4X4 world;
+	UINT indexStart;
+	UINT indexCount;
+	UINT meshletsVisible;
+};
+
+struct MeshletCullStats
+{
+	MeshletCullStats() : objects(0), meshlets(0), visible(0), frustumCulled(0), coneCulled(0), triangles(0) {}
+
+	UINT objects;
+	UINT meshlets;
+	UINT visible;
+	UINT frustumCulled;		// Outside one of the view's planes
+	UINT coneCulled;		// Every triangle facing away from the view
+	UINT triangles;			// Written to the index buffer
+};
+
+class MeshletCuller
+{
+public:
+	MeshletCuller();
+	~MeshletCuller();
+
+	void ParseCommandLine(const char* cmdLine);
+
+	/// <summary>Starts the worker threads, the index buffer is made on the first Cull
+	/// </summary>
+	void Initialize(ID3D11Device* dev);
+
+	bool IsEnabled() const;
+
+	/// <summary>Returns whether meshlets are worth testing one by one rather than drawing the whole level
+	/// </summary>
+	bool ShouldCull(const MeshletData& meshlets, UINT lod) const;
+
+	/// <summary>Views from an untransposed view projection matrix, the eye or view direction decides which way is back facing
+	/// </summary>
+	static MeshletView PerspectiveView(const XMFLOAT4X4& viewProjection, const XMFLOAT3& eye);
+	static MeshletView OrthographicView(const XMFLOAT4X4& viewProjection, const XMFLOAT3& direction);
+
+	/// <summary>Culls every job and writes the indices left into the index buffer, relative to each mesh's first vertex
+	/// Discards what the buffer held, so draws of an earlier pass keep reading their own copy. Returns false if it couldn't be mapped
+	/// </summary>
+	bool Cull(ID3D11DeviceContext* devCon, const MeshletView& view, MeshletJob* jobs, UINT jobCount);
+
+	/// <summary>Culls into memory instead of the index buffer, indices needs room for every job's full triangle count
+	/// </summary>
+	void CullInto(const MeshletView& view, MeshletJob* jobs, UINT jobCount, UINT* indices);
+
+	/// <summary>Tests the meshlets against a view already moved into the mesh's space and writes the indices left to out
+	/// Returns how many were written
+	/// </summary>
+	static UINT CullMeshlets(const MeshletData& meshlets, const MeshletView& view, bool coneTest, UINT* out, MeshletCullStats& cullStats);
+
+	ID3D11Buffer* GetIndexBuffer() const;
+
+	/// <summary>Totals of the last Cull
+	/// </summary>
+	const MeshletCullStats& GetStats() const;
+private:
+	MeshletCuller(const MeshletCuller&);
+	MeshletCuller& operator=(const MeshletCuller&);
+
+	/// <summary>Sets each job's indexStart and returns how many indices they need at most
+	/// </summary>
+	static UINT PlaceJobs(MeshletJob* jobs, UINT jobCount);
+
+	/// <summary>Culls the jobs on the render thread and the workers together, writing to indices
+	/// </summary>
+	void Run(const MeshletView& view, MeshletJob* jobs, UINT jobCount, UINT* indices);
+
+	ID3D11Device* dev;
+	ID3D11Buffer* indexBuffer;
+	UINT capacity;			// Indices the buffer holds
+	bool enabled;
+	UINT threadCount;
+	UINT minMeshlets;
+	MeshletCullStats stats;
+
+	JobPool jobPool;
+	std::vector<MeshletCullStats> slotStats;	// Per thread totals of the current Cull
+};
+
+#endif
@@ -31,7 +31,10 @@ cbuffer perObject : register(b1)
 	LightMaterial lightMat;
 	float tileX;
 	float tileZ;
-	float padO[2];
+	uint diffuseSlice;
+	uint normalSlice;
+	float4 diffuseRect;
+	float4 normalRect;
 };
 
 float4 main( VertexInput input) : SV_POSITION
@@ -0,0 +1,109 @@
+//
+// Fixed size pool for objects that come and go every few frames, like draw packets and per chunk state
+// Objects are carved out of blocks that are never given back until the pool goes, freed slots are reused first
+//
+
+#ifndef OBJECTPOOL_H
+#define OBJECTPOOL_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <Windows.h>
+
+template <class T>
+class ObjectPool
+{
+public:
+	ObjectPool(UINT itemsPerBlock = 256) :
+	itemsPerBlock(itemsPerBlock),
+	freeList(NULL),
+	live(0)
+	{
+
+	}
+
+	/// <summary>Every object still alive is destroyed with the pool
+	/// </summary>
+	~ObjectPool()
+	{
+		Clear();
+		for (Slot* block : blocks)
+			delete[] block;
+	}
+
+	template <class... Args>
+	T* Create(Args&&... args)
+	{
+		if (!freeList)
+			AddBlock();
+
+		Slot* slot = freeList;
+		freeList = slot->next;
+		slot->next = NULL;
+		slot->live = true;
+		live++;
+		return ::new((void*)&slot->storage) T(std::forward<Args>(args)...);
+	}
+
+	void Destroy(T* object)
+	{
+		if (!object)
+			return;
+
+		object->~T();
+		Slot* slot = (Slot*)((BYTE*)object - offsetof(Slot, storage));
+		slot->live = false;
+		slot->next = freeList;
+		freeList = slot;
+		live--;
+	}
+
+	/// <summary>Destroys every live object but keeps the blocks
+	/// </summary>
+	void Clear()
+	{
+		for (Slot* block : blocks)
+		{
+			for (UINT i = 0; i < itemsPerBlock; i++)
+			{
+				if (block[i].live)
+					Destroy((T*)&block[i].storage);
+			}
+		}
+	}
+
+	UINT GetLiveCount() const { return live; }
+	UINT GetCapacity() const { return (UINT)blocks.size() * itemsPerBlock; }
+private:
+	struct Slot
+	{
+		typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type storage;
+		Slot* next;		// Next free slot, only while free
+		bool live;
+	};
+
+	ObjectPool(const ObjectPool&);
+	ObjectPool& operator=(const ObjectPool&);
+
+	void AddBlock()
+	{
+		Slot* block = new Slot[itemsPerBlock];
+		for (UINT i = 0; i < itemsPerBlock; i++)
+		{
+			block[i].live = false;
+			block[i].next = i + 1 < itemsPerBlock ? &block[i + 1] : freeList;
+		}
+		freeList = block;
+		blocks.push_back(block);
+	}
+
+	UINT itemsPerBlock;
+	std::vector<Slot*> blocks;
+	Slot* freeList;
+	UINT live;
+};
+
+#endif
@@ -0,0 +1,438 @@
+//
+// CPU occlusion culling against a small masked depth buffer
+// Occluder boxes and meshes are rasterized into 8x4 pixel subtiles that each keep a coverage mask and two depth layers,
+// then object bounds are tested against a max depth pyramid built from them. Works for any view, the camera or a light
+//
+
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <emmintrin.h>
+#include <sstream>
+#include <string>
+
+static const UINT SubtileWidth = 8;
+static const UINT SubtileHeight = 4;
+static const UINT FullMask = 0xFFFFFFFF;
+
+// Box corners are numbered by bits, 1 takes the max x, 2 the max y and 4 the max z
+// Each face is clockwise seen from outside
+static const UINT BoxIndices[36] =
+{
+	2, 3, 1, 2, 1, 0,	// -z
+	7, 6, 4, 7, 4, 5,	// +z
+	6, 2, 0, 6, 0, 4,	// -x
+	3, 7, 5, 3, 5, 1,	// +x
+	6, 7, 3, 6, 3, 2,	// +y
+	5, 4, 0, 5, 0, 1	// -y
+};
+
+static void Multiply(const XMFLOAT4X4& a, const XMFLOAT4X4& b, XMFLOAT4X4& result)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = 0; j < 4; j++)
+			result.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j] + a.m[i][3] * b.m[3][j];
+	}
+}
+
+static void TransformPoint(const float* p, const XMFLOAT4X4& m, float* out)
+{
+	for (int i = 0; i < 4; i++)
+		out[i] = p[0] * m.m[0][i] + p[1] * m.m[1][i] + p[2] * m.m[2][i] + m.m[3][i];
+}
+
+static void GetBoxCorners(const MeshBounds& box, const XMFLOAT4X4& transform, float corners[8][4])
+{
+	for (UINT i = 0; i < 8; i++)
+	{
+		float p[3] =
+		{
+			box.center.x + (i & 1 ? box.extents.x : -box.extents.x),
+			box.center.y + (i & 2 ? box.extents.y : -box.extents.y),
+			box.center.z + (i & 4 ? box.extents.z : -box.extents.z)
+		};
+		TransformPoint(p, transform, corners[i]);
+	}
+}
+
+/// <summary>Lanes where the edge function is positive, or zero on a top or left edge
+/// </summary>
+static __m128 InsideEdge(__m128 e, __m128 topLeft)
+{
+	__m128 zero = _mm_setzero_ps();
+	return _mm_or_ps(_mm_cmpgt_ps(e, zero), _mm_and_ps(_mm_cmpeq_ps(e, zero), topLeft));
+}
+
+OcclusionCuller::OcclusionCuller() :
+enabled(true),
+width(0),
+height(0),
+subtilesX(0),
+subtilesY(0)
+{
+
+}
+
+void OcclusionCuller::ParseCommandLine(const char* cmdLine)
+{
+	if (!cmdLine)
+		return;
+
+	std::istringstream args(cmdLine);
+	std::string arg;
+	while (args >> arg)
+	{
+		size_t split = arg.find('=');
+		if (split != std::string::npos && arg.substr(0, split) == "occlusion")
+			enabled = arg.substr(split + 1) != "0";
+	}
+}
+
+bool OcclusionCuller::IsEnabled() const { return enabled; }
+
+void OcclusionCuller::Resize(UINT _width, UINT _height)
+{
+	subtilesX = max((_width + SubtileWidth - 1) / SubtileWidth, 1u);
+	subtilesY = max((_height + SubtileHeight - 1) / SubtileHeight, 1u);
+	width = subtilesX * SubtileWidth;
+	height = subtilesY * SubtileHeight;
+
+	UINT count = subtilesX * subtilesY;
+	farDepth.assign(count, 1.0f);
+	workingDepth.assign(count, 0.0f);
+	workingMask.assign(count, 0);
+
+	pyramid.clear();
+	pyramidWidths.clear();
+	pyramidHeights.clear();
+	UINT levelWidth = subtilesX;
+	UINT levelHeight = subtilesY;
+	for (;;)
+	{
+		pyramid.push_back(std::vector<float>(levelWidth * levelHeight, 1.0f));
+		pyramidWidths.push_back(levelWidth);
+		pyramidHeights.push_back(levelHeight);
+		if (levelWidth == 1 && levelHeight == 1)
+			break;
+		levelWidth = (levelWidth + 1) / 2;
+		levelHeight = (levelHeight + 1) / 2;
+	}
+}
+
+void OcclusionCuller::Begin(const XMFLOAT4X4& _viewProjection)
+{
+	viewProjection = _viewProjection;
+	std::fill(farDepth.begin(), farDepth.end(), 1.0f);
+	std::fill(workingDepth.begin(), workingDepth.end(), 0.0f);
+	std::fill(workingMask.begin(), workingMask.end(), 0);
+	stats = OcclusionStats();
+}
+
+void OcclusionCuller::RenderBox(const MeshBounds& box, const XMFLOAT4X4& world)
+{
+	XMFLOAT4X4 transform;
+	Multiply(world, viewProjection, transform);
+
+	float corners[8][4];
+	GetBoxCorners(box, transform, corners);
+
+	stats.occluders++;
+	for (UINT i = 0; i < 36; i += 3)
+		RenderTriangle(corners[BoxIndices[i]], corners[BoxIndices[i + 1]], corners[BoxIndices[i + 2]]);
+}
+
+void OcclusionCuller::RenderMesh(const Vertex* vertices, UINT vertexCount, const UINT* indices, UINT indexCount, const XMFLOAT4X4& world)
+{
+	XMFLOAT4X4 transform;
+	Multiply(world, viewProjection, transform);
+
+	clipVertices.resize(vertexCount * 4);
+	for (UINT i = 0; i < vertexCount; i++)
+		TransformPoint(&vertices[i].Position.x, transform, &clipVertices[i * 4]);
+
+	stats.occluders++;
+	for (UINT i = 0; i + 2 < indexCount; i += 3)
+	{
+		if (indices[i] >= vertexCount || indices[i + 1] >= vertexCount || indices[i + 2] >= vertexCount)
+			continue;
+		RenderTriangle(&clipVertices[indices[i] * 4], &clipVertices[indices[i + 1] * 4], &clipVertices[indices[i + 2] * 4]);
+	}
+}
+
+void OcclusionCuller::RenderTriangle(const float* v0, const float* v1, const float* v2)
+{
+	const float* input[3] = { v0, v1, v2 };
+
+	// Only the near plane (z >= 0) is clipped, the rest is handled by clamping to the buffer
+	float polygon[4][4];
+	UINT count = 0;
+	for (UINT k = 0; k < 3; k++)
+	{
+		const float* a = input[k];
+		const float* b = input[k == 2 ? 0 : k + 1];
+		if (a[2] >= 0.0f)
+		{
+			for (int c = 0; c < 4; c++)
+				polygon[count][c] = a[c];
+			count++;
+		}
+		if ((a[2] >= 0.0f) != (b[2] >= 0.0f))
+		{
+			float t = a[2] / (a[2] - b[2]);
+			for (int c = 0; c < 4; c++)
+				polygon[count][c] = a[c] + (b[c] - a[c]) * t;
+			count++;
+		}
+	}
+	if (count < 3)
+		return;
+
+	float x[4], y[4], z[4];
+	for (UINT k = 0; k < count; k++)
+	{
+		float w = polygon[k][3];
+		if (!(w > 0.0f))
+			return;
+		float invW = 1.0f / w;
+		x[k] = (polygon[k][0] * invW * 0.5f + 0.5f) * width;
+		y[k] = (0.5f - polygon[k][1] * invW * 0.5f) * height;
+		z[k] = polygon[k][2] * invW;
+	}
+
+	RasterizeTriangle(x, y, z);
+	if (count == 4)
+	{
+		float fanX[3] = { x[0], x[2], x[3] };
+		float fanY[3] = { y[0], y[2], y[3] };
+		float fanZ[3] = { z[0], z[2], z[3] };
+		RasterizeTriangle(fanX, fanY, fanZ);
+	}
+}
+
+void OcclusionCuller::RasterizeTriangle(const float* x, const float* y, const float* z)
+{
+	// Clockwise on screen is front facing, the same edge functions as the software renderer
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (!(area > 0.0f))
+		return;
+
+	int minX = max((int)floorf(min(x[0], min(x[1], x[2])) - 0.5f), 0);
+	int minY = max((int)floorf(min(y[0], min(y[1], y[2])) - 0.5f), 0);
+	int maxX = min((int)ceilf(max(x[0], max(x[1], x[2])) - 0.5f), (int)width - 1);
+	int maxY = min((int)ceilf(max(y[0], max(y[1], y[2])) - 0.5f), (int)height - 1);
+	if (minX > maxX || minY > maxY)
+		return;
+
+	stats.occluderTriangles++;
+
+	// Pixel centers on an edge belong to the triangle it is a top or left edge of, as in the software renderer, so two
+	// triangles sharing an edge through a row of centers still cover the subtiles under it completely
+	float edgeA[3], edgeB[3], edgeC[3];
+	__m128 topLeft[3];
+	for (int k = 0; k < 3; k++)
+	{
+		int j = k == 2 ? 0 : k + 1;
+		int l = j == 2 ? 0 : j + 1;
+		edgeA[k] = y[j] - y[l];
+		edgeB[k] = x[l] - x[j];
+		edgeC[k] = x[j] * y[l] - x[l] * y[j];
+		bool isTopLeft = edgeA[k] > 0.0f || (edgeA[k] == 0.0f && edgeB[k] > 0.0f);
+		topLeft[k] = isTopLeft ? _mm_castsi128_ps(_mm_set1_epi32(-1)) : _mm_setzero_ps();
+	}
+
+	// Depth is planar on screen, its max over a subtile is at one corner and never beyond the farthest vertex
+	float invArea = 1.0f / area;
+	float depthX = (edgeA[0] * z[0] + edgeA[1] * z[1] + edgeA[2] * z[2]) * invArea;
+	float depthY = (edgeB[0] * z[0] + edgeB[1] * z[1] + edgeB[2] * z[2]) * invArea;
+	float depthC = (edgeC[0] * z[0] + edgeC[1] * z[1] + edgeC[2] * z[2]) * invArea;
+	float maxDepth = max(z[0], max(z[1], z[2]));
+
+	// Edge steps across a subtile row, pixels 0-3 and 4-7
+	__m128 stepLow[3], stepHigh[3];
+	for (int k = 0; k < 3; k++)
+	{
+		stepLow[k] = _mm_mul_ps(_mm_set1_ps(edgeA[k]), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+		stepHigh[k] = _mm_mul_ps(_mm_set1_ps(edgeA[k]), _mm_setr_ps(4.0f, 5.0f, 6.0f, 7.0f));
+	}
+
+	UINT firstX = minX / SubtileWidth;
+	UINT lastX = maxX / SubtileWidth;
+	UINT firstY = minY / SubtileHeight;
+	UINT lastY = maxY / SubtileHeight;
+	for (UINT sy = firstY; sy <= lastY; sy++)
+	{
+		float originY = (float)(sy * SubtileHeight) + 0.5f;
+		for (UINT sx = firstX; sx <= lastX; sx++)
+		{
+			float originX = (float)(sx * SubtileWidth) + 0.5f;
+			float depth = depthX * (depthX > 0.0f ? originX + SubtileWidth - 1 : originX) +
+				depthY * (depthY > 0.0f ? originY + SubtileHeight - 1 : originY) + depthC;
+			depth = min(depth, maxDepth);
+
+			// Nothing to gain where the subtile is already known to be nearer
+			UINT subtile = sy * subtilesX + sx;
+			if (!(depth < farDepth[subtile]))
+				continue;
+
+			UINT coverage = 0;
+			for (UINT row = 0; row < SubtileHeight; row++)
+			{
+				__m128 insideLow = _mm_castsi128_ps(_mm_set1_epi32(-1));
+				__m128 insideHigh = insideLow;
+				for (int k = 0; k < 3; k++)
+				{
+					__m128 start = _mm_set1_ps(edgeA[k] * originX + edgeB[k] * (originY + row) + edgeC[k]);
+					insideLow = _mm_and_ps(insideLow, InsideEdge(_mm_add_ps(start, stepLow[k]), topLeft[k]));
+					insideHigh = _mm_and_ps(insideHigh, InsideEdge(_mm_add_ps(start, stepHigh[k]), topLeft[k]));
+				}
+				UINT rowMask = (UINT)_mm_movemask_ps(insideLow) | ((UINT)_mm_movemask_ps(insideHigh) << 4);
+				coverage |= rowMask << (row * SubtileWidth);
+			}
+
+			if (coverage)
+				UpdateSubtile(subtile, coverage, depth);
+		}
+	}
+}
+
+void OcclusionCuller::UpdateSubtile(UINT subtile, UINT coverage, float depth)
+{
+	float& reference = farDepth[subtile];
+	float& working = workingDepth[subtile];
+	UINT& mask = workingMask[subtile];
+
+	// Merging a much nearer triangle would waste it on the working layer's depth, start the working layer over from it instead
+	if (mask != 0 && depth < working && working - depth > reference - working)
+		mask = 0;
+
+	working = mask ? max(working, depth) : depth;
+	mask |= coverage;
+
+	// Once every pixel is covered the working layer becomes the new reference
+	if (mask == FullMask)
+	{
+		reference = min(reference, working);
+		working = 0.0f;
+		mask = 0;
+	}
+}
+
+void OcclusionCuller::End()
+{
+	pyramid[0] = farDepth;
+	for (size_t level = 1; level < pyramid.size(); level++)
+	{
+		const std::vector<float>& below = pyramid[level - 1];
+		UINT belowWidth = pyramidWidths[level - 1];
+		UINT belowHeight = pyramidHeights[level - 1];
+		std::vector<float>& cells = pyramid[level];
+		for (UINT y = 0; y < pyramidHeights[level]; y++)
+		{
+			for (UINT x = 0; x < pyramidWidths[level]; x++)
+			{
+				UINT x1 = min(x * 2 + 1, belowWidth - 1);
+				UINT y1 = min(y * 2 + 1, belowHeight - 1);
+				cells[y * pyramidWidths[level] + x] = max(max(below[y * 2 * belowWidth + x * 2], below[y * 2 * belowWidth + x1]),
+					max(below[y1 * belowWidth + x * 2], below[y1 * belowWidth + x1]));
+			}
+		}
+	}
+}
+
+bool OcclusionCuller::IsVisible(const MeshBounds& bounds, const XMFLOAT4X4& world)
+{
+	stats.tested++;
+
+	XMFLOAT4X4 transform;
+	Multiply(world, viewProjection, transform);
+
+	float corners[8][4];
+	GetBoxCorners(bounds, transform, corners);
+
+	// A box crossing the near plane can't be bounded on screen, one wholly behind it isn't drawn at all
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX, minDepth = FLT_MAX;
+	UINT behind = 0;
+	for (UINT i = 0; i < 8; i++)
+	{
+		const float* p = corners[i];
+		if (p[2] < 0.0f || !(p[3] > 0.0f))
+		{
+			behind++;
+			continue;
+		}
+		float invW = 1.0f / p[3];
+		float x = (p[0] * invW * 0.5f + 0.5f) * width;
+		float y = (0.5f - p[1] * invW * 0.5f) * height;
+		minX = min(minX, x);
+		maxX = max(maxX, x);
+		minY = min(minY, y);
+		maxY = max(maxY, y);
+		minDepth = min(minDepth, p[2] * invW);
+	}
+	if (behind == 8)
+	{
+		stats.outside++;
+		return false;
+	}
+	if (behind > 0)
+	{
+		stats.visible++;
+		return true;
+	}
+
+	if (maxX < 0.0f || maxY < 0.0f || minX >= (float)width || minY >= (float)height || minDepth > 1.0f)
+	{
+		stats.outside++;
+		return false;
+	}
+
+	// Every pixel the box touches, not only those whose centers it covers, the buffer is coarser than the target
+	int pixelMinX = max((int)floorf(minX), 0);
+	int pixelMinY = max((int)floorf(minY), 0);
+	int pixelMaxX = min((int)floorf(maxX), (int)width - 1);
+	int pixelMaxY = min((int)floorf(maxY), (int)height - 1);
+
+	UINT top = (UINT)pyramid.size() - 1;
+	if (TestLevel(top, 0, 0, pixelMinX / SubtileWidth, pixelMinY / SubtileHeight, pixelMaxX / SubtileWidth, pixelMaxY / SubtileHeight, minDepth))
+	{
+		stats.visible++;
+		return true;
+	}
+	stats.occluded++;
+	return false;
+}
+
+bool OcclusionCuller::TestLevel(UINT level, UINT cellX, UINT cellY, int minX, int minY, int maxX, int maxY, float depth) const
+{
+	// Hidden if the box's nearest point is behind the farthest depth anywhere in the cell
+	if (depth > pyramid[level][cellY * pyramidWidths[level] + cellX])
+		return false;
+	if (level == 0)
+		return true;
+
+	UINT child = level - 1;
+	int firstX = max((int)cellX * 2, minX >> child);
+	int lastX = min(min((int)cellX * 2 + 1, maxX >> child), (int)pyramidWidths[child] - 1);
+	int firstY = max((int)cellY * 2, minY >> child);
+	int lastY = min(min((int)cellY * 2 + 1, maxY >> child), (int)pyramidHeights[child] - 1);
+	for (int y = firstY; y <= lastY; y++)
+	{
+		for (int x = firstX; x <= lastX; x++)
+		{
+			if (TestLevel(child, x, y, minX, minY, maxX, maxY, depth))
+				return true;
+		}
+	}
+	return false;
+}
+
+const OcclusionStats& OcclusionCuller::GetStats() const { return stats; }
+
+const std::vector<float>& OcclusionCuller::GetDepth() const { return farDepth; }
+
+UINT OcclusionCuller::GetSubtilesX() const { return subtilesX; }
+
+UINT OcclusionCuller::GetSubtilesY() const { return subtilesY; }
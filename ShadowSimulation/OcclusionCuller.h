@@ -0,0 +1,117 @@
+//
+// CPU occlusion culling against a small masked depth buffer
+// Occluder boxes and meshes are rasterized into 8x4 pixel subtiles that each keep a coverage mask and two depth layers,
+// then object bounds are tested against a max depth pyramid built from them. Works for any view, the camera or a light
+//
+
+#ifndef OCCLUSIONCULLER_H
+#define OCCLUSIONCULLER_H
+
+#include <vector>
+#include <Windows.h>
+#include <DirectXMath.h>
+
+#include "Vertex.h"
+
+using namespace DirectX;
+
+struct OcclusionStats
+{
+	OcclusionStats() :
+	occluders(0),
+	occluderTriangles(0),
+	tested(0),
+	visible(0),
+	occluded(0),
+	outside(0)
+	{
+
+	}
+
+	UINT occluders;
+	UINT occluderTriangles;		// Front facing triangles that reached the depth buffer
+	UINT tested;
+	UINT visible;
+	UINT occluded;				// Behind the occluders
+	UINT outside;				// Off screen or past the far plane
+};
+
+class OcclusionCuller
+{
+public:
+	OcclusionCuller();
+
+	/// <summary>Reads occlusion=0 from the command line to turn culling off
+	/// </summary>
+	void ParseCommandLine(const char* cmdLine);
+
+	bool IsEnabled() const;
+
+	/// <summary>Sizes the depth buffer, rounded up to whole 8x4 subtiles. It is much smaller than the target it culls for
+	/// </summary>
+	void Resize(UINT width, UINT height);
+
+	/// <summary>Clears the depth buffer for a new view. The matrix is untransposed, points multiply on the left
+	/// </summary>
+	void Begin(const XMFLOAT4X4& viewProjection);
+
+	/// <summary>Rasterizes a box that lies entirely inside the object it stands in for
+	/// </summary>
+	void RenderBox(const MeshBounds& box, const XMFLOAT4X4& world);
+
+	/// <summary>Rasterizes a simplified occluder mesh, clockwise front faces like the scene's rasterizer state
+	/// </summary>
+	void RenderMesh(const Vertex* vertices, UINT vertexCount, const UINT* indices, UINT indexCount, const XMFLOAT4X4& world);
+
+	/// <summary>Builds the depth pyramid the tests read, call after the last occluder
+	/// </summary>
+	void End();
+
+	/// <summary>Returns false if the bounds are certainly hidden behind the occluders or outside the view
+	/// </summary>
+	bool IsVisible(const MeshBounds& bounds, const XMFLOAT4X4& world);
+
+	const OcclusionStats& GetStats() const;
+
+	/// <summary>Conservative farthest depth of each subtile, row major, for inspecting the buffer
+	/// </summary>
+	const std::vector<float>& GetDepth() const;
+	UINT GetSubtilesX() const;
+	UINT GetSubtilesY() const;
+private:
+	/// <summary>Clips a clip space triangle against the near plane and rasterizes what is left
+	/// </summary>
+	void RenderTriangle(const float* v0, const float* v1, const float* v2);
+
+	void RasterizeTriangle(const float* x, const float* y, const float* z);
+
+	/// <summary>Merges a triangle's coverage of one subtile into its layers
+	/// </summary>
+	void UpdateSubtile(UINT subtile, UINT coverage, float depth);
+
+	/// <summary>Returns true if any pixel under the rectangle could be farther than depth, refining from level down to the subtiles
+	/// </summary>
+	bool TestLevel(UINT level, UINT cellX, UINT cellY, int minX, int minY, int maxX, int maxY, float depth) const;
+
+	bool enabled;
+	UINT width;
+	UINT height;
+	UINT subtilesX;
+	UINT subtilesY;
+	XMFLOAT4X4 viewProjection;
+	std::vector<float> clipVertices;
+
+	// Per subtile: the reference layer's depth holds for every pixel, the working layer's only for the masked ones
+	std::vector<float> farDepth;
+	std::vector<float> workingDepth;
+	std::vector<UINT> workingMask;
+
+	// Level 0 is a copy of farDepth, each level above keeps the max of 2x2 cells of the one below
+	std::vector<std::vector<float> > pyramid;
+	std::vector<UINT> pyramidWidths;
+	std::vector<UINT> pyramidHeights;
+
+	OcclusionStats stats;
+};
+
+#endif
@@ -0,0 +1,785 @@
+//
+// Portable PNG decoder, produces 8 bit RGBA without going through WIC
+// Reads every color type and bit depth in the spec, including Adam7 interlacing
+//
+
+#include "PNGDecoder.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <emmintrin.h>
+
+#include "ImageConvert.h"
+#include "Profiler.h"
+
+static const BYTE PNGSignature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+static const UINT PNGMaxSize = 16384;	// Largest texture D3D11 can create
+
+enum PNGColorType
+{
+	PNGGray = 0,
+	PNGRGB = 2,
+	PNGPalette = 3,
+	PNGGrayAlpha = 4,
+	PNGRGBA = 6
+};
+
+static UINT ReadBigEndian(const BYTE* data)
+{
+	return ((UINT)data[0] << 24) | ((UINT)data[1] << 16) | ((UINT)data[2] << 8) | data[3];
+}
+
+///
+// Inflate
+///
+static const UINT HuffmanFastBits = 9;
+static const UINT HuffmanFastMask = (1 << HuffmanFastBits) - 1;
+
+static const USHORT LengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const BYTE LengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const USHORT DistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+	4097, 6145, 8193, 12289, 16385, 24577 };
+static const BYTE DistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+static const BYTE CodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+/// <summary>Reads the stream least significant bit first, 64 bits buffered at a time
+/// </summary>
+struct BitReader
+{
+	BitReader(const BYTE* _data, size_t _size) :
+	data(_data),
+	size(_size),
+	position(0),
+	bits(0),
+	count(0)
+	{
+
+	}
+
+	void Refill()
+	{
+		// Past the end reads zeros, Overrun catches streams that needed them
+		while (count <= 56)
+		{
+			UINT64 byte = position < size ? data[position] : 0;
+			bits |= byte << count;
+			position++;
+			count += 8;
+		}
+	}
+
+	UINT Peek(UINT n)
+	{
+		if (count < n)
+			Refill();
+		return (UINT)(bits & ((1ull << n) - 1));
+	}
+
+	void Consume(UINT n)
+	{
+		bits >>= n;
+		count -= n;
+	}
+
+	UINT Read(UINT n)
+	{
+		UINT value = Peek(n);
+		Consume(n);
+		return value;
+	}
+
+	/// <summary>Drops the bits left in the current byte and hands back the buffered whole bytes
+	/// </summary>
+	void AlignToByte()
+	{
+		Consume(count % 8);
+		position -= count / 8;
+		bits = 0;
+		count = 0;
+	}
+
+	bool Overrun() const
+	{
+		return position - count / 8 > size;
+	}
+
+	const BYTE* data;
+	size_t size;
+	size_t position;
+	UINT64 bits;
+	UINT count;
+};
+
+/// <summary>Canonical Huffman code, a table for codes up to 9 bits and a search by length for longer ones
+/// </summary>
+struct Huffman
+{
+	bool Build(const BYTE* lengths, UINT symbols)
+	{
+		UINT counts[16] = { 0 };
+		for (UINT i = 0; i < symbols; i++)
+			counts[lengths[i]]++;
+		counts[0] = 0;
+
+		memset(fast, 0, sizeof(fast));
+
+		UINT code = 0;
+		UINT symbol = 0;
+		UINT next[16];
+		for (UINT length = 1; length < 16; length++)
+		{
+			next[length] = code;
+			firstCode[length] = (USHORT)code;
+			firstSymbol[length] = (USHORT)symbol;
+			code += counts[length];
+			if (counts[length] && code > (1u << length))
+				return false;	// Oversubscribed
+			maxCode[length] = code << (16 - length);
+			code <<= 1;
+			symbol += counts[length];
+		}
+		maxCode[16] = 0x10000;
+
+		for (UINT i = 0; i < symbols; i++)
+		{
+			UINT length = lengths[i];
+			if (length == 0)
+				continue;
+
+			UINT index = firstSymbol[length] + next[length] - firstCode[length];
+			values[index] = (USHORT)i;
+
+			// The stream stores codes most significant bit first, the reader works the other way round
+			if (length <= HuffmanFastBits)
+			{
+				UINT reversed = Reverse(next[length], length);
+				for (UINT j = reversed; j <= HuffmanFastMask; j += 1 << length)
+					fast[j] = (USHORT)((length << HuffmanFastBits) | i);
+			}
+			next[length]++;
+		}
+		return true;
+	}
+
+	/// <summary>Returns the next symbol, or -1 for a code that isn't in the table
+	/// </summary>
+	int Decode(BitReader& reader) const
+	{
+		UINT peek = reader.Peek(16);
+		USHORT entry = fast[peek & HuffmanFastMask];
+		if (entry)
+		{
+			reader.Consume(entry >> HuffmanFastBits);
+			return entry & HuffmanFastMask;
+		}
+
+		UINT code = Reverse(peek, 16);
+		UINT length = HuffmanFastBits + 1;
+		while (code >= maxCode[length])
+			length++;
+		if (length >= 16)
+			return -1;
+
+		reader.Consume(length);
+		return values[firstSymbol[length] + (code >> (16 - length)) - firstCode[length]];
+	}
+
+	static UINT Reverse(UINT code, UINT length)
+	{
+		UINT reversed = 0;
+		for (UINT i = 0; i < length; i++)
+		{
+			reversed = (reversed << 1) | (code & 1);
+			code >>= 1;
+		}
+		return reversed;
+	}
+
+	USHORT fast[1 << HuffmanFastBits];	// Length above the symbol, 0 when the code is longer than the table
+	USHORT firstCode[16];
+	USHORT firstSymbol[16];
+	UINT maxCode[17];
+	USHORT values[288];
+};
+
+static UINT Adler32(const BYTE* data, size_t size)
+{
+	UINT a = 1;
+	UINT b = 0;
+	while (size > 0)
+	{
+		// Largest run that can't overflow b before taking the modulus
+		size_t run = min(size, (size_t)5552);
+		for (size_t i = 0; i < run; i++)
+		{
+			a += data[i];
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+		data += run;
+		size -= run;
+	}
+	return (b << 16) | a;
+}
+
+static bool InflateBlock(BitReader& reader, const Huffman& literals, const Huffman& distances, BYTE* out, size_t size, size_t& written)
+{
+	for (;;)
+	{
+		int symbol = literals.Decode(reader);
+		if (symbol < 0 || reader.Overrun())
+			return false;
+
+		if (symbol < 256)
+		{
+			if (written >= size)
+				return false;
+			out[written++] = (BYTE)symbol;
+			continue;
+		}
+		if (symbol == 256)
+			return true;
+
+		symbol -= 257;
+		if (symbol >= 29)
+			return false;
+		size_t length = LengthBase[symbol] + reader.Read(LengthExtra[symbol]);
+
+		int distanceSymbol = distances.Decode(reader);
+		if (distanceSymbol < 0 || distanceSymbol >= 30)
+			return false;
+		size_t distance = DistanceBase[distanceSymbol] + reader.Read(DistanceExtra[distanceSymbol]);
+
+		if (distance > written || length > size - written)
+			return false;
+
+		BYTE* target = out + written;
+		const BYTE* source = target - distance;
+		if (distance == 1)
+			memset(target, *source, length);
+		else if (distance >= length)
+			memcpy(target, source, length);
+		else
+		{
+			// Overlapping copies repeat the last distance bytes
+			for (size_t i = 0; i < length; i++)
+				target[i] = source[i];
+		}
+		written += length;
+	}
+}
+
+bool PNGDecoder::Inflate(const BYTE* data, size_t length, BYTE* out, size_t size)
+{
+	// zlib header, deflate with no preset dictionary
+	if (length < 6 || (data[0] & 0x0F) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 0x20))
+		return false;
+
+	BitReader reader(data + 2, length - 2);
+	size_t written = 0;
+
+	Huffman* literals = new Huffman();
+	Huffman* distances = new Huffman();
+	bool valid = true;
+	bool last = false;
+	while (valid && !last)
+	{
+		last = reader.Read(1) != 0;
+		UINT type = reader.Read(2);
+
+		if (type == 0)
+		{
+			// Stored
+			reader.AlignToByte();
+			if (reader.position + 4 > reader.size)
+			{
+				valid = false;
+				break;
+			}
+			const BYTE* header = reader.data + reader.position;
+			UINT stored = header[0] | (header[1] << 8);
+			UINT check = header[2] | (header[3] << 8);
+			reader.position += 4;
+			if ((stored ^ 0xFFFF) != check || reader.position + stored > reader.size || stored > size - written)
+			{
+				valid = false;
+				break;
+			}
+			memcpy(out + written, reader.data + reader.position, stored);
+			reader.position += stored;
+			written += stored;
+		}
+		else if (type == 1)
+		{
+			BYTE lengths[288 + 32];
+			memset(lengths, 8, 144);
+			memset(lengths + 144, 9, 112);
+			memset(lengths + 256, 7, 24);
+			memset(lengths + 280, 8, 8);
+			memset(lengths + 288, 5, 32);
+			valid = literals->Build(lengths, 288) && distances->Build(lengths + 288, 32) &&
+				InflateBlock(reader, *literals, *distances, out, size, written);
+		}
+		else if (type == 2)
+		{
+			UINT literalCount = reader.Read(5) + 257;
+			UINT distanceCount = reader.Read(5) + 1;
+			UINT codeLengthCount = reader.Read(4) + 4;
+
+			BYTE codeLengths[19] = { 0 };
+			for (UINT i = 0; i < codeLengthCount; i++)
+				codeLengths[CodeLengthOrder[i]] = (BYTE)reader.Read(3);
+
+			Huffman codeLengthCode;
+			valid = literalCount <= 286 && distanceCount <= 30 && codeLengthCode.Build(codeLengths, 19);
+
+			// Literal and distance lengths run together, repeats can cross from one to the other
+			BYTE lengths[286 + 30];
+			UINT total = literalCount + distanceCount;
+			UINT filled = 0;
+			while (valid && filled < total)
+			{
+				int symbol = codeLengthCode.Decode(reader);
+				if (symbol < 0 || reader.Overrun())
+					valid = false;
+				else if (symbol < 16)
+					lengths[filled++] = (BYTE)symbol;
+				else
+				{
+					BYTE value = 0;
+					UINT repeat;
+					if (symbol == 16)
+					{
+						if (filled == 0)
+						{
+							valid = false;
+							break;
+						}
+						value = lengths[filled - 1];
+						repeat = 3 + reader.Read(2);
+					}
+					else if (symbol == 17)
+						repeat = 3 + reader.Read(3);
+					else
+						repeat = 11 + reader.Read(7);
+
+					if (filled + repeat > total)
+						valid = false;
+					else
+					{
+						memset(lengths + filled, value, repeat);
+						filled += repeat;
+					}
+				}
+			}
+
+			valid = valid && lengths[256] != 0 && literals->Build(lengths, literalCount) && distances->Build(lengths + literalCount, distanceCount) &&
+				InflateBlock(reader, *literals, *distances, out, size, written);
+		}
+		else
+			valid = false;
+
+		valid = valid && !reader.Overrun();
+	}
+	delete literals;
+	delete distances;
+
+	if (!valid || written != size)
+		return false;
+
+	reader.AlignToByte();
+	if (reader.position + 4 > reader.size)
+		return false;
+	return ReadBigEndian(reader.data + reader.position) == Adler32(out, size);
+}
+
+///
+// PNG
+///
+struct PNGHeader
+{
+	UINT width;
+	UINT height;
+	UINT depth;
+	UINT colorType;
+	bool interlaced;
+
+	UINT channels;
+	UINT bitsPerPixel;
+	UINT filterStride;	// Bytes back to the corresponding byte of the pixel to the left, at least 1
+};
+
+struct PNGTransparency
+{
+	PNGTransparency() :
+	keyed(false)
+	{
+
+	}
+
+	bool keyed;		// Gray and RGB images, one color is fully transparent
+	UINT key[3];
+};
+
+// Adam7 passes, the first pixel and the spacing in each direction
+static const UINT Adam7X[7] = { 0, 4, 0, 2, 0, 1, 0 };
+static const UINT Adam7Y[7] = { 0, 0, 4, 0, 2, 0, 1 };
+static const UINT Adam7StepX[7] = { 8, 8, 4, 4, 2, 2, 1 };
+static const UINT Adam7StepY[7] = { 8, 8, 8, 4, 4, 2, 2 };
+
+static UINT GetRowBytes(const PNGHeader& header, UINT width)
+{
+	return (UINT)(((UINT64)width * header.bitsPerPixel + 7) / 8);
+}
+
+static BYTE Paeth(BYTE left, BYTE up, BYTE upLeft)
+{
+	int estimate = left + up - upLeft;
+	int distanceLeft = abs(estimate - left);
+	int distanceUp = abs(estimate - up);
+	int distanceUpLeft = abs(estimate - upLeft);
+	if (distanceLeft <= distanceUp && distanceLeft <= distanceUpLeft)
+		return left;
+	return distanceUp <= distanceUpLeft ? up : upLeft;
+}
+
+/// <summary>Undoes the per row filters in place. Each row is a filter byte followed by rowBytes of pixels
+/// </summary>
+static bool Unfilter(BYTE* rows, UINT height, UINT rowBytes, UINT stride, const BYTE* zeros)
+{
+	const BYTE* prior = zeros;
+	for (UINT y = 0; y < height; y++)
+	{
+		BYTE filter = rows[0];
+		BYTE* row = rows + 1;
+
+		UINT i = 0;
+		switch (filter)
+		{
+		case 0:
+			break;
+		case 1:
+			for (i = stride; i < rowBytes; i++)
+				row[i] = (BYTE)(row[i] + row[i - stride]);
+			break;
+		case 2:
+			// The only filter without a dependency along the row, sixteen bytes at a time
+			for (; i + 16 <= rowBytes; i += 16)
+			{
+				__m128i sum = _mm_add_epi8(_mm_loadu_si128((const __m128i*)(row + i)), _mm_loadu_si128((const __m128i*)(prior + i)));
+				_mm_storeu_si128((__m128i*)(row + i), sum);
+			}
+			for (; i < rowBytes; i++)
+				row[i] = (BYTE)(row[i] + prior[i]);
+			break;
+		case 3:
+			for (; i < stride && i < rowBytes; i++)
+				row[i] = (BYTE)(row[i] + (prior[i] >> 1));
+			for (; i < rowBytes; i++)
+				row[i] = (BYTE)(row[i] + ((row[i - stride] + prior[i]) >> 1));
+			break;
+		case 4:
+			for (; i < stride && i < rowBytes; i++)
+				row[i] = (BYTE)(row[i] + prior[i]);
+			for (; i < rowBytes; i++)
+				row[i] = (BYTE)(row[i] + Paeth(row[i - stride], prior[i], prior[i - stride]));
+			break;
+		default:
+			return false;
+		}
+
+		prior = row;
+		rows += rowBytes + 1;
+	}
+	return true;
+}
+
+static UINT ReadSample(const BYTE* row, UINT index, UINT depth)
+{
+	if (depth == 8)
+		return row[index];
+	if (depth == 16)
+		return (row[index * 2] << 8) | row[index * 2 + 1];
+
+	// Packed most significant bits first
+	UINT bit = index * depth;
+	return (row[bit / 8] >> (8 - depth - bit % 8)) & ((1 << depth) - 1);
+}
+
+/// <summary>Converts one unfiltered row to RGBA
+/// </summary>
+static void ExpandRow(const BYTE* row, UINT width, const PNGHeader& header, const BYTE* palette, const PNGTransparency& transparency, BYTE* out)
+{
+	if (header.depth == 8 && header.colorType == PNGRGBA)
+	{
+		memcpy(out, row, (size_t)width * 4);
+		return;
+	}
+
+	if (header.depth == 8 && header.colorType == PNGRGB)
+	{
+		ImageConvert::RGBToRGBA(row, out, width);
+		if (transparency.keyed)
+		{
+			for (UINT x = 0; x < width; x++)
+			{
+				const BYTE* pixel = row + x * 3;
+				if (pixel[0] == transparency.key[0] && pixel[1] == transparency.key[1] && pixel[2] == transparency.key[2])
+					out[x * 4 + 3] = 0;
+			}
+		}
+		return;
+	}
+
+	UINT maxValue = (1 << header.depth) - 1;
+	for (UINT x = 0; x < width; x++)
+	{
+		BYTE* pixel = out + x * 4;
+		UINT samples[4];
+		for (UINT c = 0; c < header.channels; c++)
+			samples[c] = ReadSample(row, x * header.channels + c, header.depth);
+
+		if (header.colorType == PNGPalette)
+		{
+			memcpy(pixel, palette + samples[0] * 4, 4);
+			continue;
+		}
+
+		BYTE scaled[4];
+		for (UINT c = 0; c < header.channels; c++)
+			scaled[c] = (BYTE)(header.depth == 16 ? samples[c] >> 8 : samples[c] * 255 / maxValue);
+
+		switch (header.colorType)
+		{
+		case PNGGray:
+			pixel[0] = pixel[1] = pixel[2] = scaled[0];
+			pixel[3] = transparency.keyed && samples[0] == transparency.key[0] ? 0 : 255;
+			break;
+		case PNGGrayAlpha:
+			pixel[0] = pixel[1] = pixel[2] = scaled[0];
+			pixel[3] = scaled[1];
+			break;
+		case PNGRGB:
+			pixel[0] = scaled[0];
+			pixel[1] = scaled[1];
+			pixel[2] = scaled[2];
+			pixel[3] = transparency.keyed && samples[0] == transparency.key[0] && samples[1] == transparency.key[1] &&
+				samples[2] == transparency.key[2] ? 0 : 255;
+			break;
+		default:
+			memcpy(pixel, scaled, 4);
+			break;
+		}
+	}
+}
+
+bool PNGDecoder::CanDecode(const BYTE* data, size_t size) const
+{
+	return size >= sizeof(PNGSignature) && memcmp(data, PNGSignature, sizeof(PNGSignature)) == 0;
+}
+
+const char* PNGDecoder::GetName() const
+{
+	return "PNG";
+}
+
+PNGDecoder::PNGDecoder() :
+decodes(0),
+decodeTicks(0),
+inflateTicks(0)
+{
+
+}
+
+PNGDecodeStats PNGDecoder::GetStats() const
+{
+	PNGDecodeStats stats = { decodes.load(), decodeTicks.load(), inflateTicks.load() };
+	return stats;
+}
+
+bool PNGDecoder::Decode(const BYTE* data, size_t size, ImageData& image) const
+{
+	if (!CanDecode(data, size))
+		return false;
+	INT64 start = Profiler::Now();
+
+	PNGHeader header;
+	memset(&header, 0, sizeof(header));
+	PNGTransparency transparency;
+
+	// Opaque black for entries past the end of a short palette
+	BYTE palette[256 * 4];
+	memset(palette, 0, sizeof(palette));
+	for (UINT i = 0; i < 256; i++)
+		palette[i * 4 + 3] = 255;
+	UINT paletteSize = 0;
+
+	std::vector<BYTE> compressed;
+	bool seenHeader = false;
+	bool seenEnd = false;
+	size_t position = sizeof(PNGSignature);
+	while (!seenEnd && position + 12 <= size)
+	{
+		UINT length = ReadBigEndian(data + position);
+		const BYTE* type = data + position + 4;
+		const BYTE* chunk = data + position + 8;
+		if (length > size - position - 12)
+			return false;
+		position += 12 + (size_t)length;
+
+		if (memcmp(type, "IHDR", 4) == 0)
+		{
+			if (length != 13)
+				return false;
+			header.width = ReadBigEndian(chunk);
+			header.height = ReadBigEndian(chunk + 4);
+			header.depth = chunk[8];
+			header.colorType = chunk[9];
+			header.interlaced = chunk[12] == 1;
+			if (chunk[10] != 0 || chunk[11] != 0 || chunk[12] > 1)
+				return false;
+			seenHeader = true;
+		}
+		else if (!seenHeader)
+			return false;
+		else if (memcmp(type, "PLTE", 4) == 0)
+		{
+			paletteSize = min(length / 3, 256u);
+			for (UINT i = 0; i < paletteSize; i++)
+				memcpy(palette + i * 4, chunk + i * 3, 3);
+		}
+		else if (memcmp(type, "tRNS", 4) == 0)
+		{
+			if (header.colorType == PNGPalette)
+			{
+				for (UINT i = 0; i < min(length, 256u); i++)
+					palette[i * 4 + 3] = chunk[i];
+			}
+			else if (header.colorType == PNGGray && length >= 2)
+			{
+				transparency.keyed = true;
+				transparency.key[0] = (chunk[0] << 8) | chunk[1];
+			}
+			else if (header.colorType == PNGRGB && length >= 6)
+			{
+				transparency.keyed = true;
+				for (UINT c = 0; c < 3; c++)
+					transparency.key[c] = (chunk[c * 2] << 8) | chunk[c * 2 + 1];
+			}
+		}
+		else if (memcmp(type, "IDAT", 4) == 0)
+			compressed.insert(compressed.end(), chunk, chunk + length);
+		else if (memcmp(type, "IEND", 4) == 0)
+			seenEnd = true;
+	}
+
+	if (!seenHeader || compressed.empty())
+		return false;
+	if (header.width == 0 || header.height == 0 || header.width > PNGMaxSize || header.height > PNGMaxSize)
+		return false;
+
+	switch (header.colorType)
+	{
+	case PNGGray:
+		header.channels = 1;
+		break;
+	case PNGRGB:
+		header.channels = 3;
+		break;
+	case PNGPalette:
+		header.channels = 1;
+		break;
+	case PNGGrayAlpha:
+		header.channels = 2;
+		break;
+	case PNGRGBA:
+		header.channels = 4;
+		break;
+	default:
+		return false;
+	}
+
+	// Each color type only allows some depths
+	UINT depth = header.depth;
+	bool validDepth = depth == 8 || (depth == 16 && header.colorType != PNGPalette) ||
+		((depth == 1 || depth == 2 || depth == 4) && (header.colorType == PNGGray || header.colorType == PNGPalette));
+	if (!validDepth || (header.colorType == PNGPalette && paletteSize == 0))
+		return false;
+
+	header.bitsPerPixel = header.channels * depth;
+	header.filterStride = max(header.bitsPerPixel / 8, 1u);
+
+	// The interlaced passes are stored one after another, each a complete filtered image of its own
+	UINT passes = header.interlaced ? 7 : 1;
+	UINT passWidths[7];
+	UINT passHeights[7];
+	size_t rawSize = 0;
+	for (UINT pass = 0; pass < passes; pass++)
+	{
+		if (header.interlaced)
+		{
+			passWidths[pass] = header.width > Adam7X[pass] ? (header.width - Adam7X[pass] + Adam7StepX[pass] - 1) / Adam7StepX[pass] : 0;
+			passHeights[pass] = header.height > Adam7Y[pass] ? (header.height - Adam7Y[pass] + Adam7StepY[pass] - 1) / Adam7StepY[pass] : 0;
+		}
+		else
+		{
+			passWidths[pass] = header.width;
+			passHeights[pass] = header.height;
+		}
+		if (passWidths[pass] && passHeights[pass])
+			rawSize += (size_t)passHeights[pass] * (GetRowBytes(header, passWidths[pass]) + 1);
+	}
+
+	std::vector<BYTE> raw(rawSize);
+	INT64 inflateStart = Profiler::Now();
+	if (!Inflate(&compressed[0], compressed.size(), &raw[0], rawSize))
+		return false;
+	INT64 inflated = Profiler::Now() - inflateStart;
+
+	image.width = header.width;
+	image.height = header.height;
+	image.rgba.resize((size_t)header.width * header.height * 4);
+
+	std::vector<BYTE> zeros(GetRowBytes(header, header.width) + 16, 0);
+	std::vector<BYTE> expanded;
+	if (header.interlaced)
+		expanded.resize((size_t)header.width * 4);
+
+	BYTE* rows = &raw[0];
+	for (UINT pass = 0; pass < passes; pass++)
+	{
+		UINT width = passWidths[pass];
+		UINT height = passHeights[pass];
+		if (width == 0 || height == 0)
+			continue;
+
+		UINT rowBytes = GetRowBytes(header, width);
+		if (!Unfilter(rows, height, rowBytes, header.filterStride, &zeros[0]))
+			return false;
+
+		for (UINT y = 0; y < height; y++)
+		{
+			const BYTE* row = rows + (size_t)y * (rowBytes + 1) + 1;
+			if (!header.interlaced)
+			{
+				ExpandRow(row, width, header, palette, transparency, &image.rgba[(size_t)y * header.width * 4]);
+				continue;
+			}
+
+			ExpandRow(row, width, header, palette, transparency, &expanded[0]);
+			UINT targetY = Adam7Y[pass] + y * Adam7StepY[pass];
+			for (UINT x = 0; x < width; x++)
+			{
+				UINT targetX = Adam7X[pass] + x * Adam7StepX[pass];
+				memcpy(&image.rgba[((size_t)targetY * header.width + targetX) * 4], &expanded[x * 4], 4);
+			}
+		}
+		rows += (size_t)height * (rowBytes + 1);
+	}
+
+	decodes++;
+	inflateTicks += inflated;
+	decodeTicks += Profiler::Now() - start;
+	return true;
+}
@@ -0,0 +1,47 @@
+//
+// Portable PNG decoder, produces 8 bit RGBA without going through WIC
+// Reads every color type and bit depth in the spec, including Adam7 interlacing
+//
+
+#ifndef PNGDECODER_H
+#define PNGDECODER_H
+
+#include <atomic>
+#include "ImageDecoder.h"
+
+/// <summary>Successful decodes since the decoder was made and the profiler ticks they took, inflating included
+/// </summary>
+struct PNGDecodeStats
+{
+	UINT64 decodes;
+	INT64 decodeTicks;
+	INT64 inflateTicks;
+};
+
+class PNGDecoder : public ImageDecoder
+{
+public:
+	PNGDecoder();
+
+	bool CanDecode(const BYTE* data, size_t size) const;
+
+	bool Decode(const BYTE* data, size_t size, ImageData& image) const;
+
+	const char* GetName() const;
+
+	/// <summary>Inflates a zlib stream that decompresses to exactly size bytes, checking its Adler-32
+	/// </summary>
+	static bool Inflate(const BYTE* data, size_t length, BYTE* out, size_t size);
+
+	PNGDecodeStats GetStats() const;
+private:
+	PNGDecoder(const PNGDecoder&);
+	PNGDecoder& operator=(const PNGDecoder&);
+
+	// Streaming workers share one decoder, so these are added to without a lock
+	mutable std::atomic<UINT64> decodes;
+	mutable std::atomic<INT64> decodeTicks;
+	mutable std::atomic<INT64> inflateTicks;
+};
+
+#endif
@@ -0,0 +1,330 @@
+//
+// Portable PNG encoder for 8 bit RGBA, used to write software rendered frames
+// Each row gets the filter with the smallest residuals, the result is deflated with LZ77 and the fixed Huffman codes
+//
+
+#include "PNGEncoder.h"
+
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+static const BYTE PNGSignature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+
+static void WriteBigEndian(UINT value, std::vector<BYTE>& out)
+{
+	out.push_back((BYTE)(value >> 24));
+	out.push_back((BYTE)(value >> 16));
+	out.push_back((BYTE)(value >> 8));
+	out.push_back((BYTE)value);
+}
+
+static UINT Crc32(const BYTE* data, size_t size)
+{
+	static UINT table[256];
+	static bool tableBuilt = false;
+	if (!tableBuilt)
+	{
+		for (UINT n = 0; n < 256; n++)
+		{
+			UINT c = n;
+			for (int k = 0; k < 8; k++)
+				c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+			table[n] = c;
+		}
+		tableBuilt = true;
+	}
+
+	UINT crc = 0xFFFFFFFF;
+	for (size_t i = 0; i < size; i++)
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return crc ^ 0xFFFFFFFF;
+}
+
+static UINT Adler32(const BYTE* data, size_t size)
+{
+	UINT a = 1;
+	UINT b = 0;
+	while (size > 0)
+	{
+		// Largest run that can't overflow b before taking the modulus
+		size_t run = min(size, (size_t)5552);
+		for (size_t i = 0; i < run; i++)
+		{
+			a += data[i];
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+		data += run;
+		size -= run;
+	}
+	return (b << 16) | a;
+}
+
+static void WriteChunk(const char* type, const BYTE* data, size_t size, std::vector<BYTE>& out)
+{
+	WriteBigEndian((UINT)size, out);
+	size_t start = out.size();
+	out.insert(out.end(), type, type + 4);
+	if (size > 0)
+		out.insert(out.end(), data, data + size);
+	WriteBigEndian(Crc32(&out[start], size + 4), out);
+}
+
+///
+// Deflate
+///
+static const USHORT LengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const BYTE LengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const USHORT DistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+	4097, 6145, 8193, 12289, 16385, 24577 };
+static const BYTE DistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+static const UINT WindowSize = 32768;
+static const UINT MinMatch = 3;
+static const UINT MaxMatch = 258;
+static const UINT HashBits = 15;
+static const UINT MaxChain = 32;	// Candidates tried per position, more compresses a little better and runs slower
+
+/// <summary>Writes least significant bit first, Huffman codes are reversed before they go in
+/// </summary>
+struct BitWriter
+{
+	BitWriter(std::vector<BYTE>& _out) :
+	out(_out),
+	bits(0),
+	count(0)
+	{
+
+	}
+
+	void Write(UINT value, UINT length)
+	{
+		bits |= (UINT64)value << count;
+		count += length;
+		while (count >= 8)
+		{
+			out.push_back((BYTE)bits);
+			bits >>= 8;
+			count -= 8;
+		}
+	}
+
+	void WriteCode(UINT code, UINT length)
+	{
+		UINT reversed = 0;
+		for (UINT i = 0; i < length; i++)
+		{
+			reversed = (reversed << 1) | (code & 1);
+			code >>= 1;
+		}
+		Write(reversed, length);
+	}
+
+	void Flush()
+	{
+		if (count > 0)
+			out.push_back((BYTE)bits);
+		bits = 0;
+		count = 0;
+	}
+
+	std::vector<BYTE>& out;
+	UINT64 bits;
+	UINT count;
+};
+
+/// <summary>Fixed literal/length code from the deflate spec
+/// </summary>
+static void WriteLiteral(BitWriter& writer, UINT symbol)
+{
+	if (symbol < 144)
+		writer.WriteCode(0x30 + symbol, 8);
+	else if (symbol < 256)
+		writer.WriteCode(0x190 + symbol - 144, 9);
+	else if (symbol < 280)
+		writer.WriteCode(symbol - 256, 7);
+	else
+		writer.WriteCode(0xC0 + symbol - 280, 8);
+}
+
+static void WriteMatch(BitWriter& writer, UINT length, UINT distance)
+{
+	UINT lengthCode = 28;
+	while (LengthBase[lengthCode] > length)
+		lengthCode--;
+	WriteLiteral(writer, 257 + lengthCode);
+	writer.Write(length - LengthBase[lengthCode], LengthExtra[lengthCode]);
+
+	UINT distanceCode = 29;
+	while (DistanceBase[distanceCode] > distance)
+		distanceCode--;
+	writer.WriteCode(distanceCode, 5);
+	writer.Write(distance - DistanceBase[distanceCode], DistanceExtra[distanceCode]);
+}
+
+static UINT Hash(const BYTE* data)
+{
+	return ((data[0] << 16 | data[1] << 8 | data[2]) * 2654435761u) >> (32 - HashBits);
+}
+
+void PNGEncoder::Deflate(const BYTE* data, size_t size, std::vector<BYTE>& out)
+{
+	// zlib header, 32K window and no preset dictionary
+	out.push_back(0x78);
+	out.push_back(0x01);
+
+	// One final block with the fixed codes
+	BitWriter writer(out);
+	writer.Write(1, 1);
+	writer.Write(1, 2);
+
+	// Most recent position of each hash and, for each position in the window, the one before it with the same hash
+	std::vector<int> head(1 << HashBits, -1);
+	std::vector<int> previous(WindowSize, -1);
+
+	size_t i = 0;
+	while (i < size)
+	{
+		UINT bestLength = 0;
+		UINT bestDistance = 0;
+		if (i + MinMatch <= size)
+		{
+			UINT hash = Hash(data + i);
+			UINT limit = (UINT)min(size - i, (size_t)MaxMatch);
+			int candidate = head[hash];
+			for (UINT chain = 0; chain < MaxChain && candidate >= 0 && i - candidate <= WindowSize; chain++)
+			{
+				UINT length = 0;
+				while (length < limit && data[candidate + length] == data[i + length])
+					length++;
+				if (length > bestLength)
+				{
+					bestLength = length;
+					bestDistance = (UINT)(i - candidate);
+					if (length == limit)
+						break;
+				}
+				candidate = previous[candidate % WindowSize];
+			}
+		}
+
+		UINT advance = 1;
+		if (bestLength >= MinMatch)
+		{
+			WriteMatch(writer, bestLength, bestDistance);
+			advance = bestLength;
+		}
+		else
+		{
+			WriteLiteral(writer, data[i]);
+		}
+
+		// Every position covered goes in the hash chains
+		for (UINT k = 0; k < advance; k++, i++)
+		{
+			if (i + MinMatch > size)
+				continue;
+			UINT hash = Hash(data + i);
+			previous[i % WindowSize] = head[hash];
+			head[hash] = (int)i;
+		}
+	}
+
+	WriteLiteral(writer, 256);
+	writer.Flush();
+	WriteBigEndian(Adler32(data, size), out);
+}
+
+static BYTE Paeth(BYTE left, BYTE up, BYTE upLeft)
+{
+	int estimate = left + up - upLeft;
+	int distanceLeft = abs(estimate - left);
+	int distanceUp = abs(estimate - up);
+	int distanceUpLeft = abs(estimate - upLeft);
+	if (distanceLeft <= distanceUp && distanceLeft <= distanceUpLeft)
+		return left;
+	return distanceUp <= distanceUpLeft ? up : upLeft;
+}
+
+/// <summary>Filters a row with one of the five PNG filters, out holds rowBytes residuals
+/// </summary>
+static void FilterRow(const BYTE* row, const BYTE* prior, UINT rowBytes, UINT stride, BYTE filter, BYTE* out)
+{
+	for (UINT i = 0; i < rowBytes; i++)
+	{
+		BYTE left = i >= stride ? row[i - stride] : 0;
+		BYTE upLeft = i >= stride ? prior[i - stride] : 0;
+		BYTE predicted = 0;
+		switch (filter)
+		{
+		case 1: predicted = left; break;
+		case 2: predicted = prior[i]; break;
+		case 3: predicted = (BYTE)((left + prior[i]) >> 1); break;
+		case 4: predicted = Paeth(left, prior[i], upLeft); break;
+		}
+		out[i] = (BYTE)(row[i] - predicted);
+	}
+}
+
+void PNGEncoder::Encode(const ImageData& image, std::vector<BYTE>& png)
+{
+	png.assign(PNGSignature, PNGSignature + 8);
+
+	// 8 bit RGBA, no interlacing
+	std::vector<BYTE> header;
+	WriteBigEndian(image.width, header);
+	WriteBigEndian(image.height, header);
+	header.push_back(8);
+	header.push_back(6);
+	header.push_back(0);
+	header.push_back(0);
+	header.push_back(0);
+	WriteChunk("IHDR", &header[0], header.size(), png);
+
+	// Each row takes the filter whose residuals sum smallest as signed bytes, the usual heuristic
+	UINT rowBytes = image.width * 4;
+	std::vector<BYTE> filtered((size_t)(rowBytes + 1) * image.height);
+	std::vector<BYTE> zeros(rowBytes, 0);
+	std::vector<BYTE> candidate(rowBytes);
+	for (UINT y = 0; y < image.height; y++)
+	{
+		const BYTE* row = &image.rgba[(size_t)y * rowBytes];
+		const BYTE* prior = y > 0 ? row - rowBytes : &zeros[0];
+		BYTE* out = &filtered[(size_t)y * (rowBytes + 1)];
+
+		UINT bestCost = UINT_MAX;
+		for (BYTE filter = 0; filter < 5; filter++)
+		{
+			FilterRow(row, prior, rowBytes, 4, filter, &candidate[0]);
+			UINT cost = 0;
+			for (UINT i = 0; i < rowBytes; i++)
+				cost += abs((signed char)candidate[i]);
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				out[0] = filter;
+				memcpy(out + 1, &candidate[0], rowBytes);
+			}
+		}
+	}
+
+	std::vector<BYTE> compressed;
+	Deflate(filtered.empty() ? NULL : &filtered[0], filtered.size(), compressed);
+	WriteChunk("IDAT", &compressed[0], compressed.size(), png);
+	WriteChunk("IEND", NULL, 0, png);
+}
+
+bool PNGEncoder::WriteFile(const std::string& path, const ImageData& image)
+{
+	std::vector<BYTE> png;
+	Encode(image, png);
+
+	std::ofstream file(path.c_str(), std::ios::binary);
+	if (!file)
+		return false;
+	file.write((const char*)&png[0], png.size());
+	return file.good();
+}
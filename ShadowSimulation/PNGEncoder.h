@@ -0,0 +1,26 @@
+//
+// Portable PNG encoder for 8 bit RGBA, used to write software rendered frames
+// Each row gets the filter with the smallest residuals, the result is deflated with LZ77 and the fixed Huffman codes
+//
+
+#ifndef PNGENCODER_H
+#define PNGENCODER_H
+
+#include <string>
+#include <vector>
+
+#include "ImageDecoder.h"
+
+class PNGEncoder
+{
+public:
+	static void Encode(const ImageData& image, std::vector<BYTE>& png);
+
+	static bool WriteFile(const std::string& path, const ImageData& image);
+
+	/// <summary>Compresses data to a zlib stream, the inverse of PNGDecoder::Inflate
+	/// </summary>
+	static void Deflate(const BYTE* data, size_t size, std::vector<BYTE>& out);
+};
+
+#endif
@@ -0,0 +1,3 @@
+// PixelNoNormal reading its textures from the atlas texture array
+#define TEXTURE_ARRAY 1
+#include "PixelNoNormal.hlsl"
@@ -0,0 +1,124 @@
+//
+// Character poses sampled, blended and skinned across worker threads
+//
+
+#include "PoseEvaluator.h"
+
+#include <cmath>
+
+#include "Profiler.h"
+
+// Characters a job evaluates, enough that taking a job costs nothing next to it
+static const UINT CharacterBatch = 16;
+
+PoseEvaluator::PoseEvaluator()
+{
+
+}
+
+bool PoseEvaluator::Load(const Skeleton& _skeleton, const std::vector<RawClip>& rawClips, UINT workerCount)
+{
+	PROFILE_ZONE("PoseEvaluator::Load");
+	if (rawClips.empty() || _skeleton.GetJointCount() == 0 || _skeleton.GetJointCount() > MaxSkinJoints)
+		return false;
+
+	skeleton = _skeleton;
+	stats = AnimationStats();
+	stats.characters = (UINT)characters.size();
+	stats.joints = skeleton.GetJointCount();
+	stats.clips = (UINT)rawClips.size();
+	clips.resize(rawClips.size());
+	for (size_t i = 0; i < rawClips.size(); i++)
+	{
+		clips[i].Compress(rawClips[i], skeleton);
+		const ClipCompressionStats& clipStats = clips[i].GetStats();
+		stats.rawKeys += clipStats.rawKeys;
+		stats.keptKeys += clipStats.keptKeys;
+		stats.rawBytes += clipStats.rawBytes;
+		stats.clipBytes += clipStats.bytes;
+	}
+
+	jobPool.Start(workerCount);
+	slotScratch.resize(jobPool.GetWorkerCount() + 1);
+	return true;
+}
+
+void PoseEvaluator::AddCharacter(const AnimatedCharacter& character)
+{
+	characters.push_back(character);
+	stats.characters = (UINT)characters.size();
+}
+
+UINT PoseEvaluator::GetCharacterCount() const { return (UINT)characters.size(); }
+const AnimatedCharacter& PoseEvaluator::GetCharacter(UINT i) const { return characters[i]; }
+const SkinMatrix* PoseEvaluator::GetPalette(UINT character) const { return &palettes[character * skeleton.GetJointCount()]; }
+UINT PoseEvaluator::GetJointCount() const { return skeleton.GetJointCount(); }
+const AnimationStats& PoseEvaluator::GetStats() const { return stats; }
+
+///
+// Evaluation
+///
+void PoseEvaluator::Evaluate(float time)
+{
+	PROFILE_ZONE("PoseEvaluator::Evaluate");
+	UINT count = (UINT)characters.size();
+	if (count == 0 || clips.empty())
+		return;
+
+	palettes.resize(count * skeleton.GetJointCount());
+	jobPool.Run((count + CharacterBatch - 1) / CharacterBatch, [this, count, time](UINT job, UINT slot)
+	{
+		Scratch& scratch = slotScratch[slot];
+		UINT end = min((job + 1) * CharacterBatch, count);
+		for (UINT i = job * CharacterBatch; i < end; i++)
+			EvaluateCharacter(i, time, scratch);
+	});
+}
+
+void PoseEvaluator::EvaluateCharacter(UINT i, float time, Scratch& scratch)
+{
+	const AnimatedCharacter& character = characters[i];
+	float local = time * character.speed + character.phase;
+	clips[i % clips.size()].Sample(local, scratch.first);
+	if (clips.size() > 1 && character.blendPeriod > 0.0f)
+	{
+		float weight = 0.5f - 0.5f * std::cos(2.0f * PI * local / character.blendPeriod);
+		clips[(i + 1) % clips.size()].Sample(local, scratch.second);
+		Skinning::Blend(scratch.first, scratch.second, weight, scratch.first);
+	}
+	Skinning::BuildPalette(skeleton, scratch.first, scratch.skinning, &palettes[i * skeleton.GetJointCount()]);
+}
+
+///
+// CPU skinning
+///
+void PoseEvaluator::SkinVerticesInto(const Vertex* vertices, const SkinInfluences* influences, UINT vertexCount, Vertex* out)
+{
+	UINT count = (UINT)characters.size();
+	UINT jointCount = skeleton.GetJointCount();
+	if (count == 0 || palettes.empty())
+		return;
+
+	jobPool.Run((count + CharacterBatch - 1) / CharacterBatch, [this, count, jointCount, vertices, influences, vertexCount, out](UINT job, UINT slot)
+	{
+		Scratch& scratch = slotScratch[slot];
+		scratch.worldPalette.resize(jointCount);
+		UINT end = min((job + 1) * CharacterBatch, count);
+		for (UINT i = job * CharacterBatch; i < end; i++)
+		{
+			// Palette entries are transposed, so the world matrix goes in front to be applied after them
+			XMMATRIX world = XMMatrixTranspose(XMLoadFloat4x4(&characters[i].world));
+			const SkinMatrix* palette = GetPalette(i);
+			for (UINT j = 0; j < jointCount; j++)
+			{
+				XMMATRIX skin(XMLoadFloat4(&palette[j].rows[0]), XMLoadFloat4(&palette[j].rows[1]), XMLoadFloat4(&palette[j].rows[2]),
+					XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f));
+				skin = XMMatrixMultiply(world, skin);
+				XMStoreFloat4(&scratch.worldPalette[j].rows[0], skin.r[0]);
+				XMStoreFloat4(&scratch.worldPalette[j].rows[1], skin.r[1]);
+				XMStoreFloat4(&scratch.worldPalette[j].rows[2], skin.r[2]);
+			}
+			Skinning::SkinVertices(vertices, influences, vertexCount, &scratch.worldPalette[0], out + i * vertexCount);
+		}
+	});
+}
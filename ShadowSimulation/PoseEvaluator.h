@@ -0,0 +1,94 @@
+//
+// Poses of many characters each playing two compressed clips blended together, turned into matrix palettes every frame
+// Characters are split into batches among worker threads that wait between frames, each thread sampling into poses of
+// its own. Nothing here touches the device, AnimationSystem uploads and draws what it builds
+//
+
+#ifndef POSEEVALUATOR_H
+#define POSEEVALUATOR_H
+
+#include <vector>
+
+#include "AnimationClip.h"
+#include "JobPool.h"
+
+struct AnimatedCharacter
+{
+	XMFLOAT4X4 world;
+	float phase;		// Seconds into its clips at time 0
+	float speed;		// Playback rate
+	float blendPeriod;	// Seconds to blend from its first clip to its second and back
+};
+
+struct AnimationStats
+{
+	AnimationStats() : characters(0), joints(0), clips(0), rawKeys(0), keptKeys(0), rawBytes(0), clipBytes(0) {}
+
+	UINT characters;
+	UINT joints;		// Per character
+	UINT clips;
+	UINT rawKeys;		// Keys of every clip resampled, before and after compression
+	UINT keptKeys;
+	UINT rawBytes;
+	UINT clipBytes;
+};
+
+class PoseEvaluator
+{
+public:
+	PoseEvaluator();
+
+	/// <summary>Compresses the clips of skeleton and starts workerCount workers besides the thread calling Evaluate
+	/// Returns false if there are no clips, no joints or more joints than MaxSkinJoints
+	/// </summary>
+	bool Load(const Skeleton& skeleton, const std::vector<RawClip>& clips, UINT workerCount);
+
+	/// <summary>Each character plays clip i and i + 1, i being its index
+	/// </summary>
+	void AddCharacter(const AnimatedCharacter& character);
+
+	UINT GetCharacterCount() const;
+	const AnimatedCharacter& GetCharacter(UINT i) const;
+
+	/// <summary>Samples and blends every character's clips at time and builds their palettes
+	/// </summary>
+	void Evaluate(float time);
+
+	/// <summary>GetJointCount() entries taking the mesh into the character's posed model space
+	/// </summary>
+	const SkinMatrix* GetPalette(UINT character) const;
+
+	/// <summary>Skins a copy of the bind pose mesh for every character into out after Evaluate, in world space
+	/// out needs room for vertexCount vertices per character
+	/// </summary>
+	void SkinVerticesInto(const Vertex* vertices, const SkinInfluences* influences, UINT vertexCount, Vertex* out);
+
+	UINT GetJointCount() const;
+	const AnimationStats& GetStats() const;
+private:
+	PoseEvaluator(const PoseEvaluator&);
+	PoseEvaluator& operator=(const PoseEvaluator&);
+
+	/// <summary>What a thread needs to evaluate characters, kept between frames
+	/// </summary>
+	struct Scratch
+	{
+		Pose first;
+		Pose second;
+		SkinningScratch skinning;
+		std::vector<SkinMatrix> worldPalette;
+	};
+
+	void EvaluateCharacter(UINT i, float time, Scratch& scratch);
+
+	Skeleton skeleton;
+	std::vector<AnimationClip> clips;
+	std::vector<AnimatedCharacter> characters;
+	std::vector<SkinMatrix> palettes;			// jointCount per character
+	AnimationStats stats;
+
+	JobPool jobPool;
+	std::vector<Scratch> slotScratch;
+};
+
+#endif
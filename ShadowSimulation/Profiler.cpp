@@ -0,0 +1,342 @@
+//
+// Lightweight hierarchical CPU profiler
+// Wrap a scope in PROFILE_ZONE("Name") to time it, PROFILE_COUNTER("Name", value) to track a number
+// Every thread records into its own fixed size ring buffer, so recording never takes a lock
+// Call WriteChromeTrace to view the capture in chrome://tracing, or WriteCapture for a compact binary file
+//
+
+#include "Profiler.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The time stamp counter is far cheaper to read than the OS clock, use it where available
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define PROFILER_USE_TSC
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+struct ProfilerThread
+{
+	UINT id;
+	std::vector<ProfileEvent> events;
+	UINT64 mask;	// Capacity is a power of two, so wrapping the ring is a mask rather than a divide
+	std::atomic<UINT64> written;
+
+	UINT depth;
+	UINT frame;
+	UINT frameEvents;
+};
+
+// Shared state, only touched when a thread registers or a capture is written
+static std::mutex threadsMutex;
+static std::vector<ProfilerThread*> threads;
+
+static std::atomic<bool> enabled(true);
+static std::atomic<UINT> frameIndex(0);
+static std::atomic<UINT64> droppedEvents(0);
+static UINT eventBudget = 4096;
+static UINT depthBudget = 16;
+static UINT threadCapacity = 1 << 16;
+
+PROFILER_THREAD_LOCAL ProfilerThread* Profiler::threadData = 0;
+
+void Profiler::SetEnabled(bool _enabled) { enabled = _enabled; }
+bool Profiler::IsEnabled() { return enabled; }
+void Profiler::BeginFrame() { frameIndex.fetch_add(1, std::memory_order_relaxed); }
+UINT64 Profiler::GetDroppedEvents() { return droppedEvents; }
+
+void Profiler::SetBudget(UINT eventsPerThreadPerFrame, UINT maxDepth)
+{
+	eventBudget = eventsPerThreadPerFrame;
+	depthBudget = maxDepth;
+}
+
+void Profiler::SetThreadCapacity(UINT events)
+{
+	threadCapacity = 1;
+	while (threadCapacity < events && threadCapacity < 0x80000000)
+		threadCapacity <<= 1;
+}
+
+static INT64 ClockNanoseconds()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#ifdef PROFILER_USE_TSC
+// Reference points for converting TSC ticks to time, taken when the program starts
+static const INT64 tscStart = (INT64)__rdtsc();
+static const INT64 clockStart = ClockNanoseconds();
+
+// Shortest span the TSC rate is measured over, the steady clock's own jitter swamps anything shorter
+static const INT64 MinCalibrationNanoseconds = 50000000;
+
+static std::once_flag tscCalibrated;
+static double microsecondsPerTick = 0.0;
+
+static void CalibrateTsc()
+{
+	// Measure the TSC rate against the steady clock over the whole run so far, waiting out a run that's barely started
+	INT64 elapsed = ClockNanoseconds() - clockStart;
+	if (elapsed < MinCalibrationNanoseconds)
+		std::this_thread::sleep_for(std::chrono::nanoseconds(MinCalibrationNanoseconds - elapsed));
+
+	INT64 elapsedTicks = (INT64)__rdtsc() - tscStart;
+	INT64 elapsedNanoseconds = ClockNanoseconds() - clockStart;
+	if (elapsedTicks > 0)
+		microsecondsPerTick = (double)elapsedNanoseconds / 1000.0 / elapsedTicks;
+}
+
+INT64 Profiler::Now()
+{
+	return (INT64)__rdtsc();
+}
+
+double Profiler::TicksToMicroseconds(INT64 ticks)
+{
+	// Calibrated once, so every timestamp in a capture converts at the same rate whichever thread asks first
+	std::call_once(tscCalibrated, CalibrateTsc);
+	return ticks * microsecondsPerTick;
+}
+#else
+INT64 Profiler::Now()
+{
+	return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+double Profiler::TicksToMicroseconds(INT64 ticks)
+{
+	typedef std::chrono::steady_clock::period period;
+	return (double)ticks * 1000000.0 * period::num / period::den;
+}
+#endif
+
+ProfilerThread* Profiler::RegisterThread()
+{
+	ProfilerThread* thread = new ProfilerThread();
+	thread->events.resize(threadCapacity);
+	thread->mask = threadCapacity - 1;
+	thread->written = 0;
+	thread->depth = 0;
+	thread->frame = 0;
+	thread->frameEvents = 0;
+
+	std::lock_guard<std::mutex> lock(threadsMutex);
+	thread->id = (UINT)threads.size();
+	threads.push_back(thread);
+	threadData = thread;
+	return thread;
+}
+
+inline ProfilerThread* Profiler::GetThread()
+{
+	// Registering is the rare path, kept out of line so the check inlines into every zone
+	ProfilerThread* thread = threadData;
+	return thread ? thread : RegisterThread();
+}
+
+inline bool Profiler::BeginEvent(ProfilerThread* thread)
+{
+	UINT frame = frameIndex.load(std::memory_order_relaxed);
+	if (thread->frame != frame)
+	{
+		thread->frame = frame;
+		thread->frameEvents = 0;
+	}
+
+	if (thread->frameEvents >= eventBudget || thread->depth >= depthBudget)
+	{
+		droppedEvents.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	thread->frameEvents++;
+	return true;
+}
+
+inline void Profiler::Record(ProfilerThread* thread, const ProfileEvent& e)
+{
+	UINT64 index = thread->written.load(std::memory_order_relaxed);
+	thread->events[(size_t)(index & thread->mask)] = e;
+	thread->written.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::Counter(const char* name, float value)
+{
+	if (!enabled)
+		return;
+
+	ProfilerThread* thread = GetThread();
+	if (!BeginEvent(thread))
+		return;
+
+	ProfileEvent e;
+	e.name = name;
+	e.start = e.end = Now();
+	e.value = value;
+	e.depth = (WORD)thread->depth;
+	e.type = CounterEvent;
+	Record(thread, e);
+}
+
+ProfileZone::ProfileZone(const char* name) :
+thread(0),
+name(name),
+start(0),
+recording(false)
+{
+	if (!Profiler::IsEnabled())
+		return;
+
+	thread = Profiler::GetThread();
+	recording = Profiler::BeginEvent(thread);
+	if (recording)
+	{
+		thread->depth++;
+		start = Profiler::Now();
+	}
+}
+
+ProfileZone::~ProfileZone()
+{
+	if (!recording)
+		return;
+
+	ProfileEvent e;
+	e.name = name;
+	e.start = start;
+	e.end = Profiler::Now();
+	e.value = 0.0f;
+	e.depth = (WORD)(--thread->depth);
+	e.type = ZoneEvent;
+	Profiler::Record(thread, e);
+}
+
+// Calls visit(threadId, event) for every event still held in the ring buffers, oldest first
+template <typename Visitor>
+static void ForEachEvent(Visitor visit)
+{
+	std::lock_guard<std::mutex> lock(threadsMutex);
+	for (ProfilerThread* thread : threads)
+	{
+		UINT64 written = thread->written.load(std::memory_order_acquire);
+		UINT64 capacity = thread->events.size();
+		UINT64 first = written > capacity ? written - capacity : 0;
+		for (UINT64 i = first; i < written; i++)
+		{
+			visit(thread->id, thread->events[(size_t)(i & thread->mask)]);
+		}
+	}
+}
+
+static void WriteJsonString(std::ofstream& file, const char* str)
+{
+	file << '"';
+	for (const char* c = str; *c; c++)
+	{
+		if (*c == '"' || *c == '\\')
+			file << '\\';
+		file << *c;
+	}
+	file << '"';
+}
+
+bool Profiler::WriteChromeTrace(const char* filepath)
+{
+	std::ofstream file(filepath);
+	if (!file)
+		return false;
+
+	file << std::fixed << std::setprecision(3);
+	file << "{\"traceEvents\":[\n";
+	bool first = true;
+	ForEachEvent([&](UINT threadId, const ProfileEvent& e)
+	{
+		if (!first)
+			file << ",\n";
+		first = false;
+
+		file << "{\"name\":";
+		WriteJsonString(file, e.name);
+		file << ",\"pid\":0,\"tid\":" << threadId << ",\"ts\":" << TicksToMicroseconds(e.start);
+		if (e.type == ZoneEvent)
+			file << ",\"ph\":\"X\",\"dur\":" << TicksToMicroseconds(e.end - e.start) << "}";
+		else
+			file << ",\"ph\":\"C\",\"args\":{\"value\":" << e.value << "}}";
+	});
+	file << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":" << GetDroppedEvents() << "}}\n";
+
+	return file.good();
+}
+
+template <typename T>
+static void WriteValue(std::ofstream& file, const T& value)
+{
+	file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+//
+// Binary capture layout (little endian)
+// char[4] "SSPF", UINT version, double microsecondsPerTick
+// UINT nameCount, then per name: WORD length, chars
+// UINT eventCount, then per event: UINT thread, UINT name, INT64 start, INT64 end, float value, WORD depth, WORD type
+//
+bool Profiler::WriteCapture(const char* filepath)
+{
+	std::ofstream file(filepath, std::ios::binary);
+	if (!file)
+		return false;
+
+	// Name pointers are unique per literal, so map them to a compact string table
+	std::map<const char*, UINT> nameIds;
+	std::vector<const char*> names;
+	UINT eventCount = 0;
+	ForEachEvent([&](UINT threadId, const ProfileEvent& e)
+	{
+		if (nameIds.find(e.name) == nameIds.end())
+		{
+			nameIds[e.name] = (UINT)names.size();
+			names.push_back(e.name);
+		}
+		eventCount++;
+	});
+
+	file.write("SSPF", 4);
+	WriteValue(file, (UINT)1);
+	WriteValue(file, TicksToMicroseconds(1));
+
+	WriteValue(file, (UINT)names.size());
+	for (const char* name : names)
+	{
+		WORD length = (WORD)strlen(name);
+		WriteValue(file, length);
+		file.write(name, length);
+	}
+
+	WriteValue(file, eventCount);
+	ForEachEvent([&](UINT threadId, const ProfileEvent& e)
+	{
+		WriteValue(file, threadId);
+		WriteValue(file, nameIds[e.name]);
+		WriteValue(file, e.start);
+		WriteValue(file, e.end);
+		WriteValue(file, e.value);
+		WriteValue(file, e.depth);
+		WriteValue(file, e.type);
+	});
+
+	return file.good();
+}
@@ -0,0 +1,117 @@
+//
+// Lightweight hierarchical CPU profiler
+// Wrap a scope in PROFILE_ZONE("Name") to time it, PROFILE_COUNTER("Name", value) to track a number
+// Every thread records into its own fixed size ring buffer, so recording never takes a lock
+// Call WriteChromeTrace to view the capture in chrome://tracing, or WriteCapture for a compact binary file
+//
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Windows.h>
+
+#if defined(_MSC_VER)
+#define PROFILER_THREAD_LOCAL __declspec(thread)
+#else
+#define PROFILER_THREAD_LOCAL thread_local
+#endif
+
+enum ProfileEventType
+{
+	ZoneEvent,
+	CounterEvent
+};
+
+struct ProfileEvent
+{
+	const char* name;	// Must outlive the profiler, string literals only
+	INT64 start;
+	INT64 end;
+	float value;
+	WORD depth;
+	WORD type;
+};
+
+struct ProfilerThread;
+
+class Profiler
+{
+public:
+	/// <summary>Turns recording on or off for every thread
+	/// </summary>
+	static void SetEnabled(bool enabled);
+	static bool IsEnabled();
+
+	/// <summary>Marks the start of a new frame. Per frame budgets are reset here
+	/// </summary>
+	static void BeginFrame();
+
+	/// <summary>Limits how many events each thread may record per frame and how deep zones may nest
+	/// Anything over budget is dropped and counted, keeping profiling cost bounded
+	/// </summary>
+	static void SetBudget(UINT eventsPerThreadPerFrame, UINT maxDepth);
+
+	/// <summary>Sets how many events each thread's ring buffer holds, rounded up to a power of two
+	/// Only affects threads that record after the call
+	/// </summary>
+	static void SetThreadCapacity(UINT events);
+
+	/// <summary>Records a named value at the current time
+	/// </summary>
+	static void Counter(const char* name, float value);
+
+	/// <summary>Returns the current timestamp in profiler ticks (steady clock, monotonic)
+	/// </summary>
+	static INT64 Now();
+
+	/// <summary>Converts profiler ticks to microseconds
+	/// The tick rate is measured once, on the first call, which waits until the program has run long enough to measure it
+	/// </summary>
+	static double TicksToMicroseconds(INT64 ticks);
+
+	/// <summary>Number of events thrown away because a thread went over budget
+	/// </summary>
+	static UINT64 GetDroppedEvents();
+
+	/// <summary>Writes every recorded event as Chrome trace JSON
+	/// Only call once every other thread that records has been joined, events are read without a lock
+	/// </summary>
+	static bool WriteChromeTrace(const char* filepath);
+
+	/// <summary>Writes every recorded event as a compact binary capture, with the same restriction as WriteChromeTrace
+	/// </summary>
+	static bool WriteCapture(const char* filepath);
+private:
+	friend class ProfileZone;
+
+	static ProfilerThread* GetThread();
+	static ProfilerThread* RegisterThread();
+	static bool BeginEvent(ProfilerThread* thread);
+	static void Record(ProfilerThread* thread, const ProfileEvent& e);
+
+	static PROFILER_THREAD_LOCAL ProfilerThread* threadData;
+};
+
+class ProfileZone
+{
+public:
+	ProfileZone(const char* name);
+	~ProfileZone();
+private:
+	ProfilerThread* thread;
+	const char* name;
+	INT64 start;
+	bool recording;
+};
+
+#ifndef DISABLE_PROFILER
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_COUNTER(name, value) Profiler::Counter(name, (float)(value))
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_COUNTER(name, value)
+#endif
+
+#endif
@@ -0,0 +1,353 @@
+//
+// Hands out ranges of a fixed size space, like vertices and indices of a shared buffer
+//
+
+#include "RangeAllocator.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+
+static UINT HighestBit(UINT value)
+{
+	unsigned long index;
+	_BitScanReverse(&index, value);
+	return index;
+}
+
+static UINT LowestBit(UINT value)
+{
+	unsigned long index;
+	_BitScanForward(&index, value);
+	return index;
+}
+#else
+static UINT HighestBit(UINT value) { return 31 - __builtin_clz(value); }
+static UINT LowestBit(UINT value) { return __builtin_ctz(value); }
+#endif
+
+// Defined for callers that bind it to a reference
+const UINT RangeAllocator::Invalid;
+
+RangeAllocator::RangeAllocator(UINT _capacity)
+{
+	Reset(_capacity);
+}
+
+void RangeAllocator::Reset(UINT _capacity)
+{
+	blocks.clear();
+	unusedBlocks = Invalid;
+	firstBlock = Invalid;
+	lastBlock = Invalid;
+
+	firstLevelMap = 0;
+	for (UINT i = 0; i < FirstLevelCount; i++)
+	{
+		secondLevelMaps[i] = 0;
+		for (UINT j = 0; j < SecondLevelCount; j++)
+			freeLists[i][j] = Invalid;
+	}
+
+	capacity = 0;
+	used = 0;
+	allocations = 0;
+	freeRanges = 0;
+	Grow(_capacity);
+}
+
+UINT RangeAllocator::Allocate(UINT size)
+{
+	if (size == 0)
+		return Invalid;
+
+	UINT block = FindFree(size);
+	if (block == Invalid)
+		return Invalid;
+	RemoveFree(block);
+
+	// Whatever is left over goes back as a free range of its own
+	if (blocks[block].size > size)
+	{
+		UINT rest = NewBlock(blocks[block].offset + size, blocks[block].size - size);
+		blocks[rest].previous = block;
+		blocks[rest].next = blocks[block].next;
+		if (blocks[block].next != Invalid)
+			blocks[blocks[block].next].previous = rest;
+		else
+			lastBlock = rest;
+		blocks[block].next = rest;
+		blocks[block].size = size;
+		InsertFree(rest);
+	}
+
+	blocks[block].free = false;
+	used += size;
+	allocations++;
+	return block;
+}
+
+void RangeAllocator::Free(UINT range)
+{
+	if (range >= blocks.size() || blocks[range].free)
+		return;
+
+	used -= blocks[range].size;
+	allocations--;
+	blocks[range].free = true;
+
+	UINT next = blocks[range].next;
+	if (next != Invalid && blocks[next].free)
+	{
+		RemoveFree(next);
+		blocks[range].size += blocks[next].size;
+		blocks[range].next = blocks[next].next;
+		if (blocks[next].next != Invalid)
+			blocks[blocks[next].next].previous = range;
+		else
+			lastBlock = range;
+		DeleteBlock(next);
+	}
+
+	UINT previous = blocks[range].previous;
+	if (previous != Invalid && blocks[previous].free)
+	{
+		RemoveFree(previous);
+		blocks[previous].size += blocks[range].size;
+		blocks[previous].next = blocks[range].next;
+		if (blocks[range].next != Invalid)
+			blocks[blocks[range].next].previous = previous;
+		else
+			lastBlock = previous;
+		DeleteBlock(range);
+		range = previous;
+	}
+
+	InsertFree(range);
+}
+
+UINT RangeAllocator::GetOffset(UINT range) const { return blocks[range].offset; }
+UINT RangeAllocator::GetSize(UINT range) const { return blocks[range].size; }
+
+void RangeAllocator::Grow(UINT _capacity)
+{
+	if (_capacity <= capacity)
+		return;
+
+	UINT extra = _capacity - capacity;
+	if (lastBlock != Invalid && blocks[lastBlock].free)
+	{
+		RemoveFree(lastBlock);
+		blocks[lastBlock].size += extra;
+		InsertFree(lastBlock);
+	}
+	else
+	{
+		UINT block = NewBlock(capacity, extra);
+		blocks[block].previous = lastBlock;
+		if (lastBlock != Invalid)
+			blocks[lastBlock].next = block;
+		else
+			firstBlock = block;
+		lastBlock = block;
+		InsertFree(block);
+	}
+	capacity = _capacity;
+}
+
+void RangeAllocator::Compact(std::vector<RangeMove>& moves)
+{
+	// Free blocks are dropped and used ones relinked back to back, so the free lists start over
+	UINT cursor = 0;
+	UINT previousUsed = Invalid;
+	UINT block = firstBlock;
+	firstBlock = Invalid;
+	while (block != Invalid)
+	{
+		UINT next = blocks[block].next;
+		if (blocks[block].free)
+		{
+			DeleteBlock(block);
+			block = next;
+			continue;
+		}
+
+		Block& range = blocks[block];
+		if (range.offset != cursor)
+		{
+			RangeMove move = { block, range.offset, cursor, range.size };
+			moves.push_back(move);
+			range.offset = cursor;
+		}
+		range.previous = previousUsed;
+		if (previousUsed != Invalid)
+			blocks[previousUsed].next = block;
+		else
+			firstBlock = block;
+		previousUsed = block;
+		cursor += range.size;
+		block = next;
+	}
+	if (previousUsed != Invalid)
+		blocks[previousUsed].next = Invalid;
+	lastBlock = previousUsed;
+
+	firstLevelMap = 0;
+	for (UINT i = 0; i < FirstLevelCount; i++)
+	{
+		secondLevelMaps[i] = 0;
+		for (UINT j = 0; j < SecondLevelCount; j++)
+			freeLists[i][j] = Invalid;
+	}
+	freeRanges = 0;
+
+	if (cursor < capacity)
+	{
+		UINT tail = NewBlock(cursor, capacity - cursor);
+		blocks[tail].previous = lastBlock;
+		if (lastBlock != Invalid)
+			blocks[lastBlock].next = tail;
+		else
+			firstBlock = tail;
+		lastBlock = tail;
+		InsertFree(tail);
+	}
+}
+
+RangeAllocatorStats RangeAllocator::GetStats() const
+{
+	RangeAllocatorStats stats;
+	stats.capacity = capacity;
+	stats.used = used;
+	stats.allocations = allocations;
+	stats.freeRanges = freeRanges;
+
+	// The largest free range is in the highest class that has any
+	if (firstLevelMap)
+	{
+		UINT firstLevel = HighestBit(firstLevelMap);
+		UINT secondLevel = HighestBit(secondLevelMaps[firstLevel]);
+		for (UINT block = freeLists[firstLevel][secondLevel]; block != Invalid; block = blocks[block].nextFree)
+			stats.largestFree = max(stats.largestFree, blocks[block].size);
+	}
+	return stats;
+}
+
+UINT RangeAllocator::GetCapacity() const { return capacity; }
+
+void RangeAllocator::GetClass(UINT size, UINT& firstLevel, UINT& secondLevel)
+{
+	if (size < SecondLevelCount)
+	{
+		firstLevel = 0;
+		secondLevel = size;
+		return;
+	}
+
+	UINT bit = HighestBit(size);
+	firstLevel = bit - SecondLevelBits + 1;
+	secondLevel = (size >> (bit - SecondLevelBits)) - SecondLevelCount;
+}
+
+UINT RangeAllocator::NewBlock(UINT offset, UINT size)
+{
+	UINT block = unusedBlocks;
+	if (block != Invalid)
+		unusedBlocks = blocks[block].nextFree;
+	else
+	{
+		block = (UINT)blocks.size();
+		blocks.push_back(Block());
+	}
+
+	Block& created = blocks[block];
+	created.offset = offset;
+	created.size = size;
+	created.previous = Invalid;
+	created.next = Invalid;
+	created.previousFree = Invalid;
+	created.nextFree = Invalid;
+	created.free = true;
+	return block;
+}
+
+void RangeAllocator::DeleteBlock(UINT block)
+{
+	blocks[block].free = true;
+	blocks[block].nextFree = unusedBlocks;
+	unusedBlocks = block;
+}
+
+void RangeAllocator::InsertFree(UINT block)
+{
+	UINT firstLevel, secondLevel;
+	GetClass(blocks[block].size, firstLevel, secondLevel);
+
+	UINT& head = freeLists[firstLevel][secondLevel];
+	blocks[block].free = true;
+	blocks[block].previousFree = Invalid;
+	blocks[block].nextFree = head;
+	if (head != Invalid)
+		blocks[head].previousFree = block;
+	head = block;
+
+	firstLevelMap |= 1u << firstLevel;
+	secondLevelMaps[firstLevel] |= 1u << secondLevel;
+	freeRanges++;
+}
+
+void RangeAllocator::RemoveFree(UINT block)
+{
+	UINT firstLevel, secondLevel;
+	GetClass(blocks[block].size, firstLevel, secondLevel);
+
+	Block& removed = blocks[block];
+	if (removed.previousFree != Invalid)
+		blocks[removed.previousFree].nextFree = removed.nextFree;
+	else
+		freeLists[firstLevel][secondLevel] = removed.nextFree;
+	if (removed.nextFree != Invalid)
+		blocks[removed.nextFree].previousFree = removed.previousFree;
+
+	if (freeLists[firstLevel][secondLevel] == Invalid)
+	{
+		secondLevelMaps[firstLevel] &= ~(1u << secondLevel);
+		if (!secondLevelMaps[firstLevel])
+			firstLevelMap &= ~(1u << firstLevel);
+	}
+	freeRanges--;
+}
+
+UINT RangeAllocator::FindFree(UINT size) const
+{
+	// Rounded up to the next class, so every block in the class found is large enough
+	UINT64 rounded = size;
+	if (size >= SecondLevelCount)
+		rounded += (1u << (HighestBit(size) - SecondLevelBits)) - 1;
+
+	UINT firstLevel, secondLevel;
+	if (rounded <= 0xFFFFFFFF)
+	{
+		GetClass((UINT)rounded, firstLevel, secondLevel);
+		UINT secondLevelMap = secondLevelMaps[firstLevel] & (~0u << secondLevel);
+		if (!secondLevelMap && firstLevel + 1 < FirstLevelCount)
+		{
+			UINT firstLevelLarger = firstLevelMap & (~0u << (firstLevel + 1));
+			if (firstLevelLarger)
+			{
+				firstLevel = LowestBit(firstLevelLarger);
+				secondLevelMap = secondLevelMaps[firstLevel];
+			}
+		}
+		if (secondLevelMap)
+			return freeLists[firstLevel][LowestBit(secondLevelMap)];
+	}
+
+	// Nothing in the larger classes, a block in size's own class may still fit, as when filling the space exactly
+	GetClass(size, firstLevel, secondLevel);
+	for (UINT block = freeLists[firstLevel][secondLevel]; block != Invalid; block = blocks[block].nextFree)
+	{
+		if (blocks[block].size >= size)
+			return block;
+	}
+	return Invalid;
+}
@@ -0,0 +1,110 @@
+//
+// Hands out ranges of a fixed size space, like vertices and indices of a shared buffer
+// Two level segregated fit (TLSF): free ranges are kept in lists by size class with a bitmap over the lists, so allocating
+// and freeing take constant time, and freed ranges merge with free neighbours straight away
+// Knows nothing about what the space holds, Compact reports how ranges moved and the owner copies the data
+//
+
+#ifndef RANGEALLOCATOR_H
+#define RANGEALLOCATOR_H
+
+#include <vector>
+#include <Windows.h>
+
+/// <summary>A range Compact moved, from and to are offsets in the space
+/// </summary>
+struct RangeMove
+{
+	UINT range;
+	UINT from;
+	UINT to;
+	UINT size;
+};
+
+struct RangeAllocatorStats
+{
+	RangeAllocatorStats() : capacity(0), used(0), allocations(0), freeRanges(0), largestFree(0) {}
+
+	UINT capacity;
+	UINT used;
+	UINT allocations;
+	UINT freeRanges;
+	UINT largestFree;
+};
+
+class RangeAllocator
+{
+public:
+	static const UINT Invalid = 0xFFFFFFFF;
+
+	RangeAllocator(UINT capacity = 0);
+
+	/// <summary>Forgets every range and starts over with one free range of capacity
+	/// </summary>
+	void Reset(UINT capacity);
+
+	/// <summary>Returns the id of a range of size, or Invalid if no free range is large enough. size must be above 0
+	/// The id stays the same until the range is freed, even if Compact moves it
+	/// </summary>
+	UINT Allocate(UINT size);
+
+	void Free(UINT range);
+
+	UINT GetOffset(UINT range) const;
+	UINT GetSize(UINT range) const;
+
+	/// <summary>Adds space at the end, capacity can only grow
+	/// </summary>
+	void Grow(UINT capacity);
+
+	/// <summary>Packs every range to the front in the order they lie, leaving a single free range at the end
+	/// Adds a move for every range whose offset changed, in ascending order of offset
+	/// </summary>
+	void Compact(std::vector<RangeMove>& moves);
+
+	RangeAllocatorStats GetStats() const;
+	UINT GetCapacity() const;
+private:
+	struct Block
+	{
+		UINT offset;
+		UINT size;
+		UINT previous;		// Neighbours in the space
+		UINT next;
+		UINT previousFree;	// Neighbours in the block's size class list while free, next also links unused blocks
+		UINT nextFree;
+		bool free;
+	};
+
+	// Each power of two is split into this many size classes, sizes below it get a class of their own
+	static const UINT SecondLevelBits = 4;
+	static const UINT SecondLevelCount = 1 << SecondLevelBits;
+	static const UINT FirstLevelCount = 32 - SecondLevelBits + 1;
+
+	static void GetClass(UINT size, UINT& firstLevel, UINT& secondLevel);
+
+	UINT NewBlock(UINT offset, UINT size);
+	void DeleteBlock(UINT block);
+	void InsertFree(UINT block);
+	void RemoveFree(UINT block);
+
+	/// <summary>A free block at least size large, or Invalid
+	/// </summary>
+	UINT FindFree(UINT size) const;
+
+	std::vector<Block> blocks;
+	UINT unusedBlocks;		// Blocks not in the space, linked through nextFree
+	UINT firstBlock;
+	UINT lastBlock;
+
+	UINT firstLevelMap;
+	UINT secondLevelMaps[FirstLevelCount];
+	UINT freeLists[FirstLevelCount][SecondLevelCount];
+
+	UINT capacity;
+	UINT used;
+	UINT allocations;
+	UINT freeRanges;
+};
+
+#endif
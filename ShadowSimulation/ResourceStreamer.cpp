@@ -0,0 +1,342 @@
+//
+// D3D11 side of asset streaming
+// Hands out meshes and material textures that show placeholders until their data has been
+// streamed in by an AssetStreamer, and puts the placeholders back when they are evicted
+//
+
+#include "ResourceStreamer.h"
+
+#include <fstream>
+#include <DDSTextureLoader.h>
+#include <WICTextureLoader.h>
+
+#include "FileTextureSource.h"
+#include "Game.h"
+#include "MeshGenerator.h"
+#include "Profiler.h"
+#include "TrackedResources.h"
+
+// Images decoded on a loader thread start with this, followed by the packed mip chain
+// Anything else is a file for the DDS or WIC loaders
+struct DecodedTexturePayloadHeader
+{
+	UINT magic;
+	UINT width;
+	UINT height;
+	UINT mipCount;
+};
+
+static const UINT DecodedTextureMagic = 0x41424752;	// "RGBA"
+
+ResourceStreamer::ResourceStreamer() :
+dev(NULL),
+geometry(NULL),
+textures(NULL),
+streamer(this),
+placeholderMesh(NULL),
+placeholderDiffuse(NULL),
+placeholderNormal(NULL)
+{
+
+}
+
+ResourceStreamer::~ResourceStreamer()
+{
+	Shutdown();
+	for (StreamedAsset& asset : assets)
+		delete asset.mesh;
+	ReleaseMacro(placeholderDiffuse);
+	ReleaseMacro(placeholderNormal);
+	delete placeholderMesh;
+}
+
+bool ResourceStreamer::Initialize(ID3D11Device* _dev, GeometryPool* _geometry, TextureCache* _textures, UINT workerCount)
+{
+	dev = _dev;
+	geometry = _geometry;
+	textures = _textures;
+
+	MeshData sphere;
+	MeshGenerator::CreateSphere(0.5f, 1, sphere);
+	placeholderMesh = new Mesh(sphere, *geometry, "PlaceholderMesh");
+
+	// Plain white, and a flat tangent space normal
+	placeholderDiffuse = CreateSolidTexture(0xFFFFFFFF);
+	placeholderNormal = CreateSolidTexture(0xFFFF8080);
+	if (!placeholderDiffuse || !placeholderNormal)
+		return false;
+
+	streamer.Start(workerCount);
+	return true;
+}
+
+void ResourceStreamer::Shutdown()
+{
+	streamer.Stop();
+}
+
+Mesh* ResourceStreamer::StreamMesh(const char* filepath)
+{
+	std::map<std::string, AssetId>::iterator existing = meshIds.find(filepath);
+	if (existing != meshIds.end())
+		return assets[existing->second].mesh;
+
+	StreamedAsset asset;
+	asset.isMesh = true;
+	asset.meshPath = filepath;
+	asset.mesh = new Mesh(placeholderMesh);
+	{
+		std::lock_guard<std::mutex> lock(assetMutex);
+		assets.push_back(asset);
+	}
+
+	AssetId id = streamer.Add(0.0f);
+	meshIds[filepath] = id;
+	meshAssets[asset.mesh] = id;
+	return asset.mesh;
+}
+
+void ResourceStreamer::StreamTexture(Material* mat, TextureSlot slot, const wchar_t* filepath)
+{
+	TextureUser user = { mat, slot };
+	std::wstring key = TextureCache::Canonicalize(filepath);
+
+	std::map<std::wstring, AssetId>::iterator existing = textureIds.find(key);
+	if (existing != textureIds.end())
+	{
+		StreamedAsset& asset = assets[existing->second];
+		asset.users.push_back(user);
+		if (asset.texture.IsValid())
+			mat->SetTexture(slot, asset.texture);
+		else
+			mat->SetTexture(slot, GetPlaceholder(slot));
+		materialAssets.insert(std::make_pair(mat, existing->second));
+		return;
+	}
+
+	StreamedAsset asset;
+	asset.isMesh = false;
+	asset.texturePath = filepath;
+	asset.mesh = NULL;
+	asset.users.push_back(user);
+	{
+		std::lock_guard<std::mutex> lock(assetMutex);
+		assets.push_back(asset);
+	}
+	mat->SetTexture(slot, GetPlaceholder(slot));
+
+	AssetId id = streamer.Add(0.0f);
+	textureIds[key] = id;
+	materialAssets.insert(std::make_pair(mat, id));
+}
+
+void ResourceStreamer::ResetPriorities()
+{
+	streamer.ResetPriorities();
+}
+
+void ResourceStreamer::Prioritize(Mesh* mesh, Material* mat, float priority)
+{
+	std::map<Mesh*, AssetId>::iterator meshAsset = meshAssets.find(mesh);
+	if (meshAsset != meshAssets.end())
+		streamer.RaisePriority(meshAsset->second, priority);
+
+	typedef std::multimap<Material*, AssetId>::iterator MaterialIterator;
+	std::pair<MaterialIterator, MaterialIterator> textures = materialAssets.equal_range(mat);
+	for (MaterialIterator it = textures.first; it != textures.second; ++it)
+		streamer.RaisePriority(it->second, priority);
+}
+
+void ResourceStreamer::Update(UINT64 uploadBudget)
+{
+	PROFILE_ZONE("ResourceStreamer::Update");
+	UINT uploads = streamer.Update(uploadBudget);
+	PROFILE_COUNTER("Streamed Uploads", uploads);
+	PROFILE_COUNTER("Resident KB", streamer.GetResidentBytes() / 1024);
+}
+
+AssetStreamer& ResourceStreamer::GetStreamer() { return streamer; }
+
+bool ResourceStreamer::Load(AssetId id, std::vector<BYTE>& payload)
+{
+	bool isMesh;
+	std::string meshPath;
+	std::wstring texturePath;
+	{
+		std::lock_guard<std::mutex> lock(assetMutex);
+		isMesh = assets[id].isMesh;
+		meshPath = assets[id].meshPath;
+		texturePath = assets[id].texturePath;
+	}
+
+	// Meshes are payloads in the cooked .mesh layout, read from the cooked file next to the model when there is one
+	// and otherwise imported and simplified here, off the render thread. Compressed files decode straight into the payload
+	if (isMesh)
+	{
+		PROFILE_ZONE("Stream::ImportMesh");
+		CookedMesh cooked;
+		if (Mesh::ReadCooked(Mesh::GetCookedPath(meshPath), payload) && ParseCookedMesh(&payload[0], payload.size(), cooked))
+			return true;
+
+		MeshData data;
+		if (!Mesh::Import(meshPath.c_str(), data))
+			return false;
+		Mesh::BuildLODs(data);
+		SerializeMesh(data, payload);
+		return true;
+	}
+
+	// Textures are read here preferring a cooked .dds next to the source image, which is created as it is during upload
+	PROFILE_ZONE("Stream::ReadTexture");
+	std::ifstream file(FileTextureSource::GetCookedPath(texturePath).c_str(), std::ios::binary | std::ios::ate);
+	if (!file)
+		file.open(texturePath.c_str(), std::ios::binary | std::ios::ate);
+	if (!file)
+		return false;
+
+	std::streamsize size = file.tellg();
+	if (size <= 0)
+		return false;
+
+	payload.resize((size_t)size);
+	file.seekg(0, std::ios::beg);
+	if (!file.read((char*)&payload[0], size))
+		return false;
+
+	// Images the portable decoders read are decoded and mipped here, leaving upload nothing but the copy to the GPU
+	DecodedTexture decoded;
+	bool cooked = payload.size() > 4 && memcmp(&payload[0], "DDS ", 4) == 0;
+	if (cooked || !FileTextureSource::DecodeImage(texturePath, &payload[0], payload.size(), TextureLoadOptions(), decoded))
+		return true;
+
+	DecodedTexturePayloadHeader header = { DecodedTextureMagic, decoded.width, decoded.height, decoded.mipCount };
+	payload.resize(sizeof(header) + decoded.levels.size());
+	memcpy(&payload[0], &header, sizeof(header));
+	memcpy(&payload[sizeof(header)], &decoded.levels[0], decoded.levels.size());
+	return true;
+}
+
+UINT64 ResourceStreamer::Upload(AssetId id, const std::vector<BYTE>& payload)
+{
+	// Upload and Evict run on the main thread, the only one that adds assets, so reading them needs no lock
+	StreamedAsset& asset = assets[id];
+
+	if (asset.isMesh)
+	{
+		PROFILE_ZONE("Stream::UploadMesh");
+		CookedMesh cooked;
+		if (!ParseCookedMesh(&payload[0], payload.size(), cooked))
+			return 0;
+		const CookedMeshHeader& header = cooked.header;
+
+		GeometryHandle handle = geometry->Add(cooked.vertices, header.numVertices, cooked.indices, header.numIndices, asset.meshPath.c_str());
+		if (!handle)
+			return 0;
+
+		MeshBounds bounds = ComputeMeshBounds(cooked.vertices, header.numVertices);
+		asset.mesh->SetGeometry(geometry, handle, header.numVertices, header.numIndices, &bounds, cooked.lods, header.numLODs);
+		geometry->Release(handle);
+
+		MeshletData meshlets;
+		ReadCookedMeshlets(cooked, meshlets);
+		asset.mesh->SetMeshlets(meshlets, asset.meshPath.c_str());
+		return header.numVertices * sizeof(Vertex) + header.numIndices * sizeof(UINT);
+	}
+
+	PROFILE_ZONE("Stream::UploadTexture");
+
+	// Something else may have loaded the file since it was last evicted, reuse it rather than decode a copy
+	asset.texture = textures->Find(asset.texturePath);
+	if (!asset.texture.IsValid())
+	{
+		ID3D11Resource* resource = NULL;
+		ID3D11ShaderResourceView* view = NULL;
+		DecodedTexturePayloadHeader header = { 0 };
+		if (payload.size() >= sizeof(header))
+			memcpy(&header, &payload[0], sizeof(header));
+
+		// Paths are ASCII in practice, narrowed for the registry
+		std::string owner(asset.texturePath.begin(), asset.texturePath.end());
+		HRESULT hr;
+		if (header.magic == DecodedTextureMagic)
+		{
+			hr = FileTextureSource::CreateDecodedTexture(dev, header.width, header.height, header.mipCount, &payload[sizeof(header)], false,
+				owner.c_str(), &resource, &view);
+		}
+		else
+		{
+			if (payload.size() > 4 && memcmp(&payload[0], "DDS ", 4) == 0)
+				hr = CreateDDSTextureFromMemory(dev, &payload[0], payload.size(), &resource, &view);
+			else
+				hr = CreateWICTextureFromMemory(dev, &payload[0], payload.size(), &resource, &view);
+			if (SUCCEEDED(hr))
+			{
+				TrackedResources::TrackResource(resource, owner.c_str());
+				TrackedResources::Track(view, MemoryView, owner.c_str(), 0);
+			}
+		}
+		if (FAILED(hr))
+			return 0;
+
+		UINT64 bytes = FileTextureSource::GetTextureBytes(resource);
+		ReleaseMacro(resource);
+		asset.texture = textures->Insert(asset.texturePath, TextureLoadOptions(), view, bytes);
+		ReleaseMacro(view);
+	}
+
+	for (TextureUser& user : asset.users)
+		user.mat->SetTexture(user.slot, asset.texture);
+	return asset.texture.GetBytes();
+}
+
+void ResourceStreamer::Evict(AssetId id)
+{
+	StreamedAsset& asset = assets[id];
+	if (asset.isMesh)
+	{
+		const std::vector<MeshLOD>& placeholderLODs = placeholderMesh->GetLODs();
+		asset.mesh->SetGeometry(placeholderMesh->GetPool(), placeholderMesh->GetGeometry(), placeholderMesh->numVertices, placeholderMesh->numIndices, NULL,
+			&placeholderLODs[0], (UINT)placeholderLODs.size());
+		MeshletData none;
+		asset.mesh->SetMeshlets(none, asset.meshPath.c_str());
+		return;
+	}
+
+	// Once the materials have dropped their handles the cache is free to trim the texture
+	for (TextureUser& user : asset.users)
+		user.mat->SetTexture(user.slot, GetPlaceholder(user.slot));
+	asset.texture.Reset();
+}
+
+ID3D11ShaderResourceView* ResourceStreamer::CreateSolidTexture(UINT rgba)
+{
+	D3D11_TEXTURE2D_DESC desc;
+	ZeroMemory(&desc, sizeof(D3D11_TEXTURE2D_DESC));
+	desc.Width = 1;
+	desc.Height = 1;
+	desc.MipLevels = 1;
+	desc.ArraySize = 1;
+	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	D3D11_SUBRESOURCE_DATA data;
+	data.pSysMem = &rgba;
+	data.SysMemPitch = sizeof(UINT);
+	data.SysMemSlicePitch = 0;
+
+	ID3D11Texture2D* texture = NULL;
+	if (FAILED(TrackedResources::CreateTexture2D(dev, &desc, &data, "PlaceholderTexture", &texture)))
+		return NULL;
+
+	ID3D11ShaderResourceView* view = NULL;
+	TrackedResources::CreateShaderResourceView(dev, texture, NULL, "PlaceholderTexture", &view);
+	ReleaseMacro(texture);
+	return view;
+}
+
+ID3D11ShaderResourceView* ResourceStreamer::GetPlaceholder(TextureSlot slot)
+{
+	return slot == NormalSlot ? placeholderNormal : placeholderDiffuse;
+}
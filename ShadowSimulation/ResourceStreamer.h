@@ -0,0 +1,108 @@
+//
+// D3D11 side of asset streaming
+// Hands out meshes and material textures that show placeholders until their data has been
+// streamed in by an AssetStreamer, and puts the placeholders back when they are evicted
+//
+
+#ifndef RESOURCESTREAMER_H
+#define RESOURCESTREAMER_H
+
+#include <d3d11.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "AssetStreamer.h"
+#include "Mesh.h"
+#include "Material.h"
+#include "TextureCache.h"
+
+class ResourceStreamer : public StreamBackend
+{
+public:
+	ResourceStreamer();
+	~ResourceStreamer();
+
+	/// <summary>Creates the placeholders and starts the loader threads
+	/// Streamed textures are shared through the cache, so each file is only resident once
+	/// </summary>
+	bool Initialize(ID3D11Device* dev, GeometryPool* geometry, TextureCache* textures, UINT workerCount);
+
+	/// <summary>Stops the loader threads, call before the device goes away
+	/// </summary>
+	void Shutdown();
+
+	/// <summary>Returns a mesh that draws a placeholder until the file has been streamed in
+	/// Requesting the same file again returns the same mesh, which stays owned by the streamer
+	/// </summary>
+	Mesh* StreamMesh(const char* filepath);
+
+	/// <summary>Puts a placeholder in the material's slot until the texture has been streamed in
+	/// </summary>
+	void StreamTexture(Material* mat, TextureSlot slot, const wchar_t* filepath);
+
+	/// <summary>Clears every priority, call before prioritizing this frame's objects
+	/// </summary>
+	void ResetPriorities();
+
+	/// <summary>Raises the priority of a mesh and of every texture streamed into a material
+	/// </summary>
+	void Prioritize(Mesh* mesh, Material* mat, float priority);
+
+	/// <summary>Uploads finished assets, spending at most uploadBudget bytes this frame
+	/// </summary>
+	void Update(UINT64 uploadBudget);
+
+	AssetStreamer& GetStreamer();
+
+	///
+	// StreamBackend
+	///
+	bool Load(AssetId id, std::vector<BYTE>& payload);
+	UINT64 Upload(AssetId id, const std::vector<BYTE>& payload);
+	void Evict(AssetId id);
+private:
+	struct TextureUser
+	{
+		Material* mat;
+		TextureSlot slot;
+	};
+
+	struct StreamedAsset
+	{
+		bool isMesh;
+		std::string meshPath;
+		std::wstring texturePath;
+
+		Mesh* mesh;
+		std::vector<TextureUser> users;
+		TextureHandle texture;
+	};
+
+	/// <summary>Creates a 1x1 texture of a single color
+	/// </summary>
+	ID3D11ShaderResourceView* CreateSolidTexture(UINT rgba);
+
+	ID3D11ShaderResourceView* GetPlaceholder(TextureSlot slot);
+
+	ID3D11Device* dev;
+	GeometryPool* geometry;
+	TextureCache* textures;
+	AssetStreamer streamer;
+
+	Mesh* placeholderMesh;
+	ID3D11ShaderResourceView* placeholderDiffuse;
+	ID3D11ShaderResourceView* placeholderNormal;
+
+	// Written on the main thread, read by the loader threads
+	std::mutex assetMutex;
+	std::vector<StreamedAsset> assets;
+
+	std::map<std::string, AssetId> meshIds;
+	std::map<std::wstring, AssetId> textureIds;
+	std::map<Mesh*, AssetId> meshAssets;
+	std::multimap<Material*, AssetId> materialAssets;
+};
+
+#endif
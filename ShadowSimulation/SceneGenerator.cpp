@@ -0,0 +1,95 @@
+//
+// Builds reproducible benchmark scenes from a seed
+// The same SceneDesc always produces the same objects, lights and camera path on every platform
+//
+
+#include "SceneGenerator.h"
+#include <cmath>
+
+//
+// Small xorshift generator. The standard distributions are implementation defined,
+// so the float conversion is done by hand to keep scenes identical across compilers
+//
+class SceneRandom
+{
+public:
+	SceneRandom(UINT seed) : state(seed ? seed : 0x9E3779B9u) {}
+
+	UINT Next()
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+	float Range(float minValue, float maxValue)
+	{
+		float unit = (Next() >> 8) * (1.0f / 16777216.0f);
+		return minValue + (maxValue - minValue) * unit;
+	}
+private:
+	UINT state;
+};
+
+void SceneGenerator::Generate(const SceneDesc& desc, GeneratedScene& scene)
+{
+	SceneRandom rand(desc.seed);
+	float half = desc.extent * 0.5f;
+
+	scene.objects.resize(desc.objectCount);
+	for (GeneratedObject& obj : scene.objects)
+	{
+		obj.mesh = desc.meshCount ? rand.Next() % desc.meshCount : 0;
+		obj.position = XMFLOAT3(rand.Range(-half, half), rand.Range(0.5f, 3.0f), rand.Range(-half, half));
+		obj.rotation = XMFLOAT3(0.0f, rand.Range(0.0f, XM_2PI), 0.0f);
+
+		float size = rand.Range(0.5f, 2.0f);
+		obj.scale = XMFLOAT3(size, size, size);
+
+		obj.dynamic = rand.Range(0.0f, 1.0f) < desc.dynamicFraction;
+		obj.angularVelocity = obj.dynamic ? XMFLOAT3(0.0f, rand.Range(-2.0f, 2.0f), 0.0f) : XMFLOAT3(0.0f, 0.0f, 0.0f);
+	}
+
+	scene.lights.resize(desc.lightCount);
+	for (GeneratedLight& light : scene.lights)
+	{
+		light.position = XMFLOAT3(rand.Range(-half, half), rand.Range(5.0f, 15.0f), rand.Range(-half, half));
+		light.color = XMFLOAT4(rand.Range(0.4f, 1.0f), rand.Range(0.4f, 1.0f), rand.Range(0.4f, 1.0f), 1.0f);
+		light.range = rand.Range(10.0f, 40.0f);
+	}
+
+	// Camera keys go round the scene on a jittered circle so the path never doubles back
+	scene.cameraPath.resize(desc.cameraKeys < 4 ? 4 : desc.cameraKeys);
+	for (size_t i = 0; i < scene.cameraPath.size(); i++)
+	{
+		float angle = XM_2PI * i / scene.cameraPath.size();
+		float radius = half * rand.Range(0.3f, 0.9f);
+		scene.cameraPath[i] = XMFLOAT3(radius * cosf(angle), rand.Range(3.0f, 12.0f), radius * sinf(angle));
+	}
+}
+
+// Closed Catmull-Rom spline through the camera keys
+static XMFLOAT3 EvaluatePath(const std::vector<XMFLOAT3>& keys, float t)
+{
+	size_t count = keys.size();
+	float scaled = (t - floorf(t)) * count;
+	size_t segment = (size_t)scaled % count;
+	float s = scaled - floorf(scaled);
+
+	const XMFLOAT3& p0 = keys[(segment + count - 1) % count];
+	const XMFLOAT3& p1 = keys[segment];
+	const XMFLOAT3& p2 = keys[(segment + 1) % count];
+	const XMFLOAT3& p3 = keys[(segment + 2) % count];
+
+	XMFLOAT3 result;
+	XMStoreFloat3(&result, XMVectorCatmullRom(XMLoadFloat3(&p0), XMLoadFloat3(&p1), XMLoadFloat3(&p2), XMLoadFloat3(&p3), s));
+	return result;
+}
+
+void SceneGenerator::SampleCameraPath(const GeneratedScene& scene, float t, XMFLOAT3& position, XMFLOAT3& target)
+{
+	position = EvaluatePath(scene.cameraPath, t);
+	target = EvaluatePath(scene.cameraPath, t + 0.01f);
+	target.y = 0.0f;
+}
@@ -0,0 +1,74 @@
+//
+// Builds reproducible benchmark scenes from a seed
+// The same SceneDesc always produces the same objects, lights and camera path on every platform
+//
+
+#ifndef SCENEGENERATOR_H
+#define SCENEGENERATOR_H
+
+#include <vector>
+#include <Windows.h>
+#include <DirectXMath.h>
+
+using namespace DirectX;
+
+struct SceneDesc
+{
+	SceneDesc() :
+	seed(1),
+	objectCount(1000),
+	lightCount(8),
+	meshCount(1),
+	dynamicFraction(0.25f),
+	extent(100.0f),
+	cameraKeys(8)
+	{
+
+	}
+
+	UINT seed;
+	UINT objectCount;
+	UINT lightCount;
+	UINT meshCount;			// Size of the mesh palette objects pick from
+	float dynamicFraction;	// Share of objects that spin every update
+	float extent;			// Objects are scattered over an extent x extent square
+	UINT cameraKeys;		// Control points of the closed camera flythrough
+};
+
+struct GeneratedObject
+{
+	UINT mesh;
+	XMFLOAT3 position;
+	XMFLOAT3 rotation;
+	XMFLOAT3 scale;
+	bool dynamic;
+	XMFLOAT3 angularVelocity;
+};
+
+struct GeneratedLight
+{
+	XMFLOAT3 position;
+	XMFLOAT4 color;
+	float range;
+};
+
+struct GeneratedScene
+{
+	std::vector<GeneratedObject> objects;
+	std::vector<GeneratedLight> lights;
+	std::vector<XMFLOAT3> cameraPath;
+};
+
+class SceneGenerator
+{
+public:
+	/// <summary>Fills scene with objects, lights and a camera path generated from desc.seed
+	/// </summary>
+	static void Generate(const SceneDesc& desc, GeneratedScene& scene);
+
+	/// <summary>Samples the closed camera path at t in [0, 1). Returns the position and a point just ahead to look at
+	/// </summary>
+	static void SampleCameraPath(const GeneratedScene& scene, float t, XMFLOAT3& position, XMFLOAT3& target);
+};
+
+#endif
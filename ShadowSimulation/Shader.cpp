@@ -1,6 +1,9 @@
 #include "Shader.h"
 #include <d3dcompiler.h>
 #include "Game.h"
+#include "Profiler.h"
+#include "ShaderLibrary.h"
+#include "TrackedResources.h"
 
 Shader::Shader():
 vert(),
@@ -28,31 +31,82 @@ Shader::~Shader()
 
 bool Shader::LoadShader(wchar_t* filepath, ShaderType type, ID3D11Device* dev)
 {
+	PROFILE_ZONE("Shader::LoadShader");
 	ID3DBlob* fileToBlob;
 	HRESULT hr = D3DReadFileToBlob(filepath, &fileToBlob);
 
 	if (hr != S_OK)
 		return false;
 
+	bool created = LoadShader(fileToBlob, type, dev);
+	ReleaseMacro(fileToBlob);
+	return created;
+}
+
+bool Shader::LoadShader(ID3DBlob* bytecode, ShaderType type, ID3D11Device* dev)
+{
+	HRESULT hr = E_INVALIDARG;
+	ID3D11DeviceChild* created = NULL;
 	switch (type)
 	{
 	case Vert:
-		dev->CreateVertexShader(fileToBlob->GetBufferPointer(), fileToBlob->GetBufferSize(), NULL, &vert);
+		hr = dev->CreateVertexShader(bytecode->GetBufferPointer(), bytecode->GetBufferSize(), NULL, &vert);
+		created = vert;
 		break;
 	case Pixel:
-		dev->CreatePixelShader(fileToBlob->GetBufferPointer(), fileToBlob->GetBufferSize(), NULL, &pix);
+		hr = dev->CreatePixelShader(bytecode->GetBufferPointer(), bytecode->GetBufferSize(), NULL, &pix);
+		created = pix;
 		break;
 	case Geometry:
-		dev->CreateGeometryShader(fileToBlob->GetBufferPointer(), fileToBlob->GetBufferSize(), NULL, &geo);
+		hr = dev->CreateGeometryShader(bytecode->GetBufferPointer(), bytecode->GetBufferSize(), NULL, &geo);
+		created = geo;
 		break;
 	case Compute:
-		dev->CreateComputeShader(fileToBlob->GetBufferPointer(), fileToBlob->GetBufferSize(), NULL, &comp);
+		hr = dev->CreateComputeShader(bytecode->GetBufferPointer(), bytecode->GetBufferSize(), NULL, &comp);
+		created = comp;
 		break;
 	case Domain:
-		dev->CreateDomainShader(fileToBlob->GetBufferPointer(), fileToBlob->GetBufferSize(), NULL, &dom);
+		hr = dev->CreateDomainShader(bytecode->GetBufferPointer(), bytecode->GetBufferSize(), NULL, &dom);
+		created = dom;
 		break;
 	}
 
+	if (FAILED(hr))
+		return false;
+	TrackedResources::Track(created, MemoryShader, "Shader", bytecode->GetBufferSize());
+	return true;
+}
+
+bool Shader::LoadShader(ShaderLibrary& library, UINT64 hash, ShaderType type, ID3D11Device* dev)
+{
+	ID3D11DeviceChild* shader = library.GetShader(hash, type, dev);
+	if (!shader)
+		return false;
+
+	shader->AddRef();
+	switch (type)
+	{
+	case Vert:
+		ReleaseMacro(vert);
+		vert = static_cast<ID3D11VertexShader*>(shader);
+		break;
+	case Pixel:
+		ReleaseMacro(pix);
+		pix = static_cast<ID3D11PixelShader*>(shader);
+		break;
+	case Geometry:
+		ReleaseMacro(geo);
+		geo = static_cast<ID3D11GeometryShader*>(shader);
+		break;
+	case Compute:
+		ReleaseMacro(comp);
+		comp = static_cast<ID3D11ComputeShader*>(shader);
+		break;
+	case Domain:
+		ReleaseMacro(dom);
+		dom = static_cast<ID3D11DomainShader*>(shader);
+		break;
+	}
 	return true;
 }
 
@@ -18,6 +18,8 @@ enum ShaderType
 	Domain
 };
 
+class ShaderLibrary;
+
 class Shader
 {
 public:
@@ -25,6 +27,14 @@ public:
 	virtual ~Shader();
 	
 	bool LoadShader(wchar_t* filepath, ShaderType type, ID3D11Device* dev);
+
+	/// <summary>Creates a shader from bytecode that was already read, e.g. on a loader thread
+	/// </summary>
+	bool LoadShader(ID3DBlob* bytecode, ShaderType type, ID3D11Device* dev);
+
+	/// <summary>Takes a reference on the library's shader for bytecode it loaded, so materials sharing a file share the shader
+	/// </summary>
+	bool LoadShader(ShaderLibrary& library, UINT64 hash, ShaderType type, ID3D11Device* dev);
 	void SetShader(ShaderType type, ID3D11DeviceContext* devCon);
 private:
 	bool CheckLoaded(ShaderType type);
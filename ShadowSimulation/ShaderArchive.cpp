@@ -0,0 +1,167 @@
+//
+// Packed file of compiled shader permutations, looked up by shader name and feature mask
+//
+
+#include "ShaderArchive.h"
+
+#include <cstring>
+#include <fstream>
+
+#include "ShaderReflection.h"
+
+ShaderArchive::ShaderArchive()
+{
+
+}
+
+void ShaderArchive::Add(const std::string& shader, UINT features, const BYTE* bytecode, size_t size)
+{
+	if (!bytecode || size == 0)
+		return;
+
+	ShaderArchiveEntry entry;
+	entry.shader = ShaderReflection::Hash(shader.c_str(), shader.size());
+	entry.features = features;
+	entry.size = (UINT)size;
+	entry.pad = 0;
+
+	// Reuse identical bytecode, e.g. permutations whose features the compiler optimized away
+	UINT64 hash = ShaderReflection::Hash(bytecode, size);
+	size_t blob = 0;
+	while (blob < blobHashes.size() &&
+		!(blobHashes[blob] == hash && blobSizes[blob] == size && memcmp(&blobs[blobOffsets[blob]], bytecode, size) == 0))
+		blob++;
+	if (blob == blobHashes.size())
+	{
+		blobHashes.push_back(hash);
+		blobOffsets.push_back((UINT)blobs.size());
+		blobSizes.push_back((UINT)size);
+		blobs.insert(blobs.end(), bytecode, bytecode + size);
+
+		// Keep bytecode 4 byte aligned for the DXBC parser and device
+		blobs.resize((blobs.size() + 3) & ~3);
+	}
+	entry.offset = blobOffsets[blob];
+
+	for (ShaderArchiveEntry& existing : entries)
+	{
+		if (existing.shader == entry.shader && existing.features == features)
+		{
+			existing = entry;
+			return;
+		}
+	}
+	entries.push_back(entry);
+}
+
+void ShaderArchive::Write(std::vector<BYTE>& data) const
+{
+	ShaderArchiveHeader header;
+	header.magic = ShaderArchiveMagic;
+	header.version = ShaderArchiveVersion;
+	header.entryCount = (UINT)entries.size();
+	header.blobCount = (UINT)blobHashes.size();
+
+	size_t tableSize = sizeof(ShaderArchiveHeader) + entries.size() * sizeof(ShaderArchiveEntry);
+	data.resize(tableSize + blobs.size());
+	memcpy(&data[0], &header, sizeof(ShaderArchiveHeader));
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		ShaderArchiveEntry entry = entries[i];
+		entry.offset += (UINT)tableSize;
+		memcpy(&data[sizeof(ShaderArchiveHeader) + i * sizeof(ShaderArchiveEntry)], &entry, sizeof(ShaderArchiveEntry));
+	}
+	if (!blobs.empty())
+		memcpy(&data[tableSize], &blobs[0], blobs.size());
+}
+
+bool ShaderArchive::Read(const BYTE* data, size_t size)
+{
+	entries.clear();
+	blobs.clear();
+	blobHashes.clear();
+	blobOffsets.clear();
+	blobSizes.clear();
+
+	ShaderArchiveHeader header;
+	if (!data || size < sizeof(ShaderArchiveHeader))
+		return false;
+	memcpy(&header, data, sizeof(ShaderArchiveHeader));
+	if (header.magic != ShaderArchiveMagic || header.version != ShaderArchiveVersion ||
+		header.entryCount > (size - sizeof(ShaderArchiveHeader)) / sizeof(ShaderArchiveEntry))
+		return false;
+
+	size_t tableSize = sizeof(ShaderArchiveHeader) + header.entryCount * sizeof(ShaderArchiveEntry);
+	entries.resize(header.entryCount);
+	for (UINT i = 0; i < header.entryCount; i++)
+	{
+		ShaderArchiveEntry& entry = entries[i];
+		memcpy(&entry, data + sizeof(ShaderArchiveHeader) + i * sizeof(ShaderArchiveEntry), sizeof(ShaderArchiveEntry));
+		if (entry.offset < tableSize || entry.offset > size || entry.size > size - entry.offset)
+		{
+			entries.clear();
+			return false;
+		}
+		entry.offset -= (UINT)tableSize;
+	}
+
+	// Offsets stay relative to the bytecode so a loaded archive can take more permutations
+	blobs.assign(data + tableSize, data + size);
+	for (const ShaderArchiveEntry& entry : entries)
+	{
+		bool known = false;
+		for (size_t blob = 0; blob < blobOffsets.size(); blob++)
+			known = known || (blobOffsets[blob] == entry.offset && blobSizes[blob] == entry.size);
+		if (!known && entry.size > 0)
+		{
+			blobOffsets.push_back(entry.offset);
+			blobSizes.push_back(entry.size);
+			blobHashes.push_back(ShaderReflection::Hash(&blobs[entry.offset], entry.size));
+		}
+	}
+	return true;
+}
+
+bool ShaderArchive::Load(const std::wstring& path)
+{
+#if defined(_MSC_VER)
+	std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+#else
+	std::ifstream file(std::string(path.begin(), path.end()).c_str(), std::ios::binary | std::ios::ate);
+#endif
+	if (!file)
+		return false;
+
+	std::streamsize size = file.tellg();
+	if (size <= 0)
+		return false;
+
+	std::vector<BYTE> data((size_t)size);
+	file.seekg(0, std::ios::beg);
+	if (!file.read((char*)&data[0], size))
+		return false;
+	return Read(&data[0], data.size());
+}
+
+bool ShaderArchive::Find(const std::string& shader, UINT features, const BYTE*& bytecode, size_t& size) const
+{
+	UINT64 name = ShaderReflection::Hash(shader.c_str(), shader.size());
+	for (const ShaderArchiveEntry& entry : entries)
+	{
+		if (entry.shader == name && entry.features == features && entry.size > 0)
+		{
+			bytecode = &blobs[entry.offset];
+			size = entry.size;
+			return true;
+		}
+	}
+	return false;
+}
+
+UINT ShaderArchive::GetPermutationCount() const { return (UINT)entries.size(); }
+UINT ShaderArchive::GetBlobCount() const { return (UINT)blobHashes.size(); }
+
+size_t ShaderArchive::GetSize() const
+{
+	return sizeof(ShaderArchiveHeader) + entries.size() * sizeof(ShaderArchiveEntry) + blobs.size();
+}
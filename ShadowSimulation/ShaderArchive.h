@@ -0,0 +1,71 @@
+//
+// Packed file of compiled shader permutations, looked up by shader name and feature mask
+// Permutations that compile to identical bytecode share one copy
+// Layout: header, one entry per permutation, then the bytecode, every offset from the start of the file
+//
+
+#ifndef SHADERARCHIVE_H
+#define SHADERARCHIVE_H
+
+#include <string>
+#include <vector>
+#include <Windows.h>
+
+struct ShaderArchiveHeader
+{
+	UINT magic;			// ShaderArchiveMagic
+	UINT version;
+	UINT entryCount;
+	UINT blobCount;		// Distinct bytecode, at most entryCount
+};
+
+struct ShaderArchiveEntry
+{
+	UINT64 shader;		// Hash of the shader name
+	UINT features;
+	UINT offset;
+	UINT size;
+	UINT pad;
+};
+
+static const UINT ShaderArchiveMagic = 0x4D524550;	// "PERM"
+static const UINT ShaderArchiveVersion = 1;
+
+class ShaderArchive
+{
+public:
+	ShaderArchive();
+
+	/// <summary>Adds a compiled permutation, replacing an earlier one with the same shader and features
+	/// </summary>
+	void Add(const std::string& shader, UINT features, const BYTE* bytecode, size_t size);
+
+	/// <summary>Serializes every permutation added so far
+	/// </summary>
+	void Write(std::vector<BYTE>& data) const;
+
+	/// <summary>Replaces the contents with an archive Write produced. Returns false if data is malformed
+	/// </summary>
+	bool Read(const BYTE* data, size_t size);
+
+	bool Load(const std::wstring& path);
+
+	/// <summary>Returns the bytecode for a permutation, false if the archive doesn't have it
+	/// </summary>
+	bool Find(const std::string& shader, UINT features, const BYTE*& bytecode, size_t& size) const;
+
+	UINT GetPermutationCount() const;
+	UINT GetBlobCount() const;
+
+	/// <summary>Bytes the archive takes on disk
+	/// </summary>
+	size_t GetSize() const;
+private:
+	std::vector<ShaderArchiveEntry> entries;	// Offsets index into blobs until written
+	std::vector<BYTE> blobs;
+	std::vector<UINT64> blobHashes;
+	std::vector<UINT> blobOffsets;
+	std::vector<UINT> blobSizes;
+};
+
+#endif
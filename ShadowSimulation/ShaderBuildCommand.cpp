@@ -0,0 +1,171 @@
+//
+// Compiles the shader permutations the simulation uses into one archive without opening a window
+// Turned on from the command line: -buildshaders in=../ShadowSimulation out=Shaders.perm target=ps_4_0 report=shaders.log
+// Compiling goes through a ShaderCompiler, d3dcompiler on Windows, so the rest of the build can be tested elsewhere
+//
+
+#include "ShaderBuildCommand.h"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "ShaderArchive.h"
+
+#if defined(_MSC_VER)
+#include <d3dcompiler.h>
+#include "Game.h"
+
+/// <summary>Compiles through D3DCompileFromFile, which resolves includes relative to the source
+/// </summary>
+class D3DShaderCompiler : public ShaderCompiler
+{
+public:
+	bool Compile(const std::string& source, const std::vector<ShaderDefine>& defines, const std::string& target,
+		std::vector<BYTE>& bytecode, std::string& errors)
+	{
+		std::vector<D3D_SHADER_MACRO> macros;
+		for (const ShaderDefine& define : defines)
+		{
+			D3D_SHADER_MACRO macro = { define.name.c_str(), define.value.c_str() };
+			macros.push_back(macro);
+		}
+		D3D_SHADER_MACRO end = { NULL, NULL };
+		macros.push_back(end);
+
+		ID3DBlob* code = NULL;
+		ID3DBlob* messages = NULL;
+		HRESULT hr = D3DCompileFromFile(std::wstring(source.begin(), source.end()).c_str(), &macros[0], D3D_COMPILE_STANDARD_FILE_INCLUDE,
+			"main", target.c_str(), D3DCOMPILE_OPTIMIZATION_LEVEL3, 0, &code, &messages);
+		if (SUCCEEDED(hr))
+			bytecode.assign((const BYTE*)code->GetBufferPointer(), (const BYTE*)code->GetBufferPointer() + code->GetBufferSize());
+		errors = messages ? (const char*)messages->GetBufferPointer() : "";
+		ReleaseMacro(code);
+		ReleaseMacro(messages);
+		return SUCCEEDED(hr);
+	}
+};
+#endif
+
+ShaderBuildCommand::ShaderBuildCommand() :
+enabled(false),
+inputPath("../ShadowSimulation"),
+outputPath("Shaders.perm"),
+target("ps_4_0"),
+reportPath("shaders.log"),
+log(NULL)
+{
+
+}
+
+bool ShaderBuildCommand::ParseCommandLine(const char* cmdLine)
+{
+	if (!cmdLine)
+		return false;
+
+	std::istringstream args(cmdLine);
+	std::string arg;
+	while (args >> arg)
+	{
+		if (arg == "-buildshaders")
+		{
+			enabled = true;
+			continue;
+		}
+
+		size_t split = arg.find('=');
+		if (split == std::string::npos)
+			continue;
+
+		std::string key = arg.substr(0, split);
+		std::string value = arg.substr(split + 1);
+		if (key == "in")
+			inputPath = value;
+		else if (key == "out")
+			outputPath = value;
+		else if (key == "target")
+			target = value;
+		else if (key == "report")
+			reportPath = value;
+	}
+	return enabled;
+}
+
+void ShaderBuildCommand::SetLog(std::ostream* _log)
+{
+	log = _log;
+}
+
+int ShaderBuildCommand::Run()
+{
+#if defined(_MSC_VER)
+	D3DShaderCompiler compiler;
+	return Run(compiler);
+#else
+	OutputDebugStringA("-buildshaders compiles through d3dcompiler, which only the Windows build has\n");
+	return 1;
+#endif
+}
+
+int ShaderBuildCommand::Run(ShaderCompiler& compiler)
+{
+	std::vector<ShaderPermutation> permutations;
+	ShaderPermutations::GetUsed(permutations);
+
+	std::ostringstream report;
+	report << std::fixed << std::setprecision(2);
+
+	ShaderArchive archive;
+	UINT failures = 0;
+	size_t compiledBytes = 0;
+	for (const ShaderPermutation& permutation : permutations)
+	{
+		std::vector<ShaderDefine> defines;
+		ShaderPermutations::GetDefines(permutation.features, defines);
+
+		std::string source = inputPath + "/" + permutation.shader + ".hlsli";
+		std::string name = permutation.shader + " " + ShaderPermutations::GetName(permutation.features);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::vector<BYTE> code;
+		std::string errors;
+		bool compiled = compiler.Compile(source, defines, target, code, errors) && !code.empty();
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+		if (!compiled)
+		{
+			report << name << ": failed to compile\n";
+			if (!errors.empty())
+				report << errors << "\n";
+			failures++;
+		}
+		else
+		{
+			archive.Add(permutation.shader, ShaderPermutations::Normalize(permutation.features), &code[0], code.size());
+			compiledBytes += code.size();
+			report << name << ": " << code.size() << " bytes, " << elapsed.count() << " ms\n";
+		}
+	}
+
+	std::vector<BYTE> data;
+	archive.Write(data);
+	std::ofstream file(outputPath.c_str(), std::ios::binary);
+	if (!file.write((const char*)&data[0], data.size()))
+	{
+		report << "Could not write " << outputPath << "\n";
+		failures++;
+	}
+
+	report << "\nCompiled " << archive.GetPermutationCount() << " of " << ShaderPermutations::CountAll() << " possible permutations, "
+		<< archive.GetBlobCount() << " distinct\n"
+		<< "Archive " << outputPath << ": " << data.size() / 1024.0 << " KB (" << compiledBytes / 1024.0 << " KB of bytecode before sharing)\n";
+
+	std::ofstream reportFile(reportPath.c_str());
+	reportFile << report.str();
+	if (log)
+		*log << report.str();
+	else
+		OutputDebugStringA(report.str().c_str());
+	return failures == 0 ? 0 : 1;
+}
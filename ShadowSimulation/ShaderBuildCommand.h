@@ -0,0 +1,60 @@
+//
+// Compiles the shader permutations the simulation uses into one archive without opening a window
+// Turned on from the command line: -buildshaders in=../ShadowSimulation out=Shaders.perm target=ps_4_0 report=shaders.log
+// in is the directory holding the shader sources, the default is the source directory seen from the output directory
+//
+
+#ifndef SHADERBUILDCOMMAND_H
+#define SHADERBUILDCOMMAND_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <Windows.h>
+
+#include "ShaderPermutations.h"
+
+/// <summary>Compiles shader sources for a ShaderBuildCommand
+/// </summary>
+class ShaderCompiler
+{
+public:
+	virtual ~ShaderCompiler() {}
+
+	/// <summary>Compiles main in the source file with the defines. On failure errors holds what the compiler said
+	/// </summary>
+	virtual bool Compile(const std::string& source, const std::vector<ShaderDefine>& defines, const std::string& target,
+		std::vector<BYTE>& bytecode, std::string& errors) = 0;
+};
+
+class ShaderBuildCommand
+{
+public:
+	ShaderBuildCommand();
+
+	/// <summary>Reads build settings from the command line. Returns true if -buildshaders was passed
+	/// </summary>
+	bool ParseCommandLine(const char* cmdLine);
+
+	/// <summary>Compiles every used permutation with d3dcompiler, writes the archive and the report. Returns the process
+	/// exit code. Only the Windows build has a compiler, elsewhere this fails
+	/// </summary>
+	int Run();
+
+	/// <summary>Run with the given compiler
+	/// </summary>
+	int Run(ShaderCompiler& compiler);
+
+	/// <summary>Where the report is echoed besides the report file. NULL, the default, echoes it to the debugger
+	/// </summary>
+	void SetLog(std::ostream* log);
+private:
+	bool enabled;
+	std::string inputPath;
+	std::string outputPath;
+	std::string target;
+	std::string reportPath;
+	std::ostream* log;
+};
+
+#endif
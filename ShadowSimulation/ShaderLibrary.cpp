@@ -0,0 +1,203 @@
+//
+// Loads each compiled shader once and shares the device objects made from it
+//
+
+#include "ShaderLibrary.h"
+
+#include <fstream>
+#include <utility>
+
+#include "Game.h"
+#include "Profiler.h"
+#include "TextureCache.h"
+#include "TrackedResources.h"
+
+ShaderLibrary::ShaderLibrary() :
+fileHits(0),
+layoutHits(0)
+{
+
+}
+
+ShaderLibrary::~ShaderLibrary()
+{
+	for (std::map<UINT64, Blob>::iterator it = blobs.begin(); it != blobs.end(); ++it)
+	{
+		for (ID3D11DeviceChild*& shader : it->second.shaders)
+			ReleaseMacro(shader);
+	}
+	for (std::map<std::pair<UINT64, UINT64>, ID3D11InputLayout*>::iterator it = layouts.begin(); it != layouts.end(); ++it)
+		ReleaseMacro(it->second);
+}
+
+UINT64 ShaderLibrary::Load(const std::wstring& path)
+{
+	PROFILE_ZONE("ShaderLibrary::Load");
+	std::wstring key = TextureCache::Canonicalize(path);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::map<std::wstring, UINT64>::iterator file = files.find(key);
+		if (file != files.end())
+		{
+			fileHits++;
+			return file->second;
+		}
+	}
+
+	// Read without the lock so loader threads can read different files at once
+	std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+	if (!file)
+		return 0;
+	std::streamsize size = file.tellg();
+	if (size <= 0)
+		return 0;
+
+	std::vector<BYTE> bytecode((size_t)size);
+	file.seekg(0, std::ios::beg);
+	if (!file.read((char*)&bytecode[0], size))
+		return 0;
+
+	UINT64 hash = Add(&bytecode[0], bytecode.size());
+	std::lock_guard<std::mutex> lock(mutex);
+	files[key] = hash;
+	return hash;
+}
+
+UINT64 ShaderLibrary::Add(const BYTE* bytecode, size_t size)
+{
+	if (!bytecode || size == 0)
+		return 0;
+
+	UINT64 hash = ShaderReflection::Hash(bytecode, size);
+	if (hash == 0)
+		hash = 1;
+
+	// Identical bytecode under another name keeps the copy already loaded
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (blobs.find(hash) != blobs.end())
+			return hash;
+	}
+
+	// Pixel and compute shaders have signatures too, a shader without one just can't get an input layout
+	Blob blob;
+	blob.bytecode.assign(bytecode, bytecode + size);
+	ShaderReflection::ReadInputSignature(bytecode, size, blob.inputs);
+	blob.signature = ShaderReflection::HashInputSignature(blob.inputs);
+	for (ID3D11DeviceChild*& shader : blob.shaders)
+		shader = NULL;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (blobs.find(hash) == blobs.end())
+		blobs.insert(std::make_pair(hash, std::move(blob)));
+	return hash;
+}
+
+ID3D11DeviceChild* ShaderLibrary::GetShader(UINT64 hash, ShaderType type, ID3D11Device* dev)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::map<UINT64, Blob>::iterator it = blobs.find(hash);
+	if (it == blobs.end())
+		return NULL;
+
+	Blob& blob = it->second;
+	if (blob.shaders[type])
+		return blob.shaders[type];
+
+	const void* code = &blob.bytecode[0];
+	SIZE_T size = blob.bytecode.size();
+	HRESULT hr = E_INVALIDARG;
+	switch (type)
+	{
+	case Vert:
+		hr = dev->CreateVertexShader(code, size, NULL, (ID3D11VertexShader**)&blob.shaders[type]);
+		break;
+	case Pixel:
+		hr = dev->CreatePixelShader(code, size, NULL, (ID3D11PixelShader**)&blob.shaders[type]);
+		break;
+	case Geometry:
+		hr = dev->CreateGeometryShader(code, size, NULL, (ID3D11GeometryShader**)&blob.shaders[type]);
+		break;
+	case Compute:
+		hr = dev->CreateComputeShader(code, size, NULL, (ID3D11ComputeShader**)&blob.shaders[type]);
+		break;
+	case Domain:
+		hr = dev->CreateDomainShader(code, size, NULL, (ID3D11DomainShader**)&blob.shaders[type]);
+		break;
+	}
+
+	if (FAILED(hr))
+		blob.shaders[type] = NULL;
+	else
+		TrackedResources::Track(blob.shaders[type], MemoryShader, "ShaderLibrary", size);
+	return blob.shaders[type];
+}
+
+ID3D11InputLayout* ShaderLibrary::GetInputLayout(UINT64 hash, const VertexFormat& format, ID3D11Device* dev)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::map<UINT64, Blob>::iterator it = blobs.find(hash);
+	if (it == blobs.end())
+		return NULL;
+
+	const Blob& blob = it->second;
+	std::pair<UINT64, UINT64> key(blob.signature, ShaderReflection::HashVertexFormat(format));
+	std::map<std::pair<UINT64, UINT64>, ID3D11InputLayout*>::iterator layout = layouts.find(key);
+	if (layout != layouts.end())
+	{
+		layoutHits++;
+		return layout->second;
+	}
+
+	std::string error;
+	if (!ShaderReflection::MatchVertexFormat(blob.inputs, format, error))
+	{
+		error += "\n";
+		OutputDebugStringA(error.c_str());
+		return NULL;
+	}
+
+	// Every attribute goes in the layout, so it also fits shaders that read fewer of them
+	std::vector<D3D11_INPUT_ELEMENT_DESC> elements(format.attributeCount);
+	for (UINT i = 0; i < format.attributeCount; i++)
+	{
+		const VertexAttribute& attribute = format.attributes[i];
+		D3D11_INPUT_ELEMENT_DESC& element = elements[i];
+		element.SemanticName = attribute.semantic;
+		element.SemanticIndex = attribute.semanticIndex;
+		element.Format = attribute.format;
+		element.InputSlot = 0;
+		element.AlignedByteOffset = attribute.offset;
+		element.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+		element.InstanceDataStepRate = 0;
+	}
+
+	ID3D11InputLayout* inputLayout = NULL;
+	if (FAILED(dev->CreateInputLayout(&elements[0], (UINT)elements.size(), &blob.bytecode[0], blob.bytecode.size(), &inputLayout)))
+		return NULL;
+
+	layouts[key] = inputLayout;
+	return inputLayout;
+}
+
+ShaderLibraryStats ShaderLibrary::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	ShaderLibraryStats stats;
+	stats.files = (UINT)files.size();
+	stats.blobs = (UINT)blobs.size();
+	stats.fileHits = fileHits;
+	stats.shaders = 0;
+	stats.layouts = (UINT)layouts.size();
+	stats.layoutHits = layoutHits;
+
+	for (std::map<UINT64, Blob>::const_iterator it = blobs.begin(); it != blobs.end(); ++it)
+	{
+		for (ID3D11DeviceChild* shader : it->second.shaders)
+		{
+			if (shader)
+				stats.shaders++;
+		}
+	}
+	return stats;
+}
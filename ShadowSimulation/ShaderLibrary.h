@@ -0,0 +1,71 @@
+//
+// Loads each compiled shader once and shares the device objects made from it
+// Bytecode is keyed by a hash of its contents, so two paths to the same file (or two identical files) share one entry
+// Input layouts are built from the vertex shader's signature and cached per signature and vertex format
+//
+
+#ifndef SHADERLIBRARY_H
+#define SHADERLIBRARY_H
+
+#include <d3d11.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Shader.h"
+#include "ShaderReflection.h"
+
+struct ShaderLibraryStats
+{
+	UINT files;		// Distinct paths loaded
+	UINT blobs;		// Distinct bytecode after deduplication
+	UINT fileHits;	// Loads answered without reading the file
+	UINT shaders;
+	UINT layouts;
+	UINT layoutHits;	// Layouts shared between shaders declaring the same inputs
+};
+
+class ShaderLibrary
+{
+public:
+	ShaderLibrary();
+	~ShaderLibrary();
+
+	/// <summary>Reads a compiled shader and returns the hash of its bytecode, or 0 if it couldn't be read
+	/// Files already loaded aren't read again. Safe to call from loader threads
+	/// </summary>
+	UINT64 Load(const std::wstring& path);
+
+	/// <summary>Adds bytecode read elsewhere, e.g. out of a permutation archive, and returns its hash
+	/// </summary>
+	UINT64 Add(const BYTE* bytecode, size_t size);
+
+	/// <summary>Returns the shader created from the bytecode, creating it on first use. The library keeps the reference
+	/// </summary>
+	ID3D11DeviceChild* GetShader(UINT64 hash, ShaderType type, ID3D11Device* dev);
+
+	/// <summary>Returns an input layout feeding format to the vertex shader, the library keeps the reference
+	/// Returns NULL if format is missing an input the shader declares
+	/// </summary>
+	ID3D11InputLayout* GetInputLayout(UINT64 hash, const VertexFormat& format, ID3D11Device* dev);
+
+	ShaderLibraryStats GetStats() const;
+private:
+	struct Blob
+	{
+		std::vector<BYTE> bytecode;
+		std::vector<ShaderInputElement> inputs;
+		UINT64 signature;
+		ID3D11DeviceChild* shaders[5];	// One per ShaderType
+	};
+
+	std::map<std::wstring, UINT64> files;
+	std::map<UINT64, Blob> blobs;
+	std::map<std::pair<UINT64, UINT64>, ID3D11InputLayout*> layouts;	// Keyed by signature and vertex format hash
+	UINT fileHits;
+	UINT layoutHits;
+	mutable std::mutex mutex;
+};
+
+#endif
@@ -0,0 +1,104 @@
+//
+// Feature masks for the lit pixel shader and the macros each feature compiles with
+//
+
+#include "ShaderPermutations.h"
+
+// Every light but the directional one, whose direction is left at zero so it adds nothing, 3x3 PCF and fog
+static const UINT SceneFeatures = FeaturePointLight | FeatureSpotLight | FeatureShadows | FeaturePCF9 | FeatureFog;
+
+UINT ShaderPermutations::Normalize(UINT features)
+{
+	features &= FeatureAll | FeatureTextureArray | FeaturePCF4;
+	if (!(features & FeatureShadows))
+		features &= ~(FeaturePCF4 | FeaturePCF9);
+	if (features & FeaturePCF9)
+		features &= ~FeaturePCF4;
+	return features;
+}
+
+void ShaderPermutations::GetDefines(UINT features, std::vector<ShaderDefine>& defines)
+{
+	features = Normalize(features);
+	defines.clear();
+
+	ShaderDefine define;
+	define.name = "NORMAL_MAP";
+	define.value = features & FeatureNormalMap ? "1" : "0";
+	defines.push_back(define);
+	define.name = "TEXTURE_ARRAY";
+	define.value = features & FeatureTextureArray ? "1" : "0";
+	defines.push_back(define);
+	define.name = "NUM_DIR";
+	define.value = features & FeatureDirectionalLight ? "1" : "0";
+	defines.push_back(define);
+	define.name = "NUM_POINT";
+	define.value = features & FeaturePointLight ? "1" : "0";
+	defines.push_back(define);
+	define.name = "NUM_SPOT";
+	define.value = features & FeatureSpotLight ? "1" : "0";
+	defines.push_back(define);
+	define.name = "SHADOWS";
+	define.value = features & FeatureShadows ? "1" : "0";
+	defines.push_back(define);
+	define.name = "PCF_TAPS";
+	define.value = features & FeaturePCF9 ? "9" : (features & FeaturePCF4 ? "4" : "1");
+	defines.push_back(define);
+	define.name = "FOG";
+	define.value = features & FeatureFog ? "1" : "0";
+	defines.push_back(define);
+}
+
+std::string ShaderPermutations::GetName(UINT features)
+{
+	static const struct { UINT feature; const char* name; } names[] =
+	{
+		{ FeatureNormalMap, "NORMAL_MAP" },
+		{ FeatureTextureArray, "TEXTURE_ARRAY" },
+		{ FeatureDirectionalLight, "DIR" },
+		{ FeaturePointLight, "POINT" },
+		{ FeatureSpotLight, "SPOT" },
+		{ FeatureShadows, "SHADOWS" },
+		{ FeaturePCF4, "PCF4" },
+		{ FeaturePCF9, "PCF9" },
+		{ FeatureFog, "FOG" }
+	};
+
+	features = Normalize(features);
+	std::string name;
+	for (UINT i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+	{
+		if (!(features & names[i].feature))
+			continue;
+		if (!name.empty())
+			name += "|";
+		name += names[i].name;
+	}
+	return name.empty() ? "NONE" : name;
+}
+
+UINT ShaderPermutations::CountAll()
+{
+	// Six on/off features, then shadows off or on with 1, 4 or 9 taps
+	return (1 << 6) * 4;
+}
+
+UINT ShaderPermutations::GetSceneFeatures()
+{
+	return SceneFeatures;
+}
+
+void ShaderPermutations::GetUsed(std::vector<ShaderPermutation>& permutations)
+{
+	permutations.clear();
+
+	// Brick and default materials, each with its textures streamed or in the atlas
+	const UINT materials[] = { FeatureNormalMap, 0, FeatureNormalMap | FeatureTextureArray, FeatureTextureArray };
+	for (UINT material : materials)
+	{
+		ShaderPermutation permutation;
+		permutation.shader = "LitPixel";
+		permutation.features = Normalize(material | SceneFeatures);
+		permutations.push_back(permutation);
+	}
+}
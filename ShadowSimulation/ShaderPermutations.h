@@ -0,0 +1,72 @@
+//
+// Feature masks for the lit pixel shader and the macros each feature compiles with
+// Lists the permutations the simulation uses, -buildshaders compiles only those into the permutation archive
+//
+
+#ifndef SHADERPERMUTATIONS_H
+#define SHADERPERMUTATIONS_H
+
+#include <string>
+#include <vector>
+#include <Windows.h>
+
+enum ShaderFeature
+{
+	FeatureNormalMap = 1 << 0,
+	FeatureTextureArray = 1 << 1,
+	FeatureDirectionalLight = 1 << 2,
+	FeaturePointLight = 1 << 3,
+	FeatureSpotLight = 1 << 4,
+	FeatureShadows = 1 << 5,
+	FeaturePCF4 = 1 << 6,		// 2x2 PCF, without either PCF bit shadows take a single tap
+	FeaturePCF9 = 1 << 7,		// 3x3 PCF, wins over FeaturePCF4
+	FeatureFog = 1 << 8,
+
+	// What DefaultPixel.cso is compiled with
+	FeatureAll = FeatureNormalMap | FeatureDirectionalLight | FeaturePointLight | FeatureSpotLight | FeatureShadows | FeaturePCF9 | FeatureFog
+};
+
+struct ShaderDefine
+{
+	std::string name;
+	std::string value;
+};
+
+/// <summary>A shader source and the feature mask it is compiled with
+/// </summary>
+struct ShaderPermutation
+{
+	std::string shader;
+	UINT features;
+};
+
+class ShaderPermutations
+{
+public:
+	/// <summary>Drops bits that don't change the compiled shader, PCF without shadows or both PCF sizes at once
+	/// Every mask is normalized before it is compiled or looked up
+	/// </summary>
+	static UINT Normalize(UINT features);
+
+	/// <summary>Macros LitPixel.hlsli is compiled with for a feature mask
+	/// </summary>
+	static void GetDefines(UINT features, std::vector<ShaderDefine>& defines);
+
+	/// <summary>Readable list of the features, e.g. "NORMAL_MAP|POINT|SHADOWS|PCF9"
+	/// </summary>
+	static std::string GetName(UINT features);
+
+	/// <summary>Number of distinct normalized masks, what compiling every combination would produce
+	/// </summary>
+	static UINT CountAll();
+
+	/// <summary>Lighting features the simulation's scene turns on, the materials add their own bits
+	/// </summary>
+	static UINT GetSceneFeatures();
+
+	/// <summary>Fills permutations with every shader and mask the simulation's materials can ask for
+	/// </summary>
+	static void GetUsed(std::vector<ShaderPermutation>& permutations);
+};
+
+#endif
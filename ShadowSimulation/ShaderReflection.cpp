@@ -0,0 +1,196 @@
+//
+// Reads the input signature out of compiled shader bytecode and checks it against a vertex format
+// Container layout: "DXBC", 16 byte checksum, version, total size, chunk count, then one offset per chunk
+// Each chunk is a four character code and a size followed by its data
+//
+
+#include "ShaderReflection.h"
+
+#include <cstring>
+#include <sstream>
+
+static const UINT64 FNVPrime = 1099511628211ULL;
+
+static UINT ReadUInt(const BYTE* data)
+{
+	UINT value;
+	memcpy(&value, data, sizeof(UINT));
+	return value;
+}
+
+UINT64 ShaderReflection::Hash(const void* data, size_t size, UINT64 hash)
+{
+	const BYTE* bytes = (const BYTE*)data;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= FNVPrime;
+	}
+	return hash;
+}
+
+bool ShaderReflection::ReadInputSignature(const BYTE* bytecode, size_t size, std::vector<ShaderInputElement>& inputs)
+{
+	inputs.clear();
+	if (!bytecode || size < 32 || memcmp(bytecode, "DXBC", 4) != 0)
+		return false;
+
+	UINT totalSize = ReadUInt(bytecode + 24);
+	UINT chunkCount = ReadUInt(bytecode + 28);
+	if (totalSize > size || chunkCount > (size - 32) / 4)
+		return false;
+
+	for (UINT chunk = 0; chunk < chunkCount; chunk++)
+	{
+		UINT offset = ReadUInt(bytecode + 32 + chunk * 4);
+		if (offset > size - 8)
+			return false;
+
+		const BYTE* header = bytecode + offset;
+		UINT chunkSize = ReadUInt(header + 4);
+		if (chunkSize > size - offset - 8)
+			return false;
+
+		// ISG1 is the newer layout with a stream index in front and min precision at the end
+		bool extended = memcmp(header, "ISG1", 4) == 0;
+		if (!extended && memcmp(header, "ISGN", 4) != 0)
+			continue;
+
+		const BYTE* data = header + 8;
+		if (chunkSize < 8)
+			return false;
+
+		UINT count = ReadUInt(data);
+		UINT elementOffset = ReadUInt(data + 4);
+		UINT stride = extended ? 32 : 24;
+		if (elementOffset > chunkSize || count > (chunkSize - elementOffset) / stride)
+			return false;
+
+		for (UINT i = 0; i < count; i++)
+		{
+			const BYTE* element = data + elementOffset + i * stride + (extended ? 4 : 0);
+			UINT nameOffset = ReadUInt(element);
+			if (nameOffset >= chunkSize)
+				return false;
+
+			// Names are null terminated strings inside the chunk
+			const char* name = (const char*)data + nameOffset;
+			size_t length = 0;
+			while (nameOffset + length < chunkSize && name[length])
+				length++;
+			if (nameOffset + length == chunkSize)
+				return false;
+
+			ShaderInputElement input;
+			input.semantic.assign(name, length);
+			input.semanticIndex = ReadUInt(element + 4);
+			input.systemValue = ReadUInt(element + 8);
+			UINT componentType = ReadUInt(element + 12);
+			input.componentType = componentType <= ComponentFloat ? (ShaderComponentType)componentType : ComponentUnknown;
+			input.registerIndex = ReadUInt(element + 16);
+			input.mask = element[20];
+			inputs.push_back(input);
+		}
+		return true;
+	}
+
+	// Shaders without inputs still have an empty signature chunk
+	return false;
+}
+
+UINT64 ShaderReflection::HashInputSignature(const std::vector<ShaderInputElement>& inputs)
+{
+	UINT64 hash = Hash(NULL, 0);
+	for (const ShaderInputElement& input : inputs)
+	{
+		hash = Hash(input.semantic.c_str(), input.semantic.size() + 1, hash);
+		UINT values[5] = { input.semanticIndex, input.systemValue, (UINT)input.componentType, input.registerIndex, input.mask };
+		hash = Hash(values, sizeof(values), hash);
+	}
+	return hash;
+}
+
+UINT64 ShaderReflection::HashVertexFormat(const VertexFormat& format)
+{
+	UINT64 hash = Hash(&format.stride, sizeof(UINT));
+	for (UINT i = 0; i < format.attributeCount; i++)
+	{
+		const VertexAttribute& attribute = format.attributes[i];
+		hash = Hash(attribute.semantic, strlen(attribute.semantic) + 1, hash);
+		UINT values[3] = { attribute.semanticIndex, (UINT)attribute.format, attribute.offset };
+		hash = Hash(values, sizeof(values), hash);
+	}
+	return hash;
+}
+
+bool ShaderReflection::MatchVertexFormat(const std::vector<ShaderInputElement>& inputs, const VertexFormat& format, std::string& error)
+{
+	for (const ShaderInputElement& input : inputs)
+	{
+		// System values like SV_VertexID are generated by the input assembler
+		if (input.systemValue != 0)
+			continue;
+
+		const VertexAttribute* match = NULL;
+		for (UINT i = 0; i < format.attributeCount && !match; i++)
+		{
+			const VertexAttribute& attribute = format.attributes[i];
+			if (_stricmp(attribute.semantic, input.semantic.c_str()) == 0 && attribute.semanticIndex == input.semanticIndex)
+				match = &attribute;
+		}
+
+		std::ostringstream message;
+		message << format.name << " ";
+		if (!match)
+		{
+			message << "has no attribute for " << input.semantic << input.semanticIndex;
+			error = message.str();
+			return false;
+		}
+
+		// Fewer components than the shader declares is fine, the input assembler fills in the rest
+		UINT components = 0;
+		UINT bytes = 0;
+		ShaderComponentType type = GetFormatInfo(match->format, components, bytes);
+		if (type == ComponentUnknown || type != input.componentType)
+		{
+			message << "stores " << input.semantic << input.semanticIndex << " as a type the shader doesn't read";
+			error = message.str();
+			return false;
+		}
+		if (match->offset + bytes > format.stride)
+		{
+			message << "places " << input.semantic << input.semanticIndex << " past the end of the vertex";
+			error = message.str();
+			return false;
+		}
+	}
+
+	error.clear();
+	return true;
+}
+
+ShaderComponentType ShaderReflection::GetFormatInfo(DXGI_FORMAT format, UINT& components, UINT& bytes)
+{
+	switch (format)
+	{
+	case DXGI_FORMAT_R32G32B32A32_FLOAT: components = 4; bytes = 16; return ComponentFloat;
+	case DXGI_FORMAT_R32G32B32_FLOAT: components = 3; bytes = 12; return ComponentFloat;
+	case DXGI_FORMAT_R32G32_FLOAT: components = 2; bytes = 8; return ComponentFloat;
+	case DXGI_FORMAT_R32_FLOAT: components = 1; bytes = 4; return ComponentFloat;
+	case DXGI_FORMAT_R16G16B16A16_FLOAT: components = 4; bytes = 8; return ComponentFloat;
+	case DXGI_FORMAT_R16G16_FLOAT: components = 2; bytes = 4; return ComponentFloat;
+	case DXGI_FORMAT_R16G16B16A16_SNORM: components = 4; bytes = 8; return ComponentFloat;
+	case DXGI_FORMAT_R16G16_SNORM: components = 2; bytes = 4; return ComponentFloat;
+	case DXGI_FORMAT_R8G8B8A8_UNORM: components = 4; bytes = 4; return ComponentFloat;
+	case DXGI_FORMAT_R8G8B8A8_SNORM: components = 4; bytes = 4; return ComponentFloat;
+	case DXGI_FORMAT_R32G32B32A32_UINT: components = 4; bytes = 16; return ComponentUInt;
+	case DXGI_FORMAT_R32_UINT: components = 1; bytes = 4; return ComponentUInt;
+	case DXGI_FORMAT_R16G16B16A16_UINT: components = 4; bytes = 8; return ComponentUInt;
+	case DXGI_FORMAT_R8G8B8A8_UINT: components = 4; bytes = 4; return ComponentUInt;
+	case DXGI_FORMAT_R32G32B32A32_SINT: components = 4; bytes = 16; return ComponentSInt;
+	case DXGI_FORMAT_R32_SINT: components = 1; bytes = 4; return ComponentSInt;
+	case DXGI_FORMAT_R16G16B16A16_SINT: components = 4; bytes = 8; return ComponentSInt;
+	default: components = 0; bytes = 0; return ComponentUnknown;
+	}
+}
@@ -0,0 +1,80 @@
+//
+// Reads the input signature out of compiled shader bytecode and checks it against a vertex format
+// Works on the raw .cso bytes so it needs no device or d3dcompiler
+//
+
+#ifndef SHADERREFLECTION_H
+#define SHADERREFLECTION_H
+
+#include <string>
+#include <vector>
+#include <Windows.h>
+#include <dxgiformat.h>
+
+/// <summary>Register component types as the bytecode stores them
+/// </summary>
+enum ShaderComponentType
+{
+	ComponentUnknown = 0,
+	ComponentUInt = 1,
+	ComponentSInt = 2,
+	ComponentFloat = 3
+};
+
+struct ShaderInputElement
+{
+	std::string semantic;
+	UINT semanticIndex;
+	UINT systemValue;	// 0 for values read from vertex buffers
+	ShaderComponentType componentType;
+	UINT registerIndex;
+	BYTE mask;			// Components the shader declares
+};
+
+struct VertexAttribute
+{
+	const char* semantic;
+	UINT semanticIndex;
+	DXGI_FORMAT format;
+	UINT offset;
+};
+
+/// <summary>Declares where each attribute sits in a vertex struct
+/// </summary>
+struct VertexFormat
+{
+	const char* name;
+	const VertexAttribute* attributes;
+	UINT attributeCount;
+	UINT stride;
+};
+
+class ShaderReflection
+{
+public:
+	/// <summary>64 bit FNV-1a, pass the previous result as hash to continue over more data
+	/// </summary>
+	static UINT64 Hash(const void* data, size_t size, UINT64 hash = 14695981039346656037ULL);
+
+	/// <summary>Parses the ISGN (or ISG1) chunk of a DXBC container. Returns false if the bytecode is malformed
+	/// </summary>
+	static bool ReadInputSignature(const BYTE* bytecode, size_t size, std::vector<ShaderInputElement>& inputs);
+
+	/// <summary>Hashes what a signature declares, ignoring which components the shader happens to read
+	/// Shaders that declare the same inputs get the same hash and can share an input layout
+	/// </summary>
+	static UINT64 HashInputSignature(const std::vector<ShaderInputElement>& inputs);
+
+	static UINT64 HashVertexFormat(const VertexFormat& format);
+
+	/// <summary>Checks every vertex buffer input the shader declares has an attribute of a compatible type
+	/// Attributes the shader doesn't read are allowed. On failure error says which input didn't match
+	/// </summary>
+	static bool MatchVertexFormat(const std::vector<ShaderInputElement>& inputs, const VertexFormat& format, std::string& error);
+
+	/// <summary>Component type, count and size of a vertex attribute format, ComponentUnknown for formats this doesn't handle
+	/// </summary>
+	static ShaderComponentType GetFormatInfo(DXGI_FORMAT format, UINT& components, UINT& bytes);
+};
+
+#endif
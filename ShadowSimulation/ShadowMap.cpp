@@ -1,5 +1,7 @@
 #include "ShadowMap.h"
 #include "Game.h"
+#include "Profiler.h"
+#include "TrackedResources.h"
 
 ShadowMap::ShadowMap(ID3D11Device* dev, UINT width, UINT height) :
 dsv(0),
@@ -7,6 +9,7 @@ shadowMap(0),
 width(width),
 height(height)
 {
+	PROFILE_ZONE("ShadowMap::Create");
 	viewport.Width = (float)width;
 	viewport.Height = (float)height;
 	viewport.MinDepth = 0.0f;
@@ -29,7 +32,7 @@ height(height)
 	td.MiscFlags = 0;
 
 	ID3D11Texture2D* depthMap = 0;
-	dev->CreateTexture2D(&td, 0, &depthMap);
+	TrackedResources::CreateTexture2D(dev, &td, 0, "ShadowMap", &depthMap);
 
 	D3D11_DEPTH_STENCIL_VIEW_DESC dsvd;
 	ZeroMemory(&dsvd, sizeof(D3D11_DEPTH_STENCIL_VIEW_DESC));
@@ -38,7 +41,7 @@ height(height)
 	dsvd.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
 	dsvd.Texture2D.MipSlice = 0;
 
-	dev->CreateDepthStencilView(depthMap, &dsvd, &dsv);
+	TrackedResources::CreateDepthStencilView(dev, depthMap, &dsvd, "ShadowMap", &dsv);
 
 	D3D11_SHADER_RESOURCE_VIEW_DESC srvd;
 	ZeroMemory(&srvd, sizeof(D3D11_SHADER_RESOURCE_VIEW_DESC));
@@ -46,7 +49,7 @@ height(height)
 	srvd.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
 	srvd.Texture2D.MipLevels = td.MipLevels;
 	srvd.Texture2D.MostDetailedMip = 0;
-	dev->CreateShaderResourceView(depthMap, &srvd, &shadowMap);
+	TrackedResources::CreateShaderResourceView(dev, depthMap, &srvd, "ShadowMap", &shadowMap);
 
 	ReleaseMacro(depthMap);
 }
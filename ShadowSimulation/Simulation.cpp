@@ -2,44 +2,133 @@
 // Environment Simulation made by Justin Bonczek using DirectX 11
 ///
 
-#include <d3dcompiler.h>
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <sstream>
+#include <utility>
 
 #include "Simulation.h"
 #include "Vertex.h"
 #include "Timer.h"
+#include "Profiler.h"
+#include "FrameArena.h"
+#include "LoadGraph.h"
+#include "TrackedResources.h"
+
+// Streaming limits, bytes of decoded data uploaded per frame and GPU memory streamed assets may use
+static const UINT64 StreamUploadBudget = 4 * 1024 * 1024;
+static const UINT64 StreamMemoryCap = 256 * 1024 * 1024;
+static const UINT StreamWorkers = 2;
+
+// Streamed textures nothing draws any more are kept around while the cache is under this size
+static const UINT64 TextureCacheBudget = StreamMemoryCap;
+
+// Occlusion depth buffer sizes, a quarter of the window for the camera and enough for the shadow map's ortho view
+static const UINT CameraOcclusionWidth = 320;
+static const UINT CameraOcclusionHeight = 180;
+static const UINT ShadowOcclusionSize = 256;
+
+// Width and height of the shadow map's orthographic view
+static const float ShadowViewSize = 30.0f;
+
+// Imported models in the benchmark's mesh palette, after the generated sphere
+static const char* BenchmarkModels[] = { "Models/cube.fbx", "Models/pawn.fbx", "Models/chair.fbx" };
+static const UINT BenchmarkModelCount = sizeof(BenchmarkModels) / sizeof(BenchmarkModels[0]);
 
 void Simulation::MoveLight(float dt)
 {
-	if (GetAsyncKeyState('I') & 0x8000)
+	if (input.IsDown(KeyLightForward))
 		sLight.position.z += 10.0f * dt; 
-	if (GetAsyncKeyState('K') & 0x8000)
+	if (input.IsDown(KeyLightBack))
 		sLight.position.z -= 10.0f * dt;
-	if (GetAsyncKeyState('J') & 0x8000)
+	if (input.IsDown(KeyLightLeft))
 		sLight.position.x -= 10.0f * dt;
-	if (GetAsyncKeyState('L') & 0x8000)
+	if (input.IsDown(KeyLightRight))
 		sLight.position.x += 10.0f * dt;
-	if (GetAsyncKeyState('U') & 0x8000)
+	if (input.IsDown(KeyLightUp))
 		sLight.position.y += 10.0f * dt;
-	if (GetAsyncKeyState('O') & 0x8000)
+	if (input.IsDown(KeyLightDown))
 		sLight.position.y -= 10.0f * dt;
 }
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR cmdLine, int showCmd)
 {
-	Simulation simulation(hInstance);
+	// Cooking textures doesn't need a window or a device
+	CookCommand cook;
+	if (cook.ParseCommandLine(cmdLine))
+		return cook.Run();
 
-	if (!simulation.Initialize())
-		return 0;
+	ShaderBuildCommand buildShaders;
+	if (buildShaders.ParseCommandLine(cmdLine))
+		return buildShaders.Run();
+
+	SoftwareRenderCommand softRender;
+	if (softRender.ParseCommandLine(cmdLine))
+		return softRender.Run();
+
+	int result = 1;
+	{
+		Simulation simulation(hInstance, cmdLine);
+		if (simulation.Initialize())
+			result = simulation.Run();
+	}
 
-	return simulation.Run();
+	// The streamers, job pools and loaders join their threads as Simulation is destroyed, so nothing is still
+	// recording and the last few seconds of zones can be read safely
+	Profiler::WriteChromeTrace("profile.json");
+	return result;
 }
 
-Simulation::Simulation(HINSTANCE hInstance) : 
-Game(hInstance)
+Simulation::Simulation(HINSTANCE hInstance, const char* cmdLine) : 
+Game(hInstance),
+input(&keyboard),
+replayLoaded(true),
+wireframeMode(false),
+totalTime(0.0f),
+time(0.0f),
+textureCache(&textureSource),
+cameraVisible(NULL),
+shadowVisible(NULL),
+objectWorlds(NULL),
+terrainObject(NULL),
+characterObject(NULL),
+skinnedShader(NULL),
+skinnedLayout(NULL),
+lastMesh(NULL),
+lastMaterial(NULL)
 {
 	windowTitle = L"Environment Simulation";
 	windowWidth = 1280;
 	windowHeight = 720;
+	updateRate = 60.0f;
+
+	// Benchmarks step in lockstep with a fixed dt so every run simulates the same frames
+	if (benchmark.ParseCommandLine(cmdLine))
+	{
+		windowTitle = L"Environment Simulation (Benchmark)";
+		updateRate = 0.0f;
+	}
+
+	// Replays also run in lockstep so each recorded step maps to exactly one Update
+	replayLoaded = input.ParseCommandLine(cmdLine);
+	if (input.IsReplaying())
+		updateRate = 0.0f;
+
+	atlas.ParseCommandLine(cmdLine);
+
+	cameraOcclusion.ParseCommandLine(cmdLine);
+	cameraOcclusion.Resize(CameraOcclusionWidth, CameraOcclusionHeight);
+	shadowOcclusion.ParseCommandLine(cmdLine);
+	shadowOcclusion.Resize(ShadowOcclusionSize, ShadowOcclusionSize);
+
+	lodSelector.ParseCommandLine(cmdLine);
+	terrain.ParseCommandLine(cmdLine);
+	geometryPool.ParseCommandLine(cmdLine);
+	staticBatcher.ParseCommandLine(cmdLine);
+	meshletCuller.ParseCommandLine(cmdLine);
+	animation.ParseCommandLine(cmdLine);
+	MemoryRegistry::Global().ParseCommandLine(cmdLine);
 }
 
 Simulation::~Simulation()
@@ -49,28 +138,54 @@ Simulation::~Simulation()
 		delete obj;
 		obj = 0;
 	}
+	for (Mesh* mesh : staticBatchMeshes)
+		delete mesh;
+	delete terrainObject;
+	delete characterObject;
 	ReleaseMacro(inputLayout);
+	ReleaseMacro(skinnedLayout);
 	ReleaseMacro(perFrameBuffer);
 	ReleaseMacro(perObjectBuffer);
 	ReleaseMacro(blendState);
 	ReleaseMacro(solid);
 	ReleaseMacro(wireframe)
+
+	textureCache.WriteReport("textures.log");
 }
 
 bool Simulation::Initialize()
 {
+	// Running live instead would record nothing useful and look like a successful replay
+	if (!replayLoaded)
+	{
+		MessageBox(NULL, L"The replay file couldn't be loaded.", NULL, NULL);
+		return false;
+	}
+
 	if (!Game::Initialize())
 		return false;
 
-	LoadAssets();
+	if (!LoadAssets())
+		return false;
+	AssignDrawIds();
 	InitializePipeline();
 
-	m_Camera.SetPosition(0.0f, 5.0f, -10.0f);
+	// The benchmark flythrough already placed the camera
+	if (!benchmark.IsEnabled())
+		m_Camera.SetPosition(0.0f, 5.0f, -10.0f);
+	m_Camera.UpdateViewMatrix();
+
+	// Seed the renderer with the initial state before the update thread starts
+	CaptureState(currentState);
+	previousState = currentState;
+	PublishSnapshot();
 	return true;
 }
 
-void Simulation::LoadAssets()
+bool Simulation::LoadAssets()
 {
+	PROFILE_ZONE("LoadAssets");
+
 	ID3D11SamplerState* wrapSampler;
 	D3D11_SAMPLER_DESC wsd;
 	ZeroMemory(&wsd, sizeof(D3D11_SAMPLER_DESC));
@@ -81,7 +196,7 @@ void Simulation::LoadAssets()
 	wsd.MaxAnisotropy = 0;
 	wsd.ComparisonFunc = D3D11_COMPARISON_NEVER;
 	wsd.MinLOD = 0;
-	wsd.MaxLOD = 0;
+	wsd.MaxLOD = D3D11_FLOAT32_MAX;
 	wsd.MipLODBias = 0;
 	dev->CreateSamplerState(&wsd, &wrapSampler);
 
@@ -93,6 +208,13 @@ void Simulation::LoadAssets()
 	wsd.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
 	dev->CreateSamplerState(&wsd, &pcfSampler);
 	devCon->PSSetSamplers(1, 1, &pcfSampler);
+
+	textureSource.SetDevice(dev);
+	textureCache.SetBudget(TextureCacheBudget);
+	geometryPool.Initialize(dev, devCon);
+	meshletCuller.Initialize(dev);
+	streamer.Initialize(dev, &geometryPool, &textureCache, StreamWorkers);
+	streamer.GetStreamer().SetMemoryCap(StreamMemoryCap);
 	
 	///
 	// Lights
@@ -130,107 +252,508 @@ void Simulation::LoadAssets()
 	perFrameData.fogColor = XMFLOAT4(0.7f, 0.7f, 0.7f, 0.2f);
 
 	///
-	// GameObject Initialization
-	// No separate class needed to manage them for a small simulation
+	// Startup load graph
+	// Files are read and meshes generated on every core, then device objects are created on this thread in one go
+	// No separate class needed to manage the objects for a small simulation
+	///
+	LoadGraph graph;
+
+	// Each shader file is read once through the library, materials using the same shader share one shader object
+	// The skinned vertex shader comes last and is only read with animation on, so a missing one can't stop startup
+	enum { DefaultVS, DefaultPS, NoNormalPS, DefaultArrayPS, NoNormalArrayPS, NoLightVS, NoLightPS, QuadVS, QuadPS, SkinnedVS, ShaderCount };
+	const char* shaderNames[ShaderCount] = { "DefaultVertex.cso", "DefaultPixel.cso", "PixelNoNormal.cso", "DefaultPixelArray.cso", "PixelNoNormalArray.cso",
+		"NoLightVert.cso", "NoLightPixel.cso", "FullScreenQuadVert.cso", "FullScreenQuadPixel.cso", "SkinnedVertex.cso" };
+	const wchar_t* shaderFiles[ShaderCount] = { L"DefaultVertex.cso", L"DefaultPixel.cso", L"PixelNoNormal.cso", L"DefaultPixelArray.cso", L"PixelNoNormalArray.cso",
+		L"NoLightVert.cso", L"NoLightPixel.cso", L"FullScreenQuadVert.cso", L"FullScreenQuadPixel.cso", L"SkinnedVertex.cso" };
+	UINT64 shaderCode[ShaderCount] = {};
+	LoadNodeId shaderNodes[ShaderCount];
+	int shaderLoads = animation.IsEnabled() ? ShaderCount : SkinnedVS;
+	for (int i = 0; i < shaderLoads; i++)
+	{
+		shaderNodes[i] = graph.Add(shaderNames[i], [this, &shaderFiles, &shaderCode, i]()
+		{
+			shaderCode[i] = shaders.Load(shaderFiles[i]);
+			return shaderCode[i] != 0;
+		});
+	}
+
+	// Precompiled permutations, optional since the plain shaders cover every feature combination
+	LoadNodeId permutationNode = graph.Add("ShaderArchive", [this]()
+	{
+		permutations.Load(L"Shaders.perm");
+		return true;
+	});
+
+	///
+	// Meshes
+	///
+	MeshData plane, sphere, screenQuad;
+	Mesh* planeMesh = NULL;
+	Mesh* sphereMesh = NULL;
+	Mesh* screenQuadMesh = NULL;
+
+	LoadNodeId planeNode = graph.Add("PlaneMesh",
+		[&]() { MeshGenerator::CreatePlane(25.0f, 25.0f, 2, 2, plane); return true; },
+		[&]() { planeMesh = new Mesh(plane, geometryPool, "PlaneMesh"); return true; });
+
+	LoadNodeId sphereNode = graph.Add("SphereMesh",
+		[&]() { MeshGenerator::CreateSphere(1.0f, 2, sphere); return true; },
+		[&]() { sphereMesh = new Mesh(sphere, geometryPool, "SphereMesh"); return true; });
+
+	LoadNodeId screenQuadNode = graph.Add("ScreenQuadMesh",
+		[&]()
+		{
+			screenQuad.vertices.push_back(Vertex(XMFLOAT3(0.5f, -0.5f, 0.1f), XMFLOAT2(0.0f, 0.0f)));
+			screenQuad.vertices.push_back(Vertex(XMFLOAT3(1.0f, -0.5f, 0.1f), XMFLOAT2(1.0f, 0.0f)));
+			screenQuad.vertices.push_back(Vertex(XMFLOAT3(0.5f, -1.0f, 0.1f), XMFLOAT2(0.0f, 1.0f)));
+			screenQuad.vertices.push_back(Vertex(XMFLOAT3(1.0f, -1.0f, 0.1f), XMFLOAT2(1.0f, 1.0f)));
+			screenQuad.indices.push_back(0);
+			screenQuad.indices.push_back(1);
+			screenQuad.indices.push_back(2);
+			screenQuad.indices.push_back(1);
+			screenQuad.indices.push_back(3);
+			screenQuad.indices.push_back(2);
+			return true;
+		},
+		[&]() { screenQuadMesh = new Mesh(screenQuad, geometryPool, "ScreenQuadMesh"); return true; });
+
+	// Models static objects are merged from, read on a loader thread so batching only has to transform them.
+	// The objects still draw through the streamer if batching is off or leaves them out
+	std::map<std::string, MeshData> staticMeshes;
+	if (staticBatcher.IsEnabled())
+	{
+		if (benchmark.IsEnabled())
+		{
+			for (UINT i = 0; i < BenchmarkModelCount; i++)
+				staticMeshes[BenchmarkModels[i]];
+		}
+		else
+			staticMeshes["Models/chair.fbx"];
+	}
+
+	LoadNodeId staticMeshNode = graph.Add("StaticMeshes", [&]()
+	{
+		for (std::map<std::string, MeshData>::iterator mesh = staticMeshes.begin(); mesh != staticMeshes.end(); ++mesh)
+		{
+			if (!Mesh::Load(mesh->first.c_str(), mesh->second))
+				mesh->second = MeshData();
+		}
+		return true;
+	});
+
+	///
+	// Materials, textures are streamed in after startup unless they're packed into the atlas
+	///
+	const wchar_t* brickDiffuse = L"Textures/floor_tiles.png";
+	const wchar_t* brickNormal = L"Textures/floor_tiles_normal.png";
+	const wchar_t* defaultDiffuse = L"Textures/default.png";
+	const wchar_t* defaultNormal = L"Textures/brick_normal.png";
+	if (atlas.IsEnabled())
+	{
+		atlas.Add(brickDiffuse);
+		atlas.Add(brickNormal);
+		atlas.Add(defaultDiffuse);
+		atlas.Add(defaultNormal);
+	}
+
+	LoadNodeId atlasNode = graph.Add("TextureAtlas",
+		[&]() { return atlas.Decode(); },
+		[&]() { return atlas.Create(dev); });
+
+	Material* brickMat = NULL;
+	Material* defaultMat = NULL;
+	Material* noLightMat = NULL;
+	Material* noLightTexMat = NULL;
+
+	LoadNodeId brickNode = graph.Add("BrickMaterial", std::function<bool()>(), [&]()
+	{
+		LightMaterial* tileLightMat = new LightMaterial();
+		tileLightMat->ambient = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
+		tileLightMat->diffuse = XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f);
+		tileLightMat->specular = XMFLOAT4(0.9f, 0.9f, 0.9f, 64.0f);
+
+		brickMat = new Material(wrapSampler);
+		brickMat->LoadShader(shaders, shaderCode[DefaultVS], Vert, dev);
+		// The permutation compiled for this scene if the archive was built, otherwise the shader with everything on
+		UINT brickFeatures = FeatureNormalMap | ShaderPermutations::GetSceneFeatures() | (atlas.IsEnabled() ? FeatureTextureArray : 0);
+		if (!brickMat->LoadPermutation(shaders, permutations, "LitPixel", brickFeatures, Pixel, dev))
+			brickMat->LoadShader(shaders, shaderCode[atlas.IsEnabled() ? DefaultArrayPS : DefaultPS], Pixel, dev);
+		if (atlas.IsEnabled())
+		{
+			atlas.Apply(brickMat, DiffuseSlot, brickDiffuse);
+			atlas.Apply(brickMat, NormalSlot, brickNormal);
+		}
+		else
+		{
+			streamer.StreamTexture(brickMat, DiffuseSlot, brickDiffuse);
+			streamer.StreamTexture(brickMat, NormalSlot, brickNormal);
+		}
+		brickMat->SetTileX(3.0f);
+		brickMat->SetTileZ(3.0f);
+		brickMat->SetLightMaterial(tileLightMat);
+		return true;
+	});
+	graph.DependsOn(brickNode, shaderNodes[DefaultVS]);
+	graph.DependsOn(brickNode, shaderNodes[DefaultPS]);
+	graph.DependsOn(brickNode, shaderNodes[DefaultArrayPS]);
+	graph.DependsOn(brickNode, atlasNode);
+	graph.DependsOn(brickNode, permutationNode);
+
+	LoadNodeId defaultNode = graph.Add("DefaultMaterial", std::function<bool()>(), [&]()
+	{
+		LightMaterial* chairLightMat = new LightMaterial();
+		chairLightMat->ambient = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
+		chairLightMat->diffuse = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+		chairLightMat->specular = XMFLOAT4(0.0f, 0.0f, 0.0f, 16.0f);
+
+		defaultMat = new Material(wrapSampler);
+		defaultMat->LoadShader(shaders, shaderCode[DefaultVS], Vert, dev);
+		// The permutation compiled for this scene if the archive was built, otherwise the shader with everything on
+		UINT defaultFeatures = ShaderPermutations::GetSceneFeatures() | (atlas.IsEnabled() ? FeatureTextureArray : 0);
+		if (!defaultMat->LoadPermutation(shaders, permutations, "LitPixel", defaultFeatures, Pixel, dev))
+			defaultMat->LoadShader(shaders, shaderCode[atlas.IsEnabled() ? NoNormalArrayPS : NoNormalPS], Pixel, dev);
+		if (atlas.IsEnabled())
+		{
+			atlas.Apply(defaultMat, DiffuseSlot, defaultDiffuse);
+			atlas.Apply(defaultMat, NormalSlot, defaultNormal);
+		}
+		else
+		{
+			streamer.StreamTexture(defaultMat, DiffuseSlot, defaultDiffuse);
+			streamer.StreamTexture(defaultMat, NormalSlot, defaultNormal);
+		}
+		defaultMat->SetTileX(1.0f);
+		defaultMat->SetTileZ(1.0f);
+		defaultMat->SetLightMaterial(chairLightMat);
+		return true;
+	});
+	graph.DependsOn(defaultNode, shaderNodes[DefaultVS]);
+	graph.DependsOn(defaultNode, shaderNodes[NoNormalPS]);
+	graph.DependsOn(defaultNode, shaderNodes[NoNormalArrayPS]);
+	graph.DependsOn(defaultNode, atlasNode);
+	graph.DependsOn(defaultNode, permutationNode);
+
+	LoadNodeId noLightNode = graph.Add("NoLightMaterial", std::function<bool()>(), [&]()
+	{
+		noLightMat = new Material(wrapSampler);
+		noLightMat->LoadShader(shaders, shaderCode[NoLightVS], Vert, dev);
+		noLightMat->LoadShader(shaders, shaderCode[NoLightPS], Pixel, dev);
+		return true;
+	});
+	graph.DependsOn(noLightNode, shaderNodes[NoLightVS]);
+	graph.DependsOn(noLightNode, shaderNodes[NoLightPS]);
+
+	LoadNodeId noLightTexNode = graph.Add("ScreenQuadMaterial", std::function<bool()>(), [&]()
+	{
+		noLightTexMat = new Material(wrapSampler);
+		noLightTexMat->LoadShader(shaders, shaderCode[QuadVS], Vert, dev);
+		noLightTexMat->LoadShader(shaders, shaderCode[QuadPS], Pixel, dev);
+		return true;
+	});
+	graph.DependsOn(noLightTexNode, shaderNodes[QuadVS]);
+	graph.DependsOn(noLightTexNode, shaderNodes[QuadPS]);
+
+	// Built from the vertex shaders' signatures, every vertex shader has to accept the Vertex layout
+	LoadNodeId layoutNode = graph.Add("InputLayout", std::function<bool()>(), [&]()
+	{
+		ID3D11InputLayout* layout = shaders.GetInputLayout(shaderCode[DefaultVS], VertexFormatDefault, dev);
+		if (!layout || !shaders.GetInputLayout(shaderCode[NoLightVS], VertexFormatDefault, dev) ||
+			!shaders.GetInputLayout(shaderCode[QuadVS], VertexFormatDefault, dev))
+			return false;
+		layout->AddRef();
+		inputLayout = layout;
+		return true;
+	});
+	graph.DependsOn(layoutNode, shaderNodes[DefaultVS]);
+	graph.DependsOn(layoutNode, shaderNodes[NoLightVS]);
+	graph.DependsOn(layoutNode, shaderNodes[QuadVS]);
+
+	///
+	// GameObjects
 	// Sets up meshes, materials, light materials, shaders and handles position/rotation/scaling
 	///
-	MeshData plane;
-	MeshGenerator::CreatePlane(25.0f, 25.0f, 2, 2, plane);
-	Mesh* planeMesh = new Mesh(plane, dev);
+	LoadNodeId sceneNode = graph.Add("Scene", std::function<bool()>(), [&]()
+	{
+		if (benchmark.IsEnabled())
+		{
+			LoadBenchmarkScene(brickMat, defaultMat, staticMeshes);
+		}
+		else
+		{
+			GameObject* obj = new GameObject(planeMesh, brickMat);
+			obj->SetPosition(XMFLOAT3(0.0f, 0.0f, 10.0f));
+			obj->SetOccluder(1.0f);
+			obj->SetStatic(true);
+			objects.push_back(obj);
+
+			for (int i = 0; i < 5; i++)
+			{
+				GameObject* chair = new GameObject(streamer.StreamMesh("Models/chair.fbx"), defaultMat);
+				chair->SetPosition(XMFLOAT3(-5.0f, 2.0f, (float)i * 5.0f));
+				chair->SetScale(XMFLOAT3(1.0f, 0.25f, 1.0f));
+				chair->SetRotation(XMFLOAT3(0.0f, PI / 2.0f, 0.0f));
+				chair->SetStatic(true);
+				objects.push_back(chair);
+			}
+
+			for (int i = 0; i < 5; i++)
+			{
+				GameObject* chair = new GameObject(streamer.StreamMesh("Models/chair.fbx"), defaultMat);
+				chair->SetPosition(XMFLOAT3(5.0f, 2.0f, (float)i * 5.0f));
+				chair->SetScale(XMFLOAT3(1.0f, 0.25f, 1.0f));
+				chair->SetRotation(XMFLOAT3(0.0f, -PI/ 2.0f, 0.0f));
+				chair->SetStatic(true);
+				objects.push_back(chair);
+			}
+
+			std::map<Mesh*, const MeshData*> sources;
+			sources[planeMesh] = &plane;
+			sources[streamer.StreamMesh("Models/chair.fbx")] = &staticMeshes["Models/chair.fbx"];
+			BatchStaticObjects(sources);
+		}
 
-	MeshData sphere;
-	MeshGenerator::CreateSphere(1.0f, 2, sphere);
-	Mesh* sphereMesh = new Mesh(sphere, dev);
-
-	MeshData screenQuad;
-	screenQuad.vertices.push_back(Vertex(XMFLOAT3(0.5f, -0.5f, 0.1f), XMFLOAT2(0.0f, 0.0f)));
-	screenQuad.vertices.push_back(Vertex(XMFLOAT3(1.0f, -0.5f, 0.1f), XMFLOAT2(1.0f, 0.0f)));
-	screenQuad.vertices.push_back(Vertex(XMFLOAT3(0.5f, -1.0f, 0.1f), XMFLOAT2(0.0f, 1.0f)));
-	screenQuad.vertices.push_back(Vertex(XMFLOAT3(1.0f, -1.0f, 0.1f), XMFLOAT2(1.0f, 1.0f)));
-	screenQuad.indices.push_back(0);
-	screenQuad.indices.push_back(1);
-	screenQuad.indices.push_back(2);
-	screenQuad.indices.push_back(1);
-	screenQuad.indices.push_back(3);
-	screenQuad.indices.push_back(2);
-	Mesh* screenQuadMesh = new Mesh(screenQuad, dev);
-
-	Material* brickMat = new Material(L"Textures/floor_tiles.png", wrapSampler, dev);
-	brickMat->LoadShader(L"DefaultVertex.cso", Vert, dev);
-	brickMat->LoadShader(L"DefaultPixel.cso", Pixel, dev);
-	brickMat->LoadNormal(L"Textures/floor_tiles_normal.png", dev);
-	brickMat->SetTileX(3.0f);
-	brickMat->SetTileZ(3.0f);
-
-	Material* defaultMat = new Material(L"Textures/default.png", wrapSampler, dev);
-	defaultMat->LoadShader(L"DefaultVertex.cso", Vert, dev);
-	defaultMat->LoadShader(L"PixelNoNormal.cso", Pixel, dev);
-	defaultMat->LoadNormal(L"Textures/brick_normal.png", dev);
-	defaultMat->SetTileX(1.0f);
-	defaultMat->SetTileZ(1.0f);
-
-	Material* noLightMat = new Material(L"NoLightVert.cso", L"NoLightPixel.cso", wrapSampler, dev);
-	Material* noLightTexMat = new Material(L"FullScreenQuadVert.cso", L"FullScreenQuadPixel.cso", wrapSampler, dev);
-
-	LightMaterial* tileLightMat = new LightMaterial();
-	tileLightMat->ambient = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
-	tileLightMat->diffuse = XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f);
-	tileLightMat->specular = XMFLOAT4(0.9f, 0.9f, 0.9f, 64.0f);
-
-	LightMaterial* chairLightMat = new LightMaterial();
-	chairLightMat->ambient = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
-	chairLightMat->diffuse = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-	chairLightMat->specular = XMFLOAT4(0.0f, 0.0f, 0.0f, 16.0f);
-
-	brickMat->SetLightMaterial(tileLightMat);
-	defaultMat->SetLightMaterial(chairLightMat);
-
-	GameObject* obj = new GameObject(planeMesh, brickMat);
-	obj->SetPosition(XMFLOAT3(0.0f, 0.0f, 10.0f));
-	objects.push_back(obj);
-
-	for (int i = 0; i < 5; i++)
-	{
-		GameObject* chair = new GameObject(new Mesh("Models/chair.fbx", dev), defaultMat);
-		chair->SetPosition(XMFLOAT3(-5.0f, 2.0f, (float)i * 5.0f));
-		chair->SetScale(XMFLOAT3(1.0f, 0.25f, 1.0f));
-		chair->SetRotation(XMFLOAT3(0.0f, PI / 2.0f, 0.0f));
-		objects.push_back(chair);
-	}
-
-	for (int i = 0; i < 5; i++)
-	{
-		GameObject* chair = new GameObject(new Mesh("Models/chair.fbx", dev), defaultMat);
-		chair->SetPosition(XMFLOAT3(5.0f, 2.0f, (float)i * 5.0f));
-		chair->SetScale(XMFLOAT3(1.0f, 0.25f, 1.0f));
-		chair->SetRotation(XMFLOAT3(0.0f, -PI/ 2.0f, 0.0f));
-		objects.push_back(chair);
-	}
-
-	cameraDebugSphere = new GameObject(sphereMesh, noLightMat);
-	quarterQuad = new GameObject(screenQuadMesh, noLightTexMat);
+		for (GameObject* obj : objects)
+		{
+			obj->Update(0.0f);
+		}
+
+		if (terrain.IsEnabled())
+		{
+			if (!terrain.Initialize(dev))
+				return false;
+			terrainObject = new GameObject(brickMat);
+		}
+		return true;
+	});
+	graph.DependsOn(sceneNode, planeNode);
+	graph.DependsOn(sceneNode, staticMeshNode);
+	graph.DependsOn(sceneNode, brickNode);
+	graph.DependsOn(sceneNode, defaultNode);
+
+	LoadNodeId debugNode = graph.Add("DebugObjects", std::function<bool()>(), [&]()
+	{
+		cameraDebugSphere = new GameObject(sphereMesh, noLightMat);
+		quarterQuad = new GameObject(screenQuadMesh, noLightTexMat);
+		quarterQuad->Update(0.0f);
+		return true;
+	});
+	graph.DependsOn(debugNode, sphereNode);
+	graph.DependsOn(debugNode, screenQuadNode);
+	graph.DependsOn(debugNode, noLightNode);
+	graph.DependsOn(debugNode, noLightTexNode);
+
+	// A grid of characters in front of the spawn, each starting its clips at a different point and playing them at its
+	// own speed so they don't move in step
+	LoadNodeId characterNode = graph.Add("Characters", std::function<bool()>(), [&]()
+	{
+		if (!animation.IsEnabled())
+			return true;
+		if (!animation.Initialize(dev))
+			return false;
+		ID3D11InputLayout* layout = shaders.GetInputLayout(shaderCode[SkinnedVS], VertexFormatSkinned, dev);
+		skinnedShader = (ID3D11VertexShader*)shaders.GetShader(shaderCode[SkinnedVS], Vert, dev);
+		if (!layout || !skinnedShader)
+			return false;
+		layout->AddRef();
+		skinnedLayout = layout;
+		characterObject = new GameObject(defaultMat);
+
+		UINT count = animation.GetRequestedCharacters();
+		UINT perRow = (UINT)std::ceil(std::sqrt((float)count));
+		float spacing = 1.5f;
+		for (UINT i = 0; i < count; i++)
+		{
+			AnimatedCharacter character;
+			float x = ((float)(i % perRow) - 0.5f * (perRow - 1)) * spacing;
+			float z = 10.0f + ((float)(i / perRow) - 0.5f * (perRow - 1)) * spacing;
+			XMStoreFloat4x4(&character.world, XMMatrixRotationY(0.7f * i) * XMMatrixTranslation(x, 0.0f, z));
+			character.phase = 0.37f * i;
+			character.speed = 0.8f + 0.4f * (i % 7) / 6.0f;
+			character.blendPeriod = 4.0f + (i % 5);
+			animation.AddCharacter(character);
+		}
+		return true;
+	});
+	if (animation.IsEnabled())
+		graph.DependsOn(characterNode, shaderNodes[SkinnedVS]);
+	graph.DependsOn(characterNode, defaultNode);
+
+	bool loaded = graph.Run();
+	graph.WriteTimeline("startup.log");
+
+	std::ostringstream report;
+	report << "Shader archive: " << permutations.GetPermutationCount() << " permutations (" << permutations.GetBlobCount() << " distinct), "
+		<< permutations.GetSize() / 1024 << " KB\n"
+		<< "Brick material: " << (brickMat && brickMat->GetFeatures() ? ShaderPermutations::GetName(brickMat->GetFeatures()) : "DefaultPixel.cso") << "\n"
+		<< "Default material: " << (defaultMat && defaultMat->GetFeatures() ? ShaderPermutations::GetName(defaultMat->GetFeatures()) : "PixelNoNormal.cso") << "\n";
+	const StaticBatchStats& batchStats = staticBatcher.GetStats();
+	report << "Static batching: " << batchStats.batched << " of " << batchStats.instances << " static objects merged into " << batchStats.batches
+		<< " batches, " << batchStats.drawsBefore << " -> " << batchStats.drawsAfter << " draws per pass, " << batchStats.bytes / 1024 << " KB\n";
+	std::set<const Mesh*> meshletMeshes;
+	UINT meshletCount = 0;
+	for (GameObject* object : objects)
+	{
+		const Mesh* mesh = object->GetMesh();
+		if (!mesh->GetMeshlets().meshlets.empty() && meshletMeshes.insert(mesh).second)
+			meshletCount += (UINT)mesh->GetMeshlets().meshlets.size();
+	}
+	report << "Meshlets: " << meshletMeshes.size() << " meshes split into " << meshletCount << " meshlets"
+		<< (meshletCuller.IsEnabled() ? "" : ", culling off") << "\n";
+	if (animation.IsEnabled())
+	{
+		const AnimationStats& animationStats = animation.GetStats();
+		report << "Animation: " << animationStats.characters << " characters of " << animationStats.joints << " joints, "
+			<< animationStats.clips << " clips keeping " << animationStats.keptKeys << " of " << animationStats.rawKeys << " keys, "
+			<< animationStats.rawBytes / 1024 << " KB -> " << animationStats.clipBytes / 1024 << " KB"
+			<< (animation.IsCpuSkinning() ? ", shadows skinned on the CPU" : "") << "\n";
+	}
+	OutputDebugStringA(report.str().c_str());
+	return loaded;
 }	
 
-void Simulation::InitializePipeline()
+void Simulation::LoadBenchmarkScene(Material* groundMat, Material* objectMat, const std::map<std::string, MeshData>& staticMeshes)
 {
-	///
-	// Input Layout
-	///
-	D3D11_INPUT_ELEMENT_DESC vDesc[] = 
+	PROFILE_ZONE("LoadBenchmarkScene");
+
+	// Palette of generated primitives and imported models the scene picks from
+	std::vector<Mesh*> palette;
+
+	MeshData sphere;
+	MeshGenerator::CreateSphere(0.5f, 2, sphere);
+	Mesh::BuildLODs(sphere);
+	palette.push_back(new Mesh(sphere, geometryPool, "BenchmarkSphere"));
+	for (UINT i = 0; i < BenchmarkModelCount; i++)
+		palette.push_back(streamer.StreamMesh(BenchmarkModels[i]));
+
+	// How much of each mesh's bounds is solid, the faceted sphere holds the box inscribed in its smallest radius,
+	// the pawn and chair are too thin to occlude anything
+	const float occluderFills[] = { 0.55f, 1.0f, 0.0f, 0.0f };
+
+	SceneDesc desc = benchmark.GetSceneDesc();
+	desc.meshCount = (UINT)palette.size();
+	SceneGenerator::Generate(desc, benchmarkScene);
+
+	objects.reserve(benchmarkScene.objects.size() + 1);
+
+	MeshData ground;
+	MeshGenerator::CreatePlane(desc.extent, desc.extent, 2, 2, ground);
+	Mesh* groundMesh = new Mesh(ground, geometryPool, "BenchmarkGround");
+	objects.push_back(new GameObject(groundMesh, groundMat));
+	objects.back()->SetOccluder(1.0f);
+	objects.back()->SetStatic(true);
+
+	for (const GeneratedObject& generated : benchmarkScene.objects)
+	{
+		GameObject* obj = new GameObject(palette[generated.mesh], objectMat);
+		obj->SetPosition(generated.position);
+		obj->SetRotation(generated.rotation);
+		obj->SetScale(generated.scale);
+		obj->SetOccluder(occluderFills[generated.mesh]);
+		obj->SetStatic(!generated.dynamic);
+		objects.push_back(obj);
+		benchmarkObjects.push_back(obj);
+	}
+
+	std::map<Mesh*, const MeshData*> sources;
+	sources[palette[0]] = &sphere;
+	sources[groundMesh] = &ground;
+	for (UINT i = 0; i < BenchmarkModelCount; i++)
 	{
-		{ "POSITION", NULL, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, NULL },
-		{ "COLOR", NULL, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, NULL },
-		{ "TEXCOORD", NULL, DXGI_FORMAT_R32G32_FLOAT, 0, 28, D3D11_INPUT_PER_VERTEX_DATA, NULL },
-		{ "NORMAL", NULL, DXGI_FORMAT_R32G32B32_FLOAT, 0, 36, D3D11_INPUT_PER_VERTEX_DATA, NULL },
-		{ "TANGENT", NULL, DXGI_FORMAT_R32G32B32_FLOAT, 0, 48, D3D11_INPUT_PER_VERTEX_DATA, NULL }
-	};
+		std::map<std::string, MeshData>::const_iterator found = staticMeshes.find(BenchmarkModels[i]);
+		if (found != staticMeshes.end())
+			sources[palette[i + 1]] = &found->second;
+	}
+	BatchStaticObjects(sources);
 
-	ID3DBlob* vertexByte;
-	D3DReadFileToBlob(L"DefaultVertex.cso", &vertexByte);
+	// Pin the camera to the start of the flythrough
+	UpdateBenchmark(0.0f);
+}
 
-	dev->CreateInputLayout(vDesc, ARRAYSIZE(vDesc), vertexByte->GetBufferPointer(), vertexByte->GetBufferSize(), &inputLayout);
+void Simulation::BatchStaticObjects(const std::map<Mesh*, const MeshData*>& sources)
+{
+	PROFILE_ZONE("BatchStaticObjects");
+	std::vector<StaticInstance> instances;
+	std::vector<size_t> instanceObjects;
+	std::vector<Material*> materials;
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		GameObject* obj = objects[i];
+		std::map<Mesh*, const MeshData*>::const_iterator source = sources.find(obj->GetMesh());
+		if (!obj->IsStatic() || source == sources.end())
+			continue;
+
+		StaticInstance instance;
+		instance.mesh = source->second;
+		XMStoreFloat4x4(&instance.world, TransformToMatrix(obj->GetTransform()));
+		instance.material = (UINT)(std::find(materials.begin(), materials.end(), obj->GetMaterial()) - materials.begin());
+		if (instance.material == materials.size())
+			materials.push_back(obj->GetMaterial());
+		instances.push_back(instance);
+		instanceObjects.push_back(i);
+	}
 
-	ReleaseMacro(vertexByte);
+	std::vector<StaticBatch> batches;
+	staticBatcher.Build(instances, batches);
+
+	// Merged objects are deleted, occluders among them keep occluding through their boxes
+	std::map<const MeshData*, MeshBounds> sourceBounds;
+	std::vector<bool> merged(objects.size(), false);
+	for (StaticBatch& batch : batches)
+	{
+		for (UINT instance : batch.instances)
+		{
+			GameObject* obj = objects[instanceObjects[instance]];
+			merged[instanceObjects[instance]] = true;
+			float fill = obj->GetOccluderFill();
+			if (fill <= 0.0f)
+				continue;
+
+			const MeshData* data = instances[instance].mesh;
+			if (!sourceBounds.count(data))
+				sourceBounds[data] = ComputeMeshBounds(&data->vertices[0], (UINT)data->vertices.size());
+			StaticOccluder occluder;
+			occluder.bounds = sourceBounds[data];
+			occluder.bounds.extents.x *= fill;
+			occluder.bounds.extents.y *= fill;
+			occluder.bounds.extents.z *= fill;
+			occluder.world = instances[instance].world;
+			staticOccluders.push_back(occluder);
+		}
+	}
+
+	std::set<GameObject*> deleted;
+	std::vector<GameObject*> kept;
+	kept.reserve(objects.size() - staticBatcher.GetStats().batched + batches.size());
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		if (!merged[i])
+		{
+			kept.push_back(objects[i]);
+			continue;
+		}
+		deleted.insert(objects[i]);
+		delete objects[i];
+	}
+	for (GameObject*& obj : benchmarkObjects)
+	{
+		if (deleted.count(obj))
+			obj = NULL;
+	}
+
+	for (StaticBatch& batch : batches)
+	{
+		Mesh* mesh = new Mesh(batch.data, geometryPool, "StaticBatch");
+		staticBatchMeshes.push_back(mesh);
+		GameObject* obj = new GameObject(mesh, materials[batch.material]);
+		obj->SetStatic(true);
+		kept.push_back(obj);
+	}
+	objects.swap(kept);
+}
+
+void Simulation::InitializePipeline()
+{
+	PROFILE_ZONE("InitializePipeline");
 
 	///
 	// Pipeline buffers/ states
@@ -244,13 +767,13 @@ void Simulation::InitializePipeline()
 	cd.CPUAccessFlags = 0;
 	cd.MiscFlags = 0;
 	cd.StructureByteStride = 0;
-	dev->CreateBuffer(&cd, NULL, &perFrameBuffer);
+	TrackedResources::CreateBuffer(dev, &cd, NULL, "Simulation", &perFrameBuffer);
 
 	cd.ByteWidth = sizeof(perObjectData);
-	dev->CreateBuffer(&cd, NULL, &perObjectBuffer);
+	TrackedResources::CreateBuffer(dev, &cd, NULL, "Simulation", &perObjectBuffer);
 
 	cd.ByteWidth = sizeof(shadowData);
-	dev->CreateBuffer(&cd, NULL, &shadowBuffer);
+	TrackedResources::CreateBuffer(dev, &cd, NULL, "Simulation", &shadowBuffer);
 
 	//
 	// Blend State
@@ -290,8 +813,6 @@ void Simulation::InitializePipeline()
 	rd.FillMode = D3D11_FILL_SOLID;
 	dev->CreateRasterizerState(&rd, &solid);
 
-	current = solid;
-
 	//
 	// Depth Stencil States
 	//
@@ -355,37 +876,51 @@ void Simulation::OnResize()
 {
 	Game::OnResize();
 
-	m_Camera.SetLens(0.25f * 3.1415926535f, AspectRatio(), 0.1f, 200.0f);
-	XMStoreFloat4x4(&(perFrameData.projection), XMMatrixTranspose(m_Camera.Proj()));
+	renderCamera.SetLens(0.25f * 3.1415926535f, AspectRatio(), 0.1f, 200.0f);
+	XMStoreFloat4x4(&(perFrameData.projection), XMMatrixTranspose(renderCamera.Proj()));
 }
 
 void Simulation::Update(float dt)
 {
+	PROFILE_ZONE("Update");
+
+	if (benchmark.IsEnabled())
+	{
+		// Nothing moves until streaming has settled, so every run starts measuring from the same state
+		if (benchmark.IsSettling())
+			return;
+		dt = benchmark.GetFixedStep();
+	}
+
+	// Recorded sessions bring their own dt
+	if (!input.BeginStep(dt))
+	{
+		PostQuitMessage(0);
+		return;
+	}
+
+	// Keep the previous state around so the renderer can interpolate towards the new one
+	std::swap(previousState, currentState);
+
 	///
 	// Rudimentary implementation to handle rasterizer state change (space to switch to wireframe/ back)
 	///
 	time += dt;
 	totalTime += dt;
 
-	perFrameData.time = totalTime;
-	if (GetAsyncKeyState(VK_SPACE) && 0x8000 && time > 0.25f)
+	if (input.IsDown(KeyWireframe) && time > 0.25f)
 	{
-		if (current == solid)
-		{
-			current = wireframe;
-			time = 0.0f;
-		}
-		else
-		{
-			current = solid;
-			time = 0.0f;
-		}
-		if (time > 100.0f)
-			time -= 100.0f;
+		wireframeMode = !wireframeMode;
+		time = 0.0f;
+	}
+	if (benchmark.IsEnabled())
+		UpdateBenchmark(dt);
+	if (!benchmark.IsEnabled() || input.IsReplaying())
+	{
+		MoveCamera(dt);
+		MoveLight(dt);
 	}
-	MoveCamera(dt);
-	perFrameData.eyePos = m_Camera.GetPosition();
-	MoveLight(dt);
+	m_Camera.UpdateViewMatrix();
 	cameraDebugSphere->SetPosition(sLight.position);
 	cameraDebugSphere->Update(dt);
 	///
@@ -395,20 +930,348 @@ void Simulation::Update(float dt)
 	XMFLOAT3 direction(-(sLight.position.x), -sLight.position.y, 10.0f - (sLight.position.z));
 	XMStoreFloat3(&sLight.direction, XMVector3Normalize(XMLoadFloat3(&direction)));
 
-	perFrameData.sLight = sLight;
-
 	for (GameObject* obj : objects)
 	{
 		obj->Update(dt);
 	}
 
-	quarterQuad->Update(dt);
+	CaptureState(currentState);
+	PublishSnapshot();
+}
+
+void Simulation::UpdateBenchmark(float dt)
+{
+	// A replayed session steers the camera instead of the flythrough
+	if (!input.IsReplaying())
+	{
+		XMFLOAT3 eye, target;
+		SceneGenerator::SampleCameraPath(benchmarkScene, benchmark.GetProgress(), eye, target);
+		m_Camera.LookAt(eye, target, XMFLOAT3(0.0f, 1.0f, 0.0f));
+	}
+
+	for (size_t i = 0; i < benchmarkScene.objects.size(); i++)
+	{
+		GeneratedObject& generated = benchmarkScene.objects[i];
+		if (!generated.dynamic)
+			continue;
+
+		XMStoreFloat3(&generated.rotation, XMLoadFloat3(&generated.rotation) + XMLoadFloat3(&generated.angularVelocity) * dt);
+		benchmarkObjects[i]->SetRotation(generated.rotation);
+	}
+}
+
+void Simulation::BindNearestLight(const XMFLOAT3& eye)
+{
+	const GeneratedLight* nearest = NULL;
+	float nearestDistance = 0.0f;
+	for (const GeneratedLight& light : benchmarkScene.lights)
+	{
+		float distance = XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&light.position) - XMLoadFloat3(&eye)));
+		if (!nearest || distance < nearestDistance)
+		{
+			nearest = &light;
+			nearestDistance = distance;
+		}
+	}
+
+	if (nearest)
+	{
+		perFrameData.pLight.position = nearest->position;
+		perFrameData.pLight.diffuse = nearest->color;
+		perFrameData.pLight.range = nearest->range;
+	}
+}
+
+void Simulation::CaptureState(SimulationState& state)
+{
+	state.objects.resize(objects.size());
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		state.objects[i] = objects[i]->GetTransform();
+	}
+	state.debugSphere = cameraDebugSphere->GetTransform();
+	state.sLight = sLight;
+
+	state.cameraPosition = m_Camera.GetPosition();
+	state.cameraRight = m_Camera.GetRight();
+	state.cameraUp = m_Camera.GetUp();
+	state.cameraLook = m_Camera.GetLook();
+
+	state.totalTime = totalTime;
+	state.wireframe = wireframeMode;
+}
+
+void Simulation::PublishSnapshot()
+{
+	SimulationSnapshot& snapshot = snapshots.WriteSlot();
+	snapshot.previous = previousState;
+	snapshot.current = currentState;
+	snapshot.stepTime = std::chrono::steady_clock::now();
+	snapshots.Publish();
+}
+
+void Simulation::SetObjectData(const XMMATRIX& world, GameObject* obj)
+{
+	XMStoreFloat4x4(&(perObjectData.world), XMMatrixTranspose(world));
+	XMStoreFloat4x4(&(perObjectData.worldInverseTranspose), XMMatrixTranspose(XMMatrixInverse(nullptr, XMMatrixTranspose(world))));
+	if (obj)
+	{
+		perObjectData.lightMat = obj->GetLightMaterial();
+		perObjectData.tileX = obj->GetTextureTileX();
+		perObjectData.tileZ = obj->GetTextureTileZ();
+
+		// Only read by the texture array shaders
+		Material* mat = obj->GetMaterial();
+		perObjectData.diffuseSlice = mat->GetTextureSlice(DiffuseSlot);
+		perObjectData.normalSlice = mat->GetTextureSlice(NormalSlot);
+		perObjectData.diffuseRect = mat->GetTextureRect(DiffuseSlot);
+		perObjectData.normalRect = mat->GetTextureRect(NormalSlot);
+	}
+	devCon->UpdateSubresource(perObjectBuffer, 0, NULL, &perObjectData, 0, 0);
+	frameStats.bytesUploaded += sizeof(perObjectData);
+}
+
+void Simulation::UpdateStreaming()
+{
+	XMVECTOR eye = XMLoadFloat3(&renderState.cameraPosition);
+
+	// Roughly the size an object appears on screen
+	streamer.ResetPriorities();
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		const TransformState& transform = renderState.objects[i];
+		float size = max(transform.scale.x, max(transform.scale.y, transform.scale.z));
+		float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&transform.position) - eye));
+		streamer.Prioritize(objects[i]->GetMesh(), objects[i]->GetMaterial(), size / max(distance, 0.1f));
+	}
+
+	streamer.Update(StreamUploadBudget);
+	geometryPool.Update();
+	textureCache.Trim();
+	PROFILE_COUNTER("TextureKB", textureCache.GetStats().bytes / 1024);
+	PROFILE_COUNTER("DeviceMB", MemoryRegistry::Global().GetDeviceTotals().bytes / (1024 * 1024));
+	PROFILE_COUNTER("MeshDataKB", MemoryRegistry::Global().GetTotals(MemoryMeshData).bytes / 1024);
+	PROFILE_COUNTER("GeometryPoolKB", (geometryPool.GetStats().usedVertexBytes + geometryPool.GetStats().usedIndexBytes) / 1024);
+}
+
+void Simulation::AssignDrawIds()
+{
+	std::map<Material*, UINT> materialIds;
+	std::map<Mesh*, UINT> meshIds;
+	objectDrawIds.resize(objects.size());
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		// First seen, first numbered, so ids don't depend on where things landed in memory
+		Material* mat = objects[i]->GetMaterial();
+		Mesh* mesh = objects[i]->GetMesh();
+		materialIds.insert(std::make_pair(mat, (UINT)materialIds.size()));
+		meshIds.insert(std::make_pair(mesh, (UINT)meshIds.size()));
+		objectDrawIds[i] = std::make_pair(materialIds[mat], meshIds[mesh]);
+	}
+}
+
+void Simulation::SortDraws(const bool* visible, const std::vector<UINT>& levels)
+{
+	PROFILE_ZONE("SortDraws");
+	drawQueue.Clear();
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		if (visible[i])
+			drawQueue.Add(objectDrawIds[i].first, objectDrawIds[i].second, levels[i], (UINT)i);
+	}
+	drawQueue.Sort();
+}
+
+void Simulation::DrawObject(GameObject* obj)
+{
+	if (obj->GetMesh() != lastMesh || obj->GetMaterial() != lastMaterial)
+		frameStats.stateChanges++;
+	lastMesh = obj->GetMesh();
+	lastMaterial = obj->GetMaterial();
+
+	UINT bufferBinds = geometryBindings.binds;
+	frameStats.textureBinds += obj->Draw(devCon, &textureBindings, &geometryBindings);
+	frameStats.bufferBinds += geometryBindings.binds - bufferBinds;
+	frameStats.draws++;
+	frameStats.triangles += obj->GetIndexCount() / 3;
+}
+
+void Simulation::CullOccluded(OcclusionCuller& culler, const XMMATRIX& viewProjection, bool* visible)
+{
+	std::fill(visible, visible + objects.size(), true);
+	if (!culler.IsEnabled())
+		return;
+
+	XMFLOAT4X4 viewProj;
+	XMStoreFloat4x4(&viewProj, viewProjection);
+	culler.Begin(viewProj);
+
+	MeshBounds bounds;
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		float fill = objects[i]->GetOccluderFill();
+		if (fill <= 0.0f || !objects[i]->GetMesh()->GetBounds(bounds))
+			continue;
+		bounds.extents.x *= fill;
+		bounds.extents.y *= fill;
+		bounds.extents.z *= fill;
+		culler.RenderBox(bounds, objectWorlds[i]);
+	}
+	for (const StaticOccluder& occluder : staticOccluders)
+		culler.RenderBox(occluder.bounds, occluder.world);
+	culler.End();
+
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		if (objects[i]->GetMesh()->GetBounds(bounds))
+			visible[i] = culler.IsVisible(bounds, objectWorlds[i]);
+	}
+}
+
+void Simulation::SelectLODs(LODPass pass, std::vector<UINT>& levels)
+{
+	levels.resize(objects.size(), 0);
+	MeshBounds bounds;
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		const Mesh* mesh = objects[i]->GetMesh();
+		if (mesh->GetBounds(bounds))
+			levels[i] = lodSelector.Select(pass, mesh->GetLODs(), bounds, objectWorlds[i], levels[i]);
+		else
+			levels[i] = 0;
+	}
+}
+
+void Simulation::CullMeshlets(const MeshletView& view, bool* visible, const std::vector<UINT>& levels)
+{
+	LinearArena& arena = FrameArena::Get();
+	MeshletJob* jobs = arena.AllocateArray<MeshletJob>(objects.size());
+	UINT* jobObjects = arena.AllocateArray<UINT>(objects.size());
+	UINT jobCount = 0;
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		objects[i]->SetCulledIndices(NULL, 0, 0);
+		const MeshletData& meshlets = objects[i]->GetMesh()->GetMeshlets();
+		if (!visible[i] || !meshletCuller.ShouldCull(meshlets, levels[i]))
+			continue;
+
+		MeshletJob& job = jobs[jobCount];
+		job.meshlets = &meshlets;
+		job.world = objectWorlds[i];
+		jobObjects[jobCount++] = (UINT)i;
+	}
+	if (jobCount == 0 || !meshletCuller.Cull(devCon, view, jobs, jobCount))
+		return;
+
+	for (UINT i = 0; i < jobCount; i++)
+	{
+		if (jobs[i].indexCount == 0)
+			visible[jobObjects[i]] = false;
+		else
+			objects[jobObjects[i]]->SetCulledIndices(meshletCuller.GetIndexBuffer(), jobs[i].indexStart, jobs[i].indexCount);
+	}
+
+	const MeshletCullStats& stats = meshletCuller.GetStats();
+	frameStats.meshletsCulled += stats.frustumCulled + stats.coneCulled;
+	frameStats.bytesUploaded += (UINT64)stats.triangles * 3 * sizeof(UINT);
+}
+
+void Simulation::DrawTerrain(bool shadowPass)
+{
+	if (!terrainObject)
+		return;
+
+	SetObjectData(XMMatrixIdentity(), terrainObject);
+	if (lastMesh != NULL || terrainObject->GetMaterial() != lastMaterial)
+		frameStats.stateChanges++;
+	lastMesh = NULL;
+	lastMaterial = terrainObject->GetMaterial();
+
+	UINT draws, triangles;
+	frameStats.textureBinds += terrain.Draw(devCon, terrainObject->GetMaterial(), shadowPass, &textureBindings, draws, triangles);
+	geometryBindings.Reset();
+	frameStats.draws += draws;
+	frameStats.triangles += triangles;
+}
+
+void Simulation::DrawCharacters(bool shadowPass)
+{
+	if (!characterObject)
+		return;
+
+	Material* mat = characterObject->GetMaterial();
+	mat->SetShader(devCon);
+	if (shadowPass)
+		devCon->PSSetShader(0, 0, 0);
+	mat->SetSampler(devCon);
+	frameStats.textureBinds += mat->SetResources(devCon, &textureBindings);
+	if (lastMesh != NULL || mat != lastMaterial)
+		frameStats.stateChanges++;
+	lastMesh = NULL;
+	lastMaterial = mat;
+
+	// The CPU skinned vertices are already in world space and go through the default vertex shader
+	UINT count = animation.GetCharacterCount();
+	if (shadowPass && animation.IsCpuSkinning())
+	{
+		SetObjectData(XMMatrixIdentity(), characterObject);
+		frameStats.draws += animation.DrawSkinned(devCon);
+	}
+	else
+	{
+		devCon->VSSetShader(skinnedShader, 0, 0);
+		devCon->IASetInputLayout(skinnedLayout);
+		animation.Bind(devCon);
+		for (UINT i = 0; i < count; i++)
+		{
+			SetObjectData(XMLoadFloat4x4(&animation.GetCharacter(i).world), characterObject);
+			animation.Draw(devCon, i);
+		}
+		devCon->IASetInputLayout(inputLayout);
+		frameStats.draws += count;
+		frameStats.bytesUploaded += (UINT64)count * animation.GetStats().joints * sizeof(SkinMatrix);
+	}
+	frameStats.triangles += count * animation.GetIndexCount() / 3;
+	geometryBindings.Reset();
 }
 
 void Simulation::Draw()
 {
+	PROFILE_ZONE("Draw");
+	FrameArena::BeginFrame();
+	LinearArena& arena = FrameArena::Get();
+
+	// Pick up the newest simulation snapshot and blend between its two states
+	snapshots.Acquire();
+	const SimulationSnapshot& snapshot = snapshots.ReadSlot();
+	float alpha = 1.0f;
+	if (updateThread.IsRunning())
+		alpha = FixedStepSchedule::GetAlpha(std::chrono::steady_clock::now() - snapshot.stepTime, updateThread.GetStepTime());
+	InterpolateState(snapshot.previous, snapshot.current, alpha, renderState);
+
+	objectWorlds = arena.AllocateArray<XMFLOAT4X4>(objects.size());
+	cameraVisible = arena.AllocateArray<bool>(objects.size());
+	shadowVisible = arena.AllocateArray<bool>(objects.size());
+	for (size_t i = 0; i < objects.size(); i++)
+		XMStoreFloat4x4(&objectWorlds[i], TransformToMatrix(renderState.objects[i]));
+
 	// Update camera
-	m_Camera.UpdateViewMatrix();
+	renderCamera.SetPosition(renderState.cameraPosition);
+	renderCamera.SetOrientation(renderState.cameraRight, renderState.cameraUp, renderState.cameraLook);
+	renderCamera.UpdateViewMatrix();
+
+	perFrameData.time = renderState.totalTime;
+	perFrameData.eyePos = renderState.cameraPosition;
+	perFrameData.sLight = renderState.sLight;
+	if (benchmark.IsEnabled())
+		BindNearestLight(renderState.cameraPosition);
+
+	frameStats = FrameStats();
+	geometryBindings.Reset();
+	lastMesh = NULL;
+	lastMaterial = NULL;
+
+	UpdateStreaming();
 
 	// Set up the render target (back buffer) and clear it
 	const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
@@ -419,84 +1282,167 @@ void Simulation::Draw()
 	// Set various states
 	float blendFactors[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
 	devCon->OMSetBlendState(blendState, blendFactors, 0xFFFFFF);
-	devCon->RSSetState(current);
+	devCon->RSSetState(renderState.wireframe ? wireframe : solid);
 	devCon->OMSetDepthStencilState(depthStencilState, 0);
 	
+	// Poses for both passes, the shadow pass's vertices skinned here too when they're done on the CPU
+	if (characterObject)
+	{
+		PROFILE_ZONE("Animation");
+		animation.Evaluate(renderState.totalTime);
+		if (animation.IsCpuSkinning())
+			animation.SkinVertices(devCon);
+	}
+
 	// Render the scene from the light's point of view to create a shadow map
-	shadowMap->BindDSVAndSetNullRenderTarget(devCon);
-	XMMATRIX sView = XMMatrixLookAtLH(XMLoadFloat3(&sLight.position), XMVectorSet(0.0f, 0.0f, 10.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
-	//XMMATRIX sProj = XMMatrixPerspectiveFovLH(0.25f * 3.1415926535f, 1.0, 0.1, 50.0);
-	XMMATRIX sProj = XMMatrixOrthographicLH(30.0f, 30.0f, 0.1f, 200.0f);
-	XMStoreFloat4x4(&perFrameData.view, XMMatrixTranspose(sView));
-	XMStoreFloat4x4(&perFrameData.projection, XMMatrixTranspose(sProj));
-	XMStoreFloat4x4(&shadowData.sView, XMMatrixTranspose(sView));
-	XMStoreFloat4x4(&shadowData.sProj, XMMatrixTranspose(sProj));
-	devCon->UpdateSubresource(perFrameBuffer, 0, NULL, &perFrameData, 0, 0);
-	devCon->UpdateSubresource(shadowBuffer, 0, NULL, &shadowData, 0, 0);
-	for (GameObject* obj : objects)
 	{
-		XMStoreFloat4x4(&(perObjectData.world), XMMatrixTranspose(XMLoadFloat4x4(&(obj->GetWorldMatrix()))));
-		XMStoreFloat4x4(&(perObjectData.worldInverseTranspose), XMMatrixTranspose(XMMatrixInverse(nullptr, XMMatrixTranspose(XMLoadFloat4x4(&(obj->GetWorldMatrix()))))));
-		perObjectData.lightMat = obj->GetLightMaterial();
-		perObjectData.tileX = obj->GetTextureTileX();
-		perObjectData.tileZ = obj->GetTextureTileZ();
-		devCon->UpdateSubresource(perObjectBuffer, 0, NULL, &perObjectData, 0, 0);
-		obj->SetShadowPass(true);
-		obj->Draw(devCon);
+		PROFILE_ZONE("ShadowPass");
+		shadowMap->BindDSVAndSetNullRenderTarget(devCon);
+		textureBindings.Reset();
+		XMVECTOR sTarget = XMVectorSet(0.0f, 0.0f, 10.0f, 0.0f);
+		XMMATRIX sView = XMMatrixLookAtLH(XMLoadFloat3(&renderState.sLight.position), sTarget, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		//XMMATRIX sProj = XMMatrixPerspectiveFovLH(0.25f * 3.1415926535f, 1.0, 0.1, 50.0);
+		XMMATRIX sProj = XMMatrixOrthographicLH(ShadowViewSize, ShadowViewSize, 0.1f, 200.0f);
+		{
+			PROFILE_ZONE("Occlusion");
+			CullOccluded(shadowOcclusion, sView * sProj, shadowVisible);
+			frameStats.shadowOccluded = shadowOcclusion.GetStats().occluded;
+		}
+		lodSelector.SetOrthographic(LODPassShadow, ShadowViewSize, shadowData.resolution);
+		SelectLODs(LODPassShadow, shadowLODs);
+		{
+			PROFILE_ZONE("MeshletCulling");
+			XMFLOAT4X4 sViewProj;
+			XMStoreFloat4x4(&sViewProj, sView * sProj);
+			XMFLOAT3 lightDirection;
+			XMStoreFloat3(&lightDirection, XMVector3Normalize(sTarget - XMLoadFloat3(&renderState.sLight.position)));
+			CullMeshlets(MeshletCuller::OrthographicView(sViewProj, lightDirection), shadowVisible, shadowLODs);
+		}
+		XMStoreFloat4x4(&perFrameData.view, XMMatrixTranspose(sView));
+		XMStoreFloat4x4(&perFrameData.projection, XMMatrixTranspose(sProj));
+		XMStoreFloat4x4(&shadowData.sView, XMMatrixTranspose(sView));
+		XMStoreFloat4x4(&shadowData.sProj, XMMatrixTranspose(sProj));
+		devCon->UpdateSubresource(perFrameBuffer, 0, NULL, &perFrameData, 0, 0);
+		devCon->UpdateSubresource(shadowBuffer, 0, NULL, &shadowData, 0, 0);
+		frameStats.bytesUploaded += sizeof(perFrameData) + sizeof(shadowData);
+		SortDraws(shadowVisible, shadowLODs);
+		for (const DrawItem& draw : drawQueue.GetItems())
+		{
+			GameObject* obj = objects[draw.object];
+			SetObjectData(XMLoadFloat4x4(&objectWorlds[draw.object]), obj);
+			obj->SetShadowPass(true);
+			obj->SetLOD(shadowLODs[draw.object]);
+			DrawObject(obj);
+		}
+
+		// Chunks are picked once a frame for both passes, the shadow view is the only place both matrices are at hand
+		if (terrainObject)
+		{
+			terrain.Update(devCon, renderState.cameraPosition, renderCamera.GetFarZ(), renderCamera.View() * renderCamera.Proj(), sView * sProj);
+			DrawTerrain(true);
+		}
+		DrawCharacters(true);
 	}
+
 	// Reset render target/ view and projection matrices
 	// Set shadowmap to the shader
-	XMStoreFloat4x4(&(perFrameData.view), XMMatrixTranspose(m_Camera.View()));
-	XMStoreFloat4x4(&(perFrameData.projection), XMMatrixTranspose(m_Camera.Proj()));
+	XMStoreFloat4x4(&(perFrameData.view), XMMatrixTranspose(renderCamera.View()));
+	XMStoreFloat4x4(&(perFrameData.projection), XMMatrixTranspose(renderCamera.Proj()));
 	devCon->OMSetRenderTargets(1, &renderTargetView, depthStencilView);
 	devCon->RSSetViewports(1, &viewport);
 	shadowMap->SetSRVToShaders(devCon);
+	textureBindings.Reset();
 
 	devCon->UpdateSubresource(perFrameBuffer, 0, NULL, &perFrameData, 0, 0);
+	frameStats.bytesUploaded += sizeof(perFrameData);
 	// Render the geometry from the camera to the back buffer
-	for (GameObject* obj : objects)
-	{		
-		XMStoreFloat4x4(&(perObjectData.world), XMMatrixTranspose(XMLoadFloat4x4(&(obj->GetWorldMatrix()))));
-		XMStoreFloat4x4(&(perObjectData.worldInverseTranspose), XMMatrixTranspose(XMMatrixInverse(nullptr, XMMatrixTranspose(XMLoadFloat4x4(&(obj->GetWorldMatrix()))))));
-		perObjectData.lightMat = obj->GetLightMaterial();
-		perObjectData.tileX = obj->GetTextureTileX();
-		perObjectData.tileZ = obj->GetTextureTileZ();
-		devCon->UpdateSubresource(perObjectBuffer, 0, NULL, &perObjectData, 0, 0);
-		obj->SetShadowPass(false);
-		obj->Draw(devCon);
+	{
+		PROFILE_ZONE("Occlusion");
+		CullOccluded(cameraOcclusion, renderCamera.View() * renderCamera.Proj(), cameraVisible);
+		frameStats.visible = (UINT)std::count(cameraVisible, cameraVisible + objects.size(), true);
+		frameStats.occluded = cameraOcclusion.GetStats().occluded;
+	}
+	lodSelector.SetPerspective(LODPassCamera, renderState.cameraPosition, renderCamera.GetFovY(), (float)windowHeight);
+	SelectLODs(LODPassCamera, cameraLODs);
+	{
+		PROFILE_ZONE("MeshletCulling");
+		XMFLOAT4X4 viewProj;
+		XMStoreFloat4x4(&viewProj, renderCamera.View() * renderCamera.Proj());
+		CullMeshlets(MeshletCuller::PerspectiveView(viewProj, renderState.cameraPosition), cameraVisible, cameraLODs);
+	}
+	{
+		PROFILE_ZONE("MainPass");
+		SortDraws(cameraVisible, cameraLODs);
+		for (const DrawItem& draw : drawQueue.GetItems())
+		{
+			GameObject* obj = objects[draw.object];
+			SetObjectData(XMLoadFloat4x4(&objectWorlds[draw.object]), obj);
+			obj->SetShadowPass(false);
+			obj->SetLOD(cameraLODs[draw.object]);
+			DrawObject(obj);
+		}
+		DrawTerrain(false);
+		DrawCharacters(false);
 	}
 
 	// Debug drawing
-	XMStoreFloat4x4(&(perObjectData.world), XMMatrixTranspose(XMLoadFloat4x4(&(cameraDebugSphere->GetWorldMatrix()))));
-	XMStoreFloat4x4(&(perObjectData.worldInverseTranspose), XMMatrixTranspose(XMMatrixInverse(nullptr, XMMatrixTranspose(XMLoadFloat4x4(&(cameraDebugSphere->GetWorldMatrix()))))));
-	devCon->UpdateSubresource(perObjectBuffer, 0, NULL, &perObjectData, 0, 0);
-	cameraDebugSphere->Draw(devCon);
+	{
+		PROFILE_ZONE("DebugPass");
+		SetObjectData(TransformToMatrix(renderState.debugSphere), NULL);
+		DrawObject(cameraDebugSphere);
 
-	XMStoreFloat4x4(&(perObjectData.world), XMMatrixTranspose(XMLoadFloat4x4(&(quarterQuad->GetWorldMatrix()))));
-	XMStoreFloat4x4(&(perObjectData.worldInverseTranspose), XMMatrixTranspose(XMMatrixInverse(nullptr, XMMatrixTranspose(XMLoadFloat4x4(&(quarterQuad->GetWorldMatrix()))))));
-	devCon->UpdateSubresource(perObjectBuffer, 0, NULL, &perObjectData, 0, 0);
-	quarterQuad->Draw(devCon);
+		XMFLOAT4X4 quadWorld = quarterQuad->GetWorldMatrix();
+		SetObjectData(XMLoadFloat4x4(&quadWorld), NULL);
+		DrawObject(quarterQuad);
+	}
+	PROFILE_COUNTER("Draws", frameStats.draws);
+	PROFILE_COUNTER("TextureBinds", frameStats.textureBinds);
+	PROFILE_COUNTER("BufferBinds", frameStats.bufferBinds);
+	PROFILE_COUNTER("Occluded", frameStats.occluded);
+	PROFILE_COUNTER("Triangles", frameStats.triangles);
+	PROFILE_COUNTER("MeshletsCulled", frameStats.meshletsCulled);
+
+	// Frame arena use of the last frame every thread finished
+	ArenaStats arenaStats = FrameArena::GetStats();
+	PROFILE_COUNTER("FrameAllocations", arenaStats.allocations);
+	PROFILE_COUNTER("FramePeakKB", arenaStats.peakBytes / 1024);
+	PROFILE_COUNTER("FrameHeapBlocks", arenaStats.heapBlocks);
+	if (terrainObject)
+	{
+		PROFILE_COUNTER("TerrainChunks", terrain.GetStats().selected);
+		PROFILE_COUNTER("TerrainRebuilt", terrain.GetStats().rebuilt);
+	}
 
 	// Swap the buffer pointers!
-	swapChain->Present(0, 0);
+	{
+		PROFILE_ZONE("Present");
+		swapChain->Present(0, 0);
+	}
+
+	bool streamingIdle = streamer.GetStreamer().IsIdle() && terrain.IsStreamingIdle();
+	if (benchmark.IsEnabled() && benchmark.EndFrame(frameStats, streamingIdle))
+	{
+		benchmark.WriteReport();
+		PostQuitMessage(0);
+	}
 }
 
 void Simulation::MoveCamera(float dt)
 {
-	if (GetAsyncKeyState('W') & 0x8000)
+	if (input.IsDown(KeyForward))
 		m_Camera.Walk(10.0f*dt);
-	if (GetAsyncKeyState('S') & 0x8000)
+	if (input.IsDown(KeyBack))
 		m_Camera.Walk(-10.0f*dt);
-	if (GetAsyncKeyState('A') & 0x8000)
+	if (input.IsDown(KeyStrafeLeft))
 		m_Camera.Strafe(-10.0f*dt);
-	if (GetAsyncKeyState('D') & 0x8000)
+	if (input.IsDown(KeyStrafeRight))
 		m_Camera.Strafe(10.0f*dt);
-	if (GetAsyncKeyState(VK_UP) & 0x8000)
+	if (input.IsDown(KeyPitchUp))
 		m_Camera.Pitch(-1.0f * dt);
-	if (GetAsyncKeyState(VK_LEFT) & 0x8000)
+	if (input.IsDown(KeyTurnLeft))
 		m_Camera.RotateY(-1.0f * dt);
-	if (GetAsyncKeyState(VK_RIGHT) & 0x8000)
+	if (input.IsDown(KeyTurnRight))
 		m_Camera.RotateY(1.0f * dt);
-	if (GetAsyncKeyState(VK_DOWN) & 0x8000)
+	if (input.IsDown(KeyPitchDown))
 		m_Camera.Pitch(1.0f * dt);
 }
\ No newline at end of file
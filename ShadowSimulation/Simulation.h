@@ -6,6 +6,8 @@
 #ifndef SIMULATION_H
 #define SIMULATION_H
 
+#include <map>
+#include <string>
 #include <vector>
 
 #include "Game.h"
@@ -14,6 +16,29 @@
 #include "MeshGenerator.h"
 #include "Lights.h"
 #include "ShadowMap.h"
+#include "SimulationState.h"
+#include "SnapshotBuffer.h"
+#include "SceneGenerator.h"
+#include "BenchmarkRunner.h"
+#include "DrawQueue.h"
+#include "Input.h"
+#include "KeyboardKeySource.h"
+#include "ResourceStreamer.h"
+#include "TextureCache.h"
+#include "FileTextureSource.h"
+#include "CookCommand.h"
+#include "TextureAtlas.h"
+#include "ShaderLibrary.h"
+#include "ShaderArchive.h"
+#include "ShaderPermutations.h"
+#include "ShaderBuildCommand.h"
+#include "SoftwareRenderCommand.h"
+#include "OcclusionCuller.h"
+#include "LODSelector.h"
+#include "Terrain.h"
+#include "StaticBatcher.h"
+#include "MeshletCuller.h"
+#include "AnimationSystem.h"
 
 struct PerFrameData
 {
@@ -37,7 +62,10 @@ struct PerObjectData
 	LightMaterial lightMat;
 	float tileX;
 	float tileZ;
-	float pad[2];
+	UINT diffuseSlice;
+	UINT normalSlice;
+	XMFLOAT4 diffuseRect;	// UV offset and scale of the material's texture region, 0, 0, 1, 1 outside the atlas
+	XMFLOAT4 normalRect;
 };
 
 struct ShadowData
@@ -51,7 +79,7 @@ struct ShadowData
 class Simulation : public Game
 {
 public:
-	Simulation(HINSTANCE hInstance);
+	Simulation(HINSTANCE hInstance, const char* cmdLine);
 	virtual ~Simulation();
 
 	/// <summary>Sets up the game
@@ -70,9 +98,64 @@ public:
 	/// </summary>
 	void Draw();
 private:
-	/// <summary>Functions called during initialization
+	/// <summary>Functions called during initialization. Returns false if a startup asset failed to load
+	/// </summary>
+	bool LoadAssets();
+
+	/// <summary>Builds the seeded benchmark scene in place of the default one. staticMeshes holds the CPU data of the
+	/// models static objects may be merged from, keyed by path
+	/// </summary>
+	void LoadBenchmarkScene(Material* groundMat, Material* objectMat, const std::map<std::string, MeshData>& staticMeshes);
+
+	/// <summary>Replaces static objects whose mesh has CPU data in sources with merged batches, the rest are left alone
+	/// </summary>
+	void BatchStaticObjects(const std::map<Mesh*, const MeshData*>& sources);
+
+	/// <summary>Advances the benchmark flythrough (unless a session is replaying) and spins the dynamic objects
+	/// </summary>
+	void UpdateBenchmark(float dt);
+
+	/// <summary>Binds the benchmark light closest to the camera, the shaders only take one point light
+	/// </summary>
+	void BindNearestLight(const XMFLOAT3& eye);
+
+	/// <summary>Prioritizes streamed assets by how large their objects appear and uploads what has arrived
+	/// </summary>
+	void UpdateStreaming();
+
+	/// <summary>Hands out the material and mesh ids draws are sorted by, in object order. Call once the scene is loaded
+	/// </summary>
+	void AssignDrawIds();
+
+	/// <summary>Queues a pass's visible objects at their levels of detail and sorts them into submission order
+	/// </summary>
+	void SortDraws(const bool* visible, const std::vector<UINT>& levels);
+
+	/// <summary>Draws an object and records it in the frame statistics
+	/// </summary>
+	void DrawObject(GameObject* obj);
+
+	/// <summary>Rasterizes the occluders for a view and tests every object against them. visible holds a flag per object,
+	/// all true when culling is off, objects whose mesh hasn't streamed in are always visible
+	/// </summary>
+	void CullOccluded(OcclusionCuller& culler, const XMMATRIX& viewProjection, bool* visible);
+
+	/// <summary>Picks every object's level of detail for a pass, levels holds the ones picked last frame
+	/// </summary>
+	void SelectLODs(LODPass pass, std::vector<UINT>& levels);
+
+	/// <summary>Culls the meshlets of the visible objects drawn at full detail and points them at the indices left
+	/// Objects with nothing left are marked not visible, every other object draws its level of detail whole
+	/// </summary>
+	void CullMeshlets(const MeshletView& view, bool* visible, const std::vector<UINT>& levels);
+
+	/// <summary>Draws the terrain chunks a pass sees and records them in the frame statistics
+	/// </summary>
+	void DrawTerrain(bool shadowPass);
+
+	/// <summary>Draws the animated characters for a pass and records them in the frame statistics
 	/// </summary>
-	void LoadAssets();
+	void DrawCharacters(bool shadowPass);
 
 	/// <summary>Sets up the input layouts and other DirectX 11 states
 	/// </summary>
@@ -86,7 +169,32 @@ private:
 	/// </summary>
 	void MoveLight(float dt);
 
+	/// <summary>Copies the simulation's current state into a snapshot
+	/// </summary>
+	void CaptureState(SimulationState& state);
+
+	/// <summary>Hands the last two simulation states to the renderer
+	/// </summary>
+	void PublishSnapshot();
+
+	/// <summary>Uploads per object data for the given world matrix. Material values are skipped if obj is NULL
+	/// </summary>
+	void SetObjectData(const XMMATRIX& world, GameObject* obj);
+
+	// Owned by the update thread
 	Camera m_Camera;
+	KeyboardKeySource keyboard;
+	Input input;
+	bool replayLoaded;	// False if replay= named a file that couldn't be loaded
+
+	// Owned by the render thread, follows the interpolated simulation camera
+	Camera renderCamera;
+
+	// previous/current are written by the update thread, renderState is read by the render thread
+	SnapshotBuffer<SimulationSnapshot> snapshots;
+	SimulationState previousState;
+	SimulationState currentState;
+	SimulationState renderState;
 
 	PerFrameData perFrameData;
 	PerObjectData perObjectData;
@@ -104,6 +212,9 @@ private:
 	GameObject* cameraDebugSphere;
 	GameObject* quarterQuad;
 
+	// Compiled shaders and the input layouts built from them, shared by every material
+	ShaderLibrary shaders;
+	ShaderArchive permutations;
 	ID3D11InputLayout* inputLayout;
 	
 	ID3D11BlendState* blendState;
@@ -112,11 +223,77 @@ private:
 
 	ID3D11RasterizerState* solid;
 	ID3D11RasterizerState* wireframe;
-	ID3D11RasterizerState* current;
+	bool wireframeMode;
 	float totalTime;
 	float time;
 
 	std::vector<GameObject*> objects;
+
+	// Every texture goes through the cache, declared first so it outlives the streamer's handles
+	FileTextureSource textureSource;
+	TextureCache textureCache;
+
+	// Vertices and indices of every mesh, declared before the streamer whose meshes hold handles to it
+	GeometryPool geometryPool;
+	GeometryBindings geometryBindings;
+
+	// Textures and models load in the background and are uploaded from Draw
+	ResourceStreamer streamer;
+
+	// Material textures packed into one texture array, turned on with -atlas
+	TextureAtlas atlas;
+	TextureBindings textureBindings;
+
+	// Occluders rasterized on the CPU for the camera and the shadow casting light, occlusion=0 turns them off
+	OcclusionCuller cameraOcclusion;
+	OcclusionCuller shadowOcclusion;
+
+	// Per object, allocated from the frame arena at the start of Draw and gone when it ends
+	bool* cameraVisible;
+	bool* shadowVisible;
+	XMFLOAT4X4* objectWorlds;
+
+	// Levels of detail picked per pass, coarser for the shadow map. lod=0 draws everything at full detail
+	LODSelector lodSelector;
+	std::vector<UINT> cameraLODs;
+	std::vector<UINT> shadowLODs;
+
+	// Visible objects of the pass being drawn in submission order. objectDrawIds holds each object's material and
+	// mesh ids, handed out once the scene is loaded
+	DrawQueue drawQueue;
+	std::vector<std::pair<UINT, UINT> > objectDrawIds;
+
+	// Meshlets of large meshes culled against each pass's frustum and back faces, meshlets=0 draws them whole
+	MeshletCuller meshletCuller;
+
+	// Static objects merged into batches at load, staticbatch=0 draws every object on its own. Batched objects that
+	// occluded still do through their boxes
+	struct StaticOccluder
+	{
+		MeshBounds bounds;
+		XMFLOAT4X4 world;
+	};
+	StaticBatcher staticBatcher;
+	std::vector<Mesh*> staticBatchMeshes;
+	std::vector<StaticOccluder> staticOccluders;
+
+	// Streamed heightmap terrain around the arena, turned on with terrain=1. terrainObject only carries its material
+	Terrain terrain;
+	GameObject* terrainObject;
+
+	// Skinned characters walking the arena, turned on with agents=N. characterObject only carries their material
+	AnimationSystem animation;
+	GameObject* characterObject;
+	ID3D11VertexShader* skinnedShader;
+	ID3D11InputLayout* skinnedLayout;
+
+	// Benchmark mode, benchmarkObjects[i] is benchmarkScene.objects[i], NULL once merged into a static batch
+	BenchmarkRunner benchmark;
+	GeneratedScene benchmarkScene;
+	std::vector<GameObject*> benchmarkObjects;
+	FrameStats frameStats;
+	Mesh* lastMesh;
+	Material* lastMaterial;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,53 @@
+//
+// Plain copies of everything the renderer needs from the simulation
+// The update thread fills these in after each step, the render thread interpolates between two of them
+//
+
+#include "SimulationState.h"
+
+static XMFLOAT3 LerpFloat3(const XMFLOAT3& a, const XMFLOAT3& b, float t)
+{
+	XMFLOAT3 result;
+	XMStoreFloat3(&result, XMVectorLerp(XMLoadFloat3(&a), XMLoadFloat3(&b), t));
+	return result;
+}
+
+void InterpolateTransform(const TransformState& a, const TransformState& b, float t, TransformState& out)
+{
+	out.position = LerpFloat3(a.position, b.position, t);
+	out.scale = LerpFloat3(a.scale, b.scale, t);
+	XMStoreFloat4(&out.orientation, XMQuaternionSlerp(XMLoadFloat4(&a.orientation), XMLoadFloat4(&b.orientation), t));
+}
+
+void InterpolateState(const SimulationState& a, const SimulationState& b, float t, SimulationState& out)
+{
+	out.objects.resize(b.objects.size());
+	for (size_t i = 0; i < b.objects.size(); i++)
+	{
+		if (i < a.objects.size())
+			InterpolateTransform(a.objects[i], b.objects[i], t, out.objects[i]);
+		else
+			out.objects[i] = b.objects[i];
+	}
+	InterpolateTransform(a.debugSphere, b.debugSphere, t, out.debugSphere);
+
+	out.sLight = b.sLight;
+	out.sLight.position = LerpFloat3(a.sLight.position, b.sLight.position, t);
+	XMStoreFloat3(&out.sLight.direction, XMVector3Normalize(XMVectorLerp(XMLoadFloat3(&a.sLight.direction), XMLoadFloat3(&b.sLight.direction), t)));
+
+	out.cameraPosition = LerpFloat3(a.cameraPosition, b.cameraPosition, t);
+	out.cameraRight = LerpFloat3(a.cameraRight, b.cameraRight, t);
+	out.cameraUp = LerpFloat3(a.cameraUp, b.cameraUp, t);
+	out.cameraLook = LerpFloat3(a.cameraLook, b.cameraLook, t);
+
+	out.totalTime = a.totalTime + (b.totalTime - a.totalTime) * t;
+	out.wireframe = b.wireframe;
+}
+
+XMMATRIX TransformToMatrix(const TransformState& transform)
+{
+	XMMATRIX scaleM = XMMatrixScalingFromVector(XMLoadFloat3(&transform.scale));
+	XMMATRIX rotation = XMMatrixRotationQuaternion(XMLoadFloat4(&transform.orientation));
+	XMMATRIX translation = XMMatrixTranslationFromVector(XMLoadFloat3(&transform.position));
+	return scaleM * rotation * translation;
+}
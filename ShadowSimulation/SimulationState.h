@@ -0,0 +1,60 @@
+//
+// Plain copies of everything the renderer needs from the simulation
+// The update thread fills these in after each step, the render thread interpolates between two of them
+//
+
+#ifndef SIMULATIONSTATE_H
+#define SIMULATIONSTATE_H
+
+#include <chrono>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "Lights.h"
+
+using namespace DirectX;
+
+struct TransformState
+{
+	XMFLOAT3 position;
+	XMFLOAT4 orientation;
+	XMFLOAT3 scale;
+};
+
+struct SimulationState
+{
+	std::vector<TransformState> objects;
+	TransformState debugSphere;
+	SpotLight sLight;
+
+	XMFLOAT3 cameraPosition;
+	XMFLOAT3 cameraRight;
+	XMFLOAT3 cameraUp;
+	XMFLOAT3 cameraLook;
+
+	float totalTime;
+	bool wireframe;
+};
+
+struct SimulationSnapshot
+{
+	SimulationState previous;
+	SimulationState current;
+
+	// When current was produced, used to work out how far the renderer is between previous and current
+	std::chrono::steady_clock::time_point stepTime;
+};
+
+/// <summary>Blends two transforms, slerping the orientation
+/// </summary>
+void InterpolateTransform(const TransformState& a, const TransformState& b, float t, TransformState& out);
+
+/// <summary>Blends two simulation states. Discrete values (wireframe) are taken from b
+/// </summary>
+void InterpolateState(const SimulationState& a, const SimulationState& b, float t, SimulationState& out);
+
+/// <summary>Builds a world matrix (scale, rotate, translate) from a transform
+/// </summary>
+XMMATRIX TransformToMatrix(const TransformState& transform);
+
+#endif
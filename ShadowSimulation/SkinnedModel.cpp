@@ -0,0 +1,260 @@
+//
+// Skinned characters read from model files, or built in code for scenes without any
+//
+
+#include "SkinnedModel.h"
+#include <cmath>
+
+// Keys a second the procedural clips are written at, above the rate clips are compressed to like most exported animation
+static const float ProceduralKeyRate = 60.0f;
+
+// Size of the procedural character
+static const float ProceduralHeight = 1.8f;
+static const float ProceduralRadius = 0.25f;
+static const UINT ProceduralSides = 12;
+static const UINT ProceduralRingsPerJoint = 2;
+
+static int FindJoint(const Skeleton& skeleton, const std::string& name)
+{
+	for (UINT i = 0; i < skeleton.GetJointCount(); i++)
+	{
+		if (skeleton.names[i] == name)
+			return (int)i;
+	}
+	return -1;
+}
+
+bool SkinnedModel::Import(const char* filepath, SkinnedModelData& data)
+{
+	Assimp::Importer importer;
+	const aiScene* scene = importer.ReadFile(filepath, MeshImportFlags | aiProcess_LimitBoneWeights);
+	if (!Mesh::ReadScene(scene, data.mesh) || data.mesh.bones.empty())
+		return false;
+
+	data.skeleton = Skeleton();
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+	AddJoints(scene->mRootNode, -1, identity, data.mesh.bones, data.skeleton);
+	if (data.skeleton.GetJointCount() > MaxSkinJoints)
+		return false;
+
+	// Influences were numbered by the mesh's bones, from here on they refer to joints
+	std::vector<BYTE> jointOfBone(data.mesh.bones.size());
+	for (UINT i = 0; i < data.mesh.bones.size(); i++)
+	{
+		int joint = FindJoint(data.skeleton, data.mesh.bones[i].name);
+		if (joint < 0)
+			return false;
+		jointOfBone[i] = (BYTE)joint;
+		data.skeleton.inverseBind[joint] = data.mesh.bones[i].inverseBind;
+	}
+	for (SkinInfluences& skin : data.mesh.influences)
+	{
+		for (int k = 0; k < 4; k++)
+			skin.joints[k] = jointOfBone[skin.joints[k]];
+	}
+
+	data.clips.resize(scene->mNumAnimations);
+	for (UINT i = 0; i < scene->mNumAnimations; i++)
+		ReadClip(scene->mAnimations[i], data.skeleton, data.clips[i]);
+	return true;
+}
+
+bool SkinnedModel::AddJoints(const aiNode* node, int parent, const XMFLOAT4X4& parentModel, const std::vector<MeshBone>& bones, Skeleton& skeleton)
+{
+	// Assimp's matrices transform column vectors, transposed they fit DirectX Math's row vectors
+	XMFLOAT4X4 source(&node->mTransformation.a1);
+	XMMATRIX local = XMMatrixTranspose(XMLoadFloat4x4(&source));
+	XMFLOAT4X4 model;
+	XMStoreFloat4x4(&model, local * XMLoadFloat4x4(&parentModel));
+
+	JointTransform bind;
+	XMVECTOR scale, rotation, translation;
+	XMMatrixDecompose(&scale, &rotation, &translation, local);
+	XMStoreFloat4(&bind.rotation, rotation);
+	XMStoreFloat3(&bind.translation, translation);
+	XMStoreFloat3(&bind.scale, scale);
+
+	// Nodes only there to connect bones are never drawn with, where the bind pose puts them stands in for an inverse bind
+	XMFLOAT4X4 inverseBind;
+	XMStoreFloat4x4(&inverseBind, XMMatrixInverse(nullptr, XMLoadFloat4x4(&model)));
+
+	int joint = (int)skeleton.GetJointCount();
+	skeleton.names.push_back(node->mName.C_Str());
+	skeleton.parents.push_back(parent);
+	skeleton.bindPose.push_back(bind);
+	skeleton.inverseBind.push_back(inverseBind);
+
+	bool used = false;
+	for (const MeshBone& bone : bones)
+		used = used || bone.name == skeleton.names[joint];
+	for (UINT i = 0; i < node->mNumChildren; i++)
+		used = AddJoints(node->mChildren[i], joint, model, bones, skeleton) || used;
+
+	// Nothing below was added either, so the node is still the last joint
+	if (!used)
+	{
+		skeleton.names.pop_back();
+		skeleton.parents.pop_back();
+		skeleton.bindPose.pop_back();
+		skeleton.inverseBind.pop_back();
+	}
+	return used;
+}
+
+void SkinnedModel::ReadClip(const aiAnimation* animation, const Skeleton& skeleton, RawClip& clip)
+{
+	double ticksPerSecond = animation->mTicksPerSecond > 0.0 ? animation->mTicksPerSecond : 25.0;
+	clip.name = animation->mName.C_Str();
+	clip.duration = (float)(animation->mDuration / ticksPerSecond);
+	clip.tracks.assign(skeleton.GetJointCount(), RawTrack());
+	for (UINT i = 0; i < animation->mNumChannels; i++)
+	{
+		const aiNodeAnim* channel = animation->mChannels[i];
+		int joint = FindJoint(skeleton, channel->mNodeName.C_Str());
+		if (joint < 0)
+			continue;
+
+		RawTrack& track = clip.tracks[joint];
+		for (UINT k = 0; k < channel->mNumRotationKeys; k++)
+		{
+			const aiQuatKey& key = channel->mRotationKeys[k];
+			track.rotationTimes.push_back((float)(key.mTime / ticksPerSecond));
+			track.rotations.push_back(XMFLOAT4(key.mValue.x, key.mValue.y, key.mValue.z, key.mValue.w));
+		}
+		for (UINT k = 0; k < channel->mNumPositionKeys; k++)
+		{
+			const aiVectorKey& key = channel->mPositionKeys[k];
+			track.translationTimes.push_back((float)(key.mTime / ticksPerSecond));
+			track.translations.push_back(XMFLOAT3(key.mValue.x, key.mValue.y, key.mValue.z));
+		}
+		for (UINT k = 0; k < channel->mNumScalingKeys; k++)
+		{
+			const aiVectorKey& key = channel->mScalingKeys[k];
+			track.scaleTimes.push_back((float)(key.mTime / ticksPerSecond));
+			track.scales.push_back(XMFLOAT3(key.mValue.x, key.mValue.y, key.mValue.z));
+		}
+	}
+}
+
+void SkinnedModel::BuildProcedural(UINT jointCount, SkinnedModelData& data)
+{
+	jointCount = min(max(jointCount, 1u), MaxSkinJoints);
+	float segment = ProceduralHeight / jointCount;
+	data = SkinnedModelData();
+
+	///
+	// Skeleton
+	// A chain standing on the first joint, one joint per segment
+	///
+	for (UINT i = 0; i < jointCount; i++)
+	{
+		JointTransform bind = { XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f), XMFLOAT3(0.0f, i == 0 ? 0.0f : segment, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f) };
+		XMFLOAT4X4 inverseBind;
+		XMStoreFloat4x4(&inverseBind, XMMatrixTranslation(0.0f, -segment * i, 0.0f));
+		data.skeleton.names.push_back("Segment" + std::to_string(i));
+		data.skeleton.parents.push_back((int)i - 1);
+		data.skeleton.bindPose.push_back(bind);
+		data.skeleton.inverseBind.push_back(inverseBind);
+	}
+
+	///
+	// Mesh
+	// Rings up the chain, each weighted between the two joints it sits between, and a cap on top
+	///
+	MeshData& mesh = data.mesh;
+	UINT rings = jointCount * ProceduralRingsPerJoint + 1;
+	for (UINT r = 0; r < rings; r++)
+	{
+		float height = ProceduralHeight * r / (rings - 1);
+		float along = height / segment - 0.5f;
+		UINT lower = (UINT)min(max(std::floor(along), 0.0f), (float)(jointCount - 1));
+		float upperWeight = min(max(along - lower, 0.0f), 1.0f);
+
+		SkinInfluences skin;
+		ZeroMemory(&skin, sizeof(skin));
+		skin.joints[0] = (BYTE)lower;
+		skin.joints[1] = (BYTE)min(lower + 1, jointCount - 1);
+		skin.weights[0] = 1.0f - upperWeight;
+		skin.weights[1] = upperWeight;
+		for (UINT s = 0; s <= ProceduralSides; s++)
+		{
+			float angle = 2.0f * PI * s / ProceduralSides;
+			Vertex vertex(XMFLOAT3(std::cos(angle) * ProceduralRadius, height, std::sin(angle) * ProceduralRadius),
+				XMFLOAT2((float)s / ProceduralSides, height / ProceduralHeight));
+			vertex.Color = XMFLOAT4(0.7f, 0.7f, 0.7f, 1.0f);
+			vertex.Normal = XMFLOAT3(std::cos(angle), 0.0f, std::sin(angle));
+			vertex.Tangent = XMFLOAT3(-std::sin(angle), 0.0f, std::cos(angle));
+			mesh.vertices.push_back(vertex);
+			mesh.influences.push_back(skin);
+		}
+	}
+	UINT ringSize = ProceduralSides + 1;
+	for (UINT r = 0; r + 1 < rings; r++)
+	{
+		for (UINT s = 0; s < ProceduralSides; s++)
+		{
+			UINT corner = r * ringSize + s;
+			UINT quad[6] = { corner, corner + ringSize, corner + 1, corner + ringSize, corner + ringSize + 1, corner + 1 };
+			mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+		}
+	}
+
+	UINT top = (UINT)mesh.vertices.size();
+	UINT topRing = (rings - 1) * ringSize;
+	Vertex cap(XMFLOAT3(0.0f, ProceduralHeight, 0.0f), XMFLOAT2(0.5f, 1.0f));
+	cap.Color = XMFLOAT4(0.7f, 0.7f, 0.7f, 1.0f);
+	cap.Normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
+	cap.Tangent = XMFLOAT3(1.0f, 0.0f, 0.0f);
+	mesh.vertices.push_back(cap);
+	mesh.influences.push_back(mesh.influences.back());
+	for (UINT s = 0; s < ProceduralSides; s++)
+	{
+		UINT triangle[3] = { top, topRing + s + 1, topRing + s };
+		mesh.indices.insert(mesh.indices.end(), triangle, triangle + 3);
+	}
+
+	///
+	// Clips
+	// A wave running up the chain in both, so every joint moves a little differently and each clip loops
+	///
+	const char* names[2] = { "Sway", "Twist" };
+	const float periods[2] = { 2.0f, 3.0f };
+	data.clips.resize(2);
+	for (UINT c = 0; c < 2; c++)
+	{
+		RawClip& clip = data.clips[c];
+		clip.name = names[c];
+		clip.duration = periods[c];
+		clip.tracks.resize(jointCount);
+		UINT keys = (UINT)(periods[c] * ProceduralKeyRate) + 1;
+		float bend = 1.2f / jointCount;
+		for (UINT i = 0; i < jointCount; i++)
+		{
+			RawTrack& track = clip.tracks[i];
+			for (UINT k = 0; k < keys; k++)
+			{
+				float time = (float)k / ProceduralKeyRate;
+				float wave = 2.0f * PI * time / periods[c] - 0.4f * i;
+				XMFLOAT4 rotation;
+				if (c == 0)
+					XMStoreFloat4(&rotation, XMQuaternionRotationRollPitchYaw(0.3f * bend * std::sin(wave * 2.0f), 0.0f, bend * std::sin(wave)));
+				else
+					XMStoreFloat4(&rotation, XMQuaternionRotationRollPitchYaw(0.5f * bend * std::sin(wave), 1.5f * bend * std::sin(wave), 0.0f));
+				track.rotationTimes.push_back(time);
+				track.rotations.push_back(rotation);
+			}
+
+			// Only the root moves, bobbing up and down twice a loop
+			if (i == 0)
+			{
+				for (UINT k = 0; k < keys; k++)
+				{
+					float time = (float)k / ProceduralKeyRate;
+					track.translationTimes.push_back(time);
+					track.translations.push_back(XMFLOAT3(0.0f, 0.05f * std::sin(4.0f * PI * time / periods[c]), 0.0f));
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,42 @@
+//
+// Skinned characters read from model files, or built in code for scenes without any
+// The skeleton is the model's node hierarchy cut down to the bones and the nodes above them, clips are kept raw until
+// the animation system compresses them
+//
+
+#ifndef SKINNEDMODEL_H
+#define SKINNEDMODEL_H
+
+#include "AnimationClip.h"
+#include "Mesh.h"
+
+/// <summary>Mesh, skeleton and clips of one character. The mesh's influences refer to the skeleton's joints
+/// </summary>
+struct SkinnedModelData
+{
+	MeshData mesh;
+	Skeleton skeleton;
+	std::vector<RawClip> clips;
+};
+
+class SkinnedModel
+{
+public:
+	/// <summary>Reads a model with bones and the animations in the same file. Returns false if it has no bones or more
+	/// joints than MaxSkinJoints
+	/// </summary>
+	static bool Import(const char* filepath, SkinnedModelData& data);
+
+	/// <summary>Builds a standing tube jointCount segments high with a swaying clip and a twisting one
+	/// </summary>
+	static void BuildProcedural(UINT jointCount, SkinnedModelData& data);
+private:
+	/// <summary>Adds node to the skeleton if it or anything below it is a bone, then its children
+	/// parentModel takes the parent's space into the model's
+	/// </summary>
+	static bool AddJoints(const aiNode* node, int parent, const XMFLOAT4X4& parentModel, const std::vector<MeshBone>& bones, Skeleton& skeleton);
+
+	static void ReadClip(const aiAnimation* animation, const Skeleton& skeleton, RawClip& clip);
+};
+
+#endif
@@ -0,0 +1,115 @@
+#include "Lighting.hlsli"
+
+cbuffer perFrame : register(b0)
+{
+	DirectionalLight dLight;
+	PointLight pLight;
+	SpotLight sLight;
+	matrix view;
+	matrix projection;
+	float3 eyePos;
+	float time;
+	float4 fogColor;
+	float fogStart;
+	float fogRange;
+	float pad[2];
+};
+
+cbuffer perObject : register(b1)
+{
+	matrix world;
+	matrix worldInverseTranspose;
+	LightMaterial lightMat;
+	float tileX;
+	float tileZ;
+	uint diffuseSlice;
+	uint normalSlice;
+	float4 diffuseRect;
+	float4 normalRect;
+};
+
+cbuffer shadow : register(b2)
+{
+	matrix sView;
+	matrix sProj;
+	float resolution;
+	float padS[3];
+};
+
+// Matches MaxSkinJoints in Skinning.h
+#define MAX_SKIN_JOINTS 128
+
+// Three rows per joint, each joint's skinning matrix transposed without its last column
+cbuffer skin : register(b3)
+{
+	float4 bones[MAX_SKIN_JOINTS * 3];
+};
+
+struct VertexInput
+{
+	float3 position : POSITION;
+	float4 color    : COLOR;
+	float2 uv		: TEXCOORD0;
+	float3 normal   : NORMAL;
+	float4 tangent  : TANGENT;
+	uint4 joints    : BLENDINDICES;
+	float4 weights  : BLENDWEIGHT;
+};
+
+struct VertexOutput
+{
+	float4 position : SV_POSITION;
+	float3 worldpos : POSITION0;
+	float4 color    : COLOR;
+	float2 uv		: TEXCOORD0;
+	float3 normal   : NORMAL;
+	float3 tangent  : TANGENT;
+	float4 shadowpos: TEXCOORD1;	
+};
+
+VertexOutput main(VertexInput input)
+{
+	VertexOutput o;
+
+	// Blend the rows of every joint the vertex is weighted to, then skin into model space
+	float4 row0 = 0;
+	float4 row1 = 0;
+	float4 row2 = 0;
+	[unroll]
+	for (int i = 0; i < 4; i++)
+	{
+		uint bone = input.joints[i] * 3;
+		row0 += bones[bone] * input.weights[i];
+		row1 += bones[bone + 1] * input.weights[i];
+		row2 += bones[bone + 2] * input.weights[i];
+	}
+	float4 position = float4(input.position, 1.0);
+	position.xyz = float3(dot(row0, position), dot(row1, position), dot(row2, position));
+	float3 normal = float3(dot(row0.xyz, input.normal), dot(row1.xyz, input.normal), dot(row2.xyz, input.normal));
+	float3 tangent = float3(dot(row0.xyz, input.tangent.xyz), dot(row1.xyz, input.tangent.xyz), dot(row2.xyz, input.tangent.xyz));
+
+	// Calculate wvp matrix
+	matrix worldViewProj = mul(mul(world, view), projection);
+
+	// Apply wvp matrix to input coordinates to get screen coordinates
+	o.position = mul(position, worldViewProj);
+
+	// Apply world matrix to input coordinates to get world coordinates
+	o.worldpos = mul(position, world).xyz;
+
+	// Normal/ Tangent calculation
+	o.normal = mul(normal, (float3x3)worldInverseTranspose);
+	o.tangent = mul(tangent, (float3x3)world);
+
+	// Pass through values
+	o.color = input.color;
+	o.uv = input.uv;
+
+	// Calculate projected texture coordinates for shadowmap
+	matrix shadowTransform = mul(mul(world, sView), sProj);
+	o.shadowpos = mul(position, shadowTransform);
+	o.shadowpos.xy = o.shadowpos.xy * 0.5 + 0.5;
+	o.shadowpos.y = o.shadowpos.y * -1;
+
+	return o;
+}
\ No newline at end of file
@@ -0,0 +1,201 @@
+//
+// Skeletons, poses and the matrix palettes skinned meshes are drawn with
+//
+
+#include "Skinning.h"
+#include <emmintrin.h>
+
+Pose::Pose() :
+jointCount(0),
+stride(0)
+{
+
+}
+
+void Pose::Resize(UINT _jointCount)
+{
+	jointCount = _jointCount;
+	stride = (jointCount + 3) & ~3u;
+	values.assign(stride * PoseStreamCount, 0.0f);
+	std::fill(values.begin() + PoseRotationW * stride, values.begin() + (PoseRotationW + 1) * stride, 1.0f);
+	std::fill(values.begin() + PoseScaleX * stride, values.end(), 1.0f);
+}
+
+void Pose::SetJoint(UINT joint, const JointTransform& transform)
+{
+	const float components[PoseStreamCount] = { transform.rotation.x, transform.rotation.y, transform.rotation.z, transform.rotation.w,
+		transform.translation.x, transform.translation.y, transform.translation.z, transform.scale.x, transform.scale.y, transform.scale.z };
+	for (UINT i = 0; i < PoseStreamCount; i++)
+		values[i * stride + joint] = components[i];
+}
+
+JointTransform Pose::GetJoint(UINT joint) const
+{
+	const float* v = &values[joint];
+	JointTransform transform;
+	transform.rotation = XMFLOAT4(v[PoseRotationX * stride], v[PoseRotationY * stride], v[PoseRotationZ * stride], v[PoseRotationW * stride]);
+	transform.translation = XMFLOAT3(v[PoseTranslationX * stride], v[PoseTranslationY * stride], v[PoseTranslationZ * stride]);
+	transform.scale = XMFLOAT3(v[PoseScaleX * stride], v[PoseScaleY * stride], v[PoseScaleZ * stride]);
+	return transform;
+}
+
+void Skinning::SetBindPose(const Skeleton& skeleton, Pose& pose)
+{
+	pose.Resize(skeleton.GetJointCount());
+	for (UINT i = 0; i < skeleton.GetJointCount(); i++)
+		pose.SetJoint(i, skeleton.bindPose[i]);
+}
+
+void Skinning::Blend(const Pose& a, const Pose& b, float weight, Pose& out)
+{
+	if (out.GetJointCount() != a.GetJointCount())
+		out.Resize(a.GetJointCount());
+
+	UINT stride = a.GetStride();
+	const float* ra = a.GetStream(PoseRotationX);
+	const float* rb = b.GetStream(PoseRotationX);
+	float* ro = out.GetStream(PoseRotationX);
+	__m128 w = _mm_set1_ps(weight);
+	__m128 signBit = _mm_set1_ps(-0.0f);
+	for (UINT i = 0; i < stride; i += 4)
+	{
+		__m128 ax = _mm_loadu_ps(ra + i), ay = _mm_loadu_ps(ra + stride + i), az = _mm_loadu_ps(ra + 2 * stride + i), aw = _mm_loadu_ps(ra + 3 * stride + i);
+		__m128 bx = _mm_loadu_ps(rb + i), by = _mm_loadu_ps(rb + stride + i), bz = _mm_loadu_ps(rb + 2 * stride + i), bw = _mm_loadu_ps(rb + 3 * stride + i);
+
+		// q and -q are the same rotation, take whichever of b is on a's side so the blend goes the short way round
+		__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+		__m128 flip = _mm_and_ps(_mm_cmplt_ps(dot, _mm_setzero_ps()), signBit);
+		bx = _mm_xor_ps(bx, flip);
+		by = _mm_xor_ps(by, flip);
+		bz = _mm_xor_ps(bz, flip);
+		bw = _mm_xor_ps(bw, flip);
+
+		__m128 x = _mm_add_ps(ax, _mm_mul_ps(_mm_sub_ps(bx, ax), w));
+		__m128 y = _mm_add_ps(ay, _mm_mul_ps(_mm_sub_ps(by, ay), w));
+		__m128 z = _mm_add_ps(az, _mm_mul_ps(_mm_sub_ps(bz, az), w));
+		__m128 qw = _mm_add_ps(aw, _mm_mul_ps(_mm_sub_ps(bw, aw), w));
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(qw, qw))));
+		_mm_storeu_ps(ro + i, _mm_div_ps(x, length));
+		_mm_storeu_ps(ro + stride + i, _mm_div_ps(y, length));
+		_mm_storeu_ps(ro + 2 * stride + i, _mm_div_ps(z, length));
+		_mm_storeu_ps(ro + 3 * stride + i, _mm_div_ps(qw, length));
+	}
+
+	// Translations and scales follow the rotations in one run of streams
+	const float* va = a.GetStream(PoseTranslationX);
+	const float* vb = b.GetStream(PoseTranslationX);
+	float* vo = out.GetStream(PoseTranslationX);
+	for (UINT i = 0; i < stride * (PoseStreamCount - PoseTranslationX); i += 4)
+	{
+		__m128 pa = _mm_loadu_ps(va + i);
+		_mm_storeu_ps(vo + i, _mm_add_ps(pa, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(vb + i), pa), w)));
+	}
+}
+
+void Skinning::BuildPalette(const Skeleton& skeleton, const Pose& pose, SkinningScratch& scratch, SkinMatrix* palette)
+{
+	UINT jointCount = skeleton.GetJointCount();
+	UINT stride = pose.GetStride();
+	scratch.model.resize(stride);
+
+	///
+	// Local matrices
+	// Scale, then rotate, then translate, four joints at a time straight from the streams
+	///
+	const float* rx = pose.GetStream(PoseRotationX);
+	const float* ry = pose.GetStream(PoseRotationY);
+	const float* rz = pose.GetStream(PoseRotationZ);
+	const float* rw = pose.GetStream(PoseRotationW);
+	const float* tx = pose.GetStream(PoseTranslationX);
+	const float* ty = pose.GetStream(PoseTranslationY);
+	const float* tz = pose.GetStream(PoseTranslationZ);
+	const float* sx = pose.GetStream(PoseScaleX);
+	const float* sy = pose.GetStream(PoseScaleY);
+	const float* sz = pose.GetStream(PoseScaleZ);
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 two = _mm_set1_ps(2.0f);
+	for (UINT i = 0; i < stride; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(rx + i), y = _mm_loadu_ps(ry + i), z = _mm_loadu_ps(rz + i), w = _mm_loadu_ps(rw + i);
+		__m128 x2 = _mm_mul_ps(x, two), y2 = _mm_mul_ps(y, two), z2 = _mm_mul_ps(z, two);
+		__m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+		__m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+		__m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+		__m128 scaleX = _mm_loadu_ps(sx + i), scaleY = _mm_loadu_ps(sy + i), scaleZ = _mm_loadu_ps(sz + i);
+
+		// Row major elements of each joint, same layout as XMMatrixRotationQuaternion with rows scaled
+		__m128 m[12] =
+		{
+			_mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), scaleX), _mm_mul_ps(_mm_add_ps(xy, wz), scaleX), _mm_mul_ps(_mm_sub_ps(xz, wy), scaleX),
+			_mm_mul_ps(_mm_sub_ps(xy, wz), scaleY), _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), scaleY), _mm_mul_ps(_mm_add_ps(yz, wx), scaleY),
+			_mm_mul_ps(_mm_add_ps(xz, wy), scaleZ), _mm_mul_ps(_mm_sub_ps(yz, wx), scaleZ), _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), scaleZ),
+			_mm_loadu_ps(tx + i), _mm_loadu_ps(ty + i), _mm_loadu_ps(tz + i)
+		};
+		float lanes[12][4];
+		for (int k = 0; k < 12; k++)
+			_mm_storeu_ps(lanes[k], m[k]);
+		for (UINT lane = 0; lane < 4; lane++)
+		{
+			XMFLOAT4X4& local = scratch.model[i + lane];
+			local = XMFLOAT4X4(lanes[0][lane], lanes[1][lane], lanes[2][lane], 0.0f,
+				lanes[3][lane], lanes[4][lane], lanes[5][lane], 0.0f,
+				lanes[6][lane], lanes[7][lane], lanes[8][lane], 0.0f,
+				lanes[9][lane], lanes[10][lane], lanes[11][lane], 1.0f);
+		}
+	}
+
+	///
+	// Hierarchy
+	// Parents come first, so each one is already in the mesh's space when its children get to it
+	///
+	for (UINT i = 0; i < jointCount; i++)
+	{
+		XMMATRIX model = XMLoadFloat4x4(&scratch.model[i]);
+		int parent = skeleton.parents[i];
+		if (parent >= 0)
+		{
+			model = XMMatrixMultiply(model, XMLoadFloat4x4(&scratch.model[parent]));
+			XMStoreFloat4x4(&scratch.model[i], model);
+		}
+
+		XMMATRIX skin = XMMatrixTranspose(XMMatrixMultiply(XMLoadFloat4x4(&skeleton.inverseBind[i]), model));
+		XMStoreFloat4(&palette[i].rows[0], skin.r[0]);
+		XMStoreFloat4(&palette[i].rows[1], skin.r[1]);
+		XMStoreFloat4(&palette[i].rows[2], skin.r[2]);
+	}
+}
+
+/// <summary>Sums the rows of the product of each row with v, giving the skin matrix applied to v
+/// </summary>
+static XMVECTOR TransformBySkin(const XMVECTOR* rows, FXMVECTOR v)
+{
+	XMMATRIX products(XMVectorMultiply(rows[0], v), XMVectorMultiply(rows[1], v), XMVectorMultiply(rows[2], v), XMVectorZero());
+	products = XMMatrixTranspose(products);
+	return XMVectorAdd(XMVectorAdd(products.r[0], products.r[1]), XMVectorAdd(products.r[2], products.r[3]));
+}
+
+void Skinning::SkinVertices(const Vertex* vertices, const SkinInfluences* influences, UINT count, const SkinMatrix* palette, Vertex* out)
+{
+	for (UINT i = 0; i < count; i++)
+	{
+		const SkinInfluences& skin = influences[i];
+		XMVECTOR rows[3] = { XMVectorZero(), XMVectorZero(), XMVectorZero() };
+		for (int k = 0; k < 4; k++)
+		{
+			if (skin.weights[k] == 0.0f)
+				continue;
+			const SkinMatrix& joint = palette[skin.joints[k]];
+			XMVECTOR weight = XMVectorReplicate(skin.weights[k]);
+			rows[0] = XMVectorMultiplyAdd(XMLoadFloat4(&joint.rows[0]), weight, rows[0]);
+			rows[1] = XMVectorMultiplyAdd(XMLoadFloat4(&joint.rows[1]), weight, rows[1]);
+			rows[2] = XMVectorMultiplyAdd(XMLoadFloat4(&joint.rows[2]), weight, rows[2]);
+		}
+
+		const Vertex& source = vertices[i];
+		Vertex& target = out[i];
+		target = source;
+		XMStoreFloat3(&target.Position, TransformBySkin(rows, XMVectorSetW(XMLoadFloat3(&source.Position), 1.0f)));
+		XMStoreFloat3(&target.Normal, XMVector3Normalize(TransformBySkin(rows, XMLoadFloat3(&source.Normal))));
+		XMStoreFloat3(&target.Tangent, XMVector3Normalize(TransformBySkin(rows, XMLoadFloat3(&source.Tangent))));
+	}
+}
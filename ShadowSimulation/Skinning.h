@@ -0,0 +1,113 @@
+//
+// Skeletons, poses and the matrix palettes skinned meshes are drawn with
+// Poses are kept as structures of arrays, each component of every joint in its own stream padded to four joints, so
+// blending and building palettes work on four joints per SSE instruction
+//
+
+#ifndef SKINNING_H
+#define SKINNING_H
+
+#include <string>
+#include <vector>
+#include <DirectXMath.h>
+#include <Windows.h>
+#include "Vertex.h"
+
+using namespace DirectX;
+
+static const UINT MaxSkinJoints = 128;	// Palette size SkinnedVertex.hlsl is compiled for
+
+/// <summary>Position of a joint relative to its parent
+/// </summary>
+struct JointTransform
+{
+	XMFLOAT4 rotation;		// Quaternion
+	XMFLOAT3 translation;
+	XMFLOAT3 scale;
+};
+
+/// <summary>Joint hierarchy shared by every character using the same model. Parents always come before their children
+/// </summary>
+struct Skeleton
+{
+	std::vector<std::string> names;
+	std::vector<int> parents;				// -1 for roots
+	std::vector<JointTransform> bindPose;	// Local transforms the mesh was modeled in
+	std::vector<XMFLOAT4X4> inverseBind;	// From the mesh's space into each joint's space at the bind pose
+
+	UINT GetJointCount() const { return (UINT)parents.size(); }
+};
+
+/// <summary>Component streams of a Pose
+/// </summary>
+enum PoseStream
+{
+	PoseRotationX, PoseRotationY, PoseRotationZ, PoseRotationW,
+	PoseTranslationX, PoseTranslationY, PoseTranslationZ,
+	PoseScaleX, PoseScaleY, PoseScaleZ,
+	PoseStreamCount
+};
+
+/// <summary>Local transform of every joint. Each stream holds one component of every joint, padded to a multiple of
+/// four joints. Padding always holds some valid transform, so working on it never turns into NaNs
+/// </summary>
+class Pose
+{
+public:
+	Pose();
+
+	/// <summary>Sets every joint to identity
+	/// </summary>
+	void Resize(UINT jointCount);
+
+	UINT GetJointCount() const { return jointCount; }
+	UINT GetStride() const { return stride; }
+
+	float* GetStream(PoseStream stream) { return &values[stream * stride]; }
+	const float* GetStream(PoseStream stream) const { return &values[stream * stride]; }
+
+	void SetJoint(UINT joint, const JointTransform& transform);
+	JointTransform GetJoint(UINT joint) const;
+private:
+	UINT jointCount;
+	UINT stride;						// Floats per stream, a multiple of 4
+	std::vector<float> values;
+};
+
+/// <summary>Transposed joint transform without its last column, which is always 0, 0, 0, 1
+/// SkinnedVertex.hlsl and CPU skinning both take a vertex into the posed mesh's space with a dot product per row
+/// </summary>
+struct SkinMatrix
+{
+	XMFLOAT4 rows[3];
+};
+
+/// <summary>Scratch a thread needs to build palettes, kept between calls so evaluating poses doesn't allocate
+/// </summary>
+struct SkinningScratch
+{
+	std::vector<XMFLOAT4X4> model;	// Each joint's transform into the mesh's space
+};
+
+class Skinning
+{
+public:
+	static void SetBindPose(const Skeleton& skeleton, Pose& pose);
+
+	/// <summary>Blends two poses of the same skeleton into out, which may be either of them. weight 0 is all of a
+	/// Rotations are interpolated linearly and renormalized, which is close enough to slerp at the angles between
+	/// two poses of one character and a lot cheaper
+	/// </summary>
+	static void Blend(const Pose& a, const Pose& b, float weight, Pose& out);
+
+	/// <summary>Concatenates the pose down the hierarchy and writes a palette entry per joint
+	/// </summary>
+	static void BuildPalette(const Skeleton& skeleton, const Pose& pose, SkinningScratch& scratch, SkinMatrix* palette);
+
+	/// <summary>Moves vertices by their influences on the CPU, for passes that would rather not pay for skinning per
+	/// vertex shader invocation. Normals and tangents are renormalized
+	/// </summary>
+	static void SkinVertices(const Vertex* vertices, const SkinInfluences* influences, UINT count, const SkinMatrix* palette, Vertex* out);
+};
+
+#endif
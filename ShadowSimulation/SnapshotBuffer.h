@@ -0,0 +1,63 @@
+//
+// Lock-free triple buffer used to hand simulation snapshots to the renderer
+// One thread writes (WriteSlot + Publish), one thread reads (Acquire + ReadSlot)
+// Neither side ever waits on the other; the reader always sees the newest published slot
+//
+
+#ifndef SNAPSHOTBUFFER_H
+#define SNAPSHOTBUFFER_H
+
+#include <atomic>
+
+template <typename T>
+class SnapshotBuffer
+{
+public:
+	SnapshotBuffer() :
+	shared(1),
+	writeIndex(0),
+	readIndex(2)
+	{
+
+	}
+
+	/// <summary>Returns the slot owned by the writer. Only valid on the writing thread
+	/// </summary>
+	T& WriteSlot() { return slots[writeIndex]; }
+
+	/// <summary>Makes the write slot visible to the reader and takes back a free slot to write into
+	/// </summary>
+	void Publish()
+	{
+		int previous = shared.exchange(writeIndex | DirtyBit, std::memory_order_acq_rel);
+		writeIndex = previous & IndexMask;
+	}
+
+	/// <summary>Swaps in the newest published slot. Returns false if nothing new was published
+	/// </summary>
+	bool Acquire()
+	{
+		if (!(shared.load(std::memory_order_relaxed) & DirtyBit))
+			return false;
+
+		int previous = shared.exchange(readIndex, std::memory_order_acq_rel);
+		readIndex = previous & IndexMask;
+		return true;
+	}
+
+	/// <summary>Returns the slot owned by the reader. Only valid on the reading thread
+	/// </summary>
+	const T& ReadSlot() const { return slots[readIndex]; }
+private:
+	enum { IndexMask = 0x3, DirtyBit = 0x4 };
+
+	T slots[3];
+
+	// Index of the slot currently owned by neither side, plus a bit telling if it holds unread data
+	std::atomic<int> shared;
+
+	int writeIndex;
+	int readIndex;
+};
+
+#endif
@@ -0,0 +1,473 @@
+//
+// Renders the simulation's scene with the software renderer, no window or device needed
+// Turned on from the command line: -softrender width=1280 height=720 threads=0 frames=1 time=0 scene=default shadow=2048
+//   out=frame.png golden=golden.png tolerance=2 mismatch=0.001 scaling=0 report=softrender.log
+//
+
+#include "SoftwareRenderCommand.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <thread>
+
+#include "BenchmarkRunner.h"
+#include "Camera.h"
+#include "FileTextureSource.h"
+#include "ImageConvert.h"
+#include "MeshGenerator.h"
+#include "PNGDecoder.h"
+#include "PNGEncoder.h"
+#include "ShaderPermutations.h"
+
+static const float StepTime = 1.0f / 60.0f;
+
+SoftwareRenderCommand::SoftwareRenderCommand() :
+enabled(false),
+width(1280),
+height(720),
+threads(0),
+frames(1),
+startTime(0.0f),
+benchmarkScene(false),
+shadowSize(2048),
+outputPath("frame.png"),
+reportPath("softrender.log"),
+tolerance(2),
+maxMismatch(0.001f),
+scaling(false)
+{
+
+}
+
+bool SoftwareRenderCommand::ParseCommandLine(const char* cmdLine)
+{
+	if (!cmdLine)
+		return false;
+
+	std::istringstream args(cmdLine);
+	std::string arg;
+	while (args >> arg)
+	{
+		if (arg == "-softrender")
+		{
+			enabled = true;
+			continue;
+		}
+
+		size_t split = arg.find('=');
+		if (split == std::string::npos)
+			continue;
+
+		std::string key = arg.substr(0, split);
+		std::string value = arg.substr(split + 1);
+		if (key == "width")
+			width = (UINT)strtoul(value.c_str(), NULL, 10);
+		else if (key == "height")
+			height = (UINT)strtoul(value.c_str(), NULL, 10);
+		else if (key == "threads")
+			threads = (UINT)strtoul(value.c_str(), NULL, 10);
+		else if (key == "frames")
+			frames = (UINT)strtoul(value.c_str(), NULL, 10);
+		else if (key == "time")
+			startTime = (float)atof(value.c_str());
+		else if (key == "scene")
+			benchmarkScene = value == "benchmark";
+		else if (key == "shadow")
+			shadowSize = (UINT)strtoul(value.c_str(), NULL, 10);
+		else if (key == "out")
+			outputPath = value;
+		else if (key == "golden")
+			goldenPath = value;
+		else if (key == "tolerance")
+			tolerance = (UINT)strtoul(value.c_str(), NULL, 10);
+		else if (key == "mismatch")
+			maxMismatch = (float)atof(value.c_str());
+		else if (key == "scaling")
+			scaling = value != "0";
+		else if (key == "report")
+			reportPath = value;
+	}
+
+	if (width == 0)
+		width = 1280;
+	if (height == 0)
+		height = 720;
+	if (frames == 0)
+		frames = 1;
+	if (shadowSize == 0)
+		shadowSize = 2048;
+
+	// The benchmark scene is described by the same keys as -benchmark
+	BenchmarkRunner benchmark;
+	benchmark.ParseCommandLine(cmdLine);
+	sceneDesc = benchmark.GetSceneDesc();
+	return enabled;
+}
+
+int SoftwareRenderCommand::Run()
+{
+	std::ostringstream report;
+	report << std::fixed << std::setprecision(2);
+
+	if (!LoadScene())
+	{
+		report << "Scene could not be loaded\n";
+		WriteReport(report.str());
+		return 1;
+	}
+
+	SoftwareRenderer renderer;
+	renderer.Resize(width, height, shadowSize);
+	renderer.SetThreads(threads);
+
+	// The first frame is the one written out and checked, it also warms the caches for the timed run
+	RecordFrame(0, renderer);
+	renderer.End();
+	const ImageData& image = renderer.GetImage();
+	const SoftwareRenderStats& stats = renderer.GetStats();
+
+	bool failed = false;
+	report << width << "x" << height << ", " << (benchmarkScene ? "benchmark" : "default") << " scene, "
+		<< objects.size() << " objects, shadow map " << shadowSize << "\n"
+		<< "\t" << stats.draws << " draws, " << stats.triangles << " triangles, " << stats.rasterizedTriangles << " rasterized, "
+		<< stats.binnedTriangles << " binned, " << stats.pixelsShaded << " pixels shaded\n"
+		<< "\tshadow " << stats.shadowSeconds * 1000.0 << " ms, setup " << stats.setupSeconds * 1000.0 << " ms, raster "
+		<< stats.rasterSeconds * 1000.0 << " ms\n";
+
+	if (!outputPath.empty())
+	{
+		if (PNGEncoder::WriteFile(outputPath, image))
+			report << "Wrote " << outputPath << "\n";
+		else
+		{
+			report << outputPath << ": could not be written\n";
+			failed = true;
+		}
+	}
+
+	if (!goldenPath.empty())
+	{
+		UINT mismatched = 0;
+		if (!CompareGolden(image, mismatched))
+		{
+			report << goldenPath << ": could not be read or is a different size\n";
+			failed = true;
+		}
+		else
+		{
+			double fraction = (double)mismatched / ((double)width * height);
+			bool passed = fraction <= maxMismatch;
+			report << "Golden " << goldenPath << ": " << mismatched << " pixels over tolerance " << tolerance
+				<< " (" << std::setprecision(4) << fraction * 100.0 << "%), " << (passed ? "passed" : "FAILED") << "\n"
+				<< std::setprecision(2);
+			failed |= !passed;
+		}
+	}
+
+	// Throughput over every frame, pixels are the target's, not the shaded count, so overdraw savings show up
+	double ms = RenderFrames(renderer);
+	double seconds = ms / 1000.0;
+	report << frames << " frames, " << ms / frames << " ms per frame, "
+		<< (seconds > 0.0 ? (double)width * height * frames / seconds / 1000000.0 : 0.0) << " Mpix/s, "
+		<< (seconds > 0.0 ? (double)stats.triangles * frames / seconds / 1000000.0 : 0.0) << " Mtris/s\n";
+
+	if (scaling)
+	{
+		UINT maxThreads = threads > 0 ? threads : max(std::thread::hardware_concurrency(), 1u);
+		double single = 0.0;
+		report << "Scaling:\n";
+		for (UINT count = 1; ; count = min(count * 2, maxThreads))
+		{
+			renderer.SetThreads(count);
+			double scaledMs = RenderFrames(renderer);
+			if (count == 1)
+				single = scaledMs;
+			report << "\t" << count << " threads: " << scaledMs / frames << " ms per frame, "
+				<< (scaledMs > 0.0 ? single / scaledMs : 0.0) << "x\n";
+			if (count == maxThreads)
+				break;
+		}
+	}
+
+	WriteReport(report.str());
+	return failed ? 1 : 0;
+}
+
+void SoftwareRenderCommand::WriteReport(const std::string& report) const
+{
+	std::ofstream reportFile(reportPath.c_str());
+	reportFile << report;
+	OutputDebugStringA(report.c_str());
+
+	// A GUI process has no console of its own, so write to wherever stdout was redirected or to the console it was
+	// started from, letting scripts and CI read the results without a debugger attached
+	DWORD written = 0;
+	HANDLE output = GetStdHandle(STD_OUTPUT_HANDLE);
+	if (output && output != INVALID_HANDLE_VALUE)
+	{
+		WriteFile(output, report.c_str(), (DWORD)report.size(), &written, NULL);
+		return;
+	}
+	if (!AttachConsole(ATTACH_PARENT_PROCESS))
+		return;
+	HANDLE console = CreateFileA("CONOUT$", GENERIC_WRITE, FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL);
+	if (console != INVALID_HANDLE_VALUE)
+	{
+		WriteFile(console, report.c_str(), (DWORD)report.size(), &written, NULL);
+		CloseHandle(console);
+	}
+	FreeConsole();
+}
+
+bool SoftwareRenderCommand::LoadTexture(const std::wstring& path, SoftwareTexture& texture)
+{
+	PNGDecoder png;
+	ImageDecoders decoders;
+	decoders.Add(&png);
+
+	ImageData image;
+	if (!decoders.DecodeFile(path, image))
+		return false;
+
+	ImageConvert::GenerateMips(image, FileTextureSource::GetMipContent(path), MipBox, texture.mips);
+	return true;
+}
+
+bool SoftwareRenderCommand::LoadScene()
+{
+	// Same textures and light materials as the simulation's brick and default materials
+	textures.resize(3);
+	if (!LoadTexture(L"Textures/floor_tiles.png", textures[0]) ||
+		!LoadTexture(L"Textures/floor_tiles_normal.png", textures[1]) ||
+		!LoadTexture(L"Textures/default.png", textures[2]))
+		return false;
+
+	materials.resize(2);
+	SoftwareMaterial& brick = materials[0];
+	brick.lightMat.ambient = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
+	brick.lightMat.diffuse = XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f);
+	brick.lightMat.specular = XMFLOAT4(0.9f, 0.9f, 0.9f, 64.0f);
+	brick.diffuse = &textures[0];
+	brick.normal = &textures[1];
+	brick.tileX = 3.0f;
+	brick.tileZ = 3.0f;
+
+	// Drawn with PixelNoNormal, so no normal map
+	SoftwareMaterial& plain = materials[1];
+	plain.lightMat.ambient = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
+	plain.lightMat.diffuse = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+	plain.lightMat.specular = XMFLOAT4(0.0f, 0.0f, 0.0f, 16.0f);
+	plain.diffuse = &textures[2];
+
+	SceneObject object;
+	object.material = 1;
+	object.position = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	object.rotation = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	object.scale = XMFLOAT3(1.0f, 1.0f, 1.0f);
+	object.angularVelocity = XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+	if (!benchmarkScene)
+	{
+		meshes.resize(2);
+		MeshGenerator::CreatePlane(25, 25, 2, 2, meshes[0]);
+		if (!Mesh::Import("Models/chair.fbx", meshes[1]))
+			return false;
+
+		SceneObject plane = object;
+		plane.mesh = 0;
+		plane.material = 0;
+		plane.position = XMFLOAT3(0.0f, 0.0f, 10.0f);
+		objects.push_back(plane);
+
+		for (int side = 0; side < 2; side++)
+		{
+			for (int i = 0; i < 5; i++)
+			{
+				SceneObject chair = object;
+				chair.mesh = 1;
+				chair.position = XMFLOAT3(side == 0 ? -5.0f : 5.0f, 2.0f, (float)i * 5.0f);
+				chair.scale = XMFLOAT3(1.0f, 0.25f, 1.0f);
+				chair.rotation = XMFLOAT3(0.0f, side == 0 ? PI / 2.0f : -PI / 2.0f, 0.0f);
+				objects.push_back(chair);
+			}
+		}
+		return true;
+	}
+
+	// Same palette as Simulation::LoadBenchmarkScene, the ground goes last so generated indices stay valid
+	meshes.resize(5);
+	MeshGenerator::CreateSphere(0.5f, 2, meshes[0]);
+	if (!Mesh::Import("Models/cube.fbx", meshes[1]) ||
+		!Mesh::Import("Models/pawn.fbx", meshes[2]) ||
+		!Mesh::Import("Models/chair.fbx", meshes[3]))
+		return false;
+
+	SceneDesc desc = sceneDesc;
+	desc.meshCount = 4;
+	SceneGenerator::Generate(desc, generated);
+	MeshGenerator::CreatePlane(desc.extent, desc.extent, 2, 2, meshes[4]);
+
+	SceneObject ground = object;
+	ground.mesh = 4;
+	ground.material = 0;
+	objects.push_back(ground);
+
+	objects.reserve(generated.objects.size() + 1);
+	for (const GeneratedObject& source : generated.objects)
+	{
+		SceneObject generatedObject = object;
+		generatedObject.mesh = source.mesh;
+		generatedObject.position = source.position;
+		generatedObject.rotation = source.rotation;
+		generatedObject.scale = source.scale;
+		if (source.dynamic)
+			generatedObject.angularVelocity = source.angularVelocity;
+		objects.push_back(generatedObject);
+	}
+	return true;
+}
+
+void SoftwareRenderCommand::RecordFrame(UINT frameIndex, SoftwareRenderer& renderer) const
+{
+	float time = startTime + (float)frameIndex * StepTime;
+
+	// Lights as Simulation::LoadAssets sets them up, with the spot light on its orbit
+	SoftwareFrameData frame;
+	frame.dLight.ambient = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+	frame.dLight.diffuse = XMFLOAT4(0.7f, 0.7f, 0.7f, 1.0f);
+	frame.dLight.specular = XMFLOAT4(0.7f, 0.7f, 0.7f, 1.0f);
+	frame.dLight.direction = XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+	frame.pLight.ambient = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+	frame.pLight.diffuse = XMFLOAT4(0.7f, 0.7f, 0.7f, 1.0f);
+	frame.pLight.specular = XMFLOAT4(0.6f, 0.6f, 0.6f, 1.0f);
+	frame.pLight.attenuation = XMFLOAT3(0.0f, 0.1f, 0.0f);
+	frame.pLight.position = XMFLOAT3(0.0f, -44.0f, 10.0f);
+	frame.pLight.range = 40.0f;
+
+	frame.sLight.ambient = XMFLOAT4(0.1f, 0.1f, 0.1f, 1.0f);
+	frame.sLight.diffuse = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+	frame.sLight.specular = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+	frame.sLight.attenuation = XMFLOAT3(1.0f, 0.0f, 0.0f);
+	frame.sLight.position = XMFLOAT3(30.0f * cos(time), 10.0f, 30.0f * sin(time) + 10.0f);
+	XMFLOAT3 direction(-frame.sLight.position.x, -frame.sLight.position.y, 10.0f - frame.sLight.position.z);
+	XMStoreFloat3(&frame.sLight.direction, XMVector3Normalize(XMLoadFloat3(&direction)));
+	frame.sLight.spot = 90.0f;
+	frame.sLight.range = 1000.0f;
+
+	frame.fogStart = 50.0f;
+	frame.fogRange = 100.0f;
+	frame.fogColor = XMFLOAT4(0.7f, 0.7f, 0.7f, 0.2f);
+	frame.clearColor = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+	frame.features = FeatureAll;
+
+	Camera camera;
+	if (benchmarkScene)
+	{
+		// Flythrough sampled across the frames like BenchmarkRunner::GetProgress, lit by the nearest generated light
+		XMFLOAT3 eye, target;
+		SceneGenerator::SampleCameraPath(generated, (float)frameIndex / frames, eye, target);
+		camera.LookAt(eye, target, XMFLOAT3(0.0f, 1.0f, 0.0f));
+
+		const GeneratedLight* nearest = NULL;
+		float nearestDistance = 0.0f;
+		for (const GeneratedLight& light : generated.lights)
+		{
+			float distance = XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&light.position) - XMLoadFloat3(&eye)));
+			if (!nearest || distance < nearestDistance)
+			{
+				nearest = &light;
+				nearestDistance = distance;
+			}
+		}
+
+		if (nearest)
+		{
+			frame.pLight.position = nearest->position;
+			frame.pLight.diffuse = nearest->color;
+			frame.pLight.range = nearest->range;
+		}
+	}
+	else
+	{
+		camera.SetPosition(0.0f, 5.0f, -10.0f);
+	}
+	camera.SetLens(0.25f * 3.1415926535f, (float)width / height, 0.1f, 200.0f);
+	camera.UpdateViewMatrix();
+	XMStoreFloat4x4(&frame.view, camera.View());
+	XMStoreFloat4x4(&frame.projection, camera.Proj());
+	frame.eyePos = camera.GetPosition();
+
+	XMMATRIX sView = XMMatrixLookAtLH(XMLoadFloat3(&frame.sLight.position), XMVectorSet(0.0f, 0.0f, 10.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMMATRIX sProj = XMMatrixOrthographicLH(30.0f, 30.0f, 0.1f, 200.0f);
+	XMStoreFloat4x4(&frame.shadowView, sView);
+	XMStoreFloat4x4(&frame.shadowProjection, sProj);
+
+	renderer.Begin(frame);
+	for (const SceneObject& object : objects)
+	{
+		const MeshData& mesh = meshes[object.mesh];
+		if (mesh.indices.empty())
+			continue;
+
+		// Same order as GameObject::Update
+		XMVECTOR rotation = XMLoadFloat3(&object.rotation) + XMLoadFloat3(&object.angularVelocity) * time;
+		XMMATRIX world = XMMatrixScalingFromVector(XMLoadFloat3(&object.scale)) *
+			XMMatrixRotationX(XMVectorGetX(rotation)) * XMMatrixRotationY(XMVectorGetY(rotation)) * XMMatrixRotationZ(XMVectorGetZ(rotation)) *
+			XMMatrixTranslationFromVector(XMLoadFloat3(&object.position));
+
+		SoftwareDraw draw;
+		draw.vertices = &mesh.vertices[0];
+		draw.vertexCount = (UINT)mesh.vertices.size();
+		draw.indices = &mesh.indices[0];
+		draw.indexCount = (UINT)mesh.indices.size();
+		XMStoreFloat4x4(&draw.world, world);
+		// What GameObject hands the shader as worldInverseTranspose
+		XMStoreFloat4x4(&draw.worldInverseTranspose, XMMatrixTranspose(XMMatrixInverse(nullptr, XMMatrixTranspose(world))));
+		draw.material = &materials[object.material];
+		renderer.Draw(draw);
+	}
+}
+
+double SoftwareRenderCommand::RenderFrames(SoftwareRenderer& renderer)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (UINT i = 0; i < frames; i++)
+	{
+		RecordFrame(i, renderer);
+		renderer.End();
+	}
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool SoftwareRenderCommand::CompareGolden(const ImageData& image, UINT& mismatched) const
+{
+	std::ifstream file(goldenPath.c_str(), std::ios::binary);
+	if (!file)
+		return false;
+	std::vector<BYTE> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	PNGDecoder png;
+	ImageData golden;
+	if (data.empty() || !png.Decode(&data[0], data.size(), golden) || golden.width != image.width || golden.height != image.height)
+		return false;
+
+	mismatched = 0;
+	size_t pixels = (size_t)image.width * image.height;
+	for (size_t i = 0; i < pixels; i++)
+	{
+		for (UINT c = 0; c < 4; c++)
+		{
+			if ((UINT)abs((int)image.rgba[i * 4 + c] - (int)golden.rgba[i * 4 + c]) > tolerance)
+			{
+				mismatched++;
+				break;
+			}
+		}
+	}
+	return true;
+}
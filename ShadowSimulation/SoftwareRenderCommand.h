@@ -0,0 +1,91 @@
+//
+// Renders the simulation's scene with the software renderer, no window or device needed
+// Turned on from the command line: -softrender width=1280 height=720 threads=0 frames=1 time=0 scene=default shadow=2048
+//   out=frame.png golden=golden.png tolerance=2 mismatch=0.001 scaling=0 report=softrender.log
+// scene=benchmark renders the seeded benchmark scene along its flythrough, seed, objects and lights are read as for -benchmark
+// golden fails the run if more than mismatch of the first frame's pixels differ from it by more than tolerance,
+// scaling=1 times the frames again with 1, 2, 4... threads up to the thread count
+// The report also goes to stdout when it's redirected, or to the console the process was started from
+//
+
+#ifndef SOFTWARERENDERCOMMAND_H
+#define SOFTWARERENDERCOMMAND_H
+
+#include <string>
+#include <vector>
+#include <Windows.h>
+
+#include "Mesh.h"
+#include "SceneGenerator.h"
+#include "SoftwareRenderer.h"
+
+class SoftwareRenderCommand
+{
+public:
+	SoftwareRenderCommand();
+
+	/// <summary>Reads render settings from the command line. Returns true if -softrender was passed
+	/// </summary>
+	bool ParseCommandLine(const char* cmdLine);
+
+	/// <summary>Renders the frames, checks the golden image and writes the report. Returns the process exit code
+	/// </summary>
+	int Run();
+private:
+	struct SceneObject
+	{
+		UINT mesh;
+		UINT material;
+		XMFLOAT3 position;
+		XMFLOAT3 rotation;
+		XMFLOAT3 scale;
+		XMFLOAT3 angularVelocity;	// Benchmark objects that spin
+	};
+
+	/// <summary>Loads the meshes and textures and places the objects the way Simulation::LoadAssets does
+	/// </summary>
+	bool LoadScene();
+
+	/// <summary>Sets up the frame's lights and camera and records every object, frameIndex steps at the simulation's 60 Hz
+	/// </summary>
+	void RecordFrame(UINT frameIndex, SoftwareRenderer& renderer) const;
+
+	/// <summary>Renders every frame, returning the milliseconds they took in total
+	/// </summary>
+	double RenderFrames(SoftwareRenderer& renderer);
+
+	/// <summary>Counts the pixels that differ from the golden image by more than the tolerance in any channel
+	/// Returns false if it can't be read or has a different size
+	/// </summary>
+	bool CompareGolden(const ImageData& image, UINT& mismatched) const;
+
+	/// <summary>Writes the report file, and the report to the debugger and to stdout or the console the run was started from
+	/// </summary>
+	void WriteReport(const std::string& report) const;
+
+	static bool LoadTexture(const std::wstring& path, SoftwareTexture& texture);
+
+	bool enabled;
+	UINT width;
+	UINT height;
+	UINT threads;
+	UINT frames;
+	float startTime;
+	bool benchmarkScene;
+	UINT shadowSize;
+	std::string outputPath;
+	std::string goldenPath;
+	std::string reportPath;
+	UINT tolerance;
+	float maxMismatch;		// Fraction of the pixels allowed over the tolerance
+	bool scaling;
+	SceneDesc sceneDesc;
+
+	std::vector<MeshData> meshes;
+	std::vector<SoftwareTexture> textures;
+	std::vector<SoftwareMaterial> materials;
+	std::vector<SceneObject> objects;
+	GeneratedScene generated;
+};
+
+#endif
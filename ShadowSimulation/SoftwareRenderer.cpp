@@ -0,0 +1,629 @@
+//
+// Renders recorded draws on the CPU, no device needed, so frames can be produced and checked headless
+// Triangles are set up and binned to screen tiles across threads, each tile is rasterized with SSE2 edge functions
+// into depth and a triangle id per pixel, then every visible pixel is shaded once with the LitPixel port
+//
+
+#include "SoftwareRenderer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <emmintrin.h>
+#include <thread>
+
+#include "ShaderPermutations.h"
+
+// Clipping leaves at most seven triangles of one, so a chunk's triangles always fit in the low ChunkIdBits of a pixel's id
+static const UINT ChunkTriangles = 512;
+static const UINT ChunkIdBits = 12;
+static const UINT EmptyId = UINT_MAX;
+
+// Triangles are only clipped where they leave this many screen widths around the screen, the edge tests reject the rest
+static const float GuardBand = 2.0f;
+
+// Vertices snap to 1/256 of a pixel like a hardware rasterizer's subpixel grid
+static const float SubpixelScale = 256.0f;
+
+enum ClipPlane
+{
+	ClipNear,
+	ClipFar,
+	ClipLeft,
+	ClipRight,
+	ClipBottom,
+	ClipTop,
+	ClipPlaneCount
+};
+
+/// <summary>Signed distance of a clip space position to a plane, positive inside
+/// </summary>
+static float GetPlaneDistance(const float* p, int plane)
+{
+	switch (plane)
+	{
+	case ClipNear: return p[2];
+	case ClipFar: return p[3] - p[2];
+	case ClipLeft: return p[0] + GuardBand * p[3];
+	case ClipRight: return GuardBand * p[3] - p[0];
+	case ClipBottom: return p[1] + GuardBand * p[3];
+	default: return GuardBand * p[3] - p[1];
+	}
+}
+
+static UINT GetOutcode(const float* p)
+{
+	UINT outcode = 0;
+	for (int plane = 0; plane < ClipPlaneCount; plane++)
+	{
+		if (GetPlaneDistance(p, plane) < 0.0f)
+			outcode |= 1 << plane;
+	}
+	return outcode;
+}
+
+static void Multiply(const XMFLOAT4X4& a, const XMFLOAT4X4& b, XMFLOAT4X4& result)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = 0; j < 4; j++)
+			result.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j] + a.m[i][3] * b.m[3][j];
+	}
+}
+
+/// <summary>Float to UNORM8 the way the output merger converts, NaN writes 0
+/// </summary>
+static BYTE ToUnorm(float v)
+{
+	return (BYTE)(v > 0.0f ? (v < 1.0f ? v * 255.0f + 0.5f : 255.0f) : 0.0f);
+}
+
+SoftwareRenderer::SoftwareRenderer() :
+threads(0),
+width(0),
+height(0),
+shadowSize(0),
+maxVertexCount(0),
+chunkCount(0)
+{
+
+}
+
+void SoftwareRenderer::Resize(UINT _width, UINT _height, UINT _shadowSize)
+{
+	width = _width;
+	height = _height;
+	shadowSize = _shadowSize;
+	image.width = width;
+	image.height = height;
+	image.rgba.assign((size_t)width * height * 4, 0);
+	shadowDepth.assign((size_t)shadowSize * shadowSize, 1.0f);
+}
+
+void SoftwareRenderer::SetThreads(UINT _threads)
+{
+	threads = _threads == 0 ? max(std::thread::hardware_concurrency(), 1u) : _threads;
+	workers.resize(threads);
+	for (Worker& worker : workers)
+	{
+		worker.depth.resize(TileSize * TileSize);
+		worker.ids.resize(TileSize * TileSize);
+	}
+}
+
+void SoftwareRenderer::Begin(const SoftwareFrameData& _frame)
+{
+	frame = _frame;
+	frame.features = ShaderPermutations::Normalize(frame.features);
+	draws.clear();
+	maxVertexCount = 0;
+	stats = SoftwareRenderStats();
+}
+
+void SoftwareRenderer::Draw(const SoftwareDraw& draw)
+{
+	if (!draw.vertices || !draw.indices || !draw.material || draw.indexCount < 3)
+		return;
+
+	draws.push_back(draw);
+	maxVertexCount = max(maxVertexCount, draw.vertexCount);
+	stats.draws++;
+	stats.triangles += draw.indexCount / 3;
+}
+
+void SoftwareRenderer::End()
+{
+	if (workers.empty())
+		SetThreads(threads);
+
+	for (Worker& worker : workers)
+	{
+		worker.stamps.resize(maxVertexCount, 0);
+		worker.slots.resize(maxVertexCount);
+		worker.rasterized = 0;
+		worker.binned = 0;
+		worker.shaded = 0;
+	}
+
+	Multiply(frame.shadowView, frame.shadowProjection, shadowViewProjection);
+
+	// Render the scene from the light's point of view to create a shadow map, unless nothing samples it
+	if ((frame.features & FeatureShadows) && shadowSize > 0)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		Pass shadow = { shadowSize, shadowSize, (shadowSize + TileSize - 1) / TileSize, (shadowSize + TileSize - 1) / TileSize };
+		shadow.viewProjection = shadowViewProjection;
+		shadow.depthOnly = true;
+		double setupSeconds, rasterSeconds;
+		RenderPass(shadow, setupSeconds, rasterSeconds);
+		stats.shadowSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	Pass main = { width, height, (width + TileSize - 1) / TileSize, (height + TileSize - 1) / TileSize };
+	Multiply(frame.view, frame.projection, main.viewProjection);
+	main.depthOnly = false;
+	RenderPass(main, stats.setupSeconds, stats.rasterSeconds);
+
+	for (const Worker& worker : workers)
+	{
+		stats.rasterizedTriangles += worker.rasterized;
+		stats.binnedTriangles += worker.binned;
+		stats.pixelsShaded += worker.shaded;
+	}
+}
+
+const ImageData& SoftwareRenderer::GetImage() const
+{
+	return image;
+}
+
+const SoftwareRenderStats& SoftwareRenderer::GetStats() const
+{
+	return stats;
+}
+
+void SoftwareRenderer::RenderPass(const Pass& pass, double& setupSeconds, double& rasterSeconds)
+{
+	// Every draw is cut into runs of triangles in submission order, tiles walk them in the same order
+	chunkCount = 0;
+	for (UINT d = 0; d < draws.size(); d++)
+	{
+		UINT indexCount = draws[d].indexCount - draws[d].indexCount % 3;
+		for (UINT first = 0; first < indexCount; first += ChunkTriangles * 3)
+		{
+			if (chunkCount == chunks.size())
+				chunks.push_back(Chunk());
+			Chunk& chunk = chunks[chunkCount++];
+			chunk.draw = d;
+			chunk.firstIndex = first;
+			chunk.indexCount = min(ChunkTriangles * 3, indexCount - first);
+		}
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	RunParallel(chunkCount, [this, &pass](UINT item, UINT worker) { SetupChunk(pass, chunks[item], workers[worker]); });
+
+	std::chrono::steady_clock::time_point setupDone = std::chrono::steady_clock::now();
+	RunParallel(pass.tilesX * pass.tilesY, [this, &pass](UINT tile, UINT worker) { RenderTile(pass, tile, workers[worker]); });
+
+	setupSeconds = std::chrono::duration<double>(setupDone - start).count();
+	rasterSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - setupDone).count();
+}
+
+void SoftwareRenderer::SetupChunk(const Pass& pass, Chunk& chunk, Worker& worker)
+{
+	const SoftwareDraw& draw = draws[chunk.draw];
+	chunk.triangles.clear();
+	chunk.attributes.clear();
+
+	XMFLOAT4X4 worldViewProj;
+	XMFLOAT4X4 shadowTransform;
+	Multiply(draw.world, pass.viewProjection, worldViewProj);
+	Multiply(draw.world, shadowViewProjection, shadowTransform);
+
+	// Each vertex is shaded once per chunk however many of its triangles use it
+	if (++worker.stamp == 0)
+	{
+		std::fill(worker.stamps.begin(), worker.stamps.end(), 0);
+		worker.stamp = 1;
+	}
+	if (worker.vertices.size() < chunk.indexCount)
+		worker.vertices.resize(chunk.indexCount);
+
+	UINT shaded = 0;
+	for (UINT i = 0; i < chunk.indexCount; i += 3)
+	{
+		const UINT* indices = draw.indices + chunk.firstIndex + i;
+		if (indices[0] >= draw.vertexCount || indices[1] >= draw.vertexCount || indices[2] >= draw.vertexCount)
+			continue;
+
+		const ClipVertex* corners[3];
+		for (int k = 0; k < 3; k++)
+		{
+			UINT index = indices[k];
+			if (worker.stamps[index] != worker.stamp)
+			{
+				ClipVertex& vertex = worker.vertices[shaded];
+				SoftwareShader::ShadeVertex(draw.vertices[index], worldViewProj, draw.world, draw.worldInverseTranspose, shadowTransform,
+					vertex.position, pass.depthOnly ? NULL : vertex.varyings);
+				worker.stamps[index] = worker.stamp;
+				worker.slots[index] = shaded++;
+			}
+			corners[k] = &worker.vertices[worker.slots[index]];
+		}
+		ClipTriangle(pass, corners[0], corners[1], corners[2], chunk.draw, chunk);
+	}
+
+	BinChunk(pass, chunk);
+	worker.rasterized += chunk.triangles.size();
+}
+
+void SoftwareRenderer::ClipTriangle(const Pass& pass, const ClipVertex* v0, const ClipVertex* v1, const ClipVertex* v2, UINT draw, Chunk& chunk)
+{
+	UINT outcode0 = GetOutcode(v0->position);
+	UINT outcode1 = GetOutcode(v1->position);
+	UINT outcode2 = GetOutcode(v2->position);
+	if ((outcode0 | outcode1 | outcode2) == 0)
+	{
+		SetupTriangle(pass, *v0, *v1, *v2, draw, chunk);
+		return;
+	}
+	if (outcode0 & outcode1 & outcode2)
+		return;
+
+	// Sutherland-Hodgman, each plane adds at most one vertex to the polygon
+	ClipVertex polygons[2][3 + ClipPlaneCount];
+	polygons[0][0] = *v0;
+	polygons[0][1] = *v1;
+	polygons[0][2] = *v2;
+	UINT count = 3;
+	UINT current = 0;
+	UINT planes = outcode0 | outcode1 | outcode2;
+	int components = 4 + (pass.depthOnly ? 0 : VaryingCount);
+	for (int plane = 0; plane < ClipPlaneCount; plane++)
+	{
+		if (!(planes & (1 << plane)))
+			continue;
+
+		const ClipVertex* in = polygons[current];
+		ClipVertex* out = polygons[current ^ 1];
+		UINT outCount = 0;
+		for (UINT i = 0; i < count; i++)
+		{
+			const ClipVertex& a = in[i];
+			const ClipVertex& b = in[i + 1 == count ? 0 : i + 1];
+			float distanceA = GetPlaneDistance(a.position, plane);
+			float distanceB = GetPlaneDistance(b.position, plane);
+			if (distanceA >= 0.0f)
+				out[outCount++] = a;
+			if ((distanceA >= 0.0f) != (distanceB >= 0.0f))
+			{
+				// Always measured from the inside vertex, so triangles sharing the edge get the same point
+				const ClipVertex& inside = distanceA >= 0.0f ? a : b;
+				const ClipVertex& outside = distanceA >= 0.0f ? b : a;
+				float insideDistance = distanceA >= 0.0f ? distanceA : distanceB;
+				float outsideDistance = distanceA >= 0.0f ? distanceB : distanceA;
+				float t = insideDistance / (insideDistance - outsideDistance);
+
+				const float* from = inside.position;
+				const float* to = outside.position;
+				float* result = out[outCount++].position;
+				for (int c = 0; c < components; c++)
+					result[c] = from[c] + (to[c] - from[c]) * t;
+			}
+		}
+
+		count = outCount;
+		current ^= 1;
+		if (count < 3)
+			return;
+	}
+
+	for (UINT i = 1; i + 1 < count; i++)
+		SetupTriangle(pass, polygons[current][0], polygons[current][i], polygons[current][i + 1], draw, chunk);
+}
+
+void SoftwareRenderer::SetupTriangle(const Pass& pass, const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2, UINT draw, Chunk& chunk)
+{
+	const ClipVertex* v[3] = { &v0, &v1, &v2 };
+	float x[3], y[3], z[3], invW[3];
+	for (int k = 0; k < 3; k++)
+	{
+		const float* p = v[k]->position;
+		invW[k] = 1.0f / p[3];
+		x[k] = floorf((p[0] * invW[k] * 0.5f + 0.5f) * pass.width * SubpixelScale + 0.5f) / SubpixelScale;
+		y[k] = floorf((0.5f - p[1] * invW[k] * 0.5f) * pass.height * SubpixelScale + 0.5f) / SubpixelScale;
+		z[k] = p[2] * invW[k];
+	}
+
+	// Clockwise on screen is front facing, back faces and degenerate triangles are culled
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (!(area > 0.0f))
+		return;
+
+	// Pixels whose centers could be inside
+	int minX = max((int)floorf(min(x[0], min(x[1], x[2])) - 0.5f), 0);
+	int minY = max((int)floorf(min(y[0], min(y[1], y[2])) - 0.5f), 0);
+	int maxX = min((int)ceilf(max(x[0], max(x[1], x[2])) - 0.5f), (int)pass.width - 1);
+	int maxY = min((int)ceilf(max(y[0], max(y[1], y[2])) - 0.5f), (int)pass.height - 1);
+	if (minX > maxX || minY > maxY)
+		return;
+
+	RasterTriangle triangle;
+	triangle.topLeft = 0;
+	for (int k = 0; k < 3; k++)
+	{
+		// Both triangles on a shared edge compute exactly negated coefficients, so every pixel center lands in exactly one
+		int j = k == 2 ? 0 : k + 1;
+		int l = j == 2 ? 0 : j + 1;
+		triangle.edgeA[k] = y[j] - y[l];
+		triangle.edgeB[k] = x[l] - x[j];
+		triangle.edgeC[k] = x[j] * y[l] - x[l] * y[j];
+
+		// Inside is to the right of a left edge and below a top edge
+		if (triangle.edgeA[k] > 0.0f || (triangle.edgeA[k] == 0.0f && triangle.edgeB[k] > 0.0f))
+			triangle.topLeft |= 1 << k;
+	}
+
+	// The edge functions sum to the area anywhere, divided by it they're the barycentrics
+	float invArea = 1.0f / area;
+	triangle.depth[0] = (triangle.edgeA[0] * z[0] + triangle.edgeA[1] * z[1] + triangle.edgeA[2] * z[2]) * invArea;
+	triangle.depth[1] = (triangle.edgeB[0] * z[0] + triangle.edgeB[1] * z[1] + triangle.edgeB[2] * z[2]) * invArea;
+	triangle.depth[2] = (triangle.edgeC[0] * z[0] + triangle.edgeC[1] * z[1] + triangle.edgeC[2] * z[2]) * invArea;
+	triangle.minX = minX;
+	triangle.minY = minY;
+	triangle.maxX = maxX;
+	triangle.maxY = maxY;
+	triangle.draw = draw;
+	chunk.triangles.push_back(triangle);
+	if (pass.depthOnly)
+		return;
+
+	// Perspective correct attributes, value / w and 1 / w are linear across the screen
+	TriangleAttributes attributes;
+	attributes.originX = x[0];
+	attributes.originY = y[0];
+	attributes.invW[0] = (triangle.edgeA[0] * invW[0] + triangle.edgeA[1] * invW[1] + triangle.edgeA[2] * invW[2]) * invArea;
+	attributes.invW[1] = (triangle.edgeB[0] * invW[0] + triangle.edgeB[1] * invW[1] + triangle.edgeB[2] * invW[2]) * invArea;
+	attributes.invW[2] = invW[0];
+	for (int i = 0; i < VaryingCount; i++)
+	{
+		float f0 = v0.varyings[i] * invW[0];
+		float f1 = v1.varyings[i] * invW[1];
+		float f2 = v2.varyings[i] * invW[2];
+		attributes.varyings[i][0] = (triangle.edgeA[0] * f0 + triangle.edgeA[1] * f1 + triangle.edgeA[2] * f2) * invArea;
+		attributes.varyings[i][1] = (triangle.edgeB[0] * f0 + triangle.edgeB[1] * f1 + triangle.edgeB[2] * f2) * invArea;
+		attributes.varyings[i][2] = f0;
+	}
+	chunk.attributes.push_back(attributes);
+}
+
+/// <summary>Returns false if one of the triangle's edges has every pixel center of the tile outside it
+/// Uses the raster loop's arithmetic, which only grows towards the corner the edge faces
+/// </summary>
+static bool MayCoverTile(const float* edgeA, const float* edgeB, const float* edgeC, int tileX, int tileY)
+{
+	const int TileSize = SoftwareRenderer::TileSize;
+	for (int k = 0; k < 3; k++)
+	{
+		float x = (float)(edgeA[k] > 0.0f ? tileX + TileSize - 1 : tileX) + 0.5f;
+		float y = (float)(edgeB[k] > 0.0f ? tileY + TileSize - 1 : tileY) + 0.5f;
+		if (edgeA[k] * x + (edgeB[k] * y + edgeC[k]) < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+void SoftwareRenderer::BinChunk(const Pass& pass, Chunk& chunk)
+{
+	// Counted first, then each tile's offset is used as its write cursor and shifted back afterwards
+	UINT tileCount = pass.tilesX * pass.tilesY;
+	chunk.binOffsets.assign(tileCount + 1, 0);
+	for (int step = 0; step < 2; step++)
+	{
+		for (UINT i = 0; i < chunk.triangles.size(); i++)
+		{
+			const RasterTriangle& triangle = chunk.triangles[i];
+			for (int ty = triangle.minY / TileSize; ty <= triangle.maxY / TileSize; ty++)
+			{
+				for (int tx = triangle.minX / TileSize; tx <= triangle.maxX / TileSize; tx++)
+				{
+					if (!MayCoverTile(triangle.edgeA, triangle.edgeB, triangle.edgeC, tx * TileSize, ty * TileSize))
+						continue;
+
+					UINT tile = ty * pass.tilesX + tx;
+					if (step == 0)
+						chunk.binOffsets[tile + 1]++;
+					else
+						chunk.binTriangles[chunk.binOffsets[tile]++] = i;
+				}
+			}
+		}
+
+		if (step == 0)
+		{
+			for (UINT tile = 0; tile < tileCount; tile++)
+				chunk.binOffsets[tile + 1] += chunk.binOffsets[tile];
+			chunk.binTriangles.resize(chunk.binOffsets[tileCount]);
+		}
+	}
+	for (UINT tile = tileCount; tile > 0; tile--)
+		chunk.binOffsets[tile] = chunk.binOffsets[tile - 1];
+	chunk.binOffsets[0] = 0;
+}
+
+void SoftwareRenderer::RenderTile(const Pass& pass, UINT tile, Worker& worker)
+{
+	int tileX = (int)(tile % pass.tilesX) * TileSize;
+	int tileY = (int)(tile / pass.tilesX) * TileSize;
+	std::fill(worker.depth.begin(), worker.depth.end(), 1.0f);
+	UINT* ids = NULL;
+	if (!pass.depthOnly)
+	{
+		std::fill(worker.ids.begin(), worker.ids.end(), EmptyId);
+		ids = &worker.ids[0];
+	}
+
+	for (UINT c = 0; c < chunkCount; c++)
+	{
+		const Chunk& chunk = chunks[c];
+		for (UINT b = chunk.binOffsets[tile]; b < chunk.binOffsets[tile + 1]; b++)
+		{
+			UINT local = chunk.binTriangles[b];
+			RasterizeTriangle(chunk.triangles[local], tileX, tileY, &worker.depth[0], ids, (c << ChunkIdBits) | local);
+		}
+		worker.binned += chunk.binOffsets[tile + 1] - chunk.binOffsets[tile];
+	}
+
+	if (!pass.depthOnly)
+	{
+		ShadeTile(pass, tileX, tileY, ids, worker);
+		return;
+	}
+
+	int rows = min(TileSize, (int)pass.height - tileY);
+	int columns = min(TileSize, (int)pass.width - tileX);
+	for (int y = 0; y < rows; y++)
+		memcpy(&shadowDepth[(size_t)(tileY + y) * pass.width + tileX], &worker.depth[y * TileSize], columns * sizeof(float));
+}
+
+static __m128 InsideEdge(__m128 e, __m128 topLeft)
+{
+	__m128 zero = _mm_setzero_ps();
+	return _mm_or_ps(_mm_cmpgt_ps(e, zero), _mm_and_ps(_mm_cmpeq_ps(e, zero), topLeft));
+}
+
+void SoftwareRenderer::RasterizeTriangle(const RasterTriangle& triangle, int tileX, int tileY, float* depth, UINT* ids, UINT id)
+{
+	int x0 = max(triangle.minX, tileX);
+	int y0 = max(triangle.minY, tileY);
+	int x1 = min(triangle.maxX, tileX + TileSize - 1);
+	int y1 = min(triangle.maxY, tileY + TileSize - 1);
+	if (x0 > x1 || y0 > y1)
+		return;
+
+	// Four pixels of a row at a time, tiles start on a multiple of four so the groups never leave the tile
+	x0 &= ~3;
+	const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 allBits = _mm_castsi128_ps(_mm_set1_epi32(-1));
+	__m128 a[3], topLeft[3];
+	for (int k = 0; k < 3; k++)
+	{
+		a[k] = _mm_set1_ps(triangle.edgeA[k]);
+		topLeft[k] = (triangle.topLeft & (1 << k)) ? allBits : _mm_setzero_ps();
+	}
+	__m128 depthX = _mm_set1_ps(triangle.depth[0]);
+	__m128i idVector = _mm_set1_epi32((int)id);
+
+	for (int y = y0; y <= y1; y++)
+	{
+		float py = y + 0.5f;
+		__m128 row0 = _mm_set1_ps(triangle.edgeB[0] * py + triangle.edgeC[0]);
+		__m128 row1 = _mm_set1_ps(triangle.edgeB[1] * py + triangle.edgeC[1]);
+		__m128 row2 = _mm_set1_ps(triangle.edgeB[2] * py + triangle.edgeC[2]);
+		__m128 rowDepth = _mm_set1_ps(triangle.depth[1] * py + triangle.depth[2]);
+		float* depthRow = depth + (y - tileY) * TileSize - tileX;
+		UINT* idRow = ids ? ids + (y - tileY) * TileSize - tileX : NULL;
+
+		for (int x = x0; x <= x1; x += 4)
+		{
+			__m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+			__m128 inside = InsideEdge(_mm_add_ps(_mm_mul_ps(a[0], px), row0), topLeft[0]);
+			inside = _mm_and_ps(inside, InsideEdge(_mm_add_ps(_mm_mul_ps(a[1], px), row1), topLeft[1]));
+			inside = _mm_and_ps(inside, InsideEdge(_mm_add_ps(_mm_mul_ps(a[2], px), row2), topLeft[2]));
+			if (!_mm_movemask_ps(inside))
+				continue;
+
+			// LESS_EQUAL like the simulation's depth stencil state
+			__m128 z = _mm_add_ps(_mm_mul_ps(depthX, px), rowDepth);
+			__m128 old = _mm_loadu_ps(depthRow + x);
+			__m128 pass = _mm_and_ps(inside, _mm_cmple_ps(z, old));
+			if (!_mm_movemask_ps(pass))
+				continue;
+
+			_mm_storeu_ps(depthRow + x, _mm_or_ps(_mm_and_ps(pass, z), _mm_andnot_ps(pass, old)));
+			if (idRow)
+			{
+				__m128i passBits = _mm_castps_si128(pass);
+				__m128i oldIds = _mm_loadu_si128((const __m128i*)(idRow + x));
+				_mm_storeu_si128((__m128i*)(idRow + x), _mm_or_si128(_mm_and_si128(passBits, idVector), _mm_andnot_si128(passBits, oldIds)));
+			}
+		}
+	}
+}
+
+void SoftwareRenderer::ShadeTile(const Pass& pass, int tileX, int tileY, const UINT* ids, Worker& worker)
+{
+	SoftwareShadowMap shadowMap = { shadowSize, shadowDepth.empty() ? NULL : &shadowDepth[0] };
+	BYTE clear[4] = { ToUnorm(frame.clearColor.x), ToUnorm(frame.clearColor.y), ToUnorm(frame.clearColor.z), ToUnorm(frame.clearColor.w) };
+
+	int rows = min(TileSize, (int)pass.height - tileY);
+	int columns = min(TileSize, (int)pass.width - tileX);
+	for (int y = 0; y < rows; y++)
+	{
+		BYTE* out = &image.rgba[((size_t)(tileY + y) * pass.width + tileX) * 4];
+		for (int x = 0; x < columns; x++, out += 4)
+		{
+			UINT id = ids[y * TileSize + x];
+			if (id == EmptyId)
+			{
+				memcpy(out, clear, 4);
+				continue;
+			}
+
+			const Chunk& chunk = chunks[id >> ChunkIdBits];
+			UINT local = id & ((1 << ChunkIdBits) - 1);
+			const TriangleAttributes& attributes = chunk.attributes[local];
+
+			// Varyings are evaluated at the pixel center
+			float px = tileX + x + 0.5f - attributes.originX;
+			float py = tileY + y + 0.5f - attributes.originY;
+			float w = 1.0f / (attributes.invW[2] + attributes.invW[0] * px + attributes.invW[1] * py);
+			SoftwarePixelInput input;
+			for (int i = 0; i < VaryingCount; i++)
+			{
+				const float* plane = attributes.varyings[i];
+				input.varyings[i] = (plane[2] + plane[0] * px + plane[1] * py) * w;
+			}
+
+			// Exact screen space derivatives of the uv, where ddx and ddy would take differences across the quad
+			for (int i = 0; i < 2; i++)
+			{
+				const float* plane = attributes.varyings[VaryingUV + i];
+				float value = input.varyings[VaryingUV + i];
+				input.uvDx[i] = (plane[0] - value * attributes.invW[0]) * w;
+				input.uvDy[i] = (plane[1] - value * attributes.invW[1]) * w;
+			}
+
+			const SoftwareDraw& draw = draws[chunk.triangles[local].draw];
+			XMFLOAT4 color = SoftwareShader::ShadePixel(input, *draw.material, frame, shadowMap);
+			out[0] = ToUnorm(color.x);
+			out[1] = ToUnorm(color.y);
+			out[2] = ToUnorm(color.z);
+			out[3] = ToUnorm(color.w);
+			worker.shaded++;
+		}
+	}
+}
+
+void SoftwareRenderer::RunParallel(UINT count, const std::function<void(UINT, UINT)>& work)
+{
+	std::atomic<UINT> next(0);
+	auto run = [&](UINT worker)
+	{
+		for (UINT item = next++; item < count; item = next++)
+			work(item, worker);
+	};
+
+	// The calling thread is one of the workers
+	UINT workerCount = min((UINT)workers.size(), count);
+	std::vector<std::thread> spawned;
+	for (UINT i = 1; i < workerCount; i++)
+		spawned.push_back(std::thread(run, i));
+	run(0);
+	for (std::thread& thread : spawned)
+		thread.join();
+}
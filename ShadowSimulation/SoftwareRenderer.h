@@ -0,0 +1,222 @@
+//
+// Renders recorded draws on the CPU, no device needed, so frames can be produced and checked headless
+// Triangles are set up and binned to screen tiles across threads, each tile is rasterized with SSE2 edge functions
+// into depth and a triangle id per pixel, then every visible pixel is shaded once with the LitPixel port
+// Draws are opaque, the blend state's alpha blending isn't emulated since the lit materials all write alpha 1
+//
+
+#ifndef SOFTWARERENDERER_H
+#define SOFTWARERENDERER_H
+
+#include <functional>
+#include <vector>
+#include <Windows.h>
+
+#include "SoftwareShader.h"
+
+/// <summary>One recorded draw. The vertices, indices and material must stay alive until End
+/// </summary>
+struct SoftwareDraw
+{
+	const Vertex* vertices;
+	UINT vertexCount;
+	const UINT* indices;
+	UINT indexCount;
+	XMFLOAT4X4 world;					// Untransposed, as the shader sees the perObject cbuffer
+	XMFLOAT4X4 worldInverseTranspose;
+	const SoftwareMaterial* material;
+};
+
+struct SoftwareRenderStats
+{
+	SoftwareRenderStats() :
+	draws(0),
+	triangles(0),
+	rasterizedTriangles(0),
+	binnedTriangles(0),
+	pixelsShaded(0),
+	shadowSeconds(0.0),
+	setupSeconds(0.0),
+	rasterSeconds(0.0)
+	{
+
+	}
+
+	UINT draws;
+	UINT64 triangles;				// Submitted to the main pass
+	UINT64 rasterizedTriangles;		// Left after clipping and culling, both passes
+	UINT64 binnedTriangles;			// Triangle and tile pairs, both passes
+	UINT64 pixelsShaded;
+	double shadowSeconds;
+	double setupSeconds;			// Main pass vertex shading, clipping and binning
+	double rasterSeconds;			// Main pass rasterization and shading
+};
+
+class SoftwareRenderer
+{
+public:
+	SoftwareRenderer();
+
+	/// <summary>Sizes the color target and the square shadow map
+	/// </summary>
+	void Resize(UINT width, UINT height, UINT shadowSize);
+
+	/// <summary>Worker threads, 0 uses every core. The image doesn't depend on the thread count
+	/// </summary>
+	void SetThreads(UINT threads);
+
+	/// <summary>Starts recording a frame, dropping the draws recorded for the last one
+	/// </summary>
+	void Begin(const SoftwareFrameData& frame);
+
+	void Draw(const SoftwareDraw& draw);
+
+	/// <summary>Renders the shadow map from the light and then the frame from the camera
+	/// </summary>
+	void End();
+
+	/// <summary>RGBA8 result of the last frame
+	/// </summary>
+	const ImageData& GetImage() const;
+
+	const SoftwareRenderStats& GetStats() const;
+
+	/// <summary>Edge functions and depth plane in pixels, what the raster loop reads
+	/// Edge i is zero along the side opposite vertex i and positive inside
+	/// </summary>
+	struct RasterTriangle
+	{
+		float edgeA[3];
+		float edgeB[3];
+		float edgeC[3];
+		float depth[3];		// z = depth[0] * x + depth[1] * y + depth[2]
+		int minX;
+		int minY;
+		int maxX;
+		int maxY;
+		UINT topLeft;		// Bit per edge, pixels exactly on a top or left edge belong to this triangle
+		UINT draw;
+	};
+
+	/// <summary>Depth tests the triangle's pixels inside the tile, writing depth and id where it passes (ids may be NULL)
+	/// depth and ids hold TileSize x TileSize values. Public so the raster loop can be benchmarked on its own
+	/// </summary>
+	static void RasterizeTriangle(const RasterTriangle& triangle, int tileX, int tileY, float* depth, UINT* ids, UINT id);
+
+	// Side of the square screen tiles triangles are binned to and rasterized in
+	static const int TileSize = 64;
+private:
+	/// <summary>Vertex after DefaultVertex ran, clip space position and the pixel shader inputs
+	/// </summary>
+	struct ClipVertex
+	{
+		float position[4];
+		float varyings[VaryingCount];
+	};
+
+	/// <summary>Planes of 1 / w and of every varying / w across the screen, measured from the first vertex
+	/// Only read for pixels that end up visible
+	/// </summary>
+	struct TriangleAttributes
+	{
+		float originX;
+		float originY;
+		float invW[3];
+		float varyings[VaryingCount][3];
+	};
+
+	/// <summary>A run of one draw's triangles set up and binned by a single worker
+	/// </summary>
+	struct Chunk
+	{
+		UINT draw;
+		UINT firstIndex;
+		UINT indexCount;
+		std::vector<RasterTriangle> triangles;
+		std::vector<TriangleAttributes> attributes;
+		std::vector<UINT> binOffsets;		// binTriangles[binOffsets[tile], binOffsets[tile + 1]) touch the tile
+		std::vector<UINT> binTriangles;
+	};
+
+	struct Worker
+	{
+		Worker() :
+		stamp(0),
+		rasterized(0),
+		binned(0),
+		shaded(0)
+		{
+
+		}
+
+		// Post transform cache, vertex i was shaded for this chunk if stamps[i] == stamp
+		std::vector<UINT> stamps;
+		std::vector<UINT> slots;
+		std::vector<ClipVertex> vertices;
+		UINT stamp;
+
+		std::vector<float> depth;	// Depth and triangle id of the tile being rasterized
+		std::vector<UINT> ids;
+
+		UINT64 rasterized;
+		UINT64 binned;
+		UINT64 shaded;
+	};
+
+	/// <summary>Target one pass renders into
+	/// </summary>
+	struct Pass
+	{
+		UINT width;
+		UINT height;
+		UINT tilesX;
+		UINT tilesY;
+		XMFLOAT4X4 viewProjection;
+		bool depthOnly;
+	};
+
+	/// <summary>Sets up and bins every recorded draw, then rasterizes the pass tile by tile
+	/// </summary>
+	void RenderPass(const Pass& pass, double& setupSeconds, double& rasterSeconds);
+
+	void SetupChunk(const Pass& pass, Chunk& chunk, Worker& worker);
+
+	/// <summary>Clips a triangle against the near and far planes and the guard band, then sets up what survives
+	/// </summary>
+	void ClipTriangle(const Pass& pass, const ClipVertex* v0, const ClipVertex* v1, const ClipVertex* v2, UINT draw, Chunk& chunk);
+
+	/// <summary>Projects a triangle to the screen and adds it to the chunk unless it is back facing or covers no pixel centers
+	/// </summary>
+	void SetupTriangle(const Pass& pass, const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2, UINT draw, Chunk& chunk);
+
+	void BinChunk(const Pass& pass, Chunk& chunk);
+
+	void RenderTile(const Pass& pass, UINT tile, Worker& worker);
+
+	void ShadeTile(const Pass& pass, int tileX, int tileY, const UINT* ids, Worker& worker);
+
+	/// <summary>Runs work(item, worker) for every item, workers pull items in order until none are left
+	/// </summary>
+	void RunParallel(UINT count, const std::function<void(UINT, UINT)>& work);
+
+	UINT threads;
+	UINT width;
+	UINT height;
+	UINT shadowSize;
+
+	SoftwareFrameData frame;
+	std::vector<SoftwareDraw> draws;
+	UINT maxVertexCount;
+
+	XMFLOAT4X4 shadowViewProjection;
+
+	std::vector<Chunk> chunks;		// Reused between passes, the first chunkCount belong to the current one
+	UINT chunkCount;
+	std::vector<Worker> workers;
+
+	std::vector<float> shadowDepth;
+	ImageData image;
+	SoftwareRenderStats stats;
+};
+
+#endif
@@ -0,0 +1,374 @@
+//
+// C++ port of DefaultVertex.hlsl and LitPixel.hlsli for the software renderer
+// Follows the HLSL line for line so frames match the D3D11 path, features are switched with the same ShaderFeature masks
+//
+
+#include "SoftwareShader.h"
+
+#include <cmath>
+
+#include "ShaderPermutations.h"
+
+static float Dot(const XMFLOAT3& a, const XMFLOAT3& b)
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static XMFLOAT3 Normalize(const XMFLOAT3& v)
+{
+	float scale = 1.0f / sqrtf(Dot(v, v));
+	return XMFLOAT3(v.x * scale, v.y * scale, v.z * scale);
+}
+
+static XMFLOAT3 Reflect(const XMFLOAT3& i, const XMFLOAT3& n)
+{
+	float d = 2.0f * Dot(i, n);
+	return XMFLOAT3(i.x - d * n.x, i.y - d * n.y, i.z - d * n.z);
+}
+
+static XMFLOAT4 Scale(const XMFLOAT4& v, float s)
+{
+	return XMFLOAT4(v.x * s, v.y * s, v.z * s, v.w * s);
+}
+
+static XMFLOAT4 Multiply(const XMFLOAT4& a, const XMFLOAT4& b)
+{
+	return XMFLOAT4(a.x * b.x, a.y * b.y, a.z * b.z, a.w * b.w);
+}
+
+static void Accumulate(XMFLOAT4& sum, const XMFLOAT4& v)
+{
+	sum.x += v.x;
+	sum.y += v.y;
+	sum.z += v.z;
+	sum.w += v.w;
+}
+
+static float Saturate(float v)
+{
+	return v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+}
+
+/// <summary>out = mul(float4(v, w), m), count components of the result
+/// </summary>
+static void Transform(const float* v, float w, const XMFLOAT4X4& m, float* out, int count)
+{
+	for (int j = 0; j < count; j++)
+		out[j] = v[0] * m.m[0][j] + v[1] * m.m[1][j] + v[2] * m.m[2][j] + w * m.m[3][j];
+}
+
+void SoftwareShader::ShadeVertex(const Vertex& vertex, const XMFLOAT4X4& worldViewProj, const XMFLOAT4X4& world, const XMFLOAT4X4& worldInverseTranspose,
+	const XMFLOAT4X4& shadowTransform, float* position, float* varyings)
+{
+	const float* p = &vertex.Position.x;
+	Transform(p, 1.0f, worldViewProj, position, 4);
+	if (!varyings)
+		return;
+
+	Transform(p, 1.0f, world, varyings + VaryingWorldPos, 3);
+	Transform(&vertex.Normal.x, 0.0f, worldInverseTranspose, varyings + VaryingNormal, 3);
+	Transform(&vertex.Tangent.x, 0.0f, world, varyings + VaryingTangent, 3);
+	varyings[VaryingUV] = vertex.UV.x;
+	varyings[VaryingUV + 1] = vertex.UV.y;
+
+	// Projected texture coordinates for the shadow map
+	float* shadowPos = varyings + VaryingShadowPos;
+	Transform(p, 1.0f, shadowTransform, shadowPos, 4);
+	shadowPos[0] = shadowPos[0] * 0.5f + 0.5f;
+	shadowPos[1] = shadowPos[1] * 0.5f + 0.5f;
+	shadowPos[1] = shadowPos[1] * -1.0f;
+}
+
+static XMFLOAT4 SampleBilinear(const ImageData& image, float u, float v)
+{
+	float x = u * image.width - 0.5f;
+	float y = v * image.height - 0.5f;
+	float floorX = floorf(x);
+	float floorY = floorf(y);
+	float fx = x - floorX;
+	float fy = y - floorY;
+
+	// Wrap addressing
+	int width = (int)image.width;
+	int height = (int)image.height;
+	int x0 = (int)fmodf(floorX, (float)width);
+	int y0 = (int)fmodf(floorY, (float)height);
+	if (x0 < 0)
+		x0 += width;
+	if (y0 < 0)
+		y0 += height;
+	int x1 = x0 + 1 == width ? 0 : x0 + 1;
+	int y1 = y0 + 1 == height ? 0 : y0 + 1;
+
+	const BYTE* row0 = &image.rgba[(size_t)y0 * width * 4];
+	const BYTE* row1 = &image.rgba[(size_t)y1 * width * 4];
+	float c[4];
+	for (int i = 0; i < 4; i++)
+	{
+		float top = row0[x0 * 4 + i] + (row0[x1 * 4 + i] - row0[x0 * 4 + i]) * fx;
+		float bottom = row1[x0 * 4 + i] + (row1[x1 * 4 + i] - row1[x0 * 4 + i]) * fx;
+		c[i] = (top + (bottom - top) * fy) * (1.0f / 255.0f);
+	}
+	return XMFLOAT4(c[0], c[1], c[2], c[3]);
+}
+
+XMFLOAT4 SoftwareShader::Sample(const SoftwareTexture& texture, float u, float v, float lod)
+{
+	// Unbound textures read as zero, like an empty slot on the device
+	if (texture.mips.empty())
+		return XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+
+	float maxLod = (float)(texture.mips.size() - 1);
+	lod = lod < 0.0f ? 0.0f : (lod > maxLod ? maxLod : lod);
+	UINT level = (UINT)lod;
+	float blend = lod - level;
+
+	XMFLOAT4 c = SampleBilinear(texture.mips[level], u, v);
+	if (blend > 0.0f)
+	{
+		XMFLOAT4 next = SampleBilinear(texture.mips[level + 1], u, v);
+		c.x += (next.x - c.x) * blend;
+		c.y += (next.y - c.y) * blend;
+		c.z += (next.z - c.z) * blend;
+		c.w += (next.w - c.w) * blend;
+	}
+	return c;
+}
+
+float SoftwareShader::GetLod(const SoftwareTexture& texture, const float* uvDx, const float* uvDy)
+{
+	if (texture.mips.empty())
+		return 0.0f;
+
+	// Longest of the two screen axes measured in texels of the top mip
+	float width = (float)texture.mips[0].width;
+	float height = (float)texture.mips[0].height;
+	float x = (uvDx[0] * width) * (uvDx[0] * width) + (uvDx[1] * height) * (uvDx[1] * height);
+	float y = (uvDy[0] * width) * (uvDy[0] * width) + (uvDy[1] * height) * (uvDy[1] * height);
+	float rhoSquared = max(x, y);
+	return rhoSquared > 1.0f ? 0.5f * log2f(rhoSquared) : 0.0f;
+}
+
+float SoftwareShader::SampleShadow(const SoftwareShadowMap& shadowMap, float u, float v, float depth)
+{
+	float x = u * shadowMap.size - 0.5f;
+	float y = v * shadowMap.size - 0.5f;
+	float floorX = floorf(x);
+	float floorY = floorf(y);
+	float fx = x - floorX;
+	float fy = y - floorY;
+
+	int size = (int)shadowMap.size;
+	int x0 = (int)fmodf(floorX, (float)size);
+	int y0 = (int)fmodf(floorY, (float)size);
+	if (x0 < 0)
+		x0 += size;
+	if (y0 < 0)
+		y0 += size;
+	int x1 = x0 + 1 == size ? 0 : x0 + 1;
+	int y1 = y0 + 1 == size ? 0 : y0 + 1;
+
+	// Each texel is compared before filtering, LESS_EQUAL passes when the pixel is no further than the occluder
+	const float* row0 = shadowMap.depth + (size_t)y0 * size;
+	const float* row1 = shadowMap.depth + (size_t)y1 * size;
+	float c00 = depth <= row0[x0] ? 1.0f : 0.0f;
+	float c10 = depth <= row0[x1] ? 1.0f : 0.0f;
+	float c01 = depth <= row1[x0] ? 1.0f : 0.0f;
+	float c11 = depth <= row1[x1] ? 1.0f : 0.0f;
+	float top = c00 + (c10 - c00) * fx;
+	float bottom = c01 + (c11 - c01) * fx;
+	return top + (bottom - top) * fy;
+}
+
+float SoftwareShader::ComputeShadow(const float* shadowPos, UINT features, const SoftwareShadowMap& shadowMap)
+{
+	// Complete projection (if using perspective projection)
+	float u = shadowPos[0] / shadowPos[3];
+	float v = shadowPos[1] / shadowPos[3];
+	float lightDepth = shadowPos[2] / shadowPos[3];
+
+	// Calculate distance between each pixel
+	float dx = 1.0f / shadowMap.size;
+
+	int kernel = (features & FeaturePCF9) ? 3 : ((features & FeaturePCF4) ? 2 : 1);
+
+	// PCF Filtering, a kernel x kernel grid centered on the pixel
+	float percentLit = 0.0f;
+	for (int y = 0; y < kernel; y++)
+	{
+		for (int x = 0; x < kernel; x++)
+		{
+			float offsetX = (x - (kernel - 1) * 0.5f) * dx;
+			float offsetY = (y - (kernel - 1) * 0.5f) * dx;
+			percentLit += SampleShadow(shadowMap, u + offsetX, v + offsetY, lightDepth - 0.0005f);
+		}
+	}
+
+	return percentLit / (kernel * kernel);
+}
+
+void SoftwareShader::ComputeDirectionalLight(const LightMaterial& mat, const DirectionalLight& light, const XMFLOAT3& normal, const XMFLOAT3& toEye,
+	XMFLOAT4& ambient, XMFLOAT4& diffuse, XMFLOAT4& spec)
+{
+	diffuse = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+	spec = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+
+	XMFLOAT3 lightVec(-light.direction.x, -light.direction.y, -light.direction.z);
+	ambient = Multiply(mat.ambient, light.ambient);
+	float diffuseFactor = Dot(lightVec, normal);
+	if (diffuseFactor > 0.0f)
+	{
+		XMFLOAT3 v = Reflect(XMFLOAT3(-lightVec.x, -lightVec.y, -lightVec.z), normal);
+		float specFactor = powf(max(Dot(v, toEye), 0.0f), mat.specular.w);
+		diffuse = Scale(Multiply(mat.diffuse, light.diffuse), diffuseFactor);
+		spec = Scale(Multiply(mat.specular, light.specular), specFactor);
+	}
+}
+
+void SoftwareShader::ComputePointLight(const LightMaterial& mat, const PointLight& light, const XMFLOAT3& pos, const XMFLOAT3& normal, const XMFLOAT3& toEye,
+	XMFLOAT4& ambient, XMFLOAT4& diffuse, XMFLOAT4& spec)
+{
+	ambient = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+	diffuse = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+	spec = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+
+	XMFLOAT3 lightVec(light.position.x - pos.x, light.position.y - pos.y, light.position.z - pos.z);
+	float d = sqrtf(Dot(lightVec, lightVec));
+	if (d > light.range)
+		return;
+
+	lightVec = XMFLOAT3(lightVec.x / d, lightVec.y / d, lightVec.z / d);
+
+	ambient = Multiply(mat.ambient, light.ambient);
+	float diffuseFactor = Dot(normal, lightVec);
+	if (diffuseFactor > 0.0f)
+	{
+		XMFLOAT3 v = Reflect(XMFLOAT3(-lightVec.x, -lightVec.y, -lightVec.z), normal);
+		float specFactor = powf(max(Dot(v, toEye), 0.0f), mat.specular.w);
+		diffuse = Scale(Multiply(mat.diffuse, light.diffuse), diffuseFactor);
+		spec = Scale(Multiply(mat.specular, light.specular), specFactor);
+	}
+
+	float att = 1.0f / (light.attenuation.x + light.attenuation.y * d + light.attenuation.z * d * d);
+	diffuse = Scale(diffuse, att);
+	spec = Scale(spec, att);
+}
+
+void SoftwareShader::ComputeSpotLight(const LightMaterial& mat, const SpotLight& light, const XMFLOAT3& pos, const XMFLOAT3& normal, const XMFLOAT3& toEye,
+	XMFLOAT4& ambient, XMFLOAT4& diffuse, XMFLOAT4& spec)
+{
+	ambient = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+	diffuse = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+	spec = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+
+	XMFLOAT3 lightVec(light.position.x - pos.x, light.position.y - pos.y, light.position.z - pos.z);
+	float d = sqrtf(Dot(lightVec, lightVec));
+	if (d > light.range)
+		return;
+	lightVec = XMFLOAT3(lightVec.x / d, lightVec.y / d, lightVec.z / d);
+	ambient = Multiply(mat.ambient, light.ambient);
+	float diffuseFactor = Dot(lightVec, normal);
+	if (diffuseFactor > 0.0f)
+	{
+		XMFLOAT3 v = Reflect(XMFLOAT3(-lightVec.x, -lightVec.y, -lightVec.z), normal);
+		float specFactor = powf(max(Dot(v, toEye), 0.0f), mat.specular.w);
+		diffuse = Scale(Multiply(mat.diffuse, light.diffuse), fabsf(diffuseFactor));
+		spec = Scale(Multiply(mat.specular, light.specular), specFactor);
+	}
+
+	XMFLOAT3 toLight(-lightVec.x, -lightVec.y, -lightVec.z);
+	float spot = powf(max(Dot(toLight, light.direction), 0.0f), light.spot);
+	float att = spot / (light.attenuation.x + light.attenuation.y * d + light.attenuation.z * d * d);
+	ambient = Scale(ambient, spot);
+	diffuse = Scale(diffuse, att);
+	spec = Scale(spec, att);
+}
+
+XMFLOAT4 SoftwareShader::ShadePixel(const SoftwarePixelInput& input, const SoftwareMaterial& material, const SoftwareFrameData& frame, const SoftwareShadowMap& shadowMap)
+{
+	const float* in = input.varyings;
+	XMFLOAT3 worldPos(in[VaryingWorldPos], in[VaryingWorldPos + 1], in[VaryingWorldPos + 2]);
+	XMFLOAT3 inputNormal = Normalize(XMFLOAT3(in[VaryingNormal], in[VaryingNormal + 1], in[VaryingNormal + 2]));
+
+	// Tiled uv and its derivatives
+	float u = in[VaryingUV] * material.tileX;
+	float v = in[VaryingUV + 1] * material.tileZ;
+	float uvDx[2] = { input.uvDx[0] * material.tileX, input.uvDx[1] * material.tileZ };
+	float uvDy[2] = { input.uvDy[0] * material.tileX, input.uvDy[1] * material.tileZ };
+
+	XMFLOAT3 normal = inputNormal;
+	if (material.normal && (frame.features & FeatureNormalMap))
+	{
+		// Get the normal values from the map and unpack them
+		XMFLOAT4 sample = Sample(*material.normal, u, v, GetLod(*material.normal, uvDx, uvDy));
+		XMFLOAT3 normalT(2.0f * sample.x - 1.0f, 2.0f * sample.y - 1.0f, 2.0f * sample.z - 1.0f);
+
+		// TBN matrix calculation and bumped normal calculation
+		const XMFLOAT3& N = inputNormal;
+		XMFLOAT3 tangent(in[VaryingTangent], in[VaryingTangent + 1], in[VaryingTangent + 2]);
+		float tangentDotN = Dot(tangent, N);
+		XMFLOAT3 T = Normalize(XMFLOAT3(tangent.x - tangentDotN * N.x, tangent.y - tangentDotN * N.y, tangent.z - tangentDotN * N.z));
+		XMFLOAT3 B(N.y * T.z - N.z * T.y, N.z * T.x - N.x * T.z, N.x * T.y - N.y * T.x);
+		normal = Normalize(XMFLOAT3(normalT.x * T.x + normalT.y * B.x + normalT.z * N.x,
+			normalT.x * T.y + normalT.y * B.y + normalT.z * N.y,
+			normalT.x * T.z + normalT.y * B.z + normalT.z * N.z));
+	}
+
+	// Calculate relation to camera for specularity and camera based effects
+	XMFLOAT3 eyeOffset(frame.eyePos.x - worldPos.x, frame.eyePos.y - worldPos.y, frame.eyePos.z - worldPos.z);
+	float distToEye = sqrtf(Dot(eyeOffset, eyeOffset));
+	XMFLOAT3 toEye = Normalize(eyeOffset);
+
+	XMFLOAT4 ambient(0.0f, 0.0f, 0.0f, 0.0f);
+	XMFLOAT4 diffuse(0.0f, 0.0f, 0.0f, 0.0f);
+	XMFLOAT4 spec(0.0f, 0.0f, 0.0f, 0.0f);
+	XMFLOAT4 A, D, S;
+
+	if (frame.features & FeatureDirectionalLight)
+	{
+		ComputeDirectionalLight(material.lightMat, frame.dLight, normal, toEye, A, D, S);
+		Accumulate(ambient, A);
+		Accumulate(diffuse, D);
+		Accumulate(spec, S);
+	}
+
+	if (frame.features & FeaturePointLight)
+	{
+		ComputePointLight(material.lightMat, frame.pLight, worldPos, normal, toEye, A, D, S);
+		Accumulate(ambient, A);
+		Accumulate(diffuse, D);
+		Accumulate(spec, S);
+	}
+
+	if (frame.features & FeatureSpotLight)
+	{
+		ComputeSpotLight(material.lightMat, frame.sLight, worldPos, normal, toEye, A, D, S);
+		Accumulate(ambient, A);
+		Accumulate(diffuse, D);
+		Accumulate(spec, S);
+	}
+
+	float percentLit = (frame.features & FeatureShadows) ? ComputeShadow(in + VaryingShadowPos, frame.features, shadowMap) : 1.0f;
+
+	XMFLOAT4 texColor(0.0f, 0.0f, 0.0f, 0.0f);
+	if (material.diffuse)
+		texColor = Sample(*material.diffuse, u, v, GetLod(*material.diffuse, uvDx, uvDy));
+
+	// Calculate lit color based on lighting and shadow calculations
+	XMFLOAT4 litColor(texColor.x * (ambient.x + diffuse.x * percentLit) + spec.x * percentLit,
+		texColor.y * (ambient.y + diffuse.y * percentLit) + spec.y * percentLit,
+		texColor.z * (ambient.z + diffuse.z * percentLit) + spec.z * percentLit,
+		texColor.w * (ambient.w + diffuse.w * percentLit) + spec.w * percentLit);
+
+	if (frame.features & FeatureFog)
+	{
+		float fogLerp = Saturate((distToEye - frame.fogStart) / frame.fogRange);
+		litColor.x += (frame.fogColor.x - litColor.x) * fogLerp;
+		litColor.y += (frame.fogColor.y - litColor.y) * fogLerp;
+		litColor.z += (frame.fogColor.z - litColor.z) * fogLerp;
+	}
+
+	// Pass through alpha values
+	litColor.w = material.lightMat.diffuse.w;
+	return litColor;
+}
@@ -0,0 +1,125 @@
+//
+// C++ port of DefaultVertex.hlsl and LitPixel.hlsli for the software renderer
+// Follows the HLSL line for line so frames match the D3D11 path, features are switched with the same ShaderFeature masks
+//
+
+#ifndef SOFTWARESHADER_H
+#define SOFTWARESHADER_H
+
+#include <vector>
+#include <Windows.h>
+#include <DirectXMath.h>
+
+#include "ImageDecoder.h"
+#include "Lights.h"
+#include "Vertex.h"
+
+using namespace DirectX;
+
+/// <summary>RGBA8 mip chain, sampled trilinearly with wrap addressing like the simulation's wrap sampler
+/// </summary>
+struct SoftwareTexture
+{
+	std::vector<ImageData> mips;
+};
+
+struct SoftwareMaterial
+{
+	SoftwareMaterial() :
+	diffuse(NULL),
+	normal(NULL),
+	tileX(1.0f),
+	tileZ(1.0f)
+	{
+
+	}
+
+	LightMaterial lightMat;
+	const SoftwareTexture* diffuse;
+	const SoftwareTexture* normal;	// NULL shades with the interpolated normal like PixelNoNormal
+	float tileX;
+	float tileZ;
+};
+
+/// <summary>What the perFrame and shadow cbuffers hold. Matrices are untransposed, vectors multiply on the left like mul(v, m)
+/// </summary>
+struct SoftwareFrameData
+{
+	DirectionalLight dLight;
+	PointLight pLight;
+	SpotLight sLight;
+	XMFLOAT4X4 view;
+	XMFLOAT4X4 projection;
+	XMFLOAT3 eyePos;
+	XMFLOAT4 fogColor;
+	float fogStart;
+	float fogRange;
+	XMFLOAT4X4 shadowView;
+	XMFLOAT4X4 shadowProjection;
+	XMFLOAT4 clearColor;
+	UINT features;		// ShaderFeature bits, FeatureAll matches DefaultPixel.cso
+};
+
+/// <summary>Interpolated values DefaultVertex passes to the pixel shader, in VertexToPixel order
+/// </summary>
+enum SoftwareVarying
+{
+	VaryingWorldPos = 0,
+	VaryingNormal = 3,
+	VaryingTangent = 6,
+	VaryingUV = 9,
+	VaryingShadowPos = 11,
+	VaryingCount = 15
+};
+
+/// <summary>Light space depth the shadow pass rendered, sampled with the comparison sampler
+/// </summary>
+struct SoftwareShadowMap
+{
+	UINT size;
+	const float* depth;
+};
+
+struct SoftwarePixelInput
+{
+	float varyings[VaryingCount];
+	float uvDx[2];		// Screen space derivatives of the untiled uv, pick the mip level
+	float uvDy[2];
+};
+
+class SoftwareShader
+{
+public:
+	/// <summary>DefaultVertex: clip space position into position, every varying into varyings (which may be NULL)
+	/// shadowTransform is world * shadowView * shadowProjection
+	/// </summary>
+	static void ShadeVertex(const Vertex& vertex, const XMFLOAT4X4& worldViewProj, const XMFLOAT4X4& world, const XMFLOAT4X4& worldInverseTranspose,
+		const XMFLOAT4X4& shadowTransform, float* position, float* varyings);
+
+	/// <summary>LitPixel with the frame's features, less the normal map if the material has none. Returns linear RGBA
+	/// </summary>
+	static XMFLOAT4 ShadePixel(const SoftwarePixelInput& input, const SoftwareMaterial& material, const SoftwareFrameData& frame, const SoftwareShadowMap& shadowMap);
+
+	/// <summary>Trilinear sample with wrap addressing, lod 0 is the top mip
+	/// </summary>
+	static XMFLOAT4 Sample(const SoftwareTexture& texture, float u, float v, float lod);
+
+	/// <summary>Level of detail a texture is sampled at for the given uv derivatives
+	/// </summary>
+	static float GetLod(const SoftwareTexture& texture, const float* uvDx, const float* uvDy);
+
+	/// <summary>SampleCmpLevelZero with a LESS_EQUAL linear comparison sampler and wrap addressing
+	/// </summary>
+	static float SampleShadow(const SoftwareShadowMap& shadowMap, float u, float v, float depth);
+private:
+	static float ComputeShadow(const float* shadowPos, UINT features, const SoftwareShadowMap& shadowMap);
+
+	static void ComputeDirectionalLight(const LightMaterial& mat, const DirectionalLight& light, const XMFLOAT3& normal, const XMFLOAT3& toEye,
+		XMFLOAT4& ambient, XMFLOAT4& diffuse, XMFLOAT4& spec);
+	static void ComputePointLight(const LightMaterial& mat, const PointLight& light, const XMFLOAT3& pos, const XMFLOAT3& normal, const XMFLOAT3& toEye,
+		XMFLOAT4& ambient, XMFLOAT4& diffuse, XMFLOAT4& spec);
+	static void ComputeSpotLight(const LightMaterial& mat, const SpotLight& light, const XMFLOAT3& pos, const XMFLOAT3& normal, const XMFLOAT3& toEye,
+		XMFLOAT4& ambient, XMFLOAT4& diffuse, XMFLOAT4& spec);
+};
+
+#endif
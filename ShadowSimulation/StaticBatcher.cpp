@@ -0,0 +1,241 @@
+//
+// Merges objects that never move into a few large meshes at load
+//
+
+#include "StaticBatcher.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <string>
+
+#include "Profiler.h"
+
+// Clusters are at most this many world units along any axis, small enough to still be culled on their own
+static const float DefaultClusterSize = 25.0f;
+
+// Most vertices one cluster may hold, meshes with over half of that gain little from merging and are left alone
+static const UINT DefaultClusterVertices = 65536;
+
+// Batches hold a world space copy of every instance, this caps what they may add up to
+static const UINT64 DefaultBudget = 64 * 1024 * 1024;
+
+StaticBatcher::StaticBatcher() :
+enabled(true),
+clusterSize(DefaultClusterSize),
+clusterVertices(DefaultClusterVertices),
+budget(DefaultBudget)
+{
+
+}
+
+void StaticBatcher::ParseCommandLine(const char* cmdLine)
+{
+	if (!cmdLine)
+		return;
+
+	std::istringstream args(cmdLine);
+	std::string arg;
+	while (args >> arg)
+	{
+		size_t split = arg.find('=');
+		if (split == std::string::npos)
+			continue;
+
+		std::string key = arg.substr(0, split);
+		std::string value = arg.substr(split + 1);
+		if (key == "staticbatch")
+			enabled = value != "0";
+		else if (key == "staticbatchsize")
+			clusterSize = max((float)atof(value.c_str()), 0.0f);
+		else if (key == "staticbatchvertices")
+			clusterVertices = (UINT)max(atoi(value.c_str()), 0);
+		else if (key == "staticbatchmb")
+			budget = (UINT64)(max(atof(value.c_str()), 0.0) * 1024 * 1024);
+	}
+}
+
+bool StaticBatcher::IsEnabled() const { return enabled; }
+
+void StaticBatcher::Build(const std::vector<StaticInstance>& instances, std::vector<StaticBatch>& batches)
+{
+	PROFILE_ZONE("StaticBatcher::Build");
+	batches.clear();
+	stats = StaticBatchStats();
+	stats.instances = (UINT)instances.size();
+	stats.drawsBefore = stats.instances;
+	stats.drawsAfter = stats.instances;
+	if (!enabled)
+		return;
+
+	// Instances by material, each with its mesh's bounds moved into world space
+	std::map<const MeshData*, MeshBounds> meshBounds;
+	std::map<UINT, std::vector<Item> > materials;
+	for (UINT i = 0; i < instances.size(); i++)
+	{
+		const StaticInstance& instance = instances[i];
+		const MeshData* mesh = instance.mesh;
+		if (!mesh || mesh->vertices.empty() || mesh->indices.empty() || mesh->vertices.size() > clusterVertices / 2)
+			continue;
+
+		std::map<const MeshData*, MeshBounds>::iterator found = meshBounds.find(mesh);
+		if (found == meshBounds.end())
+			found = meshBounds.insert(std::make_pair(mesh, ComputeMeshBounds(&mesh->vertices[0], (UINT)mesh->vertices.size()))).first;
+		const MeshBounds& bounds = found->second;
+
+		Item item;
+		item.instance = i;
+		item.vertices = (UINT)mesh->vertices.size();
+		XMMATRIX world = XMLoadFloat4x4(&instance.world);
+		XMStoreFloat3(&item.center, XMVector3TransformCoord(XMLoadFloat3(&bounds.center), world));
+		XMVECTOR extents = XMVectorAbs(world.r[0] * bounds.extents.x) + XMVectorAbs(world.r[1] * bounds.extents.y) +
+			XMVectorAbs(world.r[2] * bounds.extents.z);
+		XMStoreFloat3(&item.extents, extents);
+		materials[instance.material].push_back(item);
+	}
+
+	for (std::map<UINT, std::vector<Item> >::iterator material = materials.begin(); material != materials.end(); ++material)
+	{
+		std::vector<Item>& items = material->second;
+		std::vector<std::pair<size_t, size_t> > clusters;
+		Cluster(items, 0, items.size(), clusters);
+
+		for (size_t i = 0; i < clusters.size(); i++)
+		{
+			// A cluster of one draws the same as the object it holds
+			if (clusters[i].second - clusters[i].first < 2)
+				continue;
+
+			batches.push_back(StaticBatch());
+			StaticBatch& batch = batches.back();
+			batch.material = material->first;
+			Merge(instances, items, clusters[i].first, clusters[i].second, batch);
+
+			UINT64 bytes = batch.data.vertices.size() * sizeof(Vertex) + batch.data.indices.size() * sizeof(UINT);
+			if (stats.bytes + bytes > budget)
+			{
+				batches.pop_back();
+				continue;
+			}
+			stats.bytes += bytes;
+			stats.batched += (UINT)batch.instances.size();
+			stats.batches++;
+		}
+	}
+	stats.drawsAfter = stats.instances - stats.batched + stats.batches;
+}
+
+const StaticBatchStats& StaticBatcher::GetStats() const { return stats; }
+
+void StaticBatcher::Cluster(std::vector<Item>& items, size_t begin, size_t end, std::vector<std::pair<size_t, size_t> >& clusters) const
+{
+	if (begin == end)
+		return;
+
+	XMVECTOR low = XMVectorReplicate(FLT_MAX);
+	XMVECTOR high = XMVectorReplicate(-FLT_MAX);
+	XMVECTOR centerLow = low;
+	XMVECTOR centerHigh = high;
+	UINT64 vertices = 0;
+	for (size_t i = begin; i < end; i++)
+	{
+		XMVECTOR center = XMLoadFloat3(&items[i].center);
+		XMVECTOR extents = XMLoadFloat3(&items[i].extents);
+		low = XMVectorMin(low, center - extents);
+		high = XMVectorMax(high, center + extents);
+		centerLow = XMVectorMin(centerLow, center);
+		centerHigh = XMVectorMax(centerHigh, center);
+		vertices += items[i].vertices;
+	}
+
+	XMFLOAT3 size;
+	XMStoreFloat3(&size, high - low);
+	if (end - begin == 1 || (max(size.x, max(size.y, size.z)) <= clusterSize && vertices <= clusterVertices))
+	{
+		clusters.push_back(std::make_pair(begin, end));
+		return;
+	}
+
+	// Halves split where the instances spread the most keep clusters compact, splitting by count keeps the tree balanced
+	XMFLOAT3 spread;
+	XMStoreFloat3(&spread, centerHigh - centerLow);
+	int axis = spread.x >= spread.y && spread.x >= spread.z ? 0 : (spread.y >= spread.z ? 1 : 2);
+	size_t middle = begin + (end - begin) / 2;
+	std::nth_element(items.begin() + begin, items.begin() + middle, items.begin() + end, [axis](const Item& a, const Item& b)
+	{
+		return (&a.center.x)[axis] < (&b.center.x)[axis];
+	});
+
+	Cluster(items, begin, middle, clusters);
+	Cluster(items, middle, end, clusters);
+}
+
+void StaticBatcher::Merge(const std::vector<StaticInstance>& instances, const std::vector<Item>& items, size_t begin, size_t end,
+	StaticBatch& batch)
+{
+	MeshData& data = batch.data;
+	UINT levelCount = 1;
+	std::vector<UINT> baseVertices;
+	for (size_t i = begin; i < end; i++)
+	{
+		const StaticInstance& instance = instances[items[i].instance];
+		levelCount = max(levelCount, (UINT)instance.mesh->lods.size());
+		baseVertices.push_back((UINT)data.vertices.size());
+		AppendVertices(*instance.mesh, instance.world, data.vertices);
+		batch.instances.push_back(items[i].instance);
+	}
+
+	// Level n holds every instance at its level n, or its coarsest if it has fewer. Errors are in world units now,
+	// so each instance's is scaled by the largest scale its transform applies
+	data.lods.resize(levelCount);
+	for (UINT level = 0; level < levelCount; level++)
+	{
+		MeshLOD& merged = data.lods[level];
+		merged.indexStart = (UINT)data.indices.size();
+		merged.error = 0.0f;
+
+		for (size_t i = begin; i < end; i++)
+		{
+			const StaticInstance& instance = instances[items[i].instance];
+			const MeshData& mesh = *instance.mesh;
+			MeshLOD whole = { 0, (UINT)mesh.indices.size(), 0.0f };
+			const MeshLOD& lod = mesh.lods.empty() ? whole : mesh.lods[min(level, (UINT)mesh.lods.size() - 1)];
+
+			XMMATRIX world = XMLoadFloat4x4(&instance.world);
+			float scale = max(XMVectorGetX(XMVector3Length(world.r[0])), max(XMVectorGetX(XMVector3Length(world.r[1])),
+				XMVectorGetX(XMVector3Length(world.r[2]))));
+			merged.error = max(merged.error, lod.error * scale);
+
+			// Mirroring transforms flip the winding, swapping two corners of each triangle flips it back
+			bool mirrored = XMVectorGetX(XMMatrixDeterminant(world)) < 0.0f;
+			UINT baseVertex = baseVertices[i - begin];
+			const UINT* indices = &mesh.indices[lod.indexStart];
+			for (UINT j = 0; j + 2 < lod.indexCount; j += 3)
+			{
+				data.indices.push_back(baseVertex + indices[j]);
+				data.indices.push_back(baseVertex + indices[mirrored ? j + 2 : j + 1]);
+				data.indices.push_back(baseVertex + indices[mirrored ? j + 1 : j + 2]);
+			}
+		}
+		merged.indexCount = (UINT)data.indices.size() - merged.indexStart;
+	}
+
+	batch.bounds = ComputeMeshBounds(&data.vertices[0], (UINT)data.vertices.size());
+}
+
+void StaticBatcher::AppendVertices(const MeshData& mesh, const XMFLOAT4X4& transform, std::vector<Vertex>& vertices)
+{
+	// Normals go through the inverse transpose so non-uniform scales keep them perpendicular to the surface
+	XMMATRIX world = XMLoadFloat4x4(&transform);
+	XMMATRIX normalWorld = XMMatrixTranspose(XMMatrixInverse(nullptr, world));
+	for (const Vertex& source : mesh.vertices)
+	{
+		Vertex vertex = source;
+		XMStoreFloat3(&vertex.Position, XMVector3TransformCoord(XMLoadFloat3(&source.Position), world));
+		XMStoreFloat3(&vertex.Normal, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&source.Normal), normalWorld)));
+		XMStoreFloat3(&vertex.Tangent, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&source.Tangent), world)));
+		vertices.push_back(vertex);
+	}
+}
@@ -0,0 +1,97 @@
+//
+// Merges objects that never move into a few large meshes at load, so they cost one draw per cluster instead of one each
+// Instances sharing a material are split into spatial clusters, each cluster's meshes are transformed into world space
+// and appended into one mesh whose bounds still let the cluster be culled and picked a level of detail as a whole
+// Command line: staticbatch=0 turns it off, staticbatchsize=<largest cluster edge in world units>,
+// staticbatchvertices=<most vertices in a cluster>, staticbatchmb=<most memory all clusters together may take>
+//
+
+#ifndef STATICBATCHER_H
+#define STATICBATCHER_H
+
+#include <vector>
+#include <Windows.h>
+#include <DirectXMath.h>
+
+#include "MeshData.h"
+
+using namespace DirectX;
+
+/// <summary>An object that may be merged, material is any key telling apart objects that can't share a draw
+/// </summary>
+struct StaticInstance
+{
+	const MeshData* mesh;
+	XMFLOAT4X4 world;
+	UINT material;
+};
+
+/// <summary>Instances merged into one world space mesh. Its levels of detail each hold every instance at that level
+/// </summary>
+struct StaticBatch
+{
+	UINT material;
+	std::vector<UINT> instances;	// Indices into the instances given to Build
+	MeshData data;
+	MeshBounds bounds;
+};
+
+struct StaticBatchStats
+{
+	StaticBatchStats() : instances(0), batched(0), batches(0), drawsBefore(0), drawsAfter(0), bytes(0) {}
+
+	UINT instances;
+	UINT batched;		// Instances now drawn as part of a batch
+	UINT batches;
+	UINT drawsBefore;	// Draws a pass took for the instances, and takes now
+	UINT drawsAfter;
+	UINT64 bytes;		// Vertices and indices of every batch
+};
+
+class StaticBatcher
+{
+public:
+	StaticBatcher();
+
+	void ParseCommandLine(const char* cmdLine);
+
+	bool IsEnabled() const;
+
+	/// <summary>Clusters and merges the instances. Instances left out of every batch, alone in their cluster, too large
+	/// or past the memory budget, still have to be drawn on their own
+	/// </summary>
+	void Build(const std::vector<StaticInstance>& instances, std::vector<StaticBatch>& batches);
+
+	const StaticBatchStats& GetStats() const;
+private:
+	/// <summary>An instance being clustered, with its bounds in world space
+	/// </summary>
+	struct Item
+	{
+		UINT instance;
+		XMFLOAT3 center;
+		XMFLOAT3 extents;
+		UINT vertices;
+	};
+
+	/// <summary>Splits items[begin, end) at the median along its longest axis until every cluster is small enough
+	/// </summary>
+	void Cluster(std::vector<Item>& items, size_t begin, size_t end, std::vector<std::pair<size_t, size_t> >& clusters) const;
+
+	/// <summary>Writes the instances of items[begin, end) into batch, levels of detail merged by level
+	/// </summary>
+	static void Merge(const std::vector<StaticInstance>& instances, const std::vector<Item>& items, size_t begin, size_t end,
+		StaticBatch& batch);
+
+	/// <summary>Appends the mesh's vertices transformed into world space
+	/// </summary>
+	static void AppendVertices(const MeshData& mesh, const XMFLOAT4X4& transform, std::vector<Vertex>& vertices);
+
+	bool enabled;
+	float clusterSize;
+	UINT clusterVertices;
+	UINT64 budget;
+	StaticBatchStats stats;
+};
+
+#endif
@@ -0,0 +1,342 @@
+//
+// Heightmap terrain around the arena, split into chunks drawn at levels of detail picked by distance
+//
+
+#include "Terrain.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+
+#include "FrameArena.h"
+#include "Game.h"
+#include "Profiler.h"
+#include "TrackedResources.h"
+
+// Heights uploaded per frame, a tile is about 260 KB
+static const UINT64 TileUploadBudget = 1024 * 1024;
+
+// Cells the eye moves before morphing chunks are rewritten, a cell moves the morph a few percent at most
+static const float MorphEyeStep = 1.0f;
+
+Terrain::Terrain() :
+enabled(false),
+size(1024),
+cellSize(1.0f),
+heightScale(40.0f),
+firstRange(64.0f),
+memoryCap(64 * 1024 * 1024),
+directory("Terrain"),
+tileStreamer(this),
+dev(NULL),
+indexBuffer(NULL),
+drawn(NULL),
+drawnCount(0),
+morphEye(0.0f, 0.0f, 0.0f),
+frame(0)
+{
+
+}
+
+Terrain::~Terrain()
+{
+	// The loader thread calls back into this object, it has to stop before anything goes
+	tileStreamer.Stop();
+	for (ChunkBuffer* buffer : liveBuffers)
+		ReleaseMacro(buffer->vertexBuffer);
+	ReleaseMacro(indexBuffer);
+}
+
+void Terrain::ParseCommandLine(const char* cmdLine)
+{
+	if (!cmdLine)
+		return;
+
+	std::istringstream args(cmdLine);
+	std::string arg;
+	while (args >> arg)
+	{
+		size_t split = arg.find('=');
+		if (split == std::string::npos)
+			continue;
+
+		std::string key = arg.substr(0, split);
+		std::string value = arg.substr(split + 1);
+		if (key == "terrain")
+			enabled = value != "0";
+		else if (key == "terrainsize")
+			size = max((UINT)strtoul(value.c_str(), NULL, 10), 1u);
+		else if (key == "terraincell")
+			cellSize = max((float)atof(value.c_str()), 0.01f);
+		else if (key == "terrainheight")
+			heightScale = max((float)atof(value.c_str()), 0.0f);
+		else if (key == "terrainlod")
+			firstRange = max((float)atof(value.c_str()), 1.0f);
+		else if (key == "terraindir")
+			directory = value;
+		else if (key == "terrainmemory")
+			memoryCap = (UINT64)strtoul(value.c_str(), NULL, 10) * 1024 * 1024;
+	}
+}
+
+bool Terrain::IsEnabled() const { return enabled; }
+
+bool Terrain::Initialize(ID3D11Device* _dev)
+{
+	dev = _dev;
+	heightfield.Configure(size, cellSize, heightScale, directory);
+	UINT tilesPerSide = heightfield.GetTilesPerSide();
+	UINT chunksPerSide = tilesPerSide * TerrainTileChunks;
+	selector.Configure(chunksPerSide, chunksPerSide, cellSize, firstRange, heightScale);
+	tiles.resize(tilesPerSide * tilesPerSide);
+	chunkBuffers.assign(chunksPerSide * chunksPerSide, NULL);
+
+	std::vector<UINT> indices;
+	TerrainSelector::BuildIndices(indices, ranges);
+
+	D3D11_BUFFER_DESC ibd = {};
+	ibd.Usage = D3D11_USAGE_IMMUTABLE;
+	ibd.ByteWidth = (UINT)(indices.size() * sizeof(UINT));
+	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	D3D11_SUBRESOURCE_DATA initialData = {};
+	initialData.pSysMem = &indices[0];
+	if (FAILED(TrackedResources::CreateBuffer(dev, &ibd, &initialData, "Terrain", &indexBuffer)))
+		return false;
+
+	tileStreamer.SetMemoryCap(memoryCap);
+	tileStreamer.Start(1);
+	return true;
+}
+
+void Terrain::Update(ID3D11DeviceContext* devCon, const XMFLOAT3& eye, float radius, const XMMATRIX& cameraViewProjection,
+	const XMMATRIX& shadowViewProjection)
+{
+	PROFILE_ZONE("Terrain");
+	frame++;
+	stats = TerrainStats();
+
+	// Tiles under the circle around the eye stream in nearest first, the rest become the first to go
+	UINT tilesPerSide = heightfield.GetTilesPerSide();
+	float tileSize = TerrainTileCells * cellSize;
+	float corner = -0.5f * tilesPerSide * tileSize;
+	int firstX = max((int)floorf((eye.x - radius - corner) / tileSize), 0);
+	int firstZ = max((int)floorf((eye.z - radius - corner) / tileSize), 0);
+	int lastX = min((int)floorf((eye.x + radius - corner) / tileSize), (int)tilesPerSide - 1);
+	int lastZ = min((int)floorf((eye.z + radius - corner) / tileSize), (int)tilesPerSide - 1);
+
+	tileStreamer.ResetPriorities();
+	for (int z = firstZ; z <= lastZ; z++)
+	{
+		for (int x = firstX; x <= lastX; x++)
+		{
+			float minX = corner + x * tileSize, minZ = corner + z * tileSize;
+			float dx = max(max(minX - eye.x, eye.x - (minX + tileSize)), 0.0f);
+			float dz = max(max(minZ - eye.z, eye.z - (minZ + tileSize)), 0.0f);
+			float distance = sqrtf(dx * dx + dz * dz);
+			if (distance > radius)
+				continue;
+
+			Tile& tile = tiles[z * tilesPerSide + x];
+			float priority = 1.0f / (1.0f + distance);
+			if (tile.asset >= 0)
+			{
+				tileStreamer.SetPriority(tile.asset, priority);
+				continue;
+			}
+
+			// The loader thread may be reading assetTiles, so the new tile is listed before the streamer can hand it out
+			std::lock_guard<std::mutex> lock(assetMutex);
+			assetTiles.push_back(z * tilesPerSide + x);
+			tile.asset = (int)tileStreamer.Add(priority);
+		}
+	}
+	tileStreamer.Update(TileUploadBudget);
+
+	XMFLOAT4X4 cameraMatrix, shadowMatrix;
+	XMStoreFloat4x4(&cameraMatrix, cameraViewProjection);
+	XMStoreFloat4x4(&shadowMatrix, shadowViewProjection);
+	XMFLOAT4 cameraPlanes[6], shadowPlanes[6];
+	TerrainSelector::ExtractFrustum(cameraMatrix, cameraPlanes);
+	TerrainSelector::ExtractFrustum(shadowMatrix, shadowPlanes);
+
+	// Every chunk morphs from the same eye so shared edges agree, it only moves once the change is worth rewriting for
+	float dx = eye.x - morphEye.x, dy = eye.y - morphEye.y, dz = eye.z - morphEye.z;
+	float step = MorphEyeStep * cellSize;
+	if (frame == 1 || dx * dx + dy * dy + dz * dz > step * step)
+		morphEye = eye;
+	selector.Select(morphEye, radius, cameraPlanes, shadowPlanes, selected);
+
+	// Chunks keep their vertices until their level changes, morphing ones follow the morph eye
+	drawn = FrameArena::Get().AllocateArray<DrawnChunk>(selected.size());
+	drawnCount = 0;
+	UINT chunksPerSide = tilesPerSide * TerrainTileChunks;
+	for (const TerrainChunk& chunk : selected)
+	{
+		const Tile& tile = tiles[(chunk.z / TerrainTileChunks) * tilesPerSide + chunk.x / TerrainTileChunks];
+		if (tile.heights.empty())
+			continue;
+
+		UINT key = chunk.z * chunksPerSide + chunk.x;
+		ChunkBuffer* buffer = chunkBuffers[key];
+		if (!buffer)
+		{
+			D3D11_BUFFER_DESC vbd = {};
+			vbd.Usage = D3D11_USAGE_DYNAMIC;
+			vbd.ByteWidth = TerrainChunkVertices * TerrainChunkVertices * sizeof(Vertex);
+			vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+			vbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+			ID3D11Buffer* vertexBuffer;
+			if (FAILED(TrackedResources::CreateBuffer(dev, &vbd, NULL, "Terrain", &vertexBuffer)))
+				continue;
+
+			ChunkBuffer created = {};
+			created.chunk = key;
+			created.vertexBuffer = vertexBuffer;
+			buffer = chunkPool.Create(created);
+			chunkBuffers[key] = buffer;
+			liveBuffers.push_back(buffer);
+		}
+
+		bool moved = memcmp(&buffer->eye, &morphEye, sizeof(morphEye)) != 0;
+		bool rebuild = buffer->frame == 0 || buffer->level != chunk.level || ((chunk.morphing || buffer->morphing) && moved);
+		D3D11_MAPPED_SUBRESOURCE mapped;
+		if (rebuild && SUCCEEDED(devCon->Map(buffer->vertexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		{
+			selector.WriteVertices(&tile.heights[0], chunk.x % TerrainTileChunks, chunk.z % TerrainTileChunks,
+				selector.GetChunkOrigin(chunk.x, chunk.z), chunk.level, morphEye, (Vertex*)mapped.pData);
+			devCon->Unmap(buffer->vertexBuffer, 0);
+			buffer->level = chunk.level;
+			buffer->morphing = chunk.morphing;
+			buffer->eye = morphEye;
+			stats.rebuilt++;
+		}
+		buffer->frame = frame;
+
+		DrawnChunk& entry = drawn[drawnCount++];
+		entry.chunk = chunk;
+		entry.vertexBuffer = buffer->vertexBuffer;
+	}
+	ReleaseChunks(-1);
+
+	stats.selected = drawnCount;
+	for (const Tile& tile : tiles)
+	{
+		if (!tile.heights.empty())
+			stats.residentTiles++;
+	}
+}
+
+UINT Terrain::Draw(ID3D11DeviceContext* devCon, Material* mat, bool shadowPass, TextureBindings* bindings, UINT& draws, UINT& triangles)
+{
+	draws = 0;
+	triangles = 0;
+	if (drawnCount == 0)
+		return 0;
+
+	mat->SetShader(devCon);
+	if (shadowPass)
+		devCon->PSSetShader(0, 0, 0);
+	mat->SetSampler(devCon);
+	UINT binds = mat->SetResources(devCon, bindings);
+	devCon->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+
+	UINT stride = sizeof(Vertex);
+	UINT offset = 0;
+	for (UINT i = 0; i < drawnCount; i++)
+	{
+		const DrawnChunk& entry = drawn[i];
+		if (shadowPass ? !entry.chunk.shadowVisible : !entry.chunk.cameraVisible)
+			continue;
+		const MeshLOD& range = ranges[entry.chunk.level * TerrainSideCount + entry.chunk.stitch];
+		devCon->IASetVertexBuffers(0, 1, &entry.vertexBuffer, &stride, &offset);
+		devCon->DrawIndexed(range.indexCount, range.indexStart, 0);
+		draws++;
+		triangles += range.indexCount / 3;
+	}
+	return binds;
+}
+
+const TerrainStats& Terrain::GetStats() const { return stats; }
+bool Terrain::IsStreamingIdle() const { return tileStreamer.IsIdle(); }
+
+bool Terrain::Load(AssetId id, std::vector<BYTE>& payload)
+{
+	UINT tile;
+	{
+		std::lock_guard<std::mutex> lock(assetMutex);
+		tile = assetTiles[id];
+	}
+
+	PROFILE_ZONE("Stream::LoadTerrainTile");
+	UINT tilesPerSide = heightfield.GetTilesPerSide();
+	std::vector<float> heights;
+	heightfield.LoadTile(tile % tilesPerSide, tile / tilesPerSide, heights);
+	payload.resize(heights.size() * sizeof(float));
+	memcpy(&payload[0], &heights[0], payload.size());
+	return true;
+}
+
+UINT64 Terrain::Upload(AssetId id, const std::vector<BYTE>& payload)
+{
+	UINT index = assetTiles[id];
+	Tile& tile = tiles[index];
+	const float* heights = (const float*)&payload[0];
+	tile.heights.assign(heights, heights + payload.size() / sizeof(float));
+
+	// Chunk bounds tighten from the whole height range to what the chunk holds, including its shared edges
+	UINT tilesPerSide = heightfield.GetTilesPerSide();
+	UINT firstChunkX = (index % tilesPerSide) * TerrainTileChunks;
+	UINT firstChunkZ = (index / tilesPerSide) * TerrainTileChunks;
+	for (UINT cz = 0; cz < TerrainTileChunks; cz++)
+	{
+		for (UINT cx = 0; cx < TerrainTileChunks; cx++)
+		{
+			float lowest = FLT_MAX, highest = -FLT_MAX;
+			for (UINT z = 0; z < TerrainChunkVertices; z++)
+			{
+				const float* row = heights + (cz * TerrainChunkCells + z + 1) * TerrainTileSamples + cx * TerrainChunkCells + 1;
+				for (UINT x = 0; x < TerrainChunkVertices; x++)
+				{
+					lowest = min(lowest, row[x]);
+					highest = max(highest, row[x]);
+				}
+			}
+			selector.SetChunkHeights(firstChunkX + cx, firstChunkZ + cz, lowest, highest);
+		}
+	}
+	return payload.size();
+}
+
+void Terrain::Evict(AssetId id)
+{
+	int index = (int)assetTiles[id];
+	std::vector<float>().swap(tiles[index].heights);
+	ReleaseChunks(index);
+}
+
+void Terrain::ReleaseChunks(int tile)
+{
+	UINT tilesPerSide = heightfield.GetTilesPerSide();
+	UINT chunksPerSide = tilesPerSide * TerrainTileChunks;
+	for (size_t i = 0; i < liveBuffers.size();)
+	{
+		ChunkBuffer* buffer = liveBuffers[i];
+		UINT x = buffer->chunk % chunksPerSide, z = buffer->chunk / chunksPerSide;
+		bool release = tile < 0 ? buffer->frame != frame :
+			(int)((z / TerrainTileChunks) * tilesPerSide + x / TerrainTileChunks) == tile;
+		if (!release)
+		{
+			i++;
+			continue;
+		}
+
+		ReleaseMacro(buffer->vertexBuffer);
+		chunkBuffers[buffer->chunk] = NULL;
+		chunkPool.Destroy(buffer);
+		liveBuffers[i] = liveBuffers.back();
+		liveBuffers.pop_back();
+	}
+}
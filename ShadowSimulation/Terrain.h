@@ -0,0 +1,131 @@
+//
+// Heightmap terrain around the arena, split into chunks drawn at levels of detail picked by distance
+// Heights stream in a tile at a time, closest first, and stay in memory while their tile is near. A chunk's vertices are
+// rebuilt on the CPU when its level changes or while it is morphing, every chunk draws from one shared index buffer
+// Turned on from the command line with terrain=1
+//
+
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+#include <mutex>
+#include <vector>
+#include <d3d11.h>
+#include <DirectXMath.h>
+
+#include "AssetStreamer.h"
+#include "Heightfield.h"
+#include "Material.h"
+#include "ObjectPool.h"
+#include "TerrainLOD.h"
+
+using namespace DirectX;
+
+struct TerrainStats
+{
+	TerrainStats() : selected(0), rebuilt(0), residentTiles(0) {}
+
+	UINT selected;			// Chunks either view sees with their heights resident
+	UINT rebuilt;			// Chunks whose vertices were written this frame
+	UINT residentTiles;
+};
+
+class Terrain : public StreamBackend
+{
+public:
+	Terrain();
+	~Terrain();
+
+	/// <summary>Reads terrain=1 to turn it on, terrainsize=1024 for the samples along each side, terraincell=1 for the
+	/// distance between them, terrainheight=40, terrainlod=64 for the distance the finest level reaches,
+	/// terraindir=Terrain for the tile files and terrainmemory=64 for the MB of heights kept resident
+	/// </summary>
+	void ParseCommandLine(const char* cmdLine);
+
+	bool IsEnabled() const;
+
+	/// <summary>Creates the shared index buffer and starts loading tiles
+	/// </summary>
+	bool Initialize(ID3D11Device* dev);
+
+	/// <summary>Streams tiles in by distance, picks the chunks within radius that either view sees and updates their
+	/// vertices. The matrices are untransposed
+	/// </summary>
+	void Update(ID3D11DeviceContext* devCon, const XMFLOAT3& eye, float radius, const XMMATRIX& cameraViewProjection,
+		const XMMATRIX& shadowViewProjection);
+
+	/// <summary>Draws the chunks a pass sees with the material. Returns the texture slots it had to bind
+	/// </summary>
+	UINT Draw(ID3D11DeviceContext* devCon, Material* mat, bool shadowPass, TextureBindings* bindings, UINT& draws, UINT& triangles);
+
+	const TerrainStats& GetStats() const;
+
+	/// <summary>Returns true when no tile near the camera is still on its way in
+	/// </summary>
+	bool IsStreamingIdle() const;
+
+	// StreamBackend, the payload of a tile is its heights as floats
+	virtual bool Load(AssetId id, std::vector<BYTE>& payload);
+	virtual UINT64 Upload(AssetId id, const std::vector<BYTE>& payload);
+	virtual void Evict(AssetId id);
+private:
+	struct Tile
+	{
+		Tile() : asset(-1) {}
+
+		int asset;					// -1 until the tile first comes near
+		std::vector<float> heights;	// Empty unless resident
+	};
+
+	struct ChunkBuffer
+	{
+		UINT chunk;					// z * chunks per side + x
+		ID3D11Buffer* vertexBuffer;
+		UINT level;
+		bool morphing;
+		XMFLOAT3 eye;				// The morph eye the vertices were written for
+		UINT frame;					// Last frame the chunk was selected, unused buffers are released
+	};
+
+	struct DrawnChunk
+	{
+		TerrainChunk chunk;
+		ID3D11Buffer* vertexBuffer;
+	};
+
+	/// <summary>Releases the vertex buffers of chunks a tile covers, or of every chunk not selected this frame
+	/// </summary>
+	void ReleaseChunks(int tile);
+
+	bool enabled;
+	UINT size;
+	float cellSize;
+	float heightScale;
+	float firstRange;
+	UINT64 memoryCap;
+	std::string directory;
+
+	Heightfield heightfield;
+	TerrainSelector selector;
+	AssetStreamer tileStreamer;
+
+	ID3D11Device* dev;
+	ID3D11Buffer* indexBuffer;
+	std::vector<MeshLOD> ranges;
+
+	std::vector<Tile> tiles;
+	std::vector<UINT> assetTiles;	// Tile of each streamed asset, read by the loader thread
+	std::mutex assetMutex;
+
+	ObjectPool<ChunkBuffer> chunkPool;
+	std::vector<ChunkBuffer*> chunkBuffers;		// Per chunk, NULL unless it has a vertex buffer
+	std::vector<ChunkBuffer*> liveBuffers;		// The ones that aren't NULL, in no order
+	std::vector<TerrainChunk> selected;
+	DrawnChunk* drawn;							// In the frame arena, Draw has to run in the same frame as Update
+	UINT drawnCount;
+	XMFLOAT3 morphEye;				// Follows the eye a step at a time, every chunk picks its level and morphs from it
+	UINT frame;
+	TerrainStats stats;
+};
+
+#endif
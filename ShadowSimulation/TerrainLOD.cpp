@@ -0,0 +1,328 @@
+//
+// Level of detail for the terrain's chunks, kept free of D3D
+//
+
+#include "TerrainLOD.h"
+
+#include <cmath>
+
+// Part of each level's range, at its far end, over which vertices morph to the next level
+static const float MorphFraction = 0.3f;
+
+// Texture coordinates per world unit, the arena floor's texture density
+static const float TerrainUVScale = 1.0f / 25.0f;
+
+TerrainSelector::TerrainSelector() :
+chunksX(0),
+chunksZ(0),
+cellSize(1.0f),
+firstRange(1.0f)
+{
+
+}
+
+void TerrainSelector::Configure(UINT _chunksX, UINT _chunksZ, float _cellSize, float _firstRange, float heightRange)
+{
+	chunksX = _chunksX;
+	chunksZ = _chunksZ;
+	cellSize = _cellSize;
+
+	// A chunk's far edge has to come before the next coarser level starts morphing, which keeps neighbors within a
+	// level of each other and every stitched edge fully morphed. That is a chunk's diagonal inside each band's gap
+	float chunkSize = TerrainChunkCells * cellSize;
+	float diagonal = sqrtf(2.0f * chunkSize * chunkSize + heightRange * heightRange);
+	firstRange = max(_firstRange, diagonal / (1.0f - MorphFraction) * 1.01f);
+
+	chunkHeights.assign(chunksX * chunksZ, XMFLOAT2(0.0f, heightRange));
+}
+
+void TerrainSelector::SetChunkHeights(UINT x, UINT z, float minHeight, float maxHeight)
+{
+	chunkHeights[z * chunksX + x] = XMFLOAT2(minHeight, maxHeight);
+}
+
+float TerrainSelector::GetRange(UINT level) const { return firstRange * (float)(1u << level); }
+
+UINT TerrainSelector::GetLevel(float distance) const
+{
+	UINT level = 0;
+	while (level + 1 < TerrainLevels && distance >= GetRange(level))
+		level++;
+	return level;
+}
+
+float TerrainSelector::GetMorph(UINT level, float distance) const
+{
+	if (level + 1 >= TerrainLevels)
+		return 0.0f;
+	float range = GetRange(level);
+	float band = MorphFraction * (level == 0 ? range : range * 0.5f);
+	return min(max((distance - (range - band)) / band, 0.0f), 1.0f);
+}
+
+XMFLOAT2 TerrainSelector::GetChunkOrigin(UINT x, UINT z) const
+{
+	float chunkSize = TerrainChunkCells * cellSize;
+	return XMFLOAT2((x - chunksX * 0.5f) * chunkSize, (z - chunksZ * 0.5f) * chunkSize);
+}
+
+float TerrainSelector::GetCellSize() const { return cellSize; }
+
+void TerrainSelector::GetChunkBox(UINT x, UINT z, XMFLOAT3& boxMin, XMFLOAT3& boxMax) const
+{
+	float chunkSize = TerrainChunkCells * cellSize;
+	XMFLOAT2 origin = GetChunkOrigin(x, z);
+	const XMFLOAT2& heights = chunkHeights[z * chunksX + x];
+	boxMin = XMFLOAT3(origin.x, heights.x, origin.y);
+	boxMax = XMFLOAT3(origin.x + chunkSize, heights.y, origin.y + chunkSize);
+}
+
+static float DistanceToBox(const XMFLOAT3& p, const XMFLOAT3& boxMin, const XMFLOAT3& boxMax)
+{
+	float dx = max(max(boxMin.x - p.x, p.x - boxMax.x), 0.0f);
+	float dy = max(max(boxMin.y - p.y, p.y - boxMax.y), 0.0f);
+	float dz = max(max(boxMin.z - p.z, p.z - boxMax.z), 0.0f);
+	return sqrtf(dx * dx + dy * dy + dz * dz);
+}
+
+UINT TerrainSelector::GetChunkLevel(UINT x, UINT z, const XMFLOAT3& eye) const
+{
+	XMFLOAT3 boxMin, boxMax;
+	GetChunkBox(x, z, boxMin, boxMax);
+	return GetLevel(DistanceToBox(eye, boxMin, boxMax));
+}
+
+void TerrainSelector::Select(const XMFLOAT3& eye, float radius, const XMFLOAT4* cameraPlanes, const XMFLOAT4* shadowPlanes,
+	std::vector<TerrainChunk>& chunks) const
+{
+	chunks.clear();
+	if (chunksX == 0 || chunksZ == 0)
+		return;
+
+	// Only the chunks under the circle around the eye are looked at, however large the terrain is
+	float chunkSize = TerrainChunkCells * cellSize;
+	XMFLOAT2 corner = GetChunkOrigin(0, 0);
+	int firstX = max((int)floorf((eye.x - radius - corner.x) / chunkSize), 0);
+	int firstZ = max((int)floorf((eye.z - radius - corner.y) / chunkSize), 0);
+	int lastX = min((int)floorf((eye.x + radius - corner.x) / chunkSize), (int)chunksX - 1);
+	int lastZ = min((int)floorf((eye.z + radius - corner.y) / chunkSize), (int)chunksZ - 1);
+
+	for (int z = firstZ; z <= lastZ; z++)
+	{
+		for (int x = firstX; x <= lastX; x++)
+		{
+			XMFLOAT3 boxMin, boxMax;
+			GetChunkBox(x, z, boxMin, boxMax);
+			float distance = DistanceToBox(eye, boxMin, boxMax);
+			if (distance > radius)
+				continue;
+
+			TerrainChunk chunk;
+			chunk.cameraVisible = IsBoxVisible(cameraPlanes, boxMin, boxMax);
+			chunk.shadowVisible = IsBoxVisible(shadowPlanes, boxMin, boxMax);
+			if (!chunk.cameraVisible && !chunk.shadowVisible)
+				continue;
+
+			chunk.x = x;
+			chunk.z = z;
+			chunk.level = GetLevel(distance);
+
+			// The farthest corner decides whether any vertex has reached the morph band
+			float farX = max(fabsf(boxMin.x - eye.x), fabsf(boxMax.x - eye.x));
+			float farY = max(fabsf(boxMin.y - eye.y), fabsf(boxMax.y - eye.y));
+			float farZ = max(fabsf(boxMin.z - eye.z), fabsf(boxMax.z - eye.z));
+			chunk.morphing = GetMorph(chunk.level, sqrtf(farX * farX + farY * farY + farZ * farZ)) > 0.0f;
+
+			chunk.stitch = 0;
+			if (x > 0 && GetChunkLevel(x - 1, z, eye) > chunk.level)
+				chunk.stitch |= TerrainSideLeft;
+			if (x + 1 < (int)chunksX && GetChunkLevel(x + 1, z, eye) > chunk.level)
+				chunk.stitch |= TerrainSideRight;
+			if (z > 0 && GetChunkLevel(x, z - 1, eye) > chunk.level)
+				chunk.stitch |= TerrainSideNear;
+			if (z + 1 < (int)chunksZ && GetChunkLevel(x, z + 1, eye) > chunk.level)
+				chunk.stitch |= TerrainSideFar;
+			chunks.push_back(chunk);
+		}
+	}
+}
+
+// Twice the signed area of a triangle of grid vertices seen from above, positive for the clockwise front faces
+static int Orientation(UINT a, UINT b, UINT c)
+{
+	int ax = a % TerrainChunkVertices, az = a / TerrainChunkVertices;
+	int bx = b % TerrainChunkVertices, bz = b / TerrainChunkVertices;
+	int cx = c % TerrainChunkVertices, cz = c / TerrainChunkVertices;
+	return (bz - az) * (cx - ax) - (bx - ax) * (cz - az);
+}
+
+// Returns true if moving vertex onto target would turn any triangle over
+static bool CollapseFlips(const std::vector<UINT>& triangles, UINT vertex, UINT target)
+{
+	for (size_t i = 0; i < triangles.size(); i += 3)
+	{
+		UINT t[3] = { triangles[i], triangles[i + 1], triangles[i + 2] };
+		if (t[0] != vertex && t[1] != vertex && t[2] != vertex)
+			continue;
+		for (UINT k = 0; k < 3; k++)
+		{
+			if (t[k] == vertex)
+				t[k] = target;
+		}
+		if (Orientation(t[0], t[1], t[2]) < 0)
+			return true;
+	}
+	return false;
+}
+
+void TerrainSelector::BuildIndices(std::vector<UINT>& indices, std::vector<MeshLOD>& ranges)
+{
+	indices.clear();
+	ranges.resize(TerrainLevels * TerrainSideCount);
+
+	for (UINT level = 0; level < TerrainLevels; level++)
+	{
+		UINT step = 1u << level;
+		UINT quads = TerrainChunkCells / step;
+
+		// Every quad is split along the diagonal from its +x corner to its +z corner, the diagonal the morph targets follow
+		std::vector<UINT> full;
+		full.reserve(quads * quads * 6);
+		for (UINT qz = 0; qz < quads; qz++)
+		{
+			for (UINT qx = 0; qx < quads; qx++)
+			{
+				UINT a = qz * step * TerrainChunkVertices + qx * step;
+				UINT b = a + step;
+				UINT c = a + step * TerrainChunkVertices;
+				UINT d = c + step;
+				UINT quad[6] = { a, c, b, b, c, d };
+				full.insert(full.end(), quad, quad + 6);
+			}
+		}
+
+		for (UINT stitch = 0; stitch < TerrainSideCount; stitch++)
+		{
+			// Each odd vertex on a stitched side collapses onto an even neighbor along the side, whichever keeps
+			// the triangles around it facing up. The even vertices are exactly the coarser neighbor's edge
+			std::vector<UINT> triangles = full;
+			for (UINT side = 0; side < 4; side++)
+			{
+				if (!(stitch & (1u << side)))
+					continue;
+				for (UINT k = 1; k < quads; k += 2)
+				{
+					UINT along = k * step;
+					UINT first = 0, stride = 1;
+					if (side == 0 || side == 1)
+					{
+						first = side == 0 ? 0 : TerrainChunkCells;
+						stride = TerrainChunkVertices;
+					}
+					else
+					{
+						first = side == 2 ? 0 : TerrainChunkCells * TerrainChunkVertices;
+					}
+					UINT vertex = first + along * stride;
+					UINT target = vertex - step * stride;
+					if (CollapseFlips(triangles, vertex, target))
+						target = vertex + step * stride;
+					for (UINT& index : triangles)
+					{
+						if (index == vertex)
+							index = target;
+					}
+				}
+			}
+
+			MeshLOD& range = ranges[level * TerrainSideCount + stitch];
+			range.indexStart = (UINT)indices.size();
+			range.error = 0.0f;
+			for (size_t i = 0; i < triangles.size(); i += 3)
+			{
+				if (Orientation(triangles[i], triangles[i + 1], triangles[i + 2]) > 0)
+					indices.insert(indices.end(), triangles.begin() + i, triangles.begin() + i + 3);
+			}
+			range.indexCount = (UINT)indices.size() - range.indexStart;
+		}
+	}
+}
+
+void TerrainSelector::WriteVertices(const float* heights, UINT localX, UINT localZ, const XMFLOAT2& origin, UINT level,
+	const XMFLOAT3& eye, Vertex* vertices) const
+{
+	// Samples around the chunk, i and j count cells from its corner and may step one past it
+	const float* base = heights + (localZ * TerrainChunkCells + 1) * TerrainTileSamples + localX * TerrainChunkCells + 1;
+	auto height = [&](int i, int j) { return base[j * (int)TerrainTileSamples + i]; };
+
+	int step = 1 << level;
+	bool canMorph = level + 1 < TerrainLevels;
+	float inverseCell = 0.5f / cellSize;
+	for (int j = 0; j < (int)TerrainChunkVertices; j++)
+	{
+		for (int i = 0; i < (int)TerrainChunkVertices; i++)
+		{
+			Vertex& vertex = vertices[j * TerrainChunkVertices + i];
+			float x = origin.x + i * cellSize;
+			float z = origin.y + j * cellSize;
+			float y = height(i, j);
+
+			// Vertices the next level drops slide onto the line between the two it keeps on either side
+			bool oddX = ((i / step) & 1) != 0;
+			bool oddZ = ((j / step) & 1) != 0;
+			if (canMorph && i % step == 0 && j % step == 0 && (oddX || oddZ))
+			{
+				float coarse;
+				if (oddX && oddZ)
+					coarse = 0.5f * (height(i + step, j - step) + height(i - step, j + step));
+				else if (oddX)
+					coarse = 0.5f * (height(i - step, j) + height(i + step, j));
+				else
+					coarse = 0.5f * (height(i, j - step) + height(i, j + step));
+
+				float dx = x - eye.x, dy = y - eye.y, dz = z - eye.z;
+				y += (coarse - y) * GetMorph(level, sqrtf(dx * dx + dy * dy + dz * dz));
+			}
+
+			// Lighting keeps the full resolution surface's slopes at every level
+			float slopeX = (height(i + 1, j) - height(i - 1, j)) * inverseCell;
+			float slopeZ = (height(i, j + 1) - height(i, j - 1)) * inverseCell;
+			XMVECTOR normal = XMVector3Normalize(XMVectorSet(-slopeX, 1.0f, -slopeZ, 0.0f));
+			XMVECTOR tangent = XMVector3Normalize(XMVectorSet(1.0f, slopeX, 0.0f, 0.0f));
+
+			vertex.Position = XMFLOAT3(x, y, z);
+			vertex.Color = XMFLOAT4(0.7f, 0.7f, 0.7f, 1.0f);
+			vertex.UV = XMFLOAT2(x * TerrainUVScale, z * TerrainUVScale);
+			XMStoreFloat3(&vertex.Normal, normal);
+			XMStoreFloat3(&vertex.Tangent, tangent);
+		}
+	}
+}
+
+void TerrainSelector::ExtractFrustum(const XMFLOAT4X4& m, XMFLOAT4* planes)
+{
+	// Clip space is x and y in [-w, w] and z in [0, w], each plane is the w column plus or minus another column
+	for (UINT i = 0; i < 3; i++)
+	{
+		planes[i * 2] = XMFLOAT4(m._14 + m.m[0][i], m._24 + m.m[1][i], m._34 + m.m[2][i], m._44 + m.m[3][i]);
+		planes[i * 2 + 1] = XMFLOAT4(m._14 - m.m[0][i], m._24 - m.m[1][i], m._34 - m.m[2][i], m._44 - m.m[3][i]);
+	}
+
+	// The near plane is z >= 0 on its own
+	planes[4] = XMFLOAT4(m._13, m._23, m._33, m._43);
+}
+
+bool TerrainSelector::IsBoxVisible(const XMFLOAT4* planes, const XMFLOAT3& boxMin, const XMFLOAT3& boxMax)
+{
+	for (UINT i = 0; i < 6; i++)
+	{
+		// The corner furthest along the plane's normal
+		const XMFLOAT4& p = planes[i];
+		float x = p.x > 0.0f ? boxMax.x : boxMin.x;
+		float y = p.y > 0.0f ? boxMax.y : boxMin.y;
+		float z = p.z > 0.0f ? boxMax.z : boxMin.z;
+		if (p.x * x + p.y * y + p.z * z + p.w < 0.0f)
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,119 @@
+//
+// Level of detail for the terrain's chunks, kept free of D3D
+// Chunks are fixed size grids drawn with every 2^level'th vertex, farther chunks at coarser levels. Vertices near the end of
+// a level's range morph their heights onto the next coarser level, so a chunk looks the same just before and after it switches.
+// Chunks next to a coarser one drop their odd edge vertices (stitching) so the shared edge has no T-junctions
+//
+
+#ifndef TERRAINLOD_H
+#define TERRAINLOD_H
+
+#include <vector>
+#include <Windows.h>
+#include <DirectXMath.h>
+
+#include "Vertex.h"
+
+using namespace DirectX;
+
+static const UINT TerrainChunkCells = 32;							// Quads along a chunk's side at level 0
+static const UINT TerrainChunkVertices = TerrainChunkCells + 1;
+static const UINT TerrainLevels = 6;								// Level 5 draws a chunk as one quad
+static const UINT TerrainTileChunks = 8;							// Chunks along a streamed tile's side
+static const UINT TerrainTileCells = TerrainChunkCells * TerrainTileChunks;
+static const UINT TerrainTileSamples = TerrainTileCells + 3;		// One sample past each edge for normals
+
+// Sides of a chunk, set in TerrainChunk::stitch when the neighbor there is one level coarser
+enum TerrainSide
+{
+	TerrainSideLeft = 1,	// -x
+	TerrainSideRight = 2,	// +x
+	TerrainSideNear = 4,	// -z
+	TerrainSideFar = 8,		// +z
+	TerrainSideCount = 16	// Stitch combinations
+};
+
+struct TerrainChunk
+{
+	UINT x;
+	UINT z;
+	UINT level;
+	UINT stitch;			// TerrainSide bits
+	bool morphing;			// Part of the chunk lies in its level's morph band, so its heights follow the eye
+	bool cameraVisible;
+	bool shadowVisible;
+};
+
+class TerrainSelector
+{
+public:
+	TerrainSelector();
+
+	/// <summary>Sets the grid's size in chunks and cells, the world is centered on the origin. firstRange is the distance
+	/// level 0 is used to, each level after covers twice the distance. It is raised if it is too short for the chunks to
+	/// stay crack free, at most one level apart. heightRange is the tallest a chunk can be
+	/// </summary>
+	void Configure(UINT chunksX, UINT chunksZ, float cellSize, float firstRange, float heightRange);
+
+	/// <summary>Sets the lowest and highest height in a chunk, chunks start out spanning the whole heightRange
+	/// </summary>
+	void SetChunkHeights(UINT x, UINT z, float minHeight, float maxHeight);
+
+	/// <summary>Distance at which a level gives way to the next
+	/// </summary>
+	float GetRange(UINT level) const;
+
+	/// <summary>Returns the level used at a distance
+	/// </summary>
+	UINT GetLevel(float distance) const;
+
+	/// <summary>Returns how far a vertex at distance has morphed from its level towards the next, 0 to 1
+	/// </summary>
+	float GetMorph(UINT level, float distance) const;
+
+	/// <summary>Picks the level and stitching of every chunk within radius of eye that either view can see
+	/// The planes are from ExtractFrustum
+	/// </summary>
+	void Select(const XMFLOAT3& eye, float radius, const XMFLOAT4* cameraPlanes, const XMFLOAT4* shadowPlanes,
+		std::vector<TerrainChunk>& chunks) const;
+
+	/// <summary>Returns the world space corner of a chunk with the lowest x and z
+	/// </summary>
+	XMFLOAT2 GetChunkOrigin(UINT x, UINT z) const;
+
+	float GetCellSize() const;
+
+	/// <summary>Builds the index sets every chunk draws from, ranges[level * TerrainSideCount + stitch] indexes a
+	/// TerrainChunkVertices square grid, row by row along +x
+	/// </summary>
+	static void BuildIndices(std::vector<UINT>& indices, std::vector<MeshLOD>& ranges);
+
+	/// <summary>Fills a chunk's TerrainChunkVertices^2 vertices. heights holds its tile's TerrainTileSamples^2 samples,
+	/// localX and localZ are the chunk's place in the tile. Heights of vertices in the morph band are blended towards the
+	/// next coarser level by each vertex's own distance from the eye, so neighbors always agree on shared edges
+	/// </summary>
+	void WriteVertices(const float* heights, UINT localX, UINT localZ, const XMFLOAT2& origin, UINT level, const XMFLOAT3& eye,
+		Vertex* vertices) const;
+
+	/// <summary>Extracts the six planes of an untransposed view projection matrix, pointing inwards
+	/// </summary>
+	static void ExtractFrustum(const XMFLOAT4X4& viewProjection, XMFLOAT4* planes);
+
+	/// <summary>Returns false if the box is entirely outside one of the planes
+	/// </summary>
+	static bool IsBoxVisible(const XMFLOAT4* planes, const XMFLOAT3& boxMin, const XMFLOAT3& boxMax);
+private:
+	/// <summary>Level of the chunk at x, z from its nearest distance to the eye
+	/// </summary>
+	UINT GetChunkLevel(UINT x, UINT z, const XMFLOAT3& eye) const;
+
+	void GetChunkBox(UINT x, UINT z, XMFLOAT3& boxMin, XMFLOAT3& boxMax) const;
+
+	UINT chunksX;
+	UINT chunksZ;
+	float cellSize;
+	float firstRange;
+	std::vector<XMFLOAT2> chunkHeights;		// Lowest and highest height
+};
+
+#endif
@@ -0,0 +1,302 @@
+//
+// Packs material textures into the slices of one Texture2DArray so materials stop rebinding textures
+// Textures as large as a slice get one to themselves, smaller ones share slices through a skyline packer
+// with wrapped gutters, and materials sample them by slice and UV rectangle
+// Turned on from the command line: -atlas slice=1024 gutter=8
+//
+
+#include "TextureAtlas.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "Game.h"
+#include "Profiler.h"
+#include "TrackedResources.h"
+
+static bool ReadImageFile(const std::wstring& path, std::vector<BYTE>& data)
+{
+	std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+	if (!file)
+		return false;
+
+	std::streamsize size = file.tellg();
+	if (size <= 0)
+		return false;
+
+	data.resize((size_t)size);
+	file.seekg(0, std::ios::beg);
+	return !!file.read((char*)&data[0], size);
+}
+
+TextureAtlas::TextureAtlas() :
+enabled(false),
+maxSliceSize(1024),
+gutter(8),
+sliceSize(0),
+mipCount(0),
+occupancy(0.0f),
+view(NULL)
+{
+
+}
+
+TextureAtlas::~TextureAtlas()
+{
+	ReleaseMacro(view);
+}
+
+bool TextureAtlas::ParseCommandLine(const char* cmdLine)
+{
+	if (!cmdLine)
+		return false;
+
+	std::istringstream args(cmdLine);
+	std::string arg;
+	while (args >> arg)
+	{
+		if (arg == "-atlas")
+		{
+			enabled = true;
+			continue;
+		}
+
+		size_t split = arg.find('=');
+		if (split == std::string::npos)
+			continue;
+
+		std::string key = arg.substr(0, split);
+		std::string value = arg.substr(split + 1);
+		if (key == "slice")
+			maxSliceSize = max((UINT)strtoul(value.c_str(), NULL, 10), 1u);
+		else if (key == "gutter")
+			gutter = (UINT)strtoul(value.c_str(), NULL, 10);
+	}
+	return enabled;
+}
+
+bool TextureAtlas::IsEnabled() const { return enabled; }
+
+void TextureAtlas::Add(const std::wstring& path)
+{
+	std::wstring key = TextureCache::Canonicalize(path);
+	for (const Placement& placement : placements)
+	{
+		if (placement.path == key)
+			return;
+	}
+
+	Placement placement;
+	placement.path = key;
+	placement.slice = 0;
+	placement.gutterX = 0;
+	placement.gutterY = 0;
+	placements.push_back(placement);
+}
+
+bool TextureAtlas::Decode()
+{
+	PROFILE_ZONE("TextureAtlas::Decode");
+	if (placements.empty())
+		return true;
+
+	// Slices are a power of two no bigger than slice=, and just big enough for the largest texture with its gutter
+	UINT sliceLimit = 1;
+	while (sliceLimit * 2 <= maxSliceSize)
+		sliceLimit *= 2;
+
+	// Bigger textures drop their top mips to fit a slice
+	TextureLoadOptions options;
+	options.maxSize = sliceLimit;
+	UINT largest = 1;
+	for (Placement& placement : placements)
+	{
+		std::vector<BYTE> data;
+		if (!ReadImageFile(placement.path, data) || !FileTextureSource::DecodeImage(placement.path, &data[0], data.size(), options, placement.texture))
+			return false;
+		largest = max(largest, max(placement.texture.width, placement.texture.height) + gutter * 2);
+	}
+
+	sliceSize = 1;
+	mipCount = 1;
+	while (sliceSize < largest && sliceSize < sliceLimit)
+	{
+		sliceSize *= 2;
+		mipCount++;
+	}
+
+	// Tallest first keeps the skyline flat
+	std::vector<size_t> order(placements.size());
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), [this](size_t a, size_t b)
+	{
+		const DecodedTexture& first = placements[a].texture;
+		const DecodedTexture& second = placements[b].texture;
+		return first.height != second.height ? first.height > second.height : first.width > second.width;
+	});
+
+	// Packed positions stay on a power of two grid no coarser than the slice
+	UINT alignment = 1;
+	while (alignment < gutter && alignment < sliceSize)
+		alignment *= 2;
+
+	// Packers for the slices textures share, a texture filling a whole slice wraps through the sampler instead
+	std::vector<AtlasPacker> packers;
+	std::vector<UINT> packerSlices;
+	UINT sliceCount = 0;
+	UINT64 usedTexels = 0;
+	for (size_t index : order)
+	{
+		Placement& placement = placements[index];
+		UINT width = placement.texture.width;
+		UINT height = placement.texture.height;
+		usedTexels += (UINT64)width * height;
+
+		placement.gutterX = width == sliceSize ? 0 : min(gutter, (sliceSize - width) / 2);
+		placement.gutterY = height == sliceSize ? 0 : min(gutter, (sliceSize - height) / 2);
+		placement.rect.width = width;
+		placement.rect.height = height;
+		if (placement.gutterX == 0 && placement.gutterY == 0 && width == sliceSize && height == sliceSize)
+		{
+			placement.slice = sliceCount++;
+			placement.rect.x = 0;
+			placement.rect.y = 0;
+			continue;
+		}
+
+		UINT paddedWidth = width + placement.gutterX * 2;
+		UINT paddedHeight = height + placement.gutterY * 2;
+		AtlasRect rect;
+		size_t packer = 0;
+		while (packer < packers.size() && !packers[packer].Insert(paddedWidth, paddedHeight, rect))
+			packer++;
+		if (packer == packers.size())
+		{
+			packers.push_back(AtlasPacker(sliceSize, sliceSize, alignment));
+			packerSlices.push_back(sliceCount++);
+			packers.back().Insert(paddedWidth, paddedHeight, rect);
+		}
+
+		placement.slice = packerSlices[packer];
+		placement.rect.x = rect.x + placement.gutterX;
+		placement.rect.y = rect.y + placement.gutterY;
+	}
+
+	slices.assign(sliceCount, std::vector<ImageData>(mipCount));
+	for (std::vector<ImageData>& slice : slices)
+	{
+		for (UINT mip = 0; mip < mipCount; mip++)
+		{
+			slice[mip].width = max(sliceSize >> mip, 1u);
+			slice[mip].height = slice[mip].width;
+			slice[mip].rgba.assign((size_t)slice[mip].width * slice[mip].height * 4, 0);
+		}
+	}
+
+	for (Placement& placement : placements)
+	{
+		Compose(placement);
+		placement.texture.levels.clear();
+	}
+
+	occupancy = (float)((double)usedTexels / ((double)sliceCount * sliceSize * sliceSize));
+	return true;
+}
+
+void TextureAtlas::Compose(const Placement& placement)
+{
+	const DecodedTexture& texture = placement.texture;
+	const BYTE* level = &texture.levels[0];
+	for (UINT mip = 0; mip < texture.mipCount && mip < mipCount; mip++)
+	{
+		UINT width = max(texture.width >> mip, 1u);
+		UINT height = max(texture.height >> mip, 1u);
+
+		// Once the texture is smaller than a texel of the slice it has nothing left to contribute
+		if ((placement.rect.width >> mip) == 0 || (placement.rect.height >> mip) == 0)
+			break;
+
+		ImageConvert::Blit(level, width, height, placement.gutterX >> mip, placement.gutterY >> mip, slices[placement.slice][mip],
+			placement.rect.x >> mip, placement.rect.y >> mip);
+		level += (size_t)width * height * 4;
+	}
+}
+
+bool TextureAtlas::Create(ID3D11Device* dev)
+{
+	PROFILE_ZONE("TextureAtlas::Create");
+	if (slices.empty())
+		return true;
+
+	D3D11_TEXTURE2D_DESC desc;
+	ZeroMemory(&desc, sizeof(D3D11_TEXTURE2D_DESC));
+	desc.Width = sliceSize;
+	desc.Height = sliceSize;
+	desc.MipLevels = mipCount;
+	desc.ArraySize = (UINT)slices.size();
+	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	// Subresources go slice by slice, every mip of a slice before the next slice
+	std::vector<D3D11_SUBRESOURCE_DATA> data(slices.size() * mipCount);
+	for (size_t slice = 0; slice < slices.size(); slice++)
+	{
+		for (UINT mip = 0; mip < mipCount; mip++)
+		{
+			D3D11_SUBRESOURCE_DATA& subresource = data[slice * mipCount + mip];
+			subresource.pSysMem = &slices[slice][mip].rgba[0];
+			subresource.SysMemPitch = slices[slice][mip].width * 4;
+			subresource.SysMemSlicePitch = 0;
+		}
+	}
+
+	ID3D11Texture2D* texture = NULL;
+	if (FAILED(TrackedResources::CreateTexture2D(dev, &desc, &data[0], "TextureAtlas", &texture)))
+		return false;
+
+	// Always an array view, a single slice would otherwise get a plain Texture2D view the shaders can't take
+	D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc;
+	ZeroMemory(&viewDesc, sizeof(D3D11_SHADER_RESOURCE_VIEW_DESC));
+	viewDesc.Format = desc.Format;
+	viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+	viewDesc.Texture2DArray.MipLevels = mipCount;
+	viewDesc.Texture2DArray.ArraySize = desc.ArraySize;
+	HRESULT hr = TrackedResources::CreateShaderResourceView(dev, texture, &viewDesc, "TextureAtlas", &view);
+	ReleaseMacro(texture);
+
+	slices.clear();
+	return SUCCEEDED(hr);
+}
+
+bool TextureAtlas::Apply(Material* mat, TextureSlot slot, const std::wstring& path) const
+{
+	std::wstring key = TextureCache::Canonicalize(path);
+	for (const Placement& placement : placements)
+	{
+		if (placement.path != key)
+			continue;
+
+		float scale = 1.0f / sliceSize;
+		XMFLOAT4 rect(placement.rect.x * scale, placement.rect.y * scale, placement.rect.width * scale, placement.rect.height * scale);
+		mat->SetTextureRegion(slot, view, placement.slice, rect);
+		return true;
+	}
+	return false;
+}
+
+TextureAtlasStats TextureAtlas::GetStats() const
+{
+	TextureAtlasStats stats;
+	stats.textures = (UINT)placements.size();
+	stats.slices = 0;
+	stats.sliceSize = sliceSize;
+	stats.occupancy = occupancy;
+
+	for (const Placement& placement : placements)
+		stats.slices = max(stats.slices, placement.slice + 1);
+	return stats;
+}
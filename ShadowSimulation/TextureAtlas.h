@@ -0,0 +1,84 @@
+//
+// Packs material textures into the slices of one Texture2DArray so materials stop rebinding textures
+// Textures as large as a slice get one to themselves, smaller ones share slices through a skyline packer
+// with wrapped gutters, and materials sample them by slice and UV rectangle
+// Turned on from the command line: -atlas slice=1024 gutter=8
+//
+
+#ifndef TEXTUREATLAS_H
+#define TEXTUREATLAS_H
+
+#include <d3d11.h>
+#include <string>
+#include <vector>
+
+#include "AtlasPacker.h"
+#include "FileTextureSource.h"
+#include "Material.h"
+
+struct TextureAtlasStats
+{
+	UINT textures;
+	UINT slices;
+	UINT sliceSize;
+	float occupancy;	// Texels used by textures over the texels of every slice, top mip only
+};
+
+class TextureAtlas
+{
+public:
+	TextureAtlas();
+	~TextureAtlas();
+
+	/// <summary>Reads atlas settings from the command line. Returns true if -atlas was passed
+	/// </summary>
+	bool ParseCommandLine(const char* cmdLine);
+
+	bool IsEnabled() const;
+
+	/// <summary>Queues a texture for the atlas, call before Decode
+	/// </summary>
+	void Add(const std::wstring& path);
+
+	/// <summary>Decodes every queued texture and lays out the slices. Doesn't touch the device
+	/// </summary>
+	bool Decode();
+
+	/// <summary>Creates the texture array from the decoded slices and frees them
+	/// </summary>
+	bool Create(ID3D11Device* dev);
+
+	/// <summary>Points a material's slot at a texture in the array. Returns false for textures that weren't added
+	/// </summary>
+	bool Apply(Material* mat, TextureSlot slot, const std::wstring& path) const;
+
+	TextureAtlasStats GetStats() const;
+private:
+	struct Placement
+	{
+		std::wstring path;
+		DecodedTexture texture;
+		UINT slice;
+		AtlasRect rect;		// Texels the texture covers in the slice, not counting the gutter
+		UINT gutterX;
+		UINT gutterY;
+	};
+
+	/// <summary>Copies every mip of a placed texture into its slice
+	/// </summary>
+	void Compose(const Placement& placement);
+
+	bool enabled;
+	UINT maxSliceSize;
+	UINT gutter;
+
+	UINT sliceSize;
+	UINT mipCount;
+	std::vector<Placement> placements;
+	std::vector<std::vector<ImageData> > slices;	// Mip chain of each slice until Create uploads them
+	float occupancy;
+
+	ID3D11ShaderResourceView* view;
+};
+
+#endif
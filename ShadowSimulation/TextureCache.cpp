@@ -0,0 +1,335 @@
+//
+// Shares textures between everything that loads them
+// Textures are keyed on their canonical path plus load options and handed out as ref-counted handles
+// Textures nobody holds a handle to stay cached until the cache goes over budget, least recently used first
+//
+
+#include "TextureCache.h"
+
+#include <cwctype>
+#include <fstream>
+#include <sstream>
+
+static const UINT InvalidEntry = 0xFFFFFFFF;
+
+/// <summary>Releases the cache's reference on a view. Same as Game.h's ReleaseMacro, kept here so the cache builds
+/// without the rest of the renderer
+/// </summary>
+static void ReleaseView(ID3D11ShaderResourceView*& view)
+{
+	if (view)
+	{
+		view->Release();
+		view = NULL;
+	}
+}
+
+///
+// TextureHandle
+///
+TextureHandle::TextureHandle() :
+cache(NULL),
+entry(InvalidEntry)
+{
+
+}
+
+TextureHandle::TextureHandle(TextureCache* cache, UINT entry) :
+cache(cache),
+entry(entry)
+{
+	if (cache)
+		cache->AddHandle(entry);
+}
+
+TextureHandle::TextureHandle(const TextureHandle& other) :
+cache(other.cache),
+entry(other.entry)
+{
+	if (cache)
+		cache->AddHandle(entry);
+}
+
+TextureHandle& TextureHandle::operator=(const TextureHandle& other)
+{
+	if (other.cache)
+		other.cache->AddHandle(other.entry);
+	Reset();
+	cache = other.cache;
+	entry = other.entry;
+	return *this;
+}
+
+TextureHandle::~TextureHandle()
+{
+	Reset();
+}
+
+ID3D11ShaderResourceView* TextureHandle::Get() const
+{
+	if (!cache)
+		return NULL;
+
+	std::lock_guard<std::recursive_mutex> lock(cache->mutex);
+	return cache->entries[entry].view;
+}
+
+UINT64 TextureHandle::GetBytes() const
+{
+	if (!cache)
+		return 0;
+
+	std::lock_guard<std::recursive_mutex> lock(cache->mutex);
+	return cache->entries[entry].bytes;
+}
+
+bool TextureHandle::IsValid() const
+{
+	return cache != NULL;
+}
+
+void TextureHandle::Reset()
+{
+	if (cache)
+		cache->RemoveHandle(entry);
+	cache = NULL;
+	entry = InvalidEntry;
+}
+
+///
+// TextureCache
+///
+TextureCache::TextureCache(TextureSource* source) :
+source(source),
+budget(128 * 1024 * 1024),
+totalBytes(0),
+useCounter(0),
+hits(0),
+misses(0),
+evictions(0)
+{
+
+}
+
+TextureCache::~TextureCache()
+{
+	for (Entry& entry : entries)
+		ReleaseView(entry.view);
+}
+
+TextureHandle TextureCache::Load(const std::wstring& path, const TextureLoadOptions& options)
+{
+	std::lock_guard<std::recursive_mutex> lock(mutex);
+
+	std::wstring key = MakeKey(path, options);
+	std::map<std::wstring, UINT>::iterator cached = lookup.find(key);
+	if (cached != lookup.end())
+	{
+		hits++;
+		return TextureHandle(this, cached->second);
+	}
+
+	misses++;
+	ID3D11ShaderResourceView* view = NULL;
+	UINT64 bytes = 0;
+	if (!source || !source->CreateTexture(path, options, &view, bytes))
+		return TextureHandle();
+
+	TextureHandle handle(this, AddEntry(key, view, bytes));
+	TrimLocked();
+	return handle;
+}
+
+TextureHandle TextureCache::Find(const std::wstring& path, const TextureLoadOptions& options)
+{
+	std::lock_guard<std::recursive_mutex> lock(mutex);
+
+	std::map<std::wstring, UINT>::iterator cached = lookup.find(MakeKey(path, options));
+	if (cached == lookup.end())
+		return TextureHandle();
+
+	hits++;
+	return TextureHandle(this, cached->second);
+}
+
+TextureHandle TextureCache::Insert(const std::wstring& path, const TextureLoadOptions& options, ID3D11ShaderResourceView* view, UINT64 bytes)
+{
+	std::lock_guard<std::recursive_mutex> lock(mutex);
+
+	std::wstring key = MakeKey(path, options);
+	std::map<std::wstring, UINT>::iterator cached = lookup.find(key);
+	if (cached != lookup.end())
+		return TextureHandle(this, cached->second);
+
+	view->AddRef();
+	TextureHandle handle(this, AddEntry(key, view, bytes));
+	TrimLocked();
+	return handle;
+}
+
+void TextureCache::SetBudget(UINT64 bytes)
+{
+	std::lock_guard<std::recursive_mutex> lock(mutex);
+	budget = bytes;
+	TrimLocked();
+}
+
+void TextureCache::Trim()
+{
+	std::lock_guard<std::recursive_mutex> lock(mutex);
+	TrimLocked();
+}
+
+TextureCacheStats TextureCache::GetStats() const
+{
+	std::lock_guard<std::recursive_mutex> lock(mutex);
+
+	TextureCacheStats stats = {};
+	for (const Entry& entry : entries)
+	{
+		if (!entry.view)
+			continue;
+		stats.textures++;
+		stats.bytes += entry.bytes;
+		if (entry.handles)
+		{
+			stats.referenced++;
+			stats.referencedBytes += entry.bytes;
+		}
+	}
+	stats.hits = hits;
+	stats.misses = misses;
+	stats.evictions = evictions;
+	return stats;
+}
+
+bool TextureCache::WriteReport(const char* path) const
+{
+	std::ofstream file(path);
+	if (!file)
+		return false;
+
+	TextureCacheStats stats = GetStats();
+	file << "Textures: " << stats.textures << " (" << stats.referenced << " in use)\n";
+	file << "Memory: " << stats.bytes / 1024 << " KB (" << stats.referencedBytes / 1024 << " KB in use, budget " << budget / 1024 << " KB)\n";
+	file << "Hits: " << stats.hits << ", misses: " << stats.misses << ", evictions: " << stats.evictions << "\n\n";
+
+	std::lock_guard<std::recursive_mutex> lock(mutex);
+	for (const Entry& entry : entries)
+	{
+		if (!entry.view)
+			continue;
+
+		// Keys are ASCII paths in practice, narrow them for the log
+		std::string key(entry.key.begin(), entry.key.end());
+		file << entry.bytes / 1024 << " KB\t" << entry.handles << " handles\t" << key << "\n";
+	}
+	return file.good();
+}
+
+std::wstring TextureCache::Canonicalize(const std::wstring& path)
+{
+	std::wstring normalized;
+	normalized.reserve(path.size());
+	for (wchar_t c : path)
+		normalized.push_back(c == L'\\' ? L'/' : (wchar_t)towlower(c));
+
+	// Resolve the segments, keeping leading ".." that can't be resolved
+	std::vector<std::wstring> segments;
+	std::wistringstream stream(normalized);
+	std::wstring segment;
+	while (std::getline(stream, segment, L'/'))
+	{
+		if (segment.empty() || segment == L".")
+			continue;
+		if (segment == L".." && !segments.empty() && segments.back() != L"..")
+			segments.pop_back();
+		else
+			segments.push_back(segment);
+	}
+
+	std::wstring canonical = !normalized.empty() && normalized[0] == L'/' ? L"/" : L"";
+	for (size_t i = 0; i < segments.size(); i++)
+	{
+		if (i)
+			canonical += L'/';
+		canonical += segments[i];
+	}
+	return canonical;
+}
+
+std::wstring TextureCache::MakeKey(const std::wstring& path, const TextureLoadOptions& options)
+{
+	std::wostringstream key;
+	key << Canonicalize(path) << L"|" << options.maxSize << L"|" << (options.forceSRGB ? L"srgb" : L"linear");
+	if (options.premultiplyAlpha)
+		key << L"|premultiplied";
+	return key.str();
+}
+
+UINT TextureCache::AddEntry(const std::wstring& key, ID3D11ShaderResourceView* view, UINT64 bytes)
+{
+	Entry entry;
+	entry.key = key;
+	entry.view = view;
+	entry.bytes = bytes;
+	entry.handles = 0;
+	entry.lastUse = ++useCounter;
+
+	UINT index;
+	if (!freeEntries.empty())
+	{
+		index = freeEntries.back();
+		freeEntries.pop_back();
+		entries[index] = entry;
+	}
+	else
+	{
+		index = (UINT)entries.size();
+		entries.push_back(entry);
+	}
+
+	lookup[key] = index;
+	totalBytes += bytes;
+	return index;
+}
+
+void TextureCache::TrimLocked()
+{
+	while (totalBytes > budget)
+	{
+		int victim = -1;
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			if (entries[i].view && !entries[i].handles && (victim < 0 || entries[i].lastUse < entries[victim].lastUse))
+				victim = (int)i;
+		}
+
+		// Everything left is in use, the budget only applies to textures nobody holds
+		if (victim < 0)
+			return;
+
+		Entry& entry = entries[victim];
+		lookup.erase(entry.key);
+		ReleaseView(entry.view);
+		totalBytes -= entry.bytes;
+		entry.key.clear();
+		entry.bytes = 0;
+		freeEntries.push_back((UINT)victim);
+		evictions++;
+	}
+}
+
+void TextureCache::AddHandle(UINT entry)
+{
+	std::lock_guard<std::recursive_mutex> lock(mutex);
+	entries[entry].handles++;
+	entries[entry].lastUse = ++useCounter;
+}
+
+void TextureCache::RemoveHandle(UINT entry)
+{
+	std::lock_guard<std::recursive_mutex> lock(mutex);
+	entries[entry].handles--;
+	entries[entry].lastUse = ++useCounter;
+}
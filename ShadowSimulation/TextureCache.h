@@ -0,0 +1,154 @@
+//
+// Shares textures between everything that loads them
+// Textures are keyed on their canonical path plus load options and handed out as ref-counted handles
+// Textures nobody holds a handle to stay cached until the cache goes over budget, least recently used first
+//
+
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+#include <d3d11.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct TextureLoadOptions
+{
+	TextureLoadOptions() :
+	maxSize(0),
+	forceSRGB(false),
+	premultiplyAlpha(false)
+	{
+
+	}
+
+	UINT maxSize;	// Larger textures are scaled down on load, 0 keeps the file's size
+	bool forceSRGB;
+	bool premultiplyAlpha;	// Only applies to images decoded on the CPU, cooked .dds files are loaded as stored
+};
+
+/// <summary>Creates textures for a TextureCache
+/// </summary>
+class TextureSource
+{
+public:
+	virtual ~TextureSource() {}
+
+	/// <summary>Creates the texture at path. Returns a view holding one reference and the bytes the texture occupies
+	/// </summary>
+	virtual bool CreateTexture(const std::wstring& path, const TextureLoadOptions& options, ID3D11ShaderResourceView** view, UINT64& bytes) = 0;
+};
+
+struct TextureCacheStats
+{
+	UINT textures;
+	UINT referenced;	// Textures with at least one live handle
+	UINT64 bytes;
+	UINT64 referencedBytes;
+	UINT hits;
+	UINT misses;
+	UINT evictions;
+};
+
+class TextureCache;
+
+/// <summary>Keeps a cached texture alive. Copies share the texture, the last one to go marks it unused
+/// </summary>
+class TextureHandle
+{
+public:
+	TextureHandle();
+	TextureHandle(const TextureHandle& other);
+	TextureHandle& operator=(const TextureHandle& other);
+	~TextureHandle();
+
+	ID3D11ShaderResourceView* Get() const;
+	UINT64 GetBytes() const;
+	bool IsValid() const;
+	void Reset();
+private:
+	friend class TextureCache;
+	TextureHandle(TextureCache* cache, UINT entry);
+
+	TextureCache* cache;
+	UINT entry;
+};
+
+class TextureCache
+{
+public:
+	TextureCache(TextureSource* source);
+	~TextureCache();
+
+	/// <summary>Returns the cached texture, creating it on a miss. The handle is invalid if creation failed
+	/// </summary>
+	TextureHandle Load(const std::wstring& path, const TextureLoadOptions& options = TextureLoadOptions());
+
+	/// <summary>Returns the cached texture or an invalid handle, never creates one
+	/// </summary>
+	TextureHandle Find(const std::wstring& path, const TextureLoadOptions& options = TextureLoadOptions());
+
+	/// <summary>Adds a texture created elsewhere (e.g. streamed in), taking a reference on view
+	/// Returns the existing texture instead if the key is already cached
+	/// </summary>
+	TextureHandle Insert(const std::wstring& path, const TextureLoadOptions& options, ID3D11ShaderResourceView* view, UINT64 bytes);
+
+	/// <summary>Bytes the cache may hold before it starts dropping unused textures
+	/// </summary>
+	void SetBudget(UINT64 bytes);
+
+	/// <summary>Drops unused textures, least recently used first, until the cache is within budget
+	/// </summary>
+	void Trim();
+
+	TextureCacheStats GetStats() const;
+
+	/// <summary>Writes the totals and one line per cached texture
+	/// </summary>
+	bool WriteReport(const char* path) const;
+
+	/// <summary>Lower case, forward slashes, with "." and ".." segments resolved
+	/// </summary>
+	static std::wstring Canonicalize(const std::wstring& path);
+private:
+	friend class TextureHandle;
+
+	struct Entry
+	{
+		std::wstring key;
+		ID3D11ShaderResourceView* view;
+		UINT64 bytes;
+		UINT handles;
+		UINT64 lastUse;
+	};
+
+	static std::wstring MakeKey(const std::wstring& path, const TextureLoadOptions& options);
+
+	/// <summary>Takes a slot for a new entry. Called with lock held
+	/// </summary>
+	UINT AddEntry(const std::wstring& key, ID3D11ShaderResourceView* view, UINT64 bytes);
+
+	/// <summary>Drops unused entries until within budget. Called with lock held
+	/// </summary>
+	void TrimLocked();
+
+	void AddHandle(UINT entry);
+	void RemoveHandle(UINT entry);
+
+	TextureSource* source;
+	mutable std::recursive_mutex mutex;
+
+	std::vector<Entry> entries;
+	std::vector<UINT> freeEntries;
+	std::map<std::wstring, UINT> lookup;
+
+	UINT64 budget;
+	UINT64 totalBytes;
+	UINT64 useCounter;
+	UINT hits;
+	UINT misses;
+	UINT evictions;
+};
+
+#endif
@@ -0,0 +1,659 @@
+//
+// Class with static methods to cook images into block compressed DDS files
+// Builds a full mip chain (gamma correct for color, renormalized for normal maps) and encodes
+// BC1/BC3 for color and BC5 for normal maps, splitting the blocks across threads
+//
+
+#include "TextureCooker.h"
+
+#include <atomic>
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <emmintrin.h>
+
+///
+// DDS layout, matches DirectXTK's dds.h so the files load through DDSTextureLoader
+///
+struct DDSPixelFormat
+{
+	UINT size;
+	UINT flags;
+	UINT fourCC;
+	UINT rgbBitCount;
+	UINT rBitMask;
+	UINT gBitMask;
+	UINT bBitMask;
+	UINT aBitMask;
+};
+
+struct DDSHeader
+{
+	UINT size;
+	UINT flags;
+	UINT height;
+	UINT width;
+	UINT pitchOrLinearSize;
+	UINT depth;
+	UINT mipMapCount;
+	UINT reserved1[11];
+	DDSPixelFormat ddspf;
+	UINT caps;
+	UINT caps2;
+	UINT caps3;
+	UINT caps4;
+	UINT reserved2;
+};
+
+struct DDSHeaderDXT10
+{
+	UINT dxgiFormat;
+	UINT resourceDimension;
+	UINT miscFlag;
+	UINT arraySize;
+	UINT miscFlags2;
+};
+
+static const UINT DDSMagic = 0x20534444;				// "DDS "
+static const UINT DDSFourCCFlag = 0x00000004;			// DDPF_FOURCC
+static const UINT DDSHeaderFlagsTexture = 0x00001007;	// DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT
+static const UINT DDSHeaderFlagsMipmap = 0x00020000;	// DDSD_MIPMAPCOUNT
+static const UINT DDSHeaderFlagsLinearSize = 0x00080000;	// DDSD_LINEARSIZE
+static const UINT DDSSurfaceFlagsTexture = 0x00001000;	// DDSCAPS_TEXTURE
+static const UINT DDSSurfaceFlagsMipmap = 0x00400008;	// DDSCAPS_COMPLEX | DDSCAPS_MIPMAP
+
+// DXGI_FORMAT values, spelled out so the cooker doesn't need the D3D headers
+static const UINT FormatBC1 = 71;
+static const UINT FormatBC1SRGB = 72;
+static const UINT FormatBC3 = 77;
+static const UINT FormatBC3SRGB = 78;
+static const UINT FormatBC5 = 83;
+static const UINT DimensionTexture2D = 3;
+
+static UINT FourCC(char a, char b, char c, char d)
+{
+	return (UINT)(BYTE)a | ((UINT)(BYTE)b << 8) | ((UINT)(BYTE)c << 16) | ((UINT)(BYTE)d << 24);
+}
+
+///
+// BC1 helpers
+///
+static USHORT Pack565(const float color[3])
+{
+	UINT r = (UINT)(min(max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+	UINT g = (UINT)(min(max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f + 0.5f);
+	UINT b = (UINT)(min(max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+	return (USHORT)((r << 11) | (g << 5) | b);
+}
+
+static void Unpack565(USHORT packed, int color[3])
+{
+	int r = (packed >> 11) & 31;
+	int g = (packed >> 5) & 63;
+	int b = packed & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+/// <summary>Picks the closest of the four palette entries for every texel, four texels at a time
+/// Returns the total squared error
+/// </summary>
+static float SelectColorIndices(const float* r, const float* g, const float* b, const float palette[4][3], UINT& indices)
+{
+	__m128 totalError = _mm_setzero_ps();
+	indices = 0;
+	for (UINT i = 0; i < 16; i += 4)
+	{
+		__m128 pr = _mm_loadu_ps(r + i);
+		__m128 pg = _mm_loadu_ps(g + i);
+		__m128 pb = _mm_loadu_ps(b + i);
+
+		__m128 bestError = _mm_set1_ps(1e30f);
+		__m128 bestIndex = _mm_setzero_ps();
+		for (UINT k = 0; k < 4; k++)
+		{
+			__m128 dr = _mm_sub_ps(pr, _mm_set1_ps(palette[k][0]));
+			__m128 dg = _mm_sub_ps(pg, _mm_set1_ps(palette[k][1]));
+			__m128 db = _mm_sub_ps(pb, _mm_set1_ps(palette[k][2]));
+			__m128 error = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+
+			__m128 closer = _mm_cmplt_ps(error, bestError);
+			bestError = _mm_min_ps(error, bestError);
+			bestIndex = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps((float)k)), _mm_andnot_ps(closer, bestIndex));
+		}
+		totalError = _mm_add_ps(totalError, bestError);
+
+		__m128i best = _mm_cvtps_epi32(bestIndex);
+		UINT lanes[4];
+		_mm_storeu_si128((__m128i*)lanes, best);
+		for (UINT lane = 0; lane < 4; lane++)
+			indices |= lanes[lane] << ((i + lane) * 2);
+	}
+
+	float errors[4];
+	_mm_storeu_ps(errors, totalError);
+	return errors[0] + errors[1] + errors[2] + errors[3];
+}
+
+/// <summary>Quantizes a pair of endpoints and fits indices to them. Returns the squared error
+/// </summary>
+static float FitColorEndpoints(const float* r, const float* g, const float* b, const float first[3], const float second[3], USHORT& c0, USHORT& c1, UINT& indices)
+{
+	c0 = Pack565(first);
+	c1 = Pack565(second);
+
+	// Four color mode needs c0 > c1
+	if (c0 < c1)
+	{
+		USHORT swap = c0;
+		c0 = c1;
+		c1 = swap;
+	}
+
+	int e0[3], e1[3];
+	Unpack565(c0, e0);
+	Unpack565(c1, e1);
+
+	float palette[4][3];
+	for (UINT c = 0; c < 3; c++)
+	{
+		palette[0][c] = (float)e0[c];
+		palette[1][c] = (float)e1[c];
+		palette[2][c] = (float)((2 * e0[c] + e1[c]) / 3);
+		palette[3][c] = (float)((e0[c] + 2 * e1[c]) / 3);
+	}
+
+	if (c0 == c1)
+	{
+		// Solid block, every texel uses c0
+		indices = 0;
+		float error = 0.0f;
+		for (UINT i = 0; i < 16; i++)
+		{
+			float dr = r[i] - palette[0][0];
+			float dg = g[i] - palette[0][1];
+			float db = b[i] - palette[0][2];
+			error += dr * dr + dg * dg + db * db;
+		}
+		return error;
+	}
+
+	return SelectColorIndices(r, g, b, palette, indices);
+}
+
+static void WriteColorBlock(USHORT c0, USHORT c1, UINT indices, BYTE* block)
+{
+	block[0] = (BYTE)(c0 & 0xFF);
+	block[1] = (BYTE)(c0 >> 8);
+	block[2] = (BYTE)(c1 & 0xFF);
+	block[3] = (BYTE)(c1 >> 8);
+	for (UINT i = 0; i < 4; i++)
+		block[4 + i] = (BYTE)(indices >> (i * 8));
+}
+
+CookFormat TextureCooker::ChooseFormat(const std::string& path, const ImageData& image)
+{
+	std::string name = path;
+	for (size_t i = 0; i < name.size(); i++)
+		name[i] = (char)tolower((BYTE)name[i]);
+
+	size_t extension = name.rfind('.');
+	if (extension != std::string::npos)
+		name = name.substr(0, extension);
+
+	const std::string normalSuffix = "_normal";
+	if (name.size() >= normalSuffix.size() && name.compare(name.size() - normalSuffix.size(), normalSuffix.size(), normalSuffix) == 0)
+		return CookBC5;
+
+	for (size_t i = 3; i < image.rgba.size(); i += 4)
+	{
+		if (image.rgba[i] != 255)
+			return CookBC3;
+	}
+	return CookBC1;
+}
+
+bool TextureCooker::Cook(const ImageData& image, const CookOptions& options, std::vector<BYTE>& dds, CookStats& stats)
+{
+	if (image.width == 0 || image.height == 0 || image.rgba.size() < (size_t)image.width * image.height * 4)
+		return false;
+
+	std::vector<ImageData> mips;
+	if (options.mips)
+		GenerateMips(image, options.format == CookBC5, options.mipFilter, mips);
+	else
+		mips.push_back(image);
+
+	bool srgb = options.srgb && options.format != CookBC5;
+	bool extended = srgb;
+
+	DDSHeader header;
+	memset(&header, 0, sizeof(header));
+	header.size = sizeof(DDSHeader);
+	header.flags = DDSHeaderFlagsTexture | DDSHeaderFlagsLinearSize | (mips.size() > 1 ? DDSHeaderFlagsMipmap : 0);
+	header.height = image.height;
+	header.width = image.width;
+	header.pitchOrLinearSize = ((image.width + 3) / 4) * ((image.height + 3) / 4) * GetBlockBytes(options.format);
+	header.mipMapCount = (UINT)mips.size();
+	header.ddspf.size = sizeof(DDSPixelFormat);
+	header.ddspf.flags = DDSFourCCFlag;
+	header.caps = DDSSurfaceFlagsTexture | (mips.size() > 1 ? DDSSurfaceFlagsMipmap : 0);
+
+	// sRGB formats only exist in the DX10 header, the rest use the FourCCs every loader understands
+	UINT dxgiFormat = FormatBC5;
+	if (extended)
+		header.ddspf.fourCC = FourCC('D', 'X', '1', '0');
+	else if (options.format == CookBC1)
+		header.ddspf.fourCC = FourCC('D', 'X', 'T', '1');
+	else if (options.format == CookBC3)
+		header.ddspf.fourCC = FourCC('D', 'X', 'T', '5');
+	else
+		header.ddspf.fourCC = FourCC('A', 'T', 'I', '2');
+
+	if (options.format == CookBC1)
+		dxgiFormat = srgb ? FormatBC1SRGB : FormatBC1;
+	else if (options.format == CookBC3)
+		dxgiFormat = srgb ? FormatBC3SRGB : FormatBC3;
+
+	dds.clear();
+	dds.resize(sizeof(UINT) + sizeof(DDSHeader));
+	memcpy(&dds[0], &DDSMagic, sizeof(UINT));
+	memcpy(&dds[sizeof(UINT)], &header, sizeof(DDSHeader));
+	if (extended)
+	{
+		DDSHeaderDXT10 dxt10;
+		memset(&dxt10, 0, sizeof(dxt10));
+		dxt10.dxgiFormat = dxgiFormat;
+		dxt10.resourceDimension = DimensionTexture2D;
+		dxt10.arraySize = 1;
+
+		size_t offset = dds.size();
+		dds.resize(offset + sizeof(DDSHeaderDXT10));
+		memcpy(&dds[offset], &dxt10, sizeof(DDSHeaderDXT10));
+	}
+
+	stats.mipCount = (UINT)mips.size();
+	stats.sourceBytes = 0;
+	stats.seconds = 0.0;
+
+	UINT channels = options.format == CookBC1 ? 3 : (options.format == CookBC3 ? 4 : 2);
+	double squaredError = 0.0;
+	UINT64 samples = 0;
+	UINT64 texels = 0;
+
+	std::vector<BYTE> blocks;
+	for (const ImageData& mip : mips)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		EncodeBlocks(mip, options.format, options.threads, blocks);
+		stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		size_t offset = dds.size();
+		dds.resize(offset + blocks.size());
+		memcpy(&dds[offset], &blocks[0], blocks.size());
+
+		ImageData decoded;
+		DecodeBlocks(&blocks[0], mip.width, mip.height, options.format, decoded);
+		squaredError += SquaredError(mip, decoded, options.format);
+
+		texels += (UINT64)mip.width * mip.height;
+		samples += (UINT64)mip.width * mip.height * channels;
+	}
+
+	double meanError = squaredError / samples;
+	stats.psnr = meanError > 0.0 ? 10.0 * log10(255.0 * 255.0 / meanError) : 100.0;
+	stats.sourceBytes = texels * 4;
+	stats.cookedBytes = dds.size();
+	stats.megapixelsPerSecond = stats.seconds > 0.0 ? texels / stats.seconds / 1000000.0 : 0.0;
+	return true;
+}
+
+void TextureCooker::GenerateMips(const ImageData& image, bool normalMap, MipFilter filter, std::vector<ImageData>& mips)
+{
+	ImageConvert::GenerateMips(image, normalMap ? MipNormalMap : MipColor, filter, mips);
+}
+
+void TextureCooker::EncodeBlocks(const ImageData& image, CookFormat format, UINT threads, std::vector<BYTE>& blocks)
+{
+	UINT blocksWide = (image.width + 3) / 4;
+	UINT blocksHigh = (image.height + 3) / 4;
+	UINT blockBytes = GetBlockBytes(format);
+	blocks.resize((size_t)blocksWide * blocksHigh * blockBytes);
+
+	// Workers take rows of blocks until none are left
+	std::atomic<UINT> nextRow(0);
+	auto encodeRows = [&]()
+	{
+		BYTE texels[64];
+		for (UINT row = nextRow++; row < blocksHigh; row = nextRow++)
+		{
+			for (UINT column = 0; column < blocksWide; column++)
+			{
+				// Edge blocks repeat the last row and column
+				for (UINT y = 0; y < 4; y++)
+				{
+					UINT sourceY = min(row * 4 + y, image.height - 1);
+					for (UINT x = 0; x < 4; x++)
+					{
+						UINT sourceX = min(column * 4 + x, image.width - 1);
+						memcpy(&texels[(y * 4 + x) * 4], &image.rgba[((size_t)sourceY * image.width + sourceX) * 4], 4);
+					}
+				}
+
+				BYTE* block = &blocks[((size_t)row * blocksWide + column) * blockBytes];
+				if (format == CookBC1)
+				{
+					EncodeBC1(texels, block);
+				}
+				else if (format == CookBC3)
+				{
+					EncodeBC4(texels, 3, block);
+					EncodeBC1(texels, block + 8);
+				}
+				else
+				{
+					EncodeBC4(texels, 0, block);
+					EncodeBC4(texels, 1, block + 8);
+				}
+			}
+		}
+	};
+
+	if (threads == 0)
+		threads = max(std::thread::hardware_concurrency(), 1u);
+	threads = min(threads, blocksHigh);
+
+	// The calling thread is one of the workers
+	std::vector<std::thread> workers;
+	for (UINT i = 1; i < threads; i++)
+		workers.push_back(std::thread(encodeRows));
+	encodeRows();
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+void TextureCooker::DecodeBlocks(const BYTE* blocks, UINT width, UINT height, CookFormat format, ImageData& image)
+{
+	image.width = width;
+	image.height = height;
+	image.rgba.resize((size_t)width * height * 4);
+
+	UINT blocksWide = (width + 3) / 4;
+	UINT blocksHigh = (height + 3) / 4;
+	UINT blockBytes = GetBlockBytes(format);
+
+	BYTE texels[64];
+	for (UINT row = 0; row < blocksHigh; row++)
+	{
+		for (UINT column = 0; column < blocksWide; column++)
+		{
+			const BYTE* block = &blocks[((size_t)row * blocksWide + column) * blockBytes];
+			if (format == CookBC1)
+			{
+				DecodeBC1(block, texels);
+			}
+			else if (format == CookBC3)
+			{
+				DecodeBC1(block + 8, texels);
+				DecodeBC4(block, 3, texels);
+			}
+			else
+			{
+				for (UINT i = 0; i < 16; i++)
+				{
+					texels[i * 4 + 2] = 0;
+					texels[i * 4 + 3] = 255;
+				}
+				DecodeBC4(block, 0, texels);
+				DecodeBC4(block + 8, 1, texels);
+			}
+
+			for (UINT y = 0; y < 4 && row * 4 + y < height; y++)
+			{
+				for (UINT x = 0; x < 4 && column * 4 + x < width; x++)
+					memcpy(&image.rgba[((size_t)(row * 4 + y) * width + column * 4 + x) * 4], &texels[(y * 4 + x) * 4], 4);
+			}
+		}
+	}
+}
+
+UINT TextureCooker::GetBlockBytes(CookFormat format)
+{
+	return format == CookBC1 ? 8 : 16;
+}
+
+void TextureCooker::EncodeBC1(const BYTE* texels, BYTE* block)
+{
+	float r[16], g[16], b[16];
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	for (UINT i = 0; i < 16; i++)
+	{
+		r[i] = texels[i * 4];
+		g[i] = texels[i * 4 + 1];
+		b[i] = texels[i * 4 + 2];
+		mean[0] += r[i];
+		mean[1] += g[i];
+		mean[2] += b[i];
+	}
+	for (UINT c = 0; c < 3; c++)
+		mean[c] /= 16.0f;
+
+	// Covariance, then its principal axis by power iteration
+	float cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	for (UINT i = 0; i < 16; i++)
+	{
+		float dr = r[i] - mean[0];
+		float dg = g[i] - mean[1];
+		float db = b[i] - mean[2];
+		cov[0] += dr * dr;
+		cov[1] += dr * dg;
+		cov[2] += dr * db;
+		cov[3] += dg * dg;
+		cov[4] += dg * db;
+		cov[5] += db * db;
+	}
+
+	float axis[3] = { 1.0f, 1.0f, 1.0f };
+	for (UINT iteration = 0; iteration < 8; iteration++)
+	{
+		float next[3] = {
+			cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+			cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+			cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2] };
+		float length = max(fabsf(next[0]), max(fabsf(next[1]), fabsf(next[2])));
+		if (length < 1e-6f)
+			break;
+		for (UINT c = 0; c < 3; c++)
+			axis[c] = next[c] / length;
+	}
+
+	float axisLength = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+	float lowest = 0.0f;
+	float highest = 0.0f;
+	for (UINT i = 0; i < 16; i++)
+	{
+		float projection = ((r[i] - mean[0]) * axis[0] + (g[i] - mean[1]) * axis[1] + (b[i] - mean[2]) * axis[2]) / axisLength;
+		lowest = min(lowest, projection);
+		highest = max(highest, projection);
+	}
+
+	// Pull the endpoints in slightly, the extremes are rarely worth a full palette step
+	float inset = (highest - lowest) / 16.0f;
+	float first[3], second[3];
+	for (UINT c = 0; c < 3; c++)
+	{
+		first[c] = mean[c] + axis[c] * (highest - inset);
+		second[c] = mean[c] + axis[c] * (lowest + inset);
+	}
+
+	USHORT c0, c1;
+	UINT indices;
+	float error = FitColorEndpoints(r, g, b, first, second, c0, c1, indices);
+
+	// One least squares refit of the endpoints to the chosen indices
+	if (c0 != c1)
+	{
+		static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+		float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+		float ax[3] = { 0.0f, 0.0f, 0.0f };
+		float bx[3] = { 0.0f, 0.0f, 0.0f };
+		for (UINT i = 0; i < 16; i++)
+		{
+			float w = weights[(indices >> (i * 2)) & 3];
+			float color[3] = { r[i], g[i], b[i] };
+			aa += w * w;
+			bb += (1.0f - w) * (1.0f - w);
+			ab += w * (1.0f - w);
+			for (UINT c = 0; c < 3; c++)
+			{
+				ax[c] += w * color[c];
+				bx[c] += (1.0f - w) * color[c];
+			}
+		}
+
+		float determinant = aa * bb - ab * ab;
+		if (fabsf(determinant) > 1e-6f)
+		{
+			for (UINT c = 0; c < 3; c++)
+			{
+				first[c] = (ax[c] * bb - bx[c] * ab) / determinant;
+				second[c] = (bx[c] * aa - ax[c] * ab) / determinant;
+			}
+
+			USHORT refit0, refit1;
+			UINT refitIndices;
+			float refitError = FitColorEndpoints(r, g, b, first, second, refit0, refit1, refitIndices);
+			if (refitError < error)
+			{
+				c0 = refit0;
+				c1 = refit1;
+				indices = refitIndices;
+			}
+		}
+	}
+
+	WriteColorBlock(c0, c1, indices, block);
+}
+
+void TextureCooker::EncodeBC4(const BYTE* texels, UINT channel, BYTE* block)
+{
+	BYTE lowest = 255;
+	BYTE highest = 0;
+	for (UINT i = 0; i < 16; i++)
+	{
+		lowest = min(lowest, texels[i * 4 + channel]);
+		highest = max(highest, texels[i * 4 + channel]);
+	}
+
+	memset(block, 0, 8);
+	block[0] = highest;
+	block[1] = lowest;
+	if (highest == lowest)
+		return;
+
+	// Eight value mode: the endpoints and six steps between them
+	int palette[8];
+	palette[0] = highest;
+	palette[1] = lowest;
+	for (int k = 1; k < 7; k++)
+		palette[k + 1] = ((7 - k) * highest + k * lowest) / 7;
+
+	UINT64 indices = 0;
+	for (UINT i = 0; i < 16; i++)
+	{
+		int value = texels[i * 4 + channel];
+		UINT best = 0;
+		int bestError = 256;
+		for (UINT k = 0; k < 8; k++)
+		{
+			int error = abs(value - palette[k]);
+			if (error < bestError)
+			{
+				bestError = error;
+				best = k;
+			}
+		}
+		indices |= (UINT64)best << (i * 3);
+	}
+
+	for (UINT i = 0; i < 6; i++)
+		block[2 + i] = (BYTE)(indices >> (i * 8));
+}
+
+void TextureCooker::DecodeBC1(const BYTE* block, BYTE* texels)
+{
+	USHORT c0 = (USHORT)(block[0] | (block[1] << 8));
+	USHORT c1 = (USHORT)(block[2] | (block[3] << 8));
+	UINT indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((UINT)block[7] << 24);
+
+	int e0[3], e1[3];
+	Unpack565(c0, e0);
+	Unpack565(c1, e1);
+
+	BYTE palette[4][4];
+	for (UINT c = 0; c < 3; c++)
+	{
+		palette[0][c] = (BYTE)e0[c];
+		palette[1][c] = (BYTE)e1[c];
+		if (c0 > c1)
+		{
+			palette[2][c] = (BYTE)((2 * e0[c] + e1[c]) / 3);
+			palette[3][c] = (BYTE)((e0[c] + 2 * e1[c]) / 3);
+		}
+		else
+		{
+			palette[2][c] = (BYTE)((e0[c] + e1[c]) / 2);
+			palette[3][c] = 0;
+		}
+	}
+	palette[0][3] = palette[1][3] = palette[2][3] = 255;
+	palette[3][3] = c0 > c1 ? 255 : 0;
+
+	for (UINT i = 0; i < 16; i++)
+		memcpy(&texels[i * 4], palette[(indices >> (i * 2)) & 3], 4);
+}
+
+void TextureCooker::DecodeBC4(const BYTE* block, UINT channel, BYTE* texels)
+{
+	int palette[8];
+	palette[0] = block[0];
+	palette[1] = block[1];
+	if (palette[0] > palette[1])
+	{
+		for (int k = 1; k < 7; k++)
+			palette[k + 1] = ((7 - k) * palette[0] + k * palette[1]) / 7;
+	}
+	else
+	{
+		for (int k = 1; k < 5; k++)
+			palette[k + 1] = ((5 - k) * palette[0] + k * palette[1]) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+
+	UINT64 indices = 0;
+	for (UINT i = 0; i < 6; i++)
+		indices |= (UINT64)block[2 + i] << (i * 8);
+
+	for (UINT i = 0; i < 16; i++)
+		texels[i * 4 + channel] = (BYTE)palette[(indices >> (i * 3)) & 7];
+}
+
+double TextureCooker::SquaredError(const ImageData& a, const ImageData& b, CookFormat format)
+{
+	UINT channels = format == CookBC1 ? 3 : (format == CookBC3 ? 4 : 2);
+	double error = 0.0;
+	for (size_t i = 0; i < a.rgba.size(); i += 4)
+	{
+		for (UINT c = 0; c < channels; c++)
+		{
+			double difference = (double)a.rgba[i + c] - b.rgba[i + c];
+			error += difference * difference;
+		}
+	}
+	return error;
+}
@@ -0,0 +1,87 @@
+//
+// Class with static methods to cook images into block compressed DDS files
+// Builds a full mip chain (gamma correct for color, renormalized for normal maps) and encodes
+// BC1/BC3 for color and BC5 for normal maps, splitting the blocks across threads
+//
+
+#ifndef TEXTURECOOKER_H
+#define TEXTURECOOKER_H
+
+#include <string>
+#include <vector>
+#include <Windows.h>
+
+#include "ImageConvert.h"
+
+enum CookFormat
+{
+	CookBC1,	// Opaque color, 4 bits per texel
+	CookBC3,	// Color with alpha, 8 bits per texel
+	CookBC5		// Two channel tangent space normals, 8 bits per texel
+};
+
+struct CookOptions
+{
+	CookOptions() :
+	format(CookBC1),
+	srgb(false),
+	mips(true),
+	mipFilter(MipBox),
+	threads(0)
+	{
+
+	}
+
+	CookFormat format;
+	bool srgb;		// Writes the _SRGB variant of the format, mips are gamma correct either way
+	bool mips;
+	MipFilter mipFilter;
+	UINT threads;	// 0 uses every hardware thread
+};
+
+struct CookStats
+{
+	UINT mipCount;
+	UINT64 sourceBytes;	// Uncompressed RGBA8 size of the whole chain
+	UINT64 cookedBytes;	// Size of the DDS file
+	double psnr;		// Over every mip and the channels the format stores, in dB
+	double seconds;		// Time spent encoding blocks
+	double megapixelsPerSecond;
+};
+
+class TextureCooker
+{
+public:
+	/// <summary>BC5 for files named *_normal, BC3 if any texel is translucent, otherwise BC1
+	/// </summary>
+	static CookFormat ChooseFormat(const std::string& path, const ImageData& image);
+
+	/// <summary>Cooks the image into a complete DDS file in memory
+	/// </summary>
+	static bool Cook(const ImageData& image, const CookOptions& options, std::vector<BYTE>& dds, CookStats& stats);
+
+	/// <summary>Fills mips with the image followed by every smaller level down to 1x1
+	/// </summary>
+	static void GenerateMips(const ImageData& image, bool normalMap, MipFilter filter, std::vector<ImageData>& mips);
+
+	/// <summary>Encodes one level into blocks, 4x4 texels per block in row order
+	/// </summary>
+	static void EncodeBlocks(const ImageData& image, CookFormat format, UINT threads, std::vector<BYTE>& blocks);
+
+	/// <summary>Decodes blocks back to RGBA, BC5 fills blue with 0 and alpha with 255
+	/// </summary>
+	static void DecodeBlocks(const BYTE* blocks, UINT width, UINT height, CookFormat format, ImageData& image);
+
+	static UINT GetBlockBytes(CookFormat format);
+private:
+	static void EncodeBC1(const BYTE* texels, BYTE* block);
+	static void EncodeBC4(const BYTE* texels, UINT channel, BYTE* block);
+	static void DecodeBC1(const BYTE* block, BYTE* texels);
+	static void DecodeBC4(const BYTE* block, UINT channel, BYTE* texels);
+
+	/// <summary>Sum of squared differences over the channels the format stores
+	/// </summary>
+	static double SquaredError(const ImageData& a, const ImageData& b, CookFormat format);
+};
+
+#endif
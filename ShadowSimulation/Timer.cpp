@@ -8,44 +8,44 @@
 
 #include "Timer.h"
 
-std::chrono::time_point<std::chrono::system_clock> Timer::programStart;
-std::chrono::time_point<std::chrono::system_clock> Timer::localStart;
-std::chrono::time_point<std::chrono::system_clock> Timer::localEnd;
-std::chrono::time_point<std::chrono::system_clock> Timer::frameStart;
-std::chrono::time_point<std::chrono::system_clock> Timer::frameEnd;
+std::chrono::time_point<std::chrono::steady_clock> Timer::programStart;
+std::chrono::time_point<std::chrono::steady_clock> Timer::localStart;
+std::chrono::time_point<std::chrono::steady_clock> Timer::localEnd;
+std::chrono::time_point<std::chrono::steady_clock> Timer::frameStart;
+std::chrono::time_point<std::chrono::steady_clock> Timer::frameEnd;
 std::chrono::duration<float> Timer::elapsedTime;
 std::chrono::duration<float> Timer::frameTime;
 int Timer::frameRate;
 
 float Timer::GetFrameTime(void) { return frameTime.count(); }
 float Timer::GetElapsedTime(void) { return elapsedTime.count(); }
-float Timer::GetTotalTime(void){ return (std::chrono::system_clock::now() - programStart).count(); }
+float Timer::GetTotalTime(void){ return std::chrono::duration<float>(std::chrono::steady_clock::now() - programStart).count(); }
 
 void Timer::Initialize(void)
 {
-	programStart = std::chrono::system_clock::now();
+	programStart = std::chrono::steady_clock::now();
 }
 
 void Timer::Start(void)
 {
-	localStart = std::chrono::system_clock::now();
+	localStart = std::chrono::steady_clock::now();
 }
 
 void Timer::StartFrame(void)
 {
-	frameStart = std::chrono::system_clock::now();
+	frameStart = std::chrono::steady_clock::now();
 }
 
 void Timer::Stop(void)
 {
-	localEnd = std::chrono::system_clock::now();
+	localEnd = std::chrono::steady_clock::now();
 
 	elapsedTime = localEnd - localStart;
 }
 
 void Timer::StopFrame(void)
 {
-	frameEnd = std::chrono::system_clock::now();
+	frameEnd = std::chrono::steady_clock::now();
 
 	frameTime = frameEnd - frameStart;
 }
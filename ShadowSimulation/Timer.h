@@ -7,7 +7,7 @@
 //
 
 #ifndef TIMER_H
-#define TIME_H
+#define TIMER_H
 
 #include <chrono>
 
@@ -34,15 +34,15 @@ public:
 	// Returns the total time since the program began
 	static float GetTotalTime(void);
 private:
-	static std::chrono::time_point<std::chrono::system_clock> programStart;
+	static std::chrono::time_point<std::chrono::steady_clock> programStart;
 
-	static std::chrono::time_point<std::chrono::system_clock> frameStart;
-	static std::chrono::time_point<std::chrono::system_clock> frameEnd;
+	static std::chrono::time_point<std::chrono::steady_clock> frameStart;
+	static std::chrono::time_point<std::chrono::steady_clock> frameEnd;
 
 	static std::chrono::duration<float> frameTime;
 
-	static std::chrono::time_point<std::chrono::system_clock> localStart;
-	static std::chrono::time_point<std::chrono::system_clock> localEnd;
+	static std::chrono::time_point<std::chrono::steady_clock> localStart;
+	static std::chrono::time_point<std::chrono::steady_clock> localEnd;
 
 	static std::chrono::duration<float> elapsedTime;
 
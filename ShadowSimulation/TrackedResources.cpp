@@ -0,0 +1,165 @@
+//
+// Creates device objects and reports them to the MemoryRegistry, tagged with a category and an owner
+//
+
+#include "TrackedResources.h"
+
+// Identifies the record among an object's private data
+// {5B3C7E21-94A8-4D2F-B1E6-0C9D4A7F3285}
+static const GUID TrackedAllocationGuid = { 0x5b3c7e21, 0x94a8, 0x4d2f, { 0xb1, 0xe6, 0x0c, 0x9d, 0x4a, 0x7f, 0x32, 0x85 } };
+
+// Held by the tracked object, its last release removes the allocation
+class TrackedAllocation : public IUnknown
+{
+public:
+	TrackedAllocation(AllocationId id) :
+	references(1),
+	id(id)
+	{
+
+	}
+
+	ULONG STDMETHODCALLTYPE AddRef()
+	{
+		return InterlockedIncrement(&references);
+	}
+
+	ULONG STDMETHODCALLTYPE Release()
+	{
+		ULONG left = InterlockedDecrement(&references);
+		if (left == 0)
+		{
+			MemoryRegistry::Global().Remove(id);
+			delete this;
+		}
+		return left;
+	}
+
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object)
+	{
+		if (riid == __uuidof(IUnknown))
+		{
+			*object = this;
+			AddRef();
+			return S_OK;
+		}
+		*object = NULL;
+		return E_NOINTERFACE;
+	}
+private:
+	volatile LONG references;
+	AllocationId id;
+};
+
+static MemoryCategory GetBufferCategory(UINT bindFlags)
+{
+	if (bindFlags & D3D11_BIND_VERTEX_BUFFER)
+		return MemoryVertexBuffer;
+	if (bindFlags & D3D11_BIND_INDEX_BUFFER)
+		return MemoryIndexBuffer;
+	if (bindFlags & D3D11_BIND_CONSTANT_BUFFER)
+		return MemoryConstantBuffer;
+	return MemoryBuffer;
+}
+
+static MemoryCategory GetTextureCategory(UINT bindFlags)
+{
+	if (bindFlags & D3D11_BIND_DEPTH_STENCIL)
+		return MemoryDepthStencil;
+	if (bindFlags & D3D11_BIND_RENDER_TARGET)
+		return MemoryRenderTarget;
+	return MemoryTexture;
+}
+
+HRESULT TrackedResources::CreateBuffer(ID3D11Device* dev, const D3D11_BUFFER_DESC* desc, const D3D11_SUBRESOURCE_DATA* data, const char* owner,
+	ID3D11Buffer** buffer)
+{
+	HRESULT hr = dev->CreateBuffer(desc, data, buffer);
+	if (SUCCEEDED(hr))
+		Track(*buffer, GetBufferCategory(desc->BindFlags), owner, desc->ByteWidth);
+	return hr;
+}
+
+HRESULT TrackedResources::CreateTexture2D(ID3D11Device* dev, const D3D11_TEXTURE2D_DESC* desc, const D3D11_SUBRESOURCE_DATA* data, const char* owner,
+	ID3D11Texture2D** texture)
+{
+	HRESULT hr = dev->CreateTexture2D(desc, data, texture);
+	if (SUCCEEDED(hr))
+	{
+		Track(*texture, GetTextureCategory(desc->BindFlags), owner, MemoryRegistry::GetTextureBytes(desc->Width, desc->Height, 1,
+			desc->MipLevels, desc->ArraySize, desc->SampleDesc.Count, desc->Format));
+	}
+	return hr;
+}
+
+HRESULT TrackedResources::CreateShaderResourceView(ID3D11Device* dev, ID3D11Resource* resource, const D3D11_SHADER_RESOURCE_VIEW_DESC* desc,
+	const char* owner, ID3D11ShaderResourceView** view)
+{
+	HRESULT hr = dev->CreateShaderResourceView(resource, desc, view);
+	if (SUCCEEDED(hr))
+		Track(*view, MemoryView, owner, 0);
+	return hr;
+}
+
+HRESULT TrackedResources::CreateRenderTargetView(ID3D11Device* dev, ID3D11Resource* resource, const D3D11_RENDER_TARGET_VIEW_DESC* desc,
+	const char* owner, ID3D11RenderTargetView** view)
+{
+	HRESULT hr = dev->CreateRenderTargetView(resource, desc, view);
+	if (SUCCEEDED(hr))
+		Track(*view, MemoryView, owner, 0);
+	return hr;
+}
+
+HRESULT TrackedResources::CreateDepthStencilView(ID3D11Device* dev, ID3D11Resource* resource, const D3D11_DEPTH_STENCIL_VIEW_DESC* desc,
+	const char* owner, ID3D11DepthStencilView** view)
+{
+	HRESULT hr = dev->CreateDepthStencilView(resource, desc, view);
+	if (SUCCEEDED(hr))
+		Track(*view, MemoryView, owner, 0);
+	return hr;
+}
+
+void TrackedResources::Track(ID3D11DeviceChild* object, MemoryCategory category, const char* owner, UINT64 bytes)
+{
+	if (!object)
+		return;
+
+	// The object keeps its own reference, if it won't take one the allocation goes straight away
+	TrackedAllocation* allocation = new TrackedAllocation(MemoryRegistry::Global().Add(category, owner, bytes));
+	object->SetPrivateDataInterface(TrackedAllocationGuid, allocation);
+	allocation->Release();
+}
+
+void TrackedResources::TrackResource(ID3D11Resource* resource, const char* owner)
+{
+	if (!resource)
+		return;
+
+	MemoryCategory category;
+	UINT64 bytes = GetResourceBytes(resource, category);
+	Track(resource, category, owner, bytes);
+}
+
+UINT64 TrackedResources::GetResourceBytes(ID3D11Resource* resource, MemoryCategory& category)
+{
+	D3D11_RESOURCE_DIMENSION dimension;
+	resource->GetType(&dimension);
+	if (dimension == D3D11_RESOURCE_DIMENSION_BUFFER)
+	{
+		D3D11_BUFFER_DESC desc;
+		static_cast<ID3D11Buffer*>(resource)->GetDesc(&desc);
+		category = GetBufferCategory(desc.BindFlags);
+		return desc.ByteWidth;
+	}
+	if (dimension == D3D11_RESOURCE_DIMENSION_TEXTURE2D)
+	{
+		D3D11_TEXTURE2D_DESC desc;
+		static_cast<ID3D11Texture2D*>(resource)->GetDesc(&desc);
+		category = GetTextureCategory(desc.BindFlags);
+		return MemoryRegistry::GetTextureBytes(desc.Width, desc.Height, 1, desc.MipLevels, desc.ArraySize, desc.SampleDesc.Count, desc.Format);
+	}
+
+	// Nothing here makes 1D or 3D textures
+	category = MemoryTexture;
+	return 0;
+}
@@ -0,0 +1,47 @@
+//
+// Creates device objects and reports them to the MemoryRegistry, tagged with a category and an owner
+// Each tracked object carries a small record as private data, the device lets go of it when the object is destroyed and
+// that takes the allocation out of the registry, so objects are released the usual way
+//
+
+#ifndef TRACKEDRESOURCES_H
+#define TRACKEDRESOURCES_H
+
+#include <d3d11.h>
+#include "MemoryRegistry.h"
+
+class TrackedResources
+{
+public:
+	/// <summary>Vertex, index and constant buffers are told apart by their bind flags
+	/// </summary>
+	static HRESULT CreateBuffer(ID3D11Device* dev, const D3D11_BUFFER_DESC* desc, const D3D11_SUBRESOURCE_DATA* data, const char* owner,
+		ID3D11Buffer** buffer);
+
+	/// <summary>Depth stencil and render target textures are counted apart from the rest
+	/// </summary>
+	static HRESULT CreateTexture2D(ID3D11Device* dev, const D3D11_TEXTURE2D_DESC* desc, const D3D11_SUBRESOURCE_DATA* data, const char* owner,
+		ID3D11Texture2D** texture);
+
+	static HRESULT CreateShaderResourceView(ID3D11Device* dev, ID3D11Resource* resource, const D3D11_SHADER_RESOURCE_VIEW_DESC* desc,
+		const char* owner, ID3D11ShaderResourceView** view);
+	static HRESULT CreateRenderTargetView(ID3D11Device* dev, ID3D11Resource* resource, const D3D11_RENDER_TARGET_VIEW_DESC* desc,
+		const char* owner, ID3D11RenderTargetView** view);
+	static HRESULT CreateDepthStencilView(ID3D11Device* dev, ID3D11Resource* resource, const D3D11_DEPTH_STENCIL_VIEW_DESC* desc,
+		const char* owner, ID3D11DepthStencilView** view);
+
+	/// <summary>Tracks an object created elsewhere, like a shader or the swap chain's back buffer
+	/// Tracking an object again replaces its earlier record
+	/// </summary>
+	static void Track(ID3D11DeviceChild* object, MemoryCategory category, const char* owner, UINT64 bytes);
+
+	/// <summary>Tracks a buffer or texture made by a loader, its size and category come from its description
+	/// </summary>
+	static void TrackResource(ID3D11Resource* resource, const char* owner);
+
+	/// <summary>Bytes a buffer or texture takes on the device, every mip and sample included
+	/// </summary>
+	static UINT64 GetResourceBytes(ID3D11Resource* resource, MemoryCategory& category);
+};
+
+#endif
@@ -6,7 +6,9 @@
 #ifndef VERTEX_H
 #define VERTEX_H
 
+#include <cstddef>
 #include <DirectXMath.h>
+#include "ShaderReflection.h"
 using namespace DirectX;
 
 #define PI 3.14159265359f
@@ -21,4 +23,63 @@ struct Vertex
 	XMFLOAT3 Normal;
 	XMFLOAT3 Tangent;
 };
+
+/// <summary>Axis aligned box around a mesh in its own space
+/// </summary>
+struct MeshBounds
+{
+	XMFLOAT3 center;
+	XMFLOAT3 extents;	// Half the size along each axis
+};
+
+/// <summary>Range of a mesh's index buffer drawn at one level of detail, every level indexes the same vertices
+/// </summary>
+struct MeshLOD
+{
+	UINT indexStart;
+	UINT indexCount;
+	float error;		// Farthest the level strays from the full mesh, in the mesh's own units
+};
+
+/// <summary>Where each Vertex member sits, input layouts are built from this and the vertex shader's signature
+/// </summary>
+static const VertexAttribute VertexAttributes[] =
+{
+	{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, offsetof(Vertex, Position) },
+	{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, offsetof(Vertex, Color) },
+	{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, offsetof(Vertex, UV) },
+	{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, offsetof(Vertex, Normal) },
+	{ "TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, offsetof(Vertex, Tangent) }
+};
+
+static const VertexFormat VertexFormatDefault = { "Vertex", VertexAttributes, sizeof(VertexAttributes) / sizeof(VertexAttribute), sizeof(Vertex) };
+
+/// <summary>Joints moving a vertex and how much each one counts, weights add up to 1 and unused ones are 0
+/// </summary>
+struct SkinInfluences
+{
+	BYTE joints[4];
+	float weights[4];
+};
+
+/// <summary>Vertex of a skinned mesh, drawn through SkinnedVertex.hlsl
+/// </summary>
+struct SkinnedVertex
+{
+	Vertex vertex;
+	SkinInfluences skin;
+};
+
+static const VertexAttribute SkinnedVertexAttributes[] =
+{
+	{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, offsetof(SkinnedVertex, vertex.Position) },
+	{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, offsetof(SkinnedVertex, vertex.Color) },
+	{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, offsetof(SkinnedVertex, vertex.UV) },
+	{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, offsetof(SkinnedVertex, vertex.Normal) },
+	{ "TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, offsetof(SkinnedVertex, vertex.Tangent) },
+	{ "BLENDINDICES", 0, DXGI_FORMAT_R8G8B8A8_UINT, offsetof(SkinnedVertex, skin.joints) },
+	{ "BLENDWEIGHT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, offsetof(SkinnedVertex, skin.weights) }
+};
+
+static const VertexFormat VertexFormatSkinned = { "SkinnedVertex", SkinnedVertexAttributes, sizeof(SkinnedVertexAttributes) / sizeof(VertexAttribute), sizeof(SkinnedVertex) };
 #endif
\ No newline at end of file
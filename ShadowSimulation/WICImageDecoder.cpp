@@ -0,0 +1,56 @@
+//
+// Image decoder backed by WIC, reads anything Windows has a codec for
+// Put it after the portable decoders, it claims every format. COM must be initialized on the calling thread
+//
+
+#include "WICImageDecoder.h"
+
+#include <climits>
+#include <wincodec.h>
+
+#include "Game.h"
+
+bool WICImageDecoder::CanDecode(const BYTE* data, size_t size) const
+{
+	return size > 0;
+}
+
+const char* WICImageDecoder::GetName() const
+{
+	return "WIC";
+}
+
+bool WICImageDecoder::Decode(const BYTE* data, size_t size, ImageData& image) const
+{
+	if (size > UINT_MAX)
+		return false;
+
+	IWICImagingFactory* factory = NULL;
+	if (FAILED(CoCreateInstance(CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory))))
+		return false;
+
+	IWICStream* stream = NULL;
+	IWICBitmapDecoder* decoder = NULL;
+	IWICBitmapFrameDecode* frame = NULL;
+	IWICFormatConverter* converter = NULL;
+
+	bool loaded = false;
+	if (SUCCEEDED(factory->CreateStream(&stream)) &&
+		SUCCEEDED(stream->InitializeFromMemory(const_cast<BYTE*>(data), (DWORD)size)) &&
+		SUCCEEDED(factory->CreateDecoderFromStream(stream, NULL, WICDecodeMetadataCacheOnDemand, &decoder)) &&
+		SUCCEEDED(decoder->GetFrame(0, &frame)) &&
+		SUCCEEDED(frame->GetSize(&image.width, &image.height)) &&
+		SUCCEEDED(factory->CreateFormatConverter(&converter)) &&
+		SUCCEEDED(converter->Initialize(frame, GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, NULL, 0.0, WICBitmapPaletteTypeCustom)))
+	{
+		image.rgba.resize((size_t)image.width * image.height * 4);
+		loaded = SUCCEEDED(converter->CopyPixels(NULL, image.width * 4, (UINT)image.rgba.size(), &image.rgba[0]));
+	}
+
+	ReleaseMacro(converter);
+	ReleaseMacro(frame);
+	ReleaseMacro(decoder);
+	ReleaseMacro(stream);
+	ReleaseMacro(factory);
+	return loaded;
+}
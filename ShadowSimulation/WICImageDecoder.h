@@ -0,0 +1,21 @@
+//
+// Image decoder backed by WIC, reads anything Windows has a codec for
+// Put it after the portable decoders, it claims every format. COM must be initialized on the calling thread
+//
+
+#ifndef WICIMAGEDECODER_H
+#define WICIMAGEDECODER_H
+
+#include "ImageDecoder.h"
+
+class WICImageDecoder : public ImageDecoder
+{
+public:
+	bool CanDecode(const BYTE* data, size_t size) const;
+
+	bool Decode(const BYTE* data, size_t size, ImageData& image) const;
+
+	const char* GetName() const;
+};
+
+#endif
@@ -0,0 +1,217 @@
+//
+// Streaming against a fake backend: upload budgets, the memory cap, priorities, and backend calls made without the
+// streamer's lock
+//
+
+#include "Test.h"
+#include "AssetStreamer.h"
+
+// Payloads of a set size per asset, uploads take expansion times the payload
+class FakeBackend : public StreamBackend
+{
+public:
+	FakeBackend() :
+	streamer(NULL),
+	expansion(1)
+	{
+
+	}
+
+	bool Load(AssetId id, std::vector<BYTE>& payload)
+	{
+		if (sizes[id] == 0)
+			return false;
+		payload.assign(sizes[id], (BYTE)id);
+		return true;
+	}
+
+	UINT64 Upload(AssetId id, const std::vector<BYTE>& payload)
+	{
+		// Would deadlock if the streamer still held its lock
+		CHECK_EQUAL(AssetUploading, streamer->GetState(id));
+		uploads.push_back(id);
+		return payload.size() * expansion;
+	}
+
+	void Evict(AssetId id)
+	{
+		CHECK_EQUAL(AssetEvicted, streamer->GetState(id));
+		evictions.push_back(id);
+	}
+
+	AssetStreamer* streamer;
+	std::vector<UINT> sizes;	// Set before the streamer starts, 0 fails to load
+	UINT64 expansion;
+	std::vector<AssetId> uploads;
+	std::vector<AssetId> evictions;
+};
+
+/// <summary>Waits for the workers to finish loading every asset, false if they take over a few seconds
+/// </summary>
+static bool WaitForLoads(const AssetStreamer& streamer, UINT count)
+{
+	for (UINT attempt = 0; attempt < 5000; attempt++)
+	{
+		UINT busy = 0;
+		for (AssetId id = 0; id < count; id++)
+		{
+			AssetState state = streamer.GetState(id);
+			busy += (state == AssetQueued || state == AssetLoading) ? 1 : 0;
+		}
+		if (busy == 0)
+			return true;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return false;
+}
+
+TEST(AssetStreamerSpendsUploadBudgetByPriority)
+{
+	FakeBackend backend;
+	AssetStreamer streamer(&backend);
+	backend.streamer = &streamer;
+	backend.sizes.assign(5, 100);
+	const float priorities[] = { 2.0f, 5.0f, 1.0f, 4.0f, 3.0f };
+	for (float priority : priorities)
+		streamer.Add(priority);
+	streamer.Start(2);
+	REQUIRE(WaitForLoads(streamer, 5));
+	CHECK(!streamer.IsIdle());
+
+	// Stops once the budget is spent, the upload that crosses it still goes
+	CHECK_EQUAL(3u, streamer.Update(250));
+	REQUIRE(backend.uploads.size() == 3);
+	CHECK_EQUAL(1u, backend.uploads[0]);
+	CHECK_EQUAL(3u, backend.uploads[1]);
+	CHECK_EQUAL(4u, backend.uploads[2]);
+
+	// Always at least one, even without budget
+	CHECK_EQUAL(1u, streamer.Update(0));
+	CHECK_EQUAL(1u, streamer.Update(0));
+	CHECK_EQUAL(0u, streamer.Update(0));
+	CHECK_EQUAL(500u, streamer.GetResidentBytes());
+	CHECK_EQUAL(0u, streamer.GetPendingBytes());
+	CHECK(streamer.IsIdle());
+	CHECK(backend.evictions.empty());
+}
+
+TEST(AssetStreamerLoadsInlineWithoutWorkers)
+{
+	FakeBackend backend;
+	AssetStreamer streamer(&backend);
+	backend.streamer = &streamer;
+	backend.sizes.push_back(10);
+	backend.sizes.push_back(0);
+	streamer.Add(1.0f);
+	streamer.Add(2.0f);
+
+	// One load per update, the failed asset first since it ranks higher
+	CHECK_EQUAL(0u, streamer.Update(1000));
+	CHECK_EQUAL(AssetFailed, streamer.GetState(1));
+	CHECK_EQUAL(1u, streamer.Update(1000));
+	CHECK_EQUAL(AssetResident, streamer.GetState(0));
+	CHECK(streamer.IsIdle());
+}
+
+TEST(AssetStreamerEvictsLeastImportantToStayUnderCap)
+{
+	FakeBackend backend;
+	AssetStreamer streamer(&backend);
+	backend.streamer = &streamer;
+	backend.sizes.assign(3, 100);
+	streamer.SetMemoryCap(250);
+	streamer.Add(1.0f);
+	streamer.Add(2.0f);
+	streamer.Start(1);
+	REQUIRE(WaitForLoads(streamer, 2));
+	CHECK_EQUAL(2u, streamer.Update(1000));
+
+	// A more important asset pushes out the least important one
+	streamer.Add(3.0f);
+	REQUIRE(WaitForLoads(streamer, 3));
+	CHECK_EQUAL(1u, streamer.Update(1000));
+	REQUIRE(backend.evictions.size() == 1);
+	CHECK_EQUAL(0u, backend.evictions[0]);
+	CHECK_EQUAL(AssetEvicted, streamer.GetState(0));
+	CHECK_EQUAL(200u, streamer.GetResidentBytes());
+
+	// Evicted assets only come back once they clearly outrank something resident
+	streamer.SetPriority(0, 2.5f);
+	streamer.Update(1000);
+	CHECK_EQUAL(AssetEvicted, streamer.GetState(0));
+	streamer.SetPriority(0, 3.5f);
+	streamer.Update(1000);
+	REQUIRE(WaitForLoads(streamer, 3));
+	streamer.Update(1000);
+	CHECK_EQUAL(AssetResident, streamer.GetState(0));
+	CHECK_EQUAL(AssetEvicted, streamer.GetState(1));
+	CHECK(streamer.GetResidentBytes() <= 250u);
+}
+
+TEST(AssetStreamerSendsBackAssetsThatExpandPastCap)
+{
+	FakeBackend backend;
+	AssetStreamer streamer(&backend);
+	backend.streamer = &streamer;
+	backend.sizes.assign(2, 100);
+	backend.expansion = 3;
+	streamer.SetMemoryCap(500);
+	streamer.Add(2.0f);
+	streamer.Add(1.0f);
+	streamer.Start(1);
+	REQUIRE(WaitForLoads(streamer, 2));
+
+	// The second one estimated 100 bytes but took 300, and nothing less important can make room for it
+	CHECK_EQUAL(2u, streamer.Update(1000));
+	CHECK_EQUAL(AssetResident, streamer.GetState(0));
+	CHECK_EQUAL(AssetEvicted, streamer.GetState(1));
+	REQUIRE(backend.evictions.size() == 1);
+	CHECK_EQUAL(1u, backend.evictions[0]);
+	CHECK_EQUAL(300u, streamer.GetResidentBytes());
+}
+
+TEST(AssetStreamerEvictsNothingForAnAssetThatCantFit)
+{
+	FakeBackend backend;
+	AssetStreamer streamer(&backend);
+	backend.streamer = &streamer;
+	backend.sizes.push_back(40);
+	backend.sizes.push_back(40);
+	backend.sizes.push_back(90);
+	backend.sizes.push_back(10);
+	streamer.SetMemoryCap(100);
+	streamer.Add(1.0f);
+	streamer.Add(2.0f);
+	streamer.Start(1);
+	REQUIRE(WaitForLoads(streamer, 2));
+	CHECK_EQUAL(2u, streamer.Update(1000));
+
+	// Evicting the less important asset would only free 40 of the 70 bytes needed, so it stays, and the big asset
+	// doesn't hold up the small one behind it
+	streamer.Add(1.5f);
+	streamer.Add(0.5f);
+	REQUIRE(WaitForLoads(streamer, 4));
+	CHECK_EQUAL(1u, streamer.Update(1000));
+	CHECK(backend.evictions.empty());
+	CHECK_EQUAL(AssetResident, streamer.GetState(0));
+	CHECK_EQUAL(AssetResident, streamer.GetState(1));
+	CHECK_EQUAL(AssetEvicted, streamer.GetState(2));
+	CHECK_EQUAL(AssetResident, streamer.GetState(3));
+	CHECK_EQUAL(90u, streamer.GetResidentBytes());
+	CHECK_EQUAL(0u, streamer.GetPendingBytes());
+
+	// Nothing is left waiting, and it isn't requeued while room still can't be made
+	for (UINT i = 0; i < 10; i++)
+		streamer.Update(1000);
+	CHECK(streamer.IsIdle());
+	CHECK_EQUAL(AssetEvicted, streamer.GetState(2));
+	CHECK_EQUAL(3u, (UINT)backend.uploads.size());
+
+	// Once it outranks everything else it comes back and they make room
+	streamer.SetPriority(2, 5.0f);
+	streamer.Update(1000);
+	REQUIRE(WaitForLoads(streamer, 4));
+	streamer.Update(1000);
+	CHECK_EQUAL(AssetResident, streamer.GetState(2));
+	CHECK(streamer.GetResidentBytes() <= 100u);
+}
@@ -0,0 +1,155 @@
+//
+// Skyline packing: placements stay on the page, on the alignment grid and apart, and fill the page when the sizes allow
+//
+
+#include "Test.h"
+#include "AtlasPacker.h"
+
+static bool Overlap(const AtlasRect& a, const AtlasRect& b)
+{
+	return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+/// <summary>Checks rect against the page and everything already placed on it, then adds it
+/// </summary>
+static bool Place(const AtlasPacker& packer, std::vector<AtlasRect>& placed, const AtlasRect& rect, UINT alignment)
+{
+	bool valid = rect.x + rect.width <= packer.GetWidth() && rect.y + rect.height <= packer.GetHeight() &&
+		rect.x % alignment == 0 && rect.y % alignment == 0;
+	for (const AtlasRect& other : placed)
+		valid = valid && !Overlap(rect, other);
+	placed.push_back(rect);
+	return valid;
+}
+
+TEST(AtlasPackerFillsPageExactly)
+{
+	AtlasPacker packer(512, 512, 1);
+	std::vector<AtlasRect> placed;
+	for (UINT i = 0; i < 4; i++)
+	{
+		AtlasRect rect;
+		REQUIRE(packer.Insert(256, 256, rect));
+		CHECK(Place(packer, placed, rect, 1));
+	}
+	CHECK_EQUAL(1.0f, packer.GetOccupancy());
+
+	AtlasRect full;
+	CHECK(!packer.Insert(1, 1, full));
+}
+
+TEST(AtlasPackerRoundsToAlignment)
+{
+	AtlasPacker packer(256, 256, 8);
+	AtlasRect first, second;
+	REQUIRE(packer.Insert(10, 3, first));
+	CHECK_EQUAL(16u, first.width);
+	CHECK_EQUAL(8u, first.height);
+	REQUIRE(packer.Insert(17, 9, second));
+	CHECK_EQUAL(16u, second.x);
+	CHECK_EQUAL(0u, second.y);
+	CHECK_EQUAL(24u, second.width);
+	CHECK_EQUAL(16u, second.height);
+	CHECK_NEAR((16.0 * 8 + 24 * 16) / (256.0 * 256), packer.GetOccupancy(), 1e-6);
+
+	AtlasRect rounded;
+	REQUIRE(packer.Insert(250, 1, rounded));
+	CHECK_EQUAL(256u, rounded.width);
+	CHECK_EQUAL(16u, rounded.y);
+
+	// Rounding up can push a size that would fit past the page
+	AtlasPacker small(20, 20, 8);
+	CHECK(!small.Insert(20, 20, rounded));
+}
+
+TEST(AtlasPackerRejectsWhatCannotFit)
+{
+	AtlasPacker packer(128, 64, 1);
+	AtlasRect rect;
+	CHECK(!packer.Insert(0, 10, rect));
+	CHECK(!packer.Insert(10, 0, rect));
+	CHECK(!packer.Insert(129, 1, rect));
+	CHECK(!packer.Insert(1, 65, rect));
+	CHECK_EQUAL(0.0f, packer.GetOccupancy());
+
+	REQUIRE(packer.Insert(128, 40, rect));
+	CHECK(!packer.Insert(10, 25, rect));
+	CHECK(packer.Insert(10, 24, rect));
+	CHECK_EQUAL(40u, rect.y);
+}
+
+TEST(AtlasPackerPlacesWhereTopEndsLowest)
+{
+	// A tall column on the left, a short rectangle goes beside it on the floor rather than on top
+	AtlasPacker packer(300, 300, 1);
+	AtlasRect tall, beside, onTop;
+	REQUIRE(packer.Insert(100, 250, tall));
+	REQUIRE(packer.Insert(100, 100, beside));
+	CHECK_EQUAL(100u, beside.x);
+	CHECK_EQUAL(0u, beside.y);
+
+	// Too wide for the floor that's left, it rests on the shorter of the two
+	REQUIRE(packer.Insert(200, 150, onTop));
+	CHECK_EQUAL(100u, onTop.x);
+	CHECK_EQUAL(100u, onTop.y);
+}
+
+TEST(AtlasPackerPacksPowerOfTwoSquaresWithoutWaste)
+{
+	// Largest first, power of two squares that add up to the page leave no holes
+	std::mt19937 random(3);
+	for (UINT trial = 0; trial < 20; trial++)
+	{
+		std::vector<UINT> sizes;
+		UINT64 area = 0;
+		while (area < 512 * 512)
+		{
+			UINT size = 16u << (random() % 5);
+			if (area + (UINT64)size * size > 512 * 512)
+				size = 16;
+			sizes.push_back(size);
+			area += (UINT64)size * size;
+		}
+		std::sort(sizes.rbegin(), sizes.rend());
+
+		AtlasPacker packer(512, 512, 16);
+		std::vector<AtlasRect> placed;
+		bool valid = true;
+		for (UINT size : sizes)
+		{
+			AtlasRect rect;
+			REQUIRE(packer.Insert(size, size, rect));
+			valid = valid && Place(packer, placed, rect, 16);
+		}
+		CHECK(valid);
+		CHECK_EQUAL(1.0f, packer.GetOccupancy());
+	}
+}
+
+TEST(AtlasPackerNeverOverlaps)
+{
+	std::mt19937 random(11);
+	for (UINT alignment : { 1u, 4u, 8u })
+	{
+		for (UINT trial = 0; trial < 20; trial++)
+		{
+			AtlasPacker packer(512, 512, alignment);
+			std::vector<AtlasRect> placed;
+			UINT64 area = 0;
+			bool valid = true;
+			for (UINT i = 0; i < 200; i++)
+			{
+				UINT width = 1 + random() % 120;
+				UINT height = 1 + random() % 120;
+				AtlasRect rect;
+				if (!packer.Insert(width, height, rect))
+					continue;
+				valid = valid && rect.width >= width && rect.height >= height && rect.width - width < alignment &&
+					rect.height - height < alignment && Place(packer, placed, rect, alignment);
+				area += (UINT64)rect.width * rect.height;
+			}
+			CHECK(valid);
+			CHECK_NEAR((double)area / (512.0 * 512.0), packer.GetOccupancy(), 1e-6);
+		}
+	}
+}
@@ -0,0 +1,104 @@
+//
+// Benchmark runs: scenes reproduce from their seed and nothing is measured until streaming settles
+//
+
+#include "Test.h"
+#include "BenchmarkRunner.h"
+#include "SceneGenerator.h"
+
+// Field by field, the padding after dynamic isn't initialized
+static bool SameObjects(const GeneratedScene& a, const GeneratedScene& b)
+{
+	if (a.objects.size() != b.objects.size())
+		return false;
+	for (size_t i = 0; i < a.objects.size(); i++)
+	{
+		const GeneratedObject& x = a.objects[i];
+		const GeneratedObject& y = b.objects[i];
+		if (x.mesh != y.mesh || x.dynamic != y.dynamic || memcmp(&x.position, &y.position, sizeof(XMFLOAT3)) != 0 ||
+			memcmp(&x.rotation, &y.rotation, sizeof(XMFLOAT3)) != 0 || memcmp(&x.scale, &y.scale, sizeof(XMFLOAT3)) != 0 ||
+			memcmp(&x.angularVelocity, &y.angularVelocity, sizeof(XMFLOAT3)) != 0)
+			return false;
+	}
+	return true;
+}
+
+TEST(SceneGeneratorReproducesFromSeed)
+{
+	SceneDesc desc;
+	desc.objectCount = 500;
+	desc.meshCount = 4;
+	GeneratedScene a, b, other;
+	SceneGenerator::Generate(desc, a);
+	SceneGenerator::Generate(desc, b);
+	desc.seed = 2;
+	SceneGenerator::Generate(desc, other);
+
+	REQUIRE(a.objects.size() == 500);
+	CHECK(SameObjects(a, b));
+	CHECK(memcmp(&a.lights[0], &b.lights[0], a.lights.size() * sizeof(GeneratedLight)) == 0);
+	CHECK(memcmp(&a.cameraPath[0], &b.cameraPath[0], a.cameraPath.size() * sizeof(XMFLOAT3)) == 0);
+	CHECK(!SameObjects(a, other));
+
+	UINT dynamic = 0;
+	for (const GeneratedObject& obj : a.objects)
+	{
+		CHECK(obj.mesh < desc.meshCount);
+		dynamic += obj.dynamic ? 1 : 0;
+	}
+	CHECK(dynamic > 75 && dynamic < 175);
+}
+
+TEST(BenchmarkRunnerWaitsForStreaming)
+{
+	BenchmarkRunner runner;
+	REQUIRE(runner.ParseCommandLine("-benchmark frames=10 warmup=2"));
+
+	// However long streaming takes, the flythrough hasn't started
+	for (UINT i = 0; i < 50; i++)
+	{
+		CHECK(runner.IsSettling());
+		CHECK_EQUAL(0.0f, runner.GetProgress());
+		CHECK(!runner.EndFrame(FrameStats(), false));
+	}
+	CHECK(!runner.EndFrame(FrameStats(), true));
+	CHECK(!runner.IsSettling());
+	CHECK_EQUAL(0.0f, runner.GetProgress());
+
+	// Then warmup, then the measured frames, the last of which ends the run
+	UINT frames = 0;
+	while (!runner.EndFrame(FrameStats(), false))
+		frames++;
+	CHECK_EQUAL(11u, frames);
+}
+
+TEST(BenchmarkRunnerSkipsExactlyWarmup)
+{
+	// warmup frames are dropped and every frame after them counts, so the run ends on frame warmup + frames
+	const UINT warmups[] = { 0, 1, 3 };
+	for (UINT warmup : warmups)
+	{
+		BenchmarkRunner runner;
+		std::string args = "-benchmark frames=4 warmup=" + std::to_string(warmup);
+		REQUIRE(runner.ParseCommandLine(args.c_str()));
+		runner.EndFrame(FrameStats(), true);
+
+		UINT frames = 1;
+		while (!runner.EndFrame(FrameStats(), false) && frames < 100)
+			frames++;
+		CHECK_EQUAL(warmup + 4, frames);
+		CHECK_EQUAL(1.0f, runner.GetProgress());
+	}
+}
+
+TEST(BenchmarkRunnerGivesUpSettlingAfterLimit)
+{
+	BenchmarkRunner runner;
+	REQUIRE(runner.ParseCommandLine("-benchmark frames=5 warmup=0 settle=20"));
+	for (UINT i = 0; i < 20; i++)
+	{
+		CHECK(runner.IsSettling());
+		runner.EndFrame(FrameStats(), false);
+	}
+	CHECK(!runner.IsSettling());
+}
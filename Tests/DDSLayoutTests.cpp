@@ -0,0 +1,282 @@
+//
+// DDS header parsing and subresource layout, against files the texture cooker writes and headers built by hand
+//
+
+#include "Test.h"
+#include "DDSLayout.h"
+#include "TextureCooker.h"
+
+using namespace DirectX;
+
+static const size_t LegacyBitOffset = sizeof(uint32_t) + sizeof(DDS_HEADER);
+static const size_t ExtendedBitOffset = LegacyBitOffset + sizeof(DDS_HEADER_DXT10);
+
+/// <summary>A gradient with some texel noise, so every block and every mip encodes differently
+/// </summary>
+static ImageData MakeImage(UINT width, UINT height, bool translucent)
+{
+	ImageData image;
+	image.width = width;
+	image.height = height;
+	image.rgba.resize(width * height * 4);
+	UINT seed = 1;
+	for (UINT y = 0; y < height; y++)
+	{
+		for (UINT x = 0; x < width; x++)
+		{
+			seed = seed * 1664525 + 1013904223;
+			BYTE* texel = &image.rgba[(y * width + x) * 4];
+			texel[0] = (BYTE)(x * 255 / width);
+			texel[1] = (BYTE)(y * 255 / height);
+			texel[2] = (BYTE)(seed >> 24);
+			texel[3] = translucent ? (BYTE)((x + y) * 255 / (width + height)) : 255;
+		}
+	}
+	return image;
+}
+
+static std::vector<BYTE> Cook(const ImageData& image, CookFormat format, bool srgb)
+{
+	CookOptions options;
+	options.format = format;
+	options.srgb = srgb;
+	options.threads = 1;
+	std::vector<BYTE> dds;
+	CookStats stats;
+	TextureCooker::Cook(image, options, dds, stats);
+	return dds;
+}
+
+/// <summary>The format the loader would create, from the DX10 header when there is one
+/// </summary>
+static DXGI_FORMAT GetFormat(const DDS_HEADER* header)
+{
+	if ((header->ddspf.flags & DDS_FOURCC) && header->ddspf.fourCC == MAKEFOURCC('D', 'X', '1', '0'))
+		return reinterpret_cast<const DDS_HEADER_DXT10*>(header + 1)->dxgiFormat;
+	return GetDXGIFormat(header->ddspf);
+}
+
+TEST(DDSLayoutParsesCookedHeaders)
+{
+	struct Case
+	{
+		CookFormat format;
+		bool srgb;
+		DXGI_FORMAT expected;
+		size_t bitOffset;
+	};
+	const Case cases[] =
+	{
+		{ CookBC1, false, DXGI_FORMAT_BC1_UNORM, LegacyBitOffset },
+		{ CookBC1, true, DXGI_FORMAT_BC1_UNORM_SRGB, ExtendedBitOffset },
+		{ CookBC3, false, DXGI_FORMAT_BC3_UNORM, LegacyBitOffset },
+		{ CookBC3, true, DXGI_FORMAT_BC3_UNORM_SRGB, ExtendedBitOffset },
+		{ CookBC5, false, DXGI_FORMAT_BC5_UNORM, LegacyBitOffset },
+		{ CookBC5, true, DXGI_FORMAT_BC5_UNORM, LegacyBitOffset }	// Normals are never sRGB
+	};
+
+	ImageData image = MakeImage(96, 40, true);
+	for (const Case& test : cases)
+	{
+		std::vector<BYTE> dds = Cook(image, test.format, test.srgb);
+		const DDS_HEADER* header = NULL;
+		size_t bitOffset = 0;
+		REQUIRE(ParseDDSHeader(&dds[0], dds.size(), &header, &bitOffset));
+		CHECK_EQUAL(test.bitOffset, bitOffset);
+		CHECK_EQUAL(96u, header->width);
+		CHECK_EQUAL(40u, header->height);
+		CHECK_EQUAL(7u, header->mipMapCount);
+		CHECK_EQUAL((int)test.expected, (int)GetFormat(header));
+	}
+}
+
+TEST(DDSLayoutFullChainMatchesCookedMips)
+{
+	// Non power of two, so the small mips round up to whole blocks
+	ImageData image = MakeImage(100, 36, false);
+	std::vector<BYTE> dds = Cook(image, CookBC1, false);
+	const DDS_HEADER* header = NULL;
+	size_t bitOffset = 0;
+	REQUIRE(ParseDDSHeader(&dds[0], dds.size(), &header, &bitOffset));
+
+	std::vector<DDSSubresourceLayout> layout(header->mipMapCount);
+	size_t width, height, depth, usedMips;
+	bool truncated;
+	size_t bitSize = dds.size() - bitOffset;
+	REQUIRE(GetDDSSubresourceLayout(header->width, header->height, 1, header->mipMapCount, 1, GetFormat(header), 0, 0, 0, bitSize,
+		&layout[0], width, height, depth, usedMips, truncated));
+	CHECK_EQUAL((size_t)header->mipMapCount, usedMips);
+	CHECK_EQUAL(100u, width);
+	CHECK_EQUAL(36u, height);
+	CHECK(!truncated);
+
+	// The chain ends exactly at the end of the file, and each level holds the blocks the cooker encoded for it
+	const DDSSubresourceLayout& last = layout[usedMips - 1];
+	CHECK_EQUAL(bitSize, last.offset + last.numBytes);
+
+	std::vector<ImageData> mips;
+	TextureCooker::GenerateMips(image, false, MipBox, mips);
+	REQUIRE(mips.size() == usedMips);
+	for (size_t i = 0; i < usedMips; i++)
+	{
+		std::vector<BYTE> blocks;
+		TextureCooker::EncodeBlocks(mips[i], CookBC1, 1, blocks);
+		REQUIRE(blocks.size() == layout[i].numBytes);
+		CHECK(memcmp(&blocks[0], &dds[bitOffset + layout[i].offset], blocks.size()) == 0);
+		CHECK_EQUAL(((mips[i].width + 3) / 4) * 8, layout[i].rowBytes);
+	}
+}
+
+TEST(DDSLayoutSelectsMipRange)
+{
+	std::vector<BYTE> dds = Cook(MakeImage(256, 128, false), CookBC3, false);
+	const DDS_HEADER* header = NULL;
+	size_t bitOffset = 0;
+	REQUIRE(ParseDDSHeader(&dds[0], dds.size(), &header, &bitOffset));
+	size_t bitSize = dds.size() - bitOffset;
+
+	std::vector<DDSSubresourceLayout> full(header->mipMapCount);
+	std::vector<DDSSubresourceLayout> range(header->mipMapCount);
+	size_t width, height, depth, usedMips;
+	bool truncated;
+	REQUIRE(GetDDSSubresourceLayout(256, 128, 1, header->mipMapCount, 1, DXGI_FORMAT_BC3_UNORM, 0, 0, 0, bitSize,
+		&full[0], width, height, depth, usedMips, truncated));
+
+	// Mips 2 to 4 start at 64x32 and point at the same bytes as in the full chain
+	REQUIRE(GetDDSSubresourceLayout(256, 128, 1, header->mipMapCount, 1, DXGI_FORMAT_BC3_UNORM, 0, 2, 3, bitSize,
+		&range[0], width, height, depth, usedMips, truncated));
+	CHECK_EQUAL(3u, usedMips);
+	CHECK_EQUAL(64u, width);
+	CHECK_EQUAL(32u, height);
+	for (size_t i = 0; i < usedMips; i++)
+	{
+		CHECK_EQUAL(full[i + 2].offset, range[i].offset);
+		CHECK_EQUAL(full[i + 2].numBytes, range[i].numBytes);
+	}
+
+	// A range running past the chain is clipped to it
+	REQUIRE(GetDDSSubresourceLayout(256, 128, 1, header->mipMapCount, 1, DXGI_FORMAT_BC3_UNORM, 0, 6, 10, bitSize,
+		&range[0], width, height, depth, usedMips, truncated));
+	CHECK_EQUAL((size_t)header->mipMapCount - 6, usedMips);
+	CHECK_EQUAL(4u, width);
+	CHECK_EQUAL(2u, height);
+
+	// maxsize skips the mips that are too large, the same way the loader drops them
+	REQUIRE(GetDDSSubresourceLayout(256, 128, 1, header->mipMapCount, 1, DXGI_FORMAT_BC3_UNORM, 100, 0, 0, bitSize,
+		&range[0], width, height, depth, usedMips, truncated));
+	CHECK_EQUAL(64u, width);
+	CHECK_EQUAL(full[2].offset, range[0].offset);
+
+	// A range entirely past the chain selects nothing
+	CHECK(!GetDDSSubresourceLayout(256, 128, 1, header->mipMapCount, 1, DXGI_FORMAT_BC3_UNORM, 0, 20, 1, bitSize,
+		&range[0], width, height, depth, usedMips, truncated));
+	CHECK(!truncated);
+}
+
+TEST(DDSLayoutLaysOutArraySlicesOneChainAfterAnother)
+{
+	const size_t mipCount = 4;
+	const size_t arraySize = 3;
+	// 32x32 RGBA8: 4096 + 1024 + 256 + 64 bytes per chain
+	const size_t chainBytes = 5440;
+	std::vector<DDSSubresourceLayout> layout(mipCount * arraySize);
+	size_t width, height, depth, usedMips;
+	bool truncated;
+	REQUIRE(GetDDSSubresourceLayout(32, 32, 1, mipCount, arraySize, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 1, 2, chainBytes * arraySize,
+		&layout[0], width, height, depth, usedMips, truncated));
+	CHECK_EQUAL(2u, usedMips);
+	for (size_t slice = 0; slice < arraySize; slice++)
+	{
+		CHECK_EQUAL(slice * chainBytes + 4096, layout[slice * 2].offset);
+		CHECK_EQUAL(1024u, layout[slice * 2].numBytes);
+		CHECK_EQUAL(64u, layout[slice * 2].rowBytes);
+		CHECK_EQUAL(slice * chainBytes + 5120, layout[slice * 2 + 1].offset);
+	}
+
+	// Volume mips shrink in depth too, every slice of a level is counted
+	std::vector<DDSSubresourceLayout> volume(3);
+	REQUIRE(GetDDSSubresourceLayout(8, 8, 4, 3, 1, DXGI_FORMAT_R8_UNORM, 0, 0, 0, 64 * 4 + 16 * 2 + 4,
+		&volume[0], width, height, depth, usedMips, truncated));
+	CHECK_EQUAL(4u, depth);
+	CHECK_EQUAL(256u, volume[1].offset);
+	CHECK_EQUAL(288u, volume[2].offset);
+}
+
+TEST(DDSLayoutRejectsTruncatedData)
+{
+	std::vector<BYTE> dds = Cook(MakeImage(64, 64, false), CookBC1, true);
+	const DDS_HEADER* header = NULL;
+	size_t bitOffset = 0;
+	REQUIRE(ParseDDSHeader(&dds[0], dds.size(), &header, &bitOffset));
+
+	std::vector<DDSSubresourceLayout> layout(header->mipMapCount);
+	size_t width, height, depth, usedMips;
+	bool truncated;
+	CHECK(!GetDDSSubresourceLayout(64, 64, 1, header->mipMapCount, 1, DXGI_FORMAT_BC1_UNORM_SRGB, 0, 0, 0, dds.size() - bitOffset - 1,
+		&layout[0], width, height, depth, usedMips, truncated));
+	CHECK(truncated);
+
+	// Too short for the headers, the DX10 header or even the magic number
+	CHECK(!ParseDDSHeader(&dds[0], LegacyBitOffset - 1, &header, &bitOffset));
+	CHECK(!ParseDDSHeader(&dds[0], ExtendedBitOffset - 1, &header, &bitOffset));
+	CHECK(!ParseDDSHeader(&dds[0], 0, &header, &bitOffset));
+	CHECK(!ParseDDSHeader(NULL, dds.size(), &header, &bitOffset));
+}
+
+TEST(DDSLayoutRejectsBadHeaders)
+{
+	std::vector<BYTE> dds = Cook(MakeImage(16, 16, false), CookBC1, false);
+	const DDS_HEADER* header = NULL;
+	size_t bitOffset = 0;
+
+	std::vector<BYTE> badMagic = dds;
+	badMagic[0] = 'X';
+	CHECK(!ParseDDSHeader(&badMagic[0], badMagic.size(), &header, &bitOffset));
+
+	std::vector<BYTE> badSize = dds;
+	badSize[sizeof(uint32_t)]++;
+	CHECK(!ParseDDSHeader(&badSize[0], badSize.size(), &header, &bitOffset));
+
+	std::vector<BYTE> badPixelFormat = dds;
+	badPixelFormat[sizeof(uint32_t) + offsetof(DDS_HEADER, ddspf)]++;
+	CHECK(!ParseDDSHeader(&badPixelFormat[0], badPixelFormat.size(), &header, &bitOffset));
+}
+
+TEST(DDSLayoutMapsLegacyPixelFormats)
+{
+	DDS_PIXELFORMAT format = {};
+	format.size = sizeof(DDS_PIXELFORMAT);
+	format.flags = DDS_FOURCC;
+	format.fourCC = MAKEFOURCC('D', 'X', 'T', '1');
+	CHECK_EQUAL((int)DXGI_FORMAT_BC1_UNORM, (int)GetDXGIFormat(format));
+	format.fourCC = MAKEFOURCC('D', 'X', 'T', '5');
+	CHECK_EQUAL((int)DXGI_FORMAT_BC3_UNORM, (int)GetDXGIFormat(format));
+	format.fourCC = MAKEFOURCC('A', 'T', 'I', '2');
+	CHECK_EQUAL((int)DXGI_FORMAT_BC5_UNORM, (int)GetDXGIFormat(format));
+	format.fourCC = MAKEFOURCC('N', 'O', 'P', 'E');
+	CHECK_EQUAL((int)DXGI_FORMAT_UNKNOWN, (int)GetDXGIFormat(format));
+
+	format.flags = DDS_RGBA;
+	format.fourCC = 0;
+	format.RGBBitCount = 32;
+	format.RBitMask = 0x000000ff;
+	format.GBitMask = 0x0000ff00;
+	format.BBitMask = 0x00ff0000;
+	format.ABitMask = 0xff000000;
+	CHECK_EQUAL((int)DXGI_FORMAT_R8G8B8A8_UNORM, (int)GetDXGIFormat(format));
+}
+
+TEST(DDSLayoutSurfaceSizesRoundUpToBlocks)
+{
+	size_t numBytes, rowBytes, numRows;
+	GetSurfaceInfo(1, 1, DXGI_FORMAT_BC1_UNORM, &numBytes, &rowBytes, &numRows);
+	CHECK_EQUAL(8u, numBytes);
+	CHECK_EQUAL(1u, numRows);
+	GetSurfaceInfo(5, 9, DXGI_FORMAT_BC3_UNORM, &numBytes, &rowBytes, &numRows);
+	CHECK_EQUAL(32u, rowBytes);
+	CHECK_EQUAL(3u, numRows);
+	CHECK_EQUAL(96u, numBytes);
+	GetSurfaceInfo(3, 3, DXGI_FORMAT_R8G8B8A8_UNORM, &numBytes, &rowBytes, &numRows);
+	CHECK_EQUAL(12u, rowBytes);
+	CHECK_EQUAL(36u, numBytes);
+}
@@ -0,0 +1,141 @@
+#
+# Writes the PNG fixtures PNGDecoderTests reads, each with the RGBA8 it must decode to
+# Python's zlib compresses them and the expected pixels come straight from the samples, so neither depends on the
+# decoder under test. Run from this directory, the output is the same every time
+#
+
+import random
+import struct
+import zlib
+
+random.seed(7)
+
+ADAM7 = [(0, 0, 8, 8), (4, 0, 8, 8), (0, 4, 4, 8), (2, 0, 4, 4), (0, 2, 2, 4), (1, 0, 2, 2), (0, 1, 1, 2)]
+CHANNELS = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}
+
+
+def chunk(kind, data):
+    return struct.pack('>I', len(data)) + kind + data + struct.pack('>I', zlib.crc32(kind + data) & 0xffffffff)
+
+
+def paeth(a, b, c):
+    p = a + b - c
+    pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+    if pa <= pb and pa <= pc:
+        return a
+    return b if pb <= pc else c
+
+
+def filter_rows(rows, stride, filters):
+    out = b''
+    prior = bytes(len(rows[0]))
+    for y, row in enumerate(rows):
+        kind = filters(y)
+        filtered = bytearray([kind])
+        for i in range(len(row)):
+            a = row[i - stride] if i >= stride else 0
+            b = prior[i]
+            c = prior[i - stride] if i >= stride else 0
+            predicted = [0, a, b, (a + b) // 2, paeth(a, b, c)][kind]
+            filtered.append((row[i] - predicted) & 255)
+        out += bytes(filtered)
+        prior = row
+    return out
+
+
+def pack(samples, depth):
+    if depth == 8:
+        return bytes(samples)
+    if depth == 16:
+        return b''.join(struct.pack('>H', s) for s in samples)
+    bits = ''.join(format(s, '0%db' % depth) for s in samples)
+    bits += '0' * (-len(bits) % 8)
+    return bytes(int(bits[i:i + 8], 2) for i in range(0, len(bits), 8))
+
+
+def make(name, width, height, color_type, depth, interlaced=False, level=6, transparent=False, filters=None,
+         idat_size=1 << 20):
+    channels = CHANNELS[color_type]
+    largest = (1 << depth) - 1
+    palette_size = min(largest + 1, 256) if color_type == 3 else 0
+    pixels = [[[random.randint(0, palette_size - 1 if color_type == 3 else largest) for c in range(channels)]
+               for x in range(width)] for y in range(height)]
+    palette = [(random.randint(0, 255), random.randint(0, 255), random.randint(0, 255)) for i in range(palette_size)]
+    palette_alpha = [random.randint(0, 255) for i in range(palette_size)]
+    key = pixels[0][0][:] if transparent and color_type in (0, 2) else None
+    filters = filters or (lambda y: random.randint(0, 4))
+
+    stride = max(channels * depth // 8, 1)
+
+    def row_bytes(xs, y):
+        return pack([s for x in xs for s in pixels[y][x]], depth)
+
+    raw = b''
+    passes = ADAM7 if interlaced else [(0, 0, 1, 1)]
+    for (x0, y0, step_x, step_y) in passes:
+        xs = list(range(x0, width, step_x))
+        ys = list(range(y0, height, step_y))
+        if xs and ys:
+            raw += filter_rows([row_bytes(xs, y) for y in ys], stride, filters)
+
+    png = b'\x89PNG\r\n\x1a\n' + chunk(b'IHDR', struct.pack('>IIBBBBB', width, height, depth, color_type, 0, 0,
+                                                             1 if interlaced else 0))
+    if color_type == 3:
+        png += chunk(b'PLTE', b''.join(bytes(p) for p in palette))
+        if transparent:
+            png += chunk(b'tRNS', bytes(palette_alpha))
+    if key is not None:
+        png += chunk(b'tRNS', b''.join(struct.pack('>H', k) for k in key))
+    compressed = zlib.compress(raw, level)
+    for i in range(0, len(compressed), idat_size):
+        png += chunk(b'IDAT', compressed[i:i + idat_size])
+    png += chunk(b'IEND', b'')
+    open(name + '.png', 'wb').write(png)
+
+    def scale(value):
+        return value >> 8 if depth == 16 else value * 255 // largest
+
+    expected = bytearray()
+    for y in range(height):
+        for x in range(width):
+            s = pixels[y][x]
+            keyed = 0 if key is not None and s == key else 255
+            if color_type == 3:
+                expected += bytes(palette[s[0]]) + bytes([palette_alpha[s[0]] if transparent else 255])
+            elif color_type == 0:
+                expected += bytes([scale(s[0])] * 3 + [keyed])
+            elif color_type == 4:
+                expected += bytes([scale(s[0])] * 3 + [scale(s[1])])
+            elif color_type == 2:
+                expected += bytes([scale(v) for v in s] + [keyed])
+            else:
+                expected += bytes([scale(v) for v in s])
+    open(name + '.rgba', 'wb').write(bytes(expected))
+
+
+# One file per filter type, every row filtered the same way
+for kind in range(5):
+    make('filter%d' % kind, 19, 7, 2, 8, filters=lambda y, kind=kind: kind)
+
+# Every color type and the depths it allows, rows filtered at random
+make('gray1', 21, 5, 0, 1)
+make('gray2', 13, 6, 0, 2)
+make('gray4', 9, 9, 0, 4, transparent=True)
+make('gray16', 11, 4, 0, 16, transparent=True)
+make('rgb16', 7, 7, 2, 16, transparent=True)
+make('palette1', 17, 3, 3, 1)
+make('palette4', 15, 8, 3, 4, transparent=True)
+make('palette8', 16, 16, 3, 8)
+make('grayalpha8', 10, 10, 4, 8)
+make('grayalpha16', 6, 9, 4, 16)
+make('rgba8', 12, 12, 6, 8)
+make('rgba16', 5, 11, 6, 16)
+
+# Adam7, including images smaller than a pass so some passes are empty
+make('interlaced_rgba8', 37, 23, 6, 8, interlaced=True)
+make('interlaced_palette2', 9, 5, 3, 2, interlaced=True, transparent=True)
+make('interlaced_1x1', 1, 1, 2, 8, interlaced=True)
+
+# Stored deflate blocks, and a stream split over many IDAT chunks
+make('stored', 33, 17, 6, 8, level=0)
+make('split_idat', 40, 30, 2, 8, level=9, idat_size=64)
@@ -0,0 +1,38 @@
+//
+// Sort stage order and the state changes it leaves
+//
+
+#include "Test.h"
+#include "DrawQueue.h"
+
+TEST(DrawQueueSortsByMaterialThenMeshThenLOD)
+{
+	DrawQueue queue;
+	queue.Add(1, 0, 0, 0);
+	queue.Add(0, 2, 1, 1);
+	queue.Add(0, 2, 0, 2);
+	queue.Add(0, 1, 3, 3);
+	queue.Add(1, 0, 0, 4);
+	queue.Sort();
+
+	const UINT expected[] = { 3, 2, 1, 0, 4 };
+	REQUIRE(queue.GetItems().size() == 5);
+	for (UINT i = 0; i < 5; i++)
+		CHECK_EQUAL(expected[i], queue.GetItems()[i].object);
+}
+
+TEST(DrawQueueCountsStateChanges)
+{
+	DrawQueue queue;
+	CHECK_EQUAL(0u, queue.CountStateChanges());
+
+	// Alternating meshes change state every draw until sorted, levels of detail share a mesh's buffers
+	for (UINT i = 0; i < 10; i++)
+		queue.Add(0, i % 2, i % 3, i);
+	CHECK_EQUAL(10u, queue.CountStateChanges());
+	queue.Sort();
+	CHECK_EQUAL(2u, queue.CountStateChanges());
+
+	queue.Clear();
+	CHECK(queue.GetItems().empty());
+}
@@ -0,0 +1,175 @@
+//
+// Fixed step schedule and the renderer's interpolation, run against a simulated clock so the results don't depend on
+// how busy the machine is
+//
+
+#include "Test.h"
+#include "FixedStepThread.h"
+#include "SimulationState.h"
+#include "SnapshotBuffer.h"
+
+typedef FixedStepSchedule::Duration Duration;
+
+static const float StepTime = 1.0f / 60.0f;
+
+static Duration Seconds(double seconds)
+{
+	return std::chrono::duration_cast<Duration>(std::chrono::duration<double>(seconds));
+}
+
+/// <summary>The spotlight orbit from Simulation::Update, the part of the simulation that only depends on time
+/// </summary>
+static void StepState(SimulationState& state, float dt)
+{
+	state.totalTime += dt;
+	state.sLight.position = XMFLOAT3(30.0f * std::cos(state.totalTime), 10.0f, 30.0f * std::sin(state.totalTime) + 10.0f);
+	XMFLOAT3 direction(-state.sLight.position.x, -state.sLight.position.y, 10.0f - state.sLight.position.z);
+	XMStoreFloat3(&state.sLight.direction, XMVector3Normalize(XMLoadFloat3(&direction)));
+	state.objects.resize(1);
+	state.objects[0].position = state.sLight.position;
+	XMStoreFloat4(&state.objects[0].orientation, XMQuaternionRotationRollPitchYaw(0.0f, state.totalTime, 0.0f));
+	state.objects[0].scale = XMFLOAT3(1.0f, 1.0f, 1.0f);
+}
+
+struct TimelineResult
+{
+	UINT steps;
+	UINT frames;
+	SimulationState final;
+	bool framesInRange;		// Every drawn time fell between the two states it was blended from
+	bool framesOrdered;		// Drawn time never went backwards, beyond rounding
+};
+
+/// <summary>Interleaves the update thread's steps and the renderer's frames on one simulated clock. stepCost is how long
+/// each step takes, hitchAt and hitch stall one step to make the schedule fall behind
+/// </summary>
+static TimelineResult RunTimeline(double seconds, double renderHz, double stepCost, UINT hitchAt = 0, double hitch = 0.0)
+{
+	TimelineResult result;
+	result.steps = 0;
+	result.frames = 0;
+	result.framesInRange = true;
+	result.framesOrdered = true;
+
+	SnapshotBuffer<SimulationSnapshot> snapshots;
+	SimulationState current = SimulationState();
+	StepState(current, 0.0f);
+
+	FixedStepSchedule schedule;
+	schedule.Reset(Duration::zero(), StepTime);
+	Duration nextStep = Duration::zero();
+	Duration nextFrame = Duration::zero();
+	Duration end = Seconds(seconds);
+	float lastDrawn = 0.0f;
+	UINT frame = 0;
+	while (nextStep < end || nextFrame < end)
+	{
+		if (nextStep <= nextFrame && nextStep < end)
+		{
+			SimulationSnapshot& snapshot = snapshots.WriteSlot();
+			snapshot.previous = current;
+			StepState(current, StepTime);
+			snapshot.current = current;
+			snapshot.stepTime = std::chrono::steady_clock::time_point(nextStep);
+			snapshots.Publish();
+			result.steps++;
+
+			Duration finished = nextStep + Seconds(stepCost) + (result.steps == hitchAt ? Seconds(hitch) : Duration::zero());
+			Duration due = schedule.Advance(finished);
+			nextStep = max(due, finished);
+			continue;
+		}
+
+		if (snapshots.Acquire() || result.frames > 0)
+		{
+			const SimulationSnapshot& snapshot = snapshots.ReadSlot();
+			Duration now = nextFrame;
+			float alpha = FixedStepSchedule::GetAlpha(now - snapshot.stepTime.time_since_epoch(), StepTime);
+			SimulationState drawn;
+			InterpolateState(snapshot.previous, snapshot.current, alpha, drawn);
+			result.framesInRange = result.framesInRange && drawn.totalTime >= snapshot.previous.totalTime &&
+				drawn.totalTime <= snapshot.current.totalTime;
+			result.framesOrdered = result.framesOrdered && drawn.totalTime >= lastDrawn - 1e-5f;
+			lastDrawn = drawn.totalTime;
+			result.frames++;
+		}
+		frame++;
+		nextFrame = Seconds(frame / renderHz);
+	}
+	result.final = current;
+	return result;
+}
+
+static bool SameState(const SimulationState& a, const SimulationState& b)
+{
+	return a.totalTime == b.totalTime && memcmp(&a.sLight.position, &b.sLight.position, sizeof(XMFLOAT3)) == 0 &&
+		memcmp(&a.sLight.direction, &b.sLight.direction, sizeof(XMFLOAT3)) == 0 &&
+		memcmp(&a.objects[0], &b.objects[0], sizeof(TransformState)) == 0;
+}
+
+TEST(FixedStepScheduleStepsAtItsRate)
+{
+	FixedStepSchedule schedule;
+	schedule.Reset(Duration::zero(), StepTime);
+	Duration next = Duration::zero();
+	for (UINT i = 1; i <= 600; i++)
+	{
+		next = schedule.Advance(next);
+		CHECK_EQUAL(schedule.GetStepDuration().count() * i, next.count());
+	}
+}
+
+TEST(FixedStepScheduleCatchesUpShortStalls)
+{
+	// Two steps late is caught up by running steps back to back
+	FixedStepSchedule schedule;
+	schedule.Reset(Duration::zero(), StepTime);
+	Duration step = schedule.GetStepDuration();
+	Duration next = schedule.Advance(step * 3);
+	CHECK_EQUAL(step.count(), next.count());
+}
+
+TEST(FixedStepScheduleDropsLongStalls)
+{
+	FixedStepSchedule schedule;
+	schedule.Reset(Duration::zero(), StepTime);
+	Duration stalled = Seconds(0.5);
+	CHECK_EQUAL(stalled.count(), schedule.Advance(stalled).count());
+}
+
+TEST(FixedStepAlphaIsClamped)
+{
+	CHECK_EQUAL(0.0f, FixedStepSchedule::GetAlpha(Seconds(-0.01), StepTime));
+	CHECK_NEAR(0.5f, FixedStepSchedule::GetAlpha(Seconds(StepTime * 0.5), StepTime), 1e-4f);
+	CHECK_EQUAL(1.0f, FixedStepSchedule::GetAlpha(Seconds(StepTime * 3.0), StepTime));
+}
+
+TEST(FixedStepStateIsIndependentOfRenderRate)
+{
+	const double renderRates[] = { 24.0, 60.0, 144.0, 1000.0 / 7.0, 500.0 };
+	TimelineResult reference = RunTimeline(2.0, renderRates[0], 0.001);
+	CHECK_EQUAL(120u, reference.steps);
+	for (double hz : renderRates)
+	{
+		TimelineResult run = RunTimeline(2.0, hz, 0.001);
+		CHECK_EQUAL(reference.steps, run.steps);
+		CHECK_EQUAL((UINT)std::ceil(2.0 * hz - 1e-9), run.frames);
+		CHECK(SameState(reference.final, run.final));
+		CHECK(run.framesInRange);
+		CHECK(run.framesOrdered);
+	}
+}
+
+TEST(FixedStepStallsOnlyDelaySteps)
+{
+	// A 50 ms stall is caught up within the same two seconds, a 500 ms one drops steps. Neither depends on render rate
+	TimelineResult caughtUp = RunTimeline(2.0, 60.0, 0.001, 30, 0.05);
+	CHECK_EQUAL(120u, caughtUp.steps);
+
+	TimelineResult dropped = RunTimeline(2.0, 60.0, 0.001, 30, 0.5);
+	CHECK(dropped.steps < 120u);
+	TimelineResult droppedFast = RunTimeline(2.0, 240.0, 0.001, 30, 0.5);
+	CHECK_EQUAL(dropped.steps, droppedFast.steps);
+	CHECK(SameState(dropped.final, droppedFast.final));
+	CHECK(droppedFast.framesOrdered);
+}
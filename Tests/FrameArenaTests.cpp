@@ -0,0 +1,216 @@
+//
+// Linear arenas hand out aligned, non-overlapping memory, give it all back on reset and fold a frame's overflow blocks
+// into one so the next frame of the same size never reaches the heap. Frame arenas are per thread and reset once a frame
+//
+
+#include "Test.h"
+#include "FrameArena.h"
+#include "ObjectPool.h"
+
+#include <cstring>
+#include <thread>
+#include <xmmintrin.h>
+
+static bool IsAligned(const void* p, size_t alignment)
+{
+	return ((size_t)p & (alignment - 1)) == 0;
+}
+
+TEST(LinearArenaAlignsAllocations)
+{
+	LinearArena arena(4096);
+	const size_t alignments[] = { 1, 2, 4, 8, 16, 32, 64, 128, 256 };
+	std::vector<std::pair<BYTE*, size_t>> taken;
+	for (UINT round = 0; round < 4; round++)
+	{
+		for (size_t alignment : alignments)
+		{
+			// Odd sizes leave the offset unaligned for the next one
+			size_t bytes = 3 + alignment + round * 7;
+			BYTE* p = (BYTE*)arena.Allocate(bytes, alignment);
+			CHECK(IsAligned(p, alignment));
+			memset(p, (int)taken.size(), bytes);
+			taken.push_back(std::make_pair(p, bytes));
+		}
+	}
+
+	// Nothing was overwritten by a later allocation
+	for (size_t i = 0; i < taken.size(); i++)
+	{
+		bool intact = true;
+		for (size_t b = 0; b < taken[i].second; b++)
+			intact &= taken[i].first[b] == (BYTE)i;
+		CHECK(intact);
+	}
+
+	// Arrays take their type's alignment
+	struct Wide
+	{
+		__m128 value;
+		float extra;
+	};
+	arena.Allocate(1, 1);
+	CHECK(IsAligned(arena.AllocateArray<Wide>(3), std::alignment_of<Wide>::value));
+	arena.Allocate(1, 1);
+	CHECK(IsAligned(arena.AllocateArray<double>(5), std::alignment_of<double>::value));
+	CHECK_EQUAL((UINT)(taken.size() + 4), arena.GetStats().allocations);
+}
+
+TEST(LinearArenaResetReusesMemory)
+{
+	LinearArena arena(1024);
+	BYTE* first = (BYTE*)arena.Allocate(100);
+	BYTE* second = (BYTE*)arena.Allocate(100);
+	CHECK(second >= first + 100);
+	CHECK_EQUAL(2u, arena.GetStats().allocations);
+	CHECK(arena.GetStats().bytes >= 200);
+	CHECK_EQUAL(1u, arena.GetStats().heapBlocks);
+
+	// A frame that fits in one block starts over at the same address without touching the heap
+	arena.Reset();
+	CHECK_EQUAL(0u, arena.GetStats().allocations);
+	CHECK_EQUAL((UINT64)0, arena.GetStats().bytes);
+	CHECK_EQUAL(0u, arena.GetStats().heapBlocks);
+	CHECK(arena.Allocate(100) == first);
+	CHECK(arena.Allocate(100) == second);
+	CHECK_EQUAL(0u, arena.GetStats().heapBlocks);
+
+	// The peak is kept across resets
+	CHECK(arena.GetStats().peakBytes >= 200);
+	arena.Reset();
+	arena.Allocate(8);
+	CHECK(arena.GetStats().peakBytes >= 200);
+}
+
+TEST(LinearArenaFoldsBlocksOnReset)
+{
+	LinearArena arena(1024);
+
+	// A frame of 40 100 byte allocations spills over several blocks, and one larger than a block gets its own
+	for (UINT i = 0; i < 40; i++)
+		arena.Allocate(100);
+	BYTE* large = (BYTE*)arena.Allocate(5000, 64);
+	CHECK(IsAligned(large, 64));
+	memset(large, 1, 5000);
+	UINT firstBlocks = arena.GetStats().heapBlocks;
+	CHECK(firstBlocks >= 5);
+	UINT64 firstBytes = arena.GetStats().bytes;
+	CHECK(firstBytes >= 40 * 100 + 5000);
+
+	// Reset folds them into one block, the same frame again fits in it contiguously
+	arena.Reset();
+	for (UINT frame = 0; frame < 3; frame++)
+	{
+		BYTE* start = (BYTE*)arena.Allocate(100);
+		BYTE* last = start;
+		bool contiguous = true;
+		for (UINT i = 1; i < 40; i++)
+		{
+			BYTE* p = (BYTE*)arena.Allocate(100);
+			contiguous &= p == last + 112;
+			last = p;
+		}
+		large = (BYTE*)arena.Allocate(5000, 64);
+		contiguous &= large > last && large < last + 112 + 64 + 100;
+		CHECK(contiguous);
+		CHECK_EQUAL(0u, arena.GetStats().heapBlocks);
+		CHECK(arena.GetStats().bytes <= firstBytes);
+		arena.Reset();
+	}
+
+	// A bigger frame spills again and is folded again
+	for (UINT i = 0; i < 200; i++)
+		arena.Allocate(100);
+	CHECK(arena.GetStats().heapBlocks > 0);
+	arena.Reset();
+	for (UINT i = 0; i < 200; i++)
+		arena.Allocate(100);
+	CHECK_EQUAL(0u, arena.GetStats().heapBlocks);
+}
+
+TEST(ArenaAllocatorBacksContainers)
+{
+	LinearArena arena(4096);
+	std::vector<int, ArenaAllocator<int>> values((ArenaAllocator<int>(arena)));
+	for (int i = 0; i < 1000; i++)
+		values.push_back(i);
+	CHECK_EQUAL((size_t)1000, values.size());
+	CHECK_EQUAL(999, values.back());
+	CHECK(arena.GetStats().allocations > 1);
+
+	// Copies allocate from the same arena
+	std::vector<int, ArenaAllocator<int>> copy(values);
+	CHECK(copy.get_allocator() == values.get_allocator());
+	CHECK_EQUAL(500, copy[500]);
+}
+
+TEST(FrameArenaResetsPerThreadPerFrame)
+{
+	// Stats sum what each thread's arena did in the last frame it finished
+	FrameArena::BeginFrame();
+	LinearArena& mine = FrameArena::Get();
+	CHECK(&FrameArena::Get() == &mine);
+	void* first = mine.Allocate(64);
+	mine.Allocate(64);
+	CHECK_EQUAL(2u, mine.GetStats().allocations);
+
+	LinearArena* theirs = NULL;
+	std::thread other([&]()
+	{
+		theirs = &FrameArena::Get();
+		theirs->Allocate(32);
+	});
+	other.join();
+	CHECK(theirs != &mine);
+
+	// The next frame resets the arena the first time its thread asks for it, and reuses its memory
+	ArenaStats before = FrameArena::GetStats();
+	FrameArena::BeginFrame();
+	CHECK_EQUAL(2u, mine.GetStats().allocations);
+	CHECK(FrameArena::Get().Allocate(64) == first);
+	CHECK_EQUAL(1u, mine.GetStats().allocations);
+	ArenaStats after = FrameArena::GetStats();
+	CHECK_EQUAL(before.allocations + 2, after.allocations);
+
+	FrameVector<float> scratch;
+	scratch.resize(100, 1.0f);
+	CHECK(scratch.get_allocator().GetArena() == &mine);
+}
+
+TEST(ObjectPoolReusesFreedSlots)
+{
+	struct Counted
+	{
+		Counted(int* _count) : count(_count) { (*count)++; }
+		~Counted() { (*count)--; }
+		int* count;
+	};
+
+	int alive = 0;
+	{
+		ObjectPool<Counted> pool(4);
+		Counted* objects[6];
+		for (UINT i = 0; i < 6; i++)
+			objects[i] = pool.Create(&alive);
+		CHECK_EQUAL(6, alive);
+		CHECK_EQUAL(6u, pool.GetLiveCount());
+		CHECK_EQUAL(8u, pool.GetCapacity());
+
+		// The last slot freed is the first reused, no new block is taken
+		pool.Destroy(objects[2]);
+		CHECK_EQUAL(5, alive);
+		CHECK(pool.Create(&alive) == objects[2]);
+		pool.Create(&alive);
+		pool.Create(&alive);
+		CHECK_EQUAL(8u, pool.GetCapacity());
+
+		pool.Clear();
+		CHECK_EQUAL(0, alive);
+		CHECK_EQUAL(0u, pool.GetLiveCount());
+		CHECK_EQUAL(8u, pool.GetCapacity());
+		pool.Create(&alive);
+	}
+
+	// The pool destroys what is still alive when it goes
+	CHECK_EQUAL(0, alive);
+}
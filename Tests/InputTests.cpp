@@ -0,0 +1,137 @@
+//
+// Input recording round trips and rejection of damaged recordings
+//
+
+#include "Test.h"
+#include "Input.h"
+
+// Plays back a fixed list of key states, one per sample
+class ScriptedKeySource : public KeySource
+{
+public:
+	ScriptedKeySource() : next(0) {}
+
+	USHORT Sample()
+	{
+		return next < script.size() ? script[next++] : 0;
+	}
+
+	std::vector<USHORT> script;
+	size_t next;
+};
+
+static const char* RecordingPath = "input_test.input";
+
+/// <summary>Records steps of held keys, switching every few steps, with dt changing halfway through. The recording is
+/// saved as input goes out of scope
+/// </summary>
+static void Record(ScriptedKeySource& source, UINT steps, std::vector<float>& dts)
+{
+	Input input(&source);
+	CHECK(input.ParseCommandLine("record=input_test.input"));
+	for (UINT i = 0; i < steps; i++)
+	{
+		source.script.push_back((USHORT)(1 << ((i / 7) % KeyCount)));
+		float dt = i < steps / 2 ? 1.0f / 60.0f : 1.0f / 30.0f;
+		dts.push_back(dt);
+		input.BeginStep(dt);
+	}
+}
+
+static std::vector<BYTE> ReadBytes(const char* path)
+{
+	std::ifstream file(path, std::ios::binary);
+	return std::vector<BYTE>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static void WriteBytes(const char* path, const std::vector<BYTE>& bytes)
+{
+	std::ofstream file(path, std::ios::binary);
+	file.write((const char*)&bytes[0], bytes.size());
+}
+
+TEST(InputReplaysWhatWasRecorded)
+{
+	ScriptedKeySource source;
+	std::vector<float> dts;
+	Record(source, 200, dts);
+
+	ScriptedKeySource unused;
+	Input replay(&unused);
+	REQUIRE(replay.Load(RecordingPath));
+	CHECK(replay.IsReplaying());
+	for (UINT i = 0; i < 200; i++)
+	{
+		float dt = 0.5f;
+		REQUIRE(replay.BeginStep(dt));
+		CHECK_EQUAL(dts[i], dt);
+		for (int key = 0; key < KeyCount; key++)
+			CHECK_EQUAL((source.script[i] & (1 << key)) != 0, replay.IsDown((InputKey)key));
+	}
+	float dt = 0.5f;
+	CHECK(!replay.BeginStep(dt));
+	CHECK_EQUAL(0u, unused.next);
+
+	// Repeated steps share runs, 200 steps switching every 7 and once for dt
+	CHECK_EQUAL(sizeof(UINT) * 3 + 30 * sizeof(InputRun), ReadBytes(RecordingPath).size());
+	remove(RecordingPath);
+}
+
+TEST(InputFixedStepOverridesRecordedDt)
+{
+	ScriptedKeySource source;
+	std::vector<float> dts;
+	Record(source, 20, dts);
+
+	ScriptedKeySource unused;
+	Input replay(&unused);
+	REQUIRE(replay.ParseCommandLine("replay=input_test.input fixeddt=0.01"));
+	float dt = 0.5f;
+	REQUIRE(replay.BeginStep(dt));
+	CHECK_EQUAL(0.01f, dt);
+	remove(RecordingPath);
+}
+
+TEST(InputRejectsDamagedRecordings)
+{
+	ScriptedKeySource source;
+	std::vector<float> dts;
+	Record(source, 50, dts);
+	std::vector<BYTE> good = ReadBytes(RecordingPath);
+	REQUIRE(good.size() > 12);
+
+	ScriptedKeySource unused;
+	Input replay(&unused);
+
+	// Cut short
+	std::vector<BYTE> bytes(good.begin(), good.end() - 3);
+	WriteBytes(RecordingPath, bytes);
+	CHECK(!replay.Load(RecordingPath));
+
+	// A run count far past the end of the file
+	bytes = good;
+	bytes[8] = 0xFF;
+	bytes[9] = 0xFF;
+	bytes[10] = 0xFF;
+	bytes[11] = 0x7F;
+	WriteBytes(RecordingPath, bytes);
+	CHECK(!replay.Load(RecordingPath));
+
+	// Trailing bytes
+	bytes = good;
+	bytes.push_back(0);
+	WriteBytes(RecordingPath, bytes);
+	CHECK(!replay.Load(RecordingPath));
+
+	// Wrong magic
+	bytes = good;
+	bytes[0] = 'X';
+	WriteBytes(RecordingPath, bytes);
+	CHECK(!replay.Load(RecordingPath));
+	CHECK(!replay.IsReplaying());
+
+	// Missing file, reported from the command line
+	remove(RecordingPath);
+	CHECK(!replay.ParseCommandLine("replay=input_test.input"));
+	CHECK(!replay.IsReplaying());
+}
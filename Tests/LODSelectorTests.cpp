@@ -0,0 +1,184 @@
+//
+// Level selection at known distances: the coarsest level whose error stays under a pixel, the shadow map's looser
+// threshold, world scale, and the hysteresis that keeps an object from flickering between two levels at one distance
+//
+
+#include "Test.h"
+#include "LODSelector.h"
+
+// A 1000 pixel tall viewport behind a 90 degree field of view, one unit at a distance of 1 covers 500 pixels
+static const float ViewportHeight = 1000.0f;
+
+static void MakeChain(std::vector<MeshLOD>& lods)
+{
+	const float errors[] = { 0.0f, 0.01f, 0.04f, 0.16f };
+	for (UINT i = 0; i < 4; i++)
+	{
+		MeshLOD lod = { i * 300, 300u >> i, errors[i] };
+		lods.push_back(lod);
+	}
+}
+
+/// <summary>A point sized object straight ahead of the eye at the origin
+/// </summary>
+static UINT SelectAt(const LODSelector& selector, const std::vector<MeshLOD>& lods, float distance, UINT current, float scale = 1.0f)
+{
+	MeshBounds bounds;
+	bounds.center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	bounds.extents = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	XMFLOAT4X4 world;
+	XMStoreFloat4x4(&world, XMMatrixScaling(scale, scale, scale) * XMMatrixTranslation(0.0f, 0.0f, distance));
+	return selector.Select(LODPassCamera, lods, bounds, world, current);
+}
+
+static void SetCamera(LODSelector& selector)
+{
+	selector.SetPerspective(LODPassCamera, XMFLOAT3(0.0f, 0.0f, 0.0f), XM_PIDIV2, ViewportHeight);
+}
+
+TEST(LODSelectorPicksCoarsestLevelUnderAPixel)
+{
+	LODSelector selector;
+	SetCamera(selector);
+	std::vector<MeshLOD> lods;
+	MakeChain(lods);
+
+	// Level 1 fits from 5 units away, level 2 from 20 and level 3 from 80, starting from each one's own level
+	CHECK_EQUAL(0u, SelectAt(selector, lods, 4.0f, 0));
+	CHECK_EQUAL(1u, SelectAt(selector, lods, 10.0f, 1));
+	CHECK_EQUAL(2u, SelectAt(selector, lods, 50.0f, 2));
+	CHECK_EQUAL(3u, SelectAt(selector, lods, 1000.0f, 3));
+
+	// Finer levels are taken as soon as they're needed, whatever the object drew at
+	CHECK_EQUAL(0u, SelectAt(selector, lods, 4.0f, 3));
+	CHECK_EQUAL(1u, SelectAt(selector, lods, 10.0f, 3));
+
+	// A current level past the chain is clamped, and a single level is all there is
+	CHECK_EQUAL(3u, SelectAt(selector, lods, 1000.0f, 9));
+	std::vector<MeshLOD> single(1, lods[0]);
+	CHECK_EQUAL(0u, SelectAt(selector, single, 1000.0f, 0));
+
+	// Scaling the object up scales its error with it
+	CHECK_EQUAL(2u, SelectAt(selector, lods, 30.0f, 2, 1.0f));
+	CHECK_EQUAL(1u, SelectAt(selector, lods, 30.0f, 2, 2.0f));
+}
+
+TEST(LODSelectorMeasuresFromTheNearestPoint)
+{
+	LODSelector selector;
+	SetCamera(selector);
+	std::vector<MeshLOD> lods;
+	MakeChain(lods);
+
+	MeshBounds bounds;
+	bounds.center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	bounds.extents = XMFLOAT3(3.0f, 4.0f, 0.0f);
+	XMFLOAT4X4 world;
+
+	// The bounds reach 5 units towards the eye, so at 30 away they're as close as 25
+	XMStoreFloat4x4(&world, XMMatrixTranslation(0.0f, 0.0f, 30.0f));
+	CHECK_EQUAL(2u, selector.Select(LODPassCamera, lods, bounds, world, 3));
+	XMStoreFloat4x4(&world, XMMatrixTranslation(0.0f, 0.0f, 24.0f));
+	CHECK_EQUAL(1u, selector.Select(LODPassCamera, lods, bounds, world, 3));
+
+	// An eye inside the bounds gets full detail
+	XMStoreFloat4x4(&world, XMMatrixTranslation(0.0f, 0.0f, 2.0f));
+	CHECK_EQUAL(0u, selector.Select(LODPassCamera, lods, bounds, world, 3));
+}
+
+TEST(LODSelectorHoldsLevelsWithHysteresis)
+{
+	LODSelector selector;
+	SetCamera(selector);
+	std::vector<MeshLOD> lods;
+	MakeChain(lods);
+
+	// Level 2 is under the threshold from 20 units, but only a quarter under it from 26.67
+	CHECK_EQUAL(1u, SelectAt(selector, lods, 21.0f, 1));
+	CHECK_EQUAL(1u, SelectAt(selector, lods, 26.0f, 1));
+	CHECK_EQUAL(2u, SelectAt(selector, lods, 27.0f, 1));
+
+	// Moving back in, level 2 holds down to 20 and level 1 returns as soon as it is needed
+	CHECK_EQUAL(2u, SelectAt(selector, lods, 20.5f, 2));
+	CHECK_EQUAL(1u, SelectAt(selector, lods, 19.5f, 2));
+
+	// Jitter around a switching distance settles on one level instead of alternating
+	UINT level = 1;
+	UINT switches = 0;
+	for (UINT frame = 0; frame < 100; frame++)
+	{
+		UINT next = SelectAt(selector, lods, frame % 2 ? 19.8f : 21.0f, level);
+		switches += next != level;
+		level = next;
+	}
+	CHECK_EQUAL(1u, level);
+	CHECK(switches <= 1);
+
+	// Skipping levels also waits for the margin on each one on the way
+	CHECK_EQUAL(2u, SelectAt(selector, lods, 90.0f, 0));
+	CHECK_EQUAL(3u, SelectAt(selector, lods, 110.0f, 0));
+
+	// No hysteresis switches right at the threshold
+	selector.ParseCommandLine("lodhysteresis=0");
+	CHECK_EQUAL(2u, SelectAt(selector, lods, 21.0f, 1));
+}
+
+TEST(LODSelectorGivesShadowsCoarserLevels)
+{
+	LODSelector selector;
+	std::vector<MeshLOD> lods;
+	MakeChain(lods);
+
+	MeshBounds bounds;
+	bounds.center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	bounds.extents = XMFLOAT3(1.0f, 1.0f, 1.0f);
+	XMFLOAT4X4 world;
+	XMStoreFloat4x4(&world, XMMatrixTranslation(5.0f, 0.0f, 5.0f));
+
+	// 50 units over 2048 texels is 41 texels a unit, 4 texels allow errors up to 0.098
+	selector.SetOrthographic(LODPassShadow, 50.0f, 2048.0f);
+	CHECK_EQUAL(2u, selector.Select(LODPassShadow, lods, bounds, world, 2));
+
+	// The camera at the same resolution allows a quarter of that
+	selector.SetOrthographic(LODPassCamera, 50.0f, 2048.0f);
+	CHECK_EQUAL(1u, selector.Select(LODPassCamera, lods, bounds, world, 2));
+
+	// Orthographic views don't care how far away the object is
+	XMStoreFloat4x4(&world, XMMatrixTranslation(5.0f, 0.0f, 500.0f));
+	CHECK_EQUAL(2u, selector.Select(LODPassShadow, lods, bounds, world, 2));
+}
+
+TEST(LODSelectorReadsCommandLine)
+{
+	LODSelector selector;
+	SetCamera(selector);
+	std::vector<MeshLOD> lods;
+	MakeChain(lods);
+	CHECK(selector.IsEnabled());
+
+	// Twice the pixels allowed halves the distance each level needs
+	selector.ParseCommandLine("-benchmark lodpixels=2");
+	SetCamera(selector);
+	CHECK_EQUAL(2u, SelectAt(selector, lods, 12.0f, 2));
+
+	// The shadow map allowing the same as the camera keeps it off level 3
+	selector.ParseCommandLine("lodshadow=1");
+	selector.SetOrthographic(LODPassShadow, 50.0f, 2048.0f);
+	MeshBounds bounds;
+	bounds.center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	bounds.extents = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	XMFLOAT4X4 world;
+	XMStoreFloat4x4(&world, XMMatrixIdentity());
+	CHECK_EQUAL(2u, selector.Select(LODPassShadow, lods, bounds, world, 3));
+
+	// Full hysteresis never moves to a coarser level, finer ones still come straight away
+	selector.ParseCommandLine("lodhysteresis=5");
+	CHECK_EQUAL(1u, SelectAt(selector, lods, 1000.0f, 1));
+	CHECK_EQUAL(0u, SelectAt(selector, lods, 2.0f, 1));
+
+	selector.ParseCommandLine("lod=0");
+	CHECK(!selector.IsEnabled());
+	CHECK_EQUAL(0u, SelectAt(selector, lods, 1000.0f, 3));
+	selector.ParseCommandLine(NULL);
+	CHECK(!selector.IsEnabled());
+}
@@ -0,0 +1,55 @@
+//
+// Load graph ordering and failure propagation
+//
+
+#include "Test.h"
+#include "LoadGraph.h"
+
+TEST(LoadGraphLoadsAfterDependencies)
+{
+	std::mutex orderMutex;
+	std::vector<int> loaded, created;
+	LoadGraph graph;
+	LoadNodeId nodes[4];
+	for (int i = 0; i < 4; i++)
+	{
+		nodes[i] = graph.Add("Node", [&, i]()
+		{
+			std::lock_guard<std::mutex> lock(orderMutex);
+			loaded.push_back(i);
+			return true;
+		},
+		[&, i]() { created.push_back(i); return true; });
+	}
+
+	// 3 waits on 1 and 2, which wait on 0
+	graph.DependsOn(nodes[3], nodes[1]);
+	graph.DependsOn(nodes[3], nodes[2]);
+	graph.DependsOn(nodes[1], nodes[0]);
+	graph.DependsOn(nodes[2], nodes[0]);
+	REQUIRE(graph.Run(4));
+
+	REQUIRE(loaded.size() == 4 && created.size() == 4);
+	CHECK_EQUAL(0, loaded[0]);
+	CHECK_EQUAL(3, loaded[3]);
+	CHECK_EQUAL(0, created[0]);
+	CHECK_EQUAL(3, created[3]);
+	for (LoadNodeId node : nodes)
+		CHECK(graph.Succeeded(node));
+}
+
+TEST(LoadGraphFailsDependents)
+{
+	bool dependentRan = false;
+	LoadGraph graph;
+	LoadNodeId failing = graph.Add("Failing", []() { return false; });
+	LoadNodeId dependent = graph.Add("Dependent", [&]() { dependentRan = true; return true; });
+	LoadNodeId independent = graph.Add("Independent", []() { return true; });
+	graph.DependsOn(dependent, failing);
+
+	CHECK(!graph.Run(2));
+	CHECK(!dependentRan);
+	CHECK(!graph.Succeeded(failing));
+	CHECK(!graph.Succeeded(dependent));
+	CHECK(graph.Succeeded(independent));
+}
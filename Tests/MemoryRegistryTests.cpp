@@ -0,0 +1,351 @@
+//
+// Registry accounting: totals, peaks and counts per category, per owner and for the device and the host side, as
+// allocations come, grow and go. Device objects are fakes that keep TrackedResources' records as a device would and
+// drop them when they are destroyed, so the registry has to empty again once every object is released
+//
+
+#include "Test.h"
+#include "MemoryRegistry.h"
+#include "TrackedResources.h"
+
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+/// <summary>Holds private data the way a device object does, released with the object or when replaced
+/// </summary>
+template <class Interface>
+class FakeDeviceChild : public Interface
+{
+public:
+	FakeDeviceChild() :
+	references(1),
+	privateData(NULL)
+	{
+
+	}
+
+	ULONG AddRef() { return ++references; }
+
+	ULONG Release()
+	{
+		ULONG left = --references;
+		if (left == 0)
+			delete this;
+		return left;
+	}
+
+	HRESULT SetPrivateDataInterface(REFGUID, const IUnknown* data)
+	{
+		if (data)
+			const_cast<IUnknown*>(data)->AddRef();
+		if (privateData)
+			privateData->Release();
+		privateData = const_cast<IUnknown*>(data);
+		return S_OK;
+	}
+protected:
+	virtual ~FakeDeviceChild()
+	{
+		if (privateData)
+			privateData->Release();
+	}
+private:
+	ULONG references;
+	IUnknown* privateData;
+};
+
+class FakeBuffer : public FakeDeviceChild<ID3D11Buffer>
+{
+public:
+	FakeBuffer(const D3D11_BUFFER_DESC& desc) : desc(desc) {}
+	void GetType(D3D11_RESOURCE_DIMENSION* dimension) { *dimension = D3D11_RESOURCE_DIMENSION_BUFFER; }
+	void GetDesc(D3D11_BUFFER_DESC* out) { *out = desc; }
+private:
+	D3D11_BUFFER_DESC desc;
+};
+
+class FakeTexture : public FakeDeviceChild<ID3D11Texture2D>
+{
+public:
+	FakeTexture(const D3D11_TEXTURE2D_DESC& desc) : desc(desc) {}
+	void GetType(D3D11_RESOURCE_DIMENSION* dimension) { *dimension = D3D11_RESOURCE_DIMENSION_TEXTURE2D; }
+	void GetDesc(D3D11_TEXTURE2D_DESC* out) { *out = desc; }
+private:
+	D3D11_TEXTURE2D_DESC desc;
+};
+
+class FakeDevice : public ID3D11Device
+{
+public:
+	FakeDevice() : fail(false) {}
+
+	ULONG AddRef() { return 1; }
+	ULONG Release() { return 1; }
+
+	HRESULT CreateBuffer(const D3D11_BUFFER_DESC* desc, const D3D11_SUBRESOURCE_DATA*, ID3D11Buffer** buffer)
+	{
+		*buffer = fail ? NULL : new FakeBuffer(*desc);
+		return fail ? E_OUTOFMEMORY : S_OK;
+	}
+
+	HRESULT CreateTexture2D(const D3D11_TEXTURE2D_DESC* desc, const D3D11_SUBRESOURCE_DATA*, ID3D11Texture2D** texture)
+	{
+		*texture = fail ? NULL : new FakeTexture(*desc);
+		return fail ? E_OUTOFMEMORY : S_OK;
+	}
+
+	HRESULT CreateShaderResourceView(ID3D11Resource*, const D3D11_SHADER_RESOURCE_VIEW_DESC*, ID3D11ShaderResourceView** view)
+	{
+		*view = new FakeDeviceChild<ID3D11ShaderResourceView>();
+		return S_OK;
+	}
+
+	HRESULT CreateRenderTargetView(ID3D11Resource*, const D3D11_RENDER_TARGET_VIEW_DESC*, ID3D11RenderTargetView** view)
+	{
+		*view = new FakeDeviceChild<ID3D11RenderTargetView>();
+		return S_OK;
+	}
+
+	HRESULT CreateDepthStencilView(ID3D11Resource*, const D3D11_DEPTH_STENCIL_VIEW_DESC*, ID3D11DepthStencilView** view)
+	{
+		*view = new FakeDeviceChild<ID3D11DepthStencilView>();
+		return S_OK;
+	}
+
+	bool fail;
+};
+
+static D3D11_BUFFER_DESC BufferDesc(UINT bytes, UINT bindFlags)
+{
+	D3D11_BUFFER_DESC desc = {};
+	desc.ByteWidth = bytes;
+	desc.BindFlags = bindFlags;
+	return desc;
+}
+
+static D3D11_TEXTURE2D_DESC TextureDesc(UINT width, UINT height, UINT mips, DXGI_FORMAT format, UINT bindFlags)
+{
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = width;
+	desc.Height = height;
+	desc.MipLevels = mips;
+	desc.ArraySize = 1;
+	desc.Format = format;
+	desc.SampleDesc.Count = 1;
+	desc.BindFlags = bindFlags;
+	return desc;
+}
+
+TEST(MemoryRegistryKeepsTotalsAndPeaks)
+{
+	MemoryRegistry registry;
+	AllocationId mesh = registry.Add(MemoryMeshData, "Models/cube.obj", 1000);
+	AllocationId vertices = registry.Add(MemoryVertexBuffer, "Models/cube.obj", 4000);
+	AllocationId texture = registry.Add(MemoryTexture, "Textures/brick.dds", 65536);
+	CHECK(mesh != 0 && vertices != 0 && texture != 0);
+	CHECK(mesh != vertices && vertices != texture);
+
+	CHECK_EQUAL((UINT64)1000, registry.GetHostTotals().bytes);
+	CHECK_EQUAL((UINT64)69536, registry.GetDeviceTotals().bytes);
+	CHECK_EQUAL(2u, registry.GetDeviceTotals().count);
+	CHECK_EQUAL((UINT64)4000, registry.GetTotals(MemoryVertexBuffer).bytes);
+	CHECK_EQUAL((UINT64)5000, registry.GetOwnerTotals("Models/cube.obj").bytes);
+	CHECK_EQUAL(2u, registry.GetOwnerTotals("Models/cube.obj").count);
+
+	// Dropping most of the CPU copy shrinks everything it counts towards, the peaks stay
+	registry.Resize(mesh, 200);
+	CHECK_EQUAL((UINT64)200, registry.GetHostTotals().bytes);
+	CHECK_EQUAL((UINT64)1000, registry.GetHostTotals().peakBytes);
+	CHECK_EQUAL(1u, registry.GetTotals(MemoryMeshData).count);
+	CHECK_EQUAL((UINT64)4200, registry.GetOwnerTotals("Models/cube.obj").bytes);
+	CHECK_EQUAL((UINT64)5000, registry.GetOwnerTotals("Models/cube.obj").peakBytes);
+
+	// Removing takes the rest out, twice or for an unknown id does nothing
+	registry.Remove(texture);
+	registry.Remove(texture);
+	registry.Remove(12345);
+	registry.Resize(12345, 1);
+	CHECK_EQUAL((UINT64)4000, registry.GetDeviceTotals().bytes);
+	CHECK_EQUAL((UINT64)69536, registry.GetDeviceTotals().peakBytes);
+	CHECK_EQUAL((UINT64)0, registry.GetOwnerTotals("Textures/brick.dds").bytes);
+	CHECK_EQUAL((UINT64)65536, registry.GetOwnerTotals("Textures/brick.dds").peakBytes);
+	CHECK_EQUAL(0u, registry.GetOwnerTotals("Textures/brick.dds").count);
+
+	registry.Remove(mesh);
+	registry.Remove(vertices);
+	for (UINT i = 0; i < MemoryCategoryCount; i++)
+	{
+		CHECK_EQUAL((UINT64)0, registry.GetTotals((MemoryCategory)i).bytes);
+		CHECK_EQUAL(0u, registry.GetTotals((MemoryCategory)i).count);
+	}
+
+	// A missing owner is counted as unknown
+	registry.Add(MemoryBuffer, NULL, 16);
+	CHECK_EQUAL((UINT64)16, registry.GetOwnerTotals("unknown").bytes);
+	CHECK_EQUAL((UINT64)0, registry.GetOwnerTotals("never added").peakBytes);
+}
+
+TEST(MemoryRegistryCountsFromManyThreads)
+{
+	MemoryRegistry registry;
+	const UINT threads = 4, allocations = 2000;
+	std::vector<std::thread> workers;
+	for (UINT t = 0; t < threads; t++)
+	{
+		workers.push_back(std::thread([&registry, t]()
+		{
+			std::string owner = "worker" + std::to_string(t);
+			std::vector<AllocationId> ids;
+			for (UINT i = 0; i < allocations; i++)
+				ids.push_back(registry.Add((MemoryCategory)(i % MemoryCategoryCount), owner.c_str(), 10));
+			for (UINT i = 0; i < allocations; i += 2)
+				registry.Remove(ids[i]);
+		}));
+	}
+	for (std::thread& worker : workers)
+		worker.join();
+
+	UINT64 total = registry.GetDeviceTotals().bytes + registry.GetHostTotals().bytes;
+	CHECK_EQUAL((UINT64)threads * allocations / 2 * 10, total);
+	CHECK_EQUAL(threads * allocations / 2, registry.GetDeviceTotals().count + registry.GetHostTotals().count);
+	for (UINT t = 0; t < threads; t++)
+		CHECK_EQUAL((UINT64)allocations * 10, registry.GetOwnerTotals(("worker" + std::to_string(t)).c_str()).peakBytes);
+}
+
+TEST(MemoryRegistrySizesTextures)
+{
+	// A full chain is a third larger than its top level, down to 1x1
+	CHECK_EQUAL((UINT64)(256 * 256 * 4 + 128 * 128 * 4 + 64 * 64 * 4 + 32 * 32 * 4 + 16 * 16 * 4 + 8 * 8 * 4 + 4 * 4 * 4 + 2 * 2 * 4 + 4),
+		MemoryRegistry::GetTextureBytes(256, 256, 1, 0, 1, 1, DXGI_FORMAT_R8G8B8A8_UNORM));
+
+	// Block compressed levels round up to whole 4x4 blocks, BC1 is 8 bytes a block and BC3 16
+	CHECK_EQUAL((UINT64)(16 * 8 + 4 * 8 + 8 + 8), MemoryRegistry::GetTextureBytes(16, 16, 1, 4, 1, 1, DXGI_FORMAT_BC1_UNORM));
+	CHECK_EQUAL((UINT64)(2 * 2 * 16), MemoryRegistry::GetTextureBytes(5, 5, 1, 1, 1, 1, DXGI_FORMAT_BC3_UNORM));
+
+	// Slices and samples multiply, a depth buffer at 4x MSAA
+	CHECK_EQUAL((UINT64)64 * 64 * 8 * 6, MemoryRegistry::GetTextureBytes(64, 64, 1, 1, 6, 1, DXGI_FORMAT_R16G16B16A16_FLOAT));
+	CHECK_EQUAL((UINT64)1280 * 720 * 4 * 4, MemoryRegistry::GetTextureBytes(1280, 720, 1, 1, 1, 4, DXGI_FORMAT_D24_UNORM_S8_UINT));
+
+	bool blockCompressed;
+	CHECK_EQUAL(8u, MemoryRegistry::GetFormatBits(DXGI_FORMAT_R8_UNORM, blockCompressed));
+	CHECK(!blockCompressed);
+	CHECK_EQUAL(128u, MemoryRegistry::GetFormatBits(DXGI_FORMAT_BC7_UNORM, blockCompressed));
+	CHECK(blockCompressed);
+}
+
+TEST(MemoryRegistryWritesSnapshots)
+{
+	MemoryRegistry registry;
+	registry.ParseCommandLine("memreport=0 gpubudget=1 meshdata=compress");
+	CHECK_EQUAL((UINT64)1024 * 1024, registry.GetDeviceBudget());
+	CHECK(registry.GetMeshDataPolicy() == MeshDataCompress);
+	CHECK(!registry.WriteSnapshot());
+
+	registry.Add(MemoryTexture, "Textures/\"quoted\"\\path.dds", 2 * 1024 * 1024);
+	registry.Add(MemoryShader, "Shaders", 100);
+	std::ostringstream json;
+	registry.WriteJSON(json, 1.5);
+	std::string line = json.str();
+	CHECK(line.find("\"time\": 1.5") != std::string::npos);
+	CHECK(line.find("\"overBudget\": true") != std::string::npos);
+	CHECK(line.find("\"texture\": {\"bytes\": 2097152, \"peakBytes\": 2097152, \"count\": 1}") != std::string::npos);
+	CHECK(line.find("Textures/\\\"quoted\\\"\\\\path.dds") != std::string::npos);
+	CHECK(line.find("\"ownerCount\": 2") != std::string::npos);
+
+	// The largest owner is listed first
+	CHECK(line.find("quoted") < line.find("Shaders"));
+
+	// Snapshots are appended a line at a time as the interval passes
+	const char* path = "memoryregistry_test.jsonl";
+	remove(path);
+	registry.ParseCommandLine("memreport=memoryregistry_test.jsonl memreportinterval=2");
+	registry.Update(1.0f);
+	registry.Update(1.0f);
+	registry.Update(1.5f);
+	registry.Update(0.6f);
+	std::ifstream file(path);
+	std::string first, second, third;
+	CHECK(std::getline(file, first) && std::getline(file, second));
+	CHECK(!std::getline(file, third));
+	CHECK(first.find("\"time\": 2") != std::string::npos);
+	CHECK(second.find("\"time\": 4.1") != std::string::npos);
+	file.close();
+	remove(path);
+}
+
+TEST(TrackedResourcesReportDeviceObjects)
+{
+	MemoryRegistry& registry = MemoryRegistry::Global();
+	MemoryTotals before = registry.GetDeviceTotals();
+	FakeDevice device;
+
+	ID3D11Buffer* vertices = NULL;
+	ID3D11Buffer* constants = NULL;
+	D3D11_BUFFER_DESC vertexDesc = BufferDesc(3000, D3D11_BIND_VERTEX_BUFFER);
+	D3D11_BUFFER_DESC constantDesc = BufferDesc(256, D3D11_BIND_CONSTANT_BUFFER);
+	CHECK(SUCCEEDED(TrackedResources::CreateBuffer(&device, &vertexDesc, NULL, "TrackedTest/mesh", &vertices)));
+	CHECK(SUCCEEDED(TrackedResources::CreateBuffer(&device, &constantDesc, NULL, "TrackedTest/frame", &constants)));
+
+	ID3D11Texture2D* depth = NULL;
+	ID3D11Texture2D* color = NULL;
+	D3D11_TEXTURE2D_DESC depthDesc = TextureDesc(512, 512, 1, DXGI_FORMAT_R24G8_TYPELESS, D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE);
+	D3D11_TEXTURE2D_DESC colorDesc = TextureDesc(128, 128, 0, DXGI_FORMAT_BC1_UNORM, D3D11_BIND_SHADER_RESOURCE);
+	CHECK(SUCCEEDED(TrackedResources::CreateTexture2D(&device, &depthDesc, NULL, "TrackedTest/shadow", &depth)));
+	CHECK(SUCCEEDED(TrackedResources::CreateTexture2D(&device, &colorDesc, NULL, "TrackedTest/brick", &color)));
+
+	ID3D11DepthStencilView* depthView = NULL;
+	ID3D11ShaderResourceView* colorView = NULL;
+	CHECK(SUCCEEDED(TrackedResources::CreateDepthStencilView(&device, depth, NULL, "TrackedTest/shadow", &depthView)));
+	CHECK(SUCCEEDED(TrackedResources::CreateShaderResourceView(&device, color, NULL, "TrackedTest/brick", &colorView)));
+
+	// Each object lands in its category with its size, views are only counted
+	UINT64 colorBytes = MemoryRegistry::GetTextureBytes(128, 128, 1, 0, 1, 1, DXGI_FORMAT_BC1_UNORM);
+	UINT64 expected = 3000 + 256 + 512 * 512 * 4 + colorBytes;
+	MemoryTotals during = registry.GetDeviceTotals();
+	CHECK_EQUAL(before.bytes + expected, during.bytes);
+	CHECK_EQUAL(before.count + 6, during.count);
+	CHECK_EQUAL((UINT64)512 * 512 * 4, registry.GetOwnerTotals("TrackedTest/shadow").bytes);
+	CHECK_EQUAL(2u, registry.GetOwnerTotals("TrackedTest/shadow").count);
+	CHECK_EQUAL((UINT64)256, registry.GetOwnerTotals("TrackedTest/frame").bytes);
+
+	MemoryCategory category;
+	CHECK_EQUAL((UINT64)3000, TrackedResources::GetResourceBytes(vertices, category));
+	CHECK(category == MemoryVertexBuffer);
+	CHECK_EQUAL((UINT64)512 * 512 * 4, TrackedResources::GetResourceBytes(depth, category));
+	CHECK(category == MemoryDepthStencil);
+	CHECK_EQUAL(colorBytes, TrackedResources::GetResourceBytes(color, category));
+	CHECK(category == MemoryTexture);
+
+	// Tracking an object again replaces its record instead of counting it twice
+	TrackedResources::Track(constants, MemoryConstantBuffer, "TrackedTest/frame", 512);
+	CHECK_EQUAL((UINT64)512, registry.GetOwnerTotals("TrackedTest/frame").bytes);
+	CHECK_EQUAL(1u, registry.GetOwnerTotals("TrackedTest/frame").count);
+
+	// A loader's resource is measured from its description
+	D3D11_BUFFER_DESC loadedDesc = BufferDesc(777, D3D11_BIND_INDEX_BUFFER);
+	ID3D11Buffer* loaded = new FakeBuffer(loadedDesc);
+	TrackedResources::TrackResource(loaded, "TrackedTest/loaded");
+	CHECK_EQUAL((UINT64)777, registry.GetOwnerTotals("TrackedTest/loaded").bytes);
+
+	// A failed creation records nothing
+	device.fail = true;
+	ID3D11Buffer* failed = NULL;
+	CHECK(FAILED(TrackedResources::CreateBuffer(&device, &vertexDesc, NULL, "TrackedTest/failed", &failed)));
+	CHECK(failed == NULL);
+	CHECK_EQUAL(0u, registry.GetOwnerTotals("TrackedTest/failed").count);
+
+	// Releasing the objects the usual way empties the registry again
+	vertices->Release();
+	constants->Release();
+	depthView->Release();
+	depth->Release();
+	colorView->Release();
+	color->Release();
+	loaded->Release();
+	MemoryTotals after = registry.GetDeviceTotals();
+	CHECK_EQUAL(before.bytes, after.bytes);
+	CHECK_EQUAL(before.count, after.count);
+	CHECK_EQUAL(0u, registry.GetOwnerTotals("TrackedTest/brick").count);
+	CHECK_EQUAL(colorBytes, registry.GetOwnerTotals("TrackedTest/brick").peakBytes);
+}
@@ -0,0 +1,264 @@
+//
+// Mesh compression round trips exactly, piece by piece and for whole cooked meshes with and without the Huffman stage,
+// including block and group edges, values that need every byte and code lengths past the limit. Truncated or damaged
+// input is refused without reading past what it was given
+//
+
+#include "Test.h"
+#include "MeshCodec.h"
+#include "MeshData.h"
+#include "TestMeshes.h"
+
+#include <cstring>
+#include <random>
+
+static bool RoundTrips(const std::vector<BYTE>& cooked, bool entropy, std::vector<BYTE>& compressed)
+{
+	if (!MeshCodec::Encode(&cooked[0], cooked.size(), entropy, compressed))
+		return false;
+	size_t size = MeshCodec::GetDecodedSize(&compressed[0], compressed.size());
+	if (size != cooked.size())
+		return false;
+	std::vector<BYTE> decoded(size);
+	return MeshCodec::Decode(&compressed[0], compressed.size(), &decoded[0], decoded.size()) && decoded == cooked;
+}
+
+TEST(MeshCodecVerticesRoundTrip)
+{
+	// Counts around the group and block sizes, and strides from one word to a whole Vertex
+	std::mt19937 random(4);
+	const UINT counts[] = { 1, 15, 16, 17, 255, 256, 257, 1000 };
+	const UINT strides[] = { 4, 12, sizeof(Vertex) };
+	for (UINT count : counts)
+	{
+		for (UINT stride : strides)
+		{
+			// Slowly changing words like positions, words that jump anywhere and words at the ends of the range
+			std::vector<BYTE> vertices((size_t)count * stride);
+			UINT* words = (UINT*)&vertices[0];
+			for (UINT i = 0; i < count * stride / 4; i++)
+			{
+				UINT kind = i % 3;
+				words[i] = kind == 0 ? 1000 + i * 3 + random() % 5 : kind == 1 ? (UINT)random() : (random() % 2 ? 0xFFFFFFFF : 0);
+			}
+
+			std::vector<BYTE> encoded;
+			MeshCodec::EncodeVertices(&vertices[0], count, stride, encoded);
+			std::vector<BYTE> decoded(vertices.size(), 0xCD);
+			size_t read = MeshCodec::DecodeVertices(&encoded[0], encoded.size(), count, stride, &decoded[0]);
+			CHECK_EQUAL(encoded.size(), read);
+			CHECK(decoded == vertices);
+		}
+	}
+
+	// A constant stream packs to the group headers, a byte per four groups of each plane, and its first value
+	std::vector<UINT> constant(1024, 7);
+	std::vector<BYTE> encoded;
+	MeshCodec::EncodeVertices((const BYTE*)&constant[0], 1024, 4, encoded);
+	CHECK(encoded.size() <= 1024 / 16 + 16);
+
+	// Strides that aren't whole words or are too wide are refused
+	std::vector<BYTE> out(1024);
+	CHECK_EQUAL((size_t)0, MeshCodec::DecodeVertices(&encoded[0], encoded.size(), 16, 6, &out[0]));
+	CHECK_EQUAL((size_t)0, MeshCodec::DecodeVertices(&encoded[0], encoded.size(), 1, 65 * 4, &out[0]));
+}
+
+TEST(MeshCodecIndicesRoundTrip)
+{
+	// A grid in strip order hits the FIFO and the next vertex, random indices and huge ones need explicit codes
+	std::vector<UINT> grid;
+	for (UINT z = 0; z < 40; z++)
+	{
+		for (UINT x = 0; x < 40; x++)
+		{
+			UINT corner = z * 41 + x;
+			UINT quad[6] = { corner, corner + 41, corner + 1, corner + 1, corner + 41, corner + 42 };
+			grid.insert(grid.end(), quad, quad + 6);
+		}
+	}
+	std::mt19937 random(6);
+	std::vector<UINT> scattered(999);
+	for (UINT& index : scattered)
+		index = random() % 100000;
+	std::vector<UINT> extremes = { 0xFFFFFFFF, 0, 0x80000000, 0x7FFFFFFF, 1, 0xFFFFFFFE, 0 };
+
+	const std::vector<UINT>* lists[] = { &grid, &scattered, &extremes };
+	for (const std::vector<UINT>* list : lists)
+	{
+		std::vector<BYTE> encoded;
+		MeshCodec::EncodeIndices(&(*list)[0], (UINT)list->size(), encoded);
+		std::vector<UINT> decoded(list->size());
+		CHECK_EQUAL(encoded.size(), MeshCodec::DecodeIndices(&encoded[0], encoded.size(), (UINT)list->size(), &decoded[0]));
+		CHECK(decoded == *list);
+	}
+
+	// Most grid indices fit their 4 bit code, under a byte each against 4 uncompressed
+	std::vector<BYTE> encoded;
+	MeshCodec::EncodeIndices(&grid[0], (UINT)grid.size(), encoded);
+	CHECK(encoded.size() < grid.size());
+
+	// The wrong count, and an explicit index whose continuation bits never stop, are refused. 15 is the explicit code
+	std::vector<UINT> decoded(grid.size() + 2);
+	CHECK_EQUAL((size_t)0, MeshCodec::DecodeIndices(&encoded[0], encoded.size(), (UINT)grid.size() + 2, &decoded[0]));
+	const BYTE endless[] = { 1, 0, 0, 0, 15, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+	CHECK_EQUAL((size_t)0, MeshCodec::DecodeIndices(endless, sizeof(endless), 1, &decoded[0]));
+	CHECK_EQUAL((size_t)0, MeshCodec::DecodeIndices(endless, 6, 1, &decoded[0]));
+}
+
+TEST(MeshCodecEntropyRoundTrip)
+{
+	// Skewed bytes, every byte value evenly, a single repeated byte, nothing at all, and frequencies growing like the
+	// Fibonacci numbers, whose plain Huffman codes would be far longer than the 12 bit limit
+	std::mt19937 random(12);
+	std::vector<BYTE> skewed(50000);
+	for (BYTE& value : skewed)
+		value = (BYTE)(random() % 100 < 80 ? random() % 4 : random());
+	std::vector<BYTE> even(4096);
+	for (size_t i = 0; i < even.size(); i++)
+		even[i] = (BYTE)i;
+	std::vector<BYTE> single(1000, 42);
+	std::vector<BYTE> empty;
+	std::vector<BYTE> fibonacci;
+	UINT64 a = 1, b = 1;
+	for (UINT symbol = 0; symbol < 24; symbol++, b += a, a = b - a)
+		fibonacci.insert(fibonacci.end(), (size_t)a, (BYTE)symbol);
+	std::shuffle(fibonacci.begin(), fibonacci.end(), random);
+
+	const std::vector<BYTE>* inputs[] = { &skewed, &even, &single, &empty, &fibonacci };
+	for (const std::vector<BYTE>* input : inputs)
+	{
+		std::vector<BYTE> encoded;
+		MeshCodec::EncodeEntropy(input->empty() ? NULL : &(*input)[0], input->size(), encoded);
+		std::vector<BYTE> decoded(input->size() + 1, 0xCD);
+		CHECK_EQUAL(encoded.size(), MeshCodec::DecodeEntropy(&encoded[0], encoded.size(), &decoded[0], input->size()));
+		CHECK(std::equal(input->begin(), input->end(), decoded.begin()));
+		CHECK_EQUAL(0xCD, decoded[input->size()]);
+	}
+
+	// Skewed data shrinks, a lone byte takes one bit each
+	std::vector<BYTE> encoded;
+	MeshCodec::EncodeEntropy(&skewed[0], skewed.size(), encoded);
+	CHECK(encoded.size() < skewed.size() * 6 / 10);
+	encoded.clear();
+	MeshCodec::EncodeEntropy(&single[0], single.size(), encoded);
+	CHECK(encoded.size() < 128 + 4 + single.size() / 8 + 16);
+
+	// Lengths that oversubscribe the code are refused: every byte value at 1 bit
+	std::vector<BYTE> oversubscribed(encoded);
+	memset(&oversubscribed[0], 0x11, 128);
+	std::vector<BYTE> decoded(single.size());
+	CHECK_EQUAL((size_t)0, MeshCodec::DecodeEntropy(&oversubscribed[0], oversubscribed.size(), &decoded[0], decoded.size()));
+
+	// Asking for more bytes than the stream holds runs out and fails
+	std::vector<BYTE> more(single.size() * 2);
+	CHECK_EQUAL((size_t)0, MeshCodec::DecodeEntropy(&encoded[0], encoded.size(), &more[0], more.size()));
+}
+
+TEST(MeshCodecMeshesRoundTrip)
+{
+	std::vector<BYTE> cooked;
+	CreateCookedGrid(64, 10.0f, cooked);
+	CookedMesh parsed;
+	REQUIRE(ParseCookedMesh(&cooked[0], cooked.size(), parsed));
+	REQUIRE(parsed.header.numMeshlets > 0);
+
+	// Both stages, the Huffman one kept because it helps here, and the mesh still parses once decoded
+	std::vector<BYTE> plain, entropy;
+	CHECK(RoundTrips(cooked, false, plain));
+	CHECK(RoundTrips(cooked, true, entropy));
+	CompressedMeshHeader header;
+	memcpy(&header, &plain[0], sizeof(header));
+	CHECK_EQUAL(0u, header.flags);
+	memcpy(&header, &entropy[0], sizeof(header));
+	CHECK_EQUAL((UINT)MeshCodecEntropy, header.flags);
+	CHECK(entropy.size() < plain.size());
+	CHECK(plain.size() < cooked.size() / 2);
+
+	CHECK(MeshCodec::IsCompressed(&plain[0], plain.size()));
+	CHECK(!MeshCodec::IsCompressed(&cooked[0], cooked.size()));
+	CHECK_EQUAL((size_t)0, MeshCodec::GetDecodedSize(&cooked[0], cooked.size()));
+
+	// A small mesh, and a mesh without meshlets, whose empty sections still round trip
+	std::vector<BYTE> small;
+	CreateCookedGrid(1, 10.0f, small);
+	std::vector<BYTE> compressed;
+	CHECK(RoundTrips(small, true, compressed));
+	MeshData bare;
+	Vertex corner(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT2(0.0f, 0.0f));
+	bare.vertices.assign(3, corner);
+	bare.indices.push_back(0);
+	bare.indices.push_back(1);
+	bare.indices.push_back(2);
+	std::vector<BYTE> bareCooked;
+	SerializeMesh(bare, bareCooked);
+	CHECK(RoundTrips(bareCooked, false, compressed));
+
+	// Only cooked meshes are encoded, and the output has to be large enough
+	std::vector<BYTE> notCooked(cooked.begin() + 4, cooked.end());
+	CHECK(!MeshCodec::Encode(&notCooked[0], notCooked.size(), false, compressed));
+	std::vector<BYTE> tooSmall(cooked.size() - 1);
+	CHECK(!MeshCodec::Decode(&plain[0], plain.size(), &tooSmall[0], tooSmall.size()));
+}
+
+TEST(MeshCodecRefusesCorruptInput)
+{
+	std::vector<BYTE> cooked;
+	CreateCookedGrid(20, 10.0f, cooked);
+	std::vector<BYTE> decoded(cooked.size());
+
+	for (UINT pass = 0; pass < 2; pass++)
+	{
+		std::vector<BYTE> compressed;
+		REQUIRE(MeshCodec::Encode(&cooked[0], cooked.size(), pass == 1, compressed));
+
+		// Every truncation is refused, whether or not the header's payload size is fixed up to match. The copy is exactly
+		// as long as the truncated data, so reading past it would be caught by a memory checker
+		bool truncated = true;
+		for (size_t size = 0; size < compressed.size(); size += 1 + size / 64)
+		{
+			std::vector<BYTE> cut(compressed.begin(), compressed.begin() + size);
+			truncated &= !MeshCodec::Decode(cut.empty() ? NULL : &cut[0], cut.size(), &decoded[0], decoded.size());
+			if (size >= sizeof(CompressedMeshHeader))
+			{
+				UINT payloadSize = (UINT)(size - sizeof(CompressedMeshHeader));
+				memcpy(&cut[offsetof(CompressedMeshHeader, payloadSize)], &payloadSize, sizeof(UINT));
+				truncated &= !MeshCodec::Decode(&cut[0], cut.size(), &decoded[0], decoded.size());
+			}
+		}
+		CHECK(truncated);
+
+		// Wrong magic, raw size or flags
+		const size_t fields[] = { offsetof(CompressedMeshHeader, magic), offsetof(CompressedMeshHeader, rawSize),
+			offsetof(CompressedMeshHeader, flags) };
+		for (size_t field : fields)
+		{
+			std::vector<BYTE> damaged(compressed);
+			damaged[field] ^= 1;
+			CHECK(!MeshCodec::Decode(&damaged[0], damaged.size(), &decoded[0], decoded.size()));
+		}
+
+		// Flipped bytes anywhere in the payload either fail or decode to a mesh of the same layout, never more bytes.
+		// Vertex values aren't checksummed, so some flips decode to different numbers
+		std::mt19937 random(pass + 1);
+		UINT refused = 0;
+		bool parses = true;
+		for (UINT trial = 0; trial < 300; trial++)
+		{
+			std::vector<BYTE> damaged(compressed);
+			size_t at = sizeof(CompressedMeshHeader) + random() % (damaged.size() - sizeof(CompressedMeshHeader));
+			damaged[at] ^= (BYTE)(1 + random() % 255);
+			std::vector<BYTE> out(cooked.size());
+			if (!MeshCodec::Decode(&damaged[0], damaged.size(), &out[0], out.size()))
+			{
+				refused++;
+				continue;
+			}
+			CookedMesh mesh;
+			CookedMeshHeader original;
+			memcpy(&original, &cooked[0], sizeof(original));
+			parses &= !ParseCookedMesh(&out[0], out.size(), mesh) || memcmp(&mesh.header, &original, sizeof(original)) == 0;
+		}
+		CHECK(parses);
+		CHECK(refused > 0);
+	}
+}
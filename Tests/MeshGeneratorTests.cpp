@@ -0,0 +1,146 @@
+//
+// Generated spheres and planes have the vertex and index counts their formulas give, fill exactly that memory and
+// weld their shared edges: no two vertices sit at the same place and every edge inside the mesh has a triangle on
+// each side
+//
+
+#include "Test.h"
+#include "MeshGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+// Written to the vertex past the end of the generated ones, which generation must leave alone
+static const float Untouched = -12345.0f;
+
+/// <summary>Counts how many triangles use each edge, in either direction
+/// </summary>
+static void CountEdges(const std::vector<UINT>& indices, std::unordered_map<UINT64, UINT>& edges)
+{
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		for (UINT side = 0; side < 3; side++)
+		{
+			UINT a = indices[i + side], b = indices[i + (side + 1) % 3];
+			edges[a < b ? ((UINT64)a << 32) | b : ((UINT64)b << 32) | a]++;
+		}
+	}
+}
+
+/// <summary>True if no two vertices share a position
+/// </summary>
+static bool AllPositionsDistinct(const Vertex* vertices, UINT count)
+{
+	std::vector<XMFLOAT3> positions(count);
+	for (UINT i = 0; i < count; i++)
+		positions[i] = vertices[i].Position;
+	auto less = [](const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return a.x != b.x ? a.x < b.x : a.y != b.y ? a.y < b.y : a.z < b.z;
+	};
+	std::sort(positions.begin(), positions.end(), less);
+	for (UINT i = 1; i < count; i++)
+	{
+		if (!less(positions[i - 1], positions[i]))
+			return false;
+	}
+	return true;
+}
+
+TEST(MeshGeneratorSphereCounts)
+{
+	UINT scale = 1;
+	for (UINT s = 0; s <= MeshGenerator::MaxSphereSubdivisions; s++, scale *= 4)
+	{
+		UINT vertexCount, indexCount;
+		MeshGenerator::GetSphereCounts(s, vertexCount, indexCount);
+		CHECK_EQUAL(10 * scale + 2, vertexCount);
+		CHECK_EQUAL(60 * scale, indexCount);
+	}
+
+	// Past the limit it stays at the limit, as generation does
+	UINT vertexCount, indexCount, limitVertices, limitIndices;
+	MeshGenerator::GetSphereCounts(MeshGenerator::MaxSphereSubdivisions, limitVertices, limitIndices);
+	MeshGenerator::GetSphereCounts(MeshGenerator::MaxSphereSubdivisions + 3, vertexCount, indexCount);
+	CHECK_EQUAL(limitVertices, vertexCount);
+	CHECK_EQUAL(limitIndices, indexCount);
+}
+
+TEST(MeshGeneratorSphereIsWelded)
+{
+	// 7 subdivisions is past the size generated across threads
+	const float radius = 2.5f;
+	const UINT subdivisions[] = { 0, 1, 3, 7 };
+	for (UINT s : subdivisions)
+	{
+		UINT vertexCount, indexCount;
+		MeshGenerator::GetSphereCounts(s, vertexCount, indexCount);
+		std::vector<Vertex> vertices(vertexCount + 1);
+		std::vector<UINT> indices(indexCount);
+		vertices[vertexCount].Position = XMFLOAT3(Untouched, Untouched, Untouched);
+		MeshGenerator::WriteSphere(radius, s, &vertices[0], &indices[0]);
+		CHECK_EQUAL(Untouched, vertices[vertexCount].Position.x);
+
+		// Every vertex is used and lies on the sphere
+		std::vector<bool> used(vertexCount, false);
+		bool inRange = true;
+		for (UINT index : indices)
+		{
+			inRange &= index < vertexCount;
+			if (index < vertexCount)
+				used[index] = true;
+		}
+		REQUIRE(inRange);
+		CHECK(std::count(used.begin(), used.end(), false) == 0);
+		float worst = 0.0f;
+		for (UINT i = 0; i < vertexCount; i++)
+		{
+			const XMFLOAT3& p = vertices[i].Position;
+			worst = max(worst, std::fabs(std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z) - radius));
+		}
+		CHECK(worst < 1e-4f);
+
+		// Closed: each of the 30 * 4^s edges is shared by exactly two triangles, and no vertex is duplicated
+		std::unordered_map<UINT64, UINT> edges;
+		CountEdges(indices, edges);
+		CHECK_EQUAL(indexCount / 2, (UINT)edges.size());
+		bool shared = true;
+		for (const auto& edge : edges)
+			shared &= edge.second == 2;
+		CHECK(shared);
+		CHECK(AllPositionsDistinct(&vertices[0], vertexCount));
+	}
+}
+
+TEST(MeshGeneratorPlaneIsWelded)
+{
+	// The last size is past the one generated across threads
+	const UINT sizes[][2] = { { 2, 2 }, { 1, 5 }, { 7, 3 }, { 300, 260 } };
+	for (const UINT* size : sizes)
+	{
+		UINT n = max(size[0], 2u), m = max(size[1], 2u);
+		UINT vertexCount, indexCount;
+		MeshGenerator::GetPlaneCounts(size[0], size[1], vertexCount, indexCount);
+		CHECK_EQUAL(n * m, vertexCount);
+		CHECK_EQUAL(6 * (n - 1) * (m - 1), indexCount);
+
+		std::vector<Vertex> vertices(vertexCount + 1);
+		std::vector<UINT> indices(indexCount);
+		vertices[vertexCount].Position = XMFLOAT3(Untouched, Untouched, Untouched);
+		MeshGenerator::WritePlane(10.0f, 8.0f, size[0], size[1], &vertices[0], &indices[0]);
+		CHECK_EQUAL(Untouched, vertices[vertexCount].Position.x);
+		CHECK(std::count_if(indices.begin(), indices.end(), [&](UINT index) { return index >= vertexCount; }) == 0);
+		CHECK(AllPositionsDistinct(&vertices[0], vertexCount));
+
+		// Edges inside the plane have two triangles, the border and nothing else one: n - 1 and m - 1 per side
+		std::unordered_map<UINT64, UINT> edges;
+		CountEdges(indices, edges);
+		UINT border = 0, inside = 0, other = 0;
+		for (const auto& edge : edges)
+			(edge.second == 1 ? border : edge.second == 2 ? inside : other)++;
+		CHECK_EQUAL(2 * (n - 1) + 2 * (m - 1), border);
+		CHECK_EQUAL(0u, other);
+		CHECK_EQUAL(indexCount / 3 * 3, 2 * inside + border);
+	}
+}
@@ -0,0 +1,264 @@
+//
+// Simplification measured on meshes with known surfaces: flat patches collapse to their corners with no error, a sphere's
+// levels shrink by the ratio asked for, stay closed and never stray from the sphere further than the error they report,
+// and attribute seams and open borders stay where they are
+//
+
+#include "Test.h"
+#include "MeshSimplifier.h"
+#include "TestMeshes.h"
+
+#include <cfloat>
+#include <map>
+#include <set>
+
+static XMFLOAT3 Position(const MeshData& mesh, UINT index)
+{
+	return mesh.vertices[index].Position;
+}
+
+static XMVECTOR FaceNormal(const MeshData& mesh, const UINT* triangle)
+{
+	XMFLOAT3 p0 = Position(mesh, triangle[0]), p1 = Position(mesh, triangle[1]), p2 = Position(mesh, triangle[2]);
+	XMVECTOR a = XMLoadFloat3(&p0), b = XMLoadFloat3(&p1), c = XMLoadFloat3(&p2);
+	return XMVector3Cross(b - a, c - a);
+}
+
+/// <summary>Every edge between positions is used once each way, so the surface has no holes, cracks or flipped triangles
+/// </summary>
+static bool IsClosed(const MeshData& mesh, const UINT* indices, UINT indexCount)
+{
+	std::map<std::pair<std::vector<float>, std::vector<float> >, int> edges;
+	for (UINT i = 0; i < indexCount; i++)
+	{
+		XMFLOAT3 a = Position(mesh, indices[i]);
+		XMFLOAT3 b = Position(mesh, indices[i % 3 == 2 ? i - 2 : i + 1]);
+		std::vector<float> from(&a.x, &a.x + 3), to(&b.x, &b.x + 3);
+		if (from == to)
+			return false;
+		edges[std::make_pair(from, to)]++;
+	}
+	for (const auto& edge : edges)
+	{
+		auto reverse = edges.find(std::make_pair(edge.first.second, edge.first.first));
+		if (edge.second != 1 || reverse == edges.end() || reverse->second != 1)
+			return false;
+	}
+	return true;
+}
+
+/// <summary>Farthest any point of the triangles lies inside the sphere, sampled on a grid over each triangle
+/// Every vertex is on the sphere, so this is how far the level strays from it
+/// </summary>
+static float MeasureSphereError(const MeshData& mesh, float radius, const UINT* indices, UINT indexCount)
+{
+	const UINT Steps = 8;
+	float worst = 0.0f;
+	for (UINT i = 0; i < indexCount; i += 3)
+	{
+		XMFLOAT3 p0 = Position(mesh, indices[i]), p1 = Position(mesh, indices[i + 1]), p2 = Position(mesh, indices[i + 2]);
+		for (UINT s = 0; s <= Steps; s++)
+		{
+			for (UINT t = 0; s + t <= Steps; t++)
+			{
+				float u = (float)s / Steps, v = (float)t / Steps, w = 1.0f - u - v;
+				XMVECTOR p = XMLoadFloat3(&p0) * w + XMLoadFloat3(&p1) * u + XMLoadFloat3(&p2) * v;
+				worst = max(worst, radius - XMVectorGetX(XMVector3Length(p)));
+			}
+		}
+	}
+	return worst;
+}
+
+TEST(MeshSimplifierCollapsesFlatGridToCorners)
+{
+	MeshData grid;
+	CreateGrid(16, 16.0f, 0.0f, 0, grid);
+
+	SimplifyOptions options;
+	std::vector<UINT> result;
+	float error = MeshSimplifier::Simplify(&grid.vertices[0], (UINT)grid.vertices.size(), &grid.indices[0],
+		(UINT)grid.indices.size(), 6, options, result);
+	CHECK_EQUAL(6u, (UINT)result.size());
+	CHECK_NEAR(0.0f, error, 1e-4f);
+
+	// The two triangles left span the whole grid, facing up, from its corners
+	float area = 0.0f;
+	std::set<UINT> corners;
+	for (size_t i = 0; i < result.size(); i += 3)
+	{
+		XMVECTOR normal = FaceNormal(grid, &result[i]);
+		CHECK(XMVectorGetY(normal) > 0.0f);
+		area += XMVectorGetX(XMVector3Length(normal)) * 0.5f;
+		corners.insert(result.begin() + i, result.begin() + i + 3);
+	}
+	CHECK_NEAR(256.0f, area, 1e-3f);
+	for (UINT corner : corners)
+	{
+		XMFLOAT3 p = Position(grid, corner);
+		CHECK((p.x == 0.0f || p.x == 16.0f) && (p.z == 0.0f || p.z == 16.0f));
+	}
+}
+
+TEST(MeshSimplifierBuildsShrinkingSphereLevels)
+{
+	const float Radius = 2.0f;
+	MeshData sphere;
+	CreateSphere(Radius, 24, sphere);
+	UINT fullCount = (UINT)sphere.indices.size();
+	REQUIRE(IsClosed(sphere, &sphere.indices[0], fullCount));
+
+	SimplifyOptions options;
+	std::vector<MeshLOD> lods;
+	MeshSimplifier::BuildLODs(&sphere.vertices[0], (UINT)sphere.vertices.size(), sphere.indices, lods, options);
+	REQUIRE(lods.size() >= 4);
+	CHECK(lods.size() <= options.maxLevels);
+	CHECK_EQUAL(0u, lods[0].indexStart);
+	CHECK_EQUAL(fullCount, lods[0].indexCount);
+	CHECK_EQUAL(0.0f, lods[0].error);
+
+	// The full mesh's own distance from the sphere, levels can't be closer than that
+	float baseError = MeasureSphereError(sphere, Radius, &sphere.indices[0], fullCount);
+	float maxError = options.maxError * Radius * sqrtf(3.0f);
+	for (size_t i = 1; i < lods.size(); i++)
+	{
+		const MeshLOD& lod = lods[i];
+		const MeshLOD& previous = lods[i - 1];
+		CHECK_EQUAL(previous.indexStart + previous.indexCount, lod.indexStart);
+		CHECK_EQUAL(0u, lod.indexCount % 3);
+
+		// Never less than a tenth fewer triangles, and the first levels reach levelRatio before the poles and the seam
+		// hold them up
+		CHECK(lod.indexCount * 10 <= previous.indexCount * 9);
+		if (i <= 2)
+			CHECK(lod.indexCount <= (UINT)(previous.indexCount * options.levelRatio) + 3);
+		CHECK(lod.error >= previous.error);
+		CHECK(lod.error <= maxError);
+
+		const UINT* level = &sphere.indices[lod.indexStart];
+		CHECK(IsClosed(sphere, level, lod.indexCount));
+		for (UINT j = 0; j < lod.indexCount; j += 3)
+			CHECK(XMVectorGetX(XMVector3Dot(FaceNormal(sphere, level + j), XMLoadFloat3(&sphere.vertices[level[j]].Position))) > 0.0f);
+
+		// The reported error is a distance to the planes the vertices gathered, measured against the sphere it has to
+		// bound the flattening the collapses added
+		float measured = MeasureSphereError(sphere, Radius, level, lod.indexCount);
+		CHECK(measured <= baseError + lod.error * 2.0f);
+	}
+}
+
+TEST(MeshSimplifierStopsAtTheErrorLimit)
+{
+	MeshData sphere;
+	CreateSphere(1.0f, 16, sphere);
+
+	// Any collapse on a sphere costs some error, so a tiny limit keeps almost everything
+	SimplifyOptions options;
+	options.maxError = 1e-4f;
+	std::vector<UINT> result;
+	float error = MeshSimplifier::Simplify(&sphere.vertices[0], (UINT)sphere.vertices.size(), &sphere.indices[0],
+		(UINT)sphere.indices.size(), 3, options, result);
+	CHECK(error <= options.maxError * sqrtf(3.0f));
+	CHECK(result.size() * 10 > sphere.indices.size() * 9);
+
+	// A loose limit reaches the target, counted in whole triangles
+	options.maxError = 1.0f;
+	UINT target = (UINT)sphere.indices.size() / 4;
+	error = MeshSimplifier::Simplify(&sphere.vertices[0], (UINT)sphere.vertices.size(), &sphere.indices[0],
+		(UINT)sphere.indices.size(), target + 2, options, result);
+	CHECK(result.size() <= target);
+	CHECK(result.size() * 2 >= target);
+	CHECK(error > 0.0f);
+	CHECK(IsClosed(sphere, &result[0], (UINT)result.size()));
+
+	// Nothing to do
+	error = MeshSimplifier::Simplify(&sphere.vertices[0], (UINT)sphere.vertices.size(), &sphere.indices[0],
+		(UINT)sphere.indices.size(), (UINT)sphere.indices.size(), options, result);
+	CHECK_EQUAL(0.0f, error);
+	CHECK(result == sphere.indices);
+}
+
+TEST(MeshSimplifierKeepsSeamsAndBorders)
+{
+	// A box of six subdivided faces with their own normals, every edge of the box is a normal seam. Some of the generated
+	// positions come out as -0, they have to meet their +0 partners on the other face all the same
+	MeshData box;
+	const XMFLOAT3 axes[3] = { XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 1.0f) };
+	for (UINT face = 0; face < 6; face++)
+	{
+		XMVECTOR normal = XMLoadFloat3(&axes[face / 2]) * (face % 2 ? -1.0f : 1.0f);
+		XMVECTOR u = XMLoadFloat3(&axes[(face / 2 + 1) % 3]);
+		XMVECTOR v = XMVector3Cross(normal, u);
+		UINT first = (UINT)box.vertices.size();
+		for (UINT y = 0; y <= 4; y++)
+		{
+			for (UINT x = 0; x <= 4; x++)
+			{
+				XMFLOAT3 p, n, t;
+				XMStoreFloat3(&p, normal + u * (x * 0.5f - 1.0f) + v * (y * 0.5f - 1.0f));
+				XMStoreFloat3(&n, normal);
+				XMStoreFloat3(&t, u);
+				box.vertices.push_back(MakeVertex(p, XMFLOAT2(x * 0.25f, y * 0.25f), n, t));
+			}
+		}
+		for (UINT y = 0; y < 4; y++)
+		{
+			for (UINT x = 0; x < 4; x++)
+			{
+				UINT a = first + y * 5 + x;
+				UINT quad[6] = { a, a + 5, a + 1, a + 1, a + 5, a + 6 };
+				box.indices.insert(box.indices.end(), quad, quad + 6);
+			}
+		}
+	}
+	XMVECTOR firstNormal = FaceNormal(box, &box.indices[0]);
+	if (XMVectorGetX(XMVector3Dot(firstNormal, XMLoadFloat3(&box.vertices[box.indices[0]].Normal))) < 0.0f)
+	{
+		for (size_t i = 0; i < box.indices.size(); i += 3)
+			std::swap(box.indices[i + 1], box.indices[i + 2]);
+	}
+	REQUIRE(IsClosed(box, &box.indices[0], (UINT)box.indices.size()));
+
+	SimplifyOptions options;
+	std::vector<UINT> result;
+	float error = MeshSimplifier::Simplify(&box.vertices[0], (UINT)box.vertices.size(), &box.indices[0],
+		(UINT)box.indices.size(), 3, options, result);
+	CHECK_NEAR(0.0f, error, 1e-4f);
+	CHECK_EQUAL(36u, (UINT)result.size());
+	CHECK(IsClosed(box, &result[0], (UINT)result.size()));
+
+	// Each triangle still takes all of its corners from one face
+	for (size_t i = 0; i < result.size(); i += 3)
+	{
+		const Vertex& a = box.vertices[result[i]];
+		for (UINT k = 1; k < 3; k++)
+		{
+			const Vertex& b = box.vertices[result[i + k]];
+			CHECK(a.Normal.x == b.Normal.x && a.Normal.y == b.Normal.y && a.Normal.z == b.Normal.z);
+		}
+	}
+
+	// A grid with its middle row raised into a ridge keeps its outline, the ridge and the creases either side of it,
+	// four flat strips of two triangles each. Flattening any of them would pass the error limit
+	MeshData grid;
+	CreateGrid(8, 8.0f, 0.0f, 0, grid);
+	for (Vertex& vertex : grid.vertices)
+	{
+		if (vertex.Position.z == 4.0f)
+			vertex.Position.y = 4.0f;
+	}
+	options.maxError = 0.01f;
+	error = MeshSimplifier::Simplify(&grid.vertices[0], (UINT)grid.vertices.size(), &grid.indices[0],
+		(UINT)grid.indices.size(), 3, options, result);
+	float minX = FLT_MAX, maxX = -FLT_MAX, minZ = FLT_MAX, maxZ = -FLT_MAX;
+	for (UINT index : result)
+	{
+		minX = min(minX, grid.vertices[index].Position.x);
+		maxX = max(maxX, grid.vertices[index].Position.x);
+		minZ = min(minZ, grid.vertices[index].Position.z);
+		maxZ = max(maxZ, grid.vertices[index].Position.z);
+	}
+	CHECK(minX == 0.0f && maxX == 8.0f && minZ == 0.0f && maxZ == 8.0f);
+	CHECK_EQUAL(8u * 3, (UINT)result.size());
+	CHECK_NEAR(0.0f, error, 1e-4f);
+}
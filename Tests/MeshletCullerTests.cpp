@@ -0,0 +1,251 @@
+//
+// Meshlets built from a sphere and a flat grid, whose facing is known everywhere: building covers every triangle once
+// within the size limits and with bounds that hold the meshlet's vertices and normals. Culling through CullInto never
+// drops a triangle with a corner in the frustum or facing the eye, and does drop what is outside or turned away
+//
+
+#include "Test.h"
+#include "MeshletCuller.h"
+#include "TestMeshes.h"
+
+#include <algorithm>
+#include <set>
+
+typedef std::vector<UINT> TriangleList;
+
+static XMVECTOR GetFaceNormal(const MeshData& mesh, const UINT* triangle)
+{
+	XMVECTOR a = XMLoadFloat3(&mesh.vertices[triangle[0]].Position);
+	XMVECTOR b = XMLoadFloat3(&mesh.vertices[triangle[1]].Position);
+	XMVECTOR c = XMLoadFloat3(&mesh.vertices[triangle[2]].Position);
+	return XMVector3Cross(b - a, c - a);
+}
+
+static void Build(const MeshData& mesh, MeshletData& meshlets)
+{
+	MeshletBuilder::Build(&mesh.vertices[0], (UINT)mesh.vertices.size(), &mesh.indices[0], (UINT)mesh.indices.size(), 1, meshlets);
+}
+
+/// <summary>Triangles as their corners rotated to start at the smallest, so the same triangle always compares equal
+/// </summary>
+static std::multiset<std::vector<UINT> > GetTriangleSet(const UINT* indices, UINT indexCount)
+{
+	std::multiset<std::vector<UINT> > triangles;
+	for (UINT i = 0; i + 2 < indexCount; i += 3)
+	{
+		std::vector<UINT> triangle(indices + i, indices + i + 3);
+		std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+		triangles.insert(triangle);
+	}
+	return triangles;
+}
+
+static MeshletJob MakeJob(const MeshletData& meshlets, CXMMATRIX world)
+{
+	MeshletJob job;
+	job.meshlets = &meshlets;
+	XMStoreFloat4x4(&job.world, world);
+	job.indexStart = 0;
+	job.indexCount = 0;
+	job.meshletsVisible = 0;
+	return job;
+}
+
+static MeshletView LookAt(const XMFLOAT3& eye, const XMFLOAT3& target, float fov)
+{
+	XMFLOAT4X4 viewProjection;
+	XMMATRIX view = XMMatrixLookAtLH(XMLoadFloat3(&eye), XMLoadFloat3(&target), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMStoreFloat4x4(&viewProjection, view * XMMatrixPerspectiveFovLH(fov, 1.0f, 0.1f, 500.0f));
+	return MeshletCuller::PerspectiveView(viewProjection, eye);
+}
+
+TEST(MeshletBuilderCoversEveryTriangleOnce)
+{
+	MeshData sphere;
+	CreateSphere(10.0f, 32, sphere);
+	MeshletData meshlets;
+	Build(sphere, meshlets);
+	REQUIRE(meshlets.meshlets.size() > 10);
+	CHECK_EQUAL(meshlets.GetBoundsStride() * (UINT)MeshletBoundsStreams, (UINT)meshlets.bounds.size());
+
+	// Unpacking gives back the mesh's triangles, each wound as it was
+	TriangleList unpacked;
+	MeshletBuilder::Unpack(meshlets, unpacked);
+	CHECK(GetTriangleSet(&unpacked[0], (UINT)unpacked.size()) == GetTriangleSet(&sphere.indices[0], (UINT)sphere.indices.size()));
+
+	// Every meshlet within the limits, its sphere around its vertices and its cone around its triangles' normals
+	bool limits = true, enclosed = true, coned = true, packed = true;
+	UINT triangleOffset = 0;
+	for (UINT m = 0; m < meshlets.meshlets.size(); m++)
+	{
+		const Meshlet& meshlet = meshlets.meshlets[m];
+		limits &= meshlet.vertexCount <= MeshletMaxVertices && meshlet.triangleCount <= MeshletMaxTriangles && meshlet.triangleCount > 0;
+		packed &= meshlet.triangleOffset == triangleOffset;
+		triangleOffset += meshlet.triangleCount;
+
+		XMVECTOR center = XMVectorSet(meshlets.GetBounds(MeshletCenterX)[m], meshlets.GetBounds(MeshletCenterY)[m],
+			meshlets.GetBounds(MeshletCenterZ)[m], 0.0f);
+		float radius = meshlets.GetBounds(MeshletRadius)[m];
+		for (UINT v = 0; v < meshlet.vertexCount; v++)
+		{
+			XMVECTOR p = XMLoadFloat3(&sphere.vertices[meshlets.vertices[meshlet.vertexOffset + v]].Position);
+			enclosed &= XMVectorGetX(XMVector3Length(p - center)) <= radius * 1.0001f;
+		}
+
+		XMVECTOR axis = XMVectorSet(meshlets.GetBounds(MeshletConeX)[m], meshlets.GetBounds(MeshletConeY)[m],
+			meshlets.GetBounds(MeshletConeZ)[m], 0.0f);
+		float cutoff = meshlets.GetBounds(MeshletConeCutoff)[m];
+		float spread = sqrtf(max(1.0f - cutoff * cutoff, 0.0f));
+		for (UINT t = 0; t < meshlet.triangleCount && cutoff < 1.0f; t++)
+		{
+			UINT triangle[3];
+			for (UINT k = 0; k < 3; k++)
+				triangle[k] = meshlets.vertices[meshlet.vertexOffset + meshlets.triangles[(meshlet.triangleOffset + t) * 3 + k]];
+			XMVECTOR normal = XMVector3Normalize(GetFaceNormal(sphere, triangle));
+			coned &= XMVectorGetX(XMVector3Dot(normal, axis)) >= spread - 1e-4f;
+		}
+	}
+	CHECK(limits);
+	CHECK(enclosed);
+	CHECK(coned);
+	CHECK(packed);
+
+	// A flat patch's meshlets face straight up with no spread
+	MeshData grid;
+	CreateGrid(16, 16.0f, 0.0f, 0, grid);
+	Build(grid, meshlets);
+	REQUIRE(!meshlets.meshlets.empty());
+	bool flat = true;
+	for (UINT m = 0; m < meshlets.meshlets.size(); m++)
+		flat &= meshlets.GetBounds(MeshletConeY)[m] > 0.9999f && meshlets.GetBounds(MeshletConeCutoff)[m] < 1e-3f;
+	CHECK(flat);
+
+	// Meshes under the minimum get none
+	MeshletBuilder::Build(&grid.vertices[0], (UINT)grid.vertices.size(), &grid.indices[0], (UINT)grid.indices.size(),
+		(UINT)grid.indices.size() / 3 + 1, meshlets);
+	CHECK(meshlets.meshlets.empty());
+}
+
+TEST(MeshletCullerCullsAgainstTheFrustum)
+{
+	MeshData grid;
+	CreateGrid(64, 64.0f, 0.0f, 0, grid);
+	MeshletData meshlets;
+	Build(grid, meshlets);
+	UINT meshletCount = (UINT)meshlets.meshlets.size();
+
+	// Looking down at one corner of the grid from above, so the cone test keeps everything
+	MeshletView view = LookAt(XMFLOAT3(10.0f, 12.0f, 10.0f), XMFLOAT3(10.0f, 0.0f, 12.0f), XM_PIDIV4);
+
+	// The grid where it is and once far out of sight
+	MeshletJob jobs[2] = { MakeJob(meshlets, XMMatrixIdentity()), MakeJob(meshlets, XMMatrixTranslation(1000.0f, 0.0f, 0.0f)) };
+	MeshletCuller culler;
+	TriangleList indices(meshlets.triangles.size() * 6);
+	culler.CullInto(view, jobs, 2, &indices[0]);
+
+	// Jobs each get room for all their triangles one after another
+	CHECK_EQUAL(0u, jobs[0].indexStart);
+	CHECK_EQUAL((UINT)meshlets.triangles.size(), jobs[1].indexStart);
+
+	const MeshletCullStats& stats = culler.GetStats();
+	CHECK_EQUAL(2u, stats.objects);
+	CHECK_EQUAL(2 * meshletCount, stats.meshlets);
+	CHECK_EQUAL(stats.meshlets, stats.visible + stats.frustumCulled + stats.coneCulled);
+	CHECK_EQUAL(0u, stats.coneCulled);
+	CHECK_EQUAL(0u, jobs[1].indexCount);
+	CHECK_EQUAL(0u, jobs[1].meshletsVisible);
+	CHECK(jobs[0].meshletsVisible > 0 && jobs[0].meshletsVisible < meshletCount / 2);
+	CHECK_EQUAL(jobs[0].indexCount / 3, stats.triangles);
+
+	// Nothing with a corner inside the frustum is lost, and what is kept is whole meshlets of the mesh's own triangles
+	std::multiset<std::vector<UINT> > kept = GetTriangleSet(&indices[0], jobs[0].indexCount);
+	std::multiset<std::vector<UINT> > all = GetTriangleSet(&grid.indices[0], (UINT)grid.indices.size());
+	bool inside = true, known = true;
+	for (UINT i = 0; i < grid.indices.size(); i += 3)
+	{
+		bool seen = false;
+		for (UINT k = 0; k < 3; k++)
+		{
+			XMVECTOR p = XMLoadFloat3(&grid.vertices[grid.indices[i + k]].Position);
+			bool within = true;
+			for (UINT plane = 0; plane < 6; plane++)
+				within &= XMVectorGetX(XMVector3Dot(XMLoadFloat4(&view.planes[plane]), p)) + view.planes[plane].w > 0.0f;
+			seen |= within;
+		}
+		if (seen)
+			inside &= kept.count(*GetTriangleSet(&grid.indices[i], 3).begin()) == 1;
+	}
+	for (const std::vector<UINT>& triangle : kept)
+		known &= all.count(triangle) == 1;
+	CHECK(inside);
+	CHECK(known);
+
+	// Moving and scaling the grid and the view alike keeps the same triangles, the view goes into the mesh's space
+	MeshletView moved = LookAt(XMFLOAT3(70.0f, 24.0f, 20.0f), XMFLOAT3(70.0f, 0.0f, 24.0f), XM_PIDIV4);
+	MeshletJob scaled = MakeJob(meshlets, XMMatrixScaling(2.0f, 2.0f, 2.0f) * XMMatrixTranslation(50.0f, 0.0f, 0.0f));
+	culler.CullInto(moved, &scaled, 1, &indices[0]);
+	CHECK(GetTriangleSet(&indices[0], scaled.indexCount) == kept);
+}
+
+TEST(MeshletCullerCullsBackFacingCones)
+{
+	MeshData sphere;
+	CreateSphere(10.0f, 48, sphere);
+	MeshletData meshlets;
+	Build(sphere, meshlets);
+	UINT meshletCount = (UINT)meshlets.meshlets.size();
+
+	// The whole sphere in view, so only facing culls anything
+	XMFLOAT3 eye(0.0f, 5.0f, -40.0f);
+	MeshletView perspective = LookAt(eye, XMFLOAT3(0.0f, 0.0f, 0.0f), XM_PIDIV2);
+	XMFLOAT4X4 orthographicViewProjection;
+	XMStoreFloat4x4(&orthographicViewProjection, XMMatrixLookToLH(XMVectorSet(0.0f, 0.0f, -40.0f, 1.0f),
+		XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)) * XMMatrixOrthographicLH(30.0f, 30.0f, 0.1f, 100.0f));
+	MeshletView orthographic = MeshletCuller::OrthographicView(orthographicViewProjection, XMFLOAT3(0.0f, 0.0f, 1.0f));
+
+	MeshletCuller culler;
+	TriangleList indices(meshlets.triangles.size() * 3);
+	for (UINT pass = 0; pass < 2; pass++)
+	{
+		const MeshletView& view = pass == 0 ? perspective : orthographic;
+		MeshletJob job = MakeJob(meshlets, XMMatrixIdentity());
+		culler.CullInto(view, &job, 1, &indices[0]);
+		const MeshletCullStats& stats = culler.GetStats();
+		CHECK_EQUAL(0u, stats.frustumCulled);
+		CHECK(stats.coneCulled > meshletCount / 4);
+		CHECK(stats.coneCulled < meshletCount * 3 / 4);
+		CHECK_EQUAL(meshletCount, stats.visible + stats.coneCulled);
+
+		// Every triangle facing the view survives
+		std::multiset<std::vector<UINT> > kept = GetTriangleSet(&indices[0], job.indexCount);
+		bool facing = true;
+		UINT front = 0;
+		for (UINT i = 0; i < sphere.indices.size(); i += 3)
+		{
+			XMVECTOR a = XMLoadFloat3(&sphere.vertices[sphere.indices[i]].Position);
+			XMVECTOR toView = pass == 0 ? XMLoadFloat3(&eye) - a : XMVectorSet(0.0f, 0.0f, -1.0f, 0.0f);
+			if (XMVectorGetX(XMVector3Dot(GetFaceNormal(sphere, &sphere.indices[i]), toView)) <= 0.0f)
+				continue;
+			front++;
+			facing &= kept.count(*GetTriangleSet(&sphere.indices[i], 3).begin()) == 1;
+		}
+		CHECK(facing);
+		CHECK(job.indexCount / 3 < (UINT)sphere.indices.size() / 3);
+		CHECK(job.indexCount / 3 >= front);
+	}
+
+	// Mirrored, the cone test can't tell front from back and is skipped. Turned around, the other side is kept
+	MeshletJob mirrored = MakeJob(meshlets, XMMatrixScaling(-1.0f, 1.0f, 1.0f));
+	culler.CullInto(perspective, &mirrored, 1, &indices[0]);
+	CHECK_EQUAL(0u, culler.GetStats().coneCulled);
+	CHECK_EQUAL(meshletCount, culler.GetStats().visible);
+
+	MeshletJob front = MakeJob(meshlets, XMMatrixIdentity());
+	MeshletJob turned = MakeJob(meshlets, XMMatrixRotationY(XM_PI));
+	culler.CullInto(perspective, &front, 1, &indices[0]);
+	std::multiset<std::vector<UINT> > frontKept = GetTriangleSet(&indices[0], front.indexCount);
+	culler.CullInto(perspective, &turned, 1, &indices[0]);
+	std::multiset<std::vector<UINT> > turnedKept = GetTriangleSet(&indices[0], turned.indexCount);
+	CHECK(frontKept != turnedKept);
+	CHECK(culler.GetStats().coneCulled > meshletCount / 4);
+}
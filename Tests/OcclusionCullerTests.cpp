@@ -0,0 +1,296 @@
+//
+// Occlusion culling against scenes whose answers are known: objects behind walls are hidden, objects beside, in front of
+// or around them aren't, and on a random scene nothing culled has a pixel a ray cast through the buffer's pixel centers
+// would reach before hitting an occluder
+//
+
+#include "Test.h"
+#include "OcclusionCuller.h"
+
+#include <cfloat>
+
+// Buffer size and the camera's near and far planes, looking down +z from the origin unless a test moves it
+static const UINT BufferSize = 128;
+static const float NearZ = 1.0f;
+static const float FarZ = 100.0f;
+
+static XMFLOAT4X4 MakeViewProjection(XMFLOAT3 eye, XMFLOAT3 target)
+{
+	XMFLOAT4X4 viewProjection;
+	XMMATRIX view = XMMatrixLookAtLH(XMLoadFloat3(&eye), XMLoadFloat3(&target), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMStoreFloat4x4(&viewProjection, view * XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.0f, NearZ, FarZ));
+	return viewProjection;
+}
+
+static MeshBounds MakeBox(float x, float y, float z, float extentX, float extentY, float extentZ)
+{
+	MeshBounds box;
+	box.center = XMFLOAT3(x, y, z);
+	box.extents = XMFLOAT3(extentX, extentY, extentZ);
+	return box;
+}
+
+static XMFLOAT4X4 Identity()
+{
+	XMFLOAT4X4 world;
+	XMStoreFloat4x4(&world, XMMatrixIdentity());
+	return world;
+}
+
+static void BeginCamera(OcclusionCuller& culler)
+{
+	culler.Resize(BufferSize, BufferSize);
+	culler.Begin(MakeViewProjection(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 1.0f)));
+}
+
+static bool IsVisible(OcclusionCuller& culler, const MeshBounds& box)
+{
+	return culler.IsVisible(box, Identity());
+}
+
+/// <summary>Distance along the ray to where it enters the box, FLT_MAX if it misses
+/// </summary>
+static float IntersectBox(const XMFLOAT3& origin, const XMFLOAT3& direction, const MeshBounds& box)
+{
+	const float* o = &origin.x;
+	const float* d = &direction.x;
+	const float* c = &box.center.x;
+	const float* e = &box.extents.x;
+	float enter = 0.0f, exit = FLT_MAX;
+	for (int i = 0; i < 3; i++)
+	{
+		if (fabsf(d[i]) < 1e-8f)
+		{
+			if (o[i] < c[i] - e[i] || o[i] > c[i] + e[i])
+				return FLT_MAX;
+			continue;
+		}
+		float t0 = (c[i] - e[i] - o[i]) / d[i];
+		float t1 = (c[i] + e[i] - o[i]) / d[i];
+		enter = max(enter, min(t0, t1));
+		exit = min(exit, max(t0, t1));
+	}
+	return enter <= exit ? enter : FLT_MAX;
+}
+
+TEST(OcclusionCullerHidesObjectsBehindAWall)
+{
+	OcclusionCuller culler;
+	BeginCamera(culler);
+	culler.RenderBox(MakeBox(0.0f, 0.0f, 10.0f, 6.0f, 6.0f, 0.5f), Identity());
+	culler.End();
+
+	CHECK(!IsVisible(culler, MakeBox(0.0f, 0.0f, 20.0f, 1.0f, 1.0f, 1.0f)));
+	CHECK(!IsVisible(culler, MakeBox(3.0f, -3.0f, 40.0f, 4.0f, 4.0f, 1.0f)));
+
+	// In front of the wall, wider than it, and beside it
+	CHECK(IsVisible(culler, MakeBox(0.0f, 0.0f, 5.0f, 1.0f, 1.0f, 1.0f)));
+	CHECK(IsVisible(culler, MakeBox(0.0f, 0.0f, 20.0f, 14.0f, 1.0f, 1.0f)));
+	CHECK(IsVisible(culler, MakeBox(15.0f, 0.0f, 20.0f, 1.0f, 1.0f, 1.0f)));
+
+	const OcclusionStats& stats = culler.GetStats();
+	CHECK_EQUAL(1u, stats.occluders);
+	CHECK_EQUAL(2u, stats.occluderTriangles);
+	CHECK_EQUAL(5u, stats.tested);
+	CHECK_EQUAL(2u, stats.occluded);
+	CHECK_EQUAL(3u, stats.visible);
+	CHECK_EQUAL(0u, stats.outside);
+}
+
+TEST(OcclusionCullerMergesOccludersWithinSubtiles)
+{
+	// The seam between the walls falls inside a column of subtiles, neither wall covers them on its own
+	MeshBounds left = MakeBox(-2.815f, 0.0f, 10.0f, 3.185f, 6.0f, 0.5f);
+	MeshBounds right = MakeBox(3.185f, 0.0f, 10.0f, 2.815f, 6.0f, 0.5f);
+	MeshBounds behind = MakeBox(0.0f, 0.0f, 20.0f, 1.0f, 1.0f, 1.0f);
+
+	OcclusionCuller culler;
+	BeginCamera(culler);
+	culler.RenderBox(left, Identity());
+	culler.End();
+	CHECK(IsVisible(culler, behind));
+
+	BeginCamera(culler);
+	culler.RenderBox(right, Identity());
+	culler.End();
+	CHECK(IsVisible(culler, behind));
+
+	BeginCamera(culler);
+	culler.RenderBox(left, Identity());
+	culler.RenderBox(right, Identity());
+	culler.End();
+	CHECK(!IsVisible(culler, behind));
+}
+
+TEST(OcclusionCullerRejectsOutsideTheView)
+{
+	OcclusionCuller culler;
+	BeginCamera(culler);
+	culler.End();
+
+	CHECK(!IsVisible(culler, MakeBox(0.0f, 0.0f, -10.0f, 1.0f, 1.0f, 1.0f)));
+	CHECK(!IsVisible(culler, MakeBox(-200.0f, 0.0f, 20.0f, 1.0f, 1.0f, 1.0f)));
+	CHECK(!IsVisible(culler, MakeBox(0.0f, 0.0f, 150.0f, 1.0f, 1.0f, 1.0f)));
+	CHECK_EQUAL(3u, culler.GetStats().outside);
+
+	// Nothing is in the way of what is in view, and a box through the near plane can't be placed on screen
+	CHECK(IsVisible(culler, MakeBox(0.0f, 0.0f, 50.0f, 1.0f, 1.0f, 1.0f)));
+	CHECK(IsVisible(culler, MakeBox(0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f)));
+	CHECK_EQUAL(2u, culler.GetStats().visible);
+
+	// The same wall as the first test, only moved by its world matrix
+	XMFLOAT4X4 world;
+	XMStoreFloat4x4(&world, XMMatrixTranslation(0.0f, 0.0f, 10.0f));
+	BeginCamera(culler);
+	culler.RenderBox(MakeBox(0.0f, 0.0f, 0.0f, 6.0f, 6.0f, 0.5f), world);
+	culler.End();
+	CHECK(!culler.IsVisible(MakeBox(0.0f, 0.0f, 10.0f, 1.0f, 1.0f, 1.0f), world));
+}
+
+TEST(OcclusionCullerRendersFrontFacingMeshes)
+{
+	std::vector<Vertex> vertices;
+	vertices.push_back(Vertex(XMFLOAT3(-6.0f, 6.0f, 10.0f), XMFLOAT2(0.0f, 0.0f)));
+	vertices.push_back(Vertex(XMFLOAT3(6.0f, 6.0f, 10.0f), XMFLOAT2(1.0f, 0.0f)));
+	vertices.push_back(Vertex(XMFLOAT3(6.0f, -6.0f, 10.0f), XMFLOAT2(1.0f, 1.0f)));
+	vertices.push_back(Vertex(XMFLOAT3(-6.0f, -6.0f, 10.0f), XMFLOAT2(0.0f, 1.0f)));
+	const UINT front[] = { 0, 1, 3, 1, 2, 3, 0, 1, 7 };
+	const UINT back[] = { 0, 3, 1, 1, 3, 2 };
+	MeshBounds behind = MakeBox(0.0f, 0.0f, 20.0f, 1.0f, 1.0f, 1.0f);
+
+	// The triangle indexing past the vertices is skipped
+	OcclusionCuller culler;
+	BeginCamera(culler);
+	culler.RenderMesh(&vertices[0], (UINT)vertices.size(), front, 9, Identity());
+	culler.End();
+	CHECK_EQUAL(2u, culler.GetStats().occluderTriangles);
+	CHECK(!IsVisible(culler, behind));
+
+	BeginCamera(culler);
+	culler.RenderMesh(&vertices[0], (UINT)vertices.size(), back, 6, Identity());
+	culler.End();
+	CHECK_EQUAL(0u, culler.GetStats().occluderTriangles);
+	CHECK(IsVisible(culler, behind));
+}
+
+TEST(OcclusionCullerKeepsConservativeDepth)
+{
+	OcclusionCuller culler;
+	culler.Resize(100, 50);
+	CHECK_EQUAL(13u, culler.GetSubtilesX());
+	CHECK_EQUAL(13u, culler.GetSubtilesY());
+
+	BeginCamera(culler);
+	for (float depth : culler.GetDepth())
+		CHECK_EQUAL(1.0f, depth);
+
+	// A wall filling the view at a constant depth, every subtile takes that depth and none nearer
+	culler.RenderBox(MakeBox(0.0f, 0.0f, 10.0f, 100.0f, 100.0f, 0.5f), Identity());
+	culler.End();
+	float wallDepth = FarZ / (FarZ - NearZ) * (1.0f - NearZ / 9.5f);
+	CHECK_EQUAL(BufferSize / 8 * BufferSize / 4, (UINT)culler.GetDepth().size());
+	for (float depth : culler.GetDepth())
+		CHECK_NEAR(wallDepth, depth, 1e-5f);
+
+	// A new view starts empty
+	BeginCamera(culler);
+	culler.End();
+	CHECK(IsVisible(culler, MakeBox(0.0f, 0.0f, 20.0f, 1.0f, 1.0f, 1.0f)));
+}
+
+TEST(OcclusionCullerWorksForLightViews)
+{
+	// Straight down from a directional light, a roof hides what is under it
+	XMFLOAT4X4 viewProjection;
+	XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0.0f, 50.0f, 0.0f, 1.0f), XMVectorZero(), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f));
+	XMStoreFloat4x4(&viewProjection, view * XMMatrixOrthographicLH(40.0f, 40.0f, 1.0f, 100.0f));
+
+	OcclusionCuller culler;
+	culler.Resize(64, 64);
+	culler.Begin(viewProjection);
+	culler.RenderBox(MakeBox(0.0f, 10.0f, 0.0f, 5.0f, 0.5f, 5.0f), Identity());
+	culler.End();
+
+	CHECK(!IsVisible(culler, MakeBox(1.0f, 2.0f, -1.0f, 2.0f, 2.0f, 2.0f)));
+	CHECK(IsVisible(culler, MakeBox(10.0f, 2.0f, 0.0f, 2.0f, 2.0f, 2.0f)));
+	CHECK(IsVisible(culler, MakeBox(0.0f, 12.0f, 0.0f, 1.0f, 1.0f, 1.0f)));
+}
+
+TEST(OcclusionCullerNeverHidesVisibleObjects)
+{
+	std::mt19937 random(11);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	std::vector<MeshBounds> occluders, objects;
+	for (UINT i = 0; i < 30; i++)
+	{
+		float extentY = 1.0f + unit(random) * 4.0f;
+		occluders.push_back(MakeBox(unit(random) * 40.0f - 20.0f, extentY, unit(random) * 40.0f + 5.0f,
+			1.0f + unit(random) * 4.0f, extentY, 0.5f + unit(random) * 2.0f));
+	}
+	for (UINT i = 0; i < 400; i++)
+	{
+		float extent = 0.3f + unit(random) * 1.2f;
+		objects.push_back(MakeBox(unit(random) * 50.0f - 25.0f, extent, unit(random) * 50.0f + 5.0f, extent, extent, extent));
+	}
+
+	XMFLOAT3 eye(0.0f, 4.0f, -10.0f);
+	XMFLOAT4X4 viewProjection = MakeViewProjection(eye, XMFLOAT3(0.0f, 0.0f, 30.0f));
+	OcclusionCuller culler;
+	culler.Resize(BufferSize, BufferSize);
+	culler.Begin(viewProjection);
+	for (const MeshBounds& occluder : occluders)
+		culler.RenderBox(occluder, Identity());
+	culler.End();
+
+	// A ray through every pixel center, and how far it gets before an occluder stops it
+	XMMATRIX inverse = XMMatrixInverse(nullptr, XMLoadFloat4x4(&viewProjection));
+	std::vector<XMFLOAT3> directions(BufferSize * BufferSize);
+	std::vector<float> blocked(BufferSize * BufferSize, FLT_MAX);
+	for (UINT y = 0; y < BufferSize; y++)
+	{
+		for (UINT x = 0; x < BufferSize; x++)
+		{
+			float ndcX = (x + 0.5f) / BufferSize * 2.0f - 1.0f;
+			float ndcY = 1.0f - (y + 0.5f) / BufferSize * 2.0f;
+			XMVECTOR point = XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 0.5f, 1.0f), inverse);
+			XMFLOAT3& direction = directions[y * BufferSize + x];
+			XMStoreFloat3(&direction, XMVector3Normalize(point - XMLoadFloat3(&eye)));
+			for (const MeshBounds& occluder : occluders)
+				blocked[y * BufferSize + x] = min(blocked[y * BufferSize + x], IntersectBox(eye, direction, occluder));
+		}
+	}
+
+	UINT occluded = 0, wrong = 0;
+	for (const MeshBounds& object : objects)
+	{
+		if (culler.IsVisible(object, Identity()))
+			continue;
+		occluded++;
+		for (size_t i = 0; i < directions.size(); i++)
+		{
+			float distance = IntersectBox(eye, directions[i], object);
+			if (distance < blocked[i] && distance < FarZ)
+			{
+				wrong++;
+				break;
+			}
+		}
+	}
+	CHECK_EQUAL(0u, wrong);
+
+	// The scene is dense enough for the test to mean something
+	CHECK(occluded > 40);
+	CHECK_EQUAL(occluded, culler.GetStats().occluded + culler.GetStats().outside);
+}
+
+TEST(OcclusionCullerReadsCommandLine)
+{
+	OcclusionCuller culler;
+	CHECK(culler.IsEnabled());
+	culler.ParseCommandLine(NULL);
+	culler.ParseCommandLine("-benchmark occlusion=1");
+	CHECK(culler.IsEnabled());
+	culler.ParseCommandLine("-benchmark occlusion=0 lod=1");
+	CHECK(!culler.IsEnabled());
+}
@@ -0,0 +1,338 @@
+//
+// PNG decoding against known images: the fixtures in Tests/Data/PNG cover every filter type, color type and bit depth
+// with the pixels they must decode to, and the application's own textures are checked against reference hashes.
+// Corrupt and truncated files must fail cleanly
+//
+
+#include "Test.h"
+#include "PNGDecoder.h"
+
+// Written by Tests/Data/PNG/generate.py, paths are relative to the repository root
+static const char* FixtureDirectory = "Tests/Data/PNG/";
+static const char* Fixtures[] =
+{
+	"filter0", "filter1", "filter2", "filter3", "filter4",
+	"gray1", "gray2", "gray4", "gray16", "rgb16", "palette1", "palette4", "palette8", "grayalpha8", "grayalpha16", "rgba8",
+	"rgba16", "interlaced_rgba8", "interlaced_palette2", "interlaced_1x1", "stored", "split_idat"
+};
+
+static bool ReadFile(const std::string& path, std::vector<BYTE>& data)
+{
+	std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+	if (!file)
+		return false;
+	std::streamsize size = file.tellg();
+	data.resize((size_t)size);
+	file.seekg(0, std::ios::beg);
+	return size > 0 && file.read((char*)&data[0], size);
+}
+
+static UINT64 HashPixels(const std::vector<BYTE>& rgba)
+{
+	UINT64 hash = 0xcbf29ce484222325ull;
+	for (BYTE value : rgba)
+		hash = (hash ^ value) * 0x100000001b3ull;
+	return hash;
+}
+
+static void AppendBigEndian(std::vector<BYTE>& data, UINT value)
+{
+	for (int shift = 24; shift >= 0; shift -= 8)
+		data.push_back((BYTE)(value >> shift));
+}
+
+/// <summary>Appends a chunk. The decoder doesn't check CRCs, so they are left zero
+/// </summary>
+static void AppendChunk(std::vector<BYTE>& png, const char* type, const std::vector<BYTE>& data)
+{
+	AppendBigEndian(png, (UINT)data.size());
+	png.insert(png.end(), type, type + 4);
+	png.insert(png.end(), data.begin(), data.end());
+	AppendBigEndian(png, 0);
+}
+
+/// <summary>Wraps raw in a zlib stream of stored blocks, so a test controls every filtered byte
+/// </summary>
+static std::vector<BYTE> StoreZlib(const std::vector<BYTE>& raw)
+{
+	std::vector<BYTE> stream;
+	stream.push_back(0x78);
+	stream.push_back(0x01);
+	size_t position = 0;
+	do
+	{
+		UINT length = (UINT)min(raw.size() - position, (size_t)65535);
+		stream.push_back(position + length == raw.size() ? 1 : 0);
+		stream.push_back((BYTE)length);
+		stream.push_back((BYTE)(length >> 8));
+		stream.push_back((BYTE)~length);
+		stream.push_back((BYTE)(~length >> 8));
+		stream.insert(stream.end(), raw.begin() + position, raw.begin() + position + length);
+		position += length;
+	} while (position < raw.size());
+
+	UINT a = 1, b = 0;
+	for (BYTE value : raw)
+	{
+		a = (a + value) % 65521;
+		b = (b + a) % 65521;
+	}
+	AppendBigEndian(stream, (b << 16) | a);
+	return stream;
+}
+
+struct TestPNG
+{
+	TestPNG() :
+	width(2),
+	height(2),
+	depth(8),
+	colorType(2),
+	interlace(0)
+	{
+		// Two unfiltered rows of two RGB pixels
+		for (UINT y = 0; y < 2; y++)
+		{
+			raw.push_back(0);
+			for (UINT i = 0; i < 6; i++)
+				raw.push_back((BYTE)(y * 6 + i));
+		}
+	}
+
+	std::vector<BYTE> Build() const
+	{
+		static const BYTE signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+		std::vector<BYTE> png(signature, signature + 8);
+		std::vector<BYTE> header;
+		AppendBigEndian(header, width);
+		AppendBigEndian(header, height);
+		header.push_back(depth);
+		header.push_back(colorType);
+		header.push_back(0);
+		header.push_back(0);
+		header.push_back(interlace);
+		AppendChunk(png, "IHDR", header);
+		AppendChunk(png, "IDAT", StoreZlib(raw));
+		AppendChunk(png, "IEND", std::vector<BYTE>());
+		return png;
+	}
+
+	UINT width;
+	UINT height;
+	BYTE depth;
+	BYTE colorType;
+	BYTE interlace;
+	std::vector<BYTE> raw;	// Filtered rows, each starting with its filter type
+};
+
+static bool Decode(const std::vector<BYTE>& png, ImageData& image)
+{
+	PNGDecoder decoder;
+	return decoder.Decode(png.empty() ? NULL : &png[0], png.size(), image);
+}
+
+TEST(PNGDecoderMatchesFixtures)
+{
+	for (const char* name : Fixtures)
+	{
+		std::vector<BYTE> png, expected;
+		REQUIRE(ReadFile(std::string(FixtureDirectory) + name + ".png", png));
+		REQUIRE(ReadFile(std::string(FixtureDirectory) + name + ".rgba", expected));
+
+		ImageData image;
+		bool decoded = Decode(png, image);
+		if (!decoded || image.rgba != expected)
+			TestRegistry::Get().Fail(__FILE__, __LINE__, std::string(name) + " does not decode to its .rgba");
+		CHECK_EQUAL(expected.size(), (size_t)image.width * image.height * 4);
+	}
+}
+
+TEST(PNGDecoderMatchesApplicationTextures)
+{
+	// Reference hashes of the RGBA the textures decode to, from an independent zlib decode of the same files
+	struct Reference
+	{
+		const char* path;
+		UINT size;
+		UINT64 hash;
+	};
+	const Reference textures[] =
+	{
+		{ "Debug/Textures/brick.png", 512, 0xf337aab217c44733ull },
+		{ "Debug/Textures/brick_bump.png", 512, 0x94730b44427c6443ull },
+		{ "Debug/Textures/brick_normal.png", 512, 0xa5ae1691e5327f80ull },
+		{ "Debug/Textures/default.png", 256, 0x82bfb37561ba2325ull },
+		{ "Debug/Textures/floor_tiles.png", 256, 0x8737fde3b9a57508ull },
+		{ "Debug/Textures/floor_tiles_normal.png", 256, 0x59bedc763851effbull }
+	};
+
+	for (const Reference& texture : textures)
+	{
+		std::vector<BYTE> png;
+		REQUIRE(ReadFile(texture.path, png));
+		ImageData image;
+		REQUIRE(Decode(png, image));
+		CHECK_EQUAL(texture.size, image.width);
+		CHECK_EQUAL(texture.size, image.height);
+		CHECK_EQUAL(texture.hash, HashPixels(image.rgba));
+	}
+}
+
+TEST(PNGDecoderReadsHandBuiltImage)
+{
+	ImageData image;
+	REQUIRE(Decode(TestPNG().Build(), image));
+	CHECK_EQUAL(2u, image.width);
+	CHECK_EQUAL(2u, image.height);
+	const BYTE expected[16] = { 0, 1, 2, 255, 3, 4, 5, 255, 6, 7, 8, 255, 9, 10, 11, 255 };
+	CHECK(memcmp(&image.rgba[0], expected, sizeof(expected)) == 0);
+
+	// Sub on the second row adds the pixel to the left
+	TestPNG filtered;
+	filtered.raw[7] = 1;
+	filtered.raw[11] = 1;
+	filtered.raw[12] = 1;
+	filtered.raw[13] = 1;
+	REQUIRE(Decode(filtered.Build(), image));
+	CHECK_EQUAL(7, image.rgba[12]);
+	CHECK_EQUAL(8, image.rgba[13]);
+	CHECK_EQUAL(9, image.rgba[14]);
+}
+
+TEST(PNGDecoderRejectsBadHeaders)
+{
+	ImageData image;
+	std::vector<BYTE> badSignature = TestPNG().Build();
+	badSignature[1] = 'X';
+	CHECK(!Decode(badSignature, image));
+
+	TestPNG zeroWidth;
+	zeroWidth.width = 0;
+	CHECK(!Decode(zeroWidth.Build(), image));
+
+	TestPNG tooLarge;
+	tooLarge.height = 16385;
+	CHECK(!Decode(tooLarge.Build(), image));
+
+	TestPNG badDepth;
+	badDepth.depth = 4;
+	CHECK(!Decode(badDepth.Build(), image));
+
+	TestPNG badColorType;
+	badColorType.colorType = 5;
+	CHECK(!Decode(badColorType.Build(), image));
+
+	TestPNG badInterlace;
+	badInterlace.interlace = 2;
+	CHECK(!Decode(badInterlace.Build(), image));
+
+	// Palette images need a palette
+	TestPNG noPalette;
+	noPalette.colorType = 3;
+	noPalette.raw.resize(6, 0);
+	CHECK(!Decode(noPalette.Build(), image));
+
+	// IHDR has to come first
+	std::vector<BYTE> png = TestPNG().Build();
+	std::vector<BYTE> reordered(png.begin(), png.begin() + 8);
+	size_t headerEnd = 8 + 12 + 13;
+	size_t dataEnd = png.size() - 12;
+	reordered.insert(reordered.end(), png.begin() + headerEnd, png.begin() + dataEnd);
+	reordered.insert(reordered.end(), png.begin() + 8, png.begin() + headerEnd);
+	reordered.insert(reordered.end(), png.begin() + dataEnd, png.end());
+	CHECK(!Decode(reordered, image));
+}
+
+TEST(PNGDecoderRejectsBadImageData)
+{
+	ImageData image;
+
+	TestPNG badFilter;
+	badFilter.raw[7] = 5;
+	CHECK(!Decode(badFilter.Build(), image));
+
+	TestPNG shortData;
+	shortData.raw.pop_back();
+	CHECK(!Decode(shortData.Build(), image));
+
+	TestPNG longData;
+	longData.raw.push_back(0);
+	CHECK(!Decode(longData.Build(), image));
+
+	// The Adler-32 is the last four bytes of the IDAT payload, before the CRC
+	std::vector<BYTE> badChecksum = TestPNG().Build();
+	badChecksum[badChecksum.size() - 12 - 4 - 1]++;
+	CHECK(!Decode(badChecksum, image));
+
+	// A chunk claiming more bytes than the file has
+	std::vector<BYTE> badLength = TestPNG().Build();
+	badLength[8 + 12 + 13 + 2] = 0x7F;
+	CHECK(!Decode(badLength, image));
+}
+
+TEST(PNGDecoderRejectsTruncatedFiles)
+{
+	std::vector<BYTE> png;
+	REQUIRE(ReadFile(std::string(FixtureDirectory) + "split_idat.png", png));
+
+	// Any cut before the IEND chunk loses image data. A missing IEND alone is tolerated, the pixels are all there
+	bool rejected = true;
+	ImageData image;
+	size_t endChunk = png.size() - 12;
+	for (size_t size = 0; size < endChunk; size++)
+	{
+		std::vector<BYTE> truncated(png.begin(), png.begin() + size);
+		rejected = rejected && !Decode(truncated, image);
+	}
+	CHECK(rejected);
+	CHECK(Decode(std::vector<BYTE>(png.begin(), png.begin() + endChunk), image));
+}
+
+TEST(PNGDecoderSurvivesCorruption)
+{
+	// Random byte changes after the signature, over every fixture. Whatever decodes has to be the size it claims
+	PNGDecoder decoder;
+	std::mt19937 random(5);
+	UINT decoded = 0;
+	bool consistent = true;
+	for (UINT i = 0; i < 3000; i++)
+	{
+		std::vector<BYTE> png;
+		REQUIRE(ReadFile(std::string(FixtureDirectory) + Fixtures[i % ARRAYSIZE(Fixtures)] + ".png", png));
+		UINT changes = 1 + random() % 4;
+		for (UINT change = 0; change < changes; change++)
+			png[8 + random() % (png.size() - 8)] = (BYTE)random();
+
+		ImageData image;
+		if (decoder.Decode(&png[0], png.size(), image))
+		{
+			decoded++;
+			consistent = consistent && image.rgba.size() == (size_t)image.width * image.height * 4;
+		}
+	}
+	CHECK(consistent);
+	CHECK(decoded < 3000);
+}
+
+TEST(PNGDecoderInflatesFixedHuffmanBlocks)
+{
+	// zlib.compress at level 9, fixed codes with back references that overlap what they copy
+	const BYTE repeated[] = { 0x78, 0xda, 0x4b, 0x4c, 0x4a, 0x4e, 0xc4, 0x86, 0x00, 0x72, 0xe0, 0x09, 0x31 };
+	const BYTE run[] = { 0x78, 0xda, 0x4b, 0x4c, 0x24, 0x0e, 0x00, 0x00, 0x36, 0xeb, 0x0f, 0x29 };
+
+	char out[41] = {};
+	REQUIRE(PNGDecoder::Inflate(repeated, sizeof(repeated), (BYTE*)out, 24));
+	CHECK(std::string(out) == "abcabcabcabcabcabcabcabc");
+	REQUIRE(PNGDecoder::Inflate(run, sizeof(run), (BYTE*)out, 40));
+	CHECK(std::string(out) == std::string(40, 'a'));
+
+	// The output has to be exactly the size asked for
+	CHECK(!PNGDecoder::Inflate(run, sizeof(run), (BYTE*)out, 39));
+	CHECK(!PNGDecoder::Inflate(run, sizeof(run) - 1, (BYTE*)out, 40));
+
+	// Preset dictionaries aren't allowed in PNG
+	BYTE dictionary[sizeof(run)];
+	memcpy(dictionary, run, sizeof(run));
+	dictionary[1] = 0xbb;
+	CHECK(!PNGDecoder::Inflate(dictionary, sizeof(dictionary), (BYTE*)out, 40));
+}
@@ -0,0 +1,206 @@
+//
+// Pose evaluation gives the same palettes on any number of threads as sampling, blending and building them by hand,
+// the bind pose skins to the mesh as modeled and CPU skinning places each character in the world
+//
+
+#include "Test.h"
+#include "PoseEvaluator.h"
+
+#include <cmath>
+#include <cstring>
+
+// Keys a second the test clips are written at
+static const float TestKeyRate = 60.0f;
+
+/// <summary>A branching skeleton, every joint's parent halfway down the list, with its inverse bind matrices
+/// </summary>
+static void CreateSkeleton(UINT jointCount, Skeleton& skeleton)
+{
+	std::vector<XMFLOAT4X4> model(jointCount);
+	for (UINT i = 0; i < jointCount; i++)
+	{
+		int parent = i == 0 ? -1 : (int)(i - 1) / 2;
+		JointTransform bind = { XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f), XMFLOAT3(i % 2 ? 0.05f : -0.05f, 0.1f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f) };
+		XMMATRIX local = XMMatrixTranslation(bind.translation.x, bind.translation.y, bind.translation.z);
+		XMMATRIX world = parent < 0 ? local : local * XMLoadFloat4x4(&model[parent]);
+		XMStoreFloat4x4(&model[i], world);
+		XMFLOAT4X4 inverseBind;
+		XMStoreFloat4x4(&inverseBind, XMMatrixInverse(NULL, world));
+		skeleton.names.push_back("Joint" + std::to_string(i));
+		skeleton.parents.push_back(parent);
+		skeleton.bindPose.push_back(bind);
+		skeleton.inverseBind.push_back(inverseBind);
+	}
+}
+
+/// <summary>Waves of rotation running down the joints, a different one in each clip, and the root bobbing
+/// </summary>
+static void CreateClips(UINT jointCount, UINT clipCount, std::vector<RawClip>& clips)
+{
+	clips.resize(clipCount);
+	for (UINT c = 0; c < clipCount; c++)
+	{
+		RawClip& clip = clips[c];
+		clip.name = "Wave" + std::to_string(c);
+		clip.duration = 1.0f + c;
+		clip.tracks.resize(jointCount);
+		UINT keys = (UINT)(clip.duration * TestKeyRate) + 1;
+		for (UINT i = 0; i < jointCount; i++)
+		{
+			RawTrack& track = clip.tracks[i];
+			for (UINT k = 0; k < keys; k++)
+			{
+				float time = k / TestKeyRate;
+				float wave = 2.0f * PI * time / clip.duration - 0.3f * i;
+				XMFLOAT4 rotation;
+				XMStoreFloat4(&rotation, XMQuaternionRotationRollPitchYaw(0.2f * std::sin(wave), 0.1f * c * std::cos(wave), 0.3f * std::sin(wave * 2.0f)));
+				track.rotationTimes.push_back(time);
+				track.rotations.push_back(rotation);
+				if (i == 0)
+				{
+					track.translationTimes.push_back(time);
+					track.translations.push_back(XMFLOAT3(0.0f, 0.05f * std::sin(wave), 0.0f));
+				}
+			}
+		}
+	}
+}
+
+static void AddCharacters(UINT count, PoseEvaluator& poses)
+{
+	for (UINT i = 0; i < count; i++)
+	{
+		AnimatedCharacter character;
+		XMStoreFloat4x4(&character.world, XMMatrixRotationY(0.7f * i) * XMMatrixTranslation(1.5f * i, 0.0f, 10.0f));
+		character.phase = 0.37f * i;
+		character.speed = 0.8f + 0.1f * (i % 5);
+		character.blendPeriod = i % 3 == 0 ? 0.0f : 4.0f + i % 5;
+		poses.AddCharacter(character);
+	}
+}
+
+TEST(PoseEvaluatorBindPose)
+{
+	// Clips without keys hold the bind pose, which skins every vertex to where it was modeled, give or take what
+	// compression may lose
+	const UINT jointCount = 21;
+	Skeleton skeleton;
+	CreateSkeleton(jointCount, skeleton);
+	std::vector<RawClip> clips(1);
+	clips[0].name = "Still";
+	clips[0].duration = 1.0f;
+	clips[0].tracks.resize(jointCount);
+
+	PoseEvaluator poses;
+	REQUIRE(poses.Load(skeleton, clips, 0));
+	AnimatedCharacter character;
+	XMStoreFloat4x4(&character.world, XMMatrixTranslation(3.0f, 0.0f, -2.0f));
+	character.phase = 0.0f;
+	character.speed = 1.0f;
+	character.blendPeriod = 0.0f;
+	poses.AddCharacter(character);
+	poses.Evaluate(0.4f);
+
+	float worst = 0.0f;
+	const SkinMatrix* palette = poses.GetPalette(0);
+	for (UINT j = 0; j < jointCount; j++)
+	{
+		for (UINT row = 0; row < 3; row++)
+		{
+			const float* values = &palette[j].rows[row].x;
+			for (UINT column = 0; column < 4; column++)
+				worst = max(worst, std::fabs(values[column] - (row == column ? 1.0f : 0.0f)));
+		}
+	}
+	CHECK(worst < ClipCompression().translationTolerance);
+
+	// CPU skinning moves the vertex by the character's world matrix alone
+	Vertex vertex(XMFLOAT3(0.1f, 0.5f, 0.2f), XMFLOAT2(0.0f, 0.0f));
+	vertex.Normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
+	vertex.Tangent = XMFLOAT3(1.0f, 0.0f, 0.0f);
+	SkinInfluences skin;
+	ZeroMemory(&skin, sizeof(skin));
+	skin.joints[0] = 7;
+	skin.joints[1] = 12;
+	skin.weights[0] = 0.25f;
+	skin.weights[1] = 0.75f;
+	Vertex skinned;
+	poses.SkinVerticesInto(&vertex, &skin, 1, &skinned);
+	CHECK_NEAR(3.1f, skinned.Position.x, 0.005f);
+	CHECK_NEAR(0.5f, skinned.Position.y, 0.005f);
+	CHECK_NEAR(-1.8f, skinned.Position.z, 0.005f);
+	CHECK_NEAR(1.0f, skinned.Normal.y, 0.005f);
+}
+
+TEST(PoseEvaluatorMatchesByHand)
+{
+	const UINT jointCount = 37;
+	const UINT characterCount = 70;
+	Skeleton skeleton;
+	CreateSkeleton(jointCount, skeleton);
+	std::vector<RawClip> rawClips;
+	CreateClips(jointCount, 3, rawClips);
+
+	// Batches split across workers land in the same places as on the calling thread alone
+	PoseEvaluator single, threaded;
+	REQUIRE(single.Load(skeleton, rawClips, 0));
+	REQUIRE(threaded.Load(skeleton, rawClips, 3));
+	AddCharacters(characterCount, single);
+	AddCharacters(characterCount, threaded);
+	single.Evaluate(2.3f);
+	threaded.Evaluate(2.3f);
+	CHECK(memcmp(single.GetPalette(0), threaded.GetPalette(0), characterCount * jointCount * sizeof(SkinMatrix)) == 0);
+
+	const AnimationStats& stats = single.GetStats();
+	CHECK_EQUAL(characterCount, stats.characters);
+	CHECK_EQUAL(jointCount, stats.joints);
+	CHECK_EQUAL(3u, stats.clips);
+	CHECK(stats.keptKeys <= stats.rawKeys);
+	CHECK(stats.clipBytes < stats.rawBytes);
+
+	// Character i plays clips i and i + 1, blended by how far it is through its blend period
+	std::vector<AnimationClip> clips(rawClips.size());
+	for (size_t i = 0; i < clips.size(); i++)
+		clips[i].Compress(rawClips[i], skeleton);
+	Pose first, second;
+	SkinningScratch scratch;
+	std::vector<SkinMatrix> palette(jointCount);
+	bool matches = true;
+	for (UINT i = 0; i < characterCount; i++)
+	{
+		const AnimatedCharacter& character = single.GetCharacter(i);
+		float local = 2.3f * character.speed + character.phase;
+		clips[i % 3].Sample(local, first);
+		if (character.blendPeriod > 0.0f)
+		{
+			clips[(i + 1) % 3].Sample(local, second);
+			Skinning::Blend(first, second, 0.5f - 0.5f * std::cos(2.0f * PI * local / character.blendPeriod), first);
+		}
+		Skinning::BuildPalette(skeleton, first, scratch, &palette[0]);
+		matches &= memcmp(&palette[0], single.GetPalette(i), jointCount * sizeof(SkinMatrix)) == 0;
+	}
+	CHECK(matches);
+
+	// A later time moves them
+	single.Evaluate(2.8f);
+	CHECK(memcmp(single.GetPalette(0), threaded.GetPalette(0), jointCount * sizeof(SkinMatrix)) != 0);
+}
+
+TEST(PoseEvaluatorRefusesUnusableModels)
+{
+	Skeleton skeleton;
+	std::vector<RawClip> clips;
+	PoseEvaluator poses;
+	CHECK(!poses.Load(skeleton, clips, 0));
+
+	CreateSkeleton(MaxSkinJoints + 1, skeleton);
+	CreateClips(MaxSkinJoints + 1, 1, clips);
+	CHECK(!poses.Load(skeleton, clips, 0));
+
+	// Nothing loaded evaluates to nothing
+	AddCharacters(2, poses);
+	poses.Evaluate(1.0f);
+	Vertex out;
+	poses.SkinVerticesInto(NULL, NULL, 0, &out);
+	CHECK_EQUAL(2u, poses.GetCharacterCount());
+}
@@ -0,0 +1,80 @@
+//
+// Profiler capture contents, budgets and tick conversion
+//
+
+#include "Test.h"
+#include "Profiler.h"
+
+static UINT CountOccurrences(const std::string& text, const std::string& pattern)
+{
+	UINT count = 0;
+	for (size_t at = text.find(pattern); at != std::string::npos; at = text.find(pattern, at + 1))
+		count++;
+	return count;
+}
+
+static std::string ReadFile(const char* filepath)
+{
+	std::ifstream file(filepath);
+	std::stringstream contents;
+	contents << file.rdbuf();
+	return contents.str();
+}
+
+TEST(ProfilerTraceHoldsJoinedThreadsZones)
+{
+	std::thread worker([]()
+	{
+		Profiler::BeginFrame();
+		for (UINT i = 0; i < 10; i++)
+		{
+			PROFILE_ZONE("ProfilerTestWorker");
+			PROFILE_COUNTER("ProfilerTestCounter", i);
+		}
+	});
+	worker.join();
+
+	const char* filepath = "profiler_test_trace.json";
+	REQUIRE(Profiler::WriteChromeTrace(filepath));
+	std::string trace = ReadFile(filepath);
+	remove(filepath);
+	CHECK_EQUAL(10u, CountOccurrences(trace, "\"name\":\"ProfilerTestWorker\""));
+	CHECK_EQUAL(10u, CountOccurrences(trace, "\"name\":\"ProfilerTestCounter\""));
+}
+
+TEST(ProfilerDropsEventsOverBudget)
+{
+	Profiler::SetBudget(5, 2);
+	UINT64 dropped = Profiler::GetDroppedEvents();
+	std::thread worker([]()
+	{
+		Profiler::BeginFrame();
+		for (UINT i = 0; i < 8; i++)
+			PROFILE_ZONE("ProfilerTestBudget");
+	});
+	worker.join();
+	CHECK_EQUAL(dropped + 3, Profiler::GetDroppedEvents());
+
+	// Third level of nesting is over the depth budget
+	std::thread nested([]()
+	{
+		Profiler::BeginFrame();
+		PROFILE_ZONE("ProfilerTestOuter");
+		PROFILE_ZONE("ProfilerTestMiddle");
+		PROFILE_ZONE("ProfilerTestInner");
+	});
+	nested.join();
+	CHECK_EQUAL(dropped + 4, Profiler::GetDroppedEvents());
+	Profiler::SetBudget(4096, 16);
+}
+
+TEST(ProfilerTicksConvertAtOneRate)
+{
+	INT64 start = Profiler::Now();
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	INT64 elapsed = Profiler::Now() - start;
+	double microseconds = Profiler::TicksToMicroseconds(elapsed);
+	CHECK(microseconds >= 20000.0);
+	CHECK(microseconds < 40000.0);
+	CHECK_EQUAL(microseconds, Profiler::TicksToMicroseconds(elapsed));
+}
@@ -0,0 +1,294 @@
+//
+// Range allocation checked against a plain list of what is in use: ranges never overlap, freed neighbours merge into one
+// free range, allocation only fails when no gap is large enough, and the stats match. Compact's moves, applied in the
+// order given to a buffer the ranges own, leave every range's data at its new offset. Grow extends the free tail
+//
+
+#include "Test.h"
+#include "RangeAllocator.h"
+
+#include <map>
+#include <random>
+
+/// <summary>Offsets and sizes of the ranges in use, keyed by offset, and the free gaps between them
+/// </summary>
+static void GetGaps(const RangeAllocator& allocator, const std::map<UINT, UINT>& live, std::vector<UINT>& gaps)
+{
+	gaps.clear();
+	UINT cursor = 0;
+	for (auto range = live.begin(); range != live.end(); ++range)
+	{
+		if (range->first > cursor)
+			gaps.push_back(range->first - cursor);
+		cursor = range->first + range->second;
+	}
+	if (cursor < allocator.GetCapacity())
+		gaps.push_back(allocator.GetCapacity() - cursor);
+}
+
+/// <summary>Checks the allocator against the ranges the test holds, ids maps range ids to sizes
+/// </summary>
+static bool Matches(const RangeAllocator& allocator, const std::map<UINT, UINT>& ids)
+{
+	std::map<UINT, UINT> live;
+	UINT used = 0;
+	for (auto id = ids.begin(); id != ids.end(); ++id)
+	{
+		if (allocator.GetSize(id->first) != id->second)
+			return false;
+		live[allocator.GetOffset(id->first)] = id->second;
+		used += id->second;
+	}
+	if (live.size() != ids.size())
+		return false;
+
+	// Back to back at most, never overlapping or past the end
+	UINT cursor = 0;
+	for (auto range = live.begin(); range != live.end(); ++range)
+	{
+		if (range->first < cursor)
+			return false;
+		cursor = range->first + range->second;
+	}
+	if (cursor > allocator.GetCapacity())
+		return false;
+
+	// Free neighbours always merged, so each gap is one free range
+	std::vector<UINT> gaps;
+	GetGaps(allocator, live, gaps);
+	UINT largest = 0;
+	for (UINT gap : gaps)
+		largest = max(largest, gap);
+	RangeAllocatorStats stats = allocator.GetStats();
+	return stats.used == used && stats.allocations == ids.size() && stats.freeRanges == gaps.size() &&
+		stats.largestFree == largest && stats.capacity == allocator.GetCapacity();
+}
+
+TEST(RangeAllocatorAllocatesFreesAndMerges)
+{
+	RangeAllocator allocator(1000);
+	UINT a = allocator.Allocate(100);
+	UINT b = allocator.Allocate(200);
+	UINT c = allocator.Allocate(300);
+	CHECK_EQUAL(0u, allocator.GetOffset(a));
+	CHECK_EQUAL(100u, allocator.GetOffset(b));
+	CHECK_EQUAL(300u, allocator.GetOffset(c));
+	CHECK_EQUAL(1u, allocator.GetStats().freeRanges);
+	CHECK_EQUAL(400u, allocator.GetStats().largestFree);
+
+	// Freeing the middle leaves a hole, freeing its neighbour merges them, and the last one merges with the tail
+	allocator.Free(b);
+	CHECK_EQUAL(2u, allocator.GetStats().freeRanges);
+	allocator.Free(a);
+	CHECK_EQUAL(2u, allocator.GetStats().freeRanges);
+	CHECK_EQUAL(400u, allocator.GetStats().largestFree);
+
+	// Requests round up to the next size class, so an exact fit in the hole loses to the larger tail while there is one
+	UINT filled = allocator.Allocate(300);
+	CHECK_EQUAL(600u, allocator.GetOffset(filled));
+	UINT exact = allocator.Allocate(300);
+	CHECK_EQUAL(0u, allocator.GetOffset(exact));
+	CHECK_EQUAL(1u, allocator.GetStats().freeRanges);
+	CHECK_EQUAL(100u, allocator.GetStats().largestFree);
+	allocator.Free(exact);
+	allocator.Free(c);
+	allocator.Free(filled);
+	CHECK_EQUAL(1u, allocator.GetStats().freeRanges);
+	CHECK_EQUAL(1000u, allocator.GetStats().largestFree);
+	CHECK_EQUAL(0u, allocator.GetStats().used);
+
+	// Freeing twice or an id never handed out does nothing, nor does asking for nothing
+	allocator.Free(c);
+	allocator.Free(RangeAllocator::Invalid);
+	CHECK_EQUAL(RangeAllocator::Invalid, allocator.Allocate(0));
+	CHECK_EQUAL(0u, allocator.GetStats().allocations);
+
+	// The whole space can be taken exactly, then nothing more fits
+	UINT all = allocator.Allocate(1000);
+	CHECK(all != RangeAllocator::Invalid);
+	CHECK_EQUAL(0u, allocator.GetStats().freeRanges);
+	CHECK_EQUAL(RangeAllocator::Invalid, allocator.Allocate(1));
+
+	// An empty allocator has nothing to give
+	RangeAllocator empty;
+	CHECK_EQUAL(RangeAllocator::Invalid, empty.Allocate(1));
+}
+
+TEST(RangeAllocatorMatchesAReferenceUnderRandomUse)
+{
+	// Sizes from single elements to tens of thousands, so both levels of the size classes are used, and enough of them
+	// stay live that the space fills and some requests fail
+	const UINT capacity = 1 << 20;
+	RangeAllocator allocator(capacity);
+	std::map<UINT, UINT> ids;
+	std::mt19937 random(11);
+	std::uniform_int_distribution<UINT> small(1, 40);
+	std::uniform_int_distribution<UINT> large(40, 20000);
+	UINT failures = 0;
+	bool matched = true, failedOnlyWhenFull = true;
+
+	for (UINT step = 0; step < 20000; step++)
+	{
+		bool allocate = ids.empty() || random() % 100 < (ids.size() < 200 ? 60u : 45u);
+		if (allocate)
+		{
+			UINT size = random() % 2 ? small(random) : large(random);
+			UINT range = allocator.Allocate(size);
+			if (range == RangeAllocator::Invalid)
+			{
+				// Only when no gap is large enough
+				failures++;
+				failedOnlyWhenFull &= allocator.GetStats().largestFree < size;
+			}
+			else
+			{
+				matched &= ids.find(range) == ids.end();
+				ids[range] = size;
+			}
+		}
+		else
+		{
+			auto victim = ids.begin();
+			std::advance(victim, random() % ids.size());
+			allocator.Free(victim->first);
+			ids.erase(victim);
+		}
+
+		if (step % 50 == 0)
+			matched &= Matches(allocator, ids);
+	}
+	CHECK(matched);
+	CHECK(failedOnlyWhenFull);
+	CHECK(failures > 0);
+	CHECK(Matches(allocator, ids));
+
+	// Freeing everything leaves one free range of the whole space
+	for (auto id = ids.begin(); id != ids.end(); ++id)
+		allocator.Free(id->first);
+	CHECK_EQUAL(1u, allocator.GetStats().freeRanges);
+	CHECK_EQUAL(capacity, allocator.GetStats().largestFree);
+}
+
+TEST(RangeAllocatorCompactsWithMoveLists)
+{
+	// Every range's elements hold its id, so moved data is checked to have landed where the range now is
+	const UINT capacity = 50000;
+	RangeAllocator allocator(capacity);
+	std::vector<UINT> buffer(capacity, RangeAllocator::Invalid);
+	std::map<UINT, UINT> ids;
+	std::mt19937 random(5);
+	for (UINT i = 0; i < 300; i++)
+	{
+		UINT size = 1 + random() % 200;
+		UINT range = allocator.Allocate(size);
+		REQUIRE(range != RangeAllocator::Invalid);
+		ids[range] = size;
+		std::fill(buffer.begin() + allocator.GetOffset(range), buffer.begin() + allocator.GetOffset(range) + size, range);
+	}
+	for (auto id = ids.begin(); id != ids.end();)
+	{
+		if (random() % 3 == 0)
+		{
+			allocator.Free(id->first);
+			id = ids.erase(id);
+		}
+		else
+			++id;
+	}
+	CHECK(allocator.GetStats().freeRanges > 10);
+
+	// Ranges in space order before compacting, they must keep that order
+	std::map<UINT, UINT> order;
+	for (auto id = ids.begin(); id != ids.end(); ++id)
+		order[allocator.GetOffset(id->first)] = id->first;
+
+	std::vector<RangeMove> moves;
+	allocator.Compact(moves);
+	bool ascending = true, copied = true;
+	for (size_t i = 0; i < moves.size(); i++)
+	{
+		const RangeMove& move = moves[i];
+		ascending &= i == 0 || move.from > moves[i - 1].from;
+		copied &= move.to < move.from && move.size == ids[move.range];
+		std::copy(buffer.begin() + move.from, buffer.begin() + move.from + move.size, buffer.begin() + move.to);
+	}
+	CHECK(ascending);
+	CHECK(copied);
+	CHECK(!moves.empty());
+
+	UINT cursor = 0;
+	bool packed = true, intact = true;
+	for (auto range = order.begin(); range != order.end(); ++range)
+	{
+		UINT id = range->second;
+		packed &= allocator.GetOffset(id) == cursor;
+		for (UINT i = 0; i < ids[id]; i++)
+			intact &= buffer[cursor + i] == id;
+		cursor += ids[id];
+	}
+	CHECK(packed);
+	CHECK(intact);
+	CHECK_EQUAL(1u, allocator.GetStats().freeRanges);
+	CHECK_EQUAL(capacity - cursor, allocator.GetStats().largestFree);
+	CHECK(Matches(allocator, ids));
+
+	// Compacting a packed space moves nothing, and allocating afterwards works from the tail
+	moves.clear();
+	allocator.Compact(moves);
+	CHECK(moves.empty());
+	UINT after = allocator.Allocate(100);
+	CHECK_EQUAL(cursor, allocator.GetOffset(after));
+	ids[after] = 100;
+	CHECK(Matches(allocator, ids));
+
+	// A full space compacts to no free range at all
+	RangeAllocator full(300);
+	UINT first = full.Allocate(100);
+	full.Allocate(100);
+	full.Allocate(100);
+	full.Free(first);
+	full.Allocate(100);
+	moves.clear();
+	full.Compact(moves);
+	CHECK_EQUAL(0u, full.GetStats().freeRanges);
+}
+
+TEST(RangeAllocatorGrowsAtTheEnd)
+{
+	RangeAllocator allocator(100);
+	UINT a = allocator.Allocate(60);
+
+	// A free tail grows in place
+	allocator.Grow(200);
+	CHECK_EQUAL(200u, allocator.GetCapacity());
+	CHECK_EQUAL(1u, allocator.GetStats().freeRanges);
+	CHECK_EQUAL(140u, allocator.GetStats().largestFree);
+
+	// A used tail gets a new free range after it
+	UINT b = allocator.Allocate(140);
+	CHECK_EQUAL(60u, allocator.GetOffset(b));
+	CHECK_EQUAL(0u, allocator.GetStats().freeRanges);
+	allocator.Grow(300);
+	CHECK_EQUAL(1u, allocator.GetStats().freeRanges);
+	UINT c = allocator.Allocate(100);
+	CHECK_EQUAL(200u, allocator.GetOffset(c));
+
+	// Capacity never shrinks
+	allocator.Grow(50);
+	CHECK_EQUAL(300u, allocator.GetCapacity());
+
+	// The grown range merges with its free neighbour when that is freed
+	allocator.Free(c);
+	allocator.Free(b);
+	CHECK_EQUAL(1u, allocator.GetStats().freeRanges);
+	CHECK_EQUAL(240u, allocator.GetStats().largestFree);
+	allocator.Free(a);
+
+	// Starting empty and growing, and Reset starting over
+	RangeAllocator empty;
+	empty.Grow(64);
+	CHECK_EQUAL(0u, empty.GetOffset(empty.Allocate(64)));
+	empty.Reset(10);
+	CHECK_EQUAL(0u, empty.GetStats().allocations);
+	CHECK_EQUAL(10u, empty.GetStats().largestFree);
+}
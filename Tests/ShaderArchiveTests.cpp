@@ -0,0 +1,247 @@
+//
+// Shader archives written and read back with the fixture bytecode in Tests/Data/Shaders: every permutation comes back
+// byte for byte, identical bytecode is stored once, and damaged archives fail to read
+//
+
+#include "Test.h"
+#include "ShaderArchive.h"
+#include "ShaderReflection.h"
+
+#include <unistd.h>
+
+// Paths are relative to the repository root
+static const char* ShaderDirectory = "Tests/Data/Shaders/";
+static const char* ShaderNames[] =
+{
+	"DefaultVertex", "DefaultPixel", "PixelNoNormal", "NoLightVert", "NoLightPixel", "FullScreenQuadVert",
+	"FullScreenQuadPixel", "Shadow"
+};
+static const UINT ShaderCount = sizeof(ShaderNames) / sizeof(ShaderNames[0]);
+
+static bool ReadFile(const std::string& path, std::vector<BYTE>& data)
+{
+	std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+	if (!file)
+		return false;
+	std::streamsize size = file.tellg();
+	data.resize((size_t)size);
+	file.seekg(0, std::ios::beg);
+	return size > 0 && file.read((char*)&data[0], size);
+}
+
+static bool ReadShaders(std::vector<std::vector<BYTE> >& shaders)
+{
+	shaders.resize(ShaderCount);
+	for (UINT i = 0; i < ShaderCount; i++)
+	{
+		if (!ReadFile(std::string(ShaderDirectory) + ShaderNames[i] + ".cso", shaders[i]))
+			return false;
+	}
+	return true;
+}
+
+static bool Matches(const ShaderArchive& archive, const std::string& shader, UINT features, const std::vector<BYTE>& expected)
+{
+	const BYTE* bytecode = NULL;
+	size_t size = 0;
+	return archive.Find(shader, features, bytecode, size) && size == expected.size() &&
+		memcmp(bytecode, &expected[0], size) == 0;
+}
+
+/// <summary>Every fixture as permutation 0 of its own name, the pixel shaders also under two feature masks that compiled
+/// to the same bytecode
+/// </summary>
+static void AddShaders(ShaderArchive& archive, const std::vector<std::vector<BYTE> >& shaders)
+{
+	for (UINT i = 0; i < ShaderCount; i++)
+	{
+		archive.Add(ShaderNames[i], 0, &shaders[i][0], shaders[i].size());
+		if (strstr(ShaderNames[i], "Pixel"))
+		{
+			archive.Add(ShaderNames[i], 0x1, &shaders[i][0], shaders[i].size());
+			archive.Add(ShaderNames[i], 0x5, &shaders[i][0], shaders[i].size());
+		}
+	}
+}
+
+TEST(ShaderArchiveRoundTripsFixtures)
+{
+	std::vector<std::vector<BYTE> > shaders;
+	REQUIRE(ReadShaders(shaders));
+
+	ShaderArchive archive;
+	AddShaders(archive, shaders);
+	CHECK_EQUAL(ShaderCount + 2 * 4, archive.GetPermutationCount());
+	CHECK_EQUAL(ShaderCount, archive.GetBlobCount());
+
+	std::vector<BYTE> data;
+	archive.Write(data);
+	CHECK_EQUAL(archive.GetSize(), data.size());
+	size_t bytecode = 0;
+	for (const std::vector<BYTE>& shader : shaders)
+		bytecode += shader.size();
+	CHECK(data.size() < bytecode + 1024);
+
+	ShaderArchive read;
+	REQUIRE(read.Read(&data[0], data.size()));
+	CHECK_EQUAL(archive.GetPermutationCount(), read.GetPermutationCount());
+	CHECK_EQUAL(archive.GetBlobCount(), read.GetBlobCount());
+	CHECK_EQUAL(data.size(), read.GetSize());
+	for (UINT i = 0; i < ShaderCount; i++)
+	{
+		CHECK(Matches(read, ShaderNames[i], 0, shaders[i]));
+		if (strstr(ShaderNames[i], "Pixel"))
+		{
+			CHECK(Matches(read, ShaderNames[i], 0x1, shaders[i]));
+			CHECK(Matches(read, ShaderNames[i], 0x5, shaders[i]));
+		}
+		else
+		{
+			const BYTE* missing;
+			size_t size;
+			CHECK(!read.Find(ShaderNames[i], 0x1, missing, size));
+		}
+	}
+
+	// Bytecode starts 4 byte aligned in the file, and still parses out of the archive
+	for (UINT i = 0; i < read.GetPermutationCount(); i++)
+	{
+		ShaderArchiveEntry entry;
+		memcpy(&entry, &data[sizeof(ShaderArchiveHeader) + i * sizeof(ShaderArchiveEntry)], sizeof(ShaderArchiveEntry));
+		CHECK_EQUAL(0u, entry.offset % 4);
+	}
+	for (UINT i = 0; i < ShaderCount; i++)
+	{
+		const BYTE* shader = NULL;
+		size_t size = 0;
+		std::vector<ShaderInputElement> inputs;
+		REQUIRE(read.Find(ShaderNames[i], 0, shader, size));
+		CHECK(ShaderReflection::ReadInputSignature(shader, size, inputs));
+	}
+
+	// Writing what was read gives the same file
+	std::vector<BYTE> rewritten;
+	read.Write(rewritten);
+	CHECK(rewritten == data);
+}
+
+TEST(ShaderArchiveReplacesAndExtends)
+{
+	std::vector<std::vector<BYTE> > shaders;
+	REQUIRE(ReadShaders(shaders));
+
+	ShaderArchive archive;
+	archive.Add("DefaultPixel", 0x3, &shaders[1][0], shaders[1].size());
+	archive.Add("DefaultPixel", 0x3, &shaders[2][0], shaders[2].size());
+	CHECK_EQUAL(1u, archive.GetPermutationCount());
+	CHECK(Matches(archive, "DefaultPixel", 0x3, shaders[2]));
+
+	// Nothing to add
+	archive.Add("DefaultPixel", 0x7, NULL, 0);
+	archive.Add("DefaultPixel", 0x7, &shaders[1][0], 0);
+	CHECK_EQUAL(1u, archive.GetPermutationCount());
+
+	// A loaded archive takes more permutations, sharing what it already has
+	std::vector<BYTE> data;
+	archive.Write(data);
+	ShaderArchive read;
+	REQUIRE(read.Read(&data[0], data.size()));
+	read.Add("PixelNoNormal", 0, &shaders[2][0], shaders[2].size());
+	read.Add("Shadow", 0, &shaders[7][0], shaders[7].size());
+	CHECK_EQUAL(3u, read.GetPermutationCount());
+	CHECK(Matches(read, "DefaultPixel", 0x3, shaders[2]));
+	CHECK(Matches(read, "PixelNoNormal", 0, shaders[2]));
+	CHECK(Matches(read, "Shadow", 0, shaders[7]));
+
+	read.Write(data);
+	ShaderArchive reread;
+	REQUIRE(reread.Read(&data[0], data.size()));
+	CHECK_EQUAL(3u, reread.GetPermutationCount());
+	CHECK(Matches(reread, "Shadow", 0, shaders[7]));
+
+	// Names are hashed whole, not by prefix or case
+	const BYTE* bytecode;
+	size_t size;
+	CHECK(!reread.Find("Shado", 0, bytecode, size));
+	CHECK(!reread.Find("shadow", 0, bytecode, size));
+}
+
+TEST(ShaderArchiveLoadsFromFile)
+{
+	std::vector<std::vector<BYTE> > shaders;
+	REQUIRE(ReadShaders(shaders));
+	ShaderArchive archive;
+	AddShaders(archive, shaders);
+	std::vector<BYTE> data;
+	archive.Write(data);
+
+	char path[] = "/tmp/shaderarchiveXXXXXX";
+	int fd = mkstemp(path);
+	REQUIRE(fd >= 0);
+	bool written = write(fd, &data[0], data.size()) == (ssize_t)data.size();
+	close(fd);
+	std::string narrow(path);
+
+	ShaderArchive loaded;
+	CHECK(written && loaded.Load(std::wstring(narrow.begin(), narrow.end())));
+	CHECK_EQUAL(archive.GetPermutationCount(), loaded.GetPermutationCount());
+	CHECK(Matches(loaded, "DefaultVertex", 0, shaders[0]));
+	unlink(path);
+
+	CHECK(!loaded.Load(L"Tests/Data/Shaders/Missing.perm"));
+}
+
+TEST(ShaderArchiveRejectsCorruptArchives)
+{
+	std::vector<std::vector<BYTE> > shaders;
+	REQUIRE(ReadShaders(shaders));
+	ShaderArchive archive;
+	AddShaders(archive, shaders);
+	std::vector<BYTE> data;
+	archive.Write(data);
+
+	ShaderArchive read;
+	CHECK(!read.Read(NULL, 0));
+
+	// The fixtures are whole words, so any cut loses bytecode some entry points at
+	for (size_t size = 0; size < data.size(); size += size < 512 ? 1 : 331)
+	{
+		CHECK(!read.Read(&data[0], size));
+		CHECK_EQUAL(0u, read.GetPermutationCount());
+	}
+
+	std::vector<BYTE> corrupt = data;
+	corrupt[0] ^= 0xff;
+	CHECK(!read.Read(&corrupt[0], corrupt.size()));
+
+	corrupt = data;
+	corrupt[offsetof(ShaderArchiveHeader, version)]++;
+	CHECK(!read.Read(&corrupt[0], corrupt.size()));
+
+	corrupt = data;
+	UINT entries = 0x10000000;
+	memcpy(&corrupt[offsetof(ShaderArchiveHeader, entryCount)], &entries, sizeof(UINT));
+	CHECK(!read.Read(&corrupt[0], corrupt.size()));
+
+	// An entry pointing into the table, and one running past the end
+	ShaderArchiveEntry entry;
+	size_t first = sizeof(ShaderArchiveHeader);
+	corrupt = data;
+	memcpy(&entry, &corrupt[first], sizeof(entry));
+	entry.offset = 0;
+	memcpy(&corrupt[first], &entry, sizeof(entry));
+	CHECK(!read.Read(&corrupt[0], corrupt.size()));
+
+	corrupt = data;
+	memcpy(&entry, &corrupt[first], sizeof(entry));
+	entry.size = (UINT)corrupt.size();
+	memcpy(&corrupt[first], &entry, sizeof(entry));
+	CHECK(!read.Read(&corrupt[0], corrupt.size()));
+	const BYTE* bytecode;
+	size_t size;
+	CHECK(!read.Find("DefaultVertex", 0, bytecode, size));
+
+	// Still reads after all that
+	CHECK(read.Read(&data[0], data.size()));
+	CHECK(Matches(read, "DefaultVertex", 0, shaders[0]));
+}
@@ -0,0 +1,192 @@
+//
+// Permutation keys and counts: every feature mask normalizes to one of CountAll distinct permutations with its own
+// defines, and -buildshaders archives exactly the permutations the materials look up, compiled with a fake compiler
+// that turns the defines into bytecode
+//
+
+#include "Test.h"
+#include "ShaderArchive.h"
+#include "ShaderBuildCommand.h"
+
+#include <set>
+#include <unistd.h>
+
+// Every bit ShaderFeature defines
+static const UINT FeatureBits = 9;
+
+/// <summary>Bytecode that spells out what was compiled, so equal defines give equal bytecode
+/// Fails sources whose defines turn fog on, if asked to
+/// </summary>
+class FakeShaderCompiler : public ShaderCompiler
+{
+public:
+	FakeShaderCompiler() :
+	failFog(false)
+	{
+
+	}
+
+	bool Compile(const std::string& source, const std::vector<ShaderDefine>& defines, const std::string& target,
+		std::vector<BYTE>& bytecode, std::string& errors)
+	{
+		sources.push_back(source);
+		std::string text = Describe(defines) + " " + target;
+		if (failFog && text.find("FOG=1") != std::string::npos)
+		{
+			errors = "fog doesn't compile";
+			return false;
+		}
+		bytecode.assign(text.begin(), text.end());
+		return true;
+	}
+
+	static std::string Describe(const std::vector<ShaderDefine>& defines)
+	{
+		std::string text;
+		for (const ShaderDefine& define : defines)
+			text += define.name + "=" + define.value + ";";
+		return text;
+	}
+
+	bool failFog;
+	std::vector<std::string> sources;
+};
+
+/// <summary>Runs -buildshaders with the compiler into a temporary archive and report, then loads both
+/// </summary>
+static int Build(ShaderCompiler& compiler, ShaderArchive& archive, std::string& report)
+{
+	char archivePath[] = "/tmp/shaderbuildXXXXXX";
+	char reportPath[] = "/tmp/shaderbuildlogXXXXXX";
+	int archiveFile = mkstemp(archivePath);
+	int reportFile = mkstemp(reportPath);
+	close(archiveFile);
+	close(reportFile);
+
+	// The report is read back from its file, echoing it would only clutter the test output
+	std::ostream quiet(NULL);
+	ShaderBuildCommand command;
+	command.SetLog(&quiet);
+	std::string commandLine = std::string("-buildshaders in=Shaders out=") + archivePath + " target=ps_5_0 report=" + reportPath;
+	int result = command.ParseCommandLine(commandLine.c_str()) ? command.Run(compiler) : -1;
+
+	std::string narrow(archivePath);
+	if (!archive.Load(std::wstring(narrow.begin(), narrow.end())))
+		result = -1;
+	std::ifstream file(reportPath);
+	report.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	unlink(archivePath);
+	unlink(reportPath);
+	return result;
+}
+
+TEST(ShaderPermutationsCountDistinctMasks)
+{
+	std::set<UINT> masks;
+	std::set<std::string> defineSets, names;
+	for (UINT features = 0; features < (1u << FeatureBits); features++)
+	{
+		UINT normalized = ShaderPermutations::Normalize(features);
+		CHECK_EQUAL(normalized, ShaderPermutations::Normalize(normalized));
+		masks.insert(normalized);
+
+		// The key the archive uses decides the defines, whatever bits it was normalized from
+		std::vector<ShaderDefine> defines, normalizedDefines;
+		ShaderPermutations::GetDefines(features, defines);
+		ShaderPermutations::GetDefines(normalized, normalizedDefines);
+		CHECK_EQUAL(FakeShaderCompiler::Describe(normalizedDefines), FakeShaderCompiler::Describe(defines));
+		CHECK_EQUAL(ShaderPermutations::GetName(normalized), ShaderPermutations::GetName(features));
+	}
+	CHECK_EQUAL(ShaderPermutations::CountAll(), (UINT)masks.size());
+
+	// Each key compiles differently and reads differently
+	for (UINT mask : masks)
+	{
+		std::vector<ShaderDefine> defines;
+		ShaderPermutations::GetDefines(mask, defines);
+		defineSets.insert(FakeShaderCompiler::Describe(defines));
+		names.insert(ShaderPermutations::GetName(mask));
+	}
+	CHECK_EQUAL(masks.size(), defineSets.size());
+	CHECK_EQUAL(masks.size(), names.size());
+
+	CHECK_EQUAL(std::string("NONE"), ShaderPermutations::GetName(0));
+	CHECK_EQUAL(0u, ShaderPermutations::Normalize(FeaturePCF4 | FeaturePCF9));
+	CHECK_EQUAL((UINT)(FeatureShadows | FeaturePCF9), ShaderPermutations::Normalize(FeatureShadows | FeaturePCF4 | FeaturePCF9));
+}
+
+TEST(ShaderPermutationsListTheMaterialsLookups)
+{
+	std::vector<ShaderPermutation> used;
+	ShaderPermutations::GetUsed(used);
+
+	// Brick and default materials, with and without the atlas, as LoadAssets asks for them
+	std::set<UINT> lookups;
+	for (UINT atlas = 0; atlas < 2; atlas++)
+	{
+		UINT textures = atlas ? FeatureTextureArray : 0;
+		lookups.insert(ShaderPermutations::Normalize(FeatureNormalMap | ShaderPermutations::GetSceneFeatures() | textures));
+		lookups.insert(ShaderPermutations::Normalize(ShaderPermutations::GetSceneFeatures() | textures));
+	}
+
+	std::set<UINT> listed;
+	for (const ShaderPermutation& permutation : used)
+	{
+		CHECK_EQUAL(std::string("LitPixel"), permutation.shader);
+		CHECK_EQUAL(ShaderPermutations::Normalize(permutation.features), permutation.features);
+		listed.insert(permutation.features);
+	}
+	CHECK_EQUAL(used.size(), listed.size());
+	CHECK(listed == lookups);
+}
+
+TEST(ShaderBuildCommandArchivesUsedPermutations)
+{
+	FakeShaderCompiler compiler;
+	ShaderArchive archive;
+	std::string report;
+	CHECK_EQUAL(0, Build(compiler, archive, report));
+
+	std::vector<ShaderPermutation> used;
+	ShaderPermutations::GetUsed(used);
+	CHECK_EQUAL((UINT)used.size(), archive.GetPermutationCount());
+	CHECK_EQUAL((UINT)used.size(), archive.GetBlobCount());
+	REQUIRE(compiler.sources.size() == used.size());
+	for (size_t i = 0; i < used.size(); i++)
+	{
+		CHECK_EQUAL(std::string("Shaders/LitPixel.hlsli"), compiler.sources[i]);
+
+		// Stored under the normalized mask, compiled with that mask's defines for the requested target
+		std::vector<ShaderDefine> defines;
+		ShaderPermutations::GetDefines(used[i].features, defines);
+		std::string expected = FakeShaderCompiler::Describe(defines) + " ps_5_0";
+		const BYTE* bytecode = NULL;
+		size_t size = 0;
+		REQUIRE(archive.Find("LitPixel", used[i].features, bytecode, size));
+		CHECK_EQUAL(expected, std::string((const char*)bytecode, size));
+
+		CHECK(report.find("LitPixel " + ShaderPermutations::GetName(used[i].features) + ": ") != std::string::npos);
+	}
+
+	std::ostringstream counts;
+	counts << "Compiled " << used.size() << " of " << ShaderPermutations::CountAll() << " possible permutations, " << used.size() << " distinct";
+	CHECK(report.find(counts.str()) != std::string::npos);
+
+	// A mask nothing asked for isn't there
+	const BYTE* bytecode;
+	size_t size;
+	CHECK(!archive.Find("LitPixel", 0, bytecode, size));
+}
+
+TEST(ShaderBuildCommandReportsFailures)
+{
+	// The scene turns fog on, so everything fails and the archive is empty
+	FakeShaderCompiler compiler;
+	compiler.failFog = true;
+	ShaderArchive archive;
+	std::string report;
+	CHECK_EQUAL(1, Build(compiler, archive, report));
+	CHECK_EQUAL(0u, archive.GetPermutationCount());
+	CHECK(report.find("failed to compile\nfog doesn't compile") != std::string::npos);
+	CHECK(report.find("Compiled 0 of ") != std::string::npos);
+}
@@ -0,0 +1,336 @@
+//
+// Input signatures read out of compiled shaders and matched against vertex formats
+// Tests/Data/Shaders holds bytecode compiled from an earlier revision of the HLSL. Only the pixel shaders and the constant
+// buffers have changed since, the vertex inputs these tests read are the same, so the blobs stay as fixed inputs rather
+// than build outputs. Containers built here cover the skinned signature, the ISG1 layout and corrupt bytecode
+//
+
+#include "Test.h"
+#include "ShaderReflection.h"
+#include "Vertex.h"
+
+// Paths are relative to the repository root
+static const char* ShaderDirectory = "Tests/Data/Shaders/";
+
+static bool ReadFile(const std::string& path, std::vector<BYTE>& data)
+{
+	std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+	if (!file)
+		return false;
+	std::streamsize size = file.tellg();
+	data.resize((size_t)size);
+	file.seekg(0, std::ios::beg);
+	return size > 0 && file.read((char*)&data[0], size);
+}
+
+static bool ReadShader(const char* name, std::vector<ShaderInputElement>& inputs)
+{
+	std::vector<BYTE> bytecode;
+	return ReadFile(std::string(ShaderDirectory) + name, bytecode) &&
+		ShaderReflection::ReadInputSignature(&bytecode[0], bytecode.size(), inputs);
+}
+
+static void AppendUInt(std::vector<BYTE>& data, UINT value)
+{
+	data.insert(data.end(), (const BYTE*)&value, (const BYTE*)&value + sizeof(UINT));
+}
+
+static void WriteUInt(std::vector<BYTE>& data, size_t offset, UINT value)
+{
+	memcpy(&data[offset], &value, sizeof(UINT));
+}
+
+/// <summary>Signature chunk data as fxc writes it: count, offset of the elements, the elements, then the names
+/// </summary>
+static std::vector<BYTE> BuildSignature(const std::vector<ShaderInputElement>& inputs, bool extended)
+{
+	UINT stride = extended ? 32 : 24;
+	std::vector<BYTE> data;
+	AppendUInt(data, (UINT)inputs.size());
+	AppendUInt(data, 8);
+	size_t names = data.size() + inputs.size() * stride;
+	std::string nameData;
+	for (const ShaderInputElement& input : inputs)
+	{
+		if (extended)
+			AppendUInt(data, 0);
+		AppendUInt(data, (UINT)(names + nameData.size()));
+		AppendUInt(data, input.semanticIndex);
+		AppendUInt(data, input.systemValue);
+		AppendUInt(data, (UINT)input.componentType);
+		AppendUInt(data, input.registerIndex);
+		AppendUInt(data, input.mask | (input.mask << 8));
+		if (extended)
+			AppendUInt(data, 0);
+		nameData.append(input.semantic.c_str(), input.semantic.size() + 1);
+	}
+	data.insert(data.end(), nameData.begin(), nameData.end());
+	data.resize((data.size() + 3) & ~3);
+	return data;
+}
+
+/// <summary>DXBC container around the given chunks, the checksum is left zero since only the device checks it
+/// </summary>
+static std::vector<BYTE> BuildContainer(const std::vector<std::pair<std::string, std::vector<BYTE> > >& chunks)
+{
+	std::vector<BYTE> container(32 + chunks.size() * 4);
+	memcpy(&container[0], "DXBC", 4);
+	WriteUInt(container, 20, 1);
+	WriteUInt(container, 28, (UINT)chunks.size());
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		WriteUInt(container, 32 + i * 4, (UINT)container.size());
+		container.insert(container.end(), chunks[i].first.begin(), chunks[i].first.begin() + 4);
+		AppendUInt(container, (UINT)chunks[i].second.size());
+		container.insert(container.end(), chunks[i].second.begin(), chunks[i].second.end());
+	}
+	WriteUInt(container, 24, (UINT)container.size());
+	return container;
+}
+
+static ShaderInputElement Input(const char* semantic, UINT semanticIndex, ShaderComponentType type, UINT registerIndex, BYTE mask)
+{
+	ShaderInputElement input;
+	input.semantic = semantic;
+	input.semanticIndex = semanticIndex;
+	input.systemValue = 0;
+	input.componentType = type;
+	input.registerIndex = registerIndex;
+	input.mask = mask;
+	return input;
+}
+
+/// <summary>What SkinnedVertex.hlsl declares
+/// </summary>
+static std::vector<ShaderInputElement> SkinnedInputs()
+{
+	std::vector<ShaderInputElement> inputs;
+	inputs.push_back(Input("POSITION", 0, ComponentFloat, 0, 0x7));
+	inputs.push_back(Input("COLOR", 0, ComponentFloat, 1, 0xf));
+	inputs.push_back(Input("TEXCOORD", 0, ComponentFloat, 2, 0x3));
+	inputs.push_back(Input("NORMAL", 0, ComponentFloat, 3, 0x7));
+	inputs.push_back(Input("TANGENT", 0, ComponentFloat, 4, 0xf));
+	inputs.push_back(Input("BLENDINDICES", 0, ComponentUInt, 5, 0xf));
+	inputs.push_back(Input("BLENDWEIGHT", 0, ComponentFloat, 6, 0xf));
+	return inputs;
+}
+
+static std::vector<BYTE> BuildShader(const std::vector<ShaderInputElement>& inputs, bool extended)
+{
+	std::vector<std::pair<std::string, std::vector<BYTE> > > chunks;
+	chunks.push_back(std::make_pair(std::string("RDEF"), std::vector<BYTE>(16, 0)));
+	chunks.push_back(std::make_pair(std::string(extended ? "ISG1" : "ISGN"), BuildSignature(inputs, extended)));
+	chunks.push_back(std::make_pair(std::string("SHDR"), std::vector<BYTE>(8, 0)));
+	return BuildContainer(chunks);
+}
+
+TEST(ShaderReflectionReadsFixtureSignatures)
+{
+	std::vector<ShaderInputElement> inputs;
+	REQUIRE(ReadShader("DefaultVertex.cso", inputs));
+	REQUIRE(inputs.size() == 5);
+	const char* semantics[] = { "POSITION", "COLOR", "TEXCOORD", "NORMAL", "TANGENT" };
+	const BYTE masks[] = { 0x7, 0xf, 0x3, 0x7, 0xf };
+	for (UINT i = 0; i < 5; i++)
+	{
+		CHECK_EQUAL(std::string(semantics[i]), inputs[i].semantic);
+		CHECK_EQUAL(0u, inputs[i].semanticIndex);
+		CHECK_EQUAL(0u, inputs[i].systemValue);
+		CHECK_EQUAL(ComponentFloat, inputs[i].componentType);
+		CHECK_EQUAL(i, inputs[i].registerIndex);
+		CHECK_EQUAL((int)masks[i], (int)inputs[i].mask);
+	}
+
+	REQUIRE(ReadShader("Shadow.cso", inputs));
+	REQUIRE(inputs.size() == 1);
+	CHECK_EQUAL(std::string("POSITION"), inputs[0].semantic);
+	CHECK_EQUAL(0xf, (int)inputs[0].mask);
+
+	// Pixel shaders start with the position the rasterizer generates
+	REQUIRE(ReadShader("DefaultPixel.cso", inputs));
+	REQUIRE(inputs.size() == 7);
+	CHECK_EQUAL(std::string("SV_POSITION"), inputs[0].semantic);
+	CHECK_EQUAL(1u, inputs[0].systemValue);
+	CHECK_EQUAL(std::string("TEXCOORD"), inputs[6].semantic);
+	CHECK_EQUAL(1u, inputs[6].semanticIndex);
+
+	// An empty signature still reads, the shader just has no inputs
+	REQUIRE(ReadShader("NoLightPixel.cso", inputs));
+	CHECK(inputs.empty());
+}
+
+TEST(ShaderReflectionHashesSharedSignatures)
+{
+	// The three vertex shaders read different inputs but declare the same ones, so they share an input layout
+	std::vector<ShaderInputElement> defaultVertex, noLight, fullScreen, shadow;
+	REQUIRE(ReadShader("DefaultVertex.cso", defaultVertex));
+	REQUIRE(ReadShader("NoLightVert.cso", noLight));
+	REQUIRE(ReadShader("FullScreenQuadVert.cso", fullScreen));
+	REQUIRE(ReadShader("Shadow.cso", shadow));
+
+	UINT64 hash = ShaderReflection::HashInputSignature(defaultVertex);
+	CHECK_EQUAL(hash, ShaderReflection::HashInputSignature(noLight));
+	CHECK_EQUAL(hash, ShaderReflection::HashInputSignature(fullScreen));
+	CHECK(hash != ShaderReflection::HashInputSignature(shadow));
+	CHECK(hash != ShaderReflection::HashInputSignature(std::vector<ShaderInputElement>()));
+
+	// Rebuilt from what was read, the signature hashes the same
+	std::vector<BYTE> rebuilt = BuildShader(defaultVertex, false);
+	std::vector<ShaderInputElement> reread;
+	REQUIRE(ShaderReflection::ReadInputSignature(&rebuilt[0], rebuilt.size(), reread));
+	CHECK_EQUAL(hash, ShaderReflection::HashInputSignature(reread));
+
+	CHECK(ShaderReflection::HashVertexFormat(VertexFormatDefault) != ShaderReflection::HashVertexFormat(VertexFormatSkinned));
+	VertexFormat copy = VertexFormatDefault;
+	copy.name = "Copy";
+	CHECK_EQUAL(ShaderReflection::HashVertexFormat(VertexFormatDefault), ShaderReflection::HashVertexFormat(copy));
+	copy.stride += 4;
+	CHECK(ShaderReflection::HashVertexFormat(VertexFormatDefault) != ShaderReflection::HashVertexFormat(copy));
+}
+
+TEST(ShaderReflectionMatchesVertexFormats)
+{
+	const char* shaders[] = { "DefaultVertex.cso", "NoLightVert.cso", "FullScreenQuadVert.cso", "Shadow.cso" };
+	for (const char* shader : shaders)
+	{
+		std::vector<ShaderInputElement> inputs;
+		REQUIRE(ReadShader(shader, inputs));
+		std::string error = "stale";
+		CHECK(ShaderReflection::MatchVertexFormat(inputs, VertexFormatDefault, error));
+		CHECK(error.empty());
+
+		// Extra attributes the shader doesn't read are fine
+		CHECK(ShaderReflection::MatchVertexFormat(inputs, VertexFormatSkinned, error));
+	}
+
+	// System values come from the input assembler, not the vertex
+	std::vector<ShaderInputElement> inputs(1, Input("SV_VertexID", 0, ComponentUInt, 0, 0x1));
+	inputs[0].systemValue = 6;
+	std::string error;
+	CHECK(ShaderReflection::MatchVertexFormat(inputs, VertexFormatDefault, error));
+
+	// Semantics compare without case, as the runtime does
+	inputs.assign(1, Input("position", 0, ComponentFloat, 0, 0x7));
+	CHECK(ShaderReflection::MatchVertexFormat(inputs, VertexFormatDefault, error));
+}
+
+TEST(ShaderReflectionRejectsMismatchedFormats)
+{
+	std::vector<ShaderInputElement> inputs;
+	REQUIRE(ReadShader("DefaultVertex.cso", inputs));
+	std::string error;
+
+	// Missing the tangent
+	VertexFormat missing = VertexFormatDefault;
+	missing.attributeCount = 4;
+	CHECK(!ShaderReflection::MatchVertexFormat(inputs, missing, error));
+	CHECK(error.find("TANGENT0") != std::string::npos);
+
+	// Color stored as integers
+	std::vector<VertexAttribute> attributes(VertexAttributes, VertexAttributes + 5);
+	attributes[1].format = DXGI_FORMAT_R8G8B8A8_UINT;
+	VertexFormat wrongType = { "WrongType", &attributes[0], 5, sizeof(Vertex) };
+	CHECK(!ShaderReflection::MatchVertexFormat(inputs, wrongType, error));
+	CHECK(error.find("COLOR0") != std::string::npos);
+
+	// A format this doesn't know the type of
+	attributes[1].format = DXGI_FORMAT_R10G10B10A2_UNORM;
+	CHECK(!ShaderReflection::MatchVertexFormat(inputs, wrongType, error));
+
+	// Stride too short for the last attribute
+	VertexFormat shortStride = VertexFormatDefault;
+	shortStride.stride = offsetof(Vertex, Tangent) + 8;
+	CHECK(!ShaderReflection::MatchVertexFormat(inputs, shortStride, error));
+	CHECK(error.find("past the end") != std::string::npos);
+
+	// The skinned shader needs the influences a plain vertex doesn't have
+	std::vector<BYTE> skinned = BuildShader(SkinnedInputs(), false);
+	REQUIRE(ShaderReflection::ReadInputSignature(&skinned[0], skinned.size(), inputs));
+	CHECK(ShaderReflection::MatchVertexFormat(inputs, VertexFormatSkinned, error));
+	CHECK(!ShaderReflection::MatchVertexFormat(inputs, VertexFormatDefault, error));
+	CHECK(error.find("BLENDINDICES0") != std::string::npos);
+}
+
+TEST(ShaderReflectionReadsExtendedSignatures)
+{
+	std::vector<ShaderInputElement> expected = SkinnedInputs();
+	std::vector<BYTE> plain = BuildShader(expected, false);
+	std::vector<BYTE> extended = BuildShader(expected, true);
+
+	std::vector<ShaderInputElement> fromPlain, fromExtended;
+	REQUIRE(ShaderReflection::ReadInputSignature(&plain[0], plain.size(), fromPlain));
+	REQUIRE(ShaderReflection::ReadInputSignature(&extended[0], extended.size(), fromExtended));
+	REQUIRE(fromExtended.size() == expected.size());
+	for (size_t i = 0; i < expected.size(); i++)
+	{
+		CHECK_EQUAL(expected[i].semantic, fromExtended[i].semantic);
+		CHECK_EQUAL(expected[i].componentType, fromExtended[i].componentType);
+		CHECK_EQUAL(expected[i].registerIndex, fromExtended[i].registerIndex);
+		CHECK_EQUAL((int)expected[i].mask, (int)fromExtended[i].mask);
+	}
+	CHECK_EQUAL(ShaderReflection::HashInputSignature(fromPlain), ShaderReflection::HashInputSignature(fromExtended));
+}
+
+TEST(ShaderReflectionRejectsCorruptBytecode)
+{
+	std::vector<BYTE> bytecode;
+	std::vector<ShaderInputElement> inputs;
+	REQUIRE(ReadFile(std::string(ShaderDirectory) + "DefaultVertex.cso", bytecode));
+	CHECK(!ShaderReflection::ReadInputSignature(NULL, 0, inputs));
+
+	// Every cut short of the full container fails, since the header records its size
+	for (size_t size = 0; size < bytecode.size(); size += size < 64 ? 1 : 97)
+	{
+		inputs.assign(1, ShaderInputElement());
+		CHECK(!ShaderReflection::ReadInputSignature(&bytecode[0], size, inputs));
+		CHECK(inputs.empty());
+	}
+
+	std::vector<BYTE> corrupt = bytecode;
+	corrupt[0] = 'X';
+	CHECK(!ShaderReflection::ReadInputSignature(&corrupt[0], corrupt.size(), inputs));
+
+	corrupt = bytecode;
+	WriteUInt(corrupt, 28, 0x40000000);
+	CHECK(!ShaderReflection::ReadInputSignature(&corrupt[0], corrupt.size(), inputs));
+
+	corrupt = bytecode;
+	WriteUInt(corrupt, 32, (UINT)corrupt.size() - 4);
+	CHECK(!ShaderReflection::ReadInputSignature(&corrupt[0], corrupt.size(), inputs));
+
+	// No signature chunk at all
+	std::vector<std::pair<std::string, std::vector<BYTE> > > chunks;
+	chunks.push_back(std::make_pair(std::string("SHDR"), std::vector<BYTE>(8, 0)));
+	std::vector<BYTE> noSignature = BuildContainer(chunks);
+	CHECK(!ShaderReflection::ReadInputSignature(&noSignature[0], noSignature.size(), inputs));
+
+	// Element count, name offset and name termination each past the end of the chunk
+	std::vector<ShaderInputElement> skinned = SkinnedInputs();
+	std::vector<BYTE> signature = BuildSignature(skinned, false);
+	size_t chunkData = 32 + 3 * 4 + (8 + 16) + 8;	// Header, chunk offsets, RDEF, ISGN header
+	std::vector<BYTE> built = BuildShader(skinned, false);
+	REQUIRE(memcmp(&built[chunkData], &signature[0], signature.size()) == 0);
+
+	corrupt = built;
+	WriteUInt(corrupt, chunkData, 1000);
+	CHECK(!ShaderReflection::ReadInputSignature(&corrupt[0], corrupt.size(), inputs));
+
+	corrupt = built;
+	WriteUInt(corrupt, chunkData + 8, (UINT)signature.size());
+	CHECK(!ShaderReflection::ReadInputSignature(&corrupt[0], corrupt.size(), inputs));
+
+	corrupt = built;
+	for (size_t i = signature.size() - 16; i < signature.size(); i++)
+		corrupt[chunkData + i] = 'A';
+	CHECK(!ShaderReflection::ReadInputSignature(&corrupt[0], corrupt.size(), inputs));
+
+	// Random damage may still parse, but never reads outside the bytecode
+	std::mt19937 random(5);
+	for (UINT trial = 0; trial < 2000; trial++)
+	{
+		corrupt = built;
+		for (UINT flips = 1 + random() % 4; flips > 0; flips--)
+			corrupt[random() % corrupt.size()] ^= (BYTE)(1 + random() % 255);
+		ShaderReflection::ReadInputSignature(&corrupt[0], corrupt.size(), inputs);
+	}
+}
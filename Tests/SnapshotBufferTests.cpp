@@ -0,0 +1,115 @@
+//
+// Triple buffer handoff between the update and render threads
+//
+
+#include "Test.h"
+#include "SnapshotBuffer.h"
+
+// Snapshot with enough payload that a torn copy would show
+struct TestSnapshot
+{
+	UINT sequence;
+	UINT payload[64];
+};
+
+static void Fill(TestSnapshot& snapshot, UINT sequence)
+{
+	snapshot.sequence = sequence;
+	for (UINT& value : snapshot.payload)
+		value = sequence;
+}
+
+static bool IsWhole(const TestSnapshot& snapshot)
+{
+	for (UINT value : snapshot.payload)
+	{
+		if (value != snapshot.sequence)
+			return false;
+	}
+	return true;
+}
+
+TEST(SnapshotBufferAcquireFailsBeforePublish)
+{
+	SnapshotBuffer<TestSnapshot> buffer;
+	Fill(buffer.WriteSlot(), 1);
+	CHECK(!buffer.Acquire());
+}
+
+TEST(SnapshotBufferAcquireSeesPublishedSlot)
+{
+	SnapshotBuffer<TestSnapshot> buffer;
+	Fill(buffer.WriteSlot(), 1);
+	buffer.Publish();
+	REQUIRE(buffer.Acquire());
+	CHECK_EQUAL(1u, buffer.ReadSlot().sequence);
+
+	// Nothing new, the reader keeps what it has
+	CHECK(!buffer.Acquire());
+	CHECK_EQUAL(1u, buffer.ReadSlot().sequence);
+}
+
+TEST(SnapshotBufferAcquireSkipsToNewest)
+{
+	SnapshotBuffer<TestSnapshot> buffer;
+	for (UINT i = 1; i <= 5; i++)
+	{
+		Fill(buffer.WriteSlot(), i);
+		buffer.Publish();
+	}
+	REQUIRE(buffer.Acquire());
+	CHECK_EQUAL(5u, buffer.ReadSlot().sequence);
+	CHECK(!buffer.Acquire());
+}
+
+TEST(SnapshotBufferWriterNeverGetsReadSlot)
+{
+	SnapshotBuffer<TestSnapshot> buffer;
+	for (UINT i = 1; i <= 50; i++)
+	{
+		Fill(buffer.WriteSlot(), i);
+		buffer.Publish();
+		if (i % 3 == 0)
+			buffer.Acquire();
+		CHECK(&buffer.WriteSlot() != &buffer.ReadSlot());
+	}
+}
+
+TEST(SnapshotBufferReaderNeverSeesTornOrOlderSlots)
+{
+	const UINT published = 200000;
+	SnapshotBuffer<TestSnapshot> buffer;
+
+	std::thread writer([&buffer, published]()
+	{
+		for (UINT i = 1; i <= published; i++)
+		{
+			Fill(buffer.WriteSlot(), i);
+			buffer.Publish();
+		}
+	});
+
+	UINT last = 0;
+	UINT acquired = 0;
+	bool whole = true;
+	bool ordered = true;
+	while (last < published)
+	{
+		if (!buffer.Acquire())
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		const TestSnapshot& snapshot = buffer.ReadSlot();
+		whole = whole && IsWhole(snapshot);
+		ordered = ordered && snapshot.sequence > last;
+		last = snapshot.sequence;
+		acquired++;
+	}
+	writer.join();
+
+	CHECK(whole);
+	CHECK(ordered);
+	CHECK(acquired > 0);
+	CHECK_EQUAL(published, last);
+}
@@ -0,0 +1,400 @@
+//
+// Rasterization rules of the software renderer: shared edges cover each pixel center once, depth tests LESS_EQUAL,
+// back faces are culled, clipped triangles keep their inside, and the frame doesn't depend on the thread count
+// Draws are told apart by their material's diffuse alpha, which the lit pixel shader passes straight through
+//
+
+#include "Test.h"
+#include "ImageConvert.h"
+#include "PNGDecoder.h"
+#include "PNGEncoder.h"
+#include "ShaderPermutations.h"
+#include "SoftwareRenderer.h"
+
+static const UINT TargetWidth = 64;
+static const UINT TargetHeight = 48;
+
+// Alpha the clear color leaves where nothing was drawn
+static const BYTE ClearAlpha = 0;
+
+/// <summary>Identity view and projection, so vertex positions are clip space with w = 1
+/// Without features every drawn pixel is black with its material's alpha
+/// </summary>
+static SoftwareFrameData MakeFrame(UINT features)
+{
+	SoftwareFrameData frame = SoftwareFrameData();
+	XMStoreFloat4x4(&frame.view, XMMatrixIdentity());
+	XMStoreFloat4x4(&frame.projection, XMMatrixIdentity());
+	XMStoreFloat4x4(&frame.shadowView, XMMatrixIdentity());
+	XMStoreFloat4x4(&frame.shadowProjection, XMMatrixIdentity());
+	frame.clearColor = XMFLOAT4(0.0f, 0.0f, 0.0f, ClearAlpha / 255.0f);
+	frame.features = features;
+	return frame;
+}
+
+/// <summary>Material whose draws come out with the given alpha
+/// </summary>
+static SoftwareMaterial MakeMaterial(BYTE alpha)
+{
+	SoftwareMaterial material;
+	material.lightMat.ambient = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
+	material.lightMat.diffuse = XMFLOAT4(0.8f, 0.8f, 0.8f, alpha / 255.0f);
+	material.lightMat.specular = XMFLOAT4(0.5f, 0.5f, 0.5f, 16.0f);
+	return material;
+}
+
+static Vertex MakeVertex(float x, float y, float z)
+{
+	Vertex vertex(XMFLOAT3(x, y, z), XMFLOAT2((x + 1.0f) * 0.5f, (1.0f - y) * 0.5f));
+	vertex.Color = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+	vertex.Normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
+	vertex.Tangent = XMFLOAT3(1.0f, 0.0f, 0.0f);
+	return vertex;
+}
+
+static SoftwareDraw MakeDraw(const std::vector<Vertex>& vertices, const std::vector<UINT>& indices, const SoftwareMaterial& material)
+{
+	SoftwareDraw draw;
+	draw.vertices = &vertices[0];
+	draw.vertexCount = (UINT)vertices.size();
+	draw.indices = &indices[0];
+	draw.indexCount = (UINT)indices.size();
+	XMStoreFloat4x4(&draw.world, XMMatrixIdentity());
+	XMStoreFloat4x4(&draw.worldInverseTranspose, XMMatrixIdentity());
+	draw.material = &material;
+	return draw;
+}
+
+static BYTE GetAlpha(const ImageData& image, UINT x, UINT y)
+{
+	return image.rgba[((size_t)y * image.width + x) * 4 + 3];
+}
+
+/// <summary>Quad from (x0, y0) to (x1, y1) in clip space at depth z, wound to face the camera
+/// </summary>
+static void AddQuad(float x0, float y0, float x1, float y1, float z, std::vector<Vertex>& vertices, std::vector<UINT>& indices)
+{
+	UINT first = (UINT)vertices.size();
+	vertices.push_back(MakeVertex(x0, y1, z));
+	vertices.push_back(MakeVertex(x1, y1, z));
+	vertices.push_back(MakeVertex(x1, y0, z));
+	vertices.push_back(MakeVertex(x0, y0, z));
+	UINT quad[6] = { 0, 1, 2, 0, 2, 3 };
+	for (UINT index : quad)
+		indices.push_back(first + index);
+}
+
+TEST(SoftwareRendererCoversSharedEdgesOnce)
+{
+	// A jittered grid reaching past the screen, diagonals flipped at random, so every pixel center is inside exactly
+	// one triangle. Each triangle is drawn alone and the pixels it covers are counted
+	std::mt19937 random(17);
+	const UINT cells = 6;
+	std::vector<Vertex> vertices;
+	for (UINT y = 0; y <= cells; y++)
+	{
+		for (UINT x = 0; x <= cells; x++)
+		{
+			bool border = x == 0 || y == 0 || x == cells || y == cells;
+			float jitter = border ? 0.0f : 0.12f;
+			float px = -1.2f + 2.4f * x / cells + jitter * ((random() % 1000) / 500.0f - 1.0f);
+			float py = 1.2f - 2.4f * y / cells + jitter * ((random() % 1000) / 500.0f - 1.0f);
+			vertices.push_back(MakeVertex(px, py, 0.5f));
+		}
+	}
+
+	std::vector<std::vector<UINT> > triangles;
+	for (UINT y = 0; y < cells; y++)
+	{
+		for (UINT x = 0; x < cells; x++)
+		{
+			UINT topLeft = y * (cells + 1) + x;
+			UINT topRight = topLeft + 1;
+			UINT bottomLeft = topLeft + cells + 1;
+			UINT bottomRight = bottomLeft + 1;
+			UINT flipped[2][3] = { { topLeft, topRight, bottomRight }, { topLeft, bottomRight, bottomLeft } };
+			UINT plain[2][3] = { { topLeft, topRight, bottomLeft }, { topRight, bottomRight, bottomLeft } };
+			bool flip = random() % 2 == 0;
+			for (UINT t = 0; t < 2; t++)
+				triangles.push_back(std::vector<UINT>(flip ? flipped[t] : plain[t], (flip ? flipped[t] : plain[t]) + 3));
+		}
+	}
+
+	SoftwareRenderer renderer;
+	renderer.Resize(TargetWidth, TargetHeight, 0);
+	renderer.SetThreads(1);
+	SoftwareMaterial material = MakeMaterial(255);
+	std::vector<UINT> coverage(TargetWidth * TargetHeight, 0);
+	for (const std::vector<UINT>& triangle : triangles)
+	{
+		renderer.Begin(MakeFrame(0));
+		renderer.Draw(MakeDraw(vertices, triangle, material));
+		renderer.End();
+		for (UINT y = 0; y < TargetHeight; y++)
+		{
+			for (UINT x = 0; x < TargetWidth; x++)
+				coverage[y * TargetWidth + x] += GetAlpha(renderer.GetImage(), x, y) != ClearAlpha;
+		}
+	}
+
+	UINT wrong = 0;
+	for (UINT count : coverage)
+		wrong += count != 1;
+	CHECK_EQUAL(0u, wrong);
+
+	// Drawn together the same grid fills the screen
+	std::vector<UINT> indices;
+	for (const std::vector<UINT>& triangle : triangles)
+		indices.insert(indices.end(), triangle.begin(), triangle.end());
+	renderer.Begin(MakeFrame(0));
+	renderer.Draw(MakeDraw(vertices, indices, material));
+	renderer.End();
+	CHECK_EQUAL((UINT64)TargetWidth * TargetHeight, renderer.GetStats().pixelsShaded);
+}
+
+TEST(SoftwareRendererFollowsTopLeftRule)
+{
+	// Edges exactly through pixel centers: the left and top edges are in, the right and bottom ones out
+	// Pixel x's center is at clip x = (x + 0.5) / 32 - 1 on a 64 pixel wide target
+	std::vector<Vertex> vertices;
+	std::vector<UINT> indices;
+	float left = (8 + 0.5f) / 32.0f - 1.0f;
+	float right = (16 + 0.5f) / 32.0f - 1.0f;
+	float top = 1.0f - (4 + 0.5f) / 24.0f;
+	float bottom = 1.0f - (12 + 0.5f) / 24.0f;
+	AddQuad(left, bottom, right, top, 0.5f, vertices, indices);
+
+	SoftwareRenderer renderer;
+	renderer.Resize(TargetWidth, TargetHeight, 0);
+	SoftwareMaterial material = MakeMaterial(255);
+	renderer.Begin(MakeFrame(0));
+	renderer.Draw(MakeDraw(vertices, indices, material));
+	renderer.End();
+
+	const ImageData& image = renderer.GetImage();
+	for (UINT y = 0; y < TargetHeight; y++)
+	{
+		for (UINT x = 0; x < TargetWidth; x++)
+		{
+			bool inside = x >= 8 && x < 16 && y >= 4 && y < 12;
+			if ((GetAlpha(image, x, y) != ClearAlpha) != inside)
+			{
+				CHECK(!"pixel on the wrong side of the top-left rule");
+				return;
+			}
+		}
+	}
+	CHECK_EQUAL(64u, (UINT)renderer.GetStats().pixelsShaded);
+}
+
+TEST(SoftwareRendererDepthTestsLessEqual)
+{
+	std::vector<Vertex> nearQuad, farQuad, sameQuad;
+	std::vector<UINT> nearIndices, farIndices, sameIndices;
+	AddQuad(-1.0f, -1.0f, 0.5f, 1.0f, 0.25f, nearQuad, nearIndices);
+	AddQuad(-0.5f, -1.0f, 1.0f, 1.0f, 0.75f, farQuad, farIndices);
+	AddQuad(-1.0f, -1.0f, 1.0f, 1.0f, 0.25f, sameQuad, sameIndices);
+	SoftwareMaterial nearMaterial = MakeMaterial(100);
+	SoftwareMaterial farMaterial = MakeMaterial(200);
+	SoftwareMaterial sameMaterial = MakeMaterial(50);
+
+	SoftwareRenderer renderer;
+	renderer.Resize(TargetWidth, TargetHeight, 0);
+	for (int order = 0; order < 2; order++)
+	{
+		// Nearer wins whichever is drawn first
+		renderer.Begin(MakeFrame(0));
+		if (order == 0)
+		{
+			renderer.Draw(MakeDraw(nearQuad, nearIndices, nearMaterial));
+			renderer.Draw(MakeDraw(farQuad, farIndices, farMaterial));
+		}
+		else
+		{
+			renderer.Draw(MakeDraw(farQuad, farIndices, farMaterial));
+			renderer.Draw(MakeDraw(nearQuad, nearIndices, nearMaterial));
+		}
+		renderer.End();
+
+		const ImageData& image = renderer.GetImage();
+		CHECK_EQUAL(100, (int)GetAlpha(image, 2, 20));
+		CHECK_EQUAL(100, (int)GetAlpha(image, 32, 20));
+		CHECK_EQUAL(200, (int)GetAlpha(image, 60, 20));
+	}
+
+	// Equal depth passes, so the later draw wins
+	renderer.Begin(MakeFrame(0));
+	renderer.Draw(MakeDraw(nearQuad, nearIndices, nearMaterial));
+	renderer.Draw(MakeDraw(sameQuad, sameIndices, sameMaterial));
+	renderer.End();
+	CHECK_EQUAL(50, (int)GetAlpha(renderer.GetImage(), 2, 20));
+	CHECK_EQUAL(50, (int)GetAlpha(renderer.GetImage(), 60, 20));
+}
+
+TEST(SoftwareRendererCullsBackFaces)
+{
+	std::vector<Vertex> vertices;
+	std::vector<UINT> indices;
+	AddQuad(-0.5f, -0.5f, 0.5f, 0.5f, 0.5f, vertices, indices);
+	std::vector<UINT> reversed(indices.rbegin(), indices.rend());
+
+	// Degenerate, every corner on one line
+	std::vector<UINT> degenerate;
+	degenerate.push_back(0);
+	degenerate.push_back(0);
+	degenerate.push_back(1);
+
+	SoftwareRenderer renderer;
+	renderer.Resize(TargetWidth, TargetHeight, 0);
+	SoftwareMaterial material = MakeMaterial(255);
+	renderer.Begin(MakeFrame(0));
+	renderer.Draw(MakeDraw(vertices, reversed, material));
+	renderer.Draw(MakeDraw(vertices, degenerate, material));
+	renderer.End();
+	CHECK_EQUAL(2u, renderer.GetStats().draws);
+	CHECK_EQUAL(3u, (UINT)renderer.GetStats().triangles);
+	CHECK_EQUAL(0u, (UINT)renderer.GetStats().rasterizedTriangles);
+	CHECK_EQUAL(0u, (UINT)renderer.GetStats().pixelsShaded);
+	CHECK_EQUAL((int)ClearAlpha, (int)GetAlpha(renderer.GetImage(), 32, 24));
+
+	renderer.Begin(MakeFrame(0));
+	renderer.Draw(MakeDraw(vertices, indices, material));
+	renderer.End();
+	CHECK_EQUAL(2u, (UINT)renderer.GetStats().rasterizedTriangles);
+	CHECK_EQUAL(32u * 24u, (UINT)renderer.GetStats().pixelsShaded);
+}
+
+TEST(SoftwareRendererClipsToNearPlaneAndGuardBand)
+{
+	// Depth runs from -1 at the top to 1 at the bottom, only the half below the middle is in front of the near plane
+	std::vector<Vertex> vertices;
+	vertices.push_back(MakeVertex(-1.0f, 1.0f, -1.0f));
+	vertices.push_back(MakeVertex(1.0f, 1.0f, -1.0f));
+	vertices.push_back(MakeVertex(1.0f, -1.0f, 1.0f));
+	vertices.push_back(MakeVertex(-1.0f, -1.0f, 1.0f));
+	UINT quad[6] = { 0, 1, 2, 0, 2, 3 };
+	std::vector<UINT> indices(quad, quad + 6);
+
+	SoftwareRenderer renderer;
+	renderer.Resize(TargetWidth, TargetHeight, 0);
+	SoftwareMaterial material = MakeMaterial(255);
+	renderer.Begin(MakeFrame(0));
+	renderer.Draw(MakeDraw(vertices, indices, material));
+	renderer.End();
+	const ImageData& image = renderer.GetImage();
+	for (UINT y = 0; y < TargetHeight; y++)
+	{
+		bool drawn = y >= TargetHeight / 2;
+		CHECK_EQUAL(drawn, GetAlpha(image, 5, y) != ClearAlpha);
+		CHECK_EQUAL(drawn, GetAlpha(image, 60, y) != ClearAlpha);
+	}
+
+	// A triangle far past the guard band is clipped down to what covers the screen
+	std::vector<Vertex> huge;
+	huge.push_back(MakeVertex(-100.0f, 100.0f, 0.5f));
+	huge.push_back(MakeVertex(300.0f, 100.0f, 0.5f));
+	huge.push_back(MakeVertex(-100.0f, -300.0f, 0.5f));
+	std::vector<UINT> triangle;
+	for (UINT i = 0; i < 3; i++)
+		triangle.push_back(i);
+	renderer.Begin(MakeFrame(0));
+	renderer.Draw(MakeDraw(huge, triangle, material));
+	renderer.End();
+	CHECK_EQUAL((UINT64)TargetWidth * TargetHeight, renderer.GetStats().pixelsShaded);
+
+	// Entirely behind the near plane or past the far plane draws nothing
+	for (float z : { -0.5f, 1.5f })
+	{
+		std::vector<Vertex> hidden;
+		std::vector<UINT> hiddenIndices;
+		AddQuad(-1.0f, -1.0f, 1.0f, 1.0f, z, hidden, hiddenIndices);
+		renderer.Begin(MakeFrame(0));
+		renderer.Draw(MakeDraw(hidden, hiddenIndices, material));
+		renderer.End();
+		CHECK_EQUAL(0u, (UINT)renderer.GetStats().rasterizedTriangles);
+	}
+}
+
+TEST(SoftwareRendererIgnoresThreadCount)
+{
+	// Overlapping lit, textured and shadowed triangles across many tiles, at the same depth often enough that
+	// submission order decides pixels
+	std::mt19937 random(29);
+	std::vector<Vertex> vertices;
+	std::vector<UINT> indices;
+	for (UINT i = 0; i < 3000; i++)
+	{
+		float cx = (random() % 2000) / 1000.0f - 1.0f;
+		float cy = (random() % 2000) / 1000.0f - 1.0f;
+		float z = (random() % 4) / 4.0f + 0.1f;
+		float size = 0.02f + (random() % 100) / 400.0f;
+		UINT first = (UINT)vertices.size();
+		vertices.push_back(MakeVertex(cx - size, cy + size, z));
+		vertices.push_back(MakeVertex(cx + size, cy + size, z));
+		vertices.push_back(MakeVertex(cx, cy - size, z));
+		for (UINT k = 0; k < 3; k++)
+			indices.push_back(first + k);
+	}
+
+	ImageData checker;
+	checker.width = 8;
+	checker.height = 8;
+	for (UINT i = 0; i < 64; i++)
+	{
+		BYTE value = ((i % 8) / 2 + (i / 16)) % 2 ? 255 : 40;
+		BYTE texel[4] = { value, (BYTE)(255 - value), 128, 255 };
+		checker.rgba.insert(checker.rgba.end(), texel, texel + 4);
+	}
+	SoftwareTexture texture;
+	ImageConvert::GenerateMips(checker, MipColor, MipBox, texture.mips);
+
+	SoftwareMaterial materials[2] = { MakeMaterial(255), MakeMaterial(128) };
+	materials[0].diffuse = &texture;
+	materials[1].diffuse = &texture;
+	materials[1].tileX = 4.0f;
+
+	SoftwareFrameData frame = MakeFrame(FeatureAll & ~FeatureNormalMap);
+	frame.pLight.diffuse = XMFLOAT4(1.0f, 0.8f, 0.6f, 1.0f);
+	frame.pLight.position = XMFLOAT3(0.0f, 0.0f, -2.0f);
+	frame.pLight.range = 10.0f;
+	frame.pLight.attenuation = XMFLOAT3(1.0f, 0.0f, 0.0f);
+	frame.eyePos = XMFLOAT3(0.0f, 0.0f, -1.0f);
+	frame.fogStart = 1.0f;
+	frame.fogRange = 2.0f;
+	frame.fogColor = XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f);
+
+	std::vector<BYTE> reference;
+	for (UINT threads : { 1u, 2u, 3u, 8u })
+	{
+		SoftwareRenderer renderer;
+		renderer.Resize(200, 150, 128);
+		renderer.SetThreads(threads);
+		renderer.Begin(frame);
+		UINT half = (UINT)indices.size() / 2;
+		std::vector<UINT> first(indices.begin(), indices.begin() + half);
+		std::vector<UINT> second(indices.begin() + half, indices.end());
+		renderer.Draw(MakeDraw(vertices, first, materials[0]));
+		renderer.Draw(MakeDraw(vertices, second, materials[1]));
+		renderer.End();
+
+		if (reference.empty())
+		{
+			reference = renderer.GetImage().rgba;
+			CHECK(renderer.GetStats().pixelsShaded > 0);
+		}
+		else
+			CHECK(renderer.GetImage().rgba == reference);
+	}
+
+	// The written frame decodes back to the same pixels
+	ImageData image;
+	image.width = 200;
+	image.height = 150;
+	image.rgba = reference;
+	std::vector<BYTE> png;
+	PNGEncoder::Encode(image, png);
+	PNGDecoder decoder;
+	ImageData decoded;
+	REQUIRE(decoder.Decode(&png[0], png.size(), decoded));
+	CHECK(decoded.rgba == reference);
+}
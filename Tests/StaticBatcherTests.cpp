@@ -0,0 +1,240 @@
+//
+// Static batching checked on quads with known transforms: merged vertices land where the instances' worlds put them,
+// every level holds every instance with its indices offset and mirrored instances rewound, and clusters never mix
+// materials or pass their size, vertex and memory limits
+//
+
+#include "Test.h"
+#include "StaticBatcher.h"
+
+#include <random>
+#include <set>
+
+/// <summary>A unit quad in the XY plane facing +Z, its second level of detail is its first triangle
+/// </summary>
+static void CreateQuad(MeshData& mesh)
+{
+	const float corners[4][2] = { { -0.5f, -0.5f }, { 0.5f, -0.5f }, { 0.5f, 0.5f }, { -0.5f, 0.5f } };
+	for (UINT i = 0; i < 4; i++)
+	{
+		Vertex vertex(XMFLOAT3(corners[i][0], corners[i][1], 0.0f), XMFLOAT2(corners[i][0] + 0.5f, corners[i][1] + 0.5f));
+		vertex.Color = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+		vertex.Normal = XMFLOAT3(0.0f, 0.0f, 1.0f);
+		vertex.Tangent = XMFLOAT3(1.0f, 0.0f, 0.0f);
+		mesh.vertices.push_back(vertex);
+	}
+	const UINT indices[] = { 0, 1, 2, 0, 2, 3, 0, 1, 2 };
+	mesh.indices.assign(indices, indices + 9);
+	MeshLOD full = { 0, 6, 0.0f };
+	MeshLOD coarse = { 6, 3, 0.1f };
+	mesh.lods.push_back(full);
+	mesh.lods.push_back(coarse);
+}
+
+static StaticInstance MakeInstance(const MeshData* mesh, CXMMATRIX world, UINT material)
+{
+	StaticInstance instance;
+	instance.mesh = mesh;
+	XMStoreFloat4x4(&instance.world, world);
+	instance.material = material;
+	return instance;
+}
+
+/// <summary>Sign of the triangle's facing along its first vertex's normal
+/// </summary>
+static float GetFacing(const std::vector<Vertex>& vertices, const UINT* triangle)
+{
+	XMVECTOR a = XMLoadFloat3(&vertices[triangle[0]].Position);
+	XMVECTOR b = XMLoadFloat3(&vertices[triangle[1]].Position);
+	XMVECTOR c = XMLoadFloat3(&vertices[triangle[2]].Position);
+	return XMVectorGetX(XMVector3Dot(XMVector3Cross(b - a, c - a), XMLoadFloat3(&vertices[triangle[0]].Normal)));
+}
+
+TEST(StaticBatcherMergesInstancesIntoWorldSpace)
+{
+	MeshData quad;
+	CreateQuad(quad);
+
+	// Four instances close together, one mirrored and one scaled, and one on its own in another material
+	std::vector<StaticInstance> instances;
+	instances.push_back(MakeInstance(&quad, XMMatrixTranslation(0.0f, 0.0f, 0.0f), 0));
+	instances.push_back(MakeInstance(&quad, XMMatrixTranslation(2.0f, 0.0f, 0.0f), 0));
+	instances.push_back(MakeInstance(&quad, XMMatrixScaling(-1.0f, 1.0f, 1.0f) * XMMatrixTranslation(4.0f, 0.0f, 0.0f), 0));
+	instances.push_back(MakeInstance(&quad, XMMatrixRotationY(XM_PIDIV2) * XMMatrixScaling(2.0f, 2.0f, 2.0f) *
+		XMMatrixTranslation(8.0f, 1.0f, 0.0f), 0));
+	instances.push_back(MakeInstance(&quad, XMMatrixTranslation(0.0f, 0.0f, 0.0f), 1));
+
+	StaticBatcher batcher;
+	std::vector<StaticBatch> batches;
+	batcher.Build(instances, batches);
+	REQUIRE(batches.size() == 1);
+	const StaticBatch& batch = batches[0];
+	CHECK_EQUAL(0u, batch.material);
+	REQUIRE(batch.instances.size() == 4);
+
+	const StaticBatchStats& stats = batcher.GetStats();
+	CHECK_EQUAL(5u, stats.instances);
+	CHECK_EQUAL(4u, stats.batched);
+	CHECK_EQUAL(1u, stats.batches);
+	CHECK_EQUAL(5u, stats.drawsBefore);
+	CHECK_EQUAL(2u, stats.drawsAfter);
+	CHECK_EQUAL((UINT64)(16 * sizeof(Vertex) + 36 * sizeof(UINT)), stats.bytes);
+
+	// Each instance's vertices in order, moved by its world, with normals still unit length and perpendicular
+	const std::vector<Vertex>& vertices = batch.data.vertices;
+	REQUIRE(vertices.size() == 16);
+	bool placed = true, normals = true;
+	for (UINT i = 0; i < 4; i++)
+	{
+		XMMATRIX world = XMLoadFloat4x4(&instances[batch.instances[i]].world);
+		for (UINT j = 0; j < 4; j++)
+		{
+			const Vertex& vertex = vertices[i * 4 + j];
+			XMVECTOR expected = XMVector3TransformCoord(XMLoadFloat3(&quad.vertices[j].Position), world);
+			placed &= XMVectorGetX(XMVector3Length(XMLoadFloat3(&vertex.Position) - expected)) < 1e-5f;
+			XMVECTOR normal = XMLoadFloat3(&vertex.Normal);
+			XMVECTOR tangent = XMLoadFloat3(&vertex.Tangent);
+			normals &= fabsf(XMVectorGetX(XMVector3Length(normal)) - 1.0f) < 1e-5f;
+			normals &= fabsf(XMVectorGetX(XMVector3Dot(normal, tangent))) < 1e-5f;
+		}
+	}
+	CHECK(placed);
+	CHECK(normals);
+
+	// Every level holds every instance at that level, offset to its vertices and facing the way its normals do
+	REQUIRE(batch.data.lods.size() == 2);
+	const MeshLOD& full = batch.data.lods[0];
+	const MeshLOD& coarse = batch.data.lods[1];
+	CHECK_EQUAL(0u, full.indexStart);
+	CHECK_EQUAL(24u, full.indexCount);
+	CHECK_EQUAL(24u, coarse.indexStart);
+	CHECK_EQUAL(12u, coarse.indexCount);
+	CHECK_EQUAL((size_t)36, batch.data.indices.size());
+	CHECK_NEAR(0.0f, full.error, 1e-6f);
+	CHECK_NEAR(0.2f, coarse.error, 1e-5f);
+	bool offset = true, facing = true;
+	for (UINT t = 0; t < 12; t++)
+	{
+		const UINT* triangle = &batch.data.indices[t * 3];
+		UINT owner = t < 8 ? t / 2 : t - 8;
+		for (UINT k = 0; k < 3; k++)
+			offset &= triangle[k] / 4 == owner;
+		facing &= GetFacing(vertices, triangle) > 0.0f;
+	}
+	CHECK(offset);
+	CHECK(facing);
+
+	// The batch's bounds hold every vertex
+	bool inside = true;
+	for (const Vertex& vertex : vertices)
+	{
+		XMFLOAT3 beyond;
+		XMStoreFloat3(&beyond, XMVectorAbs(XMLoadFloat3(&vertex.Position) - XMLoadFloat3(&batch.bounds.center)) -
+			XMLoadFloat3(&batch.bounds.extents));
+		inside &= max(beyond.x, max(beyond.y, beyond.z)) < 1e-5f;
+	}
+	CHECK(inside);
+}
+
+TEST(StaticBatcherClustersWithinLimits)
+{
+	MeshData quad;
+	CreateQuad(quad);
+
+	// Quads scattered over 200 units in three materials
+	std::mt19937 random(9);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::vector<StaticInstance> instances;
+	for (UINT i = 0; i < 600; i++)
+	{
+		instances.push_back(MakeInstance(&quad, XMMatrixTranslation(position(random), position(random) * 0.1f, position(random)),
+			i % 3));
+	}
+
+	StaticBatcher batcher;
+	batcher.ParseCommandLine("staticbatchsize=20 staticbatchvertices=64");
+	std::vector<StaticBatch> batches;
+	batcher.Build(instances, batches);
+	REQUIRE(!batches.empty());
+
+	std::set<UINT> seen;
+	bool once = true, material = true, pairs = true, small = true, few = true;
+	UINT batched = 0;
+	for (const StaticBatch& batch : batches)
+	{
+		pairs &= batch.instances.size() >= 2;
+		few &= batch.data.vertices.size() <= 64;
+		XMFLOAT3 size(batch.bounds.extents.x * 2.0f, batch.bounds.extents.y * 2.0f, batch.bounds.extents.z * 2.0f);
+		small &= max(size.x, max(size.y, size.z)) <= 20.0f + 1e-4f;
+		for (UINT instance : batch.instances)
+		{
+			once &= seen.insert(instance).second;
+			material &= instances[instance].material == batch.material;
+		}
+		batched += (UINT)batch.instances.size();
+	}
+	CHECK(once);
+	CHECK(material);
+	CHECK(pairs);
+	CHECK(small);
+	CHECK(few);
+
+	const StaticBatchStats& stats = batcher.GetStats();
+	CHECK_EQUAL(batched, stats.batched);
+	CHECK_EQUAL((UINT)batches.size(), stats.batches);
+	CHECK_EQUAL(stats.instances - stats.batched + stats.batches, stats.drawsAfter);
+	CHECK(stats.drawsAfter < stats.drawsBefore / 2);
+
+	// Larger clusters take fewer draws
+	StaticBatcher coarse;
+	coarse.ParseCommandLine("staticbatchsize=80");
+	coarse.Build(instances, batches);
+	CHECK(coarse.GetStats().drawsAfter < stats.drawsAfter);
+}
+
+TEST(StaticBatcherLeavesOutWhatItCantMerge)
+{
+	MeshData quad, empty, large;
+	CreateQuad(quad);
+	for (UINT i = 0; i < 40; i++)
+		large.vertices.insert(large.vertices.end(), quad.vertices.begin(), quad.vertices.end());
+	large.indices = quad.indices;
+
+	// Meshes over half a cluster's vertices, empty meshes and missing meshes are all drawn on their own
+	std::vector<StaticInstance> instances;
+	for (UINT i = 0; i < 4; i++)
+	{
+		instances.push_back(MakeInstance(&large, XMMatrixTranslation((float)i, 0.0f, 0.0f), 0));
+		instances.push_back(MakeInstance(&empty, XMMatrixTranslation((float)i, 0.0f, 0.0f), 0));
+		instances.push_back(MakeInstance(NULL, XMMatrixTranslation((float)i, 0.0f, 0.0f), 0));
+	}
+	StaticBatcher batcher;
+	batcher.ParseCommandLine("staticbatchvertices=256");
+	std::vector<StaticBatch> batches;
+	batcher.Build(instances, batches);
+	CHECK(batches.empty());
+	CHECK_EQUAL(12u, batcher.GetStats().drawsAfter);
+
+	// Batches past the memory budget are dropped, what is kept stays under it
+	instances.clear();
+	for (UINT i = 0; i < 2000; i++)
+		instances.push_back(MakeInstance(&quad, XMMatrixTranslation((float)(i % 200), 0.0f, (float)(i / 200) * 30.0f), 0));
+	StaticBatcher budgeted;
+	budgeted.ParseCommandLine("staticbatchmb=0.05");
+	budgeted.Build(instances, batches);
+	CHECK(!batches.empty());
+	CHECK(budgeted.GetStats().bytes <= (UINT64)(0.05 * 1024 * 1024));
+
+	StaticBatcher unlimited;
+	unlimited.Build(instances, batches);
+	CHECK(unlimited.GetStats().bytes > (UINT64)(0.05 * 1024 * 1024));
+	CHECK(budgeted.GetStats().batched < unlimited.GetStats().batched);
+
+	// Turned off, nothing is merged
+	StaticBatcher off;
+	off.ParseCommandLine("staticbatch=0");
+	CHECK(!off.IsEnabled());
+	off.Build(instances, batches);
+	CHECK(batches.empty());
+	CHECK_EQUAL(2000u, off.GetStats().drawsAfter);
+}
@@ -0,0 +1,329 @@
+//
+// Terrain chunks drawn at their selected levels on a known height tile: every index range covers its chunk exactly, the
+// edges two neighbors draw along their shared side are the same segments at the same heights, whatever their levels and
+// wherever the eye is, and a chunk fully morphed towards the next level is the surface that level draws
+//
+
+#include "Test.h"
+#include "TerrainLOD.h"
+
+#include <algorithm>
+#include <cmath>
+
+// One tile of chunks, as tall as the terrain's default height scale
+static const float HeightRange = 40.0f;
+
+// Planes every box is inside of
+static const XMFLOAT4 OpenPlanes[6] =
+{
+	XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f), XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f), XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f),
+	XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f), XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f), XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f)
+};
+
+/// <summary>Rolling hills with a little hashed roughness, so no two neighboring samples line up
+/// </summary>
+static void CreateHeights(std::vector<float>& heights)
+{
+	heights.resize(TerrainTileSamples * TerrainTileSamples);
+	for (UINT z = 0; z < TerrainTileSamples; z++)
+	{
+		for (UINT x = 0; x < TerrainTileSamples; x++)
+		{
+			UINT hash = (x * 73856093u) ^ (z * 19349663u);
+			hash = (hash ^ (hash >> 13)) * 0x5bd1e995u;
+			float rough = (float)(hash >> 8 & 0xffff) / 65535.0f;
+			heights[z * TerrainTileSamples + x] = 18.0f + 15.0f * sinf(x * 0.05f) * cosf(z * 0.07f) + 4.0f * rough;
+		}
+	}
+}
+
+static void Configure(TerrainSelector& selector, const std::vector<float>& heights)
+{
+	selector.Configure(TerrainTileChunks, TerrainTileChunks, 1.0f, 10.0f, HeightRange);
+	for (UINT z = 0; z < TerrainTileChunks; z++)
+	{
+		for (UINT x = 0; x < TerrainTileChunks; x++)
+		{
+			float low = HeightRange, high = 0.0f;
+			for (UINT j = 0; j <= TerrainChunkVertices + 1; j++)
+			{
+				for (UINT i = 0; i <= TerrainChunkVertices + 1; i++)
+				{
+					float h = heights[(z * TerrainChunkCells + j) * TerrainTileSamples + x * TerrainChunkCells + i];
+					low = min(low, h);
+					high = max(high, h);
+				}
+			}
+			selector.SetChunkHeights(x, z, low, high);
+		}
+	}
+}
+
+static int Area(UINT a, UINT b, UINT c)
+{
+	int ax = a % TerrainChunkVertices, az = a / TerrainChunkVertices;
+	int bx = b % TerrainChunkVertices, bz = b / TerrainChunkVertices;
+	int cx = c % TerrainChunkVertices, cz = c / TerrainChunkVertices;
+	return (bz - az) * (cx - ax) - (bx - ax) * (cz - az);
+}
+
+struct EdgeSegment
+{
+	float x0, y0, z0;
+	float x1, y1, z1;
+
+	bool operator<(const EdgeSegment& other) const
+	{
+		if (x0 != other.x0) return x0 < other.x0;
+		if (z0 != other.z0) return z0 < other.z0;
+		if (x1 != other.x1) return x1 < other.x1;
+		return z1 < other.z1;
+	}
+};
+
+/// <summary>Triangle edges of a drawn chunk lying on one side, ordered so both neighbors list them the same way
+/// </summary>
+static void GetSideSegments(const std::vector<UINT>& indices, const MeshLOD& range, const std::vector<Vertex>& vertices,
+	UINT side, std::vector<EdgeSegment>& segments)
+{
+	auto onSide = [&](UINT v)
+	{
+		UINT i = v % TerrainChunkVertices, j = v / TerrainChunkVertices;
+		return side == TerrainSideLeft ? i == 0 : side == TerrainSideRight ? i == TerrainChunkCells :
+			side == TerrainSideNear ? j == 0 : j == TerrainChunkCells;
+	};
+
+	segments.clear();
+	for (UINT t = range.indexStart; t < range.indexStart + range.indexCount; t += 3)
+	{
+		for (UINT k = 0; k < 3; k++)
+		{
+			UINT a = indices[t + k], b = indices[t + (k + 1) % 3];
+			if (!onSide(a) || !onSide(b))
+				continue;
+			if (b < a)
+				std::swap(a, b);
+			const XMFLOAT3& p = vertices[a].Position;
+			const XMFLOAT3& q = vertices[b].Position;
+			EdgeSegment segment = { p.x, p.y, p.z, q.x, q.y, q.z };
+			segments.push_back(segment);
+		}
+	}
+	std::sort(segments.begin(), segments.end());
+}
+
+TEST(TerrainIndexRangesCoverTheChunk)
+{
+	std::vector<UINT> indices;
+	std::vector<MeshLOD> ranges;
+	TerrainSelector::BuildIndices(indices, ranges);
+	CHECK_EQUAL((size_t)(TerrainLevels * TerrainSideCount), ranges.size());
+
+	for (UINT level = 0; level < TerrainLevels; level++)
+	{
+		UINT step = 1u << level;
+		for (UINT stitch = 0; stitch < TerrainSideCount; stitch++)
+		{
+			// Every triangle faces up, and together they cover the chunk once
+			const MeshLOD& range = ranges[level * TerrainSideCount + stitch];
+			int area = 0;
+			bool facesUp = true;
+			bool onGrid = true;
+			for (UINT t = range.indexStart; t < range.indexStart + range.indexCount; t += 3)
+			{
+				int triangle = Area(indices[t], indices[t + 1], indices[t + 2]);
+				facesUp &= triangle > 0;
+				area += triangle;
+				for (UINT k = 0; k < 3; k++)
+				{
+					UINT i = indices[t + k] % TerrainChunkVertices, j = indices[t + k] / TerrainChunkVertices;
+					onGrid &= i % step == 0 && j % step == 0;
+
+					// Stitched sides only keep the coarser level's vertices, the last level has none to drop
+					UINT coarse = level + 1 < TerrainLevels ? step * 2 : step;
+					if (((stitch & TerrainSideLeft) && i == 0) || ((stitch & TerrainSideRight) && i == TerrainChunkCells))
+						onGrid &= j % coarse == 0;
+					if (((stitch & TerrainSideNear) && j == 0) || ((stitch & TerrainSideFar) && j == TerrainChunkCells))
+						onGrid &= i % coarse == 0;
+				}
+			}
+			CHECK(facesUp);
+			CHECK(onGrid);
+			CHECK_EQUAL((int)(2 * TerrainChunkCells * TerrainChunkCells), area);
+		}
+	}
+
+	// Unstitched levels are plain grids, two triangles a quad
+	for (UINT level = 0; level < TerrainLevels; level++)
+	{
+		UINT quads = TerrainChunkCells >> level;
+		CHECK_EQUAL(quads * quads * 6, ranges[level * TerrainSideCount].indexCount);
+	}
+}
+
+TEST(TerrainLevelsGrowAndMorphContinuously)
+{
+	TerrainSelector selector;
+	selector.Configure(4, 4, 1.0f, 10.0f, HeightRange);
+
+	// The first range was raised so a chunk's diagonal fits inside the gap before the next level morphs
+	float diagonal = sqrtf(2.0f * TerrainChunkCells * TerrainChunkCells + HeightRange * HeightRange);
+	CHECK(selector.GetRange(0) * 0.7f > diagonal);
+	for (UINT level = 1; level < TerrainLevels; level++)
+		CHECK_NEAR(selector.GetRange(level - 1) * 2.0f, selector.GetRange(level), 1e-3f);
+
+	for (UINT level = 0; level < TerrainLevels; level++)
+	{
+		float start = level == 0 ? 0.0f : selector.GetRange(level - 1);
+		CHECK_EQUAL(level, selector.GetLevel(start + 0.01f));
+
+		// Just before a switch the level is fully morphed, just after it the next one hasn't started
+		if (level + 1 < TerrainLevels)
+		{
+			float range = selector.GetRange(level);
+			CHECK_NEAR(1.0f, selector.GetMorph(level, range - 1e-3f), 1e-3f);
+			CHECK_EQUAL(0.0f, selector.GetMorph(level + 1, range));
+			CHECK_EQUAL(0.0f, selector.GetMorph(level, start));
+		}
+	}
+	CHECK_EQUAL(0.0f, selector.GetMorph(TerrainLevels - 1, 1e9f));
+	CHECK_EQUAL(TerrainLevels - 1, selector.GetLevel(1e9f));
+}
+
+TEST(TerrainSharedEdgesHaveNoCracks)
+{
+	std::vector<float> heights;
+	CreateHeights(heights);
+	TerrainSelector selector;
+	Configure(selector, heights);
+	std::vector<UINT> indices;
+	std::vector<MeshLOD> ranges;
+	TerrainSelector::BuildIndices(indices, ranges);
+
+	// Eyes over the middle, the corners and outside the tile, low and high, so every level meets its neighbors
+	const XMFLOAT3 eyes[] =
+	{
+		XMFLOAT3(0.0f, 30.0f, 0.0f), XMFLOAT3(-120.0f, 25.0f, -120.0f), XMFLOAT3(100.0f, 60.0f, -37.5f),
+		XMFLOAT3(13.3f, 21.0f, 91.7f), XMFLOAT3(-400.0f, 40.0f, 10.0f), XMFLOAT3(55.5f, 300.0f, 55.5f)
+	};
+
+	UINT pairs = 0, stitchedPairs = 0, segmentCount = 0;
+	std::vector<UINT> levelsSeen(TerrainLevels, 0);
+	for (const XMFLOAT3& eye : eyes)
+	{
+		std::vector<TerrainChunk> chunks;
+		selector.Select(eye, 1e6f, OpenPlanes, OpenPlanes, chunks);
+		CHECK_EQUAL((size_t)(TerrainTileChunks * TerrainTileChunks), chunks.size());
+
+		std::vector<std::vector<Vertex>> vertices(chunks.size(), std::vector<Vertex>(TerrainChunkVertices * TerrainChunkVertices));
+		for (size_t c = 0; c < chunks.size(); c++)
+		{
+			const TerrainChunk& chunk = chunks[c];
+			selector.WriteVertices(&heights[0], chunk.x, chunk.z, selector.GetChunkOrigin(chunk.x, chunk.z), chunk.level, eye,
+				&vertices[c][0]);
+			levelsSeen[chunk.level]++;
+		}
+
+		// Chunks come row by row, the right and alongZ neighbors are one and one row along
+		for (size_t c = 0; c < chunks.size(); c++)
+		{
+			const TerrainChunk& chunk = chunks[c];
+			for (UINT alongZ = 0; alongZ < 2; alongZ++)
+			{
+				if (alongZ ? chunk.z + 1 == TerrainTileChunks : chunk.x + 1 == TerrainTileChunks)
+					continue;
+				size_t n = c + (alongZ ? TerrainTileChunks : 1);
+				const TerrainChunk& neighbor = chunks[n];
+				CHECK(neighbor.level <= chunk.level + 1 && chunk.level <= neighbor.level + 1);
+
+				// Whichever side is finer stitches towards the coarser one
+				UINT side = alongZ ? TerrainSideFar : TerrainSideRight;
+				UINT opposite = alongZ ? TerrainSideNear : TerrainSideLeft;
+				CHECK_EQUAL(neighbor.level > chunk.level, (chunk.stitch & side) != 0);
+				CHECK_EQUAL(chunk.level > neighbor.level, (neighbor.stitch & opposite) != 0);
+
+				std::vector<EdgeSegment> mine, theirs;
+				GetSideSegments(indices, ranges[chunk.level * TerrainSideCount + chunk.stitch], vertices[c], side, mine);
+				GetSideSegments(indices, ranges[neighbor.level * TerrainSideCount + neighbor.stitch], vertices[n], opposite,
+					theirs);
+				REQUIRE(mine.size() == theirs.size());
+				for (size_t s = 0; s < mine.size(); s++)
+				{
+					CHECK_EQUAL(mine[s].x0, theirs[s].x0);
+					CHECK_EQUAL(mine[s].z0, theirs[s].z0);
+					CHECK_EQUAL(mine[s].x1, theirs[s].x1);
+					CHECK_EQUAL(mine[s].z1, theirs[s].z1);
+					CHECK_NEAR(mine[s].y0, theirs[s].y0, 1e-4f);
+					CHECK_NEAR(mine[s].y1, theirs[s].y1, 1e-4f);
+				}
+				pairs++;
+				stitchedPairs += chunk.level != neighbor.level;
+				segmentCount += (UINT)mine.size();
+			}
+		}
+	}
+
+	// The eyes did put chunks at different levels next to each other
+	CHECK(stitchedPairs > 20);
+	CHECK(pairs == 6 * 2 * TerrainTileChunks * (TerrainTileChunks - 1));
+	for (UINT level = 0; level < 4; level++)
+		CHECK(levelsSeen[level] > 0);
+	CHECK(segmentCount > 0);
+}
+
+TEST(TerrainFullyMorphedLevelIsTheNextLevel)
+{
+	std::vector<float> heights;
+	CreateHeights(heights);
+	TerrainSelector selector;
+	Configure(selector, heights);
+	std::vector<UINT> indices;
+	std::vector<MeshLOD> ranges;
+	TerrainSelector::BuildIndices(indices, ranges);
+
+	const UINT chunkX = 3, chunkZ = 5;
+	XMFLOAT2 origin = selector.GetChunkOrigin(chunkX, chunkZ);
+	for (UINT level = 0; level + 2 < TerrainLevels; level++)
+	{
+		// The eye sits level's range off the chunk's -x side, every vertex is past the end of the level and none has
+		// reached the next level's morph band
+		float range = selector.GetRange(level);
+		XMFLOAT3 eye(origin.x - range - 0.01f, HeightRange * 0.5f, origin.y + TerrainChunkCells * 0.5f);
+
+		std::vector<Vertex> fine(TerrainChunkVertices * TerrainChunkVertices);
+		std::vector<Vertex> coarse(TerrainChunkVertices * TerrainChunkVertices);
+		selector.WriteVertices(&heights[0], chunkX, chunkZ, origin, level, eye, &fine[0]);
+		selector.WriteVertices(&heights[0], chunkX, chunkZ, origin, level + 1, eye, &coarse[0]);
+
+		// Each of the finer level's vertices lies on the coarser level's triangles
+		UINT step = 1u << level;
+		const MeshLOD& coarseRange = ranges[(level + 1) * TerrainSideCount];
+		float largest = 0.0f;
+		UINT found = 0;
+		for (UINT j = 0; j < TerrainChunkVertices; j += step)
+		{
+			for (UINT i = 0; i < TerrainChunkVertices; i += step)
+			{
+				const XMFLOAT3& p = fine[j * TerrainChunkVertices + i].Position;
+				for (UINT t = coarseRange.indexStart; t < coarseRange.indexStart + coarseRange.indexCount; t += 3)
+				{
+					const XMFLOAT3& a = coarse[indices[t]].Position;
+					const XMFLOAT3& b = coarse[indices[t + 1]].Position;
+					const XMFLOAT3& c = coarse[indices[t + 2]].Position;
+					float d = (b.z - c.z) * (a.x - c.x) + (c.x - b.x) * (a.z - c.z);
+					float wa = ((b.z - c.z) * (p.x - c.x) + (c.x - b.x) * (p.z - c.z)) / d;
+					float wb = ((c.z - a.z) * (p.x - c.x) + (a.x - c.x) * (p.z - c.z)) / d;
+					float wc = 1.0f - wa - wb;
+					if (wa < -1e-5f || wb < -1e-5f || wc < -1e-5f)
+						continue;
+					largest = max(largest, fabsf(wa * a.y + wb * b.y + wc * c.y - p.y));
+					found++;
+					break;
+				}
+			}
+		}
+		UINT vertices = TerrainChunkCells / step + 1;
+		CHECK_EQUAL(vertices * vertices, found);
+		CHECK(largest < 1e-4f);
+	}
+}
@@ -0,0 +1,80 @@
+//
+// Minimal test registry for the Linux build
+// TEST registers a case before main runs. CHECK records a failure and carries on, REQUIRE also leaves the test
+//
+
+#ifndef TEST_H
+#define TEST_H
+
+#include <Windows.h>
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <vector>
+
+typedef void (*TestFunction)();
+
+class TestRegistry
+{
+public:
+	static TestRegistry& Get();
+
+	void Add(const char* name, TestFunction function);
+
+	/// <summary>Marks the running test failed and prints where
+	/// </summary>
+	void Fail(const char* file, int line, const std::string& message);
+
+	/// <summary>Runs every test whose name contains filter, all of them if it's NULL. Returns the number that failed
+	/// </summary>
+	int Run(const char* filter);
+private:
+	struct Case
+	{
+		const char* name;
+		TestFunction function;
+	};
+
+	std::vector<Case> cases;
+	bool failed;
+};
+
+struct TestRegistration
+{
+	TestRegistration(const char* name, TestFunction function) { TestRegistry::Get().Add(name, function); }
+};
+
+#define TEST(name) \
+	static void name(); \
+	static TestRegistration name##Registration(#name, name); \
+	static void name()
+
+#define CHECK(condition) \
+	do { if (!(condition)) TestRegistry::Get().Fail(__FILE__, __LINE__, #condition); } while (0)
+
+#define REQUIRE(condition) \
+	do { if (!(condition)) { TestRegistry::Get().Fail(__FILE__, __LINE__, #condition); return; } } while (0)
+
+#define CHECK_EQUAL(expected, actual) \
+	do \
+	{ \
+		if (!((expected) == (actual))) \
+		{ \
+			std::ostringstream message; \
+			message << #actual << " is " << (actual) << ", expected " << (expected); \
+			TestRegistry::Get().Fail(__FILE__, __LINE__, message.str()); \
+		} \
+	} while (0)
+
+#define CHECK_NEAR(expected, actual, tolerance) \
+	do \
+	{ \
+		if (!(std::fabs((double)(expected) - (double)(actual)) <= (double)(tolerance))) \
+		{ \
+			std::ostringstream message; \
+			message << #actual << " is " << (actual) << ", expected " << (expected) << " within " << (tolerance); \
+			TestRegistry::Get().Fail(__FILE__, __LINE__, message.str()); \
+		} \
+	} while (0)
+
+#endif
@@ -0,0 +1,50 @@
+//
+// Runs the registered tests, all of them or those whose name contains the first argument
+//
+
+#include "Test.h"
+
+TestRegistry& TestRegistry::Get()
+{
+	static TestRegistry registry;
+	return registry;
+}
+
+void TestRegistry::Add(const char* name, TestFunction function)
+{
+	Case test = { name, function };
+	cases.push_back(test);
+}
+
+void TestRegistry::Fail(const char* file, int line, const std::string& message)
+{
+	failed = true;
+	fprintf(stderr, "  %s:%d: %s\n", file, line, message.c_str());
+}
+
+int TestRegistry::Run(const char* filter)
+{
+	int failures = 0;
+	int run = 0;
+	for (const Case& test : cases)
+	{
+		if (filter && !strstr(test.name, filter))
+			continue;
+
+		failed = false;
+		test.function();
+		run++;
+		if (failed)
+		{
+			failures++;
+			fprintf(stderr, "FAIL %s\n", test.name);
+		}
+	}
+	printf("%d of %d tests passed\n", run - failures, run);
+	return failures;
+}
+
+int main(int argc, char** argv)
+{
+	return TestRegistry::Get().Run(argc > 1 ? argv[1] : NULL) == 0 ? 0 : 1;
+}
@@ -0,0 +1,117 @@
+//
+// Meshes with known surfaces shared by the tests and the benchmarks: a latitude and longitude sphere and a flat or wavy
+// grid, both wound clockwise seen from the front like the renderer's meshes, and the grid cooked like a level mesh
+//
+
+#ifndef TESTMESHES_H
+#define TESTMESHES_H
+
+#include <cmath>
+#include <vector>
+
+#include "MeshData.h"
+
+/// <summary>White vertex with the given attributes
+/// </summary>
+inline Vertex MakeVertex(const XMFLOAT3& position, const XMFLOAT2& uv, const XMFLOAT3& normal, const XMFLOAT3& tangent)
+{
+	Vertex vertex(position, uv);
+	vertex.Color = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+	vertex.Normal = normal;
+	vertex.Tangent = tangent;
+	return vertex;
+}
+
+/// <summary>Latitude and longitude sphere around the origin facing outwards, 4 * rings * (rings - 1) triangles
+/// The seam column and the poles repeat their positions exactly so only their UVs split them, and the poles have no
+/// degenerate triangles
+/// </summary>
+inline void CreateSphere(float radius, UINT rings, MeshData& mesh)
+{
+	UINT segments = rings * 2;
+	UINT first = (UINT)mesh.vertices.size();
+	for (UINT i = 0; i <= rings; i++)
+	{
+		float phi = XM_PI * i / rings;
+		for (UINT j = 0; j <= segments; j++)
+		{
+			float theta = XM_2PI * (j % segments) / segments;
+			XMFLOAT3 normal(sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta));
+			if (i == 0 || i == rings)
+				normal = XMFLOAT3(0.0f, i == 0 ? 1.0f : -1.0f, 0.0f);
+			mesh.vertices.push_back(MakeVertex(XMFLOAT3(normal.x * radius, normal.y * radius, normal.z * radius),
+				XMFLOAT2((float)j / segments, (float)i / rings), normal, XMFLOAT3(-sinf(theta), 0.0f, cosf(theta))));
+		}
+	}
+
+	for (UINT i = 0; i < rings; i++)
+	{
+		for (UINT j = 0; j < segments; j++)
+		{
+			UINT a = first + i * (segments + 1) + j;
+			UINT b = a + segments + 1;
+			if (i > 0)
+			{
+				UINT top[3] = { a, a + 1, b + 1 };
+				mesh.indices.insert(mesh.indices.end(), top, top + 3);
+			}
+			if (i + 1 < rings)
+			{
+				UINT bottom[3] = { a, b + 1, b };
+				mesh.indices.insert(mesh.indices.end(), bottom, bottom + 3);
+			}
+		}
+	}
+}
+
+/// <summary>cells x cells quads across size on the xz plane from the origin, facing up, UVs 0 to 1 across it
+/// A wave height above 0 bends it into hills that high, normals following. With levels above 0 the grid gets that many
+/// levels of detail, each using every other row and column of the one before
+/// </summary>
+inline void CreateGrid(UINT cells, float size, float waveHeight, UINT levels, MeshData& mesh)
+{
+	UINT first = (UINT)mesh.vertices.size();
+	for (UINT z = 0; z <= cells; z++)
+	{
+		for (UINT x = 0; x <= cells; x++)
+		{
+			float u = (float)x / cells, v = (float)z / cells;
+			float height = waveHeight * sinf(u * 9.0f) * cosf(v * 7.0f);
+			XMFLOAT3 normal;
+			XMStoreFloat3(&normal, XMVector3Normalize(XMVectorSet(-waveHeight * 9.0f * cosf(u * 9.0f) * cosf(v * 7.0f) / size, 1.0f,
+				waveHeight * 7.0f * sinf(u * 9.0f) * sinf(v * 7.0f) / size, 0.0f)));
+			mesh.vertices.push_back(MakeVertex(XMFLOAT3(u * size, height, v * size), XMFLOAT2(u, v), normal, XMFLOAT3(1.0f, 0.0f, 0.0f)));
+		}
+	}
+
+	for (UINT level = 0; level < (levels > 0 ? levels : 1); level++)
+	{
+		MeshLOD lod = { (UINT)mesh.indices.size(), 0, level * size / cells };
+		UINT step = 1u << level;
+		for (UINT z = 0; z + step <= cells; z += step)
+		{
+			for (UINT x = 0; x + step <= cells; x += step)
+			{
+				UINT a = first + z * (cells + 1) + x;
+				UINT c = a + step * (cells + 1);
+				UINT quad[6] = { c, c + step, a, c + step, a + step, a };
+				mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+			}
+		}
+		lod.indexCount = (UINT)mesh.indices.size() - lod.indexStart;
+		if (levels > 0)
+			mesh.lods.push_back(lod);
+	}
+}
+
+/// <summary>A wavy grid with two levels of detail and the meshlets of the first, serialized the way the cook step writes it
+/// </summary>
+inline void CreateCookedGrid(UINT cells, float size, std::vector<BYTE>& cooked)
+{
+	MeshData data;
+	CreateGrid(cells, size, 1.0f, 2, data);
+	MeshletBuilder::Build(&data.vertices[0], (UINT)data.vertices.size(), &data.indices[0], data.lods[0].indexCount, 1, data.meshlets);
+	SerializeMesh(data, cooked);
+}
+
+#endif
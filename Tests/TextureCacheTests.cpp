@@ -0,0 +1,260 @@
+//
+// Texture cache sharing, hit and miss counting and budget eviction, against a texture source that hands out fake views
+// instead of creating textures on a device
+//
+
+#include "Test.h"
+#include "TextureCache.h"
+
+/// <summary>Counts references like a real view would, and how many views are still alive
+/// </summary>
+class FakeView : public ID3D11ShaderResourceView
+{
+public:
+	FakeView(int& live) :
+	references(1),
+	live(live)
+	{
+		live++;
+	}
+
+	ULONG AddRef() { return ++references; }
+
+	ULONG Release()
+	{
+		ULONG remaining = --references;
+		if (!remaining)
+			delete this;
+		return remaining;
+	}
+private:
+	~FakeView() { live--; }
+
+	ULONG references;
+	int& live;
+};
+
+/// <summary>Sizes each texture from its options, fails paths containing "missing"
+/// </summary>
+class FakeTextureSource : public TextureSource
+{
+public:
+	FakeTextureSource() :
+	created(0),
+	live(0)
+	{
+
+	}
+
+	bool CreateTexture(const std::wstring& path, const TextureLoadOptions& options, ID3D11ShaderResourceView** view, UINT64& bytes)
+	{
+		if (path.find(L"missing") != std::wstring::npos)
+			return false;
+
+		created++;
+		*view = new FakeView(live);
+		bytes = options.maxSize ? (UINT64)options.maxSize * options.maxSize * 4 : TextureBytes;
+		return true;
+	}
+
+	static const UINT64 TextureBytes = 1024;
+
+	UINT created;
+	int live;		// Views the cache (or a test) still holds
+};
+
+TEST(TextureCacheMissCreatesAndHitShares)
+{
+	FakeTextureSource source;
+	{
+		TextureCache cache(&source);
+		TextureHandle first = cache.Load(L"Textures/brick.png");
+		TextureHandle second = cache.Load(L"Textures/brick.png");
+		REQUIRE(first.IsValid());
+		CHECK(first.Get() == second.Get());
+		CHECK_EQUAL(1u, source.created);
+		CHECK_EQUAL(FakeTextureSource::TextureBytes, first.GetBytes());
+
+		TextureCacheStats stats = cache.GetStats();
+		CHECK_EQUAL(1u, stats.textures);
+		CHECK_EQUAL(1u, stats.referenced);
+		CHECK_EQUAL(1u, stats.hits);
+		CHECK_EQUAL(1u, stats.misses);
+	}
+	// The cache's reference goes with it
+	CHECK_EQUAL(0, source.live);
+}
+
+TEST(TextureCacheKeysOnCanonicalPathAndOptions)
+{
+	FakeTextureSource source;
+	TextureCache cache(&source);
+	TextureHandle plain = cache.Load(L"Textures/Brick.png");
+	TextureHandle sameFile = cache.Load(L"textures\\sub\\..\\./brick.PNG");
+	CHECK(plain.Get() == sameFile.Get());
+
+	TextureLoadOptions srgb;
+	srgb.forceSRGB = true;
+	TextureHandle other = cache.Load(L"Textures/Brick.png", srgb);
+	CHECK(plain.Get() != other.Get());
+	CHECK_EQUAL(2u, source.created);
+
+	CHECK(TextureCache::Canonicalize(L"A\\B\\..\\C/./d.png") == L"a/c/d.png");
+	CHECK(TextureCache::Canonicalize(L"../../x/../y.png") == L"../../y.png");
+	CHECK(TextureCache::Canonicalize(L"/Root//File.dds") == L"/root/file.dds");
+}
+
+TEST(TextureCacheFailedLoadIsInvalidAndNotCached)
+{
+	FakeTextureSource source;
+	TextureCache cache(&source);
+	CHECK(!cache.Load(L"missing.png").IsValid());
+	CHECK(!cache.Load(L"missing.png").IsValid());
+	CHECK(!cache.Find(L"brick.png").IsValid());
+
+	TextureCacheStats stats = cache.GetStats();
+	CHECK_EQUAL(0u, stats.textures);
+	CHECK_EQUAL(0u, stats.hits);
+	CHECK_EQUAL(2u, stats.misses);
+}
+
+TEST(TextureCacheFindNeverCreates)
+{
+	FakeTextureSource source;
+	TextureCache cache(&source);
+	CHECK(!cache.Find(L"brick.png").IsValid());
+	cache.Load(L"brick.png");
+	CHECK(cache.Find(L"brick.png").IsValid());
+	CHECK_EQUAL(1u, source.created);
+	CHECK_EQUAL(1u, cache.GetStats().hits);
+}
+
+TEST(TextureCacheUnusedTexturesStayWithinBudget)
+{
+	FakeTextureSource source;
+	TextureCache cache(&source);
+	cache.SetBudget(FakeTextureSource::TextureBytes * 10);
+	cache.Load(L"a.png");
+	cache.Load(L"b.png");
+	CHECK_EQUAL(2u, cache.GetStats().textures);
+	CHECK_EQUAL(0u, cache.GetStats().referenced);
+
+	// Unused textures stay cached while there's room, shrinking the budget drops them
+	cache.SetBudget(FakeTextureSource::TextureBytes);
+	TextureCacheStats stats = cache.GetStats();
+	CHECK_EQUAL(1u, stats.textures);
+	CHECK_EQUAL(1u, stats.evictions);
+	CHECK_EQUAL(1, source.live);
+}
+
+TEST(TextureCacheEvictsLeastRecentlyUsed)
+{
+	FakeTextureSource source;
+	TextureCache cache(&source);
+	cache.SetBudget(FakeTextureSource::TextureBytes * 3);
+	cache.Load(L"a.png");
+	cache.Load(L"b.png");
+	cache.Load(L"c.png");
+
+	// Touching a makes b the oldest
+	cache.Find(L"a.png");
+	cache.Load(L"d.png");
+	CHECK(cache.Find(L"a.png").IsValid());
+	CHECK(!cache.Find(L"b.png").IsValid());
+	CHECK(cache.Find(L"c.png").IsValid());
+	CHECK(cache.Find(L"d.png").IsValid());
+	CHECK_EQUAL(1u, cache.GetStats().evictions);
+	CHECK_EQUAL(3, source.live);
+
+	// An evicted texture is a miss again
+	cache.Load(L"b.png");
+	CHECK_EQUAL(5u, source.created);
+	CHECK_EQUAL(5u, cache.GetStats().misses);
+}
+
+TEST(TextureCacheNeverEvictsHeldTextures)
+{
+	FakeTextureSource source;
+	TextureCache cache(&source);
+	cache.SetBudget(FakeTextureSource::TextureBytes);
+	TextureHandle a = cache.Load(L"a.png");
+	TextureHandle b = cache.Load(L"b.png");
+	TextureHandle c = cache.Load(L"c.png");
+
+	// Over budget, but everything is held
+	TextureCacheStats stats = cache.GetStats();
+	CHECK_EQUAL(3u, stats.textures);
+	CHECK_EQUAL(3u, stats.referenced);
+	CHECK_EQUAL(FakeTextureSource::TextureBytes * 3, stats.referencedBytes);
+	CHECK_EQUAL(0u, stats.evictions);
+
+	// Letting go of them trims on the next pass, the most recently released one survives
+	a.Reset();
+	c.Reset();
+	b.Reset();
+	cache.Trim();
+	CHECK_EQUAL(1u, cache.GetStats().textures);
+	CHECK(cache.Find(L"b.png").IsValid());
+	CHECK_EQUAL(1, source.live);
+}
+
+TEST(TextureCacheHandleCopiesShareOneReference)
+{
+	FakeTextureSource source;
+	TextureCache cache(&source);
+	cache.SetBudget(0);
+	TextureHandle handle = cache.Load(L"a.png");
+	{
+		TextureHandle copy = handle;
+		TextureHandle assigned;
+		assigned = copy;
+		handle.Reset();
+		CHECK_EQUAL(1u, cache.GetStats().referenced);
+	}
+	// The last copy going lets the zero budget take it
+	cache.Trim();
+	CHECK_EQUAL(0u, cache.GetStats().textures);
+	CHECK_EQUAL(0, source.live);
+}
+
+TEST(TextureCacheInsertTakesReferenceAndKeepsExisting)
+{
+	FakeTextureSource source;
+	TextureCache cache(&source);
+	FakeView* streamed = new FakeView(source.live);
+	TextureHandle inserted = cache.Insert(L"streamed.dds", TextureLoadOptions(), streamed, 4096);
+	CHECK(inserted.Get() == streamed);
+	CHECK_EQUAL(4096u, inserted.GetBytes());
+
+	// The caller's reference is still its own to release
+	streamed->Release();
+	CHECK_EQUAL(1, source.live);
+
+	// Loading the same key hits instead of going to the source
+	CHECK(cache.Load(L"Streamed.dds").Get() == inserted.Get());
+	CHECK_EQUAL(0u, source.created);
+
+	FakeView* duplicate = new FakeView(source.live);
+	CHECK(cache.Insert(L"streamed.dds", TextureLoadOptions(), duplicate, 4096).Get() == inserted.Get());
+	duplicate->Release();
+	CHECK_EQUAL(1, source.live);
+}
+
+TEST(TextureCacheReusesEvictedSlots)
+{
+	FakeTextureSource source;
+	TextureCache cache(&source);
+	cache.SetBudget(0);
+	for (UINT i = 0; i < 100; i++)
+	{
+		std::wostringstream path;
+		path << L"texture" << i << L".png";
+		TextureHandle handle = cache.Load(path.str());
+		CHECK(handle.IsValid());
+	}
+	cache.Trim();
+	TextureCacheStats stats = cache.GetStats();
+	CHECK_EQUAL(0u, stats.textures);
+	CHECK_EQUAL(0u, stats.bytes);
+	CHECK_EQUAL(0, source.live);
+}
@@ -0,0 +1,20 @@
+//
+// Runs the texture cooker from the command line, without the application or a window
+// Takes the same settings as -cook: build/cook in=Debug/Textures out=Debug/Textures threads=0 srgb=0 mips=1 report=cook.log
+// The report is also written to stderr
+//
+
+#include <string>
+
+#include "CookCommand.h"
+
+int main(int argc, char** argv)
+{
+	std::string cmdLine = "-cook";
+	for (int i = 1; i < argc; i++)
+		cmdLine += std::string(" ") + argv[i];
+
+	CookCommand cook;
+	cook.ParseCommandLine(cmdLine.c_str());
+	return cook.Run();
+}
@@ -0,0 +1,168 @@
+//
+// Runs the benchmark scene's update, cull, sort and submit stages without a window or a device
+// Takes the same settings as -benchmark: seed=1 objects=1000 lights=8 dynamic=0.25 frames=1000 out=benchmark.json
+// Submitting writes each draw's constants to a staging buffer, counting what the renderer would upload. The imported
+// models stand in as boxes of their size and nothing is batched, so draw counts differ from the windowed run
+//
+
+#include <Windows.h>
+#include <DirectXMath.h>
+#include <string>
+#include <vector>
+
+#include "BenchmarkRunner.h"
+#include "DrawQueue.h"
+#include "OcclusionCuller.h"
+#include "SceneGenerator.h"
+
+using namespace DirectX;
+
+// Same resolution the windowed run culls the camera view at
+static const UINT OcclusionWidth = 320;
+static const UINT OcclusionHeight = 180;
+
+// Camera lens of the windowed run
+static const float FieldOfView = 0.25f * XM_PI;
+static const float AspectRatio = 1280.0f / 720.0f;
+static const float NearZ = 0.1f;
+static const float FarZ = 200.0f;
+
+// Mesh palette of the windowed run: the generated sphere, then the cube, pawn and chair models
+struct PaletteMesh
+{
+	MeshBounds bounds;
+	float occluderFill;	// Share of the bounds that's solid, 0 for meshes too thin to occlude
+};
+
+static const PaletteMesh Palette[] =
+{
+	{ { XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.5f, 0.5f, 0.5f) }, 0.55f },
+	{ { XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f) }, 1.0f },
+	{ { XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT3(0.4f, 1.0f, 0.4f) }, 0.0f },
+	{ { XMFLOAT3(0.0f, 0.75f, 0.0f), XMFLOAT3(0.5f, 0.75f, 0.5f) }, 0.0f }
+};
+
+static const UINT PaletteSize = sizeof(Palette) / sizeof(Palette[0]);
+
+// What SetObjectData uploads per draw, without the material values
+struct ObjectConstants
+{
+	XMFLOAT4X4 world;
+	XMFLOAT4X4 worldInverseTranspose;
+};
+
+// Material ids, the ground has its own
+static const UINT GroundMaterial = 0;
+static const UINT ObjectMaterial = 1;
+
+static XMMATRIX ObjectWorld(const GeneratedObject& obj)
+{
+	return XMMatrixScaling(obj.scale.x, obj.scale.y, obj.scale.z) *
+		XMMatrixRotationRollPitchYaw(obj.rotation.x, obj.rotation.y, obj.rotation.z) *
+		XMMatrixTranslation(obj.position.x, obj.position.y, obj.position.z);
+}
+
+int main(int argc, char** argv)
+{
+	std::string cmdLine = "-benchmark";
+	for (int i = 1; i < argc; i++)
+		cmdLine += std::string(" ") + argv[i];
+
+	BenchmarkRunner runner;
+	runner.ParseCommandLine(cmdLine.c_str());
+
+	SceneDesc desc = runner.GetSceneDesc();
+	desc.meshCount = PaletteSize;
+	GeneratedScene scene;
+	SceneGenerator::Generate(desc, scene);
+
+	// Object 0 is the ground, the generated objects follow
+	MeshBounds groundBounds = { XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(desc.extent * 0.5f, 0.0f, desc.extent * 0.5f) };
+	XMFLOAT4X4 groundWorld;
+	XMStoreFloat4x4(&groundWorld, XMMatrixIdentity());
+
+	size_t objectCount = scene.objects.size() + 1;
+	std::vector<XMFLOAT4X4> worlds(objectCount, groundWorld);
+	std::vector<bool> visible(objectCount);
+	std::vector<ObjectConstants> staging(objectCount);
+
+	OcclusionCuller culler;
+	culler.Resize(OcclusionWidth, OcclusionHeight);
+	DrawQueue queue;
+	XMMATRIX proj = XMMatrixPerspectiveFovLH(FieldOfView, AspectRatio, NearZ, FarZ);
+
+	// Nothing streams here, so the run settles on its first frame
+	bool done = false;
+	while (!done)
+	{
+		FrameStats stats;
+
+		// Update
+		float dt = runner.IsSettling() ? 0.0f : runner.GetFixedStep();
+		for (size_t i = 0; i < scene.objects.size(); i++)
+		{
+			GeneratedObject& obj = scene.objects[i];
+			if (obj.dynamic)
+				XMStoreFloat3(&obj.rotation, XMLoadFloat3(&obj.rotation) + XMLoadFloat3(&obj.angularVelocity) * dt);
+			XMStoreFloat4x4(&worlds[i + 1], ObjectWorld(obj));
+		}
+		XMFLOAT3 eye, target;
+		SceneGenerator::SampleCameraPath(scene, runner.GetProgress(), eye, target);
+		XMMATRIX view = XMMatrixLookAtLH(XMLoadFloat3(&eye), XMLoadFloat3(&target), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		XMFLOAT4X4 viewProj;
+		XMStoreFloat4x4(&viewProj, view * proj);
+
+		// Cull
+		culler.Begin(viewProj);
+		culler.RenderBox(groundBounds, groundWorld);
+		for (size_t i = 0; i < scene.objects.size(); i++)
+		{
+			const PaletteMesh& mesh = Palette[scene.objects[i].mesh];
+			if (mesh.occluderFill <= 0.0f)
+				continue;
+			MeshBounds box = mesh.bounds;
+			box.extents.x *= mesh.occluderFill;
+			box.extents.y *= mesh.occluderFill;
+			box.extents.z *= mesh.occluderFill;
+			culler.RenderBox(box, worlds[i + 1]);
+		}
+		culler.End();
+		visible[0] = culler.IsVisible(groundBounds, groundWorld);
+		for (size_t i = 0; i < scene.objects.size(); i++)
+			visible[i + 1] = culler.IsVisible(Palette[scene.objects[i].mesh].bounds, worlds[i + 1]);
+		stats.visible = culler.GetStats().visible;
+		stats.occluded = culler.GetStats().occluded;
+
+		// Sort, the ground's mesh id comes after the palette's
+		queue.Clear();
+		if (visible[0])
+			queue.Add(GroundMaterial, PaletteSize, 0, 0);
+		for (size_t i = 0; i < scene.objects.size(); i++)
+		{
+			if (visible[i + 1])
+				queue.Add(ObjectMaterial, scene.objects[i].mesh, 0, (UINT)(i + 1));
+		}
+		queue.Sort();
+
+		// Submit
+		for (const DrawItem& draw : queue.GetItems())
+		{
+			ObjectConstants& constants = staging[stats.draws];
+			XMMATRIX world = XMLoadFloat4x4(&worlds[draw.object]);
+			XMStoreFloat4x4(&constants.world, XMMatrixTranspose(world));
+			XMStoreFloat4x4(&constants.worldInverseTranspose, XMMatrixInverse(NULL, world));
+			stats.bytesUploaded += sizeof(ObjectConstants);
+			stats.draws++;
+		}
+		stats.stateChanges = queue.CountStateChanges();
+
+		done = runner.EndFrame(stats, true);
+	}
+
+	if (!runner.WriteReport())
+	{
+		fprintf(stderr, "Couldn't write the benchmark report\n");
+		return 1;
+	}
+	return 0;
+}